@@ -39,6 +39,8 @@ static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL
 static void dvcman_free(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChannelMgr);
 static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const BYTE* data,
                                UINT32 dataSize, BOOL* close);
+static UINT drdynvc_write_compressed_data(drdynvcPlugin* drdynvc, DVCMAN_CHANNEL* channel,
+                                          const BYTE* data, UINT32 dataSize);
 static UINT drdynvc_send(drdynvcPlugin* drdynvc, wStream* s);
 
 static void dvcman_wtslistener_free(DVCMAN_LISTENER* listener)
@@ -390,6 +392,8 @@ static void dvcman_channel_free(DVCMAN_CHANNEL* channel)
 	if (channel->dvc_data)
 		Stream_Release(channel->dvc_data);
 
+	zgfx_context_free(channel->compressor);
+	zgfx_context_free(channel->decompressor);
 	DeleteCriticalSection(&(channel->lock));
 	free(channel->channel_name);
 	free(channel);
@@ -622,9 +626,14 @@ static UINT dvcman_write_channel(IWTSVirtualChannel* pChannel, ULONG cbSize, con
 	if (!channel || !channel->dvcman)
 		return CHANNEL_RC_BAD_CHANNEL;
 
+	drdynvcPlugin* drdynvc = channel->dvcman->drdynvc;
+	WINPR_ASSERT(drdynvc);
+
 	EnterCriticalSection(&(channel->lock));
-	status =
-	    drdynvc_write_data(channel->dvcman->drdynvc, channel->channel_id, pBuffer, cbSize, &close);
+	if (channel->compress && (cbSize > 0) && (drdynvc->version >= 3))
+		status = drdynvc_write_compressed_data(drdynvc, channel, pBuffer, cbSize);
+	else
+		status = drdynvc_write_data(drdynvc, channel->channel_id, pBuffer, cbSize, &close);
 	LeaveCriticalSection(&(channel->lock));
 	/* Close delayed, it removes the channel struct */
 	if (close)
@@ -746,6 +755,9 @@ static DVCMAN_CHANNEL* dvcman_create_channel(drdynvcPlugin* drdynvc,
 	channel->state = DVC_CHANNEL_RUNNING;
 	channel->channel_callback = pCallback;
 	channel->pInterface = listener->iface.pInterface;
+	channel->compress = ((listener->flags & WTS_CHANNEL_OPTION_DYNAMIC_NO_COMPRESS) == 0) &&
+	                    freerdp_settings_get_bool(drdynvc->rdpcontext->settings,
+	                                              FreeRDP_DynamicChannelCompression);
 	context = dvcman->drdynvc->context;
 
 	IFCALLRET(context->OnChannelConnected, *res, context, ChannelName, listener->iface.pInterface);
@@ -868,6 +880,46 @@ out:
 	return status;
 }
 
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT dvcman_receive_compressed_channel_data(DVCMAN_CHANNEL* channel, wStream* data,
+                                                   UINT32 ThreadingFlags)
+{
+	BYTE* pDstData = NULL;
+	UINT32 DstSize = 0;
+	wStream sbuffer = { 0 };
+
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->dvcman);
+
+	drdynvcPlugin* drdynvc = channel->dvcman->drdynvc;
+	if (!channel->decompressor)
+	{
+		channel->decompressor = zgfx_context_new_ex(FALSE, DRDYNVC_RDP8_LITE_HISTORY_SIZE);
+		if (!channel->decompressor)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "zgfx_context_new_ex failed!");
+			return CHANNEL_RC_NO_MEMORY;
+		}
+	}
+
+	if (!drdynvc_decompress_data(channel->decompressor, Stream_ConstPointer(data),
+	                             Stream_GetRemainingLength(data), &pDstData, &DstSize))
+	{
+		WLog_Print(drdynvc->log, WLOG_ERROR, "ChannelId %" PRIu32 " failed to decompress data",
+		           channel->channel_id);
+		return ERROR_INVALID_DATA;
+	}
+
+	wStream* s = Stream_StaticConstInit(&sbuffer, pDstData, DstSize);
+	const UINT status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
+	free(pDstData);
+	return status;
+}
+
 static UINT8 drdynvc_write_variable_uint(wStream* s, UINT32 val)
 {
 	UINT8 cb = 0;
@@ -1044,6 +1096,84 @@ static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const B
 	return CHANNEL_RC_OK;
 }
 
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT drdynvc_write_compressed_data(drdynvcPlugin* drdynvc, DVCMAN_CHANNEL* channel,
+                                          const BYTE* data, UINT32 dataSize)
+{
+	UINT status = CHANNEL_RC_OK;
+	BOOL first = TRUE;
+
+	WINPR_ASSERT(drdynvc);
+	WINPR_ASSERT(channel);
+
+	DVCMAN* dvcman = (DVCMAN*)drdynvc->channel_mgr;
+	WINPR_ASSERT(dvcman);
+
+	WLog_Print(drdynvc->log, WLOG_TRACE,
+	           "write_compressed_data: ChannelId=%" PRIu32 " size=%" PRIu32 "",
+	           channel->channel_id, dataSize);
+
+	if (!channel->compressor)
+	{
+		channel->compressor = zgfx_context_new_ex(TRUE, DRDYNVC_RDP8_LITE_HISTORY_SIZE);
+		if (!channel->compressor)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "zgfx_context_new_ex failed!");
+			return CHANNEL_RC_NO_MEMORY;
+		}
+	}
+
+	while ((status == CHANNEL_RC_OK) && (dataSize > 0))
+	{
+		UINT8 cbLen = 0;
+		UINT8 Cmd = DATA_COMPRESSED_PDU;
+		const UINT32 chunkLength = MIN(dataSize, DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE);
+		wStream* data_out = StreamPool_Take(dvcman->pool, CHANNEL_CHUNK_LENGTH);
+
+		if (!data_out)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "StreamPool_Take failed!");
+			return CHANNEL_RC_NO_MEMORY;
+		}
+
+		Stream_SetPosition(data_out, 1);
+		const UINT8 cbChId = drdynvc_write_variable_uint(data_out, channel->channel_id);
+
+		if (first && (dataSize > chunkLength))
+		{
+			cbLen = drdynvc_write_variable_uint(data_out, dataSize);
+			Cmd = DATA_FIRST_COMPRESSED_PDU;
+		}
+
+		first = FALSE;
+
+		if (!drdynvc_compress_data(channel->compressor, data_out, data, chunkLength))
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "drdynvc_compress_data failed!");
+			Stream_Release(data_out);
+			return ERROR_INTERNAL_ERROR;
+		}
+
+		Stream_Buffer(data_out)[0] = (BYTE)((Cmd << 4) | (cbLen << 2) | cbChId);
+		data += chunkLength;
+		dataSize -= chunkLength;
+		status = drdynvc_send(drdynvc, data_out);
+	}
+
+	if (status != CHANNEL_RC_OK)
+	{
+		WLog_Print(drdynvc->log, WLOG_ERROR, "VirtualChannelWriteEx failed with %s [%08" PRIX32 "]",
+		           WTSErrorToString(status), status);
+		return status;
+	}
+
+	return CHANNEL_RC_OK;
+}
+
 /**
  * Function description
  *
@@ -1103,6 +1233,10 @@ static UINT drdynvc_process_capability_request(drdynvcPlugin* drdynvc, int Sp, i
 	Stream_Seek(s, 1); /* pad */
 	Stream_Read_UINT16(s, drdynvc->version);
 
+	/* version 3 adds compressed data PDUs, we do not support anything newer */
+	if (drdynvc->version > 3)
+		drdynvc->version = 3;
+
 	/* RDP8 servers offer version 3, though Microsoft forgot to document it
 	 * in their early documents.  It behaves the same as version 2.
 	 */
@@ -1275,7 +1409,7 @@ static UINT drdynvc_process_create_request(drdynvcPlugin* drdynvc, UINT8 Sp, UIN
  * @return 0 on success, otherwise a Win32 error code
  */
 static UINT drdynvc_process_data_first(drdynvcPlugin* drdynvc, int Sp, int cbChId, wStream* s,
-                                       UINT32 ThreadingFlags)
+                                       UINT32 ThreadingFlags, BOOL compressed)
 {
 	UINT status = CHANNEL_RC_OK;
 	UINT32 Length = 0;
@@ -1311,7 +1445,12 @@ static UINT drdynvc_process_data_first(drdynvcPlugin* drdynvc, int Sp, int cbChI
 	status = dvcman_receive_channel_data_first(channel, Length);
 
 	if (status == CHANNEL_RC_OK)
-		status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
+	{
+		if (compressed)
+			status = dvcman_receive_compressed_channel_data(channel, s, ThreadingFlags);
+		else
+			status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
+	}
 
 	if (status != CHANNEL_RC_OK)
 		status = dvcman_channel_close(channel, FALSE, FALSE);
@@ -1327,7 +1466,7 @@ out:
  * @return 0 on success, otherwise a Win32 error code
  */
 static UINT drdynvc_process_data(drdynvcPlugin* drdynvc, int Sp, int cbChId, wStream* s,
-                                 UINT32 ThreadingFlags)
+                                 UINT32 ThreadingFlags, BOOL compressed)
 {
 	UINT32 ChannelId = 0;
 	DVCMAN_CHANNEL* channel = NULL;
@@ -1356,7 +1495,10 @@ static UINT drdynvc_process_data(drdynvcPlugin* drdynvc, int Sp, int cbChId, wSt
 	if (channel->state != DVC_CHANNEL_RUNNING)
 		goto out;
 
-	status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
+	if (compressed)
+		status = dvcman_receive_compressed_channel_data(channel, s, ThreadingFlags);
+	else
+		status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
 	if (status != CHANNEL_RC_OK)
 		status = dvcman_channel_close(channel, FALSE, FALSE);
 
@@ -1426,10 +1568,16 @@ static UINT drdynvc_order_recv(drdynvcPlugin* drdynvc, wStream* s, UINT32 Thread
 			return drdynvc_process_create_request(drdynvc, Sp, cbChId, s);
 
 		case DATA_FIRST_PDU:
-			return drdynvc_process_data_first(drdynvc, Sp, cbChId, s, ThreadingFlags);
+			return drdynvc_process_data_first(drdynvc, Sp, cbChId, s, ThreadingFlags, FALSE);
 
 		case DATA_PDU:
-			return drdynvc_process_data(drdynvc, Sp, cbChId, s, ThreadingFlags);
+			return drdynvc_process_data(drdynvc, Sp, cbChId, s, ThreadingFlags, FALSE);
+
+		case DATA_FIRST_COMPRESSED_PDU:
+			return drdynvc_process_data_first(drdynvc, Sp, cbChId, s, ThreadingFlags, TRUE);
+
+		case DATA_COMPRESSED_PDU:
+			return drdynvc_process_data(drdynvc, Sp, cbChId, s, ThreadingFlags, TRUE);
 
 		case CLOSE_REQUEST_PDU:
 			return drdynvc_process_close_request(drdynvc, Sp, cbChId, s);
@@ -765,7 +765,9 @@ CameraDevice* ecam_dev_create(CameraPlugin* ecam, const char* deviceId,
 	dev->hlistener->iface.OnNewChannelConnection = ecam_dev_on_new_channel_connection;
 	dev->hlistener->plugin = (IWTSPlugin*)dev;
 	dev->hlistener->channel_mgr = pChannelMgr;
-	if (CHANNEL_RC_OK != pChannelMgr->CreateListener(pChannelMgr, deviceId, 0,
+	/* Samples are already encoded (MJPG, H264), do not compress them again */
+	if (CHANNEL_RC_OK != pChannelMgr->CreateListener(pChannelMgr, deviceId,
+	                                                 WTS_CHANNEL_OPTION_DYNAMIC_NO_COMPRESS,
 	                                                 &dev->hlistener->iface, &dev->listener))
 	{
 		free(dev->hlistener);
@@ -125,18 +125,20 @@ static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
 		return ERROR_INTERNAL_ERROR;
 
 	wStream* fs = NULL;
-	/* Allocate new stream with enough capacity. Additional overhead is
-	 * descriptor (1 bytes) + segmentCount (2 bytes) + uncompressedSize (4 bytes)
-	 * + segmentCount * size (4 bytes) */
-	fs = Stream_New(NULL, SrcSize + 7 + (SrcSize / ZGFX_SEGMENTED_MAXSIZE + 1) * 4);
+	/* Get a channel stream with enough capacity, the segments are handed to the channel
+	 * without another copy. Additional overhead is descriptor (1 bytes) + segmentCount
+	 * (2 bytes) + uncompressedSize (4 bytes) + segmentCount * size (4 bytes) */
+	fs = WTSVirtualChannelStreamNew(context->priv->rdpgfx_channel,
+	                                SrcSize + 7 + (SrcSize / ZGFX_SEGMENTED_MAXSIZE + 1) * 4);
 
 	if (!fs)
 	{
-		WLog_Print(context->priv->log, WLOG_ERROR, "Stream_New failed!");
+		WLog_Print(context->priv->log, WLOG_ERROR, "WTSVirtualChannelStreamNew failed!");
 		error = CHANNEL_RC_NO_MEMORY;
 		goto out;
 	}
 
+	const size_t start = Stream_GetPosition(fs);
 	if (zgfx_compress_to_stream(context->priv->zgfx, fs, pSrcData, (UINT32)SrcSize, &flags) < 0)
 	{
 		WLog_Print(context->priv->log, WLOG_ERROR, "zgfx_compress_to_stream failed!");
@@ -144,27 +146,28 @@ static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
 		goto out;
 	}
 
-	const size_t pos = Stream_GetPosition(fs);
+	const size_t length = Stream_GetPosition(fs) - start;
 
-	WINPR_ASSERT(pos <= UINT32_MAX);
-	if (!WTSVirtualChannelWrite(context->priv->rdpgfx_channel, Stream_BufferAs(fs, char),
-	                            (UINT32)pos, &written))
+	/* the channel owns the stream from now on */
+	const BOOL rc = WTSVirtualChannelWriteStream(context->priv->rdpgfx_channel, fs, &written);
+	fs = NULL;
+	if (!rc)
 	{
-		WLog_Print(context->priv->log, WLOG_ERROR, "WTSVirtualChannelWrite failed!");
+		WLog_Print(context->priv->log, WLOG_ERROR, "WTSVirtualChannelWriteStream failed!");
 		error = ERROR_INTERNAL_ERROR;
 		goto out;
 	}
 
-	if (written < Stream_GetPosition(fs))
+	if (written < length)
 	{
 		WLog_Print(context->priv->log, WLOG_WARN,
-		           "Unexpected bytes written: %" PRIu32 "/%" PRIuz "", written,
-		           Stream_GetPosition(fs));
+		           "Unexpected bytes written: %" PRIu32 "/%" PRIuz "", written, length);
 	}
 
 	error = CHANNEL_RC_OK;
 out:
-	Stream_Free(fs, TRUE);
+	if (fs)
+		Stream_Release(fs);
 	Stream_Free(s, TRUE);
 	return error;
 }
@@ -1492,31 +1495,47 @@ static DWORD WINAPI rdpgfx_server_thread_func(LPVOID arg)
 
 	RdpgfxServerPrivate* priv = context->priv;
 	DWORD status = 0;
-	DWORD nCount = 0;
-	HANDLE events[8] = { 0 };
 	UINT error = CHANNEL_RC_OK;
+	WINPR_WAIT_SET* events = NULL;
 
 	WINPR_ASSERT(priv);
 
+	/* the handles do not change for the lifetime of the thread, register them once */
+	events = WaitSet_New();
+	if (!events)
+	{
+		WLog_Print(context->priv->log, WLOG_ERROR, "WaitSet_New failed!");
+		error = CHANNEL_RC_NO_MEMORY;
+		goto out;
+	}
+
 	if (priv->ownThread)
 	{
 		WINPR_ASSERT(priv->stopEvent);
-		events[nCount++] = priv->stopEvent;
+		if (!WaitSet_Add(events, priv->stopEvent))
+		{
+			error = ERROR_INTERNAL_ERROR;
+			goto out;
+		}
 	}
 
 	WINPR_ASSERT(priv->channelEvent);
-	events[nCount++] = priv->channelEvent;
+	if (!WaitSet_Add(events, priv->channelEvent))
+	{
+		error = ERROR_INTERNAL_ERROR;
+		goto out;
+	}
 
 	/* Main virtual channel loop. RDPGFX do not need version negotiation */
 	while (TRUE)
 	{
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+		status = WaitSet_Wait(events, INFINITE);
 
 		if (status == WAIT_FAILED)
 		{
 			error = GetLastError();
 			WLog_Print(context->priv->log, WLOG_ERROR,
-			           "WaitForMultipleObjects failed with error %" PRIu32 "", error);
+			           "WaitSet_Wait failed with error %" PRIu32 "", error);
 			break;
 		}
 
@@ -1532,6 +1551,9 @@ static DWORD WINAPI rdpgfx_server_thread_func(LPVOID arg)
 		}
 	}
 
+out:
+	WaitSet_Free(events);
+
 	if (error && context->rdpcontext)
 		setChannelError(context->rdpcontext, error, "rdpgfx_server_thread_func reported an error");
 
@@ -1564,8 +1586,10 @@ static BOOL rdpgfx_server_open(RdpgfxServerContext* context)
 
 		priv->SessionId = (DWORD)*pSessionId;
 		WTSFreeMemory(pSessionId);
+		/* RDPGFX PDUs are already bulk compressed */
+		const DWORD flags = WTS_CHANNEL_OPTION_DYNAMIC | WTS_CHANNEL_OPTION_DYNAMIC_NO_COMPRESS;
 		priv->rdpgfx_channel = WTSVirtualChannelOpenEx(priv->SessionId, RDPGFX_DVC_CHANNEL_NAME,
-		                                               WTS_CHANNEL_OPTION_DYNAMIC);
+		                                               flags);
 
 		if (!priv->rdpgfx_channel)
 		{
@@ -473,11 +473,11 @@ static UINT rdpsnd_server_training(RdpsndServerContext* context, UINT16 timestam
 	return status ? CHANNEL_RC_OK : ERROR_INTERNAL_ERROR;
 }
 
-static BOOL rdpsnd_server_align_wave_pdu(wStream* s, UINT32 alignment)
+static BOOL rdpsnd_server_align_wave_pdu(wStream* s, size_t start, UINT32 alignment)
 {
 	size_t size = 0;
 	Stream_SealLength(s);
-	size = Stream_Length(s);
+	size = Stream_Length(s) - start;
 
 	if ((size % alignment) != 0)
 	{
@@ -534,7 +534,7 @@ static UINT rdpsnd_server_send_wave_pdu(RdpsndServerContext* context, UINT16 wTi
 		return ERROR_INTERNAL_ERROR;
 
 	/* Set stream size */
-	if (!rdpsnd_server_align_wave_pdu(s, format->nBlockAlign))
+	if (!rdpsnd_server_align_wave_pdu(s, 0, format->nBlockAlign))
 		return ERROR_INTERNAL_ERROR;
 
 	const size_t end = Stream_GetPosition(s);
@@ -592,14 +592,17 @@ static UINT rdpsnd_server_send_wave2_pdu(RdpsndServerContext* context, UINT16 fo
 	ULONG written = 0;
 	UINT error = CHANNEL_RC_OK;
 	BOOL status = 0;
-	wStream* s = rdpsnd_server_get_buffer(context);
+	/* The PDU is built in a channel stream, the channel takes it over without a copy */
+	wStream* s = WTSVirtualChannelStreamNew(context->priv->ChannelHandle, 16 + size);
 
-	if (!Stream_EnsureRemainingCapacity(s, 16))
+	if (!s)
 	{
-		error = ERROR_INTERNAL_ERROR;
+		error = CHANNEL_RC_NO_MEMORY;
 		goto out;
 	}
 
+	const size_t start = Stream_GetPosition(s);
+
 	/* Wave2 PDU */
 	Stream_Write_UINT8(s, SNDC_WAVE2);        /* msgType */
 	Stream_Write_UINT8(s, 0);                 /* bPad */
@@ -633,29 +636,32 @@ static UINT rdpsnd_server_send_wave2_pdu(RdpsndServerContext* context, UINT16 fo
 		}
 
 		format = &context->client_formats[formatNo];
-		if (!rdpsnd_server_align_wave_pdu(s, format->nBlockAlign))
+		if (!rdpsnd_server_align_wave_pdu(s, start, format->nBlockAlign))
 		{
 			error = ERROR_INTERNAL_ERROR;
 			goto out;
 		}
 	}
 
-	const size_t end = Stream_GetPosition(s);
+	const size_t end = Stream_GetPosition(s) - start;
 	if (end > UINT16_MAX + 4)
 	{
 		error = ERROR_INTERNAL_ERROR;
 		goto out;
 	}
 
-	Stream_SetPosition(s, 2);
+	Stream_SetPosition(s, start + 2);
 	Stream_Write_UINT16(s, (UINT16)(end - 4));
+	Stream_SetPosition(s, start + end);
 
-	status = WTSVirtualChannelWrite(context->priv->ChannelHandle, Stream_BufferAs(s, char),
-	                                (UINT32)end, &written);
+	status = WTSVirtualChannelWriteStream(context->priv->ChannelHandle, s, &written);
+	s = NULL;
 
 	if (!status || (end != written))
 	{
-		WLog_ERR(TAG, "WTSVirtualChannelWrite failed! [stream length=%" PRIuz " - written=%" PRIu32,
+		WLog_ERR(TAG,
+		         "WTSVirtualChannelWriteStream failed! [stream length=%" PRIuz
+		         " - written=%" PRIu32,
 		         end, written);
 		error = ERROR_INTERNAL_ERROR;
 	}
@@ -663,7 +669,8 @@ static UINT rdpsnd_server_send_wave2_pdu(RdpsndServerContext* context, UINT16 fo
 	context->block_no = (context->block_no + 1) % 256;
 
 out:
-	Stream_SetPosition(s, 0);
+	if (s)
+		Stream_Release(s);
 	context->priv->out_pending_frames = 0;
 	return error;
 }
@@ -87,9 +87,13 @@ static UINT xf_OutputUpdate(xfContext* xfc, xfGfxSurface* surface)
 
 		if (surface->stage)
 		{
-			if (!freerdp_image_scale(surface->stage, gdi->dstFormat, surface->stageScanline, nXSrc,
-			                         nYSrc, dwidth, dheight, surface->gdi.data, surface->gdi.format,
-			                         surface->gdi.scanline, nXSrc, nYSrc, swidth, sheight))
+			if (!surface->gdi.scaler)
+				surface->gdi.scaler = freerdp_image_scaler_new();
+
+			if (!freerdp_image_scaler_scale(surface->gdi.scaler, surface->stage, gdi->dstFormat,
+			                                surface->stageScanline, nXSrc, nYSrc, dwidth, dheight,
+			                                surface->gdi.data, surface->gdi.format,
+			                                surface->gdi.scanline, nXSrc, nYSrc, swidth, sheight))
 				goto fail;
 		}
 
@@ -430,6 +434,7 @@ static UINT xf_DeleteSurface(RdpgfxClientContext* context,
 		XDestroyImage(surface->image);
 		winpr_aligned_free(surface->gdi.data);
 		winpr_aligned_free(surface->stage);
+		freerdp_image_scaler_free(surface->gdi.scaler);
 		region16_uninit(&surface->gdi.invalidRegion);
 		codecs = surface->gdi.codecs;
 		free(surface);
@@ -4920,6 +4920,11 @@ static int parse_command_line(rdpSettings* settings, const COMMAND_LINE_ARGUMENT
 			if (rc != 0)
 				return fail_at(arg, rc);
 		}
+		CommandLineSwitchCase(arg, "dvc-compression")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_DynamicChannelCompression, enable))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
 		CommandLineSwitchCase(arg, "disable-output")
 		{
 			if (!freerdp_settings_set_bool(settings, FreeRDP_DeactivateClientDecoding, enable))
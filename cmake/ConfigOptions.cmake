@@ -155,8 +155,8 @@ endif()
 
 option(USE_VERSION_FROM_GIT_TAG "Extract FreeRDP version from git tag." ON)
 
-option(WITH_CAIRO "Use CAIRO image library for screen resizing" OFF)
-option(WITH_SWSCALE "Use SWScale image library for screen resizing" ON)
+option(WITH_CAIRO "Deprecated, screen resizing no longer uses CAIRO" OFF)
+option(WITH_SWSCALE "Use SWScale image library (required by the camera redirection channel)" ON)
 
 if(ANDROID)
   include(ConfigOptionsAndroid)
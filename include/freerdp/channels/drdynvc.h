@@ -32,6 +32,18 @@
 #define DRDYNVC_CHANNEL_NAME "drdynvc"
 #define DRDYNVC_SVC_CHANNEL_NAME "drdynvc"
 
+/** The largest uncompressed payload of a DATA_FIRST_COMPRESSED or DATA_COMPRESSED PDU
+ *
+ *  \since version 3.17.0
+ */
+#define DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE 1590
+
+/** The history size of the RDP 8.0 Lite compression used for dynamic channel data
+ *
+ *  \since version 3.17.0
+ */
+#define DRDYNVC_RDP8_LITE_HISTORY_SIZE 8192
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -38,6 +38,7 @@
 #include <winpr/winpr.h>
 #include <winpr/wtypes.h>
 #include <winpr/wtsapi.h>
+#include <winpr/stream.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -90,6 +91,37 @@ extern "C"
 
 	FREERDP_API UINT32 WTSChannelGetIdByHandle(HANDLE hChannelHandle);
 
+	/** @brief Get a stream for \b WTSVirtualChannelWriteStream
+	 *
+	 *  The stream is taken from a pool of the channel manager and positioned after some
+	 *  reserved space for the channel headers. The payload is written from there on.
+	 *  Large streams are not pooled, they are freed once sent.
+	 *
+	 *  @param hChannelHandle The channel the stream is written to
+	 *  @param size The expected payload size, the stream grows as usual if required
+	 *
+	 *  @return A new stream or \b NULL in case of failure
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API wStream* WTSVirtualChannelStreamNew(HANDLE hChannelHandle, size_t size);
+
+	/** @brief Write the payload of a stream to a channel without copying it
+	 *
+	 *  The payload ends at the current position of the stream, the headers are written in
+	 *  the reserved space in front of it. Fragments of dynamic channel data reference the
+	 *  stream and get a header of their own, only compressed data is copied to the PDUs.
+	 *
+	 *  @param hChannelHandle The channel to write to
+	 *  @param s A stream returned by \b WTSVirtualChannelStreamNew, the function always takes
+	 *  ownership of it
+	 *  @param pBytesWritten Optional pointer receiving the payload size
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL WTSVirtualChannelWriteStream(HANDLE hChannelHandle, wStream* s,
+	                                              PULONG pBytesWritten);
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,4 +36,25 @@
 #define L1_COMPRESSED 0x01
 #define L1_INNER_COMPRESSION 0x10
 
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief effort levels of the MPPC, NCRUSH and XCRUSH compressors
+	 *
+	 *  The default is 0 so that an unset FreeRDP_CompressionEffort selects it.
+	 *  @since version 3.17.0
+	 */
+	typedef enum
+	{
+		BULK_COMPRESSION_EFFORT_DEFAULT = 0, /** moderate hash chains */
+		BULK_COMPRESSION_EFFORT_FAST,        /** a single probe, greedy matching */
+		BULK_COMPRESSION_EFFORT_MAX          /** long hash chains, lazy matching */
+	} BULK_COMPRESSION_EFFORT;
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* FREERDP_CODEC_BULK_H */
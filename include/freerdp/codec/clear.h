@@ -33,11 +33,37 @@ extern "C"
 
 	typedef struct S_CLEAR_CONTEXT CLEAR_CONTEXT;
 
+	/** @brief Not supported, the bitmap geometry is unknown, use \b clear_compress_to_stream
+	 *
+	 *  @return -1, \b ppDstData and \b pDstSize are cleared
+	 */
 	FREERDP_API int clear_compress(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 	                               const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
 	                               BYTE** WINPR_RESTRICT ppDstData,
 	                               UINT32* WINPR_RESTRICT pDstSize);
 
+	/** @brief Compress a bitmap with ClearCodec
+	 *
+	 *  The context must have been created with \b Compressor set to \b TRUE. The encoder keeps
+	 *  its vBar, short vBar and glyph caches in sync with the ones of the decoder, so every
+	 *  message produced must be sent to the peer in order.
+	 *
+	 *  @param clear The context to use
+	 *  @param s The stream to append the ClearCodec message to
+	 *  @param pSrcData The bitmap to compress
+	 *  @param SrcFormat The pixel format of \b pSrcData
+	 *  @param nSrcStep The line stride of \b pSrcData in bytes
+	 *  @param nWidth The width of the bitmap
+	 *  @param nHeight The height of the bitmap
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL clear_compress_to_stream(CLEAR_CONTEXT* WINPR_RESTRICT clear,
+	                                          wStream* WINPR_RESTRICT s,
+	                                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+	                                          UINT32 nSrcStep, UINT32 nWidth, UINT32 nHeight);
+
 	FREERDP_API INT32 clear_decompress(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 	                                   const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
 	                                   UINT32 nWidth, UINT32 nHeight, BYTE* WINPR_RESTRICT pDstData,
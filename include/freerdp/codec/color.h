@@ -407,6 +407,9 @@ typedef struct gdi_palette gdiPalette;
 	    UINT32 flags);
 
 	/*** Scale an image to destination
+	 *
+	 * Creates a temporary scaler for every call, use \b freerdp_image_scaler_scale to scale
+	 * repeatedly.
 	 *
 	 * @param pDstData   destination buffer
 	 * @param DstFormat  destination buffer format
@@ -432,6 +435,61 @@ typedef struct gdi_palette gdiPalette;
 	                                     UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
 	                                     UINT32 nSrcWidth, UINT32 nSrcHeight);
 
+	/** @brief A reusable image scaler
+	 *
+	 * Keeps the scaling coefficients of the last source and destination size and its
+	 * intermediate buffers between calls. A scaler must not be used by multiple threads at the
+	 * same time.
+	 *
+	 * @since version 3.17.0
+	 */
+	typedef struct S_FREERDP_IMAGE_SCALER FREERDP_IMAGE_SCALER;
+
+	/** @brief free a scaler created by \b freerdp_image_scaler_new
+	 *
+	 * @param scaler the scaler to free, may be \b NULL
+	 * @since version 3.17.0
+	 */
+	FREERDP_API void freerdp_image_scaler_free(FREERDP_IMAGE_SCALER* scaler);
+
+	/** @brief create a new image scaler
+	 *
+	 * @return a new scaler or \b NULL in case of failure
+	 * @since version 3.17.0
+	 */
+	WINPR_ATTR_MALLOC(freerdp_image_scaler_free, 1)
+	FREERDP_API FREERDP_IMAGE_SCALER* freerdp_image_scaler_new(void);
+
+	/** @brief Scale an image to destination, see \b freerdp_image_scale
+	 *
+	 * Enlarging interpolates bilinear, shrinking averages the covered source pixels. 32bpp
+	 * formats with 8 bit channels are scaled directly, other source formats are converted first.
+	 *
+	 * @param scaler     the scaler to use
+	 * @param pDstData   destination buffer
+	 * @param DstFormat  destination buffer format
+	 * @param nDstStep   destination buffer stride (line in bytes) 0 for default
+	 * @param nXDst      destination buffer offset x
+	 * @param nYDst      destination buffer offset y
+	 * @param nDstWidth  width of destination in pixels
+	 * @param nDstHeight height of destination in pixels
+	 * @param pSrcData   source buffer
+	 * @param SrcFormat  source buffer format
+	 * @param nSrcStep   source buffer stride (line in bytes) 0 for default
+	 * @param nXSrc      source buffer x offset in pixels
+	 * @param nYSrc      source buffer y offset in pixels
+	 * @param nSrcWidth  width of source in pixels
+	 * @param nSrcHeight height of source in pixels
+	 *
+	 * @return          TRUE if success, FALSE otherwise
+	 * @since version 3.17.0
+	 */
+	FREERDP_API BOOL freerdp_image_scaler_scale(
+	    FREERDP_IMAGE_SCALER* WINPR_RESTRICT scaler, BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+	    UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+	    const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat, UINT32 nSrcStep, UINT32 nXSrc,
+	    UINT32 nYSrc, UINT32 nSrcWidth, UINT32 nSrcHeight);
+
 	/** @brief fill an area with the color provided.
 	 *
 	 * @param pDstData  destination buffer
@@ -0,0 +1,83 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Shared Codec Executor
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CODEC_EXECUTOR_H
+#define FREERDP_CODEC_EXECUTOR_H
+
+#include <freerdp/api.h>
+#include <freerdp/types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief Statistics of the process wide codec executor
+	 *
+	 *  All threaded codecs (RemoteFX, progressive, YUV) share a single set of worker threads.
+	 *  Each codec context submits its tile and slice work to its own queue, the queues are
+	 *  served round robin so a busy session can not starve the others.
+	 *
+	 *  @since version 3.17.0
+	 */
+	typedef struct
+	{
+		UINT32 MaxThreads;     /**< Upper limit of worker threads */
+		UINT32 Threads;        /**< Worker threads currently running */
+		UINT32 BusyThreads;    /**< Worker threads currently executing work */
+		UINT32 Queues;         /**< Codec contexts attached to the executor */
+		UINT64 PendingItems;   /**< Work items queued but not yet started */
+		UINT64 SubmittedItems; /**< Work items submitted since startup */
+		UINT64 CompletedItems; /**< Work items completed since startup */
+		UINT64 CallerItems;    /**< Completed work items run by a waiting codec thread */
+	} FREERDP_CODEC_EXECUTOR_STATS;
+
+	/** @brief Limit the number of worker threads of the codec executor
+	 *
+	 *  The limit applies to all codec contexts of the process. Raising it takes effect with the
+	 *  next submitted work item, lowering it limits the number of concurrently executing worker
+	 *  threads.
+	 *
+	 *  @param count The maximum number of worker threads, 0 restores the default (the number of
+	 *  processors)
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL freerdp_codec_executor_set_max_threads(UINT32 count);
+
+	/** @brief Query the worker thread limit of the codec executor
+	 *
+	 *  @return The maximum number of worker threads
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API UINT32 freerdp_codec_executor_get_max_threads(void);
+
+	/** @brief Query the statistics of the codec executor
+	 *
+	 *  @param stats A pointer to the structure to fill
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL freerdp_codec_executor_get_stats(FREERDP_CODEC_EXECUTOR_STATS* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_CODEC_EXECUTOR_H */
@@ -83,6 +83,43 @@ extern "C"
 	    PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, wStream* WINPR_RESTRICT s,
 	    const RFX_MESSAGE* WINPR_RESTRICT msg);
 
+	/** Configure the quantProgVal schedule used by \link progressive_compress
+	 *  Tiles are first sent with the progressive quantization of the first entry and
+	 *  refined with TILE_UPGRADE blocks for every following entry while they are not modified.
+	 *  @param progressive The progressive codec context, must be a compressor
+	 *  @param schedule Strictly decreasing list of bit planes to drop (0 is lossless
+	 * quantization), maximum value is 8
+	 *  @param count The number of entries in \b schedule, at most 8. 0 disables multi pass
+	 * encoding
+	 *
+	 *  @since version 3.17.0
+	 *  @return \b TRUE in case of success, \b FALSE for any error
+	 */
+	FREERDP_API BOOL progressive_context_set_quant_schedule(
+	    PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, const BYTE* WINPR_RESTRICT schedule,
+	    size_t count);
+
+	/** Limit the amount of TILE_UPGRADE data added to a single message.
+	 *  @param progressive The progressive codec context, must be a compressor
+	 *  @param budget The number of bytes, 0 for unlimited. At least one upgrade is sent per
+	 * message
+	 *
+	 *  @since version 3.17.0
+	 *  @return \b TRUE in case of success, \b FALSE for any error
+	 */
+	FREERDP_API BOOL progressive_context_set_upgrade_budget(
+	    PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, UINT32 budget);
+
+	/** Check if tiles sent by \link progressive_compress can still be refined.
+	 *  Call \link progressive_compress with an empty invalid region to send the upgrades.
+	 *  @param progressive The progressive codec context
+	 *
+	 *  @since version 3.17.0
+	 *  @return \b TRUE if there are pending TILE_UPGRADE passes, \b FALSE otherwise
+	 */
+	FREERDP_API BOOL progressive_compress_has_pending_upgrades(
+	    const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive);
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,6 +39,17 @@ extern "C"
 
 	typedef struct S_ZGFX_CONTEXT ZGFX_CONTEXT;
 
+	/** @brief effort levels of the ZGFX compressor
+	 *  @since version 3.17.0
+	 */
+	typedef enum
+	{
+		ZGFX_COMPRESSION_LEVEL_NONE = 0, /** segments are sent uncompressed */
+		ZGFX_COMPRESSION_LEVEL_FAST,     /** short hash chains, greedy matching */
+		ZGFX_COMPRESSION_LEVEL_DEFAULT,  /** moderate hash chains, lazy matching */
+		ZGFX_COMPRESSION_LEVEL_MAX       /** long hash chains, lazy matching */
+	} ZGFX_COMPRESSION_LEVEL;
+
 	FREERDP_API int zgfx_decompress(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 	                                const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
 	                                BYTE** WINPR_RESTRICT ppDstData,
@@ -54,11 +65,50 @@ extern "C"
 
 	FREERDP_API void zgfx_context_reset(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, BOOL flush);
 
+	/** @brief Select the effort used by the compressor.
+	 *
+	 *  Only meaningful for contexts created with \b Compressor set to \b TRUE
+	 *
+	 *  @param zgfx The context to modify
+	 *  @param level The compression level to use
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL zgfx_context_set_compression_level(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+	                                                    ZGFX_COMPRESSION_LEVEL level);
+
+	/** @brief Limit how far back the compressor references its history.
+	 *
+	 *  Required when the peer decompresses with a history buffer smaller than the RDP 8.0
+	 *  bulk compression default, e.g. the RDP 8.0 Lite compression of dynamic channel data.
+	 *  Only meaningful for contexts created with \b Compressor set to \b TRUE
+	 *
+	 *  @param zgfx The context to modify
+	 *  @param limit The history size of the peer in bytes
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL zgfx_context_set_history_limit(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+	                                                UINT32 limit);
+
 	FREERDP_API void zgfx_context_free(ZGFX_CONTEXT* zgfx);
 
 	WINPR_ATTR_MALLOC(zgfx_context_free, 1)
 	FREERDP_API ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor);
 
+	/** @brief Create a context with a history smaller than the RDP 8.0 default
+	 *
+	 *  The history buffer and the compressor tables are sized to the history, e.g. the 8 KiB of
+	 *  the RDP 8.0 Lite compression of dynamic channel data.
+	 *
+	 *  @param Compressor \b TRUE for a compressor, \b FALSE for a decompressor
+	 *  @param HistorySize The history size in bytes, at most 2500000
+	 *  @return A new context or \b NULL
+	 *  @since version 3.17.0
+	 */
+	WINPR_ATTR_MALLOC(zgfx_context_free, 1)
+	FREERDP_API ZGFX_CONTEXT* zgfx_context_new_ex(BOOL Compressor, UINT32 HistorySize);
+
 #ifdef __cplusplus
 }
 #endif
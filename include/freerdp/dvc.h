@@ -90,7 +90,9 @@ extern "C"
 	struct s_IWTSVirtualChannelManager
 	{
 		/* Returns an instance of a listener object that listens on a specific
-		   endpoint, or creates a static channel. */
+		   endpoint, or creates a static channel.
+		   Since version 3.17.0 ulFlags may contain WTS_CHANNEL_OPTION_DYNAMIC_NO_COMPRESS to
+		   send the data of channels created by the listener uncompressed. */
 		UINT(*CreateListener)
 		(IWTSVirtualChannelManager* pChannelMgr, const char* pszChannelName, ULONG ulFlags,
 		 IWTSListenerCallback* pListenerCallback, IWTSListener** ppListener);
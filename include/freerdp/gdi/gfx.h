@@ -49,6 +49,7 @@ extern "C"
 		UINT32 outputTargetHeight;
 		BOOL windowMapped;
 		BOOL handleInUpdateSurfaceArea;
+		FREERDP_IMAGE_SCALER* scaler; /** @since version 3.17.0 */
 	};
 	typedef struct gdi_gfx_surface gdiGfxSurface;
 
@@ -79,6 +79,100 @@ extern "C"
 	WINPR_ATTR_MALLOC(freerdp_listener_free, 1)
 	FREERDP_API freerdp_listener* freerdp_listener_new(void);
 
+	/** @brief A small set of worker threads serving many listeners and peers
+	 *
+	 *  Instead of one thread per peer waiting for its event handles, every worker waits for the
+	 *  handles of all its peers at once (with epoll where available) and only calls
+	 *  \b CheckFileDescriptor of the peers that are ready.
+	 *
+	 *  @since version 3.17.0
+	 */
+	typedef struct rdp_freerdp_reactor freerdp_reactor;
+
+	/** @since version 3.17.0 */
+	typedef enum
+	{
+		FREERDP_REACTOR_PEER_TIMER,  /**< The timer interval of the peer elapsed */
+		FREERDP_REACTOR_PEER_CLOSED, /**< The peer or its worker failed, no longer served */
+	} FREERDP_REACTOR_PEER_EVENT;
+
+	/** @brief Callback for events of a peer served by a reactor, called from a worker thread
+	 *
+	 *  After \b FREERDP_REACTOR_PEER_CLOSED the reactor does no longer use the peer, the
+	 *  callback is expected to disconnect and free it.
+	 *
+	 *  @param peer The peer the event is for
+	 *  @param event The event that occurred
+	 *  @param arg The argument supplied to \b freerdp_reactor_add_peer
+	 *
+	 *  @return \b FALSE to disconnect the peer, ignored for \b FREERDP_REACTOR_PEER_CLOSED
+	 *  @since version 3.17.0
+	 */
+	typedef BOOL (*psReactorPeerEvent)(freerdp_peer* peer, FREERDP_REACTOR_PEER_EVENT event,
+	                                   void* arg);
+
+	/** @brief Stop all workers and free the reactor
+	 *
+	 *  Peers still served are reported as \b FREERDP_REACTOR_PEER_CLOSED before this returns.
+	 *
+	 *  @param reactor The reactor to free, may be \b NULL
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API void freerdp_reactor_free(freerdp_reactor* reactor);
+
+	/** @brief Create a reactor and start its worker threads
+	 *
+	 *  @param workers The number of worker threads, 0 for one per processor
+	 *
+	 *  @return A new reactor or \b NULL on failure
+	 *  @since version 3.17.0
+	 */
+	WINPR_ATTR_MALLOC(freerdp_reactor_free, 1)
+	FREERDP_API freerdp_reactor* freerdp_reactor_new(size_t workers);
+
+	/** @brief Accept connections of an open listener on a reactor worker
+	 *
+	 *  \b PeerAccepted is called from the worker thread and typically hands the new peer to
+	 *  \b freerdp_reactor_add_peer. The listener must outlive the reactor.
+	 *
+	 *  @param reactor The reactor to use
+	 *  @param listener The listener to serve
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL freerdp_reactor_add_listener(freerdp_reactor* reactor,
+	                                              freerdp_listener* listener);
+
+	/** @brief Serve an initialized peer on the least busy reactor worker
+	 *
+	 *  The worker calls \b CheckFileDescriptor of the peer and of the virtual channel manager
+	 *  whenever one of their event handles is signaled, until one of them fails.
+	 *
+	 *  @param reactor The reactor to use
+	 *  @param peer The peer to serve
+	 *  @param vcm An optional virtual channel manager of the peer, \b NULL if unused
+	 *  @param timerInterval An optional interval in milliseconds for
+	 *  \b FREERDP_REACTOR_PEER_TIMER events, 0 to disable
+	 *  @param callback The callback for events of the peer
+	 *  @param arg An argument passed to the callback
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise (the peer is not served then)
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL freerdp_reactor_add_peer(freerdp_reactor* reactor, freerdp_peer* peer,
+	                                          HANDLE vcm, UINT32 timerInterval,
+	                                          psReactorPeerEvent callback, void* arg);
+
+	/** @brief Get the number of peers currently served by a reactor
+	 *
+	 *  @param reactor The reactor to query
+	 *
+	 *  @return The number of peers
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API size_t freerdp_reactor_get_peer_count(freerdp_reactor* reactor);
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,6 +34,7 @@ extern "C"
 		UINT64 TotalCompressedBytes;
 		UINT64 TotalUncompressedBytes;
 		double TotalCompressionRatio;
+		UINT64 BulkMemoryUsage; /** @since version 3.17.0 */
 	};
 	typedef struct rdp_metrics rdpMetrics;
 
@@ -203,6 +203,31 @@ extern "C"
 	FREERDP_API const char* freerdp_peer_os_major_type_string(freerdp_peer* client);
 	FREERDP_API const char* freerdp_peer_os_minor_type_string(freerdp_peer* client);
 
+	/** @brief Get the number of bytes written to the peer that did not reach the network yet
+	 *
+	 *  Output only queues up with FreeRDP_WaitForOutputBufferFlush disabled, otherwise every
+	 *  write waits until the socket took it.
+	 *
+	 *  @param client The peer to query
+	 *
+	 *  @return The number of queued bytes
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API size_t freerdp_peer_get_output_queue_depth(freerdp_peer* client);
+
+	/** @brief Check if the peer does not keep up with the data sent to it
+	 *
+	 *  Encoders should skip or merge frames while this is the case. Writes block once the
+	 *  output queue reaches its limit, and fail if the peer does not drain it within
+	 *  FreeRDP_TcpAckTimeout.
+	 *
+	 *  @param client The peer to query
+	 *
+	 *  @return \b TRUE if the output is congested, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL freerdp_peer_is_output_congested(freerdp_peer* client);
+
 	FREERDP_API void freerdp_peer_free(freerdp_peer* client);
 
 	WINPR_ATTR_MALLOC(freerdp_peer_free, 1)
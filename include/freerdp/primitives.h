@@ -212,6 +212,164 @@ typedef pstatus_t (*fn_andC_32u_t)(const UINT32* WINPR_RESTRICT pSrc, UINT32 val
 	                               UINT32* WINPR_RESTRICT pDst, INT32 len);
 typedef pstatus_t (*fn_orC_32u_t)(const UINT32* WINPR_RESTRICT pSrc, UINT32 val,
 	                              UINT32* WINPR_RESTRICT pDst, INT32 len);
+
+/** @brief Compare two 32bpp images in tiles of 16x16 pixels
+ *
+ * @param pSrc1 The first image buffer
+ * @param src1Step The first image line width in bytes (including padding)
+ * @param pSrc2 The second image buffer
+ * @param src2Step The second image line width in bytes (including padding)
+ * @param width The width in pixels to compare
+ * @param height The height in pixels to compare
+ * @param mask The bits of a pixel (read as native endian UINT32) to compare, e.g. all but the
+ * alpha bits to ignore differences in a padding byte
+ * @param pDirty A buffer of at least ((height + 15) / 16) lines with ((width + 15) / 16) bytes
+ * each, receives \b 1 for every tile that differs and \b 0 for every equal tile
+ * @param dirtyStep The line width of \b pDirty in bytes
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_compare_tiles_32u_t)(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+	                                        const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+	                                        UINT32 width, UINT32 height, UINT32 mask,
+	                                        BYTE* WINPR_RESTRICT pDirty, UINT32 dirtyStep);
+
+/** @brief Apply a ternary raster operation (ROP3) to byte buffers
+ *
+ * Every bit of \b pDst is replaced by the ROP3 result of the bits of destination, source and
+ * pattern at the same position. Works for any pixel format as long as all buffers use the same.
+ *
+ * @param pSrc The source buffer, may be \b NULL if the operation does not use the source
+ * @param pPat The pattern buffer, may be \b NULL if the operation does not use the pattern
+ * @param pDst The destination buffer, must not overlap with \b pSrc or \b pPat
+ * @param len The number of bytes to process
+ * @param rop3 The ROP3 index (bits 16 to 23 of the raster operation code)
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_rop3_8u_t)(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat,
+	                              BYTE* WINPR_RESTRICT pDst, UINT32 len, BYTE rop3);
+
+/** @brief Split an image into separate 8 bit color planes
+ *
+ * @param pSrc The first line of the source image
+ * @param srcStep The source line width in bytes (including padding), negative to read the image
+ * bottom up
+ * @param srcFormat The source pixel format
+ * @param pDst The red, green, blue and alpha planes, \b width * \b height bytes each. Formats
+ * without alpha fill the alpha plane with \b 0xFF
+ * @param width The width of the image in pixels
+ * @param height The height of the image in pixels
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_planarSplit_8u_AC4P4_t)(const BYTE* WINPR_RESTRICT pSrc, INT32 srcStep,
+	                                           UINT32 srcFormat, BYTE* WINPR_RESTRICT pDst[4],
+	                                           UINT32 width, UINT32 height);
+
+/** @brief Merge separate 8 bit color planes into an image
+ *
+ * @param pSrc The red, green, blue and alpha planes, \b width * \b height bytes each. The alpha
+ * plane may be \b NULL, \b 0xFF is used then. The padding byte of 32bpp formats without alpha is
+ * always \b 0xFF
+ * @param pDst The first line of the destination image
+ * @param dstStep The destination line width in bytes (including padding), negative to write the
+ * image bottom up
+ * @param dstFormat The destination pixel format
+ * @param width The width of the image in pixels
+ * @param height The height of the image in pixels
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_planarMerge_8u_P4AC4_t)(const BYTE* WINPR_RESTRICT pSrc[4],
+	                                           BYTE* WINPR_RESTRICT pDst, INT32 dstStep,
+	                                           UINT32 dstFormat, UINT32 width, UINT32 height);
+
+/** @brief Delta encode an 8 bit plane as described in [MS-RDPEGDI] 3.1.9.2.3
+ *
+ * The first line is copied, every other byte is replaced by the difference \b d to the byte above
+ * it, stored as \b 2d for positive and as \b -2d-1 for negative differences.
+ *
+ * @param pSrc The source plane
+ * @param pDst The destination plane, must not overlap with \b pSrc
+ * @param width The width of the plane in bytes
+ * @param height The height of the plane in lines
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_planarDeltaEncode_8u_t)(const BYTE* WINPR_RESTRICT pSrc,
+	                                           BYTE* WINPR_RESTRICT pDst, UINT32 width,
+	                                           UINT32 height);
+
+/** @brief Reverse \b planarDeltaEncode_8u in place
+ *
+ * @param pSrcDst The delta encoded plane, receives the decoded plane
+ * @param width The width of the plane in bytes
+ * @param height The height of the plane in lines
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_planarDeltaDecode_8u_t)(BYTE* WINPR_RESTRICT pSrcDst, UINT32 width,
+	                                           UINT32 height);
+
+/** @brief Find the next run of repeated bytes
+ *
+ * Searches for the first position where at least \b minRun bytes repeat the byte preceding them.
+ *
+ * @param pSrc The buffer to search
+ * @param len The length of \b pSrc in bytes
+ * @param prev The value of the byte preceding \b pSrc
+ * @param minRun The minimum number of repetitions, must be at least 1
+ * @param pStart Receives the offset of the first repetition, \b len if there is no run
+ * @param pLength Receives the number of repetitions, \b 0 if there is no run
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_planarFindRun_8u_t)(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE prev,
+	                                       UINT32 minRun, UINT32* WINPR_RESTRICT pStart,
+	                                       UINT32* WINPR_RESTRICT pLength);
+
+/** @brief Horizontal pass of a separable image scaler for 32bpp pixels
+ *
+ * Every destination pixel \b x is the weighted sum of the \b taps source pixels starting at
+ * \b offsets[x], computed per channel. The weights are 14 bit fixed point and should add up to
+ * \b 16384 for each destination pixel.
+ *
+ * @param pSrc The first source line
+ * @param srcStep The source line width in bytes (including padding)
+ * @param pDst The first destination line
+ * @param dstStep The destination line width in bytes (including padding)
+ * @param dstWidth The width of the destination in pixels
+ * @param height The number of lines to scale
+ * @param offsets The index of the first source pixel for each destination pixel, \b dstWidth
+ * entries. \b offsets[x] + \b taps must not exceed the source width
+ * @param weights \b taps weights for each destination pixel, \b dstWidth * \b taps entries
+ * @param taps The number of source pixels contributing to a destination pixel, at least 1
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_scaleHorizontal_8u_C4_t)(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+	                                            BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+	                                            UINT32 dstWidth, UINT32 height,
+	                                            const UINT32* WINPR_RESTRICT offsets,
+	                                            const INT16* WINPR_RESTRICT weights, UINT32 taps);
+
+/** @brief Vertical pass of a separable image scaler for 32bpp pixels
+ *
+ * Computes one destination line as the weighted sum of \b taps source lines. The weights are 14
+ * bit fixed point and should add up to \b 16384.
+ *
+ * @param pSrc \b taps pointers to the source lines
+ * @param weights \b taps weights, one per source line
+ * @param taps The number of source lines, at least 1
+ * @param pDst The destination line
+ * @param width The width of the lines in pixels
+ * @return \b PRIMITIVES_SUCCESS for success, an error code otherwise
+ *  @since version 3.17.0
+ */
+typedef pstatus_t (*fn_scaleVertical_8u_C4_t)(const BYTE* const* WINPR_RESTRICT pSrc,
+	                                          const INT16* WINPR_RESTRICT weights, UINT32 taps,
+	                                          BYTE* WINPR_RESTRICT pDst, UINT32 width);
 typedef pstatus_t (*primitives_uninit_t)(void);
 
 #if defined(WITH_FREERDP_3x_DEPRECATED)
@@ -302,6 +460,15 @@ typedef struct
 	fn_add_16s_inplace_t add_16s_inplace;         /** @since version 3.6.0 */
 	fn_lShiftC_16s_inplace_t lShiftC_16s_inplace; /** @since version 3.6.0 */
 	fn_copy_no_overlap_t copy_no_overlap;         /** @since version 3.6.0 */
+	fn_compare_tiles_32u_t compare_tiles_32u;     /** @since version 3.17.0 */
+	fn_rop3_8u_t rop3_8u;                         /** @since version 3.17.0 */
+	fn_planarSplit_8u_AC4P4_t planarSplit_8u_AC4P4; /** @since version 3.17.0 */
+	fn_planarMerge_8u_P4AC4_t planarMerge_8u_P4AC4; /** @since version 3.17.0 */
+	fn_planarDeltaEncode_8u_t planarDeltaEncode_8u; /** @since version 3.17.0 */
+	fn_planarDeltaDecode_8u_t planarDeltaDecode_8u; /** @since version 3.17.0 */
+	fn_planarFindRun_8u_t planarFindRun_8u;         /** @since version 3.17.0 */
+	fn_scaleHorizontal_8u_C4_t scaleHorizontal_8u_C4; /** @since version 3.17.0 */
+	fn_scaleVertical_8u_C4_t scaleVertical_8u_C4;     /** @since version 3.17.0 */
 } primitives_t;
 
 typedef enum
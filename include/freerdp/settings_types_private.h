@@ -207,7 +207,11 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 BOOL ForceEncryptedCsPdu);    /* 719 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL HiDefRemoteApp);         /* 720 */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionLevel);     /* 721 */
-	UINT64 padding0768[768 - 722];                            /* 722 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionEffort);    /** 722
+		                                                       * @since version 3.17.0 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL DynamicChannelCompression); /** 723
+		                                                          * @since version 3.17.0 */
+	UINT64 padding0768[768 - 724];                               /* 724 */
 
 	/* Client Info (Extra) */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL IPv6Enabled);       /* 768 */
@@ -197,6 +197,17 @@ extern "C"
 	                                      UINT32 imeConvMode);
 	typedef BOOL (*pServerStatusInfo)(rdpContext* context, UINT32 status);
 
+	/** @brief A graphics update in fast-path framing
+	 *
+	 *  \param context The rdpContext of the connection
+	 *  \param updateCode The fast-path update code of the update
+	 *  \param s The reassembled and decompressed update data, starting at the current position
+	 *
+	 *  \return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	typedef BOOL (*pRawUpdate)(rdpContext* context, BYTE updateCode, wStream* s);
+
 	struct rdp_update
 	{
 		rdpContext* context;     /* 0 */
@@ -237,7 +248,13 @@ extern "C"
 		 * fills BITMAP_DATA struct members: flags, cbCompMainBodySize and cbCompFirstRowSize.
 		 */
 		BOOL autoCalculateBitmapData; /* 71 */
-		UINT32 paddingE[80 - 72];     /* 72 */
+		/* if RawUpdate is set on the client side it receives the graphics updates (bitmap,
+		 * palette, orders, surface commands and pointers) undecoded instead of the callbacks
+		 * above. Slow-path updates are passed in their fast-path form, updateCode is always a
+		 * FASTPATH_UPDATETYPE_* value. On the server side it sends such an update as is.
+		 */
+		pRawUpdate RawUpdate;     /* 72 @since version 3.17.0 */
+		UINT32 paddingE[80 - 73]; /* 73 */
 	};
 
 	FREERDP_API void rdp_update_lock(rdpUpdate* update);
@@ -23,7 +23,10 @@
 #define FREERDP_UTILS_DRDYNVC_H
 
 #include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
 #include <freerdp/api.h>
+#include <freerdp/codec/zgfx.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -32,6 +35,35 @@ extern "C"
 
 	FREERDP_API const char* drdynvc_get_packet_type(BYTE cmd);
 
+	/** @brief Compress a chunk of dynamic channel data
+	 *
+	 *  Appends the chunk as RDP8_BULK_ENCODED_DATA, the payload of the DATA_FIRST_COMPRESSED
+	 *  and DATA_COMPRESSED PDUs. The compressor history must be limited to
+	 *  \b DRDYNVC_RDP8_LITE_HISTORY_SIZE.
+	 *
+	 *  @param zgfx The compressor context of the channel
+	 *  @param s The stream to append the compressed chunk to
+	 *  @param data The uncompressed chunk
+	 *  @param length The length of the chunk, at most \b DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL drdynvc_compress_data(ZGFX_CONTEXT* zgfx, wStream* s, const BYTE* data,
+	                                       size_t length);
+
+	/** @brief Decompress the payload of a DATA_FIRST_COMPRESSED or DATA_COMPRESSED PDU
+	 *
+	 *  @param zgfx The decompressor context of the channel
+	 *  @param data The RDP8_BULK_ENCODED_DATA of the PDU
+	 *  @param length The length of \b data
+	 *  @param ppDstData Receives the decompressed chunk, to be freed with free()
+	 *  @param pDstSize Receives the length of the decompressed chunk
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	FREERDP_API BOOL drdynvc_decompress_data(ZGFX_CONTEXT* zgfx, const BYTE* data, size_t length,
+	                                         BYTE** ppDstData, UINT32* pDstSize);
+
 #ifdef __cplusplus
 }
 #endif
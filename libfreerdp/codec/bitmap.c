@@ -634,10 +634,9 @@ static INLINE SSIZE_T freerdp_bitmap_compress_24(const void* WINPR_RESTRICT srcD
 
 				if (pixel == (ypixel ^ mix))
 				{
-					const int tmp = (1 << (fom_count % 8));
-					const int val = fom_mask[fom_mask_len - 1] | tmp;
-					const int8_t ival = WINPR_ASSERTING_INT_CAST(int8_t, val);
-					fom_mask[fom_mask_len - 1] = ival;
+					const BYTE tmp = (BYTE)(1 << (fom_count % 8));
+					const BYTE val = (BYTE)fom_mask[fom_mask_len - 1] | tmp;
+					fom_mask[fom_mask_len - 1] = (int8_t)val;
 				}
 
 				fom_count++;
@@ -944,10 +943,9 @@ static INLINE SSIZE_T freerdp_bitmap_compress_16(const void* WINPR_RESTRICT srcD
 
 				if (pixel == (ypixel ^ mix))
 				{
-					const int tmp = (1 << (fom_count % 8));
-					const int val = fom_mask[fom_mask_len - 1] | tmp;
-					const int8_t ival = WINPR_ASSERTING_INT_CAST(int8_t, val);
-					fom_mask[fom_mask_len - 1] = ival;
+					const BYTE tmp = (BYTE)(1 << (fom_count % 8));
+					const BYTE val = (BYTE)fom_mask[fom_mask_len - 1] | tmp;
+					fom_mask[fom_mask_len - 1] = (int8_t)val;
 				}
 
 				fom_count++;
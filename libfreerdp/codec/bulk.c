@@ -19,6 +19,9 @@
 
 #include <math.h>
 #include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/collections.h>
+#include <winpr/stream.h>
 
 #include <freerdp/config.h>
 
@@ -27,26 +30,311 @@
 #include "../codec/mppc.h"
 #include "../codec/ncrush.h"
 #include "../codec/xcrush.h"
+#include "../codec/zgfx.h"
 
 #include <freerdp/log.h>
 #define TAG FREERDP_TAG("core")
 
 //#define WITH_BULK_DEBUG 1
 
+#define BULK_OUTPUT_BUFFER_SIZE 65536
+
+/* Number of idle contexts of each kind kept for later sessions */
+#define BULK_POOL_MAX_IDLE 8
+
+typedef enum
+{
+	BULK_CONTEXT_MPPC,
+	BULK_CONTEXT_NCRUSH,
+	BULK_CONTEXT_XCRUSH,
+	BULK_CONTEXT_ZGFX,
+	BULK_CONTEXT_COUNT
+} BULK_CONTEXT_TYPE;
+
+typedef struct
+{
+	void* (*fnNew)(BOOL Compressor);
+	void (*fnReset)(void* ctx);
+	void (*fnFree)(void* ctx);
+	size_t (*fnMemorySize)(BOOL Compressor);
+} BULK_CONTEXT_OPS;
+
+typedef struct
+{
+	wObjectPool* pool;
+	size_t idle;
+} BULK_POOL;
+
 struct rdp_bulk
 {
 	ALIGN64 rdpContext* context;
 	ALIGN64 UINT32 CompressionLevel;
 	ALIGN64 UINT16 CompressionMaxSize;
-	ALIGN64 MPPC_CONTEXT* mppcSend;
-	ALIGN64 MPPC_CONTEXT* mppcRecv;
-	ALIGN64 NCRUSH_CONTEXT* ncrushRecv;
-	ALIGN64 NCRUSH_CONTEXT* ncrushSend;
-	ALIGN64 XCRUSH_CONTEXT* xcrushRecv;
-	ALIGN64 XCRUSH_CONTEXT* xcrushSend;
-	ALIGN64 BYTE OutputBuffer[65536];
+	ALIGN64 void* Send[BULK_CONTEXT_COUNT];
+	ALIGN64 void* Recv[BULK_CONTEXT_COUNT];
+	ALIGN64 BYTE* OutputBuffer;
+	ALIGN64 BYTE* DecompressBuffer; /* ZGFX allocates its output, kept until the next packet */
+};
+
+static void* bulk_mppc_new(BOOL Compressor)
+{
+	return mppc_context_new(1, Compressor);
+}
+
+static void bulk_mppc_reset(void* ctx)
+{
+	mppc_context_reset(ctx, FALSE);
+}
+
+static void bulk_mppc_free(void* ctx)
+{
+	mppc_context_free(ctx);
+}
+
+static void* bulk_ncrush_new(BOOL Compressor)
+{
+	return ncrush_context_new(Compressor);
+}
+
+static void bulk_ncrush_reset(void* ctx)
+{
+	ncrush_context_reset(ctx, FALSE);
+}
+
+static void bulk_ncrush_free(void* ctx)
+{
+	ncrush_context_free(ctx);
+}
+
+static void* bulk_xcrush_new(BOOL Compressor)
+{
+	return xcrush_context_new(Compressor);
+}
+
+static void bulk_xcrush_reset(void* ctx)
+{
+	xcrush_context_reset(ctx, FALSE);
+}
+
+static void bulk_xcrush_free(void* ctx)
+{
+	xcrush_context_free(ctx);
+}
+
+static void* bulk_zgfx_new(BOOL Compressor)
+{
+	return zgfx_context_new(Compressor);
+}
+
+static void bulk_zgfx_reset(void* ctx)
+{
+	zgfx_context_reset(ctx, FALSE);
+}
+
+static void bulk_zgfx_free(void* ctx)
+{
+	zgfx_context_free(ctx);
+}
+
+static const BULK_CONTEXT_OPS bulk_context_ops[BULK_CONTEXT_COUNT] = {
+	{ bulk_mppc_new, bulk_mppc_reset, bulk_mppc_free, mppc_context_memory_size },
+	{ bulk_ncrush_new, bulk_ncrush_reset, bulk_ncrush_free, ncrush_context_memory_size },
+	{ bulk_xcrush_new, bulk_xcrush_reset, bulk_xcrush_free, xcrush_context_memory_size },
+	{ bulk_zgfx_new, bulk_zgfx_reset, bulk_zgfx_free, zgfx_context_memory_size }
 };
 
+/**
+ * The compressor contexts are large (XCRUSH alone is more than 3 MB) and a session only ever
+ * uses one type, so they are created on first use and shared between sessions through a
+ * process wide pool. The pools are emptied when the last rdpBulk is freed.
+ */
+static INIT_ONCE bulk_pool_once = INIT_ONCE_STATIC_INIT;
+static BOOL bulk_pool_initialized = FALSE;
+static CRITICAL_SECTION bulk_pool_lock;
+static size_t bulk_pool_users = 0;
+static BULK_POOL bulk_pools[BULK_CONTEXT_COUNT][2] = { 0 };
+
+static BOOL CALLBACK bulk_pool_init(WINPR_ATTR_UNUSED PINIT_ONCE once,
+                                    WINPR_ATTR_UNUSED PVOID param,
+                                    WINPR_ATTR_UNUSED PVOID* context)
+{
+	if (!InitializeCriticalSectionAndSpinCount(&bulk_pool_lock, 4000))
+		return TRUE;
+
+	for (size_t type = 0; type < BULK_CONTEXT_COUNT; type++)
+	{
+		for (size_t dir = 0; dir < 2; dir++)
+		{
+			BULK_POOL* pool = &bulk_pools[type][dir];
+			pool->pool = ObjectPool_New(FALSE);
+			if (!pool->pool)
+				return TRUE;
+
+			wObject* obj = ObjectPool_Object(pool->pool);
+			obj->fnObjectFree = bulk_context_ops[type].fnFree;
+		}
+	}
+
+	bulk_pool_initialized = TRUE;
+	return TRUE;
+}
+
+static BOOL bulk_pool_acquire(void)
+{
+	if (!InitOnceExecuteOnce(&bulk_pool_once, bulk_pool_init, NULL, NULL))
+		return FALSE;
+	if (!bulk_pool_initialized)
+	{
+		WLog_ERR(TAG, "failed to initialize the bulk compression pool");
+		return FALSE;
+	}
+
+	EnterCriticalSection(&bulk_pool_lock);
+	bulk_pool_users++;
+	LeaveCriticalSection(&bulk_pool_lock);
+	return TRUE;
+}
+
+static void bulk_pool_release(void)
+{
+	EnterCriticalSection(&bulk_pool_lock);
+	WINPR_ASSERT(bulk_pool_users > 0);
+	if (--bulk_pool_users == 0)
+	{
+		for (size_t type = 0; type < BULK_CONTEXT_COUNT; type++)
+		{
+			for (size_t dir = 0; dir < 2; dir++)
+			{
+				BULK_POOL* pool = &bulk_pools[type][dir];
+				ObjectPool_Clear(pool->pool);
+				pool->idle = 0;
+			}
+		}
+	}
+	LeaveCriticalSection(&bulk_pool_lock);
+}
+
+static void* bulk_pool_take(BULK_CONTEXT_TYPE type, BOOL Compressor)
+{
+	void* ctx = NULL;
+	BULK_POOL* pool = &bulk_pools[type][Compressor ? 1 : 0];
+
+	EnterCriticalSection(&bulk_pool_lock);
+	if (pool->idle > 0)
+	{
+		ctx = ObjectPool_Take(pool->pool);
+		pool->idle--;
+	}
+	LeaveCriticalSection(&bulk_pool_lock);
+
+	/* pooled contexts were reset when returned, new ones are created outside of the lock */
+	if (!ctx)
+		ctx = bulk_context_ops[type].fnNew(Compressor);
+	return ctx;
+}
+
+static void bulk_pool_return(BULK_CONTEXT_TYPE type, BOOL Compressor, void* ctx)
+{
+	BULK_POOL* pool = &bulk_pools[type][Compressor ? 1 : 0];
+
+	if (!ctx)
+		return;
+
+	bulk_context_ops[type].fnReset(ctx);
+
+	EnterCriticalSection(&bulk_pool_lock);
+	if (pool->idle < BULK_POOL_MAX_IDLE)
+	{
+		ObjectPool_Return(pool->pool, ctx);
+		pool->idle++;
+		ctx = NULL;
+	}
+	LeaveCriticalSection(&bulk_pool_lock);
+
+	bulk_context_ops[type].fnFree(ctx);
+}
+
+size_t bulk_memory_usage(const rdpBulk* WINPR_RESTRICT bulk)
+{
+	size_t size = 0;
+
+	WINPR_ASSERT(bulk);
+
+	for (size_t type = 0; type < BULK_CONTEXT_COUNT; type++)
+	{
+		if (bulk->Send[type])
+			size += bulk_context_ops[type].fnMemorySize(TRUE);
+		if (bulk->Recv[type])
+			size += bulk_context_ops[type].fnMemorySize(FALSE);
+	}
+
+	if (bulk->OutputBuffer)
+		size += BULK_OUTPUT_BUFFER_SIZE;
+	return size;
+}
+
+static void bulk_update_memory_usage(rdpBulk* WINPR_RESTRICT bulk)
+{
+	WINPR_ASSERT(bulk);
+	WINPR_ASSERT(bulk->context);
+
+	rdpMetrics* metrics = bulk->context->metrics;
+	if (metrics)
+		metrics->BulkMemoryUsage = bulk_memory_usage(bulk);
+}
+
+static void* bulk_get_context(rdpBulk* WINPR_RESTRICT bulk, BULK_CONTEXT_TYPE type,
+                              BOOL Compressor)
+{
+	WINPR_ASSERT(bulk);
+	WINPR_ASSERT(type < BULK_CONTEXT_COUNT);
+
+	void** pctx = Compressor ? &bulk->Send[type] : &bulk->Recv[type];
+	if (!*pctx)
+	{
+		*pctx = bulk_pool_take(type, Compressor);
+		if (!*pctx)
+		{
+			WLog_ERR(TAG, "failed to allocate bulk %scompression context",
+			         Compressor ? "" : "de");
+			return NULL;
+		}
+		bulk_update_memory_usage(bulk);
+	}
+	return *pctx;
+}
+
+static BYTE* bulk_get_output_buffer(rdpBulk* WINPR_RESTRICT bulk)
+{
+	WINPR_ASSERT(bulk);
+
+	if (!bulk->OutputBuffer)
+	{
+		bulk->OutputBuffer = malloc(BULK_OUTPUT_BUFFER_SIZE);
+		if (!bulk->OutputBuffer)
+			return NULL;
+		bulk_update_memory_usage(bulk);
+	}
+	return bulk->OutputBuffer;
+}
+
+static void bulk_release_contexts(rdpBulk* WINPR_RESTRICT bulk)
+{
+	WINPR_ASSERT(bulk);
+
+	for (size_t x = 0; x < BULK_CONTEXT_COUNT; x++)
+	{
+		const BULK_CONTEXT_TYPE type = (BULK_CONTEXT_TYPE)x;
+		bulk_pool_return(type, TRUE, bulk->Send[type]);
+		bulk_pool_return(type, FALSE, bulk->Recv[type]);
+		bulk->Send[type] = NULL;
+		bulk->Recv[type] = NULL;
+	}
+
+	free(bulk->DecompressBuffer);
+	bulk->DecompressBuffer = NULL;
+}
+
 #if defined(WITH_BULK_DEBUG)
 static INLINE const char* bulk_get_compression_flags_string(UINT32 flags)
 {
@@ -80,13 +368,45 @@ static UINT32 bulk_compression_level(rdpBulk* WINPR_RESTRICT bulk)
 	WINPR_ASSERT(bulk->context);
 	settings = bulk->context->settings;
 	WINPR_ASSERT(settings);
-	bulk->CompressionLevel = (settings->CompressionLevel >= PACKET_COMPR_TYPE_RDP61)
-	                             ? PACKET_COMPR_TYPE_RDP61
+	bulk->CompressionLevel = (settings->CompressionLevel >= PACKET_COMPR_TYPE_RDP8)
+	                             ? PACKET_COMPR_TYPE_RDP8
 	                             : settings->CompressionLevel;
 	WINPR_ASSERT(bulk->CompressionLevel <= UINT16_MAX);
 	return bulk->CompressionLevel;
 }
 
+static BULK_COMPRESSION_EFFORT bulk_compression_effort(const rdpBulk* WINPR_RESTRICT bulk)
+{
+	WINPR_ASSERT(bulk);
+	WINPR_ASSERT(bulk->context);
+
+	const UINT32 effort =
+	    freerdp_settings_get_uint32(bulk->context->settings, FreeRDP_CompressionEffort);
+
+	switch (effort)
+	{
+		case BULK_COMPRESSION_EFFORT_FAST:
+		case BULK_COMPRESSION_EFFORT_MAX:
+			return (BULK_COMPRESSION_EFFORT)effort;
+		default:
+			return BULK_COMPRESSION_EFFORT_DEFAULT;
+	}
+}
+
+static ZGFX_COMPRESSION_LEVEL bulk_zgfx_compression_level(BULK_COMPRESSION_EFFORT effort)
+{
+	switch (effort)
+	{
+		case BULK_COMPRESSION_EFFORT_FAST:
+			return ZGFX_COMPRESSION_LEVEL_FAST;
+		case BULK_COMPRESSION_EFFORT_MAX:
+			return ZGFX_COMPRESSION_LEVEL_MAX;
+		case BULK_COMPRESSION_EFFORT_DEFAULT:
+		default:
+			return ZGFX_COMPRESSION_LEVEL_DEFAULT;
+	}
+}
+
 UINT16 bulk_compression_max_size(rdpBulk* WINPR_RESTRICT bulk)
 {
 	WINPR_ASSERT(bulk);
@@ -170,32 +490,48 @@ int bulk_decompress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_RESTRICT pSr
 		switch (type)
 		{
 			case PACKET_COMPR_TYPE_8K:
-				mppc_set_compression_level(bulk->mppcRecv, 0);
-				status =
-				    mppc_decompress(bulk->mppcRecv, pSrcData, SrcSize, ppDstData, pDstSize, flags);
-				break;
-
 			case PACKET_COMPR_TYPE_64K:
-				mppc_set_compression_level(bulk->mppcRecv, 1);
-				status =
-				    mppc_decompress(bulk->mppcRecv, pSrcData, SrcSize, ppDstData, pDstSize, flags);
-				break;
+			{
+				MPPC_CONTEXT* mppc = bulk_get_context(bulk, BULK_CONTEXT_MPPC, FALSE);
+				if (!mppc)
+					break;
+				mppc_set_compression_level(mppc, (type == PACKET_COMPR_TYPE_64K) ? 1 : 0);
+				status = mppc_decompress(mppc, pSrcData, SrcSize, ppDstData, pDstSize, flags);
+			}
+			break;
 
 			case PACKET_COMPR_TYPE_RDP6:
-				status = ncrush_decompress(bulk->ncrushRecv, pSrcData, SrcSize, ppDstData, pDstSize,
-				                           flags);
-				break;
+			{
+				NCRUSH_CONTEXT* ncrush = bulk_get_context(bulk, BULK_CONTEXT_NCRUSH, FALSE);
+				if (!ncrush)
+					break;
+				status = ncrush_decompress(ncrush, pSrcData, SrcSize, ppDstData, pDstSize, flags);
+			}
+			break;
 
 			case PACKET_COMPR_TYPE_RDP61:
-				status = xcrush_decompress(bulk->xcrushRecv, pSrcData, SrcSize, ppDstData, pDstSize,
-				                           flags);
-				break;
+			{
+				XCRUSH_CONTEXT* xcrush = bulk_get_context(bulk, BULK_CONTEXT_XCRUSH, FALSE);
+				if (!xcrush)
+					break;
+				status = xcrush_decompress(xcrush, pSrcData, SrcSize, ppDstData, pDstSize, flags);
+			}
+			break;
 
 			case PACKET_COMPR_TYPE_RDP8:
-				WLog_ERR(TAG, "Unsupported bulk compression type %08" PRIx32,
-				         bulk->CompressionLevel);
-				status = -1;
-				break;
+			{
+				ZGFX_CONTEXT* zgfx = bulk_get_context(bulk, BULK_CONTEXT_ZGFX, FALSE);
+				if (!zgfx)
+					break;
+
+				BYTE* pDstData = NULL;
+				free(bulk->DecompressBuffer);
+				bulk->DecompressBuffer = NULL;
+				status = zgfx_decompress(zgfx, pSrcData, SrcSize, &pDstData, pDstSize, flags);
+				bulk->DecompressBuffer = pDstData;
+				*ppDstData = pDstData;
+			}
+			break;
 			default:
 				WLog_ERR(TAG, "Unknown bulk compression type %08" PRIx32, bulk->CompressionLevel);
 				status = -1;
@@ -259,30 +595,78 @@ int bulk_compress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_RESTRICT pSrcD
 		return 0;
 	}
 
-	*pDstSize = sizeof(bulk->OutputBuffer);
 	(void)bulk_compression_level(bulk);
 	(void)bulk_compression_max_size(bulk);
+	const BULK_COMPRESSION_EFFORT effort = bulk_compression_effort(bulk);
+
+	BYTE* OutputBuffer = bulk_get_output_buffer(bulk);
+	if (!OutputBuffer)
+		return -1;
+	*pDstSize = BULK_OUTPUT_BUFFER_SIZE;
 
 	switch (bulk->CompressionLevel)
 	{
 		case PACKET_COMPR_TYPE_8K:
 		case PACKET_COMPR_TYPE_64K:
-			mppc_set_compression_level(bulk->mppcSend, bulk->CompressionLevel);
-			status = mppc_compress(bulk->mppcSend, pSrcData, SrcSize, bulk->OutputBuffer, ppDstData,
-			                       pDstSize, pFlags);
-			break;
+		{
+			MPPC_CONTEXT* mppc = bulk_get_context(bulk, BULK_CONTEXT_MPPC, TRUE);
+			if (!mppc)
+				break;
+			mppc_set_compression_level(mppc, bulk->CompressionLevel);
+			(void)mppc_set_compression_effort(mppc, effort);
+			status = mppc_compress(mppc, pSrcData, SrcSize, OutputBuffer, ppDstData, pDstSize,
+			                       pFlags);
+		}
+		break;
 		case PACKET_COMPR_TYPE_RDP6:
-			status = ncrush_compress(bulk->ncrushSend, pSrcData, SrcSize, bulk->OutputBuffer,
-			                         ppDstData, pDstSize, pFlags);
-			break;
+		{
+			NCRUSH_CONTEXT* ncrush = bulk_get_context(bulk, BULK_CONTEXT_NCRUSH, TRUE);
+			if (!ncrush)
+				break;
+			(void)ncrush_set_compression_effort(ncrush, effort);
+			status = ncrush_compress(ncrush, pSrcData, SrcSize, OutputBuffer, ppDstData, pDstSize,
+			                         pFlags);
+		}
+		break;
 		case PACKET_COMPR_TYPE_RDP61:
-			status = xcrush_compress(bulk->xcrushSend, pSrcData, SrcSize, bulk->OutputBuffer,
-			                         ppDstData, pDstSize, pFlags);
-			break;
+		{
+			XCRUSH_CONTEXT* xcrush = bulk_get_context(bulk, BULK_CONTEXT_XCRUSH, TRUE);
+			if (!xcrush)
+				break;
+			(void)xcrush_set_compression_effort(xcrush, effort);
+			status = xcrush_compress(xcrush, pSrcData, SrcSize, OutputBuffer, ppDstData, pDstSize,
+			                         pFlags);
+		}
+		break;
 		case PACKET_COMPR_TYPE_RDP8:
-			WLog_ERR(TAG, "Unsupported bulk compression type %08" PRIx32, bulk->CompressionLevel);
-			status = -1;
-			break;
+		{
+			ZGFX_CONTEXT* zgfx = bulk_get_context(bulk, BULK_CONTEXT_ZGFX, TRUE);
+			if (!zgfx)
+				break;
+			if (!zgfx_context_set_compression_level(zgfx, bulk_zgfx_compression_level(effort)))
+				break;
+
+			/* the segments carry their own compression flags, the decompressor appends every
+			 * one of them to its history, so the packet is always sent as RDP8 data */
+			UINT32 zflags = 0;
+			wStream sbuffer = { 0 };
+			wStream* s = Stream_StaticInit(&sbuffer, OutputBuffer, *pDstSize);
+			status = zgfx_compress_to_stream(zgfx, s, pSrcData, SrcSize, &zflags);
+
+			/* packets are far smaller than the buffer, it must never have been reallocated */
+			if (Stream_Buffer(s) != OutputBuffer)
+			{
+				free(Stream_Buffer(s));
+				status = -1;
+			}
+			else if (status >= 0)
+			{
+				*ppDstData = OutputBuffer;
+				*pDstSize = (UINT32)Stream_GetPosition(s);
+				*pFlags = PACKET_COMPRESSED | PACKET_COMPR_TYPE_RDP8;
+			}
+		}
+		break;
 		default:
 			WLog_ERR(TAG, "Unknown bulk compression type %08" PRIx32, bulk->CompressionLevel);
 			status = -1;
@@ -324,12 +708,10 @@ void bulk_reset(rdpBulk* WINPR_RESTRICT bulk)
 {
 	WINPR_ASSERT(bulk);
 
-	mppc_context_reset(bulk->mppcSend, FALSE);
-	mppc_context_reset(bulk->mppcRecv, FALSE);
-	ncrush_context_reset(bulk->ncrushRecv, FALSE);
-	ncrush_context_reset(bulk->ncrushSend, FALSE);
-	xcrush_context_reset(bulk->xcrushRecv, FALSE);
-	xcrush_context_reset(bulk->xcrushSend, FALSE);
+	/* The compression type might change with the next activation, hand the contexts back
+	 * and pick the matching ones on first use again */
+	bulk_release_contexts(bulk);
+	bulk_update_memory_usage(bulk);
 }
 
 rdpBulk* bulk_new(rdpContext* context)
@@ -337,39 +719,21 @@ rdpBulk* bulk_new(rdpContext* context)
 	rdpBulk* bulk = NULL;
 	WINPR_ASSERT(context);
 
+	if (!bulk_pool_acquire())
+		return NULL;
+
 	bulk = (rdpBulk*)calloc(1, sizeof(rdpBulk));
 
 	if (!bulk)
-		goto fail;
+	{
+		bulk_pool_release();
+		return NULL;
+	}
 
 	bulk->context = context;
-	bulk->mppcSend = mppc_context_new(1, TRUE);
-	if (!bulk->mppcSend)
-		goto fail;
-	bulk->mppcRecv = mppc_context_new(1, FALSE);
-	if (!bulk->mppcRecv)
-		goto fail;
-	bulk->ncrushRecv = ncrush_context_new(FALSE);
-	if (!bulk->ncrushRecv)
-		goto fail;
-	bulk->ncrushSend = ncrush_context_new(TRUE);
-	if (!bulk->ncrushSend)
-		goto fail;
-	bulk->xcrushRecv = xcrush_context_new(FALSE);
-	if (!bulk->xcrushRecv)
-		goto fail;
-	bulk->xcrushSend = xcrush_context_new(TRUE);
-	if (!bulk->xcrushSend)
-		goto fail;
 	bulk->CompressionLevel = context->settings->CompressionLevel;
 
 	return bulk;
-fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	bulk_free(bulk);
-	WINPR_PRAGMA_DIAG_POP
-	return NULL;
 }
 
 void bulk_free(rdpBulk* bulk)
@@ -377,11 +741,8 @@ void bulk_free(rdpBulk* bulk)
 	if (!bulk)
 		return;
 
-	mppc_context_free(bulk->mppcSend);
-	mppc_context_free(bulk->mppcRecv);
-	ncrush_context_free(bulk->ncrushRecv);
-	ncrush_context_free(bulk->ncrushSend);
-	xcrush_context_free(bulk->xcrushRecv);
-	xcrush_context_free(bulk->xcrushSend);
+	bulk_release_contexts(bulk);
+	free(bulk->OutputBuffer);
 	free(bulk);
+	bulk_pool_release();
 }
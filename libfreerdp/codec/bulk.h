@@ -39,6 +39,9 @@ FREERDP_LOCAL int bulk_compress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_
 
 FREERDP_LOCAL void bulk_reset(rdpBulk* WINPR_RESTRICT bulk);
 
+/* bytes currently held by the compression contexts and buffers of this session */
+FREERDP_LOCAL size_t bulk_memory_usage(const rdpBulk* WINPR_RESTRICT bulk);
+
 FREERDP_LOCAL void bulk_free(rdpBulk* bulk);
 
 WINPR_ATTR_MALLOC(bulk_free, 1)
@@ -0,0 +1,54 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Bulk Compression Match Length
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include "bulk_match.h"
+#include "sse/bulk_match_sse2.h"
+#include "neon/bulk_match_neon.h"
+
+UINT32 bulk_match_length(const BYTE* a, const BYTE* b, UINT32 maxLength)
+{
+	UINT32 length = 0;
+
+	for (; length + 8 <= maxLength; length += 8)
+	{
+		UINT64 va = 0;
+		UINT64 vb = 0;
+		memcpy(&va, &a[length], sizeof(va));
+		memcpy(&vb, &b[length], sizeof(vb));
+
+		if (va != vb)
+			break;
+	}
+
+	while ((length < maxLength) && (a[length] == b[length]))
+		length++;
+
+	return length;
+}
+
+bulk_match_length_fn_t bulk_match_length_get(void)
+{
+	bulk_match_length_fn_t fn = bulk_match_length;
+
+	bulk_match_init_sse2(&fn);
+	bulk_match_init_neon(&fn);
+	return fn;
+}
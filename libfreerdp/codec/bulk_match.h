@@ -0,0 +1,38 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Bulk Compression Match Length
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_BULK_MATCH_H
+#define FREERDP_LIB_CODEC_BULK_MATCH_H
+
+#include <freerdp/api.h>
+#include <freerdp/types.h>
+
+/**
+ * Number of leading bytes a and b have in common, at most maxLength.
+ *
+ * Both pointers usually point into the same history buffer, a before b, so the ranges may
+ * overlap. Only the bytes up to maxLength are read.
+ */
+typedef UINT32 (*bulk_match_length_fn_t)(const BYTE* a, const BYTE* b, UINT32 maxLength);
+
+/* Generic implementation, also used by the SIMD implementations for tails */
+FREERDP_LOCAL UINT32 bulk_match_length(const BYTE* a, const BYTE* b, UINT32 maxLength);
+
+/* The fastest implementation supported by the CPU */
+FREERDP_LOCAL bulk_match_length_fn_t bulk_match_length_get(void);
+
+#endif /* FREERDP_LIB_CODEC_BULK_MATCH_H */
@@ -37,6 +37,15 @@
 
 #define CLEARCODEC_VBAR_SIZE 32768
 #define CLEARCODEC_VBAR_SHORT_SIZE 16384
+#define CLEARCODEC_GLYPH_CACHE_SIZE 4000
+#define CLEARCODEC_GLYPH_MAX_PIXELS 1024
+#define CLEARCODEC_VBAR_MAX_HEIGHT 52
+
+#define CLEARCODEC_SUBCODEC_UNCOMPRESSED 0
+#define CLEARCODEC_SUBCODEC_NSCODEC 1
+#define CLEARCODEC_SUBCODEC_RLEX 2
+
+#define CLEARCODEC_ENCODER_LOOKUP_SIZE 65536
 
 typedef struct
 {
@@ -52,9 +61,54 @@ typedef struct
 	BYTE* pixels;
 } CLEAR_VBAR_ENTRY;
 
+/* Encoder side mirror of a decoder VBar or ShortVBar storage entry */
+typedef struct
+{
+	UINT32 count;
+	UINT32 hash;
+	UINT32 pixels[CLEARCODEC_VBAR_MAX_HEIGHT];
+} CLEAR_VBAR_MIRROR;
+
+/* Encoder side mirror of a decoder glyph cache entry */
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 hash;
+	UINT32* pixels;
+} CLEAR_GLYPH_MIRROR;
+
+typedef struct
+{
+	BOOL CacheReset;
+	NSC_CONTEXT* nsc;
+	UINT32* pixels;
+	size_t pixelsSize;
+	UINT32* flipped;
+	size_t flippedSize;
+	wStream* residual;
+	wStream* bands;
+	wStream* subcodecs;
+	wStream* scratch;
+
+	UINT32 residualColor;
+	UINT32 residualCount;
+
+	UINT32 VBarCursor;
+	CLEAR_VBAR_MIRROR VBar[CLEARCODEC_VBAR_SIZE];
+	UINT32 VBarLookup[CLEARCODEC_ENCODER_LOOKUP_SIZE];
+	UINT32 ShortVBarCursor;
+	CLEAR_VBAR_MIRROR ShortVBar[CLEARCODEC_VBAR_SHORT_SIZE];
+	UINT32 ShortVBarLookup[CLEARCODEC_ENCODER_LOOKUP_SIZE];
+	UINT32 GlyphCursor;
+	CLEAR_GLYPH_MIRROR Glyph[CLEARCODEC_GLYPH_CACHE_SIZE];
+	UINT32 GlyphLookup[CLEARCODEC_ENCODER_LOOKUP_SIZE];
+} CLEAR_ENCODER;
+
 struct S_CLEAR_CONTEXT
 {
 	BOOL Compressor;
+	CLEAR_ENCODER* encoder;
 	NSC_CONTEXT* nsc;
 	UINT32 seqNumber;
 	BYTE* TempBuffer;
@@ -1150,14 +1204,756 @@ fail:
 	return rc;
 }
 
+static INLINE UINT32 clear_hash_pixels(const UINT32* WINPR_RESTRICT pixels, size_t count,
+                                       UINT32 seed)
+{
+	/* FNV-1a over the 24bit colors */
+	UINT32 hash = 2166136261u ^ seed;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		hash ^= pixels[x];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static INLINE UINT32 clear_lookup_slot(UINT32 hash)
+{
+	return (hash ^ (hash >> 16)) % CLEARCODEC_ENCODER_LOOKUP_SIZE;
+}
+
+static INLINE void clear_write_bgr(wStream* WINPR_RESTRICT s, UINT32 color)
+{
+	Stream_Write_UINT8(s, color & 0xFF);         /* b */
+	Stream_Write_UINT8(s, (color >> 8) & 0xFF);  /* g */
+	Stream_Write_UINT8(s, (color >> 16) & 0xFF); /* r */
+}
+
+static INLINE size_t clear_run_length_size(UINT32 runLengthFactor)
+{
+	if (runLengthFactor < 0xFF)
+		return 1;
+	if (runLengthFactor < 0xFFFF)
+		return 3;
+	return 7;
+}
+
+static INLINE void clear_write_run_length(wStream* WINPR_RESTRICT s, UINT32 runLengthFactor)
+{
+	if (runLengthFactor < 0xFF)
+	{
+		Stream_Write_UINT8(s, (BYTE)runLengthFactor);
+		return;
+	}
+
+	Stream_Write_UINT8(s, 0xFF);
+
+	if (runLengthFactor < 0xFFFF)
+	{
+		Stream_Write_UINT16(s, (UINT16)runLengthFactor);
+		return;
+	}
+
+	Stream_Write_UINT16(s, 0xFFFF);
+	Stream_Write_UINT32(s, runLengthFactor);
+}
+
+static BOOL clear_encoder_flush_residual(CLEAR_ENCODER* WINPR_RESTRICT encoder)
+{
+	if (encoder->residualCount == 0)
+		return TRUE;
+
+	if (!Stream_EnsureRemainingCapacity(encoder->residual, 10))
+		return FALSE;
+
+	clear_write_bgr(encoder->residual, encoder->residualColor);
+	clear_write_run_length(encoder->residual, encoder->residualCount);
+	encoder->residualCount = 0;
+	return TRUE;
+}
+
+static INLINE BOOL clear_encoder_residual_append(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                                                 UINT32 color, UINT32 count)
+{
+	if ((encoder->residualCount > 0) && (encoder->residualColor != color))
+	{
+		if (!clear_encoder_flush_residual(encoder))
+			return FALSE;
+	}
+
+	encoder->residualColor = color;
+	encoder->residualCount += count;
+	return TRUE;
+}
+
+static size_t clear_residual_cost(const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth,
+                                  UINT32 nHeight)
+{
+	size_t cost = 0;
+	const size_t count = 1ull * nWidth * nHeight;
+
+	for (size_t x = 0; x < count;)
+	{
+		size_t run = 1;
+
+		while ((x + run < count) && (pixels[x + run] == pixels[x]))
+			run++;
+
+		cost += 3 + clear_run_length_size((UINT32)run);
+		x += run;
+	}
+
+	return cost;
+}
+
+static BOOL clear_encode_residual(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                                  const UINT32* WINPR_RESTRICT pixels, size_t count)
+{
+	for (size_t x = 0; x < count;)
+	{
+		size_t run = 1;
+
+		while ((x + run < count) && (pixels[x + run] == pixels[x]))
+			run++;
+
+		if (!clear_encoder_residual_append(encoder, pixels[x], (UINT32)run))
+			return FALSE;
+
+		x += run;
+	}
+
+	return TRUE;
+}
+
+/* Returns the most frequent color if it covers more than half of the pixels, a guess otherwise */
+static UINT32 clear_band_background(const UINT32* WINPR_RESTRICT pixels, size_t count)
+{
+	UINT32 candidate = pixels[0];
+	size_t votes = 0;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (votes == 0)
+			candidate = pixels[x];
+
+		if (pixels[x] == candidate)
+			votes++;
+		else
+			votes--;
+	}
+
+	return candidate;
+}
+
+static void clear_vbar_extract(const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 column,
+                               UINT32 vBarHeight, UINT32 colorBkg, UINT32* WINPR_RESTRICT vBar,
+                               UINT32* WINPR_RESTRICT pYOn, UINT32* WINPR_RESTRICT pYOff)
+{
+	UINT32 yOn = vBarHeight;
+	UINT32 yOff = 0;
+
+	for (UINT32 y = 0; y < vBarHeight; y++)
+	{
+		vBar[y] = pixels[1ull * y * nWidth + column];
+
+		if (vBar[y] != colorBkg)
+		{
+			if (yOn == vBarHeight)
+				yOn = y;
+
+			yOff = y + 1;
+		}
+	}
+
+	if (yOn == vBarHeight)
+		yOn = 0;
+
+	*pYOn = yOn;
+	*pYOff = yOff;
+}
+
+static INLINE INT32 clear_vbar_find(const CLEAR_VBAR_MIRROR* WINPR_RESTRICT storage,
+                                    const UINT32* WINPR_RESTRICT lookup,
+                                    const UINT32* WINPR_RESTRICT pixels, UINT32 count,
+                                    UINT32 hash)
+{
+	const UINT32 slot = lookup[clear_lookup_slot(hash)];
+
+	if (slot == 0)
+		return -1;
+
+	const CLEAR_VBAR_MIRROR* entry = &storage[slot - 1];
+
+	if ((entry->hash != hash) || (entry->count != count))
+		return -1;
+
+	if (memcmp(entry->pixels, pixels, sizeof(UINT32) * count) != 0)
+		return -1;
+
+	return (INT32)(slot - 1);
+}
+
+static INLINE void clear_vbar_store(CLEAR_VBAR_MIRROR* WINPR_RESTRICT storage,
+                                    UINT32* WINPR_RESTRICT lookup, UINT32 index,
+                                    const UINT32* WINPR_RESTRICT pixels, UINT32 count,
+                                    UINT32 hash)
+{
+	CLEAR_VBAR_MIRROR* entry = &storage[index];
+	entry->count = count;
+	entry->hash = hash;
+	memcpy(entry->pixels, pixels, sizeof(UINT32) * count);
+	lookup[clear_lookup_slot(hash)] = index + 1;
+}
+
+static size_t clear_bands_cost(const CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                               const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth,
+                               UINT32 vBarHeight, UINT32 colorBkg)
+{
+	/* Estimate against the current cache state, hits within the band are not accounted */
+	size_t cost = 11;
+
+	for (UINT32 x = 0; x < nWidth; x++)
+	{
+		UINT32 yOn = 0;
+		UINT32 yOff = 0;
+		UINT32 vBar[CLEARCODEC_VBAR_MAX_HEIGHT] = { 0 };
+
+		clear_vbar_extract(pixels, nWidth, x, vBarHeight, colorBkg, vBar, &yOn, &yOff);
+
+		const UINT32 hash = clear_hash_pixels(vBar, vBarHeight, vBarHeight);
+
+		if (clear_vbar_find(encoder->VBar, encoder->VBarLookup, vBar, vBarHeight, hash) >= 0)
+		{
+			cost += 2;
+			continue;
+		}
+
+		const UINT32 shortCount = yOff - yOn;
+		const UINT32 shortHash = clear_hash_pixels(&vBar[yOn], shortCount, shortCount);
+
+		if ((shortCount > 0) && (clear_vbar_find(encoder->ShortVBar, encoder->ShortVBarLookup,
+		                                         &vBar[yOn], shortCount, shortHash) >= 0))
+			cost += 3;
+		else
+			cost += 2 + 3ull * shortCount;
+	}
+
+	return cost;
+}
+
+static BOOL clear_encode_band(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                              const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 yStart,
+                              UINT32 vBarHeight, UINT32 colorBkg)
+{
+	wStream* s = encoder->bands;
+
+	if (!Stream_EnsureRemainingCapacity(s, 11 + nWidth * (2ull + 3ull * vBarHeight)))
+		return FALSE;
+
+	Stream_Write_UINT16(s, 0);                                            /* xStart */
+	Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, nWidth - 1)); /* xEnd */
+	Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, yStart));     /* yStart */
+	Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, yStart + vBarHeight - 1)); /* yEnd */
+	clear_write_bgr(s, colorBkg);
+
+	for (UINT32 x = 0; x < nWidth; x++)
+	{
+		UINT32 yOn = 0;
+		UINT32 yOff = 0;
+		UINT32 vBar[CLEARCODEC_VBAR_MAX_HEIGHT] = { 0 };
+
+		clear_vbar_extract(pixels, nWidth, x, vBarHeight, colorBkg, vBar, &yOn, &yOff);
+
+		const UINT32 hash = clear_hash_pixels(vBar, vBarHeight, vBarHeight);
+		const INT32 vBarIndex =
+		    clear_vbar_find(encoder->VBar, encoder->VBarLookup, vBar, vBarHeight, hash);
+
+		if (vBarIndex >= 0)
+		{
+			Stream_Write_UINT16(s, (UINT16)(0x8000 | vBarIndex)); /* VBAR_CACHE_HIT */
+			continue;
+		}
+
+		const UINT32 shortCount = yOff - yOn;
+		const UINT32 shortHash = clear_hash_pixels(&vBar[yOn], shortCount, shortCount);
+		const INT32 shortIndex =
+		    (shortCount > 0) ? clear_vbar_find(encoder->ShortVBar, encoder->ShortVBarLookup,
+		                                       &vBar[yOn], shortCount, shortHash)
+		                     : -1;
+
+		if (shortIndex >= 0)
+		{
+			Stream_Write_UINT16(s, (UINT16)(0x4000 | shortIndex)); /* SHORT_VBAR_CACHE_HIT */
+			Stream_Write_UINT8(s, (BYTE)yOn);
+		}
+		else
+		{
+			/* SHORT_VBAR_CACHE_MISS */
+			Stream_Write_UINT16(s, (UINT16)((yOff << 8) | yOn));
+
+			for (UINT32 y = yOn; y < yOff; y++)
+				clear_write_bgr(s, vBar[y]);
+
+			clear_vbar_store(encoder->ShortVBar, encoder->ShortVBarLookup,
+			                 encoder->ShortVBarCursor, &vBar[yOn], shortCount, shortHash);
+			encoder->ShortVBarCursor =
+			    (encoder->ShortVBarCursor + 1) % CLEARCODEC_VBAR_SHORT_SIZE;
+		}
+
+		/* The decoder composes and stores the full vBar for every short vBar */
+		clear_vbar_store(encoder->VBar, encoder->VBarLookup, encoder->VBarCursor, vBar,
+		                 vBarHeight, hash);
+		encoder->VBarCursor = (encoder->VBarCursor + 1) % CLEARCODEC_VBAR_SIZE;
+	}
+
+	return TRUE;
+}
+
+static BOOL clear_encode_rlex(const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 nHeight,
+                              wStream* WINPR_RESTRICT s)
+{
+	BYTE paletteCount = 0;
+	UINT32 palette[127] = { 0 };
+	BYTE* indices = NULL;
+	const size_t count = 1ull * nWidth * nHeight;
+
+	if (count == 0)
+		return FALSE;
+
+	indices = malloc(count);
+
+	if (!indices)
+		return FALSE;
+
+	/* Palette entries are ordered by first appearance so gradients map to suites */
+	for (size_t x = 0; x < count; x++)
+	{
+		BYTE index = 0;
+
+		if ((x > 0) && (pixels[x] == pixels[x - 1]))
+		{
+			indices[x] = indices[x - 1];
+			continue;
+		}
+
+		while ((index < paletteCount) && (palette[index] != pixels[x]))
+			index++;
+
+		if (index == paletteCount)
+		{
+			if (paletteCount >= ARRAYSIZE(palette))
+			{
+				free(indices);
+				return FALSE;
+			}
+
+			palette[paletteCount++] = pixels[x];
+		}
+
+		indices[x] = index;
+	}
+
+	const UINT32 numBits = CLEAR_LOG2_FLOOR[paletteCount - 1] + 1;
+	const UINT32 maxSuiteDepth = CLEAR_8BIT_MASKS[8 - numBits];
+
+	if (!Stream_EnsureRemainingCapacity(s, 1 + 3ull * paletteCount + 2ull * count + 8))
+	{
+		free(indices);
+		return FALSE;
+	}
+
+	Stream_Write_UINT8(s, paletteCount);
+
+	for (BYTE x = 0; x < paletteCount; x++)
+		clear_write_bgr(s, palette[x]);
+
+	for (size_t x = 0; x < count;)
+	{
+		const BYTE startIndex = indices[x];
+		UINT32 run = 1;
+		UINT32 suiteDepth = 0;
+
+		while ((x + run < count) && (indices[x + run] == startIndex))
+			run++;
+
+		/* A segment is a run of startIndex followed by the suite startIndex..stopIndex */
+		size_t pos = x + run;
+
+		while ((suiteDepth < maxSuiteDepth) && (pos < count) &&
+		       (indices[pos] == startIndex + suiteDepth + 1))
+		{
+			suiteDepth++;
+			pos++;
+		}
+
+		Stream_Write_UINT8(s, (BYTE)((suiteDepth << numBits) | (startIndex + suiteDepth)));
+		clear_write_run_length(s, run - 1);
+		x = pos;
+	}
+
+	free(indices);
+	return TRUE;
+}
+
+static BOOL clear_encode_subcodec(CLEAR_ENCODER* WINPR_RESTRICT encoder, BYTE subcodecId,
+                                  UINT32 yStart, UINT32 nWidth, UINT32 nHeight,
+                                  const BYTE* WINPR_RESTRICT pData, size_t length)
+{
+	wStream* s = encoder->subcodecs;
+
+	if (!Stream_EnsureRemainingCapacity(s, 13 + length))
+		return FALSE;
+
+	Stream_Write_UINT16(s, 0);                                            /* xStart */
+	Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, yStart));     /* yStart */
+	Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, nWidth));     /* width */
+	Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, nHeight));    /* height */
+	Stream_Write_UINT32(s, WINPR_ASSERTING_INT_CAST(UINT32, length));     /* bitmapDataByteCount */
+	Stream_Write_UINT8(s, subcodecId);                                    /* subcodecId */
+	Stream_Write(s, pData, length);
+	return TRUE;
+}
+
+static BOOL clear_encode_uncompressed(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                                      const UINT32* WINPR_RESTRICT pixels, UINT32 yStart,
+                                      UINT32 nWidth, UINT32 nHeight)
+{
+	const size_t count = 1ull * nWidth * nHeight;
+	wStream* scratch = encoder->scratch;
+
+	Stream_SetPosition(scratch, 0);
+
+	if (!Stream_EnsureRemainingCapacity(scratch, 3 * count))
+		return FALSE;
+
+	for (size_t x = 0; x < count; x++)
+		clear_write_bgr(scratch, pixels[x]);
+
+	return clear_encode_subcodec(encoder, CLEARCODEC_SUBCODEC_UNCOMPRESSED, yStart, nWidth,
+	                             nHeight, Stream_Buffer(scratch), Stream_GetPosition(scratch));
+}
+
+static BOOL clear_encode_nsc(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                             const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 nHeight,
+                             wStream* WINPR_RESTRICT s)
+{
+	const size_t count = 1ull * nWidth * nHeight;
+
+	if (count > encoder->flippedSize)
+	{
+		UINT32* tmp = winpr_aligned_recalloc(encoder->flipped, count, sizeof(UINT32), 32);
+
+		if (!tmp)
+			return FALSE;
+
+		encoder->flipped = tmp;
+		encoder->flippedSize = count;
+	}
+
+	/* The NSCodec encoder expects bottom up input, the subcodec is decoded top down */
+	for (UINT32 y = 0; y < nHeight; y++)
+		memcpy(&encoder->flipped[1ull * (nHeight - y - 1) * nWidth], &pixels[1ull * y * nWidth],
+		       sizeof(UINT32) * nWidth);
+
+	return nsc_compose_message(encoder->nsc, s, (const BYTE*)encoder->flipped, nWidth, nHeight,
+	                           nWidth * sizeof(UINT32));
+}
+
+/**
+ * Encode a horizontal strip of at most CLEARCODEC_VBAR_MAX_HEIGHT rows with whichever layer
+ * produces the least data. Strips not coded in the residual layer still need residual pixels,
+ * these are merged into the current residual run as they are overdrawn anyway.
+ */
+static BOOL clear_encode_strip(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                               const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 yStart,
+                               UINT32 nHeight, BOOL lossless)
+{
+	const size_t count = 1ull * nWidth * nHeight;
+	const size_t residualCost = clear_residual_cost(pixels, nWidth, nHeight);
+	const UINT32 colorBkg = clear_band_background(pixels, count);
+	const size_t bandsCost = clear_bands_cost(encoder, pixels, nWidth, nHeight, colorBkg);
+	size_t rlexCost = SIZE_MAX;
+	size_t nscCost = SIZE_MAX;
+	const size_t rawCost = 13 + 3 * count;
+	wStream* scratch = encoder->scratch;
+
+	Stream_SetPosition(scratch, 0);
+
+	if (clear_encode_rlex(pixels, nWidth, nHeight, scratch))
+		rlexCost = 13 + Stream_GetPosition(scratch);
+	else if (!lossless)
+	{
+		Stream_SetPosition(scratch, 0);
+
+		if (clear_encode_nsc(encoder, pixels, nWidth, nHeight, scratch))
+			nscCost = 13 + Stream_GetPosition(scratch);
+	}
+
+	const size_t best = MIN(MIN(residualCost, bandsCost), MIN(MIN(rlexCost, nscCost), rawCost));
+
+	if (best == residualCost)
+		return clear_encode_residual(encoder, pixels, count);
+
+	/* The strip is overdrawn, extend whatever run the residual layer currently has */
+	if (encoder->residualCount == 0)
+		encoder->residualColor = colorBkg;
+
+	encoder->residualCount += (UINT32)count;
+
+	if (best == bandsCost)
+		return clear_encode_band(encoder, pixels, nWidth, yStart, nHeight, colorBkg);
+
+	if (best == rlexCost)
+		return clear_encode_subcodec(encoder, CLEARCODEC_SUBCODEC_RLEX, yStart, nWidth, nHeight,
+		                             Stream_Buffer(scratch), Stream_GetPosition(scratch));
+
+	if (best == nscCost)
+		return clear_encode_subcodec(encoder, CLEARCODEC_SUBCODEC_NSCODEC, yStart, nWidth,
+		                             nHeight, Stream_Buffer(scratch), Stream_GetPosition(scratch));
+
+	return clear_encode_uncompressed(encoder, pixels, yStart, nWidth, nHeight);
+}
+
+static INT32 clear_glyph_find(const CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                              const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 nHeight,
+                              UINT32 hash)
+{
+	const UINT32 slot = encoder->GlyphLookup[clear_lookup_slot(hash)];
+
+	if (slot == 0)
+		return -1;
+
+	const CLEAR_GLYPH_MIRROR* glyph = &encoder->Glyph[slot - 1];
+
+	if ((glyph->hash != hash) || (glyph->width != nWidth) || (glyph->height != nHeight))
+		return -1;
+
+	if (memcmp(glyph->pixels, pixels, sizeof(UINT32) * nWidth * nHeight) != 0)
+		return -1;
+
+	return (INT32)(slot - 1);
+}
+
+static BOOL clear_glyph_store(CLEAR_ENCODER* WINPR_RESTRICT encoder, UINT32 index,
+                              const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth, UINT32 nHeight,
+                              UINT32 hash)
+{
+	CLEAR_GLYPH_MIRROR* glyph = &encoder->Glyph[index];
+	UINT32* tmp = realloc(glyph->pixels, sizeof(UINT32) * nWidth * nHeight);
+
+	if (!tmp)
+		return FALSE;
+
+	memcpy(tmp, pixels, sizeof(UINT32) * nWidth * nHeight);
+	glyph->pixels = tmp;
+	glyph->width = nWidth;
+	glyph->height = nHeight;
+	glyph->hash = hash;
+	encoder->GlyphLookup[clear_lookup_slot(hash)] = index + 1;
+	return TRUE;
+}
+
+static BOOL clear_encoder_load_pixels(CLEAR_ENCODER* WINPR_RESTRICT encoder,
+                                      const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                                      UINT32 nSrcStep, UINT32 nWidth, UINT32 nHeight)
+{
+	const size_t count = 1ull * nWidth * nHeight;
+
+	if (count > encoder->pixelsSize)
+	{
+		UINT32* tmp = winpr_aligned_recalloc(encoder->pixels, count, sizeof(UINT32), 32);
+
+		if (!tmp)
+			return FALSE;
+
+		encoder->pixels = tmp;
+		encoder->pixelsSize = count;
+	}
+
+	if (!freerdp_image_copy_no_overlap((BYTE*)encoder->pixels, PIXEL_FORMAT_BGRX32,
+	                                   nWidth * sizeof(UINT32), 0, 0, nWidth, nHeight, pSrcData,
+	                                   SrcFormat, nSrcStep, 0, 0, NULL, FREERDP_FLIP_NONE))
+		return FALSE;
+
+	/* Only the 24bit color is transmitted, ignore whatever is in the X channel */
+	for (size_t x = 0; x < count; x++)
+		encoder->pixels[x] &= 0x00FFFFFF;
+
+	return TRUE;
+}
+
+BOOL clear_compress_to_stream(CLEAR_CONTEXT* WINPR_RESTRICT clear, wStream* WINPR_RESTRICT s,
+                              const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                              UINT32 nSrcStep, UINT32 nWidth, UINT32 nHeight)
+{
+	BYTE glyphFlags = 0;
+	INT32 glyphIndex = -1;
+	UINT32 glyphHash = 0;
+
+	WINPR_ASSERT(clear);
+	WINPR_ASSERT(s);
+	WINPR_ASSERT(pSrcData);
+
+	CLEAR_ENCODER* encoder = clear->encoder;
+
+	if (!encoder)
+	{
+		WLog_ERR(TAG, "context was not created as a compressor");
+		return FALSE;
+	}
+
+	if ((nWidth == 0) || (nHeight == 0) || (nWidth > 0xFFFF) || (nHeight > 0xFFFF))
+		return FALSE;
+
+	if (!clear_encoder_load_pixels(encoder, pSrcData, SrcFormat, nSrcStep, nWidth, nHeight))
+		return FALSE;
+
+	const UINT32* pixels = encoder->pixels;
+	const BOOL glyph = (1ull * nWidth * nHeight) <= CLEARCODEC_GLYPH_MAX_PIXELS;
+
+	if (encoder->CacheReset)
+	{
+		glyphFlags |= CLEARCODEC_FLAG_CACHE_RESET;
+		encoder->VBarCursor = 0;
+		encoder->ShortVBarCursor = 0;
+		encoder->CacheReset = FALSE;
+	}
+
+	if (glyph)
+	{
+		glyphHash = clear_hash_pixels(pixels, 1ull * nWidth * nHeight, nWidth);
+		glyphIndex = clear_glyph_find(encoder, pixels, nWidth, nHeight, glyphHash);
+
+		if (glyphIndex >= 0)
+			glyphFlags |= CLEARCODEC_FLAG_GLYPH_INDEX | CLEARCODEC_FLAG_GLYPH_HIT;
+		else
+		{
+			glyphFlags |= CLEARCODEC_FLAG_GLYPH_INDEX;
+			glyphIndex = (INT32)encoder->GlyphCursor;
+		}
+	}
+
+	if (!Stream_EnsureRemainingCapacity(s, 16))
+		return FALSE;
+
+	Stream_Write_UINT8(s, glyphFlags);
+	Stream_Write_UINT8(s, (BYTE)clear->seqNumber);
+
+	if (glyphFlags & CLEARCODEC_FLAG_GLYPH_INDEX)
+		Stream_Write_UINT16(s, (UINT16)glyphIndex);
+
+	clear->seqNumber = (clear->seqNumber + 1) % 256;
+
+	if (glyphFlags & CLEARCODEC_FLAG_GLYPH_HIT)
+		return TRUE;
+
+	Stream_SetPosition(encoder->residual, 0);
+	Stream_SetPosition(encoder->bands, 0);
+	Stream_SetPosition(encoder->subcodecs, 0);
+	encoder->residualCount = 0;
+
+	for (UINT32 y = 0; y < nHeight; y += CLEARCODEC_VBAR_MAX_HEIGHT)
+	{
+		const UINT32 height = MIN(CLEARCODEC_VBAR_MAX_HEIGHT, nHeight - y);
+
+		if (!clear_encode_strip(encoder, &pixels[1ull * y * nWidth], nWidth, y, height, glyph))
+			return FALSE;
+	}
+
+	if (!clear_encoder_flush_residual(encoder))
+		return FALSE;
+
+	const size_t residualByteCount = Stream_GetPosition(encoder->residual);
+	const size_t bandsByteCount = Stream_GetPosition(encoder->bands);
+	const size_t subcodecByteCount = Stream_GetPosition(encoder->subcodecs);
+
+	if (!Stream_EnsureRemainingCapacity(s, 12 + residualByteCount + bandsByteCount +
+	                                           subcodecByteCount))
+		return FALSE;
+
+	Stream_Write_UINT32(s, WINPR_ASSERTING_INT_CAST(UINT32, residualByteCount));
+	Stream_Write_UINT32(s, WINPR_ASSERTING_INT_CAST(UINT32, bandsByteCount));
+	Stream_Write_UINT32(s, WINPR_ASSERTING_INT_CAST(UINT32, subcodecByteCount));
+	Stream_Write(s, Stream_Buffer(encoder->residual), residualByteCount);
+	Stream_Write(s, Stream_Buffer(encoder->bands), bandsByteCount);
+	Stream_Write(s, Stream_Buffer(encoder->subcodecs), subcodecByteCount);
+
+	if (glyph)
+	{
+		/* The decoder caches the composed glyph after decoding it */
+		if (!clear_glyph_store(encoder, (UINT32)glyphIndex, pixels, nWidth, nHeight, glyphHash))
+			return FALSE;
+
+		encoder->GlyphCursor = (encoder->GlyphCursor + 1) % CLEARCODEC_GLYPH_CACHE_SIZE;
+	}
+
+	return TRUE;
+}
+
 int clear_compress(WINPR_ATTR_UNUSED CLEAR_CONTEXT* WINPR_RESTRICT clear,
                    WINPR_ATTR_UNUSED const BYTE* WINPR_RESTRICT pSrcData,
-                   WINPR_ATTR_UNUSED UINT32 SrcSize,
-                   WINPR_ATTR_UNUSED BYTE** WINPR_RESTRICT ppDstData,
-                   WINPR_ATTR_UNUSED UINT32* WINPR_RESTRICT pDstSize)
+                   WINPR_ATTR_UNUSED UINT32 SrcSize, BYTE** WINPR_RESTRICT ppDstData,
+                   UINT32* WINPR_RESTRICT pDstSize)
+{
+	if (ppDstData)
+		*ppDstData = NULL;
+	if (pDstSize)
+		*pDstSize = 0;
+
+	WLog_ERR(TAG, "bitmap geometry unknown, use clear_compress_to_stream instead!");
+	return -1;
+}
+
+static void clear_encoder_free(CLEAR_ENCODER* encoder)
 {
-	WLog_ERR(TAG, "TODO: not implemented!");
-	return 1;
+	if (!encoder)
+		return;
+
+	for (size_t x = 0; x < ARRAYSIZE(encoder->Glyph); x++)
+		free(encoder->Glyph[x].pixels);
+
+	nsc_context_free(encoder->nsc);
+	winpr_aligned_free(encoder->pixels);
+	winpr_aligned_free(encoder->flipped);
+	Stream_Free(encoder->residual, TRUE);
+	Stream_Free(encoder->bands, TRUE);
+	Stream_Free(encoder->subcodecs, TRUE);
+	Stream_Free(encoder->scratch, TRUE);
+	winpr_aligned_free(encoder);
+}
+
+static CLEAR_ENCODER* clear_encoder_new(void)
+{
+	CLEAR_ENCODER* encoder = winpr_aligned_calloc(1, sizeof(CLEAR_ENCODER), 32);
+
+	if (!encoder)
+		return NULL;
+
+	encoder->CacheReset = TRUE;
+	encoder->nsc = nsc_context_new();
+	encoder->residual = Stream_New(NULL, 4096);
+	encoder->bands = Stream_New(NULL, 4096);
+	encoder->subcodecs = Stream_New(NULL, 4096);
+	encoder->scratch = Stream_New(NULL, 4096);
+
+	if (!encoder->nsc || !encoder->residual || !encoder->bands || !encoder->subcodecs ||
+	    !encoder->scratch)
+		goto fail;
+
+	if (!nsc_context_set_parameters(encoder->nsc, NSC_COLOR_FORMAT, PIXEL_FORMAT_BGRX32))
+		goto fail;
+
+	/* NSCodec is only used for natural image content, keep chroma at full resolution */
+	if (!nsc_context_set_parameters(encoder->nsc, NSC_COLOR_LOSS_LEVEL, 1) ||
+	    !nsc_context_set_parameters(encoder->nsc, NSC_ALLOW_SUBSAMPLING, FALSE))
+		goto fail;
+
+	return encoder;
+fail:
+	clear_encoder_free(encoder);
+	return NULL;
 }
 
 BOOL clear_context_reset(CLEAR_CONTEXT* WINPR_RESTRICT clear)
@@ -1183,6 +1979,14 @@ CLEAR_CONTEXT* clear_context_new(BOOL Compressor)
 	clear->Compressor = Compressor;
 	clear->nsc = nsc_context_new();
 
+	if (Compressor)
+	{
+		clear->encoder = clear_encoder_new();
+
+		if (!clear->encoder)
+			goto error_nsc;
+	}
+
 	if (!clear->nsc)
 		goto error_nsc;
 
@@ -1213,6 +2017,7 @@ void clear_context_free(CLEAR_CONTEXT* WINPR_RESTRICT clear)
 		return;
 
 	nsc_context_free(clear->nsc);
+	clear_encoder_free(clear->encoder);
 	winpr_aligned_free(clear->TempBuffer);
 
 	clear_reset_vbar_storage(clear, TRUE);
@@ -31,18 +31,22 @@
 #include <freerdp/freerdp.h>
 #include <freerdp/primitives.h>
 
-#if defined(WITH_CAIRO)
-#include <cairo.h>
-#endif
-
-#if defined(WITH_SWSCALE)
-#include <libswscale/swscale.h>
-#endif
-
 #include "color.h"
 
 #define TAG FREERDP_TAG("color")
 
+/* Scaling weights are 14 bit fixed point */
+#define FREERDP_IMAGE_SCALER_ONE (1 << 14)
+
+typedef struct
+{
+	UINT32 srcSize;
+	UINT32 dstSize;
+	UINT32 taps;     /* source pixels per destination pixel */
+	UINT32* offsets; /* first source pixel, dstSize entries */
+	INT16* weights;  /* dstSize * taps entries */
+} FREERDP_IMAGE_SCALER_AXIS;
+
 static BOOL freerdp_image_copy_from_pointer_data_int(
     BYTE* WINPR_RESTRICT pDstData, UINT32 DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT xorMask, UINT32 xorMaskLength,
@@ -1159,35 +1163,232 @@ BOOL freerdp_image_fill_ex(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT3
 	return freerdp_image_fill(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, color);
 }
 
-#if defined(WITH_SWSCALE)
-static int av_format_for_buffer(UINT32 format)
+struct S_FREERDP_IMAGE_SCALER
+{
+	primitives_t* prims;
+	FREERDP_IMAGE_SCALER_AXIS horizontal;
+	FREERDP_IMAGE_SCALER_AXIS vertical;
+
+	BYTE* source; /* source converted to a supported format */
+	size_t sourceSize;
+	BYTE* temp; /* horizontally scaled source lines */
+	size_t tempSize;
+	BYTE* line; /* destination line awaiting format conversion */
+	size_t lineSize;
+	const BYTE** rows;
+	UINT32 rowsCount;
+};
+
+/* Formats with 8 bit channels, scaled channel by channel */
+static BOOL scaler_format_supported(UINT32 format)
 {
 	switch (format)
 	{
 		case PIXEL_FORMAT_ARGB32:
-			return AV_PIX_FMT_BGRA;
-
 		case PIXEL_FORMAT_XRGB32:
-			return AV_PIX_FMT_BGR0;
-
+		case PIXEL_FORMAT_ABGR32:
+		case PIXEL_FORMAT_XBGR32:
 		case PIXEL_FORMAT_BGRA32:
-			return AV_PIX_FMT_RGBA;
-
 		case PIXEL_FORMAT_BGRX32:
-			return AV_PIX_FMT_RGB0;
-
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			return TRUE;
 		default:
-			return AV_PIX_FMT_NONE;
+			return FALSE;
 	}
 }
-#endif
 
-BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
-                         UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
-                         const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
-                         UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth, UINT32 nSrcHeight)
+static BOOL scaler_ensure_buffer(BYTE** pbuffer, size_t* psize, size_t size)
+{
+	WINPR_ASSERT(pbuffer);
+	WINPR_ASSERT(psize);
+
+	if (*psize >= size)
+		return TRUE;
+
+	winpr_aligned_free(*pbuffer);
+	*pbuffer = winpr_aligned_malloc(size, 32);
+	*psize = *pbuffer ? size : 0;
+	return *pbuffer != NULL;
+}
+
+static void scaler_axis_free(FREERDP_IMAGE_SCALER_AXIS* axis)
+{
+	WINPR_ASSERT(axis);
+
+	free(axis->offsets);
+	free(axis->weights);
+	*axis = (FREERDP_IMAGE_SCALER_AXIS){ 0 };
+}
+
+/* Bilinear interpolation between the two source pixels around the destination pixel center */
+static void scaler_axis_bilinear(FREERDP_IMAGE_SCALER_AXIS* axis)
+{
+	const INT64 src = axis->srcSize;
+	const INT64 dst = axis->dstSize;
+
+	for (UINT32 x = 0; x < axis->dstSize; x++)
+	{
+		INT16* w = &axis->weights[1ULL * x * axis->taps];
+		const INT64 num = (2LL * x + 1) * src - dst;
+		INT64 pos = 0;
+		INT64 frac = 0;
+
+		if (num > 0)
+		{
+			pos = num / (2 * dst);
+			frac = ((num % (2 * dst)) * FREERDP_IMAGE_SCALER_ONE + dst) / (2 * dst);
+		}
+
+		if (axis->taps == 1)
+		{
+			axis->offsets[x] = 0;
+			w[0] = FREERDP_IMAGE_SCALER_ONE;
+		}
+		else if (pos >= src - 1)
+		{
+			axis->offsets[x] = (UINT32)(src - 2);
+			w[0] = 0;
+			w[1] = FREERDP_IMAGE_SCALER_ONE;
+		}
+		else
+		{
+			axis->offsets[x] = (UINT32)pos;
+			w[0] = (INT16)(FREERDP_IMAGE_SCALER_ONE - frac);
+			w[1] = (INT16)frac;
+		}
+	}
+}
+
+/* Box filter, every source pixel is weighted by the part of it covered by the destination pixel */
+static void scaler_axis_area(FREERDP_IMAGE_SCALER_AXIS* axis)
+{
+	const UINT64 src = axis->srcSize;
+	const UINT64 dst = axis->dstSize;
+
+	for (UINT32 x = 0; x < axis->dstSize; x++)
+	{
+		INT16* w = &axis->weights[1ULL * x * axis->taps];
+		const UINT64 begin = x * src;
+		const UINT64 end = begin + src;
+		const UINT64 first = begin / dst;
+		const UINT64 last = (end - 1) / dst;
+		const UINT64 start = MIN(first, src - axis->taps);
+		UINT32 sum = 0;
+		size_t max = 0;
+
+		axis->offsets[x] = (UINT32)start;
+
+		for (UINT64 j = first; j <= last; j++)
+		{
+			const UINT64 overlap = MIN(end, (j + 1) * dst) - MAX(begin, j * dst);
+			const size_t k = (size_t)(j - start);
+
+			w[k] = (INT16)((overlap * FREERDP_IMAGE_SCALER_ONE + src / 2) / src);
+			sum += (UINT32)w[k];
+			if (w[k] > w[max])
+				max = k;
+		}
+
+		/* keep the sum exact so that flat areas stay flat */
+		w[max] = (INT16)(w[max] + (INT32)FREERDP_IMAGE_SCALER_ONE - (INT32)sum);
+	}
+}
+
+static BOOL scaler_axis_update(FREERDP_IMAGE_SCALER_AXIS* axis, UINT32 srcSize, UINT32 dstSize)
 {
-	BOOL rc = FALSE;
+	WINPR_ASSERT(axis);
+	WINPR_ASSERT(srcSize > 0);
+	WINPR_ASSERT(dstSize > 0);
+
+	if ((axis->srcSize == srcSize) && (axis->dstSize == dstSize))
+		return TRUE;
+
+	scaler_axis_free(axis);
+	axis->srcSize = srcSize;
+	axis->dstSize = dstSize;
+
+	if (srcSize == dstSize)
+		axis->taps = 1;
+	else if (dstSize > srcSize)
+		axis->taps = MIN(2, srcSize);
+	else
+	{
+		/* the widest source span covered by a destination pixel */
+		for (UINT32 x = 0; x < dstSize; x++)
+		{
+			const UINT64 first = (1ULL * x * srcSize) / dstSize;
+			const UINT64 last = (1ULL * (x + 1) * srcSize - 1) / dstSize;
+			axis->taps = MAX(axis->taps, (UINT32)(last - first + 1));
+		}
+	}
+
+	axis->offsets = calloc(dstSize, sizeof(UINT32));
+	axis->weights = calloc(1ULL * dstSize * axis->taps, sizeof(INT16));
+
+	if (!axis->offsets || !axis->weights)
+	{
+		scaler_axis_free(axis);
+		return FALSE;
+	}
+
+	if (srcSize == dstSize)
+	{
+		for (UINT32 x = 0; x < dstSize; x++)
+		{
+			axis->offsets[x] = x;
+			axis->weights[x] = FREERDP_IMAGE_SCALER_ONE;
+		}
+	}
+	else if (dstSize > srcSize)
+		scaler_axis_bilinear(axis);
+	else
+		scaler_axis_area(axis);
+
+	return TRUE;
+}
+
+FREERDP_IMAGE_SCALER* freerdp_image_scaler_new(void)
+{
+	FREERDP_IMAGE_SCALER* scaler = calloc(1, sizeof(FREERDP_IMAGE_SCALER));
+
+	if (!scaler)
+		return NULL;
+
+	scaler->prims = primitives_get();
+
+	if (!scaler->prims)
+	{
+		freerdp_image_scaler_free(scaler);
+		return NULL;
+	}
+
+	return scaler;
+}
+
+void freerdp_image_scaler_free(FREERDP_IMAGE_SCALER* scaler)
+{
+	if (!scaler)
+		return;
+
+	scaler_axis_free(&scaler->horizontal);
+	scaler_axis_free(&scaler->vertical);
+	winpr_aligned_free(scaler->source);
+	winpr_aligned_free(scaler->temp);
+	winpr_aligned_free(scaler->line);
+	free((void*)scaler->rows);
+	free(scaler);
+}
+
+BOOL freerdp_image_scaler_scale(FREERDP_IMAGE_SCALER* WINPR_RESTRICT scaler,
+                                BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                                UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+                                const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth,
+                                UINT32 nSrcHeight)
+{
+	if (!scaler || !pDstData || !pSrcData)
+		return FALSE;
 
 	if (nDstStep == 0)
 		nDstStep = nDstWidth * FreeRDPGetBytesPerPixel(DstFormat);
@@ -1195,10 +1396,11 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 	if (nSrcStep == 0)
 		nSrcStep = nSrcWidth * FreeRDPGetBytesPerPixel(SrcFormat);
 
-#if defined(WITH_SWSCALE) || defined(WITH_CAIRO)
-	const BYTE* src = &pSrcData[nXSrc * FreeRDPGetBytesPerPixel(SrcFormat) + nYSrc * nSrcStep];
-	BYTE* dst = &pDstData[nXDst * FreeRDPGetBytesPerPixel(DstFormat) + nYDst * nDstStep];
-#endif
+	if ((nDstWidth == 0) || (nDstHeight == 0))
+		return TRUE;
+
+	if ((nSrcWidth == 0) || (nSrcHeight == 0))
+		return FALSE;
 
 	/* direct copy is much faster than scaling, so check if we can simply copy... */
 	if ((nDstWidth == nSrcWidth) && (nDstHeight == nSrcHeight))
@@ -1207,73 +1409,106 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 		                                     nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc,
 		                                     nYSrc, NULL, FREERDP_FLIP_NONE);
 	}
-	else
-#if defined(WITH_SWSCALE)
+
+	UINT32 format = SrcFormat;
+	UINT32 srcStep = nSrcStep;
+	const BYTE* src = &pSrcData[1ULL * nYSrc * nSrcStep + 4ULL * nXSrc];
+
+	if (!scaler_format_supported(SrcFormat))
 	{
-		int res = 0;
-		struct SwsContext* resize = NULL;
-		int srcFormat = av_format_for_buffer(SrcFormat);
-		int dstFormat = av_format_for_buffer(DstFormat);
-		const int srcStep[1] = { (int)nSrcStep };
-		const int dstStep[1] = { (int)nDstStep };
-
-		if ((srcFormat == AV_PIX_FMT_NONE) || (dstFormat == AV_PIX_FMT_NONE))
-			return FALSE;
+		format = PIXEL_FORMAT_BGRA32;
+		srcStep = nSrcWidth * 4;
 
-		resize = sws_getContext((int)nSrcWidth, (int)nSrcHeight, srcFormat, (int)nDstWidth,
-		                        (int)nDstHeight, dstFormat, SWS_BILINEAR, NULL, NULL, NULL);
+		const size_t size = 1ULL * srcStep * nSrcHeight;
 
-		if (!resize)
-			goto fail;
+		if (!scaler_ensure_buffer(&scaler->source, &scaler->sourceSize, size))
+			return FALSE;
 
-		res = sws_scale(resize, &src, srcStep, 0, (int)nSrcHeight, &dst, dstStep);
-		rc = (res == ((int)nDstHeight));
-	fail:
-		sws_freeContext(resize);
+		if (!freerdp_image_copy_no_overlap(scaler->source, format, srcStep, 0, 0, nSrcWidth,
+		                                   nSrcHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                                   NULL, FREERDP_FLIP_NONE))
+			return FALSE;
+
+		src = scaler->source;
 	}
 
-#elif defined(WITH_CAIRO)
+	if (!scaler_axis_update(&scaler->horizontal, nSrcWidth, nDstWidth) ||
+	    !scaler_axis_update(&scaler->vertical, nSrcHeight, nDstHeight))
+		return FALSE;
+
+	const FREERDP_IMAGE_SCALER_AXIS* h = &scaler->horizontal;
+	const FREERDP_IMAGE_SCALER_AXIS* v = &scaler->vertical;
+	const BYTE* temp = src;
+	UINT32 tempStep = srcStep;
+
+	if (nSrcWidth != nDstWidth)
 	{
-		const double sx = (double)nDstWidth / (double)nSrcWidth;
-		const double sy = (double)nDstHeight / (double)nSrcHeight;
-		cairo_t* cairo_context;
-		cairo_surface_t *csrc, *cdst;
+		tempStep = nDstWidth * 4;
 
-		if ((nSrcWidth > INT_MAX) || (nSrcHeight > INT_MAX) || (nSrcStep > INT_MAX))
+		if (!scaler_ensure_buffer(&scaler->temp, &scaler->tempSize, 1ULL * tempStep * nSrcHeight))
 			return FALSE;
 
-		if ((nDstWidth > INT_MAX) || (nDstHeight > INT_MAX) || (nDstStep > INT_MAX))
+		if (scaler->prims->scaleHorizontal_8u_C4(src, srcStep, scaler->temp, tempStep, nDstWidth,
+		                                         nSrcHeight, h->offsets, h->weights,
+		                                         h->taps) != PRIMITIVES_SUCCESS)
 			return FALSE;
 
-		csrc = cairo_image_surface_create_for_data((void*)src, CAIRO_FORMAT_ARGB32, (int)nSrcWidth,
-		                                           (int)nSrcHeight, (int)nSrcStep);
-		cdst = cairo_image_surface_create_for_data(dst, CAIRO_FORMAT_ARGB32, (int)nDstWidth,
-		                                           (int)nDstHeight, (int)nDstStep);
-
-		if (!csrc || !cdst)
-			goto fail;
-
-		cairo_context = cairo_create(cdst);
-
-		if (!cairo_context)
-			goto fail2;
-
-		cairo_scale(cairo_context, sx, sy);
-		cairo_set_operator(cairo_context, CAIRO_OPERATOR_SOURCE);
-		cairo_set_source_surface(cairo_context, csrc, 0, 0);
-		cairo_paint(cairo_context);
-		rc = TRUE;
-	fail2:
-		cairo_destroy(cairo_context);
-	fail:
-		cairo_surface_destroy(csrc);
-		cairo_surface_destroy(cdst);
+		temp = scaler->temp;
 	}
-#else
+
+	/* the vertical pass writes to the destination directly unless it needs a conversion */
+	const BOOL convert = (DstFormat != format);
+
+	if (convert && !scaler_ensure_buffer(&scaler->line, &scaler->lineSize, 4ULL * nDstWidth))
+		return FALSE;
+
+	if (scaler->rowsCount < v->taps)
 	{
-		WLog_WARN(TAG, "SmartScaling requested but compiled without libcairo support!");
+		free((void*)scaler->rows);
+		scaler->rows = calloc(v->taps, sizeof(BYTE*));
+		scaler->rowsCount = scaler->rows ? v->taps : 0;
+
+		if (!scaler->rows)
+			return FALSE;
 	}
-#endif
+
+	for (UINT32 y = 0; y < nDstHeight; y++)
+	{
+		BYTE* dst = scaler->line;
+
+		if (!convert)
+			dst = &pDstData[1ULL * (nYDst + y) * nDstStep + 4ULL * nXDst];
+
+		for (UINT32 k = 0; k < v->taps; k++)
+			scaler->rows[k] = &temp[1ULL * (v->offsets[y] + k) * tempStep];
+
+		if (scaler->prims->scaleVertical_8u_C4(scaler->rows, &v->weights[1ULL * y * v->taps],
+		                                       v->taps, dst, nDstWidth) != PRIMITIVES_SUCCESS)
+			return FALSE;
+
+		if (convert && !freerdp_image_copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst,
+		                                              nYDst + y, nDstWidth, 1, scaler->line, format,
+		                                              0, 0, 0, NULL, FREERDP_FLIP_NONE))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep,
+                         UINT32 nXDst, UINT32 nYDst, UINT32 nDstWidth, UINT32 nDstHeight,
+                         const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
+                         UINT32 nXSrc, UINT32 nYSrc, UINT32 nSrcWidth, UINT32 nSrcHeight)
+{
+	FREERDP_IMAGE_SCALER* scaler = freerdp_image_scaler_new();
+
+	if (!scaler)
+		return FALSE;
+
+	const BOOL rc = freerdp_image_scaler_scale(scaler, pDstData, DstFormat, nDstStep, nXDst, nYDst,
+	                                           nDstWidth, nDstHeight, pSrcData, SrcFormat, nSrcStep,
+	                                           nXSrc, nYSrc, nSrcWidth, nSrcHeight);
+	freerdp_image_scaler_free(scaler);
 	return rc;
 }
 
@@ -0,0 +1,483 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Shared Codec Executor
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/log.h>
+
+#include "executor.h"
+
+#define TAG FREERDP_TAG("codec.executor")
+
+typedef struct
+{
+	PTP_WORK_CALLBACK callback;
+	void* param;
+} CODEC_WORK_ITEM;
+
+struct S_CODEC_QUEUE
+{
+	/* link in the list of queues with pending work */
+	CODEC_QUEUE* next;
+	BOOL linked;
+
+	/* ring buffer of pending work items */
+	CODEC_WORK_ITEM* items;
+	size_t capacity;
+	size_t head;
+	size_t count;
+
+	/* items submitted but not yet completed, done is signaled when this drops to 0 */
+	size_t outstanding;
+	HANDLE done;
+};
+
+typedef struct
+{
+	CRITICAL_SECTION lock;
+	HANDLE wakeup;
+
+	UINT32 defaultThreads;
+	UINT32 maxThreads;
+	UINT32 idle;
+	UINT32 busy;
+	UINT32 queues;
+
+	/* worker threads are started on demand and stopped with the last queue */
+	HANDLE stop;
+	HANDLE* threads;
+	size_t threadCount;
+
+	/* queues with pending work, served round robin */
+	CODEC_QUEUE* readyHead;
+	CODEC_QUEUE* readyTail;
+
+	UINT64 pending;
+	UINT64 submitted;
+	UINT64 completed;
+	UINT64 callerItems;
+} CODEC_EXECUTOR;
+
+static INIT_ONCE executor_once = INIT_ONCE_STATIC_INIT;
+static BOOL executor_initialized = FALSE;
+static CODEC_EXECUTOR executor = { 0 };
+
+static BOOL CALLBACK codec_executor_init(WINPR_ATTR_UNUSED PINIT_ONCE once,
+                                         WINPR_ATTR_UNUSED PVOID param,
+                                         WINPR_ATTR_UNUSED PVOID* context)
+{
+	SYSTEM_INFO sysinfo = { 0 };
+
+	GetNativeSystemInfo(&sysinfo);
+	executor.defaultThreads = MAX(1, sysinfo.dwNumberOfProcessors);
+	executor.maxThreads = executor.defaultThreads;
+
+	if (!InitializeCriticalSectionAndSpinCount(&executor.lock, 4000))
+		return TRUE;
+
+	executor.wakeup = CreateSemaphore(NULL, 0, INT32_MAX, NULL);
+	if (!executor.wakeup)
+	{
+		DeleteCriticalSection(&executor.lock);
+		return TRUE;
+	}
+
+	executor_initialized = TRUE;
+	return TRUE;
+}
+
+static BOOL codec_executor_ensure(void)
+{
+	if (!InitOnceExecuteOnce(&executor_once, codec_executor_init, NULL, NULL))
+		return FALSE;
+	if (!executor_initialized)
+	{
+		WLog_ERR(TAG, "failed to initialize the codec executor");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* All codec_executor_* and codec_queue_* helpers below are called with executor.lock held */
+static void codec_executor_link(CODEC_QUEUE* queue)
+{
+	WINPR_ASSERT(queue);
+
+	if (queue->linked)
+		return;
+
+	queue->next = NULL;
+	queue->linked = TRUE;
+	if (executor.readyTail)
+		executor.readyTail->next = queue;
+	else
+		executor.readyHead = queue;
+	executor.readyTail = queue;
+}
+
+static void codec_executor_unlink(CODEC_QUEUE* queue)
+{
+	WINPR_ASSERT(queue);
+
+	if (!queue->linked)
+		return;
+
+	CODEC_QUEUE* prev = NULL;
+	for (CODEC_QUEUE* cur = executor.readyHead; cur; prev = cur, cur = cur->next)
+	{
+		if (cur != queue)
+			continue;
+
+		if (prev)
+			prev->next = cur->next;
+		else
+			executor.readyHead = cur->next;
+		if (executor.readyTail == cur)
+			executor.readyTail = prev;
+		break;
+	}
+
+	queue->next = NULL;
+	queue->linked = FALSE;
+}
+
+static BOOL codec_queue_push(CODEC_QUEUE* queue, const CODEC_WORK_ITEM* item)
+{
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(item);
+
+	if (queue->count == queue->capacity)
+	{
+		const size_t capacity = MAX(64, queue->capacity * 2);
+		CODEC_WORK_ITEM* items = calloc(capacity, sizeof(CODEC_WORK_ITEM));
+		if (!items)
+			return FALSE;
+
+		for (size_t x = 0; x < queue->count; x++)
+			items[x] = queue->items[(queue->head + x) % queue->capacity];
+
+		free(queue->items);
+		queue->items = items;
+		queue->capacity = capacity;
+		queue->head = 0;
+	}
+
+	queue->items[(queue->head + queue->count) % queue->capacity] = *item;
+	queue->count++;
+	executor.pending++;
+	return TRUE;
+}
+
+static BOOL codec_queue_pop(CODEC_QUEUE* queue, CODEC_WORK_ITEM* item)
+{
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(item);
+
+	if (queue->count == 0)
+		return FALSE;
+
+	*item = queue->items[queue->head];
+	queue->head = (queue->head + 1) % queue->capacity;
+	queue->count--;
+	executor.pending--;
+	return TRUE;
+}
+
+static void codec_queue_complete(CODEC_QUEUE* queue, BOOL caller)
+{
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(queue->outstanding > 0);
+
+	executor.completed++;
+	if (caller)
+		executor.callerItems++;
+
+	queue->outstanding--;
+	if (queue->outstanding == 0)
+		(void)SetEvent(queue->done);
+}
+
+/* Take one item from the first queue with pending work and move that queue to the end */
+static BOOL codec_executor_next(CODEC_QUEUE** pqueue, CODEC_WORK_ITEM* item)
+{
+	WINPR_ASSERT(pqueue);
+	WINPR_ASSERT(item);
+
+	while (executor.readyHead)
+	{
+		CODEC_QUEUE* queue = executor.readyHead;
+
+		executor.readyHead = queue->next;
+		if (!executor.readyHead)
+			executor.readyTail = NULL;
+		queue->next = NULL;
+		queue->linked = FALSE;
+
+		/* queues drained by a waiting codec thread are dropped from the list here */
+		if (codec_queue_pop(queue, item))
+		{
+			if (queue->count > 0)
+				codec_executor_link(queue);
+			*pqueue = queue;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static DWORD WINAPI codec_executor_thread(LPVOID arg)
+{
+	HANDLE stop = arg;
+	HANDLE handles[] = { stop, executor.wakeup };
+
+	EnterCriticalSection(&executor.lock);
+	while (WaitForSingleObject(stop, 0) != WAIT_OBJECT_0)
+	{
+		CODEC_QUEUE* queue = NULL;
+		CODEC_WORK_ITEM item = { 0 };
+
+		if ((executor.busy < executor.maxThreads) && codec_executor_next(&queue, &item))
+		{
+			executor.busy++;
+			LeaveCriticalSection(&executor.lock);
+			item.callback(NULL, item.param, NULL);
+			EnterCriticalSection(&executor.lock);
+			executor.busy--;
+			codec_queue_complete(queue, FALSE);
+			continue;
+		}
+
+		/* the submitter decrements idle when it releases the semaphore */
+		executor.idle++;
+		LeaveCriticalSection(&executor.lock);
+		const DWORD status = WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE);
+		EnterCriticalSection(&executor.lock);
+
+		if (status == WAIT_FAILED)
+		{
+			WLog_ERR(TAG, "WaitForMultipleObjects failed, stopping worker thread");
+			break;
+		}
+	}
+	LeaveCriticalSection(&executor.lock);
+
+	ExitThread(0);
+	return 0;
+}
+
+static BOOL codec_executor_spawn(void)
+{
+	if (!executor.stop)
+	{
+		executor.stop = CreateEvent(NULL, TRUE, FALSE, NULL);
+		if (!executor.stop)
+			return FALSE;
+	}
+
+	HANDLE* threads = realloc(executor.threads, (executor.threadCount + 1) * sizeof(HANDLE));
+	if (!threads)
+		return FALSE;
+	executor.threads = threads;
+
+	HANDLE thread = CreateThread(NULL, 0, codec_executor_thread, executor.stop, 0, NULL);
+	if (!thread)
+		return FALSE;
+
+	executor.threads[executor.threadCount++] = thread;
+	return TRUE;
+}
+
+/* Wake an idle worker or start a new one if the limit allows it */
+static void codec_executor_wakeup(void)
+{
+	if (executor.idle > 0)
+	{
+		executor.idle--;
+		(void)ReleaseSemaphore(executor.wakeup, 1, NULL);
+	}
+	else if (executor.threadCount < executor.maxThreads)
+	{
+		/* not fatal, the work is done by the thread waiting for the queue */
+		if (!codec_executor_spawn())
+			WLog_WARN(TAG, "failed to start a codec worker thread");
+	}
+}
+
+CODEC_QUEUE* codec_queue_new(void)
+{
+	if (!codec_executor_ensure())
+		return NULL;
+
+	CODEC_QUEUE* queue = calloc(1, sizeof(CODEC_QUEUE));
+	if (!queue)
+		return NULL;
+
+	queue->done = CreateEvent(NULL, TRUE, TRUE, NULL);
+	if (!queue->done)
+	{
+		free(queue);
+		return NULL;
+	}
+
+	EnterCriticalSection(&executor.lock);
+	executor.queues++;
+	LeaveCriticalSection(&executor.lock);
+	return queue;
+}
+
+void codec_queue_free(CODEC_QUEUE* queue)
+{
+	HANDLE stop = NULL;
+	HANDLE* threads = NULL;
+	size_t threadCount = 0;
+
+	if (!queue)
+		return;
+
+	codec_queue_wait(queue);
+
+	EnterCriticalSection(&executor.lock);
+	codec_executor_unlink(queue);
+
+	WINPR_ASSERT(executor.queues > 0);
+	executor.queues--;
+	if (executor.queues == 0)
+	{
+		stop = executor.stop;
+		threads = executor.threads;
+		threadCount = executor.threadCount;
+		executor.stop = NULL;
+		executor.threads = NULL;
+		executor.threadCount = 0;
+		executor.idle = 0;
+	}
+	LeaveCriticalSection(&executor.lock);
+
+	if (stop)
+	{
+		(void)SetEvent(stop);
+		for (size_t x = 0; x < threadCount; x++)
+		{
+			(void)WaitForSingleObject(threads[x], INFINITE);
+			(void)CloseHandle(threads[x]);
+		}
+		(void)CloseHandle(stop);
+	}
+	free((void*)threads);
+
+	(void)CloseHandle(queue->done);
+	free(queue->items);
+	free(queue);
+}
+
+BOOL codec_queue_submit(CODEC_QUEUE* queue, PTP_WORK_CALLBACK callback, void* param)
+{
+	const CODEC_WORK_ITEM item = { callback, param };
+
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(callback);
+
+	EnterCriticalSection(&executor.lock);
+	const BOOL rc = codec_queue_push(queue, &item);
+	if (rc)
+	{
+		if (queue->outstanding++ == 0)
+			(void)ResetEvent(queue->done);
+		executor.submitted++;
+		codec_executor_link(queue);
+		codec_executor_wakeup();
+	}
+	LeaveCriticalSection(&executor.lock);
+
+	return rc;
+}
+
+void codec_queue_wait(CODEC_QUEUE* queue)
+{
+	if (!queue)
+		return;
+
+	/* Run the items no worker picked up yet on this thread, then wait for the remaining ones */
+	EnterCriticalSection(&executor.lock);
+	for (;;)
+	{
+		CODEC_WORK_ITEM item = { 0 };
+
+		if (codec_queue_pop(queue, &item))
+		{
+			LeaveCriticalSection(&executor.lock);
+			item.callback(NULL, item.param, NULL);
+			EnterCriticalSection(&executor.lock);
+			codec_queue_complete(queue, TRUE);
+			continue;
+		}
+
+		if (queue->outstanding == 0)
+			break;
+
+		LeaveCriticalSection(&executor.lock);
+		(void)WaitForSingleObject(queue->done, INFINITE);
+		EnterCriticalSection(&executor.lock);
+	}
+	LeaveCriticalSection(&executor.lock);
+}
+
+BOOL freerdp_codec_executor_set_max_threads(UINT32 count)
+{
+	if (!codec_executor_ensure())
+		return FALSE;
+
+	EnterCriticalSection(&executor.lock);
+	executor.maxThreads = (count > 0) ? count : executor.defaultThreads;
+	LeaveCriticalSection(&executor.lock);
+	return TRUE;
+}
+
+UINT32 freerdp_codec_executor_get_max_threads(void)
+{
+	if (!codec_executor_ensure())
+		return 0;
+
+	EnterCriticalSection(&executor.lock);
+	const UINT32 count = executor.maxThreads;
+	LeaveCriticalSection(&executor.lock);
+	return count;
+}
+
+BOOL freerdp_codec_executor_get_stats(FREERDP_CODEC_EXECUTOR_STATS* stats)
+{
+	if (!stats || !codec_executor_ensure())
+		return FALSE;
+
+	EnterCriticalSection(&executor.lock);
+	stats->MaxThreads = executor.maxThreads;
+	stats->Threads = WINPR_ASSERTING_INT_CAST(UINT32, executor.threadCount);
+	stats->BusyThreads = executor.busy;
+	stats->Queues = executor.queues;
+	stats->PendingItems = executor.pending;
+	stats->SubmittedItems = executor.submitted;
+	stats->CompletedItems = executor.completed;
+	stats->CallerItems = executor.callerItems;
+	LeaveCriticalSection(&executor.lock);
+	return TRUE;
+}
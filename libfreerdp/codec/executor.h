@@ -0,0 +1,43 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Shared Codec Executor
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_EXECUTOR_H
+#define FREERDP_LIB_CODEC_EXECUTOR_H
+
+#include <winpr/pool.h>
+
+#include <freerdp/api.h>
+#include <freerdp/codec/executor.h>
+
+/*
+ * Every threaded codec context owns a CODEC_QUEUE. Work submitted to a queue is executed by the
+ * process wide worker threads, codec_queue_wait runs the remaining items of the queue on the
+ * calling thread and returns once all work submitted to this queue is done. Other queues are
+ * not waited for.
+ */
+typedef struct S_CODEC_QUEUE CODEC_QUEUE;
+
+FREERDP_LOCAL void codec_queue_free(CODEC_QUEUE* queue);
+
+WINPR_ATTR_MALLOC(codec_queue_free, 1)
+FREERDP_LOCAL CODEC_QUEUE* codec_queue_new(void);
+
+FREERDP_LOCAL BOOL codec_queue_submit(CODEC_QUEUE* queue, PTP_WORK_CALLBACK callback,
+                                      void* param);
+FREERDP_LOCAL void codec_queue_wait(CODEC_QUEUE* queue);
+
+#endif /* FREERDP_LIB_CODEC_EXECUTOR_H */
@@ -28,6 +28,11 @@
 #include <freerdp/codec/interleaved.h>
 #include <freerdp/log.h>
 
+#include "interleaved_types.h"
+#include "interleaved_encode.h"
+#include "sse/interleaved_sse2.h"
+#include "neon/interleaved_neon.h"
+
 #define TAG FREERDP_TAG("codec")
 
 #define UNROLL_BODY(_exp, _count)             \
@@ -60,40 +65,10 @@
 		UNROLL_MULTIPLE(_condition, _exp, 1);  \
 	} while (FALSE)
 
-/*
-   RLE Compressed Bitmap Stream (RLE_BITMAP_STREAM)
-   http://msdn.microsoft.com/en-us/library/cc240895%28v=prot.10%29.aspx
-   pseudo-code
-   http://msdn.microsoft.com/en-us/library/dd240593%28v=prot.10%29.aspx
-*/
-
-#define REGULAR_BG_RUN 0x00
-#define MEGA_MEGA_BG_RUN 0xF0
-#define REGULAR_FG_RUN 0x01
-#define MEGA_MEGA_FG_RUN 0xF1
-#define LITE_SET_FG_FG_RUN 0x0C
-#define MEGA_MEGA_SET_FG_RUN 0xF6
-#define LITE_DITHERED_RUN 0x0E
-#define MEGA_MEGA_DITHERED_RUN 0xF8
-#define REGULAR_COLOR_RUN 0x03
-#define MEGA_MEGA_COLOR_RUN 0xF3
-#define REGULAR_FGBG_IMAGE 0x02
-#define MEGA_MEGA_FGBG_IMAGE 0xF2
-#define LITE_SET_FG_FGBG_IMAGE 0x0D
-#define MEGA_MEGA_SET_FGBG_IMAGE 0xF7
-#define REGULAR_COLOR_IMAGE 0x04
-#define MEGA_MEGA_COLOR_IMAGE 0xF4
-#define SPECIAL_FGBG_1 0xF9
-#define SPECIAL_FGBG_2 0xFA
-#define SPECIAL_WHITE 0xFD
-#define SPECIAL_BLACK 0xFE
-
-#define BLACK_PIXEL 0x000000
-
 typedef UINT32 PIXEL;
 
-static const BYTE g_MaskSpecialFgBg1 = 0x03;
-static const BYTE g_MaskSpecialFgBg2 = 0x05;
+static const BYTE g_MaskSpecialFgBg1 = MASK_SPECIAL_FGBG_1;
+static const BYTE g_MaskSpecialFgBg2 = MASK_SPECIAL_FGBG_2;
 
 static const BYTE g_MaskRegularRunLength = 0x1F;
 static const BYTE g_MaskLiteRunLength = 0x0F;
@@ -517,16 +492,6 @@ static INLINE void write_pixel_16(BYTE* _buf, UINT16 _pix)
 #define ENSURE_CAPACITY(_start, _end, _size) ensure_capacity(_start, _end, _size, 3)
 #include "include/bitmap.h"
 
-struct S_BITMAP_INTERLEAVED_CONTEXT
-{
-	BOOL Compressor;
-
-	UINT32 TempSize;
-	BYTE* TempBuffer;
-
-	wStream* bts;
-};
-
 BOOL interleaved_decompress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved,
                             const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize, UINT32 nSrcWidth,
                             UINT32 nSrcHeight, UINT32 bpp, BYTE* WINPR_RESTRICT pDstData,
@@ -643,8 +608,6 @@ BOOL interleaved_compress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved
 {
 	BOOL status = 0;
 	wStream* s = NULL;
-	UINT32 DstFormat = 0;
-	const UINT32 maxSize = 64 * 64 * 4;
 
 	if (!interleaved || !pDstData || !pSrcData)
 		return FALSE;
@@ -667,41 +630,52 @@ BOOL interleaved_compress(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT interleaved
 		return FALSE;
 	}
 
+	if ((bpp != 24) && (bpp != 16) && (bpp != 15))
+		return FALSE;
+
+	/* The encoder works on pixel values stored bottom up after one row of black pixels */
+	UINT32* pixels = &interleaved->Pixels[nWidth];
+	const size_t count = 1ull * nWidth * nHeight;
+	memset(interleaved->Pixels, 0, sizeof(UINT32) * nWidth);
+
+	if (!freerdp_image_copy_no_overlap((BYTE*)pixels, PIXEL_FORMAT_BGRX32, nWidth * 4, 0, 0,
+	                                   nWidth, nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+	                                   palette, FREERDP_FLIP_VERTICAL))
+		return FALSE;
+
+	/* BGRX32 read as UINT32 is 0xXXRRGGBB, reduce it to the wire pixel */
 	switch (bpp)
 	{
 		case 24:
-			DstFormat = PIXEL_FORMAT_BGRX32;
+			for (size_t x = 0; x < count; x++)
+				pixels[x] &= 0x00FFFFFF;
 			break;
 
 		case 16:
-			DstFormat = PIXEL_FORMAT_RGB16;
-			break;
-
-		case 15:
-			DstFormat = PIXEL_FORMAT_RGB15;
+			for (size_t x = 0; x < count; x++)
+			{
+				const UINT32 color = pixels[x];
+				pixels[x] =
+				    ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) | ((color >> 3) & 0x1F);
+			}
 			break;
 
 		default:
-			return FALSE;
+			for (size_t x = 0; x < count; x++)
+			{
+				const UINT32 color = pixels[x];
+				pixels[x] =
+				    ((color >> 9) & 0x7C00) | ((color >> 6) & 0x03E0) | ((color >> 3) & 0x1F);
+			}
+			break;
 	}
 
-	if (!freerdp_image_copy_no_overlap(interleaved->TempBuffer, DstFormat, 0, 0, 0, nWidth, nHeight,
-	                                   pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc, palette,
-	                                   FREERDP_KEEP_DST_ALPHA))
-		return FALSE;
-
 	s = Stream_New(pDstData, *pDstSize);
 
 	if (!s)
 		return FALSE;
 
-	Stream_SetPosition(interleaved->bts, 0);
-
-	if (freerdp_bitmap_compress(interleaved->TempBuffer, nWidth, nHeight, s, bpp, maxSize,
-	                            nHeight - 1, interleaved->bts, 0) < 0)
-		status = FALSE;
-	else
-		status = TRUE;
+	status = interleaved_encode(interleaved, pixels, nWidth, nHeight, bpp, s);
 
 	Stream_SealLength(s);
 	*pDstSize = (UINT32)Stream_Length(s);
@@ -731,10 +705,17 @@ BITMAP_INTERLEAVED_CONTEXT* bitmap_interleaved_context_new(WINPR_ATTR_UNUSED BOO
 		if (!interleaved->TempBuffer)
 			goto fail;
 
-		interleaved->bts = Stream_New(NULL, interleaved->TempSize);
+		interleaved->PixelsSize = (64 + 1) * 64;
+		interleaved->Pixels =
+		    winpr_aligned_calloc(interleaved->PixelsSize, sizeof(UINT32), 16);
 
-		if (!interleaved->bts)
+		if (!interleaved->Pixels)
 			goto fail;
+
+		interleaved->match_run = interleaved_match_run;
+		interleaved->fgbg_run = interleaved_fgbg_run;
+		interleaved_init_sse2(interleaved);
+		interleaved_init_neon(interleaved);
 	}
 
 	return interleaved;
@@ -753,6 +734,6 @@ void bitmap_interleaved_context_free(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT
 		return;
 
 	winpr_aligned_free(interleaved->TempBuffer);
-	Stream_Free(interleaved->bts, TRUE);
+	winpr_aligned_free(interleaved->Pixels);
 	winpr_aligned_free(interleaved);
 }
@@ -0,0 +1,569 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Interleaved RLE Bitmap Encoder
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/cast.h>
+#include <freerdp/config.h>
+
+#include <freerdp/log.h>
+
+#include "interleaved_encode.h"
+
+#define TAG FREERDP_TAG("codec")
+
+#define MASK_REGULAR_RUN_LENGTH 0x1F
+#define MASK_LITE_RUN_LENGTH 0x0F
+
+/* FGBG images are cut where a background or foreground run of this length starts */
+#define INTERLEAVED_MIN_SPLIT_RUN 16
+
+typedef struct
+{
+	BYTE code;     /* REGULAR_*, LITE_* or SPECIAL_* order code */
+	UINT32 length; /* number of pixels covered */
+	UINT32 cost;   /* encoded size in bytes */
+	UINT32 pixelA; /* color, new foreground or first dithered pixel */
+	UINT32 pixelB; /* second dithered pixel */
+} INTERLEAVED_ORDER;
+
+typedef struct
+{
+	const BITMAP_INTERLEAVED_CONTEXT* context;
+	const UINT32* pixels;
+	const UINT32* above;
+	UINT32 width;
+	UINT32 count;
+	UINT32 pixelSize;
+	UINT32 whitePel;
+
+	/* decoder state */
+	UINT32 fgPel;
+	BOOL firstLine;
+	BOOL insertFgPel;
+
+	wStream* s;
+} INTERLEAVED_ENCODER;
+
+UINT32 interleaved_match_run(const UINT32* src, const UINT32* ref, UINT32 xorMask, UINT32 length)
+{
+	UINT32 x = 0;
+
+	while ((x < length) && (src[x] == (ref[x] ^ xorMask)))
+		x++;
+
+	return x;
+}
+
+UINT32 interleaved_fgbg_run(const UINT32* src, const UINT32* ref, UINT32 fgPel, UINT32 length)
+{
+	UINT32 x = 0;
+
+	for (; x < length; x++)
+	{
+		const UINT32 diff = src[x] ^ ref[x];
+
+		if ((diff != 0) && (diff != fgPel))
+			break;
+	}
+
+	return x;
+}
+
+/* length is the run length as transmitted, dithered runs count pixel pairs */
+static UINT32 interleaved_header_size(BYTE code, UINT32 length)
+{
+	switch (code)
+	{
+		case REGULAR_FGBG_IMAGE:
+		case LITE_SET_FG_FGBG_IMAGE:
+		{
+			const UINT32 mask =
+			    (code == REGULAR_FGBG_IMAGE) ? MASK_REGULAR_RUN_LENGTH : MASK_LITE_RUN_LENGTH;
+
+			if (((length % 8) == 0) && ((length / 8) <= mask))
+				return 1;
+
+			return (length <= 256) ? 2 : 3;
+		}
+
+		case LITE_SET_FG_FG_RUN:
+		case LITE_DITHERED_RUN:
+			if (length <= MASK_LITE_RUN_LENGTH)
+				return 1;
+
+			return (length < 16 + 256) ? 2 : 3;
+
+		default:
+			if (length <= MASK_REGULAR_RUN_LENGTH)
+				return 1;
+
+			return (length < 32 + 256) ? 2 : 3;
+	}
+}
+
+static BYTE interleaved_mega_code(BYTE code)
+{
+	switch (code)
+	{
+		case REGULAR_BG_RUN:
+			return MEGA_MEGA_BG_RUN;
+		case REGULAR_FG_RUN:
+			return MEGA_MEGA_FG_RUN;
+		case REGULAR_FGBG_IMAGE:
+			return MEGA_MEGA_FGBG_IMAGE;
+		case REGULAR_COLOR_RUN:
+			return MEGA_MEGA_COLOR_RUN;
+		case REGULAR_COLOR_IMAGE:
+			return MEGA_MEGA_COLOR_IMAGE;
+		case LITE_SET_FG_FG_RUN:
+			return MEGA_MEGA_SET_FG_RUN;
+		case LITE_SET_FG_FGBG_IMAGE:
+			return MEGA_MEGA_SET_FGBG_IMAGE;
+		default:
+			WINPR_ASSERT(code == LITE_DITHERED_RUN);
+			return MEGA_MEGA_DITHERED_RUN;
+	}
+}
+
+static void interleaved_write_header(wStream* WINPR_RESTRICT s, BYTE code, UINT32 length)
+{
+	const BOOL lite = (code >= LITE_SET_FG_FG_RUN);
+	const BOOL fgbg = (code == REGULAR_FGBG_IMAGE) || (code == LITE_SET_FG_FGBG_IMAGE);
+	const BYTE header = WINPR_ASSERTING_INT_CAST(BYTE, code << (lite ? 4 : 5));
+
+	switch (interleaved_header_size(code, length))
+	{
+		case 1:
+			Stream_Write_UINT8(s,
+			                   header | WINPR_ASSERTING_INT_CAST(BYTE, fgbg ? length / 8 : length));
+			break;
+
+		case 2:
+			Stream_Write_UINT8(s, header);
+
+			if (fgbg)
+				Stream_Write_UINT8(s, WINPR_ASSERTING_INT_CAST(BYTE, length - 1));
+			else
+				Stream_Write_UINT8(s, WINPR_ASSERTING_INT_CAST(BYTE, length - (lite ? 16 : 32)));
+			break;
+
+		default:
+			Stream_Write_UINT8(s, interleaved_mega_code(code));
+			Stream_Write_UINT16(s, WINPR_ASSERTING_INT_CAST(UINT16, length));
+			break;
+	}
+}
+
+static void interleaved_write_pixel(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 pixel)
+{
+	Stream_Write_UINT16(enc->s, (UINT16)(pixel & 0xFFFF));
+
+	if (enc->pixelSize == 3)
+		Stream_Write_UINT8(enc->s, WINPR_ASSERTING_INT_CAST(BYTE, pixel >> 16));
+}
+
+static BYTE interleaved_fgbg_mask(const UINT32* WINPR_RESTRICT cur,
+                                  const UINT32* WINPR_RESTRICT above, UINT32 count)
+{
+	BYTE mask = 0;
+
+	for (UINT32 x = 0; x < count; x++)
+	{
+		if (cur[x] != above[x])
+			mask |= (BYTE)(1u << x);
+	}
+
+	return mask;
+}
+
+/* The decoder leaves first line mode at the first order starting past the first scanline */
+static void interleaved_order_start(INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index)
+{
+	if (enc->firstLine && (index >= enc->width))
+	{
+		enc->firstLine = FALSE;
+		enc->insertFgPel = FALSE;
+	}
+}
+
+static INT32 interleaved_order_gain(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc,
+                                    const INTERLEAVED_ORDER* WINPR_RESTRICT order)
+{
+	return WINPR_ASSERTING_INT_CAST(INT32, order->length * enc->pixelSize) -
+	       WINPR_ASSERTING_INT_CAST(INT32, order->cost);
+}
+
+static void interleaved_select(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc,
+                               INTERLEAVED_ORDER* WINPR_RESTRICT best,
+                               const INTERLEAVED_ORDER* WINPR_RESTRICT candidate)
+{
+	if (candidate->length == 0)
+		return;
+
+	if ((best->length == 0) ||
+	    (interleaved_order_gain(enc, candidate) > interleaved_order_gain(enc, best)))
+		*best = *candidate;
+}
+
+/* Shorten a FGBG image so that long background or foreground runs get their own order */
+static UINT32 interleaved_fgbg_trim(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index,
+                                    UINT32 length, UINT32 fgPel)
+{
+	const UINT32* cur = &enc->pixels[index];
+	const UINT32* above = &enc->above[index];
+
+	for (UINT32 x = 8; x + INTERLEAVED_MIN_SPLIT_RUN <= length; x += 8)
+	{
+		const UINT32 diff = cur[x] ^ above[x];
+
+		if ((diff != 0) && (diff != fgPel))
+			continue;
+
+		if (enc->context->match_run(&cur[x], &above[x], diff, length - x) >=
+		    INTERLEAVED_MIN_SPLIT_RUN)
+			return x;
+	}
+
+	return length;
+}
+
+static void interleaved_find_fgbg(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index,
+                                  UINT32 lineRemaining, UINT32 bgLength,
+                                  INTERLEAVED_ORDER* WINPR_RESTRICT best)
+{
+	const BITMAP_INTERLEAVED_CONTEXT* context = enc->context;
+	const UINT32* cur = &enc->pixels[index];
+	const UINT32* above = &enc->above[index];
+	UINT32 length = context->fgbg_run(cur, above, enc->fgPel, lineRemaining);
+
+	length = interleaved_fgbg_trim(enc, index, length, enc->fgPel);
+
+	if (length > 0)
+	{
+		const INTERLEAVED_ORDER order = {
+			REGULAR_FGBG_IMAGE, length,
+			interleaved_header_size(REGULAR_FGBG_IMAGE, length) + (length + 7) / 8, 0, 0
+		};
+		interleaved_select(enc, best, &order);
+	}
+
+	if (length >= 8)
+	{
+		const BYTE mask = interleaved_fgbg_mask(cur, above, 8);
+
+		if ((mask == MASK_SPECIAL_FGBG_1) || (mask == MASK_SPECIAL_FGBG_2))
+		{
+			const INTERLEAVED_ORDER order = {
+				(mask == MASK_SPECIAL_FGBG_1) ? SPECIAL_FGBG_1 : SPECIAL_FGBG_2, 8, 1, 0, 0
+			};
+			interleaved_select(enc, best, &order);
+		}
+	}
+
+	/* the first pixel that is not background determines the new foreground color */
+	if (bgLength < lineRemaining)
+	{
+		const UINT32 fgPel = cur[bgLength] ^ above[bgLength];
+
+		if (fgPel != enc->fgPel)
+		{
+			length = context->fgbg_run(cur, above, fgPel, lineRemaining);
+			length = interleaved_fgbg_trim(enc, index, length, fgPel);
+
+			const INTERLEAVED_ORDER order = { LITE_SET_FG_FGBG_IMAGE, length,
+				                              interleaved_header_size(LITE_SET_FG_FGBG_IMAGE,
+				                                                      length) +
+				                                  enc->pixelSize + (length + 7) / 8,
+				                              fgPel, 0 };
+			interleaved_select(enc, best, &order);
+		}
+	}
+}
+
+/**
+ * Pick the order saving the most bytes at index compared to literal pixels.
+ * Returns FALSE if the pixel is better appended to a color image.
+ *
+ * The scanners are only called when the next pixels can start a run worth an order, inside
+ * color images most positions are rejected without leaving this function.
+ */
+static BOOL interleaved_find_order(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index,
+                                   BOOL literal, INTERLEAVED_ORDER* WINPR_RESTRICT best)
+{
+	const BITMAP_INTERLEAVED_CONTEXT* context = enc->context;
+	const UINT32* cur = &enc->pixels[index];
+	const UINT32* above = &enc->above[index];
+	const UINT32 pixelSize = enc->pixelSize;
+	const UINT32 fgPel = enc->fgPel;
+	const UINT32 remaining = MIN(enc->count - index, UINT16_MAX);
+	/* orders referring to the previous scanline must not leave the first one */
+	const UINT32 lineRemaining =
+	    (index < enc->width) ? MIN(enc->width - index, remaining) : remaining;
+	/* a pending color image resets the background run state */
+	const BOOL insertFgPel =
+	    !literal && enc->insertFgPel && !(enc->firstLine && (index >= enc->width));
+	const UINT32 diff = cur[0] ^ above[0];
+	const UINT32 nextDiff = (lineRemaining > 1) ? cur[1] ^ above[1] : diff ^ 1;
+	UINT32 plainBgLength = 0;
+	UINT32 bgLength = 0;
+	UINT32 fgLength = 0;
+
+	*best = (INTERLEAVED_ORDER){ 0 };
+
+	if (diff == 0)
+		plainBgLength = context->match_run(cur, above, 0, lineRemaining);
+
+	/* a background run following another one starts with an implicit foreground pixel */
+	if (!insertFgPel)
+		bgLength = plainBgLength;
+	else if (diff == fgPel)
+		bgLength = 1 + context->match_run(&cur[1], &above[1], 0, lineRemaining - 1);
+
+	if (bgLength > 0)
+	{
+		const INTERLEAVED_ORDER order = {
+			REGULAR_BG_RUN, bgLength, interleaved_header_size(REGULAR_BG_RUN, bgLength), 0, 0
+		};
+		interleaved_select(enc, best, &order);
+	}
+
+	if (diff == fgPel)
+	{
+		fgLength = context->match_run(cur, above, fgPel, lineRemaining);
+
+		const INTERLEAVED_ORDER order = {
+			REGULAR_FG_RUN, fgLength, interleaved_header_size(REGULAR_FG_RUN, fgLength), 0, 0
+		};
+		interleaved_select(enc, best, &order);
+	}
+	else if ((diff != 0) && (nextDiff == diff))
+	{
+		const UINT32 length = context->match_run(cur, above, diff, lineRemaining);
+		const INTERLEAVED_ORDER order = {
+			LITE_SET_FG_FG_RUN, length,
+			interleaved_header_size(LITE_SET_FG_FG_RUN, length) + pixelSize, diff, 0
+		};
+		interleaved_select(enc, best, &order);
+	}
+
+	if ((remaining > 1) && (cur[1] == cur[0]))
+	{
+		const UINT32 length = 2 + context->match_run(&cur[2], &cur[1], 0, remaining - 2);
+		const INTERLEAVED_ORDER order = {
+			REGULAR_COLOR_RUN, length,
+			interleaved_header_size(REGULAR_COLOR_RUN, length) + pixelSize, cur[0], 0
+		};
+		interleaved_select(enc, best, &order);
+	}
+
+	if ((cur[0] == BLACK_PIXEL) || (cur[0] == enc->whitePel))
+	{
+		const INTERLEAVED_ORDER order = {
+			(cur[0] == BLACK_PIXEL) ? SPECIAL_BLACK : SPECIAL_WHITE, 1, 1, 0, 0
+		};
+		interleaved_select(enc, best, &order);
+	}
+
+	if ((remaining >= 4) && (cur[0] != cur[1]) && (cur[2] == cur[0]) && (cur[3] == cur[1]))
+	{
+		const UINT32 pairs = (4 + context->match_run(&cur[4], &cur[2], 0, remaining - 4)) / 2;
+		const INTERLEAVED_ORDER order = {
+			LITE_DITHERED_RUN, pairs * 2,
+			interleaved_header_size(LITE_DITHERED_RUN, pairs) + 2 * pixelSize, cur[0], cur[1]
+		};
+		interleaved_select(enc, best, &order);
+	}
+
+	/* a FGBG image needs at least two pixels of background or a single foreground */
+	if ((bgLength < INTERLEAVED_MIN_SPLIT_RUN) && (fgLength < INTERLEAVED_MIN_SPLIT_RUN) &&
+	    (lineRemaining > 1) && ((nextDiff == 0) || (nextDiff == diff) || (diff == 0)))
+		interleaved_find_fgbg(enc, index, lineRemaining, plainBgLength, best);
+
+	if (best->length == 0)
+		return FALSE;
+
+	/* splitting a color image costs another order header */
+	return interleaved_order_gain(enc, best) >= (literal ? 1 : 0);
+}
+
+static void interleaved_write_fgbg(const INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index,
+                                   UINT32 length)
+{
+	const UINT32* cur = &enc->pixels[index];
+	const UINT32* above = &enc->above[index];
+
+	for (UINT32 x = 0; x < length; x += 8)
+		Stream_Write_UINT8(enc->s, interleaved_fgbg_mask(&cur[x], &above[x], MIN(8, length - x)));
+}
+
+static BOOL interleaved_write_order(INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index,
+                                    const INTERLEAVED_ORDER* WINPR_RESTRICT order)
+{
+	wStream* s = enc->s;
+
+	interleaved_order_start(enc, index);
+
+	if (!Stream_CheckAndLogRequiredCapacity(TAG, s, order->cost))
+		return FALSE;
+
+	switch (order->code)
+	{
+		case SPECIAL_FGBG_1:
+		case SPECIAL_FGBG_2:
+		case SPECIAL_WHITE:
+		case SPECIAL_BLACK:
+			Stream_Write_UINT8(s, order->code);
+			break;
+
+		case LITE_DITHERED_RUN:
+			interleaved_write_header(s, order->code, order->length / 2);
+			interleaved_write_pixel(enc, order->pixelA);
+			interleaved_write_pixel(enc, order->pixelB);
+			break;
+
+		case REGULAR_COLOR_RUN:
+			interleaved_write_header(s, order->code, order->length);
+			interleaved_write_pixel(enc, order->pixelA);
+			break;
+
+		case LITE_SET_FG_FG_RUN:
+			interleaved_write_header(s, order->code, order->length);
+			interleaved_write_pixel(enc, order->pixelA);
+			enc->fgPel = order->pixelA;
+			break;
+
+		case LITE_SET_FG_FGBG_IMAGE:
+			interleaved_write_header(s, order->code, order->length);
+			interleaved_write_pixel(enc, order->pixelA);
+			enc->fgPel = order->pixelA;
+			interleaved_write_fgbg(enc, index, order->length);
+			break;
+
+		case REGULAR_FGBG_IMAGE:
+			interleaved_write_header(s, order->code, order->length);
+			interleaved_write_fgbg(enc, index, order->length);
+			break;
+
+		default:
+			interleaved_write_header(s, order->code, order->length);
+			break;
+	}
+
+	enc->insertFgPel = (order->code == REGULAR_BG_RUN);
+	return TRUE;
+}
+
+static BOOL interleaved_write_color_image(INTERLEAVED_ENCODER* WINPR_RESTRICT enc, UINT32 index,
+                                          UINT32 length)
+{
+	const size_t cost =
+	    interleaved_header_size(REGULAR_COLOR_IMAGE, length) + 1ull * length * enc->pixelSize;
+
+	interleaved_order_start(enc, index);
+
+	if (!Stream_CheckAndLogRequiredCapacity(TAG, enc->s, cost))
+		return FALSE;
+
+	interleaved_write_header(enc->s, REGULAR_COLOR_IMAGE, length);
+
+	for (UINT32 x = 0; x < length; x++)
+		interleaved_write_pixel(enc, enc->pixels[index + x]);
+
+	enc->insertFgPel = FALSE;
+	return TRUE;
+}
+
+BOOL interleaved_encode(const BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT context,
+                        const UINT32* WINPR_RESTRICT pixels, UINT32 width, UINT32 height,
+                        UINT32 bpp, wStream* WINPR_RESTRICT s)
+{
+	INTERLEAVED_ENCODER enc = { 0 };
+	UINT32 literal = 0;
+	UINT32 index = 0;
+
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(context->match_run);
+	WINPR_ASSERT(context->fgbg_run);
+	WINPR_ASSERT(pixels);
+	WINPR_ASSERT(s);
+
+	if ((width == 0) || (height > UINT32_MAX / width))
+		return FALSE;
+
+	switch (bpp)
+	{
+		case 24:
+			enc.pixelSize = 3;
+			enc.whitePel = 0xFFFFFF;
+			break;
+
+		case 16:
+		case 15:
+			enc.pixelSize = 2;
+			enc.whitePel = 0xFFFF;
+			break;
+
+		default:
+			WLog_ERR(TAG, "Invalid color depth %" PRIu32 "", bpp);
+			return FALSE;
+	}
+
+	enc.context = context;
+	enc.pixels = pixels;
+	enc.above = pixels - width;
+	enc.width = width;
+	enc.count = width * height;
+	enc.fgPel = enc.whitePel;
+	enc.firstLine = TRUE;
+	enc.s = s;
+
+	while (index < enc.count)
+	{
+		INTERLEAVED_ORDER order = { 0 };
+
+		if (!interleaved_find_order(&enc, index, literal > 0, &order))
+		{
+			index++;
+			literal++;
+
+			if (literal == UINT16_MAX)
+			{
+				if (!interleaved_write_color_image(&enc, index - literal, literal))
+					return FALSE;
+
+				literal = 0;
+			}
+
+			continue;
+		}
+
+		if ((literal > 0) && !interleaved_write_color_image(&enc, index - literal, literal))
+			return FALSE;
+
+		literal = 0;
+
+		if (!interleaved_write_order(&enc, index, &order))
+			return FALSE;
+
+		index += order.length;
+	}
+
+	if (literal > 0)
+		return interleaved_write_color_image(&enc, index - literal, literal);
+
+	return TRUE;
+}
@@ -0,0 +1,41 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Interleaved RLE Bitmap Encoder
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_INTERLEAVED_ENCODE_H
+#define FREERDP_LIB_CODEC_INTERLEAVED_ENCODE_H
+
+#include <freerdp/api.h>
+
+#include "interleaved_types.h"
+
+/**
+ * Encode an image as RLE_BITMAP_STREAM.
+ *
+ * pixels points to the first pixel of the bottom up image, the width pixels before it must be
+ * black so that the first scanline can be handled like any other.
+ */
+FREERDP_LOCAL BOOL interleaved_encode(const BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT context,
+                                      const UINT32* WINPR_RESTRICT pixels, UINT32 width,
+                                      UINT32 height, UINT32 bpp, wStream* WINPR_RESTRICT s);
+
+/* Generic run scanners, also used by the SIMD implementations for tails */
+FREERDP_LOCAL UINT32 interleaved_match_run(const UINT32* src, const UINT32* ref, UINT32 xorMask,
+                                           UINT32 length);
+FREERDP_LOCAL UINT32 interleaved_fgbg_run(const UINT32* src, const UINT32* ref, UINT32 fgPel,
+                                          UINT32 length);
+
+#endif /* FREERDP_LIB_CODEC_INTERLEAVED_ENCODE_H */
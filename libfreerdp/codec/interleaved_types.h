@@ -0,0 +1,86 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Interleaved RLE Bitmap Codec
+ *
+ * Copyright 2014 Marc-Andre Moreau <marcandre.moreau@gmail.com>
+ * Copyright 2015 Thincast Technologies GmbH
+ * Copyright 2015 DI (FH) Martin Haimberger <martin.haimberger@thincast.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_INTERLEAVED_TYPES_H
+#define FREERDP_LIB_CODEC_INTERLEAVED_TYPES_H
+
+#include <freerdp/config.h>
+
+#include <winpr/wtypes.h>
+#include <winpr/stream.h>
+
+#include <freerdp/codec/interleaved.h>
+
+/*
+   RLE Compressed Bitmap Stream (RLE_BITMAP_STREAM)
+   http://msdn.microsoft.com/en-us/library/cc240895%28v=prot.10%29.aspx
+   pseudo-code
+   http://msdn.microsoft.com/en-us/library/dd240593%28v=prot.10%29.aspx
+*/
+
+#define REGULAR_BG_RUN 0x00
+#define MEGA_MEGA_BG_RUN 0xF0
+#define REGULAR_FG_RUN 0x01
+#define MEGA_MEGA_FG_RUN 0xF1
+#define LITE_SET_FG_FG_RUN 0x0C
+#define MEGA_MEGA_SET_FG_RUN 0xF6
+#define LITE_DITHERED_RUN 0x0E
+#define MEGA_MEGA_DITHERED_RUN 0xF8
+#define REGULAR_COLOR_RUN 0x03
+#define MEGA_MEGA_COLOR_RUN 0xF3
+#define REGULAR_FGBG_IMAGE 0x02
+#define MEGA_MEGA_FGBG_IMAGE 0xF2
+#define LITE_SET_FG_FGBG_IMAGE 0x0D
+#define MEGA_MEGA_SET_FGBG_IMAGE 0xF7
+#define REGULAR_COLOR_IMAGE 0x04
+#define MEGA_MEGA_COLOR_IMAGE 0xF4
+#define SPECIAL_FGBG_1 0xF9
+#define SPECIAL_FGBG_2 0xFA
+#define SPECIAL_WHITE 0xFD
+#define SPECIAL_BLACK 0xFE
+
+#define BLACK_PIXEL 0x000000
+
+#define MASK_SPECIAL_FGBG_1 0x03
+#define MASK_SPECIAL_FGBG_2 0x05
+
+/* Number of leading pixels with src[x] == (ref[x] ^ xorMask) */
+typedef UINT32 (*interleaved_match_run_fn_t)(const UINT32* src, const UINT32* ref, UINT32 xorMask,
+                                             UINT32 length);
+/* Number of leading pixels with src[x] == ref[x] or src[x] == (ref[x] ^ fgPel) */
+typedef UINT32 (*interleaved_fgbg_run_fn_t)(const UINT32* src, const UINT32* ref, UINT32 fgPel,
+                                            UINT32 length);
+
+struct S_BITMAP_INTERLEAVED_CONTEXT
+{
+	BOOL Compressor;
+
+	UINT32 TempSize;
+	BYTE* TempBuffer;
+
+	UINT32* Pixels; /* encoder input, one row of black pixels followed by the bottom up image */
+	UINT32 PixelsSize;
+
+	interleaved_match_run_fn_t match_run;
+	interleaved_fgbg_run_fn_t fgbg_run;
+};
+
+#endif /* FREERDP_LIB_CODEC_INTERLEAVED_TYPES_H */
@@ -27,11 +27,14 @@
 
 #include <freerdp/log.h>
 #include "mppc.h"
+#include "bulk_match.h"
 
 #define TAG FREERDP_TAG("codec.mppc")
 
 //#define DEBUG_MPPC	1
 
+#define MPPC_HISTORY_BUFFER_SIZE 65536
+
 #define MPPC_MATCH_INDEX(_sym1, _sym2, _sym3)                             \
 	((((MPPC_MATCH_TABLE[_sym3] << 16) + (MPPC_MATCH_TABLE[_sym2] << 8) + \
 	   MPPC_MATCH_TABLE[_sym1]) &                                         \
@@ -45,9 +48,13 @@ struct s_MPPC_CONTEXT
 	ALIGN64 BYTE* HistoryPtr;
 	ALIGN64 UINT32 HistoryOffset;
 	ALIGN64 UINT32 HistoryBufferSize;
-	ALIGN64 BYTE HistoryBuffer[65536];
+	ALIGN64 BYTE HistoryBuffer[MPPC_HISTORY_BUFFER_SIZE];
 	ALIGN64 UINT16 MatchBuffer[32768];
 	ALIGN64 UINT32 CompressionLevel;
+	ALIGN64 UINT16* MatchChain; /* previous position with the same hash, compressor only */
+	ALIGN64 UINT32 MaxChainLength;
+	ALIGN64 BOOL LazyMatching;
+	bulk_match_length_fn_t MatchLength;
 };
 
 static const UINT32 MPPC_MATCH_TABLE[256] = {
@@ -432,31 +439,268 @@ int mppc_decompress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize,
 	return 1;
 }
 
+static void mppc_write_literal(wBitStream* WINPR_RESTRICT bs, BYTE Literal)
+{
+#if defined(DEBUG_MPPC)
+	WLog_DBG(TAG, "%" PRIu8 "", Literal);
+#endif
+
+	if (Literal < 0x80)
+	{
+		/* 8 bits of literal are encoded as-is */
+		BitStream_Write_Bits(bs, Literal, 8);
+	}
+	else
+	{
+		/* bits 10 followed by lower 7 bits of literal */
+		BitStream_Write_Bits(bs, 0x100 | (Literal & 0x7F), 9);
+	}
+}
+
+static void mppc_write_match(wBitStream* WINPR_RESTRICT bs, UINT32 CompressionLevel,
+                             UINT32 CopyOffset, UINT32 LengthOfMatch)
+{
+	UINT32 accumulator = 0;
+
+#if defined(DEBUG_MPPC)
+	WLog_DBG(TAG, "<%" PRIu32 ",%" PRIu32 ">", CopyOffset, LengthOfMatch);
+#endif
+
+	/* Encode CopyOffset */
+
+	if (CompressionLevel) /* RDP5 */
+	{
+		if (CopyOffset < 64)
+		{
+			/* bits 11111 + lower 6 bits of CopyOffset */
+			accumulator = 0x07C0 | (CopyOffset & 0x003F);
+			BitStream_Write_Bits(bs, accumulator, 11);
+		}
+		else if ((CopyOffset >= 64) && (CopyOffset < 320))
+		{
+			/* bits 11110 + lower 8 bits of (CopyOffset - 64) */
+			accumulator = 0x1E00 | ((CopyOffset - 64) & 0x00FF);
+			BitStream_Write_Bits(bs, accumulator, 13);
+		}
+		else if ((CopyOffset >= 320) && (CopyOffset < 2368))
+		{
+			/* bits 1110 + lower 11 bits of (CopyOffset - 320) */
+			accumulator = 0x7000 | ((CopyOffset - 320) & 0x07FF);
+			BitStream_Write_Bits(bs, accumulator, 15);
+		}
+		else
+		{
+			/* bits 110 + lower 16 bits of (CopyOffset - 2368) */
+			accumulator = 0x060000 | ((CopyOffset - 2368) & 0xFFFF);
+			BitStream_Write_Bits(bs, accumulator, 19);
+		}
+	}
+	else /* RDP4 */
+	{
+		if (CopyOffset < 64)
+		{
+			/* bits 1111 + lower 6 bits of CopyOffset */
+			accumulator = 0x03C0 | (CopyOffset & 0x003F);
+			BitStream_Write_Bits(bs, accumulator, 10);
+		}
+		else if ((CopyOffset >= 64) && (CopyOffset < 320))
+		{
+			/* bits 1110 + lower 8 bits of (CopyOffset - 64) */
+			accumulator = 0x0E00 | ((CopyOffset - 64) & 0x00FF);
+			BitStream_Write_Bits(bs, accumulator, 12);
+		}
+		else if ((CopyOffset >= 320) && (CopyOffset < 8192))
+		{
+			/* bits 110 + lower 13 bits of (CopyOffset - 320) */
+			accumulator = 0xC000 | ((CopyOffset - 320) & 0x1FFF);
+			BitStream_Write_Bits(bs, accumulator, 16);
+		}
+	}
+
+	/* Encode LengthOfMatch */
+
+	if (LengthOfMatch == 3)
+	{
+		/* 0 + 0 lower bits of LengthOfMatch */
+		BitStream_Write_Bits(bs, 0, 1);
+	}
+	else if ((LengthOfMatch >= 4) && (LengthOfMatch < 8))
+	{
+		/* 10 + 2 lower bits of LengthOfMatch */
+		accumulator = 0x0008 | (LengthOfMatch & 0x0003);
+		BitStream_Write_Bits(bs, accumulator, 4);
+	}
+	else if ((LengthOfMatch >= 8) && (LengthOfMatch < 16))
+	{
+		/* 110 + 3 lower bits of LengthOfMatch */
+		accumulator = 0x0030 | (LengthOfMatch & 0x0007);
+		BitStream_Write_Bits(bs, accumulator, 6);
+	}
+	else if ((LengthOfMatch >= 16) && (LengthOfMatch < 32))
+	{
+		/* 1110 + 4 lower bits of LengthOfMatch */
+		accumulator = 0x00E0 | (LengthOfMatch & 0x000F);
+		BitStream_Write_Bits(bs, accumulator, 8);
+	}
+	else if ((LengthOfMatch >= 32) && (LengthOfMatch < 64))
+	{
+		/* 11110 + 5 lower bits of LengthOfMatch */
+		accumulator = 0x03C0 | (LengthOfMatch & 0x001F);
+		BitStream_Write_Bits(bs, accumulator, 10);
+	}
+	else if ((LengthOfMatch >= 64) && (LengthOfMatch < 128))
+	{
+		/* 111110 + 6 lower bits of LengthOfMatch */
+		accumulator = 0x0F80 | (LengthOfMatch & 0x003F);
+		BitStream_Write_Bits(bs, accumulator, 12);
+	}
+	else if ((LengthOfMatch >= 128) && (LengthOfMatch < 256))
+	{
+		/* 1111110 + 7 lower bits of LengthOfMatch */
+		accumulator = 0x3F00 | (LengthOfMatch & 0x007F);
+		BitStream_Write_Bits(bs, accumulator, 14);
+	}
+	else if ((LengthOfMatch >= 256) && (LengthOfMatch < 512))
+	{
+		/* 11111110 + 8 lower bits of LengthOfMatch */
+		accumulator = 0xFE00 | (LengthOfMatch & 0x00FF);
+		BitStream_Write_Bits(bs, accumulator, 16);
+	}
+	else if ((LengthOfMatch >= 512) && (LengthOfMatch < 1024))
+	{
+		/* 111111110 + 9 lower bits of LengthOfMatch */
+		accumulator = 0x3FC00 | (LengthOfMatch & 0x01FF);
+		BitStream_Write_Bits(bs, accumulator, 18);
+	}
+	else if ((LengthOfMatch >= 1024) && (LengthOfMatch < 2048))
+	{
+		/* 1111111110 + 10 lower bits of LengthOfMatch */
+		accumulator = 0xFF800 | (LengthOfMatch & 0x03FF);
+		BitStream_Write_Bits(bs, accumulator, 20);
+	}
+	else if ((LengthOfMatch >= 2048) && (LengthOfMatch < 4096))
+	{
+		/* 11111111110 + 11 lower bits of LengthOfMatch */
+		accumulator = 0x3FF000 | (LengthOfMatch & 0x07FF);
+		BitStream_Write_Bits(bs, accumulator, 22);
+	}
+	else if ((LengthOfMatch >= 4096) && (LengthOfMatch < 8192))
+	{
+		/* 111111111110 + 12 lower bits of LengthOfMatch */
+		accumulator = 0xFFE000 | (LengthOfMatch & 0x0FFF);
+		BitStream_Write_Bits(bs, accumulator, 24);
+	}
+	else if (((LengthOfMatch >= 8192) && (LengthOfMatch < 16384)) && CompressionLevel) /* RDP5 */
+	{
+		/* 1111111111110 + 13 lower bits of LengthOfMatch */
+		accumulator = 0x3FFC000 | (LengthOfMatch & 0x1FFF);
+		BitStream_Write_Bits(bs, accumulator, 26);
+	}
+	else if (((LengthOfMatch >= 16384) && (LengthOfMatch < 32768)) && CompressionLevel) /* RDP5 */
+	{
+		/* 11111111111110 + 14 lower bits of LengthOfMatch */
+		accumulator = 0xFFF8000 | (LengthOfMatch & 0x3FFF);
+		BitStream_Write_Bits(bs, accumulator, 28);
+	}
+	else if (((LengthOfMatch >= 32768) && (LengthOfMatch < 65536)) && CompressionLevel) /* RDP5 */
+	{
+		/* 111111111111110 + 15 lower bits of LengthOfMatch */
+		accumulator = 0x3FFF0000 | (LengthOfMatch & 0x7FFF);
+		BitStream_Write_Bits(bs, accumulator, 30);
+	}
+}
+
+static inline UINT32 mppc_hash(const BYTE* WINPR_RESTRICT data)
+{
+	return MPPC_MATCH_INDEX(data[0], data[1], data[2]);
+}
+
+/* Position 0 is never inserted, an empty chain entry is 0 */
+static inline void mppc_hash_insert(MPPC_CONTEXT* WINPR_RESTRICT mppc, UINT32 position)
+{
+	const UINT32 index = mppc_hash(&mppc->HistoryBuffer[position]);
+
+	mppc->MatchChain[position] = mppc->MatchBuffer[index];
+	mppc->MatchBuffer[index] = (UINT16)position;
+}
+
+/* Undo the insertions of [first, last) in reverse order, restoring the previous chain heads */
+static void mppc_hash_remove(MPPC_CONTEXT* WINPR_RESTRICT mppc, UINT32 first, UINT32 last)
+{
+	while (last > first)
+	{
+		last--;
+		mppc->MatchBuffer[mppc_hash(&mppc->HistoryBuffer[last])] = mppc->MatchChain[last];
+	}
+}
+
+/**
+ * Walk the hash chain of position for the longest match within [position, end).
+ *
+ * Chain entries are only trusted while they point strictly backwards: heads left behind by a
+ * discarded packet or by the history before the last PACKET_AT_FRONT may point anywhere.
+ * Everything before position is known to the decompressor, so any such candidate is valid.
+ */
+static UINT32 mppc_find_match(const MPPC_CONTEXT* WINPR_RESTRICT mppc, UINT32 position,
+                              UINT32 end, UINT32* WINPR_RESTRICT pCopyOffset)
+{
+	UINT32 bestLength = 0;
+	UINT32 previous = position;
+	const BYTE* HistoryBuffer = mppc->HistoryBuffer;
+	const UINT32 maxLength = MIN(end - position, mppc->CompressionLevel ? 65535 : 8191);
+	UINT32 candidate = mppc->MatchBuffer[mppc_hash(&HistoryBuffer[position])];
+
+	for (UINT32 chain = 0; (chain < mppc->MaxChainLength) && (candidate != 0); chain++)
+	{
+		if (candidate >= previous)
+			break;
+
+		const UINT32 CopyOffset = position - candidate;
+
+		if (CopyOffset >= mppc->HistoryBufferSize)
+			break;
+
+		/* a candidate can only improve if it matches the byte after the best length */
+		if (HistoryBuffer[candidate + bestLength] == HistoryBuffer[position + bestLength])
+		{
+			const UINT32 length =
+			    mppc->MatchLength(&HistoryBuffer[candidate], &HistoryBuffer[position], maxLength);
+
+			if (length > bestLength)
+			{
+				bestLength = length;
+				*pCopyOffset = CopyOffset;
+
+				if (length == maxLength)
+					break;
+			}
+		}
+
+		previous = candidate;
+		candidate = mppc->MatchChain[candidate];
+	}
+
+	if (bestLength < 3)
+		return 0;
+
+	return bestLength;
+}
+
 int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE* pDstBuffer,
                   const BYTE** ppDstData, UINT32* pDstSize, UINT32* pFlags)
 {
-	const BYTE* pSrcPtr = NULL;
-	const BYTE* pSrcEnd = NULL;
-	BYTE* MatchPtr = NULL;
 	UINT32 DstSize = 0;
-	BYTE* pDstData = NULL;
-	UINT32 MatchIndex = 0;
-	UINT32 accumulator = 0;
-	BOOL PacketFlushed = 0;
-	BOOL PacketAtFront = 0;
-	DWORD CopyOffset = 0;
-	DWORD LengthOfMatch = 0;
+	BOOL PacketFlushed = FALSE;
+	BOOL PacketAtFront = FALSE;
 	BYTE* HistoryBuffer = NULL;
-	BYTE* HistoryPtr = NULL;
 	UINT32 HistoryOffset = 0;
 	UINT32 HistoryBufferSize = 0;
-	BYTE Sym1 = 0;
-	BYTE Sym2 = 0;
-	BYTE Sym3 = 0;
 	UINT32 CompressionLevel = 0;
 	wBitStream* bs = NULL;
 
 	WINPR_ASSERT(mppc);
+	WINPR_ASSERT(mppc->Compressor);
+	WINPR_ASSERT(mppc->MatchChain);
 	WINPR_ASSERT(pSrcData);
 	WINPR_ASSERT(pDstBuffer);
 	WINPR_ASSERT(ppDstData);
@@ -473,7 +717,15 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 	CompressionLevel = mppc->CompressionLevel;
 	HistoryOffset = mppc->HistoryOffset;
 	*pFlags = 0;
-	PacketFlushed = FALSE;
+	*ppDstData = pDstBuffer;
+
+	/* does not fit the history at all, send it as is and keep the history untouched */
+	if ((SrcSize + 3) >= HistoryBufferSize)
+	{
+		*ppDstData = pSrcData;
+		*pDstSize = SrcSize;
+		return 1;
+	}
 
 	if (((HistoryOffset + SrcSize) < (HistoryBufferSize - 3)) && HistoryOffset)
 	{
@@ -488,278 +740,64 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 		PacketAtFront = TRUE;
 	}
 
-	HistoryPtr = &(HistoryBuffer[HistoryOffset]);
-	pDstData = pDstBuffer;
-	*ppDstData = pDstBuffer;
-
-	if (!pDstData)
-		return -1;
-
 	if (*pDstSize > SrcSize)
 		DstSize = SrcSize;
 	else
 		DstSize = *pDstSize;
 
-	BitStream_Attach(bs, pDstData, DstSize);
-	pSrcPtr = pSrcData;
-	pSrcEnd = &(pSrcData[SrcSize - 1]);
-
-	while (pSrcPtr < (pSrcEnd - 2))
-	{
-		Sym1 = pSrcPtr[0];
-		Sym2 = pSrcPtr[1];
-		Sym3 = pSrcPtr[2];
-		*HistoryPtr++ = *pSrcPtr++;
-		MatchIndex = MPPC_MATCH_INDEX(Sym1, Sym2, Sym3);
-		MatchPtr = &(HistoryBuffer[mppc->MatchBuffer[MatchIndex]]);
+	BitStream_Attach(bs, pDstBuffer, DstSize);
+	CopyMemory(&HistoryBuffer[HistoryOffset], pSrcData, SrcSize);
 
-		if (MatchPtr != (HistoryPtr - 1))
-			mppc->MatchBuffer[MatchIndex] = (UINT16)(HistoryPtr - HistoryBuffer);
+	const UINT32 end = HistoryOffset + SrcSize;
+	UINT32 position = HistoryOffset;
+	UINT32 inserted = HistoryOffset;
 
-		if (mppc->HistoryPtr < HistoryPtr)
-			mppc->HistoryPtr = HistoryPtr;
-
-		if ((Sym1 != *(MatchPtr - 1)) || (Sym2 != MatchPtr[0]) || (Sym3 != MatchPtr[1]) ||
-		    (&MatchPtr[1] > mppc->HistoryPtr) || (MatchPtr == HistoryBuffer) ||
-		    (MatchPtr == (HistoryPtr - 1)) || (MatchPtr == HistoryPtr))
-		{
-			if (((bs->position / 8) + 2) > (DstSize - 1))
-			{
-				mppc_context_reset(mppc, TRUE);
-				*pFlags |= PACKET_FLUSHED;
-				*pFlags |= CompressionLevel;
-				*ppDstData = pSrcData;
-				*pDstSize = SrcSize;
-				return 1;
-			}
-
-			accumulator = Sym1;
-#if defined(DEBUG_MPPC)
-			WLog_DBG(TAG, "%" PRIu32 "", accumulator);
-#endif
+	while (position < end)
+	{
+		UINT32 CopyOffset = 0;
+		UINT32 LengthOfMatch = 0;
 
-			if (accumulator < 0x80)
-			{
-				/* 8 bits of literal are encoded as-is */
-				BitStream_Write_Bits(bs, accumulator, 8);
-			}
-			else
-			{
-				/* bits 10 followed by lower 7 bits of literal */
-				accumulator = 0x100 | (accumulator & 0x7F);
-				BitStream_Write_Bits(bs, accumulator, 9);
-			}
-		}
-		else
+		if ((position + 3) <= end)
 		{
-			CopyOffset = (HistoryBufferSize - 1) & (HistoryPtr - MatchPtr);
-			*HistoryPtr++ = Sym2;
-			*HistoryPtr++ = Sym3;
-			pSrcPtr += 2;
-			LengthOfMatch = 3;
-			MatchPtr += 2;
+			LengthOfMatch = mppc_find_match(mppc, position, end, &CopyOffset);
 
-			while ((*pSrcPtr == *MatchPtr) && (pSrcPtr < pSrcEnd) && (MatchPtr <= mppc->HistoryPtr))
-			{
-				MatchPtr++;
-				*HistoryPtr++ = *pSrcPtr++;
-				LengthOfMatch++;
-			}
-
-#if defined(DEBUG_MPPC)
-			WLog_DBG(TAG, "<%" PRIu32 ",%" PRIu32 ">", CopyOffset, LengthOfMatch);
-#endif
-
-			/* Encode CopyOffset */
-
-			if (((bs->position / 8) + 7) > (DstSize - 1))
-			{
-				mppc_context_reset(mppc, TRUE);
-				*pFlags |= PACKET_FLUSHED;
-				*pFlags |= CompressionLevel;
-				*ppDstData = pSrcData;
-				*pDstSize = SrcSize;
-				return 1;
-			}
+			if (position > 0)
+				mppc_hash_insert(mppc, position);
+			inserted = position + 1;
 
-			if (CompressionLevel) /* RDP5 */
-			{
-				if (CopyOffset < 64)
-				{
-					/* bits 11111 + lower 6 bits of CopyOffset */
-					accumulator = 0x07C0 | (CopyOffset & 0x003F);
-					BitStream_Write_Bits(bs, accumulator, 11);
-				}
-				else if ((CopyOffset >= 64) && (CopyOffset < 320))
-				{
-					/* bits 11110 + lower 8 bits of (CopyOffset - 64) */
-					accumulator = 0x1E00 | ((CopyOffset - 64) & 0x00FF);
-					BitStream_Write_Bits(bs, accumulator, 13);
-				}
-				else if ((CopyOffset >= 320) && (CopyOffset < 2368))
-				{
-					/* bits 1110 + lower 11 bits of (CopyOffset - 320) */
-					accumulator = 0x7000 | ((CopyOffset - 320) & 0x07FF);
-					BitStream_Write_Bits(bs, accumulator, 15);
-				}
-				else
-				{
-					/* bits 110 + lower 16 bits of (CopyOffset - 2368) */
-					accumulator = 0x060000 | ((CopyOffset - 2368) & 0xFFFF);
-					BitStream_Write_Bits(bs, accumulator, 19);
-				}
-			}
-			else /* RDP4 */
+			if ((LengthOfMatch > 0) && mppc->LazyMatching && ((position + 4) <= end))
 			{
-				if (CopyOffset < 64)
-				{
-					/* bits 1111 + lower 6 bits of CopyOffset */
-					accumulator = 0x03C0 | (CopyOffset & 0x003F);
-					BitStream_Write_Bits(bs, accumulator, 10);
-				}
-				else if ((CopyOffset >= 64) && (CopyOffset < 320))
-				{
-					/* bits 1110 + lower 8 bits of (CopyOffset - 64) */
-					accumulator = 0x0E00 | ((CopyOffset - 64) & 0x00FF);
-					BitStream_Write_Bits(bs, accumulator, 12);
-				}
-				else if ((CopyOffset >= 320) && (CopyOffset < 8192))
-				{
-					/* bits 110 + lower 13 bits of (CopyOffset - 320) */
-					accumulator = 0xC000 | ((CopyOffset - 320) & 0x1FFF);
-					BitStream_Write_Bits(bs, accumulator, 16);
-				}
-			}
-
-			/* Encode LengthOfMatch */
+				UINT32 NextCopyOffset = 0;
+				const UINT32 NextLengthOfMatch =
+				    mppc_find_match(mppc, position + 1, end, &NextCopyOffset);
 
-			if (LengthOfMatch == 3)
-			{
-				/* 0 + 0 lower bits of LengthOfMatch */
-				BitStream_Write_Bits(bs, 0, 1);
-			}
-			else if ((LengthOfMatch >= 4) && (LengthOfMatch < 8))
-			{
-				/* 10 + 2 lower bits of LengthOfMatch */
-				accumulator = 0x0008 | (LengthOfMatch & 0x0003);
-				BitStream_Write_Bits(bs, accumulator, 4);
-			}
-			else if ((LengthOfMatch >= 8) && (LengthOfMatch < 16))
-			{
-				/* 110 + 3 lower bits of LengthOfMatch */
-				accumulator = 0x0030 | (LengthOfMatch & 0x0007);
-				BitStream_Write_Bits(bs, accumulator, 6);
-			}
-			else if ((LengthOfMatch >= 16) && (LengthOfMatch < 32))
-			{
-				/* 1110 + 4 lower bits of LengthOfMatch */
-				accumulator = 0x00E0 | (LengthOfMatch & 0x000F);
-				BitStream_Write_Bits(bs, accumulator, 8);
-			}
-			else if ((LengthOfMatch >= 32) && (LengthOfMatch < 64))
-			{
-				/* 11110 + 5 lower bits of LengthOfMatch */
-				accumulator = 0x03C0 | (LengthOfMatch & 0x001F);
-				BitStream_Write_Bits(bs, accumulator, 10);
-			}
-			else if ((LengthOfMatch >= 64) && (LengthOfMatch < 128))
-			{
-				/* 111110 + 6 lower bits of LengthOfMatch */
-				accumulator = 0x0F80 | (LengthOfMatch & 0x003F);
-				BitStream_Write_Bits(bs, accumulator, 12);
-			}
-			else if ((LengthOfMatch >= 128) && (LengthOfMatch < 256))
-			{
-				/* 1111110 + 7 lower bits of LengthOfMatch */
-				accumulator = 0x3F00 | (LengthOfMatch & 0x007F);
-				BitStream_Write_Bits(bs, accumulator, 14);
-			}
-			else if ((LengthOfMatch >= 256) && (LengthOfMatch < 512))
-			{
-				/* 11111110 + 8 lower bits of LengthOfMatch */
-				accumulator = 0xFE00 | (LengthOfMatch & 0x00FF);
-				BitStream_Write_Bits(bs, accumulator, 16);
-			}
-			else if ((LengthOfMatch >= 512) && (LengthOfMatch < 1024))
-			{
-				/* 111111110 + 9 lower bits of LengthOfMatch */
-				accumulator = 0x3FC00 | (LengthOfMatch & 0x01FF);
-				BitStream_Write_Bits(bs, accumulator, 18);
-			}
-			else if ((LengthOfMatch >= 1024) && (LengthOfMatch < 2048))
-			{
-				/* 1111111110 + 10 lower bits of LengthOfMatch */
-				accumulator = 0xFF800 | (LengthOfMatch & 0x03FF);
-				BitStream_Write_Bits(bs, accumulator, 20);
-			}
-			else if ((LengthOfMatch >= 2048) && (LengthOfMatch < 4096))
-			{
-				/* 11111111110 + 11 lower bits of LengthOfMatch */
-				accumulator = 0x3FF000 | (LengthOfMatch & 0x07FF);
-				BitStream_Write_Bits(bs, accumulator, 22);
-			}
-			else if ((LengthOfMatch >= 4096) && (LengthOfMatch < 8192))
-			{
-				/* 111111111110 + 12 lower bits of LengthOfMatch */
-				accumulator = 0xFFE000 | (LengthOfMatch & 0x0FFF);
-				BitStream_Write_Bits(bs, accumulator, 24);
-			}
-			else if (((LengthOfMatch >= 8192) && (LengthOfMatch < 16384)) &&
-			         CompressionLevel) /* RDP5 */
-			{
-				/* 1111111111110 + 13 lower bits of LengthOfMatch */
-				accumulator = 0x3FFC000 | (LengthOfMatch & 0x1FFF);
-				BitStream_Write_Bits(bs, accumulator, 26);
-			}
-			else if (((LengthOfMatch >= 16384) && (LengthOfMatch < 32768)) &&
-			         CompressionLevel) /* RDP5 */
-			{
-				/* 11111111111110 + 14 lower bits of LengthOfMatch */
-				accumulator = 0xFFF8000 | (LengthOfMatch & 0x3FFF);
-				BitStream_Write_Bits(bs, accumulator, 28);
-			}
-			else if (((LengthOfMatch >= 32768) && (LengthOfMatch < 65536)) &&
-			         CompressionLevel) /* RDP5 */
-			{
-				/* 111111111111110 + 15 lower bits of LengthOfMatch */
-				accumulator = 0x3FFF0000 | (LengthOfMatch & 0x7FFF);
-				BitStream_Write_Bits(bs, accumulator, 30);
+				if (NextLengthOfMatch > LengthOfMatch + 1)
+					LengthOfMatch = 0;
 			}
 		}
-	}
 
-	/* Encode trailing symbols as literals */
+		/* a match takes at most 49 bits */
+		if (((bs->position / 8) + (LengthOfMatch ? 7 : 2)) > (DstSize - 1))
+			goto no_compression;
 
-	while (pSrcPtr <= pSrcEnd)
-	{
-		if (((bs->position / 8) + 2) > (DstSize - 1))
+		if (LengthOfMatch == 0)
 		{
-			mppc_context_reset(mppc, TRUE);
-			*pFlags |= PACKET_FLUSHED;
-			*pFlags |= CompressionLevel;
-			*ppDstData = pSrcData;
-			*pDstSize = SrcSize;
-			return 1;
+			mppc_write_literal(bs, HistoryBuffer[position++]);
+			continue;
 		}
 
-		accumulator = *pSrcPtr;
-#if defined(DEBUG_MPPC)
-		WLog_DBG(TAG, "%" PRIu32 "", accumulator);
-#endif
+		mppc_write_match(bs, CompressionLevel, CopyOffset, LengthOfMatch);
 
-		if (accumulator < 0x80)
+		for (UINT32 x = 1; x < LengthOfMatch; x++)
 		{
-			/* 8 bits of literal are encoded as-is */
-			BitStream_Write_Bits(bs, accumulator, 8);
-		}
-		else
-		{
-			/* bits 10 followed by lower 7 bits of literal */
-			accumulator = 0x100 | (accumulator & 0x7F);
-			BitStream_Write_Bits(bs, accumulator, 9);
+			if ((position + x + 3) > end)
+				break;
+
+			mppc_hash_insert(mppc, position + x);
+			inserted = position + x + 1;
 		}
 
-		*HistoryPtr++ = *pSrcPtr++;
+		position += LengthOfMatch;
 	}
 
 	BitStream_Flush(bs);
@@ -773,11 +811,30 @@ int mppc_compress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize, BYTE
 		*pFlags |= PACKET_FLUSHED;
 
 	*pDstSize = ((bs->position + 7) / 8);
-	mppc->HistoryPtr = HistoryPtr;
-	const intptr_t diff = HistoryPtr - HistoryBuffer;
-	if (diff > UINT32_MAX)
-		return -1;
-	mppc->HistoryOffset = (UINT32)diff;
+	mppc->HistoryPtr = &HistoryBuffer[end];
+	mppc->HistoryOffset = end;
+	return 1;
+
+no_compression:
+	if (PacketAtFront)
+	{
+		/* the packet already replaced history the decompressor still has, start over */
+		mppc_context_reset(mppc, TRUE);
+		*pFlags |= PACKET_FLUSHED;
+		*pFlags |= CompressionLevel;
+	}
+	else
+	{
+		/**
+		 * The packet was only appended behind the history of the decompressor, which ignores
+		 * uncompressed packets. Dropping it from the hash chains keeps both sides in sync
+		 * without the cost of a flush.
+		 */
+		mppc_hash_remove(mppc, HistoryOffset, inserted);
+	}
+
+	*ppDstData = pSrcData;
+	*pDstSize = SrcSize;
 	return 1;
 }
 
@@ -797,6 +854,32 @@ void mppc_set_compression_level(MPPC_CONTEXT* mppc, DWORD CompressionLevel)
 	}
 }
 
+BOOL mppc_set_compression_effort(MPPC_CONTEXT* mppc, BULK_COMPRESSION_EFFORT effort)
+{
+	WINPR_ASSERT(mppc);
+
+	switch (effort)
+	{
+		case BULK_COMPRESSION_EFFORT_FAST:
+			mppc->MaxChainLength = 1;
+			mppc->LazyMatching = FALSE;
+			break;
+		case BULK_COMPRESSION_EFFORT_DEFAULT:
+			mppc->MaxChainLength = 8;
+			mppc->LazyMatching = TRUE;
+			break;
+		case BULK_COMPRESSION_EFFORT_MAX:
+			mppc->MaxChainLength = 256;
+			mppc->LazyMatching = TRUE;
+			break;
+		default:
+			WLog_ERR(TAG, "invalid compression effort %d", effort);
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 void mppc_context_reset(MPPC_CONTEXT* mppc, BOOL flush)
 {
 	WINPR_ASSERT(mppc);
@@ -841,6 +924,16 @@ MPPC_CONTEXT* mppc_context_new(DWORD CompressionLevel, BOOL Compressor)
 	if (!mppc->bs)
 		goto fail;
 
+	if (Compressor)
+	{
+		mppc->MatchChain = calloc(MPPC_HISTORY_BUFFER_SIZE, sizeof(UINT16));
+
+		if (!mppc->MatchChain)
+			goto fail;
+	}
+
+	mppc->MatchLength = bulk_match_length_get();
+	(void)mppc_set_compression_effort(mppc, BULK_COMPRESSION_EFFORT_DEFAULT);
 	mppc_context_reset(mppc, FALSE);
 
 	return mppc;
@@ -850,11 +943,21 @@ fail:
 	return NULL;
 }
 
+size_t mppc_context_memory_size(BOOL Compressor)
+{
+	size_t size = sizeof(MPPC_CONTEXT);
+
+	if (Compressor)
+		size += sizeof(UINT16) * MPPC_HISTORY_BUFFER_SIZE;
+	return size;
+}
+
 void mppc_context_free(MPPC_CONTEXT* mppc)
 {
 	if (mppc)
 	{
 		BitStream_Free(mppc->bs);
+		free(mppc->MatchChain);
 		free(mppc);
 	}
 }
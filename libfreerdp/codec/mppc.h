@@ -42,11 +42,19 @@ extern "C"
 
 	FREERDP_LOCAL void mppc_set_compression_level(MPPC_CONTEXT* mppc, DWORD CompressionLevel);
 
+	/* Only affects the compressor, the output is understood by every decompressor */
+	FREERDP_LOCAL BOOL mppc_set_compression_effort(MPPC_CONTEXT* mppc,
+	                                               BULK_COMPRESSION_EFFORT effort);
+
 	FREERDP_LOCAL void mppc_context_reset(MPPC_CONTEXT* mppc, BOOL flush);
 
-	FREERDP_LOCAL MPPC_CONTEXT* mppc_context_new(DWORD CompressionLevel, BOOL Compressor);
+	FREERDP_LOCAL size_t mppc_context_memory_size(BOOL Compressor);
+
 	FREERDP_LOCAL void mppc_context_free(MPPC_CONTEXT* mppc);
 
+	WINPR_ATTR_MALLOC(mppc_context_free, 1)
+	FREERDP_LOCAL MPPC_CONTEXT* mppc_context_new(DWORD CompressionLevel, BOOL Compressor);
+
 #ifdef __cplusplus
 }
 #endif
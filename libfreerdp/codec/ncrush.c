@@ -31,9 +31,13 @@
 #include <freerdp/types.h>
 
 #include "ncrush.h"
+#include "bulk_match.h"
 
 #define TAG FREERDP_TAG("codec")
 
+/* LengthOfMatch - 2 is encoded with at most 14 bits */
+#define NCRUSH_MAX_MATCH_LENGTH (16383 + 2)
+
 struct s_NCRUSH_CONTEXT
 {
 	ALIGN64 BOOL Compressor;
@@ -48,6 +52,10 @@ struct s_NCRUSH_CONTEXT
 	ALIGN64 UINT16 MatchTable[65536];
 	ALIGN64 BYTE HuffTableCopyOffset[1024];
 	ALIGN64 BYTE HuffTableLOM[4096];
+	ALIGN64 UINT32 MaxChainLength;
+	ALIGN64 UINT32 NiceMatchLength;
+	ALIGN64 BOOL LazyMatching;
+	bulk_match_length_fn_t MatchLength;
 };
 
 static const UINT16 HuffTableLEC[8192] = {
@@ -2342,142 +2350,72 @@ static int ncrush_hash_table_add(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, U
 	return 1;
 }
 
-static intptr_t ncrush_find_match_length(const BYTE* Ptr1, const BYTE* Ptr2, const BYTE* HistoryPtr)
+/* Undo ncrush_hash_table_add in reverse order, restoring the previous chain heads */
+static void ncrush_hash_table_remove(NCRUSH_CONTEXT* ncrush, UINT32 SrcSize, UINT32 HistoryOffset)
 {
-	BYTE val1 = 0;
-	BYTE val2 = 0;
-	const BYTE* Ptr = Ptr1;
-
-	WINPR_ASSERT(Ptr1);
-	WINPR_ASSERT(Ptr2);
-	WINPR_ASSERT(HistoryPtr);
+	UINT32 Offset = HistoryOffset + SrcSize - 8;
 
-	do
-	{
-		if (Ptr1 > HistoryPtr)
-			break;
+	WINPR_ASSERT(ncrush);
+	WINPR_ASSERT(HistoryOffset + SrcSize >= 8);
 
-		val1 = *Ptr1++;
-		val2 = *Ptr2++;
-	} while (val1 == val2);
+	const BYTE* HistoryBuffer = ncrush->HistoryBuffer;
 
-	return Ptr1 - (Ptr + 1);
+	while (Offset > HistoryOffset)
+	{
+		Offset--;
+		ncrush->HashTable[get_word(&HistoryBuffer[Offset])] = ncrush->MatchTable[Offset];
+	}
 }
 
-static int ncrush_find_best_match(NCRUSH_CONTEXT* ncrush, UINT16 HistoryOffset,
-                                  UINT32* pMatchOffset)
+/**
+ * Walk the chain of previous occurrences of the word at HistoryOffset for the longest match
+ * within [HistoryOffset, EndOffset).
+ *
+ * Chain entries are only trusted while they point strictly backwards: the last bytes of a packet
+ * are never added and tables left behind by a discarded packet may point anywhere. Everything
+ * before HistoryOffset is known to the decompressor, so any such candidate is valid.
+ */
+static UINT32 ncrush_find_best_match(const NCRUSH_CONTEXT* ncrush, UINT32 HistoryOffset,
+                                     UINT32 EndOffset, UINT32* pMatchOffset)
 {
-	int Length = 0;
+	UINT32 MatchLength = 0;
+	UINT32 Previous = HistoryOffset;
 
 	WINPR_ASSERT(ncrush);
 	WINPR_ASSERT(pMatchOffset);
 
-	if (!ncrush->MatchTable[HistoryOffset])
-		return -1;
+	const BYTE* HistoryBuffer = ncrush->HistoryBuffer;
+	const UINT32 MaxLength = MIN(EndOffset - HistoryOffset, NCRUSH_MAX_MATCH_LENGTH);
+	UINT32 Offset = ncrush->MatchTable[HistoryOffset];
 
-	int MatchLength = 2;
-	UINT16 Offset = HistoryOffset;
-	BYTE* HistoryBuffer = (BYTE*)ncrush->HistoryBuffer;
-
-	ncrush->MatchTable[0] = HistoryOffset;
-	UINT16 MatchOffset = ncrush->MatchTable[HistoryOffset];
-	UINT16 NextOffset = ncrush->MatchTable[Offset];
-	BYTE* MatchPtr = &HistoryBuffer[MatchLength];
-
-	for (int i = 0; i < 4; i++)
+	for (UINT32 chain = 0; (chain < ncrush->MaxChainLength) && (Offset != 0); chain++)
 	{
-		int j = -1;
-
-		if (j < 0)
-		{
-			Offset = ncrush->MatchTable[NextOffset];
-
-			if (MatchPtr[NextOffset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 0;
-		}
-
-		if (j < 0)
-		{
-			NextOffset = ncrush->MatchTable[Offset];
-
-			if (MatchPtr[Offset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 1;
-		}
-
-		if (j < 0)
-		{
-			Offset = ncrush->MatchTable[NextOffset];
-
-			if (MatchPtr[NextOffset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 2;
-		}
-
-		if (j < 0)
-		{
-			NextOffset = ncrush->MatchTable[Offset];
-
-			if (MatchPtr[Offset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 3;
-		}
-
-		if (j < 0)
-		{
-			Offset = ncrush->MatchTable[NextOffset];
-
-			if (MatchPtr[NextOffset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 4;
-		}
-
-		if (j < 0)
-		{
-			NextOffset = ncrush->MatchTable[Offset];
-
-			if (MatchPtr[Offset] == HistoryBuffer[HistoryOffset + MatchLength])
-				j = 5;
-		}
+		if (Offset >= Previous)
+			break;
 
-		if (j >= 0)
+		/* a candidate can only improve if it matches the byte after the best length */
+		if (HistoryBuffer[Offset + MatchLength] == HistoryBuffer[HistoryOffset + MatchLength])
 		{
-			if ((j % 2) == 0)
-				Offset = NextOffset;
+			const UINT32 Length = ncrush->MatchLength(&HistoryBuffer[Offset],
+			                                          &HistoryBuffer[HistoryOffset], MaxLength);
 
-			if ((Offset != HistoryOffset) && Offset)
+			if (Length > MatchLength)
 			{
-				const intptr_t len =
-				    ncrush_find_match_length(&HistoryBuffer[HistoryOffset + 2],
-				                             &HistoryBuffer[Offset + 2], ncrush->HistoryPtr);
-				WINPR_ASSERT(len < INT_MAX - 2);
-				WINPR_ASSERT(len > INT_MIN + 2);
-
-				Length = (int)len + 2;
-
-				if (Length < 2)
-					return -1;
+				MatchLength = Length;
+				*pMatchOffset = Offset;
 
-				if (Length > 16)
+				if ((Length >= ncrush->NiceMatchLength) || (Length == MaxLength))
 					break;
-
-				if (Length > MatchLength)
-				{
-					MatchLength = Length;
-					MatchOffset = Offset;
-				}
-
-				if ((Length <= MatchLength) ||
-				    (&HistoryBuffer[HistoryOffset + 2] < ncrush->HistoryPtr))
-				{
-					NextOffset = ncrush->MatchTable[Offset];
-					MatchPtr = &HistoryBuffer[MatchLength];
-					continue;
-				}
 			}
-
-			break;
 		}
+
+		Previous = Offset;
+		Offset = ncrush->MatchTable[Offset];
 	}
 
-	ncrush->MatchTable[0] = 0;
-	*pMatchOffset = MatchOffset;
+	if (MatchLength < 2)
+		return 0;
+
 	return MatchLength;
 }
 
@@ -2615,7 +2553,12 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 	MatchOffset = 0;
 	const intptr_t thsize = HistoryPtr - HistoryBuffer;
 
-	ncrush_hash_table_add(ncrush, pSrcData, SrcSize, WINPR_ASSERTING_INT_CAST(UINT32, thsize));
+	const UINT32 StartOffset = WINPR_ASSERTING_INT_CAST(UINT32, thsize);
+	const UINT32 EndOffset = StartOffset + SrcSize;
+	UINT32 SavedOffsetCache[4] = { 0 };
+
+	CopyMemory(SavedOffsetCache, OffsetCache, sizeof(SavedOffsetCache));
+	ncrush_hash_table_add(ncrush, pSrcData, SrcSize, StartOffset);
 	CopyMemory(HistoryPtr, pSrcData, SrcSize);
 	ncrush->HistoryPtr = &HistoryPtr[SrcSize];
 
@@ -2633,17 +2576,17 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 		if (HistoryOffset >= 65536)
 			return -1004;
 
-		if (ncrush->MatchTable[HistoryOffset])
-		{
-			int rc = 0;
+		MatchOffset = 0;
+		MatchLength = ncrush_find_best_match(ncrush, HistoryOffset, EndOffset, &MatchOffset);
 
-			MatchOffset = 0;
-			rc = ncrush_find_best_match(ncrush, WINPR_ASSERTING_INT_CAST(UINT16, HistoryOffset),
-			                            &MatchOffset);
+		if ((MatchLength > 0) && ncrush->LazyMatching)
+		{
+			UINT32 NextMatchOffset = 0;
+			const UINT32 NextMatchLength =
+			    ncrush_find_best_match(ncrush, HistoryOffset + 1, EndOffset, &NextMatchOffset);
 
-			if (rc < 0)
-				return -1005;
-			MatchLength = (UINT32)rc;
+			if (NextMatchLength > MatchLength + 1)
+				MatchLength = 0;
 		}
 
 		if (MatchLength)
@@ -2659,14 +2602,7 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 			HistoryPtr++;
 
 			if ((DstPtr + 2) > DstEndPtr) /* PACKET_FLUSH #1 */
-			{
-				ncrush_context_reset(ncrush, TRUE);
-				*pFlags = PACKET_FLUSHED;
-				*pFlags |= CompressionLevel;
-				*ppDstData = pSrcData;
-				*pDstSize = SrcSize;
-				return 1;
-			}
+				goto no_compression;
 
 			IndexLEC = Literal;
 			if (IndexLEC >= ARRAYSIZE(HuffLengthLEC))
@@ -2691,14 +2627,7 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 				return -1007;
 
 			if ((DstPtr + 8) > DstEndPtr) /* PACKET_FLUSH #2 */
-			{
-				ncrush_context_reset(ncrush, TRUE);
-				*pFlags = PACKET_FLUSHED;
-				*pFlags |= CompressionLevel;
-				*ppDstData = pSrcData;
-				*pDstSize = SrcSize;
-				return 1;
-			}
+				goto no_compression;
 
 			OffsetCacheIndex = 5;
 
@@ -2858,14 +2787,7 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 	while (SrcPtr < SrcEndPtr)
 	{
 		if ((DstPtr + 2) > DstEndPtr) /* PACKET_FLUSH #3 */
-		{
-			ncrush_context_reset(ncrush, TRUE);
-			*pFlags = PACKET_FLUSHED;
-			*pFlags |= CompressionLevel;
-			*ppDstData = pSrcData;
-			*pDstSize = SrcSize;
-			return 1;
-		}
+			goto no_compression;
 
 		Literal = *SrcPtr++;
 		HistoryPtr++;
@@ -2884,14 +2806,7 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 	}
 
 	if ((DstPtr + 4) >= DstEndPtr) /* PACKET_FLUSH #4 */
-	{
-		ncrush_context_reset(ncrush, TRUE);
-		*pFlags = PACKET_FLUSHED;
-		*pFlags |= CompressionLevel;
-		*ppDstData = pSrcData;
-		*pDstSize = SrcSize;
-		return 1;
-	}
+		goto no_compression;
 
 	IndexLEC = 256;
 	BitLength = HuffLengthLEC[IndexLEC];
@@ -2929,6 +2844,31 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 		return -1;
 
 	return 1;
+
+no_compression:
+	if (PacketAtFront || PacketFlushed)
+	{
+		/* the history no longer matches the one of the decompressor, start over */
+		ncrush_context_reset(ncrush, TRUE);
+		*pFlags = PACKET_FLUSHED;
+		*pFlags |= CompressionLevel;
+	}
+	else
+	{
+		/**
+		 * The packet was only appended behind the history of the decompressor, which ignores
+		 * uncompressed packets. Dropping it again keeps both sides in sync without a flush.
+		 */
+		ncrush_hash_table_remove(ncrush, SrcSize, StartOffset);
+		CopyMemory(OffsetCache, SavedOffsetCache, sizeof(SavedOffsetCache));
+		ncrush->HistoryOffset = StartOffset;
+		ncrush->HistoryPtr = &HistoryBuffer[StartOffset];
+		*pFlags = 0;
+	}
+
+	*ppDstData = pSrcData;
+	*pDstSize = SrcSize;
+	return 1;
 }
 
 static int ncrush_generate_tables(NCRUSH_CONTEXT* context)
@@ -2990,6 +2930,35 @@ static int ncrush_generate_tables(NCRUSH_CONTEXT* context)
 	return 1;
 }
 
+BOOL ncrush_set_compression_effort(NCRUSH_CONTEXT* ncrush, BULK_COMPRESSION_EFFORT effort)
+{
+	WINPR_ASSERT(ncrush);
+
+	switch (effort)
+	{
+		case BULK_COMPRESSION_EFFORT_FAST:
+			ncrush->MaxChainLength = 4;
+			ncrush->NiceMatchLength = 16;
+			ncrush->LazyMatching = FALSE;
+			break;
+		case BULK_COMPRESSION_EFFORT_DEFAULT:
+			ncrush->MaxChainLength = 16;
+			ncrush->NiceMatchLength = 128;
+			ncrush->LazyMatching = FALSE;
+			break;
+		case BULK_COMPRESSION_EFFORT_MAX:
+			ncrush->MaxChainLength = 256;
+			ncrush->NiceMatchLength = NCRUSH_MAX_MATCH_LENGTH;
+			ncrush->LazyMatching = TRUE;
+			break;
+		default:
+			WLog_ERR(TAG, "invalid compression effort %d", effort);
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 void ncrush_context_reset(NCRUSH_CONTEXT* ncrush, BOOL flush)
 {
 	WINPR_ASSERT(ncrush);
@@ -3027,6 +2996,8 @@ NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor)
 		goto fail;
 	}
 
+	ncrush->MatchLength = bulk_match_length_get();
+	(void)ncrush_set_compression_effort(ncrush, BULK_COMPRESSION_EFFORT_DEFAULT);
 	ncrush_context_reset(ncrush, FALSE);
 
 	return ncrush;
@@ -3035,6 +3006,11 @@ fail:
 	return NULL;
 }
 
+size_t ncrush_context_memory_size(WINPR_ATTR_UNUSED BOOL Compressor)
+{
+	return sizeof(NCRUSH_CONTEXT);
+}
+
 void ncrush_context_free(NCRUSH_CONTEXT* ncrush)
 {
 	free(ncrush);
@@ -41,11 +41,19 @@ extern "C"
 	                                    UINT32 SrcSize, const BYTE** ppDstData, UINT32* pDstSize,
 	                                    UINT32 flags);
 
+	/* Only affects the compressor, the output is understood by every decompressor */
+	FREERDP_LOCAL BOOL ncrush_set_compression_effort(NCRUSH_CONTEXT* ncrush,
+	                                                 BULK_COMPRESSION_EFFORT effort);
+
 	FREERDP_LOCAL void ncrush_context_reset(NCRUSH_CONTEXT* ncrush, BOOL flush);
 
-	FREERDP_LOCAL NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor);
+	FREERDP_LOCAL size_t ncrush_context_memory_size(BOOL Compressor);
+
 	FREERDP_LOCAL void ncrush_context_free(NCRUSH_CONTEXT* ncrush);
 
+	WINPR_ATTR_MALLOC(ncrush_context_free, 1)
+	FREERDP_LOCAL NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor);
+
 #ifdef __cplusplus
 }
 #endif
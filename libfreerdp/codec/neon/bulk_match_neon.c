@@ -0,0 +1,61 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Bulk Compression Match Length - NEON Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "bulk_match_neon.h"
+
+#include "../../core/simd.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static inline BOOL bulk_match_neon_all_set(uint8x16_t mask)
+{
+	const uint64x2_t wide = vreinterpretq_u64_u8(mask);
+	return (vgetq_lane_u64(wide, 0) & vgetq_lane_u64(wide, 1)) == UINT64_MAX;
+}
+
+/* The vector loop stops at the first block containing a mismatch, the scalar tail locates it */
+static UINT32 bulk_match_length_neon(const BYTE* a, const BYTE* b, UINT32 maxLength)
+{
+	UINT32 length = 0;
+
+	for (; length + 16 <= maxLength; length += 16)
+	{
+		const uint8x16_t va = vld1q_u8(&a[length]);
+		const uint8x16_t vb = vld1q_u8(&b[length]);
+
+		if (!bulk_match_neon_all_set(vceqq_u8(va, vb)))
+			break;
+	}
+
+	return length + bulk_match_length(&a[length], &b[length], maxLength - length);
+}
+#endif
+
+void bulk_match_init_neon_int(WINPR_ATTR_UNUSED bulk_match_length_fn_t* WINPR_RESTRICT fn)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	*fn = bulk_match_length_neon;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or NEON intrinsics not available");
+#endif
+}
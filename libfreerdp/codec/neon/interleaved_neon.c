@@ -0,0 +1,85 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Interleaved RLE Bitmap Encoder - NEON Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "../interleaved_types.h"
+#include "../interleaved_encode.h"
+#include "interleaved_neon.h"
+
+#include "../../core/simd.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static inline BOOL interleaved_neon_all_set(uint32x4_t mask)
+{
+	const uint16x4_t narrow = vmovn_u32(mask);
+	return vget_lane_u64(vreinterpret_u64_u16(narrow), 0) == UINT64_MAX;
+}
+
+/* The vector loops stop at the first block containing a mismatch, the scalar tail locates it */
+static UINT32 interleaved_match_run_neon(const UINT32* src, const UINT32* ref, UINT32 xorMask,
+                                         UINT32 length)
+{
+	const uint32x4_t mask = vdupq_n_u32(xorMask);
+	UINT32 x = 0;
+
+	for (; x + 4 <= length; x += 4)
+	{
+		const uint32x4_t a = vld1q_u32(&src[x]);
+		const uint32x4_t b = veorq_u32(vld1q_u32(&ref[x]), mask);
+
+		if (!interleaved_neon_all_set(vceqq_u32(a, b)))
+			break;
+	}
+
+	return x + interleaved_match_run(&src[x], &ref[x], xorMask, length - x);
+}
+
+static UINT32 interleaved_fgbg_run_neon(const UINT32* src, const UINT32* ref, UINT32 fgPel,
+                                        UINT32 length)
+{
+	const uint32x4_t fg = vdupq_n_u32(fgPel);
+	UINT32 x = 0;
+
+	for (; x + 4 <= length; x += 4)
+	{
+		const uint32x4_t diff = veorq_u32(vld1q_u32(&src[x]), vld1q_u32(&ref[x]));
+		const uint32x4_t match = vorrq_u32(vceqq_u32(diff, vdupq_n_u32(0)), vceqq_u32(diff, fg));
+
+		if (!interleaved_neon_all_set(match))
+			break;
+	}
+
+	return x + interleaved_fgbg_run(&src[x], &ref[x], fgPel, length - x);
+}
+#endif
+
+void interleaved_init_neon_int(
+    WINPR_ATTR_UNUSED BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT context)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	context->match_run = interleaved_match_run_neon;
+	context->fgbg_run = interleaved_fgbg_run_neon;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or NEON intrinsics not available");
+#endif
+}
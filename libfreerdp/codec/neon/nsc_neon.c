@@ -25,18 +25,108 @@
 #include <freerdp/log.h>
 
 #include "../nsc_types.h"
+#include "../nsc_encode.h"
 #include "nsc_neon.h"
 
 #include "../../core/simd.h"
 
 #if defined(NEON_INTRINSICS_ENABLED)
-#define TAG FREERDP_TAG("codec.nsc.neon")
+#include <arm_neon.h>
+
+#include <freerdp/codec/color.h>
+
+static void nsc_encode_argb_to_aycocg_row_neon(const NSC_CONTEXT* WINPR_RESTRICT context,
+                                               const BYTE* WINPR_RESTRICT src,
+                                               BYTE* WINPR_RESTRICT yplane,
+                                               BYTE* WINPR_RESTRICT coplane,
+                                               BYTE* WINPR_RESTRICT cgplane,
+                                               BYTE* WINPR_RESTRICT aplane, UINT32 width)
+{
+	size_t rPos = 0;
+	size_t gPos = 1;
+	size_t bPos = 0;
+	BOOL hasAlpha = FALSE;
+
+	switch (context->format)
+	{
+		case PIXEL_FORMAT_BGRA32:
+			hasAlpha = TRUE;
+			/* fallthrough */
+			WINPR_FALLTHROUGH
+		case PIXEL_FORMAT_BGRX32:
+			rPos = 2;
+			bPos = 0;
+			break;
+
+		case PIXEL_FORMAT_RGBA32:
+			hasAlpha = TRUE;
+			/* fallthrough */
+			WINPR_FALLTHROUGH
+		case PIXEL_FORMAT_RGBX32:
+			rPos = 0;
+			bPos = 2;
+			break;
+
+		default:
+			nsc_encode_argb_to_aycocg_row(context, src, yplane, coplane, cgplane, aplane, width);
+			return;
+	}
+
+	const int16x8_t ccl = vdupq_n_s16(-WINPR_ASSERTING_INT_CAST(INT16, context->ColorLossLevel));
+	UINT32 x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		const uint8x8x4_t px = vld4_u8(src);
+		const int16x8_t r_val = vreinterpretq_s16_u16(vmovl_u8(px.val[rPos]));
+		const int16x8_t g_val = vreinterpretq_s16_u16(vmovl_u8(px.val[gPos]));
+		const int16x8_t b_val = vreinterpretq_s16_u16(vmovl_u8(px.val[bPos]));
+		src += 32;
+
+		int16x8_t y_val = vaddq_s16(vshrq_n_s16(r_val, 2), vshrq_n_s16(g_val, 1));
+		y_val = vaddq_s16(y_val, vshrq_n_s16(b_val, 2));
+		/* a negative shift count shifts right */
+		const int16x8_t co_val = vshlq_s16(vsubq_s16(r_val, b_val), ccl);
+		int16x8_t cg_val = vsubq_s16(g_val, vshrq_n_s16(r_val, 1));
+		cg_val = vshlq_s16(vsubq_s16(cg_val, vshrq_n_s16(b_val, 1)), ccl);
+
+		vst1_u8(&yplane[x], vmovn_u16(vreinterpretq_u16_s16(y_val)));
+		vst1_u8(&coplane[x], vmovn_u16(vreinterpretq_u16_s16(co_val)));
+		vst1_u8(&cgplane[x], vmovn_u16(vreinterpretq_u16_s16(cg_val)));
+		vst1_u8(&aplane[x], hasAlpha ? px.val[3] : vdup_n_u8(0xFF));
+	}
+
+	if (x < width)
+		nsc_encode_argb_to_aycocg_row(context, src, &yplane[x], &coplane[x], &cgplane[x],
+		                              &aplane[x], width - x);
+}
+
+static void nsc_encode_subsampling_row_neon(BYTE* WINPR_RESTRICT dst,
+                                            const BYTE* WINPR_RESTRICT src0,
+                                            const BYTE* WINPR_RESTRICT src1, UINT32 width)
+{
+	UINT32 x = 0;
+
+	for (; x + 8 <= width; x += 8)
+	{
+		const int8x16_t t0 = vreinterpretq_s8_u8(vld1q_u8(&src0[2ULL * x]));
+		const int8x16_t t1 = vreinterpretq_s8_u8(vld1q_u8(&src1[2ULL * x]));
+		const int16x8_t sum = vaddq_s16(vpaddlq_s8(t0), vpaddlq_s8(t1));
+		vst1_u8(&dst[x], vreinterpret_u8_s8(vmovn_s16(vshrq_n_s16(sum, 2))));
+	}
+
+	if (x < width)
+		nsc_encode_subsampling_row(&dst[x], &src0[2ULL * x], &src1[2ULL * x], width - x);
+}
 #endif
 
 void nsc_init_neon_int(WINPR_ATTR_UNUSED NSC_CONTEXT* WINPR_RESTRICT context)
 {
 #if defined(NEON_INTRINSICS_ENABLED)
-	WLog_WARN(TAG, "TODO: Implement neon optimized version of this function");
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	PROFILER_RENAME(context->priv->prof_nsc_encode, "nsc_encode_neon")
+	context->encode_aycocg = nsc_encode_argb_to_aycocg_row_neon;
+	context->encode_subsampling = nsc_encode_subsampling_row_neon;
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or NEON intrinsics not available");
 #endif
@@ -29,6 +29,7 @@
 #include <winpr/assert.h>
 #include <winpr/cast.h>
 #include <winpr/crt.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/codec/nsc.h>
 #include <freerdp/codec/color.h>
@@ -340,6 +341,7 @@ BOOL nsc_context_reset(NSC_CONTEXT* WINPR_RESTRICT context, UINT32 width, UINT32
 
 NSC_CONTEXT* nsc_context_new(void)
 {
+	SYSTEM_INFO sysInfos = { 0 };
 	NSC_CONTEXT* context = (NSC_CONTEXT*)winpr_aligned_calloc(1, sizeof(NSC_CONTEXT), 32);
 
 	if (!context)
@@ -354,7 +356,11 @@ NSC_CONTEXT* nsc_context_new(void)
 	WLog_OpenAppender(context->priv->log);
 	context->BitmapData = NULL;
 	context->decode = nsc_decode;
-	context->encode = nsc_encode;
+	context->encode_aycocg = nsc_encode_argb_to_aycocg_row;
+	context->encode_subsampling = nsc_encode_subsampling_row;
+	/* The work queue is created by the encoder on first use, decoding is not threaded */
+	GetNativeSystemInfo(&sysInfos);
+	context->priv->UseThreads = (sysInfos.dwNumberOfProcessors > 1);
 
 	PROFILER_CREATE(context->priv->prof_nsc_rle_decompress_data, "nsc_rle_decompress_data")
 	PROFILER_CREATE(context->priv->prof_nsc_decode, "nsc_decode")
@@ -382,9 +388,17 @@ void nsc_context_free(NSC_CONTEXT* context)
 
 	if (context->priv)
 	{
-		for (size_t i = 0; i < 5; i++)
+		codec_queue_free(context->priv->Queue);
+
+		for (size_t i = 0; i < 4; i++)
 			winpr_aligned_free(context->priv->PlaneBuffers[i]);
 
+		for (size_t i = 0; i < 2; i++)
+			winpr_aligned_free(context->priv->ChromaBuffers[i]);
+
+		for (size_t i = 0; i < 4; i++)
+			winpr_aligned_free(context->priv->RleBuffers[i]);
+
 		nsc_profiler_print(context->priv);
 		PROFILER_FREE(context->priv->prof_nsc_rle_decompress_data)
 		PROFILER_FREE(context->priv->prof_nsc_decode)
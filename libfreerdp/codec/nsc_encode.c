@@ -31,6 +31,7 @@
 
 #include <freerdp/codec/nsc.h>
 #include <freerdp/codec/color.h>
+#include <freerdp/log.h>
 
 #include "nsc_types.h"
 #include "nsc_encode.h"
@@ -59,25 +60,46 @@ typedef struct
 static BOOL nsc_write_message(NSC_CONTEXT* WINPR_RESTRICT context, wStream* WINPR_RESTRICT s,
                               const NSC_MESSAGE* WINPR_RESTRICT message);
 
+#define NSC_ENCODE_BAND_HEIGHT 64
+#define NSC_ENCODE_MAX_BANDS 32
+
+typedef struct
+{
+	NSC_CONTEXT* context;
+	const BYTE* data;
+	UINT32 scanline;
+	UINT32 y;
+	UINT32 rows;
+} NSC_ENCODE_BAND;
+
+typedef struct
+{
+	const BYTE* in;
+	BYTE* out;
+	UINT32 originalSize;
+	UINT32 planeSize;
+} NSC_RLE_PLANE;
+
 static BOOL nsc_context_initialize_encode(NSC_CONTEXT* WINPR_RESTRICT context)
 {
-	UINT32 length = 0;
-	UINT32 tempWidth = 0;
-	UINT32 tempHeight = 0;
-	tempWidth = ROUND_UP_TO(context->width, 8);
-	tempHeight = ROUND_UP_TO(context->height, 2);
+	const UINT32 tempWidth = ROUND_UP_TO(context->width, 8);
+	const UINT32 tempHeight = ROUND_UP_TO(context->height, 2);
 	/* The maximum length a decoded plane can reach in all cases */
-	length = tempWidth * tempHeight + 16;
+	const size_t plength = 1ull * tempWidth * tempHeight + 16;
+	if (plength > UINT32_MAX)
+		return FALSE;
+
+	const UINT32 length = (UINT32)plength;
 
 	if (length > context->priv->PlaneBuffersLength)
 	{
-		for (int i = 0; i < 5; i++)
+		for (size_t i = 0; i < 4; i++)
 		{
 			BYTE* tmp = (BYTE*)winpr_aligned_recalloc(context->priv->PlaneBuffers[i], length,
 			                                          sizeof(BYTE), 32);
 
 			if (!tmp)
-				goto fail;
+				return FALSE;
 
 			context->priv->PlaneBuffers[i] = tmp;
 		}
@@ -85,6 +107,41 @@ static BOOL nsc_context_initialize_encode(NSC_CONTEXT* WINPR_RESTRICT context)
 		context->priv->PlaneBuffersLength = length;
 	}
 
+	if (length > context->priv->EncodeBuffersLength)
+	{
+		for (size_t i = 0; i < 2; i++)
+		{
+			BYTE* tmp = (BYTE*)winpr_aligned_recalloc(context->priv->ChromaBuffers[i], length,
+			                                          sizeof(BYTE), 32);
+
+			if (!tmp)
+				return FALSE;
+
+			context->priv->ChromaBuffers[i] = tmp;
+		}
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			BYTE* tmp = (BYTE*)winpr_aligned_recalloc(context->priv->RleBuffers[i], length,
+			                                          sizeof(BYTE), 32);
+
+			if (!tmp)
+				return FALSE;
+
+			context->priv->RleBuffers[i] = tmp;
+		}
+
+		context->priv->EncodeBuffersLength = length;
+	}
+
+	if (context->priv->UseThreads && !context->priv->Queue)
+	{
+		context->priv->Queue = codec_queue_new();
+
+		if (!context->priv->Queue)
+			return FALSE;
+	}
+
 	if (context->ChromaSubsamplingLevel)
 	{
 		context->OrgByteCount[0] = tempWidth * context->height;
@@ -101,319 +158,431 @@ static BOOL nsc_context_initialize_encode(NSC_CONTEXT* WINPR_RESTRICT context)
 	}
 
 	return TRUE;
-fail:
-
-	if (length > context->priv->PlaneBuffersLength)
-	{
-		for (int i = 0; i < 5; i++)
-			winpr_aligned_free(context->priv->PlaneBuffers[i]);
-	}
-
-	return FALSE;
 }
 
-static BOOL nsc_encode_argb_to_aycocg(NSC_CONTEXT* WINPR_RESTRICT context,
-                                      const BYTE* WINPR_RESTRICT data, UINT32 scanline)
+void nsc_encode_argb_to_aycocg_row(const NSC_CONTEXT* WINPR_RESTRICT context,
+                                   const BYTE* WINPR_RESTRICT src, BYTE* WINPR_RESTRICT yplane,
+                                   BYTE* WINPR_RESTRICT coplane, BYTE* WINPR_RESTRICT cgplane,
+                                   BYTE* WINPR_RESTRICT aplane, UINT32 width)
 {
-	size_t y = 0;
-	const BYTE* src = NULL;
-	BYTE* yplane = NULL;
-	BYTE* coplane = NULL;
-	BYTE* cgplane = NULL;
-	BYTE* aplane = NULL;
 	INT16 r_val = 0;
 	INT16 g_val = 0;
 	INT16 b_val = 0;
 	BYTE a_val = 0;
-
-	UINT16 tempWidth = ROUND_UP_TO(context->width, 8);
-	const UINT16 rw = (context->ChromaSubsamplingLevel ? tempWidth : context->width);
 	const BYTE ccl = WINPR_ASSERTING_INT_CAST(BYTE, context->ColorLossLevel);
 
-	for (; y < context->height; y++)
+	for (UINT32 x = 0; x < width; x++)
 	{
-		src = data + (context->height - 1 - y) * scanline;
-		yplane = context->priv->PlaneBuffers[0] + y * rw;
-		coplane = context->priv->PlaneBuffers[1] + y * rw;
-		cgplane = context->priv->PlaneBuffers[2] + y * rw;
-		aplane = context->priv->PlaneBuffers[3] + y * context->width;
-
-		UINT16 x = 0;
-		for (; x < context->width; x++)
+		switch (context->format)
 		{
-			switch (context->format)
+			case PIXEL_FORMAT_BGRX32:
+				b_val = *src++;
+				g_val = *src++;
+				r_val = *src++;
+				src++;
+				a_val = 0xFF;
+				break;
+
+			case PIXEL_FORMAT_BGRA32:
+				b_val = *src++;
+				g_val = *src++;
+				r_val = *src++;
+				a_val = *src++;
+				break;
+
+			case PIXEL_FORMAT_RGBX32:
+				r_val = *src++;
+				g_val = *src++;
+				b_val = *src++;
+				src++;
+				a_val = 0xFF;
+				break;
+
+			case PIXEL_FORMAT_RGBA32:
+				r_val = *src++;
+				g_val = *src++;
+				b_val = *src++;
+				a_val = *src++;
+				break;
+
+			case PIXEL_FORMAT_BGR24:
+				b_val = *src++;
+				g_val = *src++;
+				r_val = *src++;
+				a_val = 0xFF;
+				break;
+
+			case PIXEL_FORMAT_RGB24:
+				r_val = *src++;
+				g_val = *src++;
+				b_val = *src++;
+				a_val = 0xFF;
+				break;
+
+			case PIXEL_FORMAT_BGR16:
+				b_val = (INT16)(((*(src + 1)) & 0xF8) | ((*(src + 1)) >> 5));
+				g_val = (INT16)((((*(src + 1)) & 0x07) << 5) | (((*src) & 0xE0) >> 3));
+				r_val = (INT16)((((*src) & 0x1F) << 3) | (((*src) >> 2) & 0x07));
+				a_val = 0xFF;
+				src += 2;
+				break;
+
+			case PIXEL_FORMAT_RGB16:
+				r_val = (INT16)(((*(src + 1)) & 0xF8) | ((*(src + 1)) >> 5));
+				g_val = (INT16)((((*(src + 1)) & 0x07) << 5) | (((*src) & 0xE0) >> 3));
+				b_val = (INT16)((((*src) & 0x1F) << 3) | (((*src) >> 2) & 0x07));
+				a_val = 0xFF;
+				src += 2;
+				break;
+
+			case PIXEL_FORMAT_A4:
 			{
-				case PIXEL_FORMAT_BGRX32:
-					b_val = *src++;
-					g_val = *src++;
-					r_val = *src++;
-					src++;
-					a_val = 0xFF;
-					break;
-
-				case PIXEL_FORMAT_BGRA32:
-					b_val = *src++;
-					g_val = *src++;
-					r_val = *src++;
-					a_val = *src++;
-					break;
-
-				case PIXEL_FORMAT_RGBX32:
-					r_val = *src++;
-					g_val = *src++;
-					b_val = *src++;
-					src++;
-					a_val = 0xFF;
-					break;
-
-				case PIXEL_FORMAT_RGBA32:
-					r_val = *src++;
-					g_val = *src++;
-					b_val = *src++;
-					a_val = *src++;
-					break;
-
-				case PIXEL_FORMAT_BGR24:
-					b_val = *src++;
-					g_val = *src++;
-					r_val = *src++;
-					a_val = 0xFF;
-					break;
-
-				case PIXEL_FORMAT_RGB24:
-					r_val = *src++;
-					g_val = *src++;
-					b_val = *src++;
-					a_val = 0xFF;
-					break;
-
-				case PIXEL_FORMAT_BGR16:
-					b_val = (INT16)(((*(src + 1)) & 0xF8) | ((*(src + 1)) >> 5));
-					g_val = (INT16)((((*(src + 1)) & 0x07) << 5) | (((*src) & 0xE0) >> 3));
-					r_val = (INT16)((((*src) & 0x1F) << 3) | (((*src) >> 2) & 0x07));
-					a_val = 0xFF;
-					src += 2;
-					break;
-
-				case PIXEL_FORMAT_RGB16:
-					r_val = (INT16)(((*(src + 1)) & 0xF8) | ((*(src + 1)) >> 5));
-					g_val = (INT16)((((*(src + 1)) & 0x07) << 5) | (((*src) & 0xE0) >> 3));
-					b_val = (INT16)((((*src) & 0x1F) << 3) | (((*src) >> 2) & 0x07));
-					a_val = 0xFF;
-					src += 2;
-					break;
-
-				case PIXEL_FORMAT_A4:
-				{
-					int shift = 0;
-					BYTE idx = 0;
-					shift = (7 - (x % 8));
-					idx = ((*src) >> shift) & 1;
-					idx |= (((*(src + 1)) >> shift) & 1) << 1;
-					idx |= (((*(src + 2)) >> shift) & 1) << 2;
-					idx |= (((*(src + 3)) >> shift) & 1) << 3;
-					idx *= 3;
-					r_val = (INT16)context->palette[idx];
-					g_val = (INT16)context->palette[idx + 1];
-					b_val = (INT16)context->palette[idx + 2];
-
-					if (shift == 0)
-						src += 4;
-				}
-
-					a_val = 0xFF;
-					break;
-
-				case PIXEL_FORMAT_RGB8:
-				{
-					int idx = (*src) * 3;
-					r_val = (INT16)context->palette[idx];
-					g_val = (INT16)context->palette[idx + 1];
-					b_val = (INT16)context->palette[idx + 2];
-					src++;
-				}
-
-					a_val = 0xFF;
-					break;
-
-				default:
-					r_val = g_val = b_val = a_val = 0;
-					break;
+				int shift = 0;
+				BYTE idx = 0;
+				shift = (7 - (x % 8));
+				idx = ((*src) >> shift) & 1;
+				idx |= (((*(src + 1)) >> shift) & 1) << 1;
+				idx |= (((*(src + 2)) >> shift) & 1) << 2;
+				idx |= (((*(src + 3)) >> shift) & 1) << 3;
+				idx *= 3;
+				r_val = (INT16)context->palette[idx];
+				g_val = (INT16)context->palette[idx + 1];
+				b_val = (INT16)context->palette[idx + 2];
+
+				if (shift == 0)
+					src += 4;
 			}
 
-			*yplane++ = (BYTE)((r_val >> 2) + (g_val >> 1) + (b_val >> 2));
-			/* Perform color loss reduction here */
-			*coplane++ = (BYTE)((r_val - b_val) >> ccl);
-			*cgplane++ = (BYTE)((-(r_val >> 1) + g_val - (b_val >> 1)) >> ccl);
-			*aplane++ = a_val;
+				a_val = 0xFF;
+				break;
+
+			case PIXEL_FORMAT_RGB8:
+			{
+				int idx = (*src) * 3;
+				r_val = (INT16)context->palette[idx];
+				g_val = (INT16)context->palette[idx + 1];
+				b_val = (INT16)context->palette[idx + 2];
+				src++;
+			}
+
+				a_val = 0xFF;
+				break;
+
+			default:
+				r_val = g_val = b_val = a_val = 0;
+				break;
 		}
 
-		if (context->ChromaSubsamplingLevel && (x % 2) == 1)
+		*yplane++ = (BYTE)((r_val >> 2) + (g_val >> 1) + (b_val >> 2));
+		/* Perform color loss reduction here */
+		*coplane++ = (BYTE)((r_val - b_val) >> ccl);
+		*cgplane++ = (BYTE)((-(r_val >> 1) + g_val - (b_val >> 1)) >> ccl);
+		*aplane++ = a_val;
+	}
+}
+
+void nsc_encode_subsampling_row(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT src0,
+                                const BYTE* WINPR_RESTRICT src1, UINT32 width)
+{
+	const INT8* s0 = (const INT8*)src0;
+	const INT8* s1 = (const INT8*)src1;
+
+	for (UINT32 x = 0; x < width; x++)
+	{
+		*dst++ = (BYTE)(((INT16)s0[0] + (INT16)s0[1] + (INT16)s1[0] + (INT16)s1[1]) >> 2);
+		s0 += 2;
+		s1 += 2;
+	}
+}
+
+/**
+ * Converts the source rows [y, y + rows) and, with chroma subsampling, produces the matching
+ * half resolution chroma rows. y is always even, so bands never share a subsampled row.
+ */
+static void nsc_encode_band(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT data,
+                            UINT32 scanline, UINT32 y, UINT32 rows)
+{
+	const UINT32 width = context->width;
+	const UINT32 height = context->height;
+	const BOOL subsample = (context->ChromaSubsamplingLevel != 0);
+	const UINT32 rw = subsample ? ROUND_UP_TO(width, 8) : width;
+	BYTE* coplane = subsample ? context->priv->ChromaBuffers[0] : context->priv->PlaneBuffers[1];
+	BYTE* cgplane = subsample ? context->priv->ChromaBuffers[1] : context->priv->PlaneBuffers[2];
+	UINT32 end = y + rows;
+
+	for (UINT32 row = y; row < end; row++)
+	{
+		const BYTE* src = &data[1ULL * (height - 1 - row) * scanline];
+		BYTE* yrow = &context->priv->PlaneBuffers[0][1ULL * row * rw];
+		BYTE* corow = &coplane[1ULL * row * rw];
+		BYTE* cgrow = &cgplane[1ULL * row * rw];
+		BYTE* arow = &context->priv->PlaneBuffers[3][1ULL * row * width];
+
+		context->encode_aycocg(context, src, yrow, corow, cgrow, arow, width);
+
+		/* Pad the row to the subsampled width by repeating the last pixel */
+		if (rw > width)
 		{
-			*yplane = *(yplane - 1);
-			*coplane = *(coplane - 1);
-			*cgplane = *(cgplane - 1);
+			FillMemory(&yrow[width], rw - width, yrow[width - 1]);
+			FillMemory(&corow[width], rw - width, corow[width - 1]);
+			FillMemory(&cgrow[width], rw - width, cgrow[width - 1]);
 		}
 	}
 
-	if (context->ChromaSubsamplingLevel && (y % 2) == 1)
+	if (!subsample)
+		return;
+
+	/* An odd height repeats the last chroma row */
+	if ((end == height) && ((height % 2) != 0))
 	{
-		yplane = context->priv->PlaneBuffers[0] + y * rw;
-		coplane = context->priv->PlaneBuffers[1] + y * rw;
-		cgplane = context->priv->PlaneBuffers[2] + y * rw;
-		CopyMemory(yplane, yplane - rw, rw);
-		CopyMemory(coplane, coplane - rw, rw);
-		CopyMemory(cgplane, cgplane - rw, rw);
+		CopyMemory(&coplane[1ULL * end * rw], &coplane[1ULL * (end - 1) * rw], rw);
+		CopyMemory(&cgplane[1ULL * end * rw], &cgplane[1ULL * (end - 1) * rw], rw);
+		end++;
 	}
 
-	return TRUE;
+	for (UINT32 row = y / 2; row < end / 2; row++)
+	{
+		const size_t dstOffset = 1ULL * row * (rw / 2);
+		const size_t srcOffset = 2ULL * row * rw;
+
+		context->encode_subsampling(&context->priv->PlaneBuffers[1][dstOffset],
+		                            &coplane[srcOffset], &coplane[srcOffset + rw], rw / 2);
+		context->encode_subsampling(&context->priv->PlaneBuffers[2][dstOffset],
+		                            &cgplane[srcOffset], &cgplane[srcOffset + rw], rw / 2);
+	}
 }
 
-static BOOL nsc_encode_subsampling(NSC_CONTEXT* WINPR_RESTRICT context)
+static void CALLBACK nsc_encode_band_work_callback(WINPR_ATTR_UNUSED PTP_CALLBACK_INSTANCE instance,
+                                                   void* context, WINPR_ATTR_UNUSED PTP_WORK work)
 {
-	UINT32 tempWidth = 0;
-	UINT32 tempHeight = 0;
+	const NSC_ENCODE_BAND* band = (const NSC_ENCODE_BAND*)context;
+	WINPR_ASSERT(band);
 
-	if (!context)
-		return FALSE;
+	nsc_encode_band(band->context, band->data, band->scanline, band->y, band->rows);
+}
 
-	tempWidth = ROUND_UP_TO(context->width, 8);
-	tempHeight = ROUND_UP_TO(context->height, 2);
+BOOL nsc_encode(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT bmpdata,
+                UINT32 rowstride)
+{
+	NSC_ENCODE_BAND bands[NSC_ENCODE_MAX_BANDS] = { 0 };
+	BOOL rc = TRUE;
 
-	if (tempHeight == 0)
+	if (!context || !bmpdata || (rowstride == 0))
 		return FALSE;
 
-	if (tempWidth > context->priv->PlaneBuffersLength / tempHeight)
-		return FALSE;
+	const UINT32 height = context->height;
+
+	if ((context->width == 0) || (height == 0))
+		return TRUE;
+
+	/* Bands start on even rows so each one owns its subsampled chroma rows */
+	UINT32 bandHeight = NSC_ENCODE_BAND_HEIGHT;
+
+	if (height > NSC_ENCODE_BAND_HEIGHT * NSC_ENCODE_MAX_BANDS)
+		bandHeight = ROUND_UP_TO((height + NSC_ENCODE_MAX_BANDS - 1) / NSC_ENCODE_MAX_BANDS, 2);
+
+	const UINT32 count = (height + bandHeight - 1) / bandHeight;
+	WINPR_ASSERT(count <= NSC_ENCODE_MAX_BANDS);
 
-	for (size_t y = 0; y < tempHeight >> 1; y++)
+	if (!context->priv->Queue || (count < 2))
 	{
-		BYTE* co_dst = context->priv->PlaneBuffers[1] + y * (tempWidth >> 1);
-		BYTE* cg_dst = context->priv->PlaneBuffers[2] + y * (tempWidth >> 1);
-		const INT8* co_src0 = (INT8*)context->priv->PlaneBuffers[1] + (y << 1) * tempWidth;
-		const INT8* co_src1 = co_src0 + tempWidth;
-		const INT8* cg_src0 = (INT8*)context->priv->PlaneBuffers[2] + (y << 1) * tempWidth;
-		const INT8* cg_src1 = cg_src0 + tempWidth;
-
-		for (UINT32 x = 0; x < tempWidth >> 1; x++)
+		nsc_encode_band(context, bmpdata, rowstride, 0, height);
+		return TRUE;
+	}
+
+	for (UINT32 i = 0; i < count; i++)
+	{
+		NSC_ENCODE_BAND* band = &bands[i];
+		band->context = context;
+		band->data = bmpdata;
+		band->scanline = rowstride;
+		band->y = i * bandHeight;
+		band->rows = MIN(bandHeight, height - band->y);
+
+		if (!codec_queue_submit(context->priv->Queue, nsc_encode_band_work_callback, band))
 		{
-			*co_dst++ = (BYTE)(((INT16)*co_src0 + (INT16) * (co_src0 + 1) + (INT16)*co_src1 +
-			                    (INT16) * (co_src1 + 1)) >>
-			                   2);
-			*cg_dst++ = (BYTE)(((INT16)*cg_src0 + (INT16) * (cg_src0 + 1) + (INT16)*cg_src1 +
-			                    (INT16) * (cg_src1 + 1)) >>
-			                   2);
-			co_src0 += 2;
-			co_src1 += 2;
-			cg_src0 += 2;
-			cg_src1 += 2;
+			WLog_Print(context->priv->log, WLOG_ERROR, "codec_queue_submit failed.");
+			rc = FALSE;
+			break;
 		}
 	}
 
-	return TRUE;
+	codec_queue_wait(context->priv->Queue);
+	return rc;
 }
 
-BOOL nsc_encode(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT bmpdata,
-                UINT32 rowstride)
+static inline UINT64 nsc_rle_read64(const BYTE* WINPR_RESTRICT in)
 {
-	if (!context || !bmpdata || (rowstride == 0))
-		return FALSE;
+	UINT64 val = 0;
+	memcpy(&val, in, sizeof(val));
+	return val;
+}
 
-	if (!nsc_encode_argb_to_aycocg(context, bmpdata, rowstride))
-		return FALSE;
+/* Returns the first position after pos that does not repeat in[pos], at most limit */
+static inline UINT32 nsc_rle_run_end(const BYTE* WINPR_RESTRICT in, UINT32 pos, UINT32 limit)
+{
+	const UINT64 pattern = in[pos] * 0x0101010101010101ULL;
+	UINT32 end = pos + 1;
 
-	if (context->ChromaSubsamplingLevel)
+	while ((end + 8 <= limit) && (nsc_rle_read64(&in[end]) == pattern))
+		end += 8;
+
+	while ((end < limit) && (in[end] == in[pos]))
+		end++;
+
+	return end;
+}
+
+/* Returns the start of the next run of at least two bytes below limit, limit if there is none */
+static inline UINT32 nsc_rle_literal_end(const BYTE* WINPR_RESTRICT in, UINT32 pos, UINT32 limit)
+{
+	UINT32 end = pos;
+
+	while (end + 9 <= limit)
 	{
-		if (!nsc_encode_subsampling(context))
-			return FALSE;
+		const UINT64 diff = nsc_rle_read64(&in[end]) ^ nsc_rle_read64(&in[end + 1]);
+
+		/* A zero byte in diff marks two equal neighbours */
+		if (((diff - 0x0101010101010101ULL) & ~diff & 0x8080808080808080ULL) != 0)
+			break;
+
+		end += 8;
 	}
 
-	return TRUE;
+	while ((end + 1 < limit) && (in[end] != in[end + 1]))
+		end++;
+
+	return (end + 1 < limit) ? end : limit;
 }
 
 static UINT32 nsc_rle_encode(const BYTE* WINPR_RESTRICT in, BYTE* WINPR_RESTRICT out,
                              UINT32 originalSize)
 {
-	UINT32 left = 0;
-	UINT32 runlength = 1;
 	UINT32 planeSize = 0;
-	left = originalSize;
+	UINT32 pos = 0;
+
+	if (originalSize <= 4)
+		return originalSize;
+
+	/* The last 4 bytes are always stored raw */
+	const UINT32 limit = originalSize - 4;
 
 	/**
 	 * We quit the loop if the running compressed size is larger than the original.
 	 * In such cases data will be sent uncompressed.
 	 */
-	while (left > 4 && planeSize < originalSize - 4)
+	while (pos < limit)
 	{
-		if (left > 5 && *in == *(in + 1))
-		{
-			runlength++;
-		}
-		else if (runlength == 1)
+		if (planeSize >= limit)
+			return originalSize;
+
+		const UINT32 end = nsc_rle_run_end(in, pos, limit);
+		const UINT32 runlength = end - pos;
+
+		if (runlength == 1)
 		{
-			*out++ = *in;
-			planeSize++;
+			const UINT32 literals =
+			    MIN(nsc_rle_literal_end(in, pos, limit) - pos, limit - planeSize);
+			CopyMemory(out, &in[pos], literals);
+			out += literals;
+			planeSize += literals;
+			pos += literals;
+			continue;
 		}
-		else if (runlength < 256)
+
+		*out++ = in[pos];
+		*out++ = in[pos];
+
+		if (runlength < 256)
 		{
-			*out++ = *in;
-			*out++ = *in;
-			WINPR_ASSERT(runlength >= 2);
 			*out++ = WINPR_ASSERTING_INT_CAST(BYTE, runlength - 2);
-			runlength = 1;
 			planeSize += 3;
 		}
 		else
 		{
-			*out++ = *in;
-			*out++ = *in;
 			*out++ = 0xFF;
 			*out++ = (runlength & 0x000000FF);
 			*out++ = (runlength & 0x0000FF00) >> 8;
 			*out++ = (runlength & 0x00FF0000) >> 16;
 			*out++ = (runlength & 0xFF000000) >> 24;
-			runlength = 1;
 			planeSize += 7;
 		}
 
-		in++;
-		left--;
+		pos = end;
 	}
 
-	if (planeSize < originalSize - 4)
-		CopyMemory(out, in, 4);
+	if (planeSize >= limit)
+		return originalSize;
 
-	planeSize += 4;
-	return planeSize;
+	CopyMemory(out, &in[limit], 4);
+	return planeSize + 4;
 }
 
-static void nsc_rle_compress_data(NSC_CONTEXT* WINPR_RESTRICT context)
+static void nsc_rle_encode_plane(NSC_RLE_PLANE* WINPR_RESTRICT plane)
 {
-	UINT32 planeSize = 0;
-	UINT32 originalSize = 0;
+	if (plane->originalSize == 0)
+		plane->planeSize = 0;
+	else
+		plane->planeSize = nsc_rle_encode(plane->in, plane->out, plane->originalSize);
+}
+
+static void CALLBACK nsc_rle_encode_work_callback(WINPR_ATTR_UNUSED PTP_CALLBACK_INSTANCE instance,
+                                                  void* context, WINPR_ATTR_UNUSED PTP_WORK work)
+{
+	NSC_RLE_PLANE* plane = (NSC_RLE_PLANE*)context;
+	WINPR_ASSERT(plane);
+
+	nsc_rle_encode_plane(plane);
+}
 
-	for (UINT16 i = 0; i < 4; i++)
+/**
+ * RLE encodes all planes, each one as a separate job when threaded. Planes that do not compress
+ * are sent raw, planes[i].out then points to the plane buffer itself.
+ */
+static BOOL nsc_rle_compress_data(NSC_CONTEXT* WINPR_RESTRICT context, NSC_RLE_PLANE planes[4])
+{
+	BOOL rc = TRUE;
+
+	for (size_t i = 0; i < 4; i++)
 	{
-		originalSize = context->OrgByteCount[i];
+		NSC_RLE_PLANE* plane = &planes[i];
+		plane->in = context->priv->PlaneBuffers[i];
+		plane->out = context->priv->RleBuffers[i];
+		plane->originalSize = context->OrgByteCount[i];
 
-		if (originalSize == 0)
+		if (context->priv->Queue && (plane->originalSize > 0))
 		{
-			planeSize = 0;
+			if (!codec_queue_submit(context->priv->Queue, nsc_rle_encode_work_callback, plane))
+			{
+				WLog_Print(context->priv->log, WLOG_ERROR, "codec_queue_submit failed.");
+				rc = FALSE;
+				break;
+			}
 		}
 		else
+			nsc_rle_encode_plane(plane);
+	}
+
+	if (context->priv->Queue)
+		codec_queue_wait(context->priv->Queue);
+
+	if (!rc)
+		return FALSE;
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		NSC_RLE_PLANE* plane = &planes[i];
+
+		if (plane->planeSize >= plane->originalSize)
 		{
-			planeSize = nsc_rle_encode(context->priv->PlaneBuffers[i],
-			                           context->priv->PlaneBuffers[4], originalSize);
-
-			if (planeSize < originalSize)
-				CopyMemory(context->priv->PlaneBuffers[i], context->priv->PlaneBuffers[4],
-				           planeSize);
-			else
-				planeSize = originalSize;
+			plane->planeSize = plane->originalSize;
+			plane->out = context->priv->PlaneBuffers[i];
 		}
 
-		context->PlaneByteCount[i] = planeSize;
+		context->PlaneByteCount[i] = plane->planeSize;
 	}
+
+	return TRUE;
 }
 
 BOOL nsc_write_message(WINPR_ATTR_UNUSED NSC_CONTEXT* WINPR_RESTRICT context,
@@ -459,6 +628,7 @@ BOOL nsc_compose_message(NSC_CONTEXT* WINPR_RESTRICT context, wStream* WINPR_RES
 {
 	BOOL rc = 0;
 	NSC_MESSAGE message = { 0 };
+	NSC_RLE_PLANE planes[4] = { 0 };
 
 	if (!context || !s || !data)
 		return FALSE;
@@ -471,19 +641,22 @@ BOOL nsc_compose_message(NSC_CONTEXT* WINPR_RESTRICT context, wStream* WINPR_RES
 
 	/* ARGB to AYCoCg conversion, chroma subsampling and colorloss reduction */
 	PROFILER_ENTER(context->priv->prof_nsc_encode)
-	rc = context->encode(context, data, scanline);
+	rc = nsc_encode(context, data, scanline);
 	PROFILER_EXIT(context->priv->prof_nsc_encode)
 	if (!rc)
 		return FALSE;
 
 	/* RLE encode */
 	PROFILER_ENTER(context->priv->prof_nsc_rle_compress_data)
-	nsc_rle_compress_data(context);
+	rc = nsc_rle_compress_data(context, planes);
 	PROFILER_EXIT(context->priv->prof_nsc_rle_compress_data)
-	message.PlaneBuffers[0] = context->priv->PlaneBuffers[0];
-	message.PlaneBuffers[1] = context->priv->PlaneBuffers[1];
-	message.PlaneBuffers[2] = context->priv->PlaneBuffers[2];
-	message.PlaneBuffers[3] = context->priv->PlaneBuffers[3];
+	if (!rc)
+		return FALSE;
+
+	message.PlaneBuffers[0] = planes[0].out;
+	message.PlaneBuffers[1] = planes[1].out;
+	message.PlaneBuffers[2] = planes[2].out;
+	message.PlaneBuffers[3] = planes[3].out;
 	message.LumaPlaneByteCount = context->PlaneByteCount[0];
 	message.OrangeChromaPlaneByteCount = context->PlaneByteCount[1];
 	message.GreenChromaPlaneByteCount = context->PlaneByteCount[2];
@@ -24,7 +24,20 @@
 
 #include <freerdp/api.h>
 
+#include "nsc_types.h"
+
 FREERDP_LOCAL BOOL nsc_encode(NSC_CONTEXT* WINPR_RESTRICT context,
                               const BYTE* WINPR_RESTRICT bmpdata, UINT32 rowstride);
 
+/* Generic row kernels, also used by the SIMD implementations for unsupported formats and tails */
+FREERDP_LOCAL void nsc_encode_argb_to_aycocg_row(const NSC_CONTEXT* WINPR_RESTRICT context,
+                                                 const BYTE* WINPR_RESTRICT src,
+                                                 BYTE* WINPR_RESTRICT yplane,
+                                                 BYTE* WINPR_RESTRICT coplane,
+                                                 BYTE* WINPR_RESTRICT cgplane,
+                                                 BYTE* WINPR_RESTRICT aplane, UINT32 width);
+FREERDP_LOCAL void nsc_encode_subsampling_row(BYTE* WINPR_RESTRICT dst,
+                                              const BYTE* WINPR_RESTRICT src0,
+                                              const BYTE* WINPR_RESTRICT src1, UINT32 width);
+
 #endif /* FREERDP_LIB_CODEC_NSC_ENCODE_H */
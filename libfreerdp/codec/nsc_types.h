@@ -32,6 +32,8 @@
 #include <freerdp/utils/profiler.h>
 #include <freerdp/codec/nsc.h>
 
+#include "executor.h"
+
 #define ROUND_UP_TO(_b, _n) (_b + ((~(_b & (_n - 1)) + 0x1) & (_n - 1)))
 #define MINMAX(_v, _l, _h)                                             \
 	((_v) < (_l) ? WINPR_ASSERTING_INT_CAST(BYTE, (_l))                \
@@ -42,9 +44,16 @@ typedef struct
 {
 	wLog* log;
 
-	BYTE* PlaneBuffers[5];     /* Decompressed Plane Buffers in the respective order */
+	BYTE* PlaneBuffers[4];     /* Decompressed Plane Buffers in the respective order */
 	UINT32 PlaneBuffersLength; /* Lengths of each plane buffer */
 
+	BYTE* ChromaBuffers[2];     /* Full resolution Co and Cg planes before subsampling */
+	BYTE* RleBuffers[4];        /* RLE encoded planes */
+	UINT32 EncodeBuffersLength; /* Lengths of each chroma and RLE buffer */
+
+	BOOL UseThreads;
+	CODEC_QUEUE* Queue;
+
 	/* profilers */
 	PROFILER_DEFINE(prof_nsc_rle_decompress_data)
 	PROFILER_DEFINE(prof_nsc_decode)
@@ -72,8 +81,11 @@ struct S_NSC_CONTEXT
 	const BYTE* palette;
 
 	BOOL (*decode)(NSC_CONTEXT* WINPR_RESTRICT context);
-	BOOL(*encode)
-	(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT BitmapData, UINT32 rowstride);
+	void (*encode_aycocg)(const NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT src,
+	                      BYTE* WINPR_RESTRICT yplane, BYTE* WINPR_RESTRICT coplane,
+	                      BYTE* WINPR_RESTRICT cgplane, BYTE* WINPR_RESTRICT aplane, UINT32 width);
+	void (*encode_subsampling)(BYTE* WINPR_RESTRICT dst, const BYTE* WINPR_RESTRICT src0,
+	                           const BYTE* WINPR_RESTRICT src1, UINT32 width);
 
 	NSC_CONTEXT_PRIV* priv;
 };
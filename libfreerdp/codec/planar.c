@@ -227,38 +227,31 @@ static INLINE INT32 planar_skip_plane_rle(const BYTE* WINPR_RESTRICT pSrcData, U
 	return (INT32)used;
 }
 
-static inline UINT8 clamp(INT16 val)
-{
-	return (UINT8)val;
-}
-
 static INLINE INT32 planar_decompress_plane_rle_only(const BYTE* WINPR_RESTRICT pSrcData,
                                                      UINT32 SrcSize, BYTE* WINPR_RESTRICT pDstData,
                                                      UINT32 nWidth, UINT32 nHeight)
 {
-	BYTE* previousScanline = NULL;
-	const BYTE* srcp = pSrcData;
+	const primitives_t* prims = primitives_get();
+	UINT32 used = 0;
 
+	WINPR_ASSERT(prims);
 	WINPR_ASSERT(nHeight <= INT32_MAX);
 	WINPR_ASSERT(nWidth <= INT32_MAX);
 
 	for (UINT32 y = 0; y < nHeight; y++)
 	{
-		BYTE* dstp = &pDstData[1ULL * (y)*nWidth];
-		INT16 pixel = 0;
-		BYTE* currentScanline = dstp;
+		BYTE* dstp = &pDstData[1ULL * y * nWidth];
+		BYTE value = 0;
 
 		for (UINT32 x = 0; x < nWidth;)
 		{
-			BYTE controlByte = *srcp;
-			srcp++;
-
-			if ((srcp - pSrcData) > SrcSize * 1ll)
+			if (used >= SrcSize)
 			{
 				WLog_ERR(TAG, "error reading input buffer");
 				return -1;
 			}
 
+			const BYTE controlByte = pSrcData[used++];
 			UINT32 nRunLength = PLANAR_CONTROL_BYTE_RUN_LENGTH(controlByte);
 			UINT32 cRawBytes = PLANAR_CONTROL_BYTE_RAW_BYTES(controlByte);
 
@@ -273,314 +266,38 @@ static INLINE INT32 planar_decompress_plane_rle_only(const BYTE* WINPR_RESTRICT
 				cRawBytes = 0;
 			}
 
-			if (((dstp + (cRawBytes + nRunLength)) - currentScanline) > nWidth * 1ll)
+			if ((cRawBytes + nRunLength) > (nWidth - x))
 			{
 				WLog_ERR(TAG, "too many pixels in scanline");
 				return -1;
 			}
 
-			if (!previousScanline)
-			{
-				/* first scanline, absolute values */
-				while (cRawBytes > 0)
-				{
-					pixel = *srcp;
-					srcp++;
-					*dstp = clamp(pixel);
-					dstp++;
-					x++;
-					cRawBytes--;
-				}
-
-				while (nRunLength > 0)
-				{
-					*dstp = clamp(pixel);
-					dstp++;
-					x++;
-					nRunLength--;
-				}
-			}
-			else
-			{
-				/* delta values relative to previous scanline */
-				while (cRawBytes > 0)
-				{
-					UINT8 deltaValue = *srcp;
-					srcp++;
-
-					if (deltaValue & 1)
-					{
-						deltaValue = deltaValue >> 1;
-						deltaValue = deltaValue + 1;
-						pixel = WINPR_ASSERTING_INT_CAST(int16_t, -1 * (int16_t)deltaValue);
-					}
-					else
-					{
-						deltaValue = deltaValue >> 1;
-						pixel = WINPR_ASSERTING_INT_CAST(INT16, deltaValue);
-					}
-
-					const INT16 delta =
-					    WINPR_ASSERTING_INT_CAST(int16_t, previousScanline[x] + pixel);
-					*dstp = clamp(delta);
-					dstp++;
-					x++;
-					cRawBytes--;
-				}
-
-				while (nRunLength > 0)
-				{
-					const INT16 deltaValue =
-					    WINPR_ASSERTING_INT_CAST(int16_t, previousScanline[x] + pixel);
-					*dstp = clamp(deltaValue);
-					dstp++;
-					x++;
-					nRunLength--;
-				}
-			}
-		}
-
-		previousScanline = currentScanline;
-	}
-
-	return (INT32)(srcp - pSrcData);
-}
-
-static INLINE INT32 planar_decompress_plane_rle(const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
-                                                BYTE* WINPR_RESTRICT pDstData, UINT32 nDstStep,
-                                                UINT32 nXDst, UINT32 nYDst, UINT32 nWidth,
-                                                UINT32 nHeight, UINT32 nChannel, BOOL vFlip)
-{
-	INT32 beg = 0;
-	INT32 end = 0;
-	INT32 inc = 0;
-	BYTE* previousScanline = NULL;
-	const BYTE* srcp = pSrcData;
-
-	WINPR_ASSERT(nHeight <= INT32_MAX);
-	WINPR_ASSERT(nWidth <= INT32_MAX);
-	WINPR_ASSERT(nDstStep <= INT32_MAX);
-
-	previousScanline = NULL;
-
-	if (vFlip)
-	{
-		beg = (INT32)nHeight - 1;
-		end = -1;
-		inc = -1;
-	}
-	else
-	{
-		beg = 0;
-		end = (INT32)nHeight;
-		inc = 1;
-	}
-
-	for (INT32 y = beg; y != end; y += inc)
-	{
-		const intptr_t off = ((1LL * nYDst + y) * nDstStep) + (4LL * nXDst) + nChannel * 1LL;
-		BYTE* dstp = &pDstData[off];
-		BYTE* currentScanline = dstp;
-		INT16 pixel = 0;
-
-		for (INT32 x = 0; x < (INT32)nWidth;)
-		{
-			const BYTE controlByte = *srcp;
-			srcp++;
-
-			if ((srcp - pSrcData) > SrcSize * 1ll)
+			if (cRawBytes > (SrcSize - used))
 			{
 				WLog_ERR(TAG, "error reading input buffer");
 				return -1;
 			}
 
-			UINT32 nRunLength = PLANAR_CONTROL_BYTE_RUN_LENGTH(controlByte);
-			UINT32 cRawBytes = PLANAR_CONTROL_BYTE_RAW_BYTES(controlByte);
-
-			if (nRunLength == 1)
-			{
-				nRunLength = cRawBytes + 16;
-				cRawBytes = 0;
-			}
-			else if (nRunLength == 2)
-			{
-				nRunLength = cRawBytes + 32;
-				cRawBytes = 0;
-			}
-
-			if (((dstp + (cRawBytes + nRunLength)) - currentScanline) > nWidth * 4ll)
-			{
-				WLog_ERR(TAG, "too many pixels in scanline");
-				return -1;
-			}
-
-			if (!previousScanline)
+			/* Runs repeat the last raw byte of the scanline (or 0), which is the same for
+			 * absolute values and delta values relative to the previous scanline */
+			if (cRawBytes > 0)
 			{
-				/* first scanline, absolute values */
-				while (cRawBytes > 0)
-				{
-					pixel = *srcp;
-					srcp++;
-					*dstp = WINPR_ASSERTING_INT_CAST(BYTE, pixel);
-					dstp += 4;
-					x++;
-					cRawBytes--;
-				}
-
-				while (nRunLength > 0)
-				{
-					*dstp = WINPR_ASSERTING_INT_CAST(BYTE, pixel);
-					dstp += 4;
-					x++;
-					nRunLength--;
-				}
+				memcpy(&dstp[x], &pSrcData[used], cRawBytes);
+				used += cRawBytes;
+				x += cRawBytes;
+				value = dstp[x - 1];
 			}
-			else
-			{
-				/* delta values relative to previous scanline */
-				while (cRawBytes > 0)
-				{
-					BYTE deltaValue = *srcp;
-					srcp++;
-
-					if (deltaValue & 1)
-					{
-						deltaValue = deltaValue >> 1;
-						deltaValue = deltaValue + 1;
-						pixel = WINPR_ASSERTING_INT_CAST(int16_t, -deltaValue);
-					}
-					else
-					{
-						deltaValue = deltaValue >> 1;
-						pixel = deltaValue;
-					}
-
-					const INT16 delta =
-					    WINPR_ASSERTING_INT_CAST(int16_t, previousScanline[4LL * x] + pixel);
-					*dstp = clamp(delta);
-					dstp += 4;
-					x++;
-					cRawBytes--;
-				}
-
-				while (nRunLength > 0)
-				{
-					const INT16 deltaValue =
-					    WINPR_ASSERTING_INT_CAST(int16_t, pixel + previousScanline[4LL * x]);
-					*dstp = clamp(deltaValue);
-					dstp += 4;
-					x++;
-					nRunLength--;
-				}
-			}
-		}
-
-		previousScanline = currentScanline;
-	}
-
-	return (INT32)(srcp - pSrcData);
-}
-
-static INLINE INT32 planar_set_plane(BYTE bValue, BYTE* pDstData, UINT32 nDstStep, UINT32 nXDst,
-                                     UINT32 nYDst, UINT32 nWidth, UINT32 nHeight, UINT32 nChannel,
-                                     BOOL vFlip)
-{
-	INT32 beg = 0;
-	INT32 end = 0;
-	INT32 inc = 0;
 
-	WINPR_ASSERT(nHeight <= INT32_MAX);
-	WINPR_ASSERT(nWidth <= INT32_MAX);
-	WINPR_ASSERT(nDstStep <= INT32_MAX);
-
-	if (vFlip)
-	{
-		beg = (INT32)nHeight - 1;
-		end = -1;
-		inc = -1;
-	}
-	else
-	{
-		beg = 0;
-		end = (INT32)nHeight;
-		inc = 1;
-	}
-
-	for (INT32 y = beg; y != end; y += inc)
-	{
-		const intptr_t off = ((1LL * nYDst + y) * nDstStep) + (4LL * nXDst) + nChannel * 1LL;
-		BYTE* dstp = &pDstData[off];
-
-		for (INT32 x = 0; x < (INT32)nWidth; ++x)
-		{
-			*dstp = bValue;
-			dstp += 4;
+			memset(&dstp[x], value, nRunLength);
+			x += nRunLength;
 		}
 	}
 
-	return 0;
-}
-
-static INLINE BOOL writeLine(BYTE** WINPR_RESTRICT ppRgba, UINT32 DstFormat, UINT32 width,
-                             const BYTE** WINPR_RESTRICT ppR, const BYTE** WINPR_RESTRICT ppG,
-                             const BYTE** WINPR_RESTRICT ppB, const BYTE** WINPR_RESTRICT ppA)
-{
-	WINPR_ASSERT(ppRgba);
-	WINPR_ASSERT(ppR);
-	WINPR_ASSERT(ppG);
-	WINPR_ASSERT(ppB);
-
-	switch (DstFormat)
-	{
-		case PIXEL_FORMAT_BGRA32:
-			for (UINT32 x = 0; x < width; x++)
-			{
-				*(*ppRgba)++ = *(*ppB)++;
-				*(*ppRgba)++ = *(*ppG)++;
-				*(*ppRgba)++ = *(*ppR)++;
-				*(*ppRgba)++ = *(*ppA)++;
-			}
-
-			return TRUE;
-
-		case PIXEL_FORMAT_BGRX32:
-			for (UINT32 x = 0; x < width; x++)
-			{
-				*(*ppRgba)++ = *(*ppB)++;
-				*(*ppRgba)++ = *(*ppG)++;
-				*(*ppRgba)++ = *(*ppR)++;
-				*(*ppRgba)++ = 0xFF;
-			}
-
-			return TRUE;
-
-		default:
-			if (ppA)
-			{
-				for (UINT32 x = 0; x < width; x++)
-				{
-					BYTE alpha = *(*ppA)++;
-					UINT32 color =
-					    FreeRDPGetColor(DstFormat, *(*ppR)++, *(*ppG)++, *(*ppB)++, alpha);
-					FreeRDPWriteColor(*ppRgba, DstFormat, color);
-					*ppRgba += FreeRDPGetBytesPerPixel(DstFormat);
-				}
-			}
-			else
-			{
-				const BYTE alpha = 0xFF;
-
-				for (UINT32 x = 0; x < width; x++)
-				{
-					UINT32 color =
-					    FreeRDPGetColor(DstFormat, *(*ppR)++, *(*ppG)++, *(*ppB)++, alpha);
-					FreeRDPWriteColor(*ppRgba, DstFormat, color);
-					*ppRgba += FreeRDPGetBytesPerPixel(DstFormat);
-				}
-			}
+	/* All but the first scanline are delta values relative to the previous scanline */
+	if (prims->planarDeltaDecode_8u(pDstData, nWidth, nHeight) != PRIMITIVES_SUCCESS)
+		return -1;
 
-			return TRUE;
-	}
+	return (INT32)used;
 }
 
 static INLINE BOOL planar_decompress_planes_raw(const BYTE* WINPR_RESTRICT pSrcData[4],
@@ -589,27 +306,10 @@ static INLINE BOOL planar_decompress_planes_raw(const BYTE* WINPR_RESTRICT pSrcD
                                                 UINT32 nWidth, UINT32 nHeight, BOOL vFlip,
                                                 UINT32 totalHeight)
 {
-	INT32 beg = 0;
-	INT32 end = 0;
-	INT32 inc = 0;
-	const BYTE* pR = pSrcData[0];
-	const BYTE* pG = pSrcData[1];
-	const BYTE* pB = pSrcData[2];
-	const BYTE* pA = pSrcData[3];
+	const primitives_t* prims = primitives_get();
 	const UINT32 bpp = FreeRDPGetBytesPerPixel(DstFormat);
 
-	if (vFlip)
-	{
-		beg = WINPR_ASSERTING_INT_CAST(int32_t, nHeight - 1);
-		end = -1;
-		inc = -1;
-	}
-	else
-	{
-		beg = 0;
-		end = WINPR_ASSERTING_INT_CAST(int32_t, nHeight);
-		inc = 1;
-	}
+	WINPR_ASSERT(prims);
 
 	if (nYDst + nHeight > totalHeight)
 	{
@@ -629,25 +329,15 @@ static INLINE BOOL planar_decompress_planes_raw(const BYTE* WINPR_RESTRICT pSrcD
 		return FALSE;
 	}
 
-	for (INT32 y = beg; y != end; y += inc)
-	{
-		BYTE* pRGB = NULL;
-
-		if (y > WINPR_ASSERTING_INT_CAST(INT64, nHeight))
-		{
-			WLog_ERR(TAG, "planar plane destination Y %" PRId32 " exceeds height %" PRIu32, y,
-			         nHeight);
-			return FALSE;
-		}
-
-		const intptr_t off = ((1LL * nYDst + y) * nDstStep) + (1LL * nXDst * bpp);
-		pRGB = &pDstData[off];
+	if ((nWidth == 0) || (nHeight == 0))
+		return TRUE;
 
-		if (!writeLine(&pRGB, DstFormat, nWidth, &pR, &pG, &pB, &pA))
-			return FALSE;
-	}
+	const UINT32 first = vFlip ? nYDst + nHeight - 1 : nYDst;
+	const INT32 step = WINPR_ASSERTING_INT_CAST(INT32, nDstStep);
+	BYTE* pRGB = &pDstData[(1ULL * first * nDstStep) + (1ULL * nXDst * bpp)];
 
-	return TRUE;
+	return prims->planarMerge_8u_P4AC4(pSrcData, pRGB, vFlip ? -step : step, DstFormat, nWidth,
+	                                   nHeight) == PRIMITIVES_SUCCESS;
 }
 
 static BOOL planar_subsample_expand(const BYTE* WINPR_RESTRICT plane, size_t planeLength,
@@ -889,6 +579,18 @@ BOOL planar_decompress(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 
 		if (rleSizes[2] < 1)
 			return FALSE;
+
+		if ((nSrcWidth > planar->maxWidth) || (nSrcHeight > planar->maxHeight))
+		{
+			/* RLE planes are decoded into the context plane buffers, grow them as needed */
+			const BOOL bgr = planar->bgr;
+
+			if (!freerdp_bitmap_planar_context_reset(planar, MAX(planar->maxWidth, nSrcWidth),
+			                                         MAX(planar->maxHeight, nSrcHeight)))
+				return FALSE;
+
+			planar->bgr = bgr;
+		}
 	}
 
 	if (!cll) /* RGB */
@@ -928,44 +630,48 @@ BOOL planar_decompress(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 		}
 		else /* RLE */
 		{
-			status = planar_decompress_plane_rle(
-			    planes[0], WINPR_ASSERTING_INT_CAST(uint32_t, rleSizes[0]), pTempData, nTempStep,
-			    nXDst, nYDst, nSrcWidth, nSrcHeight, 2, vFlip); /* RedPlane */
+			BYTE* rleBuffer[4] = { 0 };
 
-			if (status < 0)
+			if (!planar->rlePlanesBuffer)
 				return FALSE;
 
-			status = planar_decompress_plane_rle(
-			    planes[1], WINPR_ASSERTING_INT_CAST(uint32_t, rleSizes[1]), pTempData, nTempStep,
-			    nXDst, nYDst, nSrcWidth, nSrcHeight, 1, vFlip); /* GreenPlane */
+			rleBuffer[0] = planar->rlePlanesBuffer;  /* RedPlane */
+			rleBuffer[1] = rleBuffer[0] + planeSize; /* GreenPlane */
+			rleBuffer[2] = rleBuffer[1] + planeSize; /* BluePlane */
+			rleBuffer[3] = rleBuffer[2] + planeSize; /* AlphaPlane */
 
-			if (status < 0)
-				return FALSE;
-
-			status = planar_decompress_plane_rle(
-			    planes[2], WINPR_ASSERTING_INT_CAST(uint32_t, rleSizes[2]), pTempData, nTempStep,
-			    nXDst, nYDst, nSrcWidth, nSrcHeight, 0, vFlip); /* BluePlane */
+			for (size_t x = 0; x < 3; x++)
+			{
+				status = planar_decompress_plane_rle_only(
+				    planes[x], WINPR_ASSERTING_INT_CAST(uint32_t, rleSizes[x]), rleBuffer[x],
+				    nSrcWidth, nSrcHeight);
 
-			if (status < 0)
-				return FALSE;
+				if (status < 0)
+					return FALSE;
+			}
 
 			srcp += rleSizes[0] + rleSizes[1] + rleSizes[2];
 
 			if (useAlpha)
 			{
-				status = planar_decompress_plane_rle(
-				    planes[3], WINPR_ASSERTING_INT_CAST(uint32_t, rleSizes[3]), pTempData,
-				    nTempStep, nXDst, nYDst, nSrcWidth, nSrcHeight, 3, vFlip); /* AlphaPlane */
-			}
-			else
-				status = planar_set_plane(0xFF, pTempData, nTempStep, nXDst, nYDst, nSrcWidth,
-				                          nSrcHeight, 3, vFlip);
+				status = planar_decompress_plane_rle_only(
+				    planes[3], WINPR_ASSERTING_INT_CAST(uint32_t, rleSizes[3]), rleBuffer[3],
+				    nSrcWidth, nSrcHeight);
 
-			if (status < 0)
-				return FALSE;
+				if (status < 0)
+					return FALSE;
+			}
 
 			if (alpha)
 				srcp += rleSizes[3];
+
+			/* RLE planes are always written in BGRA channel order, independent of planar->bgr */
+			const BYTE* rlePlanes[4] = { rleBuffer[0], rleBuffer[1], rleBuffer[2],
+				                         useAlpha ? rleBuffer[3] : NULL };
+			if (!planar_decompress_planes_raw(
+			        rlePlanes, pTempData, useAlpha ? PIXEL_FORMAT_BGRA32 : PIXEL_FORMAT_BGRX32,
+			        nTempStep, nXDst, nYDst, nSrcWidth, nSrcHeight, vFlip, nTotalHeight))
+				return FALSE;
 		}
 
 		if (pTempData != pDstData)
@@ -1104,7 +810,10 @@ static INLINE BOOL freerdp_split_color_planes(BITMAP_PLANAR_CONTEXT* WINPR_RESTR
                                               UINT32 width, UINT32 height, UINT32 scanline,
                                               BYTE* WINPR_RESTRICT planes[4])
 {
+	const primitives_t* prims = primitives_get();
+
 	WINPR_ASSERT(planar);
+	WINPR_ASSERT(prims);
 
 	if ((width > INT32_MAX) || (height > INT32_MAX) || (scanline > INT32_MAX))
 		return FALSE;
@@ -1112,42 +821,19 @@ static INLINE BOOL freerdp_split_color_planes(BITMAP_PLANAR_CONTEXT* WINPR_RESTR
 	if (scanline == 0)
 		scanline = width * FreeRDPGetBytesPerPixel(format);
 
-	if (planar->topdown)
-	{
-		UINT32 k = 0;
-		for (UINT32 i = 0; i < height; i++)
-		{
-			const BYTE* pixel = &data[1ULL * scanline * i];
+	if (height == 0)
+		return TRUE;
 
-			for (UINT32 j = 0; j < width; j++)
-			{
-				const UINT32 color = FreeRDPReadColor(pixel, format);
-				pixel += FreeRDPGetBytesPerPixel(format);
-				FreeRDPSplitColor(color, format, &planes[1][k], &planes[2][k], &planes[3][k],
-				                  &planes[0][k], NULL);
-				k++;
-			}
-		}
-	}
-	else
-	{
-		UINT32 k = 0;
+	/* The context planes are ordered alpha, red, green, blue */
+	BYTE* dst[4] = { planes[1], planes[2], planes[3], planes[0] };
+	const INT32 step = (INT32)scanline;
 
-		for (INT64 i = (INT64)height - 1; i >= 0; i--)
-		{
-			const BYTE* pixel = &data[1ULL * scanline * (UINT32)i];
+	if (planar->topdown)
+		return prims->planarSplit_8u_AC4P4(data, step, format, dst, width, height) ==
+		       PRIMITIVES_SUCCESS;
 
-			for (UINT32 j = 0; j < width; j++)
-			{
-				const UINT32 color = FreeRDPReadColor(pixel, format);
-				pixel += FreeRDPGetBytesPerPixel(format);
-				FreeRDPSplitColor(color, format, &planes[1][k], &planes[2][k], &planes[3][k],
-				                  &planes[0][k], NULL);
-				k++;
-			}
-		}
-	}
-	return TRUE;
+	return prims->planarSplit_8u_AC4P4(&data[1ULL * scanline * (height - 1)], -step, format, dst,
+	                                   width, height) == PRIMITIVES_SUCCESS;
 }
 
 static INLINE UINT32 freerdp_bitmap_planar_write_rle_bytes(const BYTE* WINPR_RESTRICT pInBuffer,
@@ -1273,78 +959,37 @@ static INLINE UINT32 freerdp_bitmap_planar_encode_rle_bytes(const BYTE* WINPR_RE
                                                             BYTE* WINPR_RESTRICT pOutBuffer,
                                                             UINT32 outBufferSize)
 {
-	BYTE symbol = 0;
-	const BYTE* pInput = NULL;
-	BYTE* pOutput = NULL;
-	const BYTE* pBytes = NULL;
-	UINT32 cRawBytes = 0;
-	UINT32 nRunLength = 0;
-	UINT32 bSymbolMatch = 0;
-	UINT32 nBytesWritten = 0;
+	const primitives_t* prims = primitives_get();
+	UINT32 pos = 0;
 	UINT32 nTotalBytesWritten = 0;
-	symbol = 0;
-	cRawBytes = 0;
-	nRunLength = 0;
-	pInput = pInBuffer;
-	pOutput = pOutBuffer;
-	nTotalBytesWritten = 0;
+
+	WINPR_ASSERT(prims);
 
 	if (!outBufferSize)
 		return 0;
 
-	do
+	while (pos < inBufferSize)
 	{
-		if (!inBufferSize)
-			break;
-
-		bSymbolMatch = (symbol == *pInput) ? TRUE : FALSE;
-		symbol = *pInput;
-		pInput++;
-		inBufferSize--;
-
-		if (nRunLength && !bSymbolMatch)
-		{
-			if (nRunLength < 3)
-			{
-				cRawBytes += nRunLength;
-				nRunLength = 0;
-			}
-			else
-			{
-				pBytes = pInput - (cRawBytes + nRunLength + 1);
-				nBytesWritten = freerdp_bitmap_planar_write_rle_bytes(pBytes, cRawBytes, nRunLength,
-				                                                      pOutput, outBufferSize);
-				nRunLength = 0;
-
-				if (!nBytesWritten || (nBytesWritten > outBufferSize))
-					return nRunLength;
-
-				nTotalBytesWritten += nBytesWritten;
-				outBufferSize -= nBytesWritten;
-				pOutput += nBytesWritten;
-				cRawBytes = 0;
-			}
-		}
+		UINT32 cRawBytes = 0;
+		UINT32 nRunLength = 0;
+		/* A run repeats the byte before it, the scanline starts with an implicit 0 */
+		const BYTE symbol = (pos > 0) ? pInBuffer[pos - 1] : 0;
 
-		nRunLength += bSymbolMatch;
-		cRawBytes += (!bSymbolMatch) ? TRUE : FALSE;
-	} while (outBufferSize);
+		if (prims->planarFindRun_8u(&pInBuffer[pos], inBufferSize - pos, symbol, 3, &cRawBytes,
+		                            &nRunLength) != PRIMITIVES_SUCCESS)
+			return 0;
 
-	if (cRawBytes || nRunLength)
-	{
-		pBytes = pInput - (cRawBytes + nRunLength);
-		nBytesWritten = freerdp_bitmap_planar_write_rle_bytes(pBytes, cRawBytes, nRunLength,
-		                                                      pOutput, outBufferSize);
+		const UINT32 nBytesWritten = freerdp_bitmap_planar_write_rle_bytes(
+		    &pInBuffer[pos], cRawBytes, nRunLength, &pOutBuffer[nTotalBytesWritten], outBufferSize);
 
-		if (!nBytesWritten)
+		if (!nBytesWritten || (nBytesWritten > outBufferSize))
 			return 0;
 
 		nTotalBytesWritten += nBytesWritten;
+		outBufferSize -= nBytesWritten;
+		pos += cRawBytes + nRunLength;
 	}
 
-	if (inBufferSize)
-		return 0;
-
 	return nTotalBytesWritten;
 }
 
@@ -1446,40 +1091,28 @@ static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRIC
 BYTE* freerdp_bitmap_planar_delta_encode_plane(const BYTE* WINPR_RESTRICT inPlane, UINT32 width,
                                                UINT32 height, BYTE* WINPR_RESTRICT outPlane)
 {
-	BYTE* outPtr = NULL;
-	const BYTE* srcPtr = NULL;
-	const BYTE* prevLinePtr = NULL;
+	const primitives_t* prims = primitives_get();
+	BYTE* plane = outPlane;
 
-	if (!outPlane)
+	WINPR_ASSERT(prims);
+
+	if (!plane)
 	{
 		if (width * height == 0)
 			return NULL;
 
-		if (!(outPlane = (BYTE*)calloc(height, width)))
+		if (!(plane = (BYTE*)calloc(height, width)))
 			return NULL;
 	}
 
-	// first line is copied as is
-	CopyMemory(outPlane, inPlane, width);
-	outPtr = outPlane + width;
-	srcPtr = inPlane + width;
-	prevLinePtr = inPlane;
-
-	for (UINT32 y = 1; y < height; y++)
+	if (prims->planarDeltaEncode_8u(inPlane, plane, width, height) != PRIMITIVES_SUCCESS)
 	{
-		for (UINT32 x = 0; x < width; x++, outPtr++, srcPtr++, prevLinePtr++)
-		{
-			INT32 delta = *srcPtr - *prevLinePtr;
-			BYTE s2c = WINPR_ASSERTING_INT_CAST(
-			    BYTE, (delta >= 0) ? delta : (~((BYTE)(-delta)) + 1) & 0xFF);
-			s2c = WINPR_ASSERTING_INT_CAST(
-			    BYTE,
-			    (s2c >= 0) ? (s2c << 1) & 0xFF : (((UINT32)(~((BYTE)s2c) + 1) << 1) - 1) & 0xFF);
-			*outPtr = s2c;
-		}
+		if (!outPlane)
+			free(plane);
+		return NULL;
 	}
 
-	return outPlane;
+	return plane;
 }
 
 static INLINE BOOL freerdp_bitmap_planar_delta_encode_planes(BYTE* WINPR_RESTRICT inPlanes[4],
@@ -37,6 +37,7 @@
 #include "rfx_quantization.h"
 #include "rfx_dwt.h"
 #include "rfx_rlgr.h"
+#include "rfx_bitstream.h"
 #include "rfx_constants.h"
 #include "rfx_types.h"
 #include "progressive.h"
@@ -46,8 +47,8 @@
 typedef struct
 {
 	BOOL nonLL;
-	wBitStream* srl;
-	wBitStream* raw;
+	RFX_BIT_READER* srl;
+	RFX_BIT_READER* raw;
 
 	/* SRL state */
 
@@ -978,7 +979,7 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 {
 	WINPR_ASSERT(state);
 
-	wBitStream* bs = state->srl;
+	RFX_BIT_READER* bs = state->srl;
 	WINPR_ASSERT(bs);
 
 	if (state->nz)
@@ -992,8 +993,7 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 	if (!state->mode)
 	{
 		/* zero encoding */
-		const UINT32 bit = (bs->accumulator & 0x80000000) ? 1 : 0;
-		BitStream_Shift(bs, 1);
+		const UINT32 bit = rfx_bit_reader_read(bs, 1);
 
 		if (!bit)
 		{
@@ -1015,10 +1015,8 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 
 			if (k)
 			{
-				bs->mask = ((1 << k) - 1);
-				state->nz =
-				    WINPR_ASSERTING_INT_CAST(int16_t, ((bs->accumulator >> (32u - k)) & bs->mask));
-				BitStream_Shift(bs, k);
+				const UINT32 nz = rfx_bit_reader_read(bs, k);
+				state->nz = WINPR_ASSERTING_INT_CAST(int16_t, nz);
 			}
 
 			if (state->nz)
@@ -1032,8 +1030,7 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 	state->mode = 0; /* zero encoding is next */
 	/* unary encoding */
 	/* read sign bit */
-	const UINT32 sign = (bs->accumulator & 0x80000000) ? 1 : 0;
-	BitStream_Shift(bs, 1);
+	const UINT32 sign = rfx_bit_reader_read(bs, 1);
 
 	if (state->kp < 6)
 		state->kp = 0;
@@ -1046,16 +1043,12 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 	UINT32 mag = 1;
 	const UINT32 max = (1 << numBits) - 1;
 
-	while (mag < max)
-	{
-		const UINT32 bit = (bs->accumulator & 0x80000000) ? 1 : 0;
-		BitStream_Shift(bs, 1);
-
-		if (bit)
-			break;
-
-		mag++;
-	}
+	/* the magnitude is the number of '0' bits before a terminating '1' bit, but at most max - 1
+	 * bits are read. */
+	const size_t run = rfx_bit_reader_skip_run(bs, FALSE, max - mag);
+	mag += WINPR_ASSERTING_INT_CAST(UINT32, run);
+	if (mag < max)
+		rfx_bit_reader_skip(bs, 1);
 
 	if (mag > INT16_MAX)
 		mag = INT16_MAX;
@@ -1065,27 +1058,15 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 static INLINE int
 progressive_rfx_upgrade_state_finish(RFX_PROGRESSIVE_UPGRADE_STATE* WINPR_RESTRICT state)
 {
-	UINT32 pad = 0;
-	wBitStream* srl = NULL;
-	wBitStream* raw = NULL;
 	if (!state)
 		return -1;
 
-	srl = state->srl;
-	raw = state->raw;
 	/* Read trailing bits from RAW/SRL bit streams */
-	pad = (raw->position % 8) ? (8 - (raw->position % 8)) : 0;
-
-	if (pad)
-		BitStream_Shift(raw, pad);
+	rfx_bit_reader_align(state->raw);
+	rfx_bit_reader_align(state->srl);
 
-	pad = (srl->position % 8) ? (8 - (srl->position % 8)) : 0;
-
-	if (pad)
-		BitStream_Shift(srl, pad);
-
-	if (BitStream_GetRemainingLength(srl) == 8)
-		BitStream_Shift(srl, 8);
+	if (rfx_bit_reader_remaining(state->srl) == 8)
+		(void)rfx_bit_reader_read(state->srl, 8);
 
 	return 1;
 }
@@ -1099,17 +1080,17 @@ static INLINE int progressive_rfx_upgrade_block(RFX_PROGRESSIVE_UPGRADE_STATE* W
 	if (!numBits)
 		return 1;
 
-	wBitStream* raw = state->raw;
-	int32_t input = 0;
+	/* coefficients are 16 bit, larger values stem from inconsistent quantization values */
+	if (numBits > 16)
+		return -1;
+
+	RFX_BIT_READER* raw = state->raw;
 
 	if (!state->nonLL)
 	{
 		for (UINT32 index = 0; index < length; index++)
 		{
-			raw->mask = ((1 << numBits) - 1);
-			input = (INT16)((raw->accumulator >> (32 - numBits)) & raw->mask);
-			BitStream_Shift(raw, numBits);
-
+			const int32_t input = (INT16)rfx_bit_reader_read(raw, numBits);
 			const int32_t shifted = input << shift;
 			const int32_t val = buffer[index] + shifted;
 			const int16_t ival = WINPR_ASSERTING_INT_CAST(int16_t, val);
@@ -1121,20 +1102,20 @@ static INLINE int progressive_rfx_upgrade_block(RFX_PROGRESSIVE_UPGRADE_STATE* W
 
 	for (UINT32 index = 0; index < length; index++)
 	{
-		if (sign[index] > 0)
+		int32_t input = 0;
+
+		if (sign[index] != 0)
 		{
-			/* sign > 0, read from raw */
-			raw->mask = ((1 << numBits) - 1);
-			input = (INT16)((raw->accumulator >> (32 - numBits)) & raw->mask);
-			BitStream_Shift(raw, numBits);
+			/* sign != 0, read from raw */
+			input = (INT16)rfx_bit_reader_read(raw, numBits);
+			if (sign[index] < 0)
+				input *= -1;
 		}
-		else if (sign[index] < 0)
+		else if (state->nz > 0)
 		{
-			/* sign < 0, read from raw */
-			raw->mask = ((1 << numBits) - 1);
-			input = (INT16)((raw->accumulator >> (32 - numBits)) & raw->mask);
-			BitStream_Shift(raw, numBits);
-			input *= -1;
+			/* sign == 0 inside a SRL zero run, the coefficient does not change */
+			state->nz--;
+			continue;
 		}
 		else
 		{
@@ -1163,18 +1144,16 @@ static INLINE int progressive_rfx_upgrade_component(
 	int rc = 0;
 	UINT32 aRawLen = 0;
 	UINT32 aSrlLen = 0;
-	wBitStream s_srl = { 0 };
-	wBitStream s_raw = { 0 };
+	RFX_BIT_READER s_srl = { 0 };
+	RFX_BIT_READER s_raw = { 0 };
 	RFX_PROGRESSIVE_UPGRADE_STATE state = { 0 };
 
 	state.kp = 8;
 	state.mode = 0;
 	state.srl = &s_srl;
 	state.raw = &s_raw;
-	BitStream_Attach(state.srl, srlData, srlLen);
-	BitStream_Fetch(state.srl);
-	BitStream_Attach(state.raw, rawData, rawLen);
-	BitStream_Fetch(state.raw);
+	rfx_bit_reader_init(state.srl, srlData, srlLen);
+	rfx_bit_reader_init(state.raw, rawData, rawLen);
 
 	state.nonLL = TRUE;
 	rc = progressive_rfx_upgrade_block(&state, &current[0], &sign[0], 1023, shift->HL1, bitPos->HL1,
@@ -1222,8 +1201,8 @@ static INLINE int progressive_rfx_upgrade_component(
 	rc = progressive_rfx_upgrade_state_finish(&state);
 	if (rc < 0)
 		return rc;
-	aRawLen = (state.raw->position + 7) / 8;
-	aSrlLen = (state.srl->position + 7) / 8;
+	aRawLen = WINPR_ASSERTING_INT_CAST(UINT32, (state.raw->position + 7) / 8);
+	aSrlLen = WINPR_ASSERTING_INT_CAST(UINT32, (state.srl->position + 7) / 8);
 
 	if ((aRawLen != rawLen) || (aSrlLen != srlLen))
 	{
@@ -1237,11 +1216,11 @@ static INLINE int progressive_rfx_upgrade_component(
 			pSrlLen = (int)((((float)aSrlLen) / ((float)srlLen)) * 100.0f);
 
 		WLog_Print(progressive->log, WLOG_WARN,
-		           "RAW: %" PRIu32 "/%" PRIu32 " %d%% (%" PRIu32 "/%" PRIu32 ":%" PRIu32
-		           ")\tSRL: %" PRIu32 "/%" PRIu32 " %d%% (%" PRIu32 "/%" PRIu32 ":%" PRIu32 ")",
+		           "RAW: %" PRIu32 "/%" PRIu32 " %d%% (%" PRIuz "/%" PRIu32 ":%" PRIuz
+		           ")\tSRL: %" PRIu32 "/%" PRIu32 " %d%% (%" PRIuz "/%" PRIu32 ":%" PRIuz ")",
 		           aRawLen, rawLen, pRawLen, state.raw->position, rawLen * 8,
-		           (rawLen * 8) - state.raw->position, aSrlLen, srlLen, pSrlLen,
-		           state.srl->position, srlLen * 8, (srlLen * 8) - state.srl->position);
+		           rfx_bit_reader_remaining(state.raw), aSrlLen, srlLen, pSrlLen,
+		           state.srl->position, srlLen * 8, rfx_bit_reader_remaining(state.srl));
 		return -1;
 	}
 
@@ -1605,7 +1584,6 @@ static INLINE SSIZE_T progressive_process_tiles(
 	UINT16 blockType = 0;
 	UINT32 blockLen = 0;
 	UINT32 count = 0;
-	UINT16 close_cnt = 0;
 
 	WINPR_ASSERT(progressive);
 	WINPR_ASSERT(region);
@@ -1698,20 +1676,14 @@ static INLINE SSIZE_T progressive_process_tiles(
 
 		if (progressive->rfx_context->priv->UseThreads)
 		{
-			progressive->work_objects[idx] =
-			    CreateThreadpoolWork(progressive_process_tiles_tile_work_callback, (void*)param,
-			                         &progressive->rfx_context->priv->ThreadPoolEnv);
-			if (!progressive->work_objects[idx])
+			if (!codec_queue_submit(progressive->rfx_context->priv->Queue,
+			                        progressive_process_tiles_tile_work_callback, (void*)param))
 			{
 				WLog_Print(progressive->log, WLOG_ERROR,
-				           "Failed to create ThreadpoolWork for tile %" PRIu32, idx);
+				           "Failed to submit work for tile %" PRIu32, idx);
 				status = -1;
 				break;
 			}
-
-			SubmitThreadpoolWork(progressive->work_objects[idx]);
-
-			close_cnt = WINPR_ASSERTING_INT_CAST(UINT16, idx + 1);
 		}
 		else
 		{
@@ -1727,13 +1699,7 @@ static INLINE SSIZE_T progressive_process_tiles(
 	}
 
 	if (progressive->rfx_context->priv->UseThreads)
-	{
-		for (UINT32 idx = 0; idx < close_cnt; idx++)
-		{
-			WaitForThreadpoolWorkCallbacks(progressive->work_objects[idx], FALSE);
-			CloseThreadpoolWork(progressive->work_objects[idx]);
-		}
-	}
+		codec_queue_wait(progressive->rfx_context->priv->Queue);
 
 fail:
 
@@ -2395,6 +2361,820 @@ BOOL progressive_rfx_write_message_progressive_simple(
 	return rfx_write_message_progressive_simple(context, s, msg);
 }
 
+/**
+ * Multi pass encoder
+ *
+ * Tiles are sent as TILE_FIRST with the coarsest quantization of the configured quantProgVal
+ * schedule. The full precision coefficients are kept per tile so that later messages can refine
+ * stable tiles with TILE_UPGRADE blocks, one schedule step at a time.
+ */
+
+typedef struct
+{
+	UINT16 offset;
+	UINT16 length;
+} PROGRESSIVE_ENCODER_BAND;
+
+/* Band layout of a reduce extrapolate DWT: HL1, LH1, HH1, HL2, LH2, HH2, HL3, LH3, HH3, LL3 */
+static const PROGRESSIVE_ENCODER_BAND progressive_encoder_bands[10] = {
+	{ 0, 1023 },    { 1023, 1023 }, { 2046, 961 }, { 3007, 272 }, { 3279, 272 },
+	{ 3551, 256 },  { 3807, 72 },   { 3879, 72 },  { 3951, 64 },  { 4015, 81 }
+};
+
+/* Same defaults as the RemoteFX encoder */
+static const RFX_COMPONENT_CODEC_QUANT progressive_encoder_quant = { 6, 6, 6, 6, 7, 7, 8, 8, 8, 9 };
+
+typedef struct
+{
+	wBitStream* bs;
+	UINT32 kp;
+	UINT32 run;
+} RFX_PROGRESSIVE_SRL_STATE;
+
+static INLINE BYTE progressive_rfx_quant_band(const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT q,
+                                              size_t band)
+{
+	switch (band)
+	{
+		case 0:
+			return q->HL1;
+		case 1:
+			return q->LH1;
+		case 2:
+			return q->HH1;
+		case 3:
+			return q->HL2;
+		case 4:
+			return q->LH2;
+		case 5:
+			return q->HH2;
+		case 6:
+			return q->HL3;
+		case 7:
+			return q->LH3;
+		case 8:
+			return q->HH3;
+		default:
+			return q->LL3;
+	}
+}
+
+static INLINE void
+progressive_component_codec_quant_write(wStream* WINPR_RESTRICT s,
+                                        const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT quantVal)
+{
+	Stream_Write_UINT8(s, (BYTE)(quantVal->LL3 | (quantVal->HL3 << 4)));
+	Stream_Write_UINT8(s, (BYTE)(quantVal->LH3 | (quantVal->HH3 << 4)));
+	Stream_Write_UINT8(s, (BYTE)(quantVal->HL2 | (quantVal->LH2 << 4)));
+	Stream_Write_UINT8(s, (BYTE)(quantVal->HH2 | (quantVal->HL1 << 4)));
+	Stream_Write_UINT8(s, (BYTE)(quantVal->LH1 | (quantVal->HH1 << 4)));
+}
+
+/**
+ * Forward lifting step matching progressive_rfx_idwt_x / progressive_rfx_idwt_y.
+ * 64 samples produce 33 low and 31 high band values, odd counts (33, 17) produce
+ * (count + 1) / 2 low and (count - 1) / 2 high band values.
+ */
+static INLINE void progressive_rfx_dwt_1d(const INT16* WINPR_RESTRICT pSrc, size_t nSrcStep,
+                                          size_t nCount, INT16* WINPR_RESTRICT pLow,
+                                          size_t nLowStep, INT16* WINPR_RESTRICT pHigh,
+                                          size_t nHighStep)
+{
+	const BOOL even = (nCount % 2) == 0;
+	const size_t nHigh = even ? (nCount / 2) - 1 : (nCount - 1) / 2;
+	INT32 prev = 0;
+
+	for (size_t n = 0; n < nHigh; n++)
+	{
+		const INT32 x0 = pSrc[(2 * n) * nSrcStep];
+		const INT32 x1 = pSrc[(2 * n + 1) * nSrcStep];
+		const INT32 x2 = pSrc[(2 * n + 2) * nSrcStep];
+		const INT32 h = (x1 - ((x0 + x2) / 2)) / 2;
+
+		pHigh[n * nHighStep] = clampi16(h);
+
+		if (n == 0)
+			pLow[0] = clampi16(x0 + h);
+		else
+			pLow[n * nLowStep] = clampi16(x0 + ((prev + h) / 2));
+
+		prev = pHigh[n * nHighStep];
+	}
+
+	if (even)
+	{
+		/* The last odd sample is interpolated against an extrapolated sample */
+		const INT32 x0 = pSrc[(nCount - 2) * nSrcStep];
+		const INT32 x1 = pSrc[(nCount - 1) * nSrcStep];
+
+		pLow[nHigh * nLowStep] = clampi16(x0 + (prev / 2));
+		pLow[(nHigh + 1) * nLowStep] = clampi16((2 * x1) - x0);
+	}
+	else
+	{
+		const INT32 x0 = pSrc[(nCount - 1) * nSrcStep];
+		pLow[nHigh * nLowStep] = clampi16(x0 + prev);
+	}
+}
+
+static INLINE void progressive_rfx_dwt_2d_encode_block(INT16* WINPR_RESTRICT buffer,
+                                                       INT16* WINPR_RESTRICT temp, size_t level)
+{
+	const size_t nBandL = progressive_rfx_get_band_l_count(level);
+	const size_t nBandH = progressive_rfx_get_band_h_count(level);
+	const size_t nCount = nBandL + nBandH;
+	INT16* L = &temp[0];
+	INT16* H = &temp[nBandL * nCount];
+	INT16* HL = &buffer[0];
+	INT16* LH = &HL[nBandL * nBandH];
+	INT16* HH = &LH[nBandH * nBandL];
+	INT16* LL = &HH[nBandH * nBandH];
+
+	/* vertical (input -> L + H) */
+	for (size_t x = 0; x < nCount; x++)
+		progressive_rfx_dwt_1d(&buffer[x], nCount, nCount, &L[x], nCount, &H[x], nCount);
+
+	/* horizontal (L -> LL + HL, H -> LH + HH) */
+	for (size_t y = 0; y < nBandL; y++)
+		progressive_rfx_dwt_1d(&L[y * nCount], 1, nCount, &LL[y * nBandL], 1, &HL[y * nBandH],
+		                       1);
+
+	for (size_t y = 0; y < nBandH; y++)
+		progressive_rfx_dwt_1d(&H[y * nCount], 1, nCount, &LH[y * nBandL], 1, &HH[y * nBandH],
+		                       1);
+}
+
+static INLINE void progressive_rfx_dwt_2d_extrapolate_encode(INT16* WINPR_RESTRICT buffer,
+                                                             INT16* WINPR_RESTRICT temp)
+{
+	progressive_rfx_dwt_2d_encode_block(&buffer[0], temp, 1);
+	progressive_rfx_dwt_2d_encode_block(&buffer[3007], temp, 2);
+	progressive_rfx_dwt_2d_encode_block(&buffer[3807], temp, 3);
+}
+
+/**
+ * Quantize to full precision. High bands are stored as sign and magnitude so that bit planes can
+ * be sent with the SRL/RAW scheme, LL3 is stored two's complement as its upgrades are unsigned.
+ */
+static INLINE void progressive_rfx_quantize_component(const INT16* WINPR_RESTRICT buffer,
+                                                      const RFX_COMPONENT_CODEC_QUANT* quant,
+                                                      INT16* WINPR_RESTRICT coeffs)
+{
+	for (size_t band = 0; band < ARRAYSIZE(progressive_encoder_bands); band++)
+	{
+		const PROGRESSIVE_ENCODER_BAND* b = &progressive_encoder_bands[band];
+		const UINT32 shift = progressive_rfx_quant_band(quant, band) - 1u;
+		const INT32 half = 1 << (shift - 1);
+
+		for (size_t i = b->offset; i < 1ull * b->offset + b->length; i++)
+		{
+			const INT32 c = buffer[i];
+
+			if (band == 9)
+				coeffs[i] = (INT16)((c + half) >> shift);
+			else if (c < 0)
+				coeffs[i] = (INT16)(-(((-c) + half) >> shift));
+			else
+				coeffs[i] = (INT16)((c + half) >> shift);
+		}
+	}
+}
+
+static INLINE INT16 progressive_rfx_coeff_at(INT16 coeff, BYTE progQuant)
+{
+	if (coeff < 0)
+		return (INT16)(-((-coeff) >> progQuant));
+	return (INT16)(coeff >> progQuant);
+}
+
+static BOOL progressive_encoder_load_tile(PROGRESSIVE_ENCODER_SURFACE* WINPR_RESTRICT encoder,
+                                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                                          UINT32 ScanLine, UINT32 x, UINT32 y,
+                                          INT16* WINPR_RESTRICT pRGB[3])
+{
+	const UINT32 width = MIN(64, encoder->width - x);
+	const UINT32 height = MIN(64, encoder->height - y);
+	UINT32* pixels = encoder->pixels;
+
+	if (!freerdp_image_copy_no_overlap((BYTE*)pixels, PIXEL_FORMAT_BGRX32, 64 * sizeof(UINT32), 0,
+	                                   0, width, height, pSrcData, SrcFormat, ScanLine, x, y, NULL,
+	                                   FREERDP_FLIP_NONE))
+		return FALSE;
+
+	/* Replicate the right-most column and bottom line for partial tiles, as RemoteFX does */
+	for (UINT32 j = 0; j < 64; j++)
+	{
+		const UINT32* src = &pixels[MIN(j, height - 1) * 64];
+		INT16* r = &pRGB[0][j * 64];
+		INT16* g = &pRGB[1][j * 64];
+		INT16* b = &pRGB[2][j * 64];
+
+		for (UINT32 i = 0; i < 64; i++)
+		{
+			const UINT32 color = src[MIN(i, width - 1)];
+			b[i] = (INT16)(color & 0xFF);
+			g[i] = (INT16)((color >> 8) & 0xFF);
+			r[i] = (INT16)((color >> 16) & 0xFF);
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL progressive_encode_tile_first(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                          PROGRESSIVE_ENCODER_TILE* WINPR_RESTRICT tile,
+                                          UINT16 xIdx, UINT16 yIdx, BYTE quality,
+                                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                                          UINT32 ScanLine, wStream* WINPR_RESTRICT s)
+{
+	static const prim_size_t roi_64x64 = { 64, 64 };
+	BOOL rc = FALSE;
+	UINT16 len[3] = { 0 };
+	INT16* pSrcDst[3] = { 0 };
+	PROGRESSIVE_ENCODER_SURFACE* encoder = &progressive->encoder;
+	const primitives_t* prims = primitives_get();
+	const BYTE progQuant = progressive->quantProgSchedule[quality];
+	BYTE* pBuffer = (BYTE*)BufferPool_Take(progressive->bufferPool, -1);
+	INT16* temp = (INT16*)BufferPool_Take(progressive->bufferPool, -1);
+
+	if (!pBuffer || !temp)
+		goto fail;
+
+	pSrcDst[0] = (INT16*)((&pBuffer[((8192 + 32) * 0) + 16])); /* Y/R buffer */
+	pSrcDst[1] = (INT16*)((&pBuffer[((8192 + 32) * 1) + 16])); /* Cb/G buffer */
+	pSrcDst[2] = (INT16*)((&pBuffer[((8192 + 32) * 2) + 16])); /* Cr/B buffer */
+
+	if (!progressive_encoder_load_tile(encoder, pSrcData, SrcFormat, ScanLine, xIdx * 64u,
+	                                   yIdx * 64u, pSrcDst))
+		goto fail;
+
+	const INT16** ptr = WINPR_REINTERPRET_CAST(pSrcDst, INT16**, const INT16**);
+	if (prims->RGBToYCbCr_16s16s_P3P3(ptr, 64 * sizeof(INT16), pSrcDst, 64 * sizeof(INT16),
+	                                  &roi_64x64) != PRIMITIVES_SUCCESS)
+		goto fail;
+
+	const size_t start = Stream_GetPosition(s);
+	const size_t blockLenMax = 23ull + 3ull * UINT16_MAX;
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLenMax))
+		goto fail;
+
+	Stream_Seek(s, 23);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		INT16* data = pSrcDst[c];
+
+		progressive_rfx_dwt_2d_extrapolate_encode(data, temp);
+		progressive_rfx_quantize_component(data, &progressive_encoder_quant, tile->coeffs[c]);
+
+		for (size_t i = 0; i < 4015; i++)
+			data[i] = progressive_rfx_coeff_at(tile->coeffs[c][i], progQuant);
+
+		for (size_t i = 4015; i < 4096; i++)
+			data[i] = (INT16)(tile->coeffs[c][i] >> progQuant);
+
+		rfx_differential_encode(&data[4015], 81);
+
+		/* The RLGR encoder expects a zeroed output buffer */
+		ZeroMemory(Stream_Pointer(s), UINT16_MAX);
+		const int rlen = progressive->rfx_context->rlgr_encode(RLGR1, data, 4096,
+		                                                       Stream_Pointer(s), UINT16_MAX);
+
+		if ((rlen <= 0) || (rlen >= UINT16_MAX))
+			goto fail;
+
+		len[c] = (UINT16)rlen;
+		Stream_Seek(s, len[c]);
+	}
+
+	const size_t end = Stream_GetPosition(s);
+	const UINT32 blockLen = WINPR_ASSERTING_INT_CAST(UINT32, end - start);
+	Stream_SetPosition(s, start);
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_FIRST); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                   /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, xIdx);                       /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, yIdx);                       /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, 0);                           /* flags (1 byte) */
+	Stream_Write_UINT8(s, quality);                     /* quality (1 byte) */
+	Stream_Write_UINT16(s, len[0]);                     /* yLen (2 bytes) */
+	Stream_Write_UINT16(s, len[1]);                     /* cbLen (2 bytes) */
+	Stream_Write_UINT16(s, len[2]);                     /* crLen (2 bytes) */
+	Stream_Write_UINT16(s, 0);                          /* tailLen (2 bytes) */
+	Stream_SetPosition(s, end);
+
+	tile->valid = TRUE;
+	tile->progQuant = progQuant;
+	rc = TRUE;
+fail:
+	BufferPool_Return(progressive->bufferPool, temp);
+	BufferPool_Return(progressive->bufferPool, pBuffer);
+	return rc;
+}
+
+static INLINE void progressive_rfx_srl_write_bits(wBitStream* WINPR_RESTRICT bs, UINT32 bits,
+                                                  UINT32 nbits)
+{
+	while (nbits > 16)
+	{
+		BitStream_Write_Bits(bs, 0, 16);
+		nbits -= 16;
+	}
+
+	if (nbits > 0)
+		BitStream_Write_Bits(bs, bits, nbits);
+}
+
+static INLINE void progressive_rfx_srl_zero_run(RFX_PROGRESSIVE_SRL_STATE* WINPR_RESTRICT state)
+{
+	/* '0' bit, a run of (1 << k) zeros */
+	const UINT32 k = state->kp / 8;
+
+	BitStream_Write_Bits(state->bs, 0, 1);
+	state->run -= MIN(state->run, 1u << k);
+	state->kp = MIN(state->kp + 4, 80);
+}
+
+/* Inverse of progressive_rfx_srl_read */
+static INLINE void progressive_rfx_srl_write(RFX_PROGRESSIVE_SRL_STATE* WINPR_RESTRICT state,
+                                             INT16 value, UINT32 numBits)
+{
+	if (value == 0)
+	{
+		state->run++;
+		return;
+	}
+
+	while (state->run >= (1u << (state->kp / 8)))
+		progressive_rfx_srl_zero_run(state);
+
+	/* '1' bit followed by the remaining run length in k bits */
+	const UINT32 k = state->kp / 8;
+	BitStream_Write_Bits(state->bs, 1, 1);
+
+	if (k)
+		BitStream_Write_Bits(state->bs, state->run, k);
+
+	state->run = 0;
+	BitStream_Write_Bits(state->bs, (value < 0) ? 1 : 0, 1);
+
+	if (state->kp < 6)
+		state->kp = 0;
+	else
+		state->kp -= 6;
+
+	if (numBits == 1)
+		return;
+
+	/* unary magnitude, the terminating bit is omitted for the largest magnitude */
+	const UINT32 mag = (UINT32)abs(value);
+	const UINT32 max = (1u << numBits) - 1;
+	progressive_rfx_srl_write_bits(state->bs, 0, mag - 1);
+
+	if (mag < max)
+		BitStream_Write_Bits(state->bs, 1, 1);
+}
+
+static INLINE void progressive_rfx_srl_finish(RFX_PROGRESSIVE_SRL_STATE* WINPR_RESTRICT state)
+{
+	while (state->run > 0)
+		progressive_rfx_srl_zero_run(state);
+}
+
+static BOOL progressive_rfx_upgrade_encode_component(
+    PROGRESSIVE_ENCODER_SURFACE* WINPR_RESTRICT encoder, const INT16* WINPR_RESTRICT coeffs,
+    BYTE oldProgQuant, BYTE newProgQuant, wStream* WINPR_RESTRICT s, UINT16* WINPR_RESTRICT srlLen,
+    UINT16* WINPR_RESTRICT rawLen)
+{
+	const UINT32 numBits = oldProgQuant - newProgQuant;
+	const UINT32 mask = (1u << numBits) - 1;
+	wBitStream s_srl = { 0 };
+	wBitStream s_raw = { 0 };
+	RFX_PROGRESSIVE_SRL_STATE state = { 0 };
+
+	state.bs = &s_srl;
+	state.kp = 8;
+	BitStream_Attach(&s_srl, encoder->srl, UINT16_MAX);
+	BitStream_Attach(&s_raw, encoder->raw, UINT16_MAX);
+
+	for (size_t i = 0; i < 4015; i++)
+	{
+		const INT16 coeff = coeffs[i];
+		const UINT32 mag = (UINT32)abs(coeff);
+
+		if ((mag >> oldProgQuant) != 0)
+			BitStream_Write_Bits(&s_raw, (mag >> newProgQuant) & mask, numBits);
+		else
+			progressive_rfx_srl_write(&state, progressive_rfx_coeff_at(coeff, newProgQuant),
+			                          numBits);
+
+		/* Bail out before the bit streams run out of space */
+		if ((s_srl.position > 8ull * (UINT16_MAX - 64)) ||
+		    (s_raw.position > 8ull * (UINT16_MAX - 64)))
+			return FALSE;
+	}
+
+	for (size_t i = 4015; i < 4096; i++)
+		BitStream_Write_Bits(&s_raw, (UINT32)(coeffs[i] >> newProgQuant) & mask, numBits);
+
+	progressive_rfx_srl_finish(&state);
+	BitStream_Flush(&s_srl);
+	BitStream_Flush(&s_raw);
+
+	*srlLen = (UINT16)((s_srl.position + 7) / 8);
+	*rawLen = (UINT16)((s_raw.position + 7) / 8);
+
+	if (!Stream_EnsureRemainingCapacity(s, 1ull * *srlLen + *rawLen))
+		return FALSE;
+
+	Stream_Write(s, encoder->srl, *srlLen);
+	Stream_Write(s, encoder->raw, *rawLen);
+	return TRUE;
+}
+
+static BOOL progressive_encode_tile_upgrade(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                            PROGRESSIVE_ENCODER_TILE* WINPR_RESTRICT tile,
+                                            UINT16 xIdx, UINT16 yIdx, BYTE quality,
+                                            wStream* WINPR_RESTRICT s)
+{
+	UINT16 srlLen[3] = { 0 };
+	UINT16 rawLen[3] = { 0 };
+	const BYTE progQuant = progressive->quantProgSchedule[quality];
+	const size_t start = Stream_GetPosition(s);
+
+	if (!Stream_EnsureRemainingCapacity(s, 26))
+		return FALSE;
+
+	Stream_Seek(s, 26);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		if (!progressive_rfx_upgrade_encode_component(&progressive->encoder, tile->coeffs[c],
+		                                              tile->progQuant, progQuant, s, &srlLen[c],
+		                                              &rawLen[c]))
+		{
+			Stream_SetPosition(s, start);
+			return FALSE;
+		}
+	}
+
+	const size_t end = Stream_GetPosition(s);
+	const UINT32 blockLen = WINPR_ASSERTING_INT_CAST(UINT32, end - start);
+	Stream_SetPosition(s, start);
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_UPGRADE); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                     /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, xIdx);                         /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, yIdx);                         /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, quality);                       /* quality (1 byte) */
+	Stream_Write_UINT16(s, srlLen[0]);                    /* ySrlLen (2 bytes) */
+	Stream_Write_UINT16(s, rawLen[0]);                    /* yRawLen (2 bytes) */
+	Stream_Write_UINT16(s, srlLen[1]);                    /* cbSrlLen (2 bytes) */
+	Stream_Write_UINT16(s, rawLen[1]);                    /* cbRawLen (2 bytes) */
+	Stream_Write_UINT16(s, srlLen[2]);                    /* crSrlLen (2 bytes) */
+	Stream_Write_UINT16(s, rawLen[2]);                    /* crRawLen (2 bytes) */
+	Stream_SetPosition(s, end);
+
+	tile->progQuant = progQuant;
+	return TRUE;
+}
+
+static INT32 progressive_encoder_next_pass(const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                           const PROGRESSIVE_ENCODER_TILE* WINPR_RESTRICT tile)
+{
+	if (!tile->valid || tile->dirty)
+		return -1;
+
+	for (UINT32 x = 0; x < progressive->numQuantProgSchedule; x++)
+	{
+		if (progressive->quantProgSchedule[x] < tile->progQuant)
+			return (INT32)x;
+	}
+
+	return -1;
+}
+
+static void progressive_encoder_surface_free(PROGRESSIVE_ENCODER_SURFACE* encoder)
+{
+	WINPR_ASSERT(encoder);
+
+	winpr_aligned_free(encoder->tiles);
+	winpr_aligned_free(encoder->pixels);
+	free(encoder->srl);
+	free(encoder->raw);
+	Stream_Free(encoder->tileData, TRUE);
+
+	const PROGRESSIVE_ENCODER_SURFACE empty = { 0 };
+	*encoder = empty;
+}
+
+static BOOL progressive_encoder_surface_reset(PROGRESSIVE_ENCODER_SURFACE* encoder, UINT32 width,
+                                              UINT32 height)
+{
+	WINPR_ASSERT(encoder);
+
+	if (encoder->tiles && (encoder->width == width) && (encoder->height == height))
+		return TRUE;
+
+	progressive_encoder_surface_free(encoder);
+
+	encoder->width = width;
+	encoder->height = height;
+	encoder->gridWidth = (width + 63) / 64;
+	encoder->gridHeight = (height + 63) / 64;
+
+	const size_t count = 1ull * encoder->gridWidth * encoder->gridHeight;
+	encoder->tiles = winpr_aligned_calloc(count, sizeof(PROGRESSIVE_ENCODER_TILE), 32);
+	encoder->pixels = winpr_aligned_calloc(64 * 64, sizeof(UINT32), 32);
+	encoder->srl = calloc(UINT16_MAX, 1);
+	encoder->raw = calloc(UINT16_MAX, 1);
+	encoder->tileData = Stream_New(NULL, 4096);
+
+	if (!encoder->tiles || !encoder->pixels || !encoder->srl || !encoder->raw ||
+	    !encoder->tileData)
+	{
+		progressive_encoder_surface_free(encoder);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL progressive_encoder_write_message(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                              wStream* WINPR_RESTRICT s, UINT16 numRects,
+                                              UINT16 numTiles)
+{
+	PROGRESSIVE_ENCODER_SURFACE* encoder = &progressive->encoder;
+	const RFX_RECT* rects = Stream_BufferAs(progressive->rects, RFX_RECT);
+	const size_t tileDataSize = Stream_GetPosition(encoder->tileData);
+	const UINT32 numProgQuant = progressive->numQuantProgSchedule;
+	const size_t regionLen = 18ull + 8ull * numRects + 5ull + 16ull * numProgQuant + tileDataSize;
+
+	if (regionLen > UINT32_MAX)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, 12ull + 10ull + 12ull + regionLen + 6ull))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_SYNC); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 12);                   /* blockLen (4 bytes) */
+	Stream_Write_UINT32(s, 0xCACCACCA);           /* magic (4 bytes) */
+	Stream_Write_UINT16(s, 0x0100);               /* version (2 bytes) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_CONTEXT); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 10);                      /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                        /* ctxId (1 byte) */
+	Stream_Write_UINT16(s, 64);                      /* tileSize (2 bytes) */
+	Stream_Write_UINT8(s, RFX_SUBBAND_DIFFING);      /* flags (1 byte) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_BEGIN); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 12);                          /* blockLen (4 bytes) */
+	Stream_Write_UINT32(s, encoder->frameIndex++);       /* frameIndex (4 bytes) */
+	Stream_Write_UINT16(s, 1);                           /* regionCount (2 bytes) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_REGION);    /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, (UINT32)regionLen);         /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 64);                         /* tileSize (1 byte) */
+	Stream_Write_UINT16(s, numRects);                  /* numRects (2 bytes) */
+	Stream_Write_UINT8(s, 1);                          /* numQuant (1 byte) */
+	Stream_Write_UINT8(s, (BYTE)numProgQuant);         /* numProgQuant (1 byte) */
+	Stream_Write_UINT8(s, RFX_DWT_REDUCE_EXTRAPOLATE); /* flags (1 byte) */
+	Stream_Write_UINT16(s, numTiles);                  /* numTiles (2 bytes) */
+	Stream_Write_UINT32(s, (UINT32)tileDataSize);      /* tileDataSize (4 bytes) */
+
+	for (UINT16 i = 0; i < numRects; i++)
+	{
+		const RFX_RECT* r = &rects[i];
+		Stream_Write_UINT16(s, r->x);      /* x (2 bytes) */
+		Stream_Write_UINT16(s, r->y);      /* y (2 bytes) */
+		Stream_Write_UINT16(s, r->width);  /* width (2 bytes) */
+		Stream_Write_UINT16(s, r->height); /* height (2 bytes) */
+	}
+
+	progressive_component_codec_quant_write(s, &progressive_encoder_quant);
+
+	for (UINT32 i = 0; i < numProgQuant; i++)
+	{
+		const BYTE p = progressive->quantProgSchedule[i];
+		const RFX_COMPONENT_CODEC_QUANT q = { p, p, p, p, p, p, p, p, p, p };
+		const BYTE quality = (BYTE)((100u * (i + 1)) / numProgQuant);
+
+		Stream_Write_UINT8(s, quality); /* quality (1 byte) */
+		progressive_component_codec_quant_write(s, &q);
+		progressive_component_codec_quant_write(s, &q);
+		progressive_component_codec_quant_write(s, &q);
+	}
+
+	Stream_Write(s, Stream_Buffer(encoder->tileData), tileDataSize);
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_END); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 6);                         /* blockLen (4 bytes) */
+	return TRUE;
+}
+
+static BOOL progressive_encoder_add_rect(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                         UINT32 xIdx, UINT32 yIdx, UINT16* WINPR_RESTRICT count)
+{
+	const PROGRESSIVE_ENCODER_SURFACE* encoder = &progressive->encoder;
+
+	if (!Stream_EnsureRemainingCapacity(progressive->rects, sizeof(RFX_RECT)))
+		return FALSE;
+
+	RFX_RECT* r = Stream_PointerAs(progressive->rects, RFX_RECT);
+	r->x = (UINT16)(xIdx * 64);
+	r->y = (UINT16)(yIdx * 64);
+	r->width = (UINT16)MIN(64, encoder->width - r->x);
+	r->height = (UINT16)MIN(64, encoder->height - r->y);
+	Stream_Seek(progressive->rects, sizeof(RFX_RECT));
+	(*count)++;
+	return TRUE;
+}
+
+static int progressive_compress_multipass(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                                          UINT32 Width, UINT32 Height, UINT32 ScanLine,
+                                          const REGION16* WINPR_RESTRICT invalidRegion,
+                                          BYTE** WINPR_RESTRICT ppDstData,
+                                          UINT32* WINPR_RESTRICT pDstSize)
+{
+	UINT16 numRects = 0;
+	UINT16 numTiles = 0;
+	PROGRESSIVE_ENCODER_SURFACE* encoder = &progressive->encoder;
+
+	if ((Width > UINT16_MAX) || (Height > UINT16_MAX))
+		return -2;
+
+	if (!progressive_encoder_surface_reset(encoder, Width, Height))
+		return -5;
+
+	const UINT32 count = encoder->gridWidth * encoder->gridHeight;
+
+	if (!invalidRegion)
+	{
+		for (UINT32 i = 0; i < count; i++)
+			encoder->tiles[i].dirty = TRUE;
+	}
+	else
+	{
+		UINT32 nbRects = 0;
+		const RECTANGLE_16* rects = region16_rects(invalidRegion, &nbRects);
+
+		for (UINT32 i = 0; i < nbRects; i++)
+		{
+			const RECTANGLE_16* r = &rects[i];
+			const UINT32 right = MIN(r->right, Width);
+			const UINT32 bottom = MIN(r->bottom, Height);
+
+			for (UINT32 y = r->top / 64; y < (bottom + 63) / 64; y++)
+			{
+				for (UINT32 x = r->left / 64; x < (right + 63) / 64; x++)
+					encoder->tiles[y * encoder->gridWidth + x].dirty = TRUE;
+			}
+		}
+	}
+
+	Stream_SetPosition(encoder->tileData, 0);
+	Stream_SetPosition(progressive->rects, 0);
+
+	for (UINT32 i = 0; (i < count) && (numTiles < UINT16_MAX); i++)
+	{
+		PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[i];
+		const UINT32 xIdx = i % encoder->gridWidth;
+		const UINT32 yIdx = i / encoder->gridWidth;
+
+		if (!tile->dirty)
+			continue;
+
+		if (!progressive_encode_tile_first(progressive, tile, (UINT16)xIdx, (UINT16)yIdx, 0,
+		                                   pSrcData, SrcFormat, ScanLine, encoder->tileData))
+			return -6;
+
+		if (!progressive_encoder_add_rect(progressive, xIdx, yIdx, &numRects))
+			return -5;
+
+		numTiles++;
+	}
+
+	/* Refine tiles that did not change, starting where the last message stopped */
+	const size_t upgradeStart = Stream_GetPosition(encoder->tileData);
+
+	for (UINT32 n = 0; (n < count) && (numTiles < UINT16_MAX); n++)
+	{
+		const UINT32 i = (encoder->upgradeCursor + n) % count;
+		PROGRESSIVE_ENCODER_TILE* tile = &encoder->tiles[i];
+		const INT32 pass = progressive_encoder_next_pass(progressive, tile);
+		const UINT32 xIdx = i % encoder->gridWidth;
+		const UINT32 yIdx = i / encoder->gridWidth;
+
+		if (pass < 0)
+			continue;
+
+		const size_t pos = Stream_GetPosition(encoder->tileData);
+		const BYTE progQuant = tile->progQuant;
+
+		if (!progressive_encode_tile_upgrade(progressive, tile, (UINT16)xIdx, (UINT16)yIdx,
+		                                     (BYTE)pass, encoder->tileData))
+		{
+			/* Upgrade does not fit the block limits, resend the tile at the new quality */
+			if (!progressive_encode_tile_first(progressive, tile, (UINT16)xIdx, (UINT16)yIdx,
+			                                   (BYTE)pass, pSrcData, SrcFormat, ScanLine,
+			                                   encoder->tileData))
+				return -6;
+		}
+
+		if ((progressive->upgradeBudget > 0) && (pos > upgradeStart) &&
+		    (Stream_GetPosition(encoder->tileData) - upgradeStart > progressive->upgradeBudget))
+		{
+			/* Over budget, this tile is refined with the next message */
+			Stream_SetPosition(encoder->tileData, pos);
+			tile->progQuant = progQuant;
+			encoder->upgradeCursor = i;
+			break;
+		}
+
+		if (!progressive_encoder_add_rect(progressive, xIdx, yIdx, &numRects))
+			return -5;
+
+		numTiles++;
+	}
+
+	for (UINT32 i = 0; i < count; i++)
+		encoder->tiles[i].dirty = FALSE;
+
+	if (numTiles == 0)
+		return 0;
+
+	wStream* s = progressive->buffer;
+	Stream_SetPosition(s, 0);
+
+	if (!progressive_encoder_write_message(progressive, s, numRects, numTiles))
+		return -5;
+
+	const size_t pos = Stream_GetPosition(s);
+	WINPR_ASSERT(pos <= UINT32_MAX);
+	*pDstSize = (UINT32)pos;
+	*ppDstData = Stream_Buffer(s);
+	return 1;
+}
+
+BOOL progressive_context_set_quant_schedule(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                            const BYTE* WINPR_RESTRICT schedule, size_t count)
+{
+	if (!progressive || !progressive->Compressor || (count > RFX_PROGRESSIVE_MAX_PASSES))
+		return FALSE;
+
+	if ((count > 0) && !schedule)
+		return FALSE;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (schedule[x] > RFX_PROGRESSIVE_MAX_PROG_QUANT)
+			return FALSE;
+
+		if ((x > 0) && (schedule[x] >= schedule[x - 1]))
+			return FALSE;
+	}
+
+	for (size_t x = 0; x < count; x++)
+		progressive->quantProgSchedule[x] = schedule[x];
+
+	progressive->numQuantProgSchedule = (UINT32)count;
+	return TRUE;
+}
+
+BOOL progressive_context_set_upgrade_budget(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                            UINT32 budget)
+{
+	if (!progressive || !progressive->Compressor)
+		return FALSE;
+
+	progressive->upgradeBudget = budget;
+	return TRUE;
+}
+
+BOOL progressive_compress_has_pending_upgrades(
+    const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
+{
+	if (!progressive || (progressive->numQuantProgSchedule == 0))
+		return FALSE;
+
+	const PROGRESSIVE_ENCODER_SURFACE* encoder = &progressive->encoder;
+	const size_t count = 1ull * encoder->gridWidth * encoder->gridHeight;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (progressive_encoder_next_pass(progressive, &encoder->tiles[i]) >= 0)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize, UINT32 SrcFormat,
                          UINT32 Width, UINT32 Height, UINT32 ScanLine,
@@ -2435,6 +3215,10 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 	if (SrcSize < Height * ScanLine)
 		return -4;
 
+	if (progressive->numQuantProgSchedule > 0)
+		return progressive_compress_multipass(progressive, pSrcData, SrcFormat, Width, Height,
+		                                      ScanLine, invalidRegion, ppDstData, pDstSize);
+
 	if (!invalidRegion)
 	{
 		numRects = (Width + 63) / 64;
@@ -2531,6 +3315,8 @@ BOOL progressive_context_reset(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
 	if (!progressive)
 		return FALSE;
 
+	/* Force TILE_FIRST for every tile with the next message */
+	progressive_encoder_surface_free(&progressive->encoder);
 	return TRUE;
 }
 
@@ -2590,6 +3376,7 @@ void progressive_context_free(PROGRESSIVE_CONTEXT* progressive)
 	Stream_Free(progressive->buffer, TRUE);
 	Stream_Free(progressive->rects, TRUE);
 	rfx_context_free(progressive->rfx_context);
+	progressive_encoder_surface_free(&progressive->encoder);
 
 	BufferPool_Free(progressive->bufferPool);
 	HashTable_Free(progressive->SurfaceContexts);
@@ -201,6 +201,32 @@ typedef struct
 	UINT32* updatedTileIndices;
 } PROGRESSIVE_SURFACE_CONTEXT;
 
+#define RFX_PROGRESSIVE_MAX_PASSES 8
+#define RFX_PROGRESSIVE_MAX_PROG_QUANT 8
+
+typedef struct
+{
+	BOOL valid;
+	BOOL dirty;
+	BYTE progQuant;
+	INT16 coeffs[3][4096];
+} PROGRESSIVE_ENCODER_TILE;
+
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 gridWidth;
+	UINT32 gridHeight;
+	UINT32 frameIndex;
+	UINT32 upgradeCursor;
+	PROGRESSIVE_ENCODER_TILE* tiles;
+	UINT32* pixels;
+	BYTE* srl;
+	BYTE* raw;
+	wStream* tileData;
+} PROGRESSIVE_ENCODER_SURFACE;
+
 typedef enum
 {
 	FLAG_WBT_SYNC = 0x01,
@@ -223,13 +249,17 @@ struct S_PROGRESSIVE_CONTEXT
 	PROGRESSIVE_BLOCK_REGION region;
 	RFX_PROGRESSIVE_CODEC_QUANT quantProgValFull;
 
+	BYTE quantProgSchedule[RFX_PROGRESSIVE_MAX_PASSES];
+	UINT32 numQuantProgSchedule;
+	UINT32 upgradeBudget;
+	PROGRESSIVE_ENCODER_SURFACE encoder;
+
 	wHashTable* SurfaceContexts;
 	wLog* log;
 	wStream* buffer;
 	wStream* rects;
 	RFX_CONTEXT* rfx_context;
 	PROGRESSIVE_TILE_PROCESS_WORK_PARAM params[0x10000];
-	PTP_WORK work_objects[0x10000];
 };
 
 #endif /* INTERNAL_CODEC_PROGRESSIVE_H */
@@ -210,7 +210,6 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 	DWORD dwType = 0;
 	DWORD dwSize = 0;
 	DWORD dwValue = 0;
-	SYSTEM_INFO sysinfo;
 	RFX_CONTEXT* context = NULL;
 	wObject* pool = NULL;
 	RFX_CONTEXT_PRIV* priv = NULL;
@@ -268,10 +267,6 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 	if (!(ThreadingFlags & THREADING_FLAGS_DISABLE_THREADS))
 	{
 		priv->UseThreads = TRUE;
-
-		GetNativeSystemInfo(&sysinfo);
-		priv->MinThreadCount = sysinfo.dwNumberOfProcessors;
-		priv->MaxThreadCount = 0;
 		status = RegOpenKeyExA(HKEY_LOCAL_MACHINE, RFX_KEY, 0, KEY_READ | KEY_WOW64_64KEY, &hKey);
 
 		if (status == ERROR_SUCCESS)
@@ -282,13 +277,10 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 			    ERROR_SUCCESS)
 				priv->UseThreads = dwValue ? 1 : 0;
 
-			if (RegQueryValueEx(hKey, _T("MinThreadCount"), NULL, &dwType, (BYTE*)&dwValue,
-			                    &dwSize) == ERROR_SUCCESS)
-				priv->MinThreadCount = dwValue;
-
+			/* The worker threads are shared by all codec contexts of the process */
 			if (RegQueryValueEx(hKey, _T("MaxThreadCount"), NULL, &dwType, (BYTE*)&dwValue,
 			                    &dwSize) == ERROR_SUCCESS)
-				priv->MaxThreadCount = dwValue;
+				(void)freerdp_codec_executor_set_max_threads(dwValue);
 
 			RegCloseKey(hKey);
 		}
@@ -304,20 +296,10 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 		/* from multiple threads. This call will initialize all function pointers correctly     */
 		/* before any decoding threads are started */
 		primitives_get();
-		priv->ThreadPool = CreateThreadpool(NULL);
+		priv->Queue = codec_queue_new();
 
-		if (!priv->ThreadPool)
+		if (!priv->Queue)
 			goto fail;
-
-		InitializeThreadpoolEnvironment(&priv->ThreadPoolEnv);
-		SetThreadpoolCallbackPool(&priv->ThreadPoolEnv, priv->ThreadPool);
-
-		if (priv->MinThreadCount)
-			if (!SetThreadpoolThreadMinimum(priv->ThreadPool, priv->MinThreadCount))
-				goto fail;
-
-		if (priv->MaxThreadCount)
-			SetThreadpoolThreadMaximum(priv->ThreadPool, priv->MaxThreadCount);
 	}
 
 	/* initialize the default pixel format */
@@ -370,10 +352,7 @@ void rfx_context_free(RFX_CONTEXT* context)
 		ObjectPool_Free(priv->TilePool);
 		if (priv->UseThreads)
 		{
-			if (priv->ThreadPool)
-				CloseThreadpool(priv->ThreadPool);
-			DestroyThreadpoolEnvironment(&priv->ThreadPoolEnv);
-			winpr_aligned_free((void*)priv->workObjects);
+			codec_queue_free(priv->Queue);
 			winpr_aligned_free(priv->tileWorkParams);
 #ifdef WITH_PROFILER
 			WLog_VRB(
@@ -837,7 +816,6 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
                                                UINT16* WINPR_RESTRICT pExpectedBlockType)
 {
 	BOOL rc = 0;
-	size_t close_cnt = 0;
 	BYTE quant = 0;
 	RFX_TILE* tile = NULL;
 	UINT32* quants = NULL;
@@ -846,7 +824,6 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 	UINT32 blockLen = 0;
 	UINT32 blockType = 0;
 	UINT32 tilesDataSize = 0;
-	PTP_WORK* work_objects = NULL;
 	RFX_TILE_PROCESS_WORK_PARAM* params = NULL;
 	void* pmem = NULL;
 
@@ -942,25 +919,14 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 
 	if (context->priv->UseThreads)
 	{
-		work_objects = (PTP_WORK*)winpr_aligned_calloc(message->numTiles, sizeof(PTP_WORK), 32);
 		params = (RFX_TILE_PROCESS_WORK_PARAM*)winpr_aligned_recalloc(
 		    NULL, message->numTiles, sizeof(RFX_TILE_PROCESS_WORK_PARAM), 32);
 
-		if (!work_objects)
-		{
-			winpr_aligned_free(params);
-			return FALSE;
-		}
-
 		if (!params)
-		{
-			winpr_aligned_free((void*)work_objects);
 			return FALSE;
-		}
 	}
 
 	/* tiles */
-	close_cnt = 0;
 	rc = FALSE;
 
 	if (Stream_GetRemainingLength(s) >= tilesDataSize)
@@ -1086,17 +1052,13 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 				params[i].context = context;
 				params[i].tile = message->tiles[i];
 
-				if (!(work_objects[i] =
-				          CreateThreadpoolWork(rfx_process_message_tile_work_callback,
-				                               (void*)&params[i], &context->priv->ThreadPoolEnv)))
+				if (!codec_queue_submit(context->priv->Queue,
+				                        rfx_process_message_tile_work_callback, &params[i]))
 				{
-					WLog_Print(context->priv->log, WLOG_ERROR, "CreateThreadpoolWork failed.");
+					WLog_Print(context->priv->log, WLOG_ERROR, "codec_queue_submit failed.");
 					rc = FALSE;
 					break;
 				}
-
-				SubmitThreadpoolWork(work_objects[i]);
-				close_cnt = i + 1;
 			}
 			else
 			{
@@ -1106,15 +1068,8 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 	}
 
 	if (context->priv->UseThreads)
-	{
-		for (size_t i = 0; i < close_cnt; i++)
-		{
-			WaitForThreadpoolWorkCallbacks(work_objects[i], FALSE);
-			CloseThreadpoolWork(work_objects[i]);
-		}
-	}
+		codec_queue_wait(context->priv->Queue);
 
-	winpr_aligned_free((void*)work_objects);
 	winpr_aligned_free(params);
 
 	for (size_t i = 0; i < message->numTiles; i++)
@@ -1631,11 +1586,6 @@ static INLINE BOOL setupWorkers(RFX_CONTEXT* WINPR_RESTRICT context, size_t nbTi
 	if (!context->priv->UseThreads)
 		return TRUE;
 
-	if (!(pmem = winpr_aligned_recalloc((void*)priv->workObjects, nbTiles, sizeof(PTP_WORK), 32)))
-		return FALSE;
-
-	priv->workObjects = (PTP_WORK*)pmem;
-
 	if (!(pmem = winpr_aligned_recalloc(priv->tileWorkParams, nbTiles,
 	                                    sizeof(RFX_TILE_COMPOSE_WORK_PARAM), 32)))
 		return FALSE;
@@ -1663,7 +1613,6 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 	const UINT32 height = h;
 	const UINT32 scanline = (UINT32)s;
 	RFX_MESSAGE* message = NULL;
-	PTP_WORK* workObject = NULL;
 	RFX_TILE_COMPOSE_WORK_PARAM* workParam = NULL;
 	BOOL success = FALSE;
 	REGION16 rectsRegion = { 0 };
@@ -1726,7 +1675,6 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 
 	if (context->priv->UseThreads)
 	{
-		workObject = context->priv->workObjects;
 		workParam = context->priv->tileWorkParams;
 	}
 
@@ -1828,15 +1776,10 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 					workParam->context = context;
 					workParam->tile = tile;
 
-					if (!(*workObject = CreateThreadpoolWork(rfx_compose_message_tile_work_callback,
-					                                         (void*)workParam,
-					                                         &context->priv->ThreadPoolEnv)))
-					{
+					if (!codec_queue_submit(context->priv->Queue,
+					                        rfx_compose_message_tile_work_callback, workParam))
 						goto skip_encoding_loop;
-					}
 
-					SubmitThreadpoolWork(*workObject);
-					workObject++;
 					workParam++;
 				}
 				else
@@ -1853,25 +1796,16 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 	success = TRUE;
 skip_encoding_loop:
 
-	/* when using threads ensure all computations are done */
+	/* when using threads ensure all computations are done, also before freeing the tiles */
+	if (context->priv->UseThreads)
+		codec_queue_wait(context->priv->Queue);
+
 	if (success)
 	{
 		message->tilesDataSize = 0;
-		workObject = context->priv->workObjects;
 
 		for (UINT32 i = 0; i < message->numTiles; i++)
 		{
-			if (context->priv->UseThreads)
-			{
-				if (*workObject)
-				{
-					WaitForThreadpoolWorkCallbacks(*workObject, FALSE);
-					CloseThreadpoolWork(*workObject);
-				}
-
-				workObject++;
-			}
-
 			const RFX_TILE* tile = message->tiles[i];
 			const size_t tlen = rfx_tile_length(tile);
 			message->tilesDataSize += WINPR_ASSERTING_INT_CAST(uint32_t, tlen);
@@ -22,22 +22,56 @@
 
 #include <winpr/assert.h>
 #include <winpr/cast.h>
+#include <winpr/endian.h>
+#include <winpr/intrin.h>
 
 #include <freerdp/codec/rfx.h>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+	/* MSB first bit writer. Bits are collected in a 64 bit accumulator and written 32 bits at a
+	 * time, bits beyond the end of the buffer are dropped. */
 	typedef struct
 	{
 		BYTE* buffer;
 		uint32_t nbytes;
-		uint32_t byte_pos;
-		uint32_t bits_left;
+		uint32_t byte_pos; /* bytes emitted, including dropped ones */
+		uint64_t acc;      /* pending bits, right aligned */
+		uint32_t acc_bits; /* number of pending bits, always < 32 between calls */
 	} RFX_BITSTREAM;
 
+	/* MSB first bit reader. Up to 64 bits are cached, bits beyond the end of the data read as 0.
+	 */
+	typedef struct
+	{
+		const BYTE* data;
+		size_t length;   /* in bytes */
+		size_t next;     /* next byte to load into the cache */
+		size_t position; /* bits consumed */
+		UINT64 cache;    /* unconsumed bits, left aligned */
+		UINT32 count;    /* valid bits in the cache */
+	} RFX_BIT_READER;
+
+	/* Number of leading 0 bits of a non zero value. Unlike __lzcnt with MSVC this does not
+	 * depend on the LZCNT instruction. */
+	static inline uint32_t rfx_bitstream_clz(uint32_t val)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index = 0;
+		(void)_BitScanReverse(&index, val);
+		return 31 - index;
+#else
+		return __lzcnt(val);
+#endif
+	}
+
 	static inline void rfx_bitstream_attach(RFX_BITSTREAM* bs, BYTE* WINPR_RESTRICT buffer,
 	                                        size_t nbytes)
 	{
@@ -47,85 +81,199 @@ extern "C"
 		WINPR_ASSERT(nbytes <= UINT32_MAX);
 		bs->nbytes = WINPR_ASSERTING_INT_CAST(uint32_t, nbytes);
 		bs->byte_pos = 0;
-		bs->bits_left = 8;
+		bs->acc = 0;
+		bs->acc_bits = 0;
 	}
 
-	static inline uint32_t rfx_bitstream_get_bits(RFX_BITSTREAM* bs, uint32_t nbits)
+	static inline void rfx_bitstream_put_byte(RFX_BITSTREAM* bs, BYTE val)
 	{
-		UINT16 n = 0;
-		while (bs->byte_pos < bs->nbytes && nbits > 0)
-		{
-			uint32_t b = nbits;
-			if (b > bs->bits_left)
-				b = bs->bits_left;
-			if (n)
-				n <<= b;
-			n |= (bs->buffer[bs->byte_pos] >> (bs->bits_left - b)) & ((1 << b) - 1);
-			bs->bits_left -= b;
-			nbits -= b;
-			if (bs->bits_left == 0)
-			{
-				bs->bits_left = 8;
-				bs->byte_pos++;
-			}
-		}
-		return n;
+		if (bs->byte_pos < bs->nbytes)
+			bs->buffer[bs->byte_pos] = val;
+		bs->byte_pos++;
 	}
 
+	/* Write the lowest _nbits of _bits, _nbits must be in [0, 32] */
 	static inline void rfx_bitstream_put_bits(RFX_BITSTREAM* bs, uint32_t _bits, uint32_t _nbits)
 	{
-		UINT16 bits = WINPR_ASSERTING_INT_CAST(UINT16, _bits);
+		WINPR_ASSERT(bs);
+		WINPR_ASSERT(_nbits <= 32);
 
-		uint32_t nbits = (_nbits);
-		while (bs->byte_pos < bs->nbytes && nbits > 0)
+		const uint64_t mask = (1ull << _nbits) - 1ull;
+		bs->acc = (bs->acc << _nbits) | (_bits & mask);
+		bs->acc_bits += _nbits;
+
+		if (bs->acc_bits < 32)
+			return;
+
+		bs->acc_bits -= 32;
+		const uint32_t word = (uint32_t)(bs->acc >> bs->acc_bits);
+
+		if (bs->byte_pos + 4 <= bs->nbytes)
 		{
-			uint32_t b = nbits;
-			if (b > bs->bits_left)
-				b = bs->bits_left;
-			bs->buffer[bs->byte_pos] |= ((bits >> (nbits - b)) & ((1 << b) - 1))
-			                            << (bs->bits_left - b);
-			bs->bits_left -= b;
-			nbits -= b;
-			if (bs->bits_left == 0)
-			{
-				bs->bits_left = 8;
-				bs->byte_pos++;
-			}
+			winpr_Data_Write_UINT32_BE(&bs->buffer[bs->byte_pos], word);
+			bs->byte_pos += 4;
+		}
+		else
+		{
+			rfx_bitstream_put_byte(bs, (word >> 24) & 0xFF);
+			rfx_bitstream_put_byte(bs, (word >> 16) & 0xFF);
+			rfx_bitstream_put_byte(bs, (word >> 8) & 0xFF);
+			rfx_bitstream_put_byte(bs, word & 0xFF);
 		}
 	}
 
+	/* Write count times the bit bit */
+	static inline void rfx_bitstream_put_run(RFX_BITSTREAM* bs, uint32_t count, BOOL bit)
+	{
+		const uint32_t bits = bit ? UINT32_MAX : 0;
+
+		for (; count >= 32; count -= 32)
+			rfx_bitstream_put_bits(bs, bits, 32);
+		rfx_bitstream_put_bits(bs, bits, count);
+	}
+
+	/* Write the pending bits. A partial last byte is followed by as many 0 bits as it holds,
+	 * which may add a 0 byte. This keeps the output identical to the byte oriented writer used
+	 * before. */
 	static inline void rfx_bitstream_flush(RFX_BITSTREAM* bs)
 	{
 		WINPR_ASSERT(bs);
-		if (bs->bits_left != 8)
+
+		rfx_bitstream_put_bits(bs, 0, bs->acc_bits % 8);
+
+		while (bs->acc_bits >= 8)
 		{
-			uint32_t _nbits = 8 - bs->bits_left;
-			rfx_bitstream_put_bits(bs, 0, _nbits);
+			bs->acc_bits -= 8;
+			rfx_bitstream_put_byte(bs, (bs->acc >> bs->acc_bits) & 0xFF);
+		}
+
+		if (bs->acc_bits > 0)
+		{
+			rfx_bitstream_put_byte(bs, (bs->acc << (8 - bs->acc_bits)) & 0xFF);
+			bs->acc_bits = 0;
 		}
 	}
 
-	static inline BOOL rfx_bitstream_eos(RFX_BITSTREAM* bs)
+	static inline uint32_t rfx_bitstream_get_processed_bytes(RFX_BITSTREAM* bs)
 	{
 		WINPR_ASSERT(bs);
-		return ((bs)->byte_pos >= (bs)->nbytes);
+		const uint32_t pending = (bs->acc_bits + 7) / 8;
+		if (bs->byte_pos + pending > bs->nbytes)
+			return bs->nbytes;
+		return bs->byte_pos + pending;
 	}
 
-	static inline uint32_t rfx_bitstream_left(RFX_BITSTREAM* bs)
+	static inline void rfx_bit_reader_init(RFX_BIT_READER* WINPR_RESTRICT reader,
+	                                       const BYTE* WINPR_RESTRICT data, size_t length)
 	{
-		WINPR_ASSERT(bs);
+		WINPR_ASSERT(reader);
+
+		const RFX_BIT_READER empty = { 0 };
+		*reader = empty;
+		reader->data = data;
+		reader->length = data ? length : 0;
+	}
+
+	/* The reader functions below are called per coded symbol, their preconditions are
+	 * documented instead of asserted. */
+	static inline void rfx_bit_reader_fill(RFX_BIT_READER* WINPR_RESTRICT reader)
+	{
+		if (reader->count > 56)
+			return;
+
+		if (reader->next + 8 <= reader->length)
+		{
+			/* load all whole bytes that fit into the cache at once */
+			const UINT64 word = winpr_Data_Get_UINT64_BE(&reader->data[reader->next]);
+			const UINT32 bytes = (64 - reader->count) / 8;
+			const UINT32 pad = 64 - reader->count - 8 * bytes;
+			reader->cache |= ((word >> reader->count) >> pad) << pad;
+			reader->count += 8 * bytes;
+			reader->next += bytes;
+			return;
+		}
+
+		while (reader->count <= 56)
+		{
+			if (reader->next >= reader->length)
+			{
+				reader->count = 64;
+				break;
+			}
+
+			reader->cache |= ((UINT64)reader->data[reader->next++]) << (56 - reader->count);
+			reader->count += 8;
+		}
+	}
+
+	/* nbits must be in [1, 32] and at most reader->count */
+	static inline UINT32 rfx_bit_reader_peek(const RFX_BIT_READER* WINPR_RESTRICT reader,
+	                                         UINT32 nbits)
+	{
+		return (UINT32)(reader->cache >> (64 - nbits));
+	}
 
-		if ((bs)->byte_pos >= (bs)->nbytes)
+	/* nbits must be less than 64 and at most reader->count */
+	static inline void rfx_bit_reader_skip(RFX_BIT_READER* WINPR_RESTRICT reader, UINT32 nbits)
+	{
+		reader->cache <<= nbits;
+		reader->count -= nbits;
+		reader->position += nbits;
+	}
+
+	/* nbits must be in [0, 32] */
+	static inline UINT32 rfx_bit_reader_read(RFX_BIT_READER* WINPR_RESTRICT reader, UINT32 nbits)
+	{
+		if (nbits == 0)
 			return 0;
 
-		return ((bs)->nbytes - (bs)->byte_pos - 1) * 8 + (bs)->bits_left;
+		if (reader->count < nbits)
+			rfx_bit_reader_fill(reader);
+
+		const UINT32 val = rfx_bit_reader_peek(reader, nbits);
+		rfx_bit_reader_skip(reader, nbits);
+		return val;
 	}
 
-	static inline uint32_t rfx_bitstream_get_processed_bytes(RFX_BITSTREAM* bs)
+	/* Consume a run of equal bits (0 or 1), at most max of them. Returns the length of the run.
+	 * The bit terminating the run is not consumed. */
+	static inline size_t rfx_bit_reader_skip_run(RFX_BIT_READER* WINPR_RESTRICT reader, BOOL bit,
+	                                             size_t max)
 	{
-		WINPR_ASSERT(bs);
-		if ((bs)->bits_left < 8)
-			return (bs)->byte_pos + 1;
-		return (bs)->byte_pos;
+		const UINT32 invert = bit ? UINT32_MAX : 0;
+		size_t run = 0;
+
+		while (run < max)
+		{
+			rfx_bit_reader_fill(reader);
+
+			const UINT32 word = rfx_bit_reader_peek(reader, 32) ^ invert;
+			const UINT32 equal = word ? rfx_bitstream_clz(word) : 32;
+			const UINT32 len = (UINT32)MIN(equal, max - run);
+
+			rfx_bit_reader_skip(reader, len);
+			run += len;
+
+			if (equal < 32)
+				break;
+		}
+
+		return run;
+	}
+
+	static inline size_t rfx_bit_reader_remaining(const RFX_BIT_READER* WINPR_RESTRICT reader)
+	{
+		WINPR_ASSERT(reader);
+		const size_t bits = reader->length * 8;
+		if (reader->position >= bits)
+			return 0;
+		return bits - reader->position;
+	}
+
+	static inline void rfx_bit_reader_align(RFX_BIT_READER* WINPR_RESTRICT reader)
+	{
+		WINPR_ASSERT(reader);
+		(void)rfx_bit_reader_read(reader, (8 - reader->position % 8) % 8);
 	}
 
 #ifdef __cplusplus
@@ -32,14 +32,22 @@
 #include <winpr/cast.h>
 #include <winpr/crt.h>
 #include <winpr/print.h>
-#include <winpr/sysinfo.h>
-#include <winpr/bitstream.h>
-#include <winpr/intrin.h>
 
 #include "rfx_bitstream.h"
 
 #include "rfx_rlgr.h"
 
+#ifdef _MSC_VER
+#define __attribute__(...)
+#endif
+
+/* forces the RLGR1/RLGR3 specialisations below to be generated */
+#ifndef __clang__
+#define ATTRIBUTES __gnu_inline__, __always_inline__, __artificial__
+#else
+#define ATTRIBUTES __gnu_inline__, __always_inline__
+#endif
+
 /* Constants used in RLGR1/RLGR3 algorithm */
 #define KPMAX (80) /* max value for kp or krp */
 #define LSGR (3)   /* shift count to convert kp to k */
@@ -48,140 +56,113 @@
 #define UQ_GR (3)  /* increase in kp after nonzero symbol in GR mode */
 #define DQ_GR (3)  /* decrease in kp after zero symbol in GR mode */
 
-/* Returns the least number of bits required to represent a given value */
-#define GetMinBits(_val, _nbits) \
-	do                           \
-	{                            \
-		UINT32 _v = (_val);      \
-		(_nbits) = 0;            \
-		while (_v)               \
-		{                        \
-			_v >>= 1;            \
-			(_nbits)++;          \
-		}                        \
-	} while (0)
-
 /*
  * Update the passed parameter and clamp it to the range [0, KPMAX]
  * Return the value of parameter right-shifted by LSGR
  */
 static inline uint32_t UpdateParam(uint32_t* param, int32_t deltaP)
 {
-	WINPR_ASSERT(param);
-	if (deltaP < 0)
-	{
-		const uint32_t udeltaP = WINPR_ASSERTING_INT_CAST(uint32_t, -deltaP);
-		if (udeltaP > *param)
-			*param = 0;
-		else
-			*param -= udeltaP;
-	}
-	else
-		*param += WINPR_ASSERTING_INT_CAST(uint32_t, deltaP);
+	/* *param is at most KPMAX and deltaP in [-KPMAX, KPMAX], this can not overflow */
+	const int32_t val = (int32_t)*param + deltaP;
 
-	if ((*param) > KPMAX)
-		(*param) = KPMAX;
+	if (val < 0)
+		*param = 0;
+	else if (val > KPMAX)
+		*param = KPMAX;
+	else
+		*param = (uint32_t)val;
 	return (*param) >> LSGR;
 }
 
-static BOOL g_LZCNT = FALSE;
-
-static INIT_ONCE rfx_rlgr_init_once = INIT_ONCE_STATIC_INIT;
+/* Returns the least number of bits required to represent a given value */
+static inline uint32_t GetMinBits(uint32_t val)
+{
+	return val ? 32 - rfx_bitstream_clz(val) : 0;
+}
 
-static BOOL CALLBACK rfx_rlgr_init(PINIT_ONCE once, PVOID param, PVOID* context)
+/* Update krp after a GR code with a unary part of vk, only if it is not equal to 1 */
+static inline uint32_t rfx_rlgr_update_kr(uint32_t* krp, size_t vk)
 {
-	WINPR_UNUSED(once);
-	WINPR_UNUSED(param);
-	WINPR_UNUSED(context);
+	if (vk == 0)
+		return UpdateParam(krp, -2);
+	if (vk > 1)
+		return UpdateParam(krp, (int32_t)MIN(vk, KPMAX));
+	return *krp >> LSGR;
+}
 
-	g_LZCNT = IsProcessorFeaturePresentEx(PF_EX_LZCNT);
-	return TRUE;
+/* Converts a GR coded (2 * magnitude - sign) value back to the signed coefficient */
+static inline INT16 rfx_rlgr_2ms_to_mag(UINT32 val)
+{
+	if (val & 1)
+		return (INT16)(-(INT32)((val + 1) >> 1));
+	return (INT16)(val >> 1);
 }
 
-static INLINE UINT32 lzcnt_s(UINT32 x)
+/*
+ * Reads a GR code word with a kr bit remainder: a run of 1s terminated by a 0, then the
+ * remainder. Short code words are extracted from a single 32 bit peek. Returns FALSE if the
+ * input ends inside the code word.
+ */
+static __inline BOOL __attribute__((ATTRIBUTES))
+rfx_rlgr_read_gr(RFX_BIT_READER* WINPR_RESTRICT bs, uint32_t kr, size_t* vk, UINT32* code)
 {
-	if (!x)
-		return 32;
+	rfx_bit_reader_fill(bs);
+
+	const UINT32 word = ~rfx_bit_reader_peek(bs, 32);
 
-	if (!g_LZCNT)
+	if (word)
 	{
-		UINT32 y = 0;
-		UINT32 n = 32;
-		y = x >> 16;
-		if (y != 0)
-		{
-			WINPR_ASSERT(n >= 16);
-			n = n - 16;
-			x = y;
-		}
-		y = x >> 8;
-		if (y != 0)
-		{
-			WINPR_ASSERT(n >= 8);
-			n = n - 8;
-			x = y;
-		}
-		y = x >> 4;
-		if (y != 0)
-		{
-			WINPR_ASSERT(n >= 4);
-			n = n - 4;
-			x = y;
-		}
-		y = x >> 2;
-		if (y != 0)
-		{
-			WINPR_ASSERT(n >= 2);
-			n = n - 2;
-			x = y;
-		}
-		y = x >> 1;
-		if (y != 0)
+		const UINT32 ones = rfx_bitstream_clz(word);
+		const UINT32 len = ones + 1 + kr;
+
+		if (len <= 32)
 		{
-			WINPR_ASSERT(n >= 2);
-			return n - 2;
-		}
+			if (rfx_bit_reader_remaining(bs) < len)
+				return FALSE;
 
-		WINPR_ASSERT(n >= x);
-		return n - x;
+			/* kr may be 0, shift in two steps to keep the shift count below 64 */
+			const UINT32 remainder = (UINT32)(((bs->cache << (ones + 1)) >> 1) >> (63 - kr));
+			rfx_bit_reader_skip(bs, len);
+
+			*vk = ones;
+			*code = (UINT16)(remainder | (ones << kr));
+			return TRUE;
+		}
 	}
 
-	return __lzcnt(x);
+	/* count number of leading 1s */
+	*vk = rfx_bit_reader_skip_run(bs, TRUE, rfx_bit_reader_remaining(bs));
+
+	if (rfx_bit_reader_remaining(bs) < 1)
+		return FALSE;
+
+	rfx_bit_reader_skip(bs, 1);
+
+	/* next kr bits contain code remainder */
+	if (rfx_bit_reader_remaining(bs) < kr)
+		return FALSE;
+
+	/* add (vk << kr) to code */
+	*code = (UINT16)(rfx_bit_reader_read(bs, kr) | ((uint32_t)*vk << kr));
+	return TRUE;
 }
 
-int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
-                    INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize)
+/*
+ * The decoder is specialised for RLGR1 and RLGR3, mode is a compile time constant in each
+ * instance. Each step checks the remaining input like the pseudocode does, a truncated stream
+ * ends the decoding and the remaining coefficients are 0.
+ */
+static __inline int __attribute__((ATTRIBUTES))
+rfx_rlgr_decode_mode(const RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                     INT16* WINPR_RESTRICT pDstData, UINT32 DstSize)
 {
-	uint32_t vk = 0;
-	size_t run = 0;
-	size_t cnt = 0;
-	size_t size = 0;
-	size_t offset = 0;
-	INT16 mag = 0;
-	UINT32 k = 0;
-	UINT32 kp = 0;
-	UINT32 kr = 0;
-	UINT32 krp = 0;
-	UINT16 code = 0;
-	UINT32 sign = 0;
-	UINT32 nIdx = 0;
-	UINT32 val1 = 0;
-	UINT32 val2 = 0;
-	INT16* pOutput = NULL;
-	wBitStream* bs = NULL;
-	wBitStream s_bs = { 0 };
-	const SSIZE_T DstSize = rDstSize;
-
-	InitOnceExecuteOnce(&rfx_rlgr_init_once, rfx_rlgr_init, NULL, NULL);
-
-	k = 1;
-	kp = k << LSGR;
-
-	kr = 1;
-	krp = kr << LSGR;
-
-	if ((mode != RLGR1) && (mode != RLGR3))
-		mode = RLGR1;
+	uint32_t kp = 1 << LSGR;
+	uint32_t k = kp >> LSGR;
+	uint32_t krp = 1 << LSGR;
+	uint32_t kr = krp >> LSGR;
+	size_t pos = 0;
+	RFX_BIT_READER s_bs = { 0 };
+	RFX_BIT_READER* bs = &s_bs;
 
 	if (!pSrcData || !SrcSize)
 		return -1;
@@ -189,428 +170,138 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 	if (!pDstData || !DstSize)
 		return -1;
 
-	pOutput = pDstData;
-
-	bs = &s_bs;
+	rfx_bit_reader_init(bs, pSrcData, SrcSize);
 
-	BitStream_Attach(bs, pSrcData, SrcSize);
-	BitStream_Fetch(bs);
-
-	while ((BitStream_GetRemainingLength(bs) > 0) && ((pOutput - pDstData) < DstSize))
+	while ((rfx_bit_reader_remaining(bs) > 0) && (pos < DstSize))
 	{
+		INT16 mag = 0;
+		UINT32 code = 0;
+
 		if (k)
 		{
 			/* Run-Length (RL) Mode */
 
-			run = 0;
-
-			/* count number of leading 0s */
-
-			cnt = lzcnt_s(bs->accumulator);
-
-			size_t nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = WINPR_ASSERTING_INT_CAST(uint32_t, nbits);
+			/* the number of leading 0s is the number of full runs of (1 << k) zeros */
+			size_t vk = rfx_bit_reader_skip_run(bs, FALSE, rfx_bit_reader_remaining(bs));
 
-			vk = WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(bs->accumulator);
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				WINPR_ASSERT(cnt + vk <= UINT32_MAX);
-				vk += WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (rfx_bit_reader_remaining(bs) < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			rfx_bit_reader_skip(bs, 1);
 
-			while (vk--)
+			size_t run = 0;
+			for (; vk > 0; vk--)
 			{
-				const UINT32 add = (1 << k); /* add (1 << k) to run length */
-				run += add;
-
-				/* update k, kp params */
-
-				kp += UP_GR;
-
-				if (kp > KPMAX)
-					kp = KPMAX;
+				run += (1ull << k);
+				k = UpdateParam(&kp, UP_GR);
 
-				k = kp >> LSGR;
+				/* k does not change any more, add the remaining runs at once */
+				if (kp == KPMAX)
+				{
+					run += (vk - 1) << k;
+					break;
+				}
 			}
 
 			/* next k bits contain run length remainder */
-
-			if (BitStream_GetRemainingLength(bs) < k)
+			if (rfx_bit_reader_remaining(bs) < k)
 				break;
 
-			bs->mask = ((1 << k) - 1);
-			run += ((bs->accumulator >> (32 - k)) & bs->mask);
-			BitStream_Shift(bs, k);
+			run += rfx_bit_reader_read(bs, k);
 
 			/* read sign bit */
-
-			if (BitStream_GetRemainingLength(bs) < 1)
-				break;
-
-			sign = (bs->accumulator & 0x80000000) ? 1 : 0;
-			BitStream_Shift(bs, 1);
-
-			/* count number of leading 1s */
-
-			cnt = lzcnt_s(~(bs->accumulator));
-
-			nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(~(bs->accumulator));
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				WINPR_ASSERT(cnt + vk <= UINT32_MAX);
-				vk += WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (rfx_bit_reader_remaining(bs) < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			const UINT32 sign = rfx_bit_reader_read(bs, 1);
 
-			/* next kr bits contain code remainder */
-
-			if (BitStream_GetRemainingLength(bs) < kr)
+			if (!rfx_rlgr_read_gr(bs, kr, &vk, &code))
 				break;
 
-			bs->mask = ((1 << kr) - 1);
-			if (kr > 0)
-				code = (UINT16)((bs->accumulator >> (32 - kr)) & bs->mask);
-			else
-				code = 0;
-			BitStream_Shift(bs, kr);
-
-			/* add (vk << kr) to code */
-
-			code |= (vk << kr);
-
-			if (!vk)
-			{
-				/* update kr, krp params */
-
-				if (krp > 2)
-					krp -= 2;
-				else
-					krp = 0;
-
-				kr = krp >> LSGR;
-			}
-			else if (vk != 1)
-			{
-				/* update kr, krp params */
-
-				krp += vk;
-
-				if (krp > KPMAX)
-					krp = KPMAX;
-
-				kr = krp >> LSGR;
-			}
-
-			/* update k, kp params */
-
-			if (kp > DN_GR)
-				kp -= DN_GR;
-			else
-				kp = 0;
-
-			k = kp >> LSGR;
+			kr = rfx_rlgr_update_kr(&krp, vk);
+			k = UpdateParam(&kp, -DN_GR);
 
 			/* compute magnitude from code */
-
 			if (sign)
-				mag = WINPR_ASSERTING_INT_CAST(int16_t, (code + 1)) * -1;
+				mag = (INT16)(-(INT32)(code + 1));
 			else
-				mag = WINPR_ASSERTING_INT_CAST(int16_t, code + 1);
+				mag = (INT16)(code + 1);
 
 			/* write to output stream */
+			const size_t size = MIN(run, DstSize - pos);
+			memset(&pDstData[pos], 0, size * sizeof(INT16));
+			pos += size;
 
-			offset = WINPR_ASSERTING_INT_CAST(size_t, (pOutput)-pDstData);
-			size = run;
-
-			if ((offset + size) > rDstSize)
-				size = WINPR_ASSERTING_INT_CAST(size_t, DstSize) - offset;
-
-			if (size)
-			{
-				ZeroMemory(pOutput, size * sizeof(INT16));
-				pOutput += size;
-			}
-
-			if ((pOutput - pDstData) < DstSize)
-			{
-				*pOutput = mag;
-				pOutput++;
-			}
+			if (pos < DstSize)
+				pDstData[pos++] = mag;
 		}
 		else
 		{
 			/* Golomb-Rice (GR) Mode */
 
-			/* count number of leading 1s */
-
-			cnt = lzcnt_s(~(bs->accumulator));
-
-			size_t nbits = BitStream_GetRemainingLength(bs);
+			size_t vk = 0;
 
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(~(bs->accumulator));
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				WINPR_ASSERT(cnt + vk <= UINT32_MAX);
-				vk += WINPR_ASSERTING_INT_CAST(uint32_t, cnt);
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (!rfx_rlgr_read_gr(bs, kr, &vk, &code))
 				break;
 
-			BitStream_Shift(bs, 1);
-
-			/* next kr bits contain code remainder */
-
-			if (BitStream_GetRemainingLength(bs) < kr)
-				break;
-
-			bs->mask = ((1 << kr) - 1);
-			if (kr > 0)
-				code = (UINT16)((bs->accumulator >> (32 - kr)) & bs->mask);
-			else
-				code = 0;
-			BitStream_Shift(bs, kr);
+			kr = rfx_rlgr_update_kr(&krp, vk);
 
-			/* add (vk << kr) to code */
-
-			code |= (vk << kr);
-
-			if (!vk)
-			{
-				/* update kr, krp params */
-
-				if (krp > 2)
-					krp -= 2;
-				else
-					krp = 0;
-
-				kr = (krp >> LSGR) & UINT32_MAX;
-			}
-			else if (vk != 1)
-			{
-				/* update kr, krp params */
-
-				krp += vk;
-
-				if (krp > KPMAX)
-					krp = KPMAX;
-
-				kr = krp >> LSGR;
-			}
-
-			if (mode == RLGR1) /* RLGR1 */
+			if (mode == RLGR1)
 			{
+				/* code = 2 * mag - sign */
 				if (!code)
-				{
-					/* update k, kp params */
-
-					kp += UQ_GR;
-
-					if (kp > KPMAX)
-						kp = KPMAX;
-
-					k = kp >> LSGR;
-
-					mag = 0;
-				}
+					k = UpdateParam(&kp, UQ_GR);
 				else
-				{
-					/* update k, kp params */
-
-					if (kp > DQ_GR)
-						kp -= DQ_GR;
-					else
-						kp = 0;
-
-					k = kp >> LSGR;
-
-					/*
-					 * code = 2 * mag - sign
-					 * sign + code = 2 * mag
-					 */
-
-					if (code & 1)
-						mag = WINPR_ASSERTING_INT_CAST(INT16, (code + 1) >> 1) * -1;
-					else
-						mag = WINPR_ASSERTING_INT_CAST(INT16, code >> 1);
-				}
+					k = UpdateParam(&kp, -DQ_GR);
 
-				if ((pOutput - pDstData) < DstSize)
-				{
-					*pOutput = mag;
-					pOutput++;
-				}
+				pDstData[pos++] = rfx_rlgr_2ms_to_mag(code);
 			}
-			else if (mode == RLGR3) /* RLGR3 */
+			else
 			{
-				nIdx = 0;
+				/* the first value is stored in the bits needed for the sum of both */
+				const UINT32 nIdx = GetMinBits(code);
 
-				if (code)
-				{
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, code);
-					nIdx = 32 - lzcnt_s(WINPR_ASSERTING_INT_CAST(uint32_t, mag));
-				}
-
-				if (BitStream_GetRemainingLength(bs) < nIdx)
+				if (rfx_bit_reader_remaining(bs) < nIdx)
 					break;
 
-				bs->mask = ((1 << nIdx) - 1);
-				if (nIdx > 0)
-					val1 = ((bs->accumulator >> (32 - nIdx)) & bs->mask);
-				else
-					val1 = 0;
-				BitStream_Shift(bs, nIdx);
-
-				val2 = code - val1;
+				const UINT32 val1 = rfx_bit_reader_read(bs, nIdx);
+				const UINT32 val2 = code - val1;
 
 				if (val1 && val2)
-				{
-					/* update k, kp params */
-
-					if (kp > 2 * DQ_GR)
-						kp -= (2 * DQ_GR);
-					else
-						kp = 0;
-
-					k = kp >> LSGR;
-				}
+					k = UpdateParam(&kp, -2 * DQ_GR);
 				else if (!val1 && !val2)
-				{
-					/* update k, kp params */
-
-					kp += (2 * UQ_GR);
-
-					if (kp > KPMAX)
-						kp = KPMAX;
-
-					k = kp >> LSGR;
-				}
-
-				if (val1 & 1)
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, (val1 + 1) >> 1) * -1;
-				else
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, val1 >> 1);
-
-				if ((pOutput - pDstData) < DstSize)
-				{
-					*pOutput = mag;
-					pOutput++;
-				}
+					k = UpdateParam(&kp, 2 * UQ_GR);
 
-				if (val2 & 1)
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, (val2 + 1) >> 1) * -1;
-				else
-					mag = WINPR_ASSERTING_INT_CAST(int16_t, val2 >> 1);
+				pDstData[pos++] = rfx_rlgr_2ms_to_mag(val1);
 
-				if ((pOutput - pDstData) < DstSize)
-				{
-					*pOutput = WINPR_ASSERTING_INT_CAST(int16_t, mag);
-					pOutput++;
-				}
+				if (pos < DstSize)
+					pDstData[pos++] = rfx_rlgr_2ms_to_mag(val2);
 			}
 		}
 	}
 
-	offset = WINPR_ASSERTING_INT_CAST(size_t, (pOutput - pDstData));
-
-	if (offset < rDstSize)
-	{
-		size = WINPR_ASSERTING_INT_CAST(size_t, DstSize) - offset;
-		ZeroMemory(pOutput, size * 2);
-		pOutput += size;
-	}
-
-	offset = WINPR_ASSERTING_INT_CAST(size_t, (pOutput - pDstData));
-
-	if ((DstSize < 0) || (offset != (size_t)DstSize))
-		return -1;
-
+	memset(&pDstData[pos], 0, (DstSize - pos) * sizeof(INT16));
 	return 1;
 }
 
-/* Returns the next coefficient (a signed int) to encode, from the input stream */
-#define GetNextInput(_n)    \
-	do                      \
-	{                       \
-		if (data_size > 0)  \
-		{                   \
-			(_n) = *data++; \
-			data_size--;    \
-		}                   \
-		else                \
-		{                   \
-			(_n) = 0;       \
-		}                   \
-	} while (0)
-
-/* Emit bitPattern to the output bitstream */
-#define OutputBits(numBits, bitPattern) rfx_bitstream_put_bits(bs, bitPattern, numBits)
-
-/* Emit a bit (0 or 1), count number of times, to the output bitstream */
-static inline void OutputBit(RFX_BITSTREAM* bs, uint32_t count, UINT8 bit)
+static int rfx_rlgr1_decode(const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                            INT16* WINPR_RESTRICT pDstData, UINT32 DstSize)
 {
-	UINT16 _b = ((bit) ? 0xFFFF : 0);
-	const uint32_t rem = count % 16;
-	for (uint32_t x = 0; x < count - rem; x += 16)
-		rfx_bitstream_put_bits(bs, _b, 16);
+	return rfx_rlgr_decode_mode(RLGR1, pSrcData, SrcSize, pDstData, DstSize);
+}
 
-	if (rem > 0)
-		rfx_bitstream_put_bits(bs, _b, rem);
+static int rfx_rlgr3_decode(const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                            INT16* WINPR_RESTRICT pDstData, UINT32 DstSize)
+{
+	return rfx_rlgr_decode_mode(RLGR3, pSrcData, SrcSize, pDstData, DstSize);
+}
+
+int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                    INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize)
+{
+	if (mode == RLGR3)
+		return rfx_rlgr3_decode(pSrcData, SrcSize, pDstData, rDstSize);
+	return rfx_rlgr1_decode(pSrcData, SrcSize, pDstData, rDstSize);
 }
 
 /* Converts the input value to (2 * abs(input) - sign(input)), where sign(input) = (input < 0 ? 1 :
@@ -623,90 +314,74 @@ static inline UINT32 Get2MagSign(INT32 input)
 }
 
 /* Outputs the Golomb/Rice encoding of a non-negative integer */
-#define CodeGR(krp, val) rfx_rlgr_code_gr(bs, krp, val)
-
-static void rfx_rlgr_code_gr(RFX_BITSTREAM* bs, uint32_t* krp, UINT32 val)
+static inline void rfx_rlgr_code_gr(RFX_BITSTREAM* bs, uint32_t* krp, UINT32 val)
 {
-	uint32_t kr = *krp >> LSGR;
+	const uint32_t kr = *krp >> LSGR;
 
 	/* unary part of GR code */
-
 	const uint32_t vk = val >> kr;
-	OutputBit(bs, vk, 1);
-	OutputBit(bs, 1, 0);
 
-	/* remainder part of GR code, if needed */
-	if (kr)
+	/* the whole code word (vk 1s, a 0 and the kr bit remainder) fits in one write for all but
+	 * the largest values */
+	if (vk + 1 + kr <= 32)
 	{
-		OutputBits(kr, val & ((1 << kr) - 1));
+		const uint32_t ones = (uint32_t)((1ull << vk) - 1ull);
+		const uint32_t remainder = val & ((1u << kr) - 1u);
+		rfx_bitstream_put_bits(bs, (ones << (kr + 1)) | remainder, vk + 1 + kr);
 	}
-
-	/* update krp, only if it is not equal to 1 */
-	if (vk == 0)
-	{
-		(void)UpdateParam(krp, -2);
-	}
-	else if (vk > 1)
+	else
 	{
-		(void)UpdateParam(krp, WINPR_CXX_COMPAT_CAST(int32_t, vk));
+		rfx_bitstream_put_run(bs, vk, TRUE);
+		rfx_bitstream_put_bits(bs, 0, 1);
+		rfx_bitstream_put_bits(bs, val, kr);
 	}
+
+	(void)rfx_rlgr_update_kr(krp, vk);
 }
 
-int rfx_rlgr_encode(RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 data_size,
-                    BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
+/* The encoder is specialised for RLGR1 and RLGR3 like the decoder */
+static __inline int __attribute__((ATTRIBUTES))
+rfx_rlgr_encode_mode(const RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 data_size,
+                     BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
 {
-	uint32_t k = 0;
-	uint32_t kp = 0;
-	uint32_t krp = 0;
-	RFX_BITSTREAM* bs = NULL;
-
-	if (!(bs = (RFX_BITSTREAM*)winpr_aligned_calloc(1, sizeof(RFX_BITSTREAM), 32)))
-		return 0;
+	RFX_BITSTREAM s_bs = { 0 };
+	RFX_BITSTREAM* bs = &s_bs;
+	const INT16* end = &data[data_size];
 
 	rfx_bitstream_attach(bs, buffer, buffer_size);
 
 	/* initialize the parameters */
-	k = 1;
-	kp = 1 << LSGR;
-	krp = 1 << LSGR;
+	uint32_t kp = 1 << LSGR;
+	uint32_t k = kp >> LSGR;
+	uint32_t krp = 1 << LSGR;
 
-	/* process all the input coefficients */
-	while (data_size > 0)
+	/* process all the input coefficients, missing input values are 0 */
+	while (data < end)
 	{
-		int input = 0;
-
 		if (k)
 		{
-			uint32_t numZeros = 0;
-			uint32_t runmax = 0;
-			BYTE sign = 0;
-
 			/* RUN-LENGTH MODE */
 
-			/* collect the run of zeros in the input stream */
-			numZeros = 0;
-			GetNextInput(input);
-			while (input == 0 && data_size > 0)
-			{
-				numZeros++;
-				GetNextInput(input);
-			}
+			/* collect the run of zeros in the input stream, a trailing 0 is coded as value */
+			const INT16* start = data;
+			while ((data < end - 1) && (*data == 0))
+				data++;
+
+			uint32_t numZeros = WINPR_ASSERTING_INT_CAST(uint32_t, data - start);
+			const int input = *data++;
 
-			// emit output zeros
-			runmax = 1 << k;
-			while (numZeros >= runmax)
+			/* each full run of (1 << k) zeros is a 0 bit */
+			uint32_t runs = 0;
+			while (numZeros >= (1u << k))
 			{
-				OutputBit(bs, 1, 0); /* output a zero bit */
-				numZeros -= runmax;
-				k = UpdateParam(&kp, UP_GR); /* update kp, k */
-				runmax = 1 << k;
+				numZeros -= (1u << k);
+				runs++;
+				k = UpdateParam(&kp, UP_GR);
 			}
 
-			/* output a 1 to terminate runs */
-			OutputBit(bs, 1, 1);
-
-			/* output the remaining run length using k bits */
-			OutputBits(k, numZeros);
+			/* output a 1 to terminate runs, then the remaining run length using k bits */
+			rfx_bitstream_put_run(bs, runs, FALSE);
+			rfx_bitstream_put_bits(bs, (1u << k) | numZeros, k + 1);
 
 			/* note: when we reach here and the last byte being encoded is 0, we still
 			   need to output the last two bits, otherwise mstsc will crash */
@@ -714,81 +389,73 @@ int rfx_rlgr_encode(RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 dat
 			/* encode the nonzero value using GR coding */
 			const UINT32 mag =
 			    (UINT32)(input < 0 ? -input : input); /* absolute value of input coefficient */
-			sign = (input < 0 ? 1 : 0);         /* sign of input coefficient */
 
-			OutputBit(bs, 1, sign);          /* output the sign bit */
-			CodeGR(&krp, mag ? mag - 1 : 0); /* output GR code for (mag - 1) */
+			rfx_bitstream_put_bits(bs, input < 0 ? 1 : 0, 1); /* output the sign bit */
+			rfx_rlgr_code_gr(bs, &krp, mag ? mag - 1 : 0);    /* output GR code for (mag - 1) */
 
 			k = UpdateParam(&kp, -DN_GR);
 		}
-		else
+		else if (mode == RLGR1)
 		{
-			/* GOLOMB-RICE MODE */
-
-			if (mode == RLGR1)
-			{
-				UINT32 twoMs = 0;
-
-				/* RLGR1 variant */
-
-				/* convert input to (2*magnitude - sign), encode using GR code */
-				GetNextInput(input);
-				twoMs = Get2MagSign(input);
-				CodeGR(&krp, twoMs);
-
-				/* update k, kp */
-				/* NOTE: as of Aug 2011, the algorithm is still wrongly documented
-				   and the update direction is reversed */
-				if (twoMs)
-				{
-					k = UpdateParam(&kp, -DQ_GR);
-				}
-				else
-				{
-					k = UpdateParam(&kp, UQ_GR);
-				}
-			}
-			else /* mode == RLGR3 */
-			{
-				UINT32 twoMs1 = 0;
-				UINT32 twoMs2 = 0;
-				UINT32 sum2Ms = 0;
-				UINT32 nIdx = 0;
+			/* GOLOMB-RICE MODE, RLGR1 variant */
 
-				/* RLGR3 variant */
+			/* convert input to (2*magnitude - sign), encode using GR code */
+			const UINT32 twoMs = Get2MagSign(*data++);
+			rfx_rlgr_code_gr(bs, &krp, twoMs);
 
-				/* convert the next two input values to (2*magnitude - sign) and */
-				/* encode their sum using GR code */
-
-				GetNextInput(input);
-				twoMs1 = Get2MagSign(input);
-				GetNextInput(input);
-				twoMs2 = Get2MagSign(input);
-				sum2Ms = twoMs1 + twoMs2;
+			/* update k, kp */
+			/* NOTE: as of Aug 2011, the algorithm is still wrongly documented
+			   and the update direction is reversed */
+			if (twoMs)
+				k = UpdateParam(&kp, -DQ_GR);
+			else
+				k = UpdateParam(&kp, UQ_GR);
+		}
+		else
+		{
+			/* GOLOMB-RICE MODE, RLGR3 variant */
 
-				CodeGR(&krp, sum2Ms);
+			/* convert the next two input values to (2*magnitude - sign) and */
+			/* encode their sum using GR code */
+			const UINT32 twoMs1 = Get2MagSign(*data++);
+			const UINT32 twoMs2 = (data < end) ? Get2MagSign(*data++) : 0;
+			const UINT32 sum2Ms = twoMs1 + twoMs2;
 
-				/* encode binary representation of the first input (twoMs1). */
-				GetMinBits(sum2Ms, nIdx);
-				OutputBits(nIdx, twoMs1);
+			rfx_rlgr_code_gr(bs, &krp, sum2Ms);
 
-				/* update k,kp for the two input values */
+			/* encode binary representation of the first input (twoMs1). */
+			rfx_bitstream_put_bits(bs, twoMs1, GetMinBits(sum2Ms));
 
-				if (twoMs1 && twoMs2)
-				{
-					k = UpdateParam(&kp, -2 * DQ_GR);
-				}
-				else if (!twoMs1 && !twoMs2)
-				{
-					k = UpdateParam(&kp, 2 * UQ_GR);
-				}
-			}
+			/* update k,kp for the two input values */
+			if (twoMs1 && twoMs2)
+				k = UpdateParam(&kp, -2 * DQ_GR);
+			else if (!twoMs1 && !twoMs2)
+				k = UpdateParam(&kp, 2 * UQ_GR);
 		}
 	}
 
 	rfx_bitstream_flush(bs);
-	uint32_t processed_size = rfx_bitstream_get_processed_bytes(bs);
-	winpr_aligned_free(bs);
+	const uint32_t processed_size = rfx_bitstream_get_processed_bytes(bs);
 
 	return WINPR_ASSERTING_INT_CAST(int, processed_size);
 }
+
+static int rfx_rlgr1_encode(const INT16* WINPR_RESTRICT data, UINT32 data_size,
+                            BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
+{
+	return rfx_rlgr_encode_mode(RLGR1, data, data_size, buffer, buffer_size);
+}
+
+static int rfx_rlgr3_encode(const INT16* WINPR_RESTRICT data, UINT32 data_size,
+                            BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
+{
+	return rfx_rlgr_encode_mode(RLGR3, data, data_size, buffer, buffer_size);
+}
+
+int rfx_rlgr_encode(RLGR_MODE mode, const INT16* WINPR_RESTRICT data, UINT32 data_size,
+                    BYTE* WINPR_RESTRICT buffer, UINT32 buffer_size)
+{
+	if (mode == RLGR3)
+		return rfx_rlgr3_encode(data, data_size, buffer, buffer_size);
+	return rfx_rlgr1_encode(data, data_size, buffer, buffer_size);
+}
@@ -31,6 +31,8 @@
 #include <freerdp/log.h>
 #include <freerdp/utils/profiler.h>
 
+#include "executor.h"
+
 #define RFX_TAG FREERDP_TAG("codec.rfx")
 #ifdef WITH_DEBUG_RFX
 #define DEBUG_RFX(...) WLog_DBG(RFX_TAG, __VA_ARGS__)
@@ -66,14 +68,9 @@ struct S_RFX_CONTEXT_PRIV
 	wObjectPool* TilePool;
 
 	BOOL UseThreads;
-	PTP_WORK* workObjects;
 	RFX_TILE_COMPOSE_WORK_PARAM* tileWorkParams;
 
-	DWORD MinThreadCount;
-	DWORD MaxThreadCount;
-
-	PTP_POOL ThreadPool;
-	TP_CALLBACK_ENVIRON ThreadPoolEnv;
+	CODEC_QUEUE* Queue;
 
 	wBufferPool* BufferPool;
 
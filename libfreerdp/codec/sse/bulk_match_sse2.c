@@ -0,0 +1,57 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Bulk Compression Match Length - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "bulk_match_sse2.h"
+
+#include "../../core/simd.h"
+#include "../../primitives/sse/prim_avxsse.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+
+/* The vector loop stops at the first block containing a mismatch, the scalar tail locates it */
+static UINT32 bulk_match_length_sse2(const BYTE* a, const BYTE* b, UINT32 maxLength)
+{
+	UINT32 length = 0;
+
+	for (; length + 16 <= maxLength; length += 16)
+	{
+		const __m128i va = LOAD_SI128(&a[length]);
+		const __m128i vb = LOAD_SI128(&b[length]);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF)
+			break;
+	}
+
+	return length + bulk_match_length(&a[length], &b[length], maxLength - length);
+}
+#endif
+
+void bulk_match_init_sse2_int(bulk_match_length_fn_t* WINPR_RESTRICT fn)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "SSE2/SSE3 optimizations");
+	*fn = bulk_match_length_sse2;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE2 intrinsics not available");
+	WINPR_UNUSED(fn);
+#endif
+}
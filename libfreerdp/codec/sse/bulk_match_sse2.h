@@ -0,0 +1,37 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Bulk Compression Match Length - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CODEC_BULK_MATCH_SSE2_H
+#define FREERDP_LIB_CODEC_BULK_MATCH_SSE2_H
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/api.h>
+
+#include "../bulk_match.h"
+
+FREERDP_LOCAL void bulk_match_init_sse2_int(bulk_match_length_fn_t* WINPR_RESTRICT fn);
+static inline void bulk_match_init_sse2(bulk_match_length_fn_t* WINPR_RESTRICT fn)
+{
+	if (!IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE) ||
+	    !IsProcessorFeaturePresent(PF_SSE3_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	bulk_match_init_sse2_int(fn);
+}
+
+#endif /* FREERDP_LIB_CODEC_BULK_MATCH_SSE2_H */
@@ -0,0 +1,81 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Interleaved RLE Bitmap Encoder - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+#include <freerdp/log.h>
+
+#include "../interleaved_types.h"
+#include "../interleaved_encode.h"
+#include "interleaved_sse2.h"
+
+#include "../../core/simd.h"
+#include "../../primitives/sse/prim_avxsse.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+
+/* The vector loops stop at the first block containing a mismatch, the scalar tail locates it */
+static UINT32 interleaved_match_run_sse2(const UINT32* src, const UINT32* ref, UINT32 xorMask,
+                                         UINT32 length)
+{
+	const __m128i mask = _mm_set1_epi32((int)xorMask);
+	UINT32 x = 0;
+
+	for (; x + 4 <= length; x += 4)
+	{
+		const __m128i a = LOAD_SI128(&src[x]);
+		const __m128i b = _mm_xor_si128(LOAD_SI128(&ref[x]), mask);
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) != 0xFFFF)
+			break;
+	}
+
+	return x + interleaved_match_run(&src[x], &ref[x], xorMask, length - x);
+}
+
+static UINT32 interleaved_fgbg_run_sse2(const UINT32* src, const UINT32* ref, UINT32 fgPel,
+                                        UINT32 length)
+{
+	const __m128i fg = _mm_set1_epi32((int)fgPel);
+	const __m128i zero = _mm_setzero_si128();
+	UINT32 x = 0;
+
+	for (; x + 4 <= length; x += 4)
+	{
+		const __m128i diff = _mm_xor_si128(LOAD_SI128(&src[x]), LOAD_SI128(&ref[x]));
+		const __m128i match = _mm_or_si128(_mm_cmpeq_epi32(diff, zero), _mm_cmpeq_epi32(diff, fg));
+
+		if (_mm_movemask_epi8(match) != 0xFFFF)
+			break;
+	}
+
+	return x + interleaved_fgbg_run(&src[x], &ref[x], fgPel, length - x);
+}
+#endif
+
+void interleaved_init_sse2_int(BITMAP_INTERLEAVED_CONTEXT* WINPR_RESTRICT context)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "SSE2/SSE3 optimizations");
+	context->match_run = interleaved_match_run_sse2;
+	context->fgbg_run = interleaved_fgbg_run_sse2;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE2 intrinsics not available");
+	WINPR_UNUSED(context);
+#endif
+}
@@ -23,6 +23,7 @@
 #include <freerdp/config.h>
 
 #include "../nsc_types.h"
+#include "../nsc_encode.h"
 #include "nsc_sse2.h"
 
 #include "../../core/simd.h"
@@ -40,6 +41,49 @@
 #include <winpr/crt.h>
 #include <winpr/sysinfo.h>
 
+static inline __m128i nsc_sse2_channel_32(__m128i lo, __m128i hi, int index)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const __m128i count = _mm_cvtsi32_si128(index * 8);
+	const __m128i l = _mm_and_si128(_mm_srl_epi32(lo, count), mask);
+	const __m128i h = _mm_and_si128(_mm_srl_epi32(hi, count), mask);
+	return _mm_packs_epi32(l, h);
+}
+
+static inline void nsc_sse2_split_32(const BYTE* src, int r, int g, int b, int a,
+                                     __m128i* r_val, __m128i* g_val, __m128i* b_val,
+                                     __m128i* a_val)
+{
+	const __m128i lo = LOAD_SI128(src);
+	const __m128i hi = LOAD_SI128(src + 16);
+	*r_val = nsc_sse2_channel_32(lo, hi, r);
+	*g_val = nsc_sse2_channel_32(lo, hi, g);
+	*b_val = nsc_sse2_channel_32(lo, hi, b);
+
+	if (a < 0)
+		*a_val = _mm_set1_epi16(0xFF);
+	else
+		*a_val = nsc_sse2_channel_32(lo, hi, a);
+}
+
+/* Expands 8 RGB565 pixels, hi receives the 5 bits stored in the upper byte */
+static inline void nsc_sse2_split_16(const BYTE* src, __m128i* hi_val, __m128i* g_val,
+                                     __m128i* lo_val)
+{
+	const __m128i p = LOAD_SI128(src);
+	*hi_val = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(p, 8), _mm_set1_epi16(0xF8)),
+	                       _mm_srli_epi16(p, 13));
+	*g_val = _mm_and_si128(_mm_srli_epi16(p, 3), _mm_set1_epi16(0xFC));
+	*lo_val = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(p, 3), _mm_set1_epi16(0xF8)),
+	                       _mm_and_si128(_mm_srli_epi16(p, 2), _mm_set1_epi16(0x07)));
+}
+
+static inline void nsc_sse2_store8(void* ptr, __m128i val)
+{
+	__m128i* mptr = WINPR_CXX_COMPAT_CAST(__m128i*, ptr);
+	_mm_storel_epi64(mptr, val);
+}
+
 static inline size_t nsc_encode_next_rgba(UINT32 format, const BYTE* src, const BYTE* palette,
                                           __m128i* r_val, __m128i* g_val, __m128i* b_val,
                                           __m128i* a_val)
@@ -47,45 +91,19 @@ static inline size_t nsc_encode_next_rgba(UINT32 format, const BYTE* src, const
 	switch (format)
 	{
 		case PIXEL_FORMAT_BGRX32:
-			*b_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16), *(src + 12),
-			                       *(src + 8), *(src + 4), *src);
-			*g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17), *(src + 13),
-			                       *(src + 9), *(src + 5), *(src + 1));
-			*r_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18), *(src + 14),
-			                       *(src + 10), *(src + 6), *(src + 2));
-			*a_val = _mm_set1_epi16(0xFF);
+			nsc_sse2_split_32(src, 2, 1, 0, -1, r_val, g_val, b_val, a_val);
 			return 32;
 
 		case PIXEL_FORMAT_BGRA32:
-			*b_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16), *(src + 12),
-			                       *(src + 8), *(src + 4), *src);
-			*g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17), *(src + 13),
-			                       *(src + 9), *(src + 5), *(src + 1));
-			*r_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18), *(src + 14),
-			                       *(src + 10), *(src + 6), *(src + 2));
-			*a_val = _mm_set_epi16(*(src + 31), *(src + 27), *(src + 23), *(src + 19), *(src + 15),
-			                       *(src + 11), *(src + 7), *(src + 3));
+			nsc_sse2_split_32(src, 2, 1, 0, 3, r_val, g_val, b_val, a_val);
 			return 32;
 
 		case PIXEL_FORMAT_RGBX32:
-			*r_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16), *(src + 12),
-			                       *(src + 8), *(src + 4), *src);
-			*g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17), *(src + 13),
-			                       *(src + 9), *(src + 5), *(src + 1));
-			*b_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18), *(src + 14),
-			                       *(src + 10), *(src + 6), *(src + 2));
-			*a_val = _mm_set1_epi16(0xFF);
+			nsc_sse2_split_32(src, 0, 1, 2, -1, r_val, g_val, b_val, a_val);
 			return 32;
 
 		case PIXEL_FORMAT_RGBA32:
-			*r_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16), *(src + 12),
-			                       *(src + 8), *(src + 4), *src);
-			*g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17), *(src + 13),
-			                       *(src + 9), *(src + 5), *(src + 1));
-			*b_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18), *(src + 14),
-			                       *(src + 10), *(src + 6), *(src + 2));
-			*a_val = _mm_set_epi16(*(src + 31), *(src + 27), *(src + 23), *(src + 19), *(src + 15),
-			                       *(src + 11), *(src + 7), *(src + 3));
+			nsc_sse2_split_32(src, 0, 1, 2, 3, r_val, g_val, b_val, a_val);
 			return 32;
 
 		case PIXEL_FORMAT_BGR24:
@@ -109,94 +127,12 @@ static inline size_t nsc_encode_next_rgba(UINT32 format, const BYTE* src, const
 			return 24;
 
 		case PIXEL_FORMAT_BGR16:
-			*b_val = _mm_set_epi16(
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 15)) & 0xF8) | ((*(src + 15)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 13)) & 0xF8) | ((*(src + 13)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 11)) & 0xF8) | ((*(src + 11)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 9)) & 0xF8) | ((*(src + 9)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 7)) & 0xF8) | ((*(src + 7)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 5)) & 0xF8) | ((*(src + 5)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 3)) & 0xF8) | ((*(src + 3)) >> 5)),
-			    WINPR_ASSERTING_INT_CAST(INT16, ((*(src + 1)) & 0xF8) | ((*(src + 1)) >> 5)));
-			*g_val =
-			    _mm_set_epi16(WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 15)) & 0x07) << 5) |
-			                                                      (((*(src + 14)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 13)) & 0x07) << 5) |
-			                                                      (((*(src + 12)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 11)) & 0x07) << 5) |
-			                                                      (((*(src + 10)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 9)) & 0x07) << 5) |
-			                                                      (((*(src + 8)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 7)) & 0x07) << 5) |
-			                                                      (((*(src + 6)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 5)) & 0x07) << 5) |
-			                                                      (((*(src + 4)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 3)) & 0x07) << 5) |
-			                                                      (((*(src + 2)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 1)) & 0x07) << 5) |
-			                                                      (((*src) & 0xE0) >> 3)));
-			*r_val = _mm_set_epi16(
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 14)) & 0x1F) << 3) |
-			                                        (((*(src + 14)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 12)) & 0x1F) << 3) |
-			                                        (((*(src + 12)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 10)) & 0x1F) << 3) |
-			                                        (((*(src + 10)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 8)) & 0x1F) << 3) |
-			                                        (((*(src + 8)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 6)) & 0x1F) << 3) |
-			                                        (((*(src + 6)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 4)) & 0x1F) << 3) |
-			                                        (((*(src + 4)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 2)) & 0x1F) << 3) |
-			                                        (((*(src + 2)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*src) & 0x1F) << 3) | (((*src) >> 2) & 0x07)));
+			nsc_sse2_split_16(src, b_val, g_val, r_val);
 			*a_val = _mm_set1_epi16(0xFF);
 			return 16;
 
 		case PIXEL_FORMAT_RGB16:
-			*r_val =
-			    _mm_set_epi16(WINPR_ASSERTING_INT_CAST(INT16, ((src[15] & 0xF8) | (src[15] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[13] & 0xF8) | (src[13] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[11] & 0xF8) | (src[11] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[9] & 0xF8) | (src[9] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[7] & 0xF8) | (src[7] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[5] & 0xF8) | (src[5] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[3] & 0xF8) | (src[3] >> 5))),
-			                  WINPR_ASSERTING_INT_CAST(INT16, ((src[1] & 0xF8) | (src[1] >> 5))));
-			*g_val =
-			    _mm_set_epi16(WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 15)) & 0x07) << 5) |
-			                                                      (((*(src + 14)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 13)) & 0x07) << 5) |
-			                                                      (((*(src + 12)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 11)) & 0x07) << 5) |
-			                                                      (((*(src + 10)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 9)) & 0x07) << 5) |
-			                                                      (((*(src + 8)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 7)) & 0x07) << 5) |
-			                                                      (((*(src + 6)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 5)) & 0x07) << 5) |
-			                                                      (((*(src + 4)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 3)) & 0x07) << 5) |
-			                                                      (((*(src + 2)) & 0xE0) >> 3)),
-			                  WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 1)) & 0x07) << 5) |
-			                                                      (((*src) & 0xE0) >> 3)));
-			*b_val = _mm_set_epi16(
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 14)) & 0x1F) << 3) |
-			                                        (((*(src + 14)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 12)) & 0x1F) << 3) |
-			                                        (((*(src + 12)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 10)) & 0x1F) << 3) |
-			                                        (((*(src + 10)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 8)) & 0x1F) << 3) |
-			                                        (((*(src + 8)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 6)) & 0x1F) << 3) |
-			                                        (((*(src + 6)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 4)) & 0x1F) << 3) |
-			                                        (((*(src + 4)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*(src + 2)) & 0x1F) << 3) |
-			                                        (((*(src + 2)) >> 2) & 0x07)),
-			    WINPR_ASSERTING_INT_CAST(INT16, (((*src) & 0x1F) << 3) | (((*src) >> 2) & 0x07)));
+			nsc_sse2_split_16(src, r_val, g_val, b_val);
 			*a_val = _mm_set1_epi16(0xFF);
 			return 16;
 
@@ -251,142 +187,76 @@ static inline size_t nsc_encode_next_rgba(UINT32 format, const BYTE* src, const
 	}
 }
 
-static BOOL nsc_encode_argb_to_aycocg_sse2(NSC_CONTEXT* context, const BYTE* data, UINT32 scanline)
+static void nsc_encode_argb_to_aycocg_row_sse2(const NSC_CONTEXT* WINPR_RESTRICT context,
+                                               const BYTE* WINPR_RESTRICT src,
+                                               BYTE* WINPR_RESTRICT yplane,
+                                               BYTE* WINPR_RESTRICT coplane,
+                                               BYTE* WINPR_RESTRICT cgplane,
+                                               BYTE* WINPR_RESTRICT aplane, UINT32 width)
 {
-	size_t y = 0;
-
-	if (!context || !data || (scanline == 0))
-		return FALSE;
-
-	const UINT16 tempWidth = ROUND_UP_TO(context->width, 8);
-	const UINT16 rw = (context->ChromaSubsamplingLevel > 0 ? tempWidth : context->width);
-
 	const BYTE ccl = WINPR_ASSERTING_INT_CAST(BYTE, context->ColorLossLevel);
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	UINT32 x = 0;
 
-	for (; y < context->height; y++)
-	{
-		const BYTE* src = data + (context->height - 1 - y) * scanline;
-		BYTE* yplane = context->priv->PlaneBuffers[0] + y * rw;
-		BYTE* coplane = context->priv->PlaneBuffers[1] + y * rw;
-		BYTE* cgplane = context->priv->PlaneBuffers[2] + y * rw;
-		BYTE* aplane = context->priv->PlaneBuffers[3] + y * context->width;
-
-		for (UINT16 x = 0; x < context->width; x += 8)
-		{
-			__m128i r_val = { 0 };
-			__m128i g_val = { 0 };
-			__m128i b_val = { 0 };
-			__m128i a_val = { 0 };
-
-			const size_t rc = nsc_encode_next_rgba(context->format, src, context->palette, &r_val,
-			                                       &g_val, &b_val, &a_val);
-			src += rc;
-
-			__m128i y_val = _mm_srai_epi16(r_val, 2);
-			y_val = _mm_add_epi16(y_val, _mm_srai_epi16(g_val, 1));
-			y_val = _mm_add_epi16(y_val, _mm_srai_epi16(b_val, 2));
-			__m128i co_val = _mm_sub_epi16(r_val, b_val);
-			co_val = _mm_srai_epi16(co_val, ccl);
-			__m128i cg_val = _mm_sub_epi16(g_val, _mm_srai_epi16(r_val, 1));
-			cg_val = _mm_sub_epi16(cg_val, _mm_srai_epi16(b_val, 1));
-			cg_val = _mm_srai_epi16(cg_val, ccl);
-			y_val = _mm_packus_epi16(y_val, y_val);
-			STORE_SI128(yplane, y_val);
-			co_val = _mm_packs_epi16(co_val, co_val);
-			STORE_SI128(coplane, co_val);
-			cg_val = _mm_packs_epi16(cg_val, cg_val);
-			STORE_SI128(cgplane, cg_val);
-			a_val = _mm_packus_epi16(a_val, a_val);
-			STORE_SI128(aplane, a_val);
-			yplane += 8;
-			coplane += 8;
-			cgplane += 8;
-			aplane += 8;
-		}
-
-		if (context->ChromaSubsamplingLevel > 0 && (context->width % 2) == 1)
-		{
-			context->priv->PlaneBuffers[0][y * rw + context->width] =
-			    context->priv->PlaneBuffers[0][y * rw + context->width - 1];
-			context->priv->PlaneBuffers[1][y * rw + context->width] =
-			    context->priv->PlaneBuffers[1][y * rw + context->width - 1];
-			context->priv->PlaneBuffers[2][y * rw + context->width] =
-			    context->priv->PlaneBuffers[2][y * rw + context->width - 1];
-		}
-	}
-
-	if (context->ChromaSubsamplingLevel > 0 && (y % 2) == 1)
+	for (; x + 8 <= width; x += 8)
 	{
-		BYTE* yplane = context->priv->PlaneBuffers[0] + y * rw;
-		BYTE* coplane = context->priv->PlaneBuffers[1] + y * rw;
-		BYTE* cgplane = context->priv->PlaneBuffers[2] + y * rw;
-		CopyMemory(yplane, yplane - rw, rw);
-		CopyMemory(coplane, coplane - rw, rw);
-		CopyMemory(cgplane, cgplane - rw, rw);
+		__m128i r_val = { 0 };
+		__m128i g_val = { 0 };
+		__m128i b_val = { 0 };
+		__m128i a_val = { 0 };
+
+		const size_t rc =
+		    nsc_encode_next_rgba(context->format, src, context->palette, &r_val, &g_val, &b_val,
+		                         &a_val);
+		if (rc == 0)
+			break;
+		src += rc;
+
+		__m128i y_val = _mm_srai_epi16(r_val, 2);
+		y_val = _mm_add_epi16(y_val, _mm_srai_epi16(g_val, 1));
+		y_val = _mm_add_epi16(y_val, _mm_srai_epi16(b_val, 2));
+		__m128i co_val = _mm_sub_epi16(r_val, b_val);
+		co_val = _mm_srai_epi16(co_val, ccl);
+		__m128i cg_val = _mm_sub_epi16(g_val, _mm_srai_epi16(r_val, 1));
+		cg_val = _mm_sub_epi16(cg_val, _mm_srai_epi16(b_val, 1));
+		cg_val = _mm_srai_epi16(cg_val, ccl);
+		/* Chroma is stored truncated to 8 bit, just like the generic code does */
+		co_val = _mm_and_si128(co_val, mask);
+		cg_val = _mm_and_si128(cg_val, mask);
+
+		nsc_sse2_store8(&yplane[x], _mm_packus_epi16(y_val, y_val));
+		nsc_sse2_store8(&coplane[x], _mm_packus_epi16(co_val, co_val));
+		nsc_sse2_store8(&cgplane[x], _mm_packus_epi16(cg_val, cg_val));
+		nsc_sse2_store8(&aplane[x], _mm_packus_epi16(a_val, a_val));
 	}
 
-	return TRUE;
+	if (x < width)
+		nsc_encode_argb_to_aycocg_row(context, src, &yplane[x], &coplane[x], &cgplane[x],
+		                              &aplane[x], width - x);
 }
 
-static void nsc_encode_subsampling_sse2(NSC_CONTEXT* context)
+static void nsc_encode_subsampling_row_sse2(BYTE* WINPR_RESTRICT dst,
+                                            const BYTE* WINPR_RESTRICT src0,
+                                            const BYTE* WINPR_RESTRICT src1, UINT32 width)
 {
-	BYTE* co_dst = NULL;
-	BYTE* cg_dst = NULL;
-	INT8* co_src0 = NULL;
-	INT8* co_src1 = NULL;
-	INT8* cg_src0 = NULL;
-	INT8* cg_src1 = NULL;
-	UINT32 tempWidth = 0;
-	UINT32 tempHeight = 0;
-	__m128i t;
-	__m128i val;
-	__m128i mask = _mm_set1_epi16(0xFF);
-	tempWidth = ROUND_UP_TO(context->width, 8);
-	tempHeight = ROUND_UP_TO(context->height, 2);
-
-	for (size_t y = 0; y < tempHeight >> 1; y++)
+	UINT32 x = 0;
+
+	for (; x + 8 <= width; x += 8)
 	{
-		co_dst = context->priv->PlaneBuffers[1] + y * (tempWidth >> 1);
-		cg_dst = context->priv->PlaneBuffers[2] + y * (tempWidth >> 1);
-		co_src0 = (INT8*)context->priv->PlaneBuffers[1] + (y << 1) * tempWidth;
-		co_src1 = co_src0 + tempWidth;
-		cg_src0 = (INT8*)context->priv->PlaneBuffers[2] + (y << 1) * tempWidth;
-		cg_src1 = cg_src0 + tempWidth;
-
-		for (UINT32 x = 0; x < tempWidth >> 1; x += 8)
-		{
-			t = LOAD_SI128(co_src0);
-			t = _mm_avg_epu8(t, LOAD_SI128(co_src1));
-			val = _mm_and_si128(_mm_srli_si128(t, 1), mask);
-			val = _mm_avg_epu16(val, _mm_and_si128(t, mask));
-			val = _mm_packus_epi16(val, val);
-			STORE_SI128(co_dst, val);
-			co_dst += 8;
-			co_src0 += 16;
-			co_src1 += 16;
-			t = LOAD_SI128(cg_src0);
-			t = _mm_avg_epu8(t, LOAD_SI128(cg_src1));
-			val = _mm_and_si128(_mm_srli_si128(t, 1), mask);
-			val = _mm_avg_epu16(val, _mm_and_si128(t, mask));
-			val = _mm_packus_epi16(val, val);
-			STORE_SI128(cg_dst, val);
-			cg_dst += 8;
-			cg_src0 += 16;
-			cg_src1 += 16;
-		}
+		const __m128i t0 = LOAD_SI128(&src0[2ULL * x]);
+		const __m128i t1 = LOAD_SI128(&src1[2ULL * x]);
+		/* sign extend the even and odd samples to 16 bit */
+		const __m128i even0 = _mm_srai_epi16(_mm_slli_epi16(t0, 8), 8);
+		const __m128i odd0 = _mm_srai_epi16(t0, 8);
+		const __m128i even1 = _mm_srai_epi16(_mm_slli_epi16(t1, 8), 8);
+		const __m128i odd1 = _mm_srai_epi16(t1, 8);
+		__m128i val = _mm_add_epi16(_mm_add_epi16(even0, odd0), _mm_add_epi16(even1, odd1));
+		val = _mm_srai_epi16(val, 2);
+		nsc_sse2_store8(&dst[x], _mm_packs_epi16(val, val));
 	}
-}
-
-static BOOL nsc_encode_sse2(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT data,
-                            UINT32 scanline)
-{
-	if (!nsc_encode_argb_to_aycocg_sse2(context, data, scanline))
-		return FALSE;
-
-	if (context->ChromaSubsamplingLevel > 0)
-		nsc_encode_subsampling_sse2(context);
 
-	return TRUE;
+	if (x < width)
+		nsc_encode_subsampling_row(&dst[x], &src0[2ULL * x], &src1[2ULL * x], width - x);
 }
 #endif
 
@@ -395,7 +265,8 @@ void nsc_init_sse2_int(NSC_CONTEXT* WINPR_RESTRICT context)
 #if defined(SSE_AVX_INTRINSICS_ENABLED)
 	WLog_VRB(PRIM_TAG, "SSE2/SSE3 optimizations");
 	PROFILER_RENAME(context->priv->prof_nsc_encode, "nsc_encode_sse2")
-	context->encode = nsc_encode_sse2;
+	context->encode_aycocg = nsc_encode_argb_to_aycocg_row_sse2;
+	context->encode_subsampling = nsc_encode_subsampling_row_sse2;
 #else
 	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE2 intrinsics not available");
 	WINPR_UNUSED(context);
@@ -449,6 +449,251 @@ static void rfx_dwt_2d_encode_sse2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RE
 	rfx_dwt_2d_encode_block_sse2(buffer + 3072, dwt_buffer, 16);
 	rfx_dwt_2d_encode_block_sse2(buffer + 3840, dwt_buffer, 8);
 }
+
+/* The extrapolating (progressive) inverse DWT. The lifting steps are computed with 32 bit
+ * intermediates and saturated to 16 bit, this matches the generic implementation bit by bit. */
+static __inline __m128i __attribute__((ATTRIBUTES)) mm_widen_lo_epi16(__m128i val)
+{
+	return _mm_srai_epi32(_mm_unpacklo_epi16(val, val), 16);
+}
+
+static __inline __m128i __attribute__((ATTRIBUTES)) mm_widen_hi_epi16(__m128i val)
+{
+	return _mm_srai_epi32(_mm_unpackhi_epi16(val, val), 16);
+}
+
+/* (a + b) / 2, rounded towards zero */
+static __inline __m128i __attribute__((ATTRIBUTES)) mm_half_sum_epi32(__m128i a, __m128i b)
+{
+	const __m128i sum = _mm_add_epi32(a, b);
+	return _mm_srai_epi32(_mm_add_epi32(sum, _mm_srli_epi32(sum, 31)), 1);
+}
+
+/* even = clamp(l - (h0 + h1) / 2) */
+static __inline __m128i __attribute__((ATTRIBUTES))
+rfx_idwt_extrapolate_even_sse2(__m128i l, __m128i h0, __m128i h1)
+{
+	const __m128i lo =
+	    _mm_sub_epi32(mm_widen_lo_epi16(l),
+	                  mm_half_sum_epi32(mm_widen_lo_epi16(h0), mm_widen_lo_epi16(h1)));
+	const __m128i hi =
+	    _mm_sub_epi32(mm_widen_hi_epi16(l),
+	                  mm_half_sum_epi32(mm_widen_hi_epi16(h0), mm_widen_hi_epi16(h1)));
+	return _mm_packs_epi32(lo, hi);
+}
+
+/* odd = clamp((x0 + x2) / 2 + 2 * h) */
+static __inline __m128i __attribute__((ATTRIBUTES))
+rfx_idwt_extrapolate_odd_sse2(__m128i x0, __m128i x2, __m128i h)
+{
+	const __m128i lo =
+	    _mm_add_epi32(mm_half_sum_epi32(mm_widen_lo_epi16(x0), mm_widen_lo_epi16(x2)),
+	                  _mm_slli_epi32(mm_widen_lo_epi16(h), 1));
+	const __m128i hi =
+	    _mm_add_epi32(mm_half_sum_epi32(mm_widen_hi_epi16(x0), mm_widen_hi_epi16(x2)),
+	                  _mm_slli_epi32(mm_widen_hi_epi16(h), 1));
+	return _mm_packs_epi32(lo, hi);
+}
+
+static __inline INT16 __attribute__((ATTRIBUTES)) rfx_idwt_clamp(INT32 val)
+{
+	if (val < INT16_MIN)
+		return INT16_MIN;
+	if (val > INT16_MAX)
+		return INT16_MAX;
+	return (INT16)val;
+}
+
+static __inline void __attribute__((ATTRIBUTES))
+rfx_idwt_extrapolate_horiz_sse2(const INT16* WINPR_RESTRICT pLowBand, size_t nLowStep,
+                                const INT16* WINPR_RESTRICT pHighBand, size_t nHighStep,
+                                INT16* WINPR_RESTRICT pDstBand, size_t nDstStep, size_t nLowCount,
+                                size_t nHighCount, size_t nDstCount)
+{
+	INT16 even[40] = { 0 };
+
+	WINPR_ASSERT(nHighCount >= 8);
+	WINPR_ASSERT(nHighCount < ARRAYSIZE(even));
+
+	for (size_t i = 0; i < nDstCount; i++)
+	{
+		const INT16* pL = pLowBand;
+		const INT16* pH = pHighBand;
+		INT16* pX = pDstBand;
+
+		/* even[n] = L[n] - (H[n - 1] + H[n]) / 2, H[-1] = H[0]. The last block of a row
+		 * overlaps the previous one instead of falling back to scalar code. */
+		for (size_t n = 0; n < nHighCount; n += 8)
+		{
+			const size_t x = MIN(n, nHighCount - 8);
+			const __m128i l = _mm_loadu_si128((const __m128i*)&pL[x]);
+			const __m128i h = _mm_loadu_si128((const __m128i*)&pH[x]);
+			const __m128i hp = (x == 0) ? _mm_insert_epi16(_mm_slli_si128(h, 2), pH[0], 0)
+			                            : _mm_loadu_si128((const __m128i*)&pH[x - 1]);
+			_mm_storeu_si128((__m128i*)&even[x], rfx_idwt_extrapolate_even_sse2(l, hp, h));
+		}
+		even[nHighCount] = even[nHighCount - 1];
+
+		/* odd[n] = (even[n] + even[n + 1]) / 2 + 2 * H[n], the last odd value of a row is
+		 * overwritten by the edge handling below */
+		for (size_t n = 0; n < nHighCount; n += 8)
+		{
+			const size_t x = MIN(n, nHighCount - 8);
+			const __m128i x0 = _mm_loadu_si128((const __m128i*)&even[x]);
+			const __m128i x2 = _mm_loadu_si128((const __m128i*)&even[x + 1]);
+			const __m128i h = _mm_loadu_si128((const __m128i*)&pH[x]);
+			const __m128i odd = rfx_idwt_extrapolate_odd_sse2(x0, x2, h);
+			_mm_storeu_si128((__m128i*)&pX[2 * x], _mm_unpacklo_epi16(x0, odd));
+			_mm_storeu_si128((__m128i*)&pX[2 * x + 8], _mm_unpackhi_epi16(x0, odd));
+		}
+
+		const INT32 X2 = even[nHighCount - 1];
+		const INT32 H0 = pH[nHighCount - 1];
+		pL += nHighCount;
+		pX += 2 * (nHighCount - 1);
+
+		if (nLowCount <= nHighCount)
+		{
+			pX[0] = (INT16)X2;
+			pX[1] = rfx_idwt_clamp(X2 + (2 * H0));
+		}
+		else if (nLowCount == nHighCount + 1)
+		{
+			const INT32 X0 = rfx_idwt_clamp(pL[0] - H0);
+			pX[0] = (INT16)X2;
+			pX[1] = rfx_idwt_clamp(((X0 + X2) / 2) + (2 * H0));
+			pX[2] = (INT16)X0;
+		}
+		else
+		{
+			const INT32 X0 = rfx_idwt_clamp(pL[0] - (H0 / 2));
+			pX[0] = (INT16)X2;
+			pX[1] = rfx_idwt_clamp(((X0 + X2) / 2) + (2 * H0));
+			pX[2] = (INT16)X0;
+			pX[3] = rfx_idwt_clamp((X0 + pL[1]) / 2);
+		}
+
+		pLowBand += nLowStep;
+		pHighBand += nHighStep;
+		pDstBand += nDstStep;
+	}
+}
+
+static __inline void __attribute__((ATTRIBUTES))
+rfx_idwt_extrapolate_vert_sse2(const INT16* WINPR_RESTRICT pLowBand, size_t nLowStep,
+                               const INT16* WINPR_RESTRICT pHighBand, size_t nHighStep,
+                               INT16* WINPR_RESTRICT pDstBand, size_t nDstStep, size_t nLowCount,
+                               size_t nHighCount, size_t nDstCount)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	WINPR_ASSERT(nDstCount >= 8);
+
+	/* 8 columns at a time, the last block overlaps the previous one */
+	for (size_t n = 0; n < nDstCount; n += 8)
+	{
+		const size_t x = MIN(n, nDstCount - 8);
+		const INT16* pL = &pLowBand[x];
+		const INT16* pH = &pHighBand[x];
+		INT16* pX = &pDstBand[x];
+
+		__m128i h0 = _mm_loadu_si128((const __m128i*)pH);
+		__m128i x0 = rfx_idwt_extrapolate_even_sse2(_mm_loadu_si128((const __m128i*)pL), h0, h0);
+
+		for (size_t j = 1; j < nHighCount; j++)
+		{
+			pH += nHighStep;
+			pL += nLowStep;
+			const __m128i h1 = _mm_loadu_si128((const __m128i*)pH);
+			const __m128i x2 =
+			    rfx_idwt_extrapolate_even_sse2(_mm_loadu_si128((const __m128i*)pL), h0, h1);
+			_mm_storeu_si128((__m128i*)pX, x0);
+			pX += nDstStep;
+			_mm_storeu_si128((__m128i*)pX, rfx_idwt_extrapolate_odd_sse2(x0, x2, h0));
+			pX += nDstStep;
+			x0 = x2;
+			h0 = h1;
+		}
+
+		const __m128i x2 = x0;
+		pL += nLowStep;
+		_mm_storeu_si128((__m128i*)pX, x2);
+		pX += nDstStep;
+
+		if (nLowCount <= nHighCount)
+		{
+			_mm_storeu_si128((__m128i*)pX, rfx_idwt_extrapolate_odd_sse2(x2, x2, h0));
+		}
+		else if (nLowCount == nHighCount + 1)
+		{
+			x0 = rfx_idwt_extrapolate_even_sse2(_mm_loadu_si128((const __m128i*)pL), h0, h0);
+			_mm_storeu_si128((__m128i*)pX, rfx_idwt_extrapolate_odd_sse2(x0, x2, h0));
+			pX += nDstStep;
+			_mm_storeu_si128((__m128i*)pX, x0);
+		}
+		else
+		{
+			x0 = rfx_idwt_extrapolate_even_sse2(_mm_loadu_si128((const __m128i*)pL), h0, zero);
+			_mm_storeu_si128((__m128i*)pX, rfx_idwt_extrapolate_odd_sse2(x0, x2, h0));
+			pX += nDstStep;
+			_mm_storeu_si128((__m128i*)pX, x0);
+			pX += nDstStep;
+			pL += nLowStep;
+			_mm_storeu_si128((__m128i*)pX, rfx_idwt_extrapolate_odd_sse2(
+			                                   x0, _mm_loadu_si128((const __m128i*)pL), zero));
+		}
+	}
+}
+
+static __inline size_t __attribute__((ATTRIBUTES)) prfx_get_band_l_count(size_t level)
+{
+	return (64 >> level) + 1;
+}
+
+static __inline size_t __attribute__((ATTRIBUTES)) prfx_get_band_h_count(size_t level)
+{
+	if (level == 1)
+		return (64 >> 1) - 1;
+	else
+		return (64 + (1 << (level - 1))) >> level;
+}
+
+static __inline void __attribute__((ATTRIBUTES))
+rfx_dwt_2d_extrapolate_decode_block_sse2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT temp,
+                                         size_t level)
+{
+	const size_t nBandL = prfx_get_band_l_count(level);
+	const size_t nBandH = prfx_get_band_h_count(level);
+	const size_t nDstStep = nBandL + nBandH;
+
+	const INT16* HL = &buffer[0];
+	const INT16* LH = &HL[nBandH * nBandL];
+	const INT16* HH = &LH[nBandL * nBandH];
+	const INT16* LL = &HH[nBandH * nBandH];
+	INT16* L = &temp[0];
+	INT16* H = &temp[nBandL * nDstStep];
+
+	/* horizontal (LL + HL -> L) */
+	rfx_idwt_extrapolate_horiz_sse2(LL, nBandL, HL, nBandH, L, nDstStep, nBandL, nBandH, nBandL);
+
+	/* horizontal (LH + HH -> H) */
+	rfx_idwt_extrapolate_horiz_sse2(LH, nBandL, HH, nBandH, H, nDstStep, nBandL, nBandH, nBandH);
+
+	/* vertical (L + H -> LL) */
+	rfx_idwt_extrapolate_vert_sse2(L, nDstStep, H, nDstStep, buffer, nDstStep, nBandL, nBandH,
+	                               nBandL + nBandH);
+}
+
+static void rfx_dwt_2d_extrapolate_decode_sse2(INT16* WINPR_RESTRICT buffer,
+                                               INT16* WINPR_RESTRICT temp)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(temp);
+
+	rfx_dwt_2d_extrapolate_decode_block_sse2(&buffer[3807], temp, 3);
+	rfx_dwt_2d_extrapolate_decode_block_sse2(&buffer[3007], temp, 2);
+	rfx_dwt_2d_extrapolate_decode_block_sse2(&buffer[0], temp, 1);
+}
 #endif
 
 void rfx_init_sse2_int(RFX_CONTEXT* WINPR_RESTRICT context)
@@ -462,6 +707,7 @@ void rfx_init_sse2_int(RFX_CONTEXT* WINPR_RESTRICT context)
 	context->quantization_decode = rfx_quantization_decode_sse2;
 	context->quantization_encode = rfx_quantization_encode_sse2;
 	context->dwt_2d_decode = rfx_dwt_2d_decode_sse2;
+	context->dwt_2d_extrapolate_decode = rfx_dwt_2d_extrapolate_decode_sse2;
 	context->dwt_2d_encode = rfx_dwt_2d_encode_sse2;
 #else
 	WINPR_UNUSED(context);
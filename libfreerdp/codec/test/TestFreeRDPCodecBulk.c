@@ -0,0 +1,292 @@
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/print.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/codec/bulk.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/metrics.h>
+#include <freerdp/settings.h>
+
+#include "../bulk.h"
+
+static const char TEST_ISLAND_DATA[] = "No man is an island entire of itself; every man "
+                                       "is a piece of the continent, a part of the main; "
+                                       "if a clod be washed away by the sea, Europe "
+                                       "is the less, as well as if a promontory were, as"
+                                       "well as any manner of thy friends or of thine "
+                                       "own were; any man's death diminishes me, "
+                                       "because I am involved in mankind. "
+                                       "And therefore never send to know for whom "
+                                       "the bell tolls; it tolls for thee.";
+
+static BOOL test_context_init(rdpContext* context)
+{
+	context->settings = freerdp_settings_new(0);
+	if (!context->settings)
+		return FALSE;
+	context->metrics = metrics_new(context);
+	return context->metrics != NULL;
+}
+
+static void test_context_uninit(rdpContext* context)
+{
+	metrics_free(context->metrics);
+	freerdp_settings_free(context->settings);
+}
+
+static BOOL test_usage(const char* what, rdpContext* context, rdpBulk* bulk, size_t min,
+                       size_t max)
+{
+	const size_t usage = bulk_memory_usage(bulk);
+
+	if ((usage < min) || (usage > max) || (context->metrics->BulkMemoryUsage != usage))
+	{
+		printf("[%s] unexpected memory usage %" PRIuz " [%" PRIuz ", %" PRIuz "], metrics %" PRIu64
+		       "\n",
+		       what, usage, min, max, context->metrics->BulkMemoryUsage);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Random data must be sent as it is without breaking the history of the receiver */
+static BOOL test_incompressible(rdpBulk* sender, rdpBulk* receiver, UINT32 level)
+{
+	BYTE data[1024] = { 0 };
+	UINT32 flags = 0;
+	UINT32 size = 0;
+	UINT32 outSize = 0;
+	const BYTE* pDstData = NULL;
+	const BYTE* pOutData = NULL;
+
+	winpr_RAND(data, sizeof(data));
+
+	if (bulk_compress(sender, data, sizeof(data), &pDstData, &size, &flags) < 0)
+		return FALSE;
+
+	/* RDP8 segments carry their own flags, the packet only grows by the segment headers */
+	if (level == PACKET_COMPR_TYPE_RDP8)
+	{
+		if (size > sizeof(data) + 2)
+		{
+			printf("[%s] level %" PRIu32 " size %" PRIu32 " exceeds the raw segment\n", __func__,
+			       level, size);
+			return FALSE;
+		}
+	}
+	else if ((flags & PACKET_COMPRESSED) || (size != sizeof(data)) ||
+	         (memcmp(pDstData, data, size) != 0))
+	{
+		printf("[%s] level %" PRIu32 " flags 0x%08" PRIx32 " size %" PRIu32
+		       ", expected an uncompressed packet\n",
+		       __func__, level, flags, size);
+		return FALSE;
+	}
+
+	if (bulk_decompress(receiver, pDstData, size, &pOutData, &outSize, flags | level) < 0)
+		return FALSE;
+
+	return (outSize == sizeof(data)) && (memcmp(pOutData, data, outSize) == 0);
+}
+
+/* Contexts are only created for the type in use, so the sizes differ by orders of magnitude */
+static BOOL test_roundtrip(rdpContext* sendContext, rdpBulk* sender, rdpContext* recvContext,
+                           rdpBulk* receiver, UINT32 level, UINT32 effort, size_t maxUsage)
+{
+	if (!freerdp_settings_set_uint32(sendContext->settings, FreeRDP_CompressionLevel, level))
+		return FALSE;
+	if (!freerdp_settings_set_uint32(sendContext->settings, FreeRDP_CompressionEffort, effort))
+		return FALSE;
+
+	for (size_t x = 0; x < 4; x++)
+	{
+		UINT32 flags = 0;
+		UINT32 size = 0;
+		UINT32 outSize = 0;
+		const BYTE* pDstData = NULL;
+		const BYTE* pOutData = NULL;
+
+		if ((x == 2) && !test_incompressible(sender, receiver, level))
+			return FALSE;
+
+		if (bulk_compress(sender, (const BYTE*)TEST_ISLAND_DATA, sizeof(TEST_ISLAND_DATA) - 1,
+		                  &pDstData, &size, &flags) < 0)
+			return FALSE;
+
+		if (bulk_decompress(receiver, pDstData, size, &pOutData, &outSize, flags | level) < 0)
+			return FALSE;
+
+		if ((outSize != sizeof(TEST_ISLAND_DATA) - 1) ||
+		    (memcmp(pOutData, TEST_ISLAND_DATA, outSize) != 0))
+		{
+			printf("[%s] level %" PRIu32 " effort %" PRIu32 " roundtrip mismatch\n", __func__,
+			       level, effort);
+			return FALSE;
+		}
+	}
+
+	/* the sender additionally keeps the output buffer and the match finder tables */
+	if (!test_usage("send", sendContext, sender, 1, maxUsage + 256 * 1024))
+		return FALSE;
+	if (!test_usage("recv", recvContext, receiver, 1, maxUsage))
+		return FALSE;
+
+	/* a reset hands the contexts back, the next packets use fresh (or reset pooled) ones */
+	bulk_reset(sender);
+	bulk_reset(receiver);
+	if (!test_usage("send reset", sendContext, sender, 0, 65536))
+		return FALSE;
+	return test_usage("recv reset", recvContext, receiver, 0, 0);
+}
+
+/* Text, repeated pixel rows and some noise, roughly what fastpath updates carry */
+static BYTE* test_create_data(size_t size)
+{
+	BYTE* data = malloc(size);
+	if (!data)
+		return NULL;
+
+	for (size_t x = 0; x < size; x++)
+	{
+		const size_t line = x / 256;
+		if ((line % 7) == 3)
+			data[x] = (BYTE)(x * 13 + line);
+		else if ((line % 5) == 1)
+			data[x] = (BYTE)TEST_ISLAND_DATA[x % (sizeof(TEST_ISLAND_DATA) - 1)];
+		else
+			data[x] = (BYTE)((x % 4) == 3 ? 0xFF : 0x20 + (x / 1024) % 4);
+	}
+
+	for (size_t x = 0; x < size; x += 16384)
+		winpr_RAND(&data[x], MIN(size - x, 512));
+	return data;
+}
+
+static BOOL test_speed(UINT32 level, UINT32 effort)
+{
+	BOOL rc = FALSE;
+	const size_t packetSize = 4000;
+	const size_t totalSize = 256 * packetSize;
+	UINT64 compressed = 0;
+	UINT64 duration = 0;
+	rdpContext sendContext = { 0 };
+	rdpContext recvContext = { 0 };
+	rdpBulk* sender = NULL;
+	rdpBulk* receiver = NULL;
+	BYTE* data = test_create_data(totalSize);
+
+	if (!data || !test_context_init(&sendContext) || !test_context_init(&recvContext))
+		goto fail;
+
+	if (!freerdp_settings_set_uint32(sendContext.settings, FreeRDP_CompressionLevel, level) ||
+	    !freerdp_settings_set_uint32(sendContext.settings, FreeRDP_CompressionEffort, effort))
+		goto fail;
+
+	sender = bulk_new(&sendContext);
+	receiver = bulk_new(&recvContext);
+	if (!sender || !receiver)
+		goto fail;
+
+	for (size_t x = 0; x < totalSize; x += packetSize)
+	{
+		UINT32 flags = 0;
+		UINT32 size = 0;
+		UINT32 outSize = 0;
+		const BYTE* pDstData = NULL;
+		const BYTE* pOutData = NULL;
+		const UINT64 start = winpr_GetTickCount64NS();
+		const int status =
+		    bulk_compress(sender, &data[x], (UINT32)packetSize, &pDstData, &size, &flags);
+		duration += winpr_GetTickCount64NS() - start;
+
+		if (status < 0)
+			goto fail;
+
+		if ((bulk_decompress(receiver, pDstData, size, &pOutData, &outSize, flags | level) < 0) ||
+		    (outSize != packetSize) || (memcmp(pOutData, &data[x], outSize) != 0))
+		{
+			printf("[%s] level %" PRIu32 " effort %" PRIu32 " roundtrip mismatch\n", __func__,
+			       level, effort);
+			goto fail;
+		}
+
+		compressed += size;
+	}
+
+	printf("[%s] level %" PRIu32 " effort %" PRIu32 " ratio %.2f%% (%" PRIuz " -> %" PRIu64
+	       " bytes), %.2f MB/s\n",
+	       __func__, level, effort, 100.0 * (double)compressed / (double)totalSize, totalSize,
+	       compressed, duration > 0 ? (double)totalSize * 1000.0 / (double)duration : 0.0);
+	rc = compressed < totalSize;
+
+fail:
+	bulk_free(sender);
+	bulk_free(receiver);
+	test_context_uninit(&sendContext);
+	test_context_uninit(&recvContext);
+	free(data);
+	return rc;
+}
+
+int TestFreeRDPCodecBulk(int argc, char* argv[])
+{
+	int rc = -1;
+	rdpContext sendContext = { 0 };
+	rdpContext recvContext = { 0 };
+	rdpBulk* sender = NULL;
+	rdpBulk* receiver = NULL;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_context_init(&sendContext) || !test_context_init(&recvContext))
+		goto fail;
+
+	sender = bulk_new(&sendContext);
+	receiver = bulk_new(&recvContext);
+	if (!sender || !receiver)
+		goto fail;
+
+	/* nothing is allocated until data is compressed */
+	if (!test_usage("new", &sendContext, sender, 0, 0))
+		goto fail;
+
+	for (UINT32 effort = BULK_COMPRESSION_EFFORT_DEFAULT; effort <= BULK_COMPRESSION_EFFORT_MAX;
+	     effort++)
+	{
+		if (!test_roundtrip(&sendContext, sender, &recvContext, receiver, PACKET_COMPR_TYPE_8K,
+		                    effort, 256 * 1024))
+			goto fail;
+		if (!test_roundtrip(&sendContext, sender, &recvContext, receiver, PACKET_COMPR_TYPE_64K,
+		                    effort, 256 * 1024))
+			goto fail;
+		if (!test_roundtrip(&sendContext, sender, &recvContext, receiver, PACKET_COMPR_TYPE_RDP6,
+		                    effort, 512 * 1024))
+			goto fail;
+		if (!test_roundtrip(&sendContext, sender, &recvContext, receiver, PACKET_COMPR_TYPE_RDP61,
+		                    effort, 4 * 1024 * 1024))
+			goto fail;
+		if (!test_roundtrip(&sendContext, sender, &recvContext, receiver, PACKET_COMPR_TYPE_RDP8,
+		                    effort, 4 * 1024 * 1024))
+			goto fail;
+	}
+
+	for (UINT32 level = PACKET_COMPR_TYPE_8K; level <= PACKET_COMPR_TYPE_RDP8; level++)
+	{
+		for (UINT32 effort = BULK_COMPRESSION_EFFORT_DEFAULT;
+		     effort <= BULK_COMPRESSION_EFFORT_MAX; effort++)
+		{
+			if (!test_speed(level, effort))
+				goto fail;
+		}
+	}
+
+	rc = 0;
+fail:
+	bulk_free(sender);
+	bulk_free(receiver);
+	test_context_uninit(&sendContext);
+	test_context_uninit(&recvContext);
+	return rc;
+}
@@ -3,6 +3,10 @@
 #include <winpr/platform.h>
 
 #include <freerdp/codec/clear.h>
+#include <freerdp/codec/planar.h>
+#include <winpr/image.h>
+#include <winpr/path.h>
+#include <winpr/sysinfo.h>
 
 WINPR_PRAGMA_DIAG_PUSH
 WINPR_PRAGMA_DIAG_IGNORED_UNUSED_CONST_VAR
@@ -68,6 +72,195 @@ fail:
 	return rc;
 }
 
+static void test_ClearFillText(BYTE* data, UINT32 width, UINT32 height, UINT32 seed)
+{
+	/* White background with dark glyph like strokes, some anti aliasing and a color bar */
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			BYTE* px = &data[(1ull * y * width + x) * 4];
+			BYTE v = 0xFF;
+			const UINT32 cx = (x + seed) % 9;
+			const UINT32 cy = y % 16;
+
+			if ((cy > 2) && (cy < 13) && ((cx == 2) || ((cy == 7) && (cx < 7))))
+				v = 0x20;
+			else if ((cy > 2) && (cy < 13) && (cx == 3))
+				v = 0xA0;
+
+			px[0] = v;
+			px[1] = v;
+			px[2] = v;
+			px[3] = 0xFF;
+
+			if (y >= height - 8)
+			{
+				px[0] = (BYTE)((x / 8) * 6);
+				px[1] = 0x40;
+				px[2] = (BYTE)(255 - (x / 8) * 6);
+			}
+		}
+	}
+}
+
+static BOOL test_ClearRoundTripImage(CLEAR_CONTEXT* encoder, CLEAR_CONTEXT* decoder,
+                                     const BYTE* data, UINT32 width, UINT32 height,
+                                     UINT32 nSrcStep, BOOL exact, size_t* pSize)
+{
+	BOOL rc = FALSE;
+	BYTE* pDstData = calloc(4ull * width, height);
+	wStream* s = Stream_New(NULL, 1024);
+
+	if (!pDstData || !s)
+		goto fail;
+
+	if (!clear_compress_to_stream(encoder, s, data, PIXEL_FORMAT_BGRX32, nSrcStep, width, height))
+		goto fail;
+
+	if (clear_decompress(decoder, Stream_Buffer(s), (UINT32)Stream_GetPosition(s), width, height,
+	                     pDstData, PIXEL_FORMAT_BGRX32, 4 * width, 0, 0, width, height, NULL) != 0)
+		goto fail;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			const BYTE* a = &data[1ull * y * nSrcStep + 4ull * x];
+			const BYTE* b = &pDstData[4ull * (1ull * y * width + x)];
+
+			for (size_t c = 0; c < 3; c++)
+			{
+				const int d = abs((int)a[c] - (int)b[c]);
+
+				if ((exact && (d != 0)) || (d > 0x20))
+				{
+					(void)printf("clear round trip mismatch at %" PRIu32 "x%" PRIu32 "\n", x, y);
+					goto fail;
+				}
+			}
+		}
+	}
+
+	*pSize = Stream_GetPosition(s);
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	free(pDstData);
+	return rc;
+}
+
+static BOOL test_ClearRoundTrip(void)
+{
+	BOOL rc = FALSE;
+	size_t first = 0;
+	size_t second = 0;
+	size_t glyph1 = 0;
+	size_t glyph2 = 0;
+	const UINT32 width = 333;
+	const UINT32 height = 120;
+	BYTE* data = calloc(4ull * width, height);
+	CLEAR_CONTEXT* encoder = clear_context_new(TRUE);
+	CLEAR_CONTEXT* decoder = clear_context_new(FALSE);
+
+	if (!data || !encoder || !decoder)
+		goto fail;
+
+	test_ClearFillText(data, width, height, 0);
+
+	if (!test_ClearRoundTripImage(encoder, decoder, data, width, height, 4 * width, TRUE, &first))
+		goto fail;
+
+	/* Shifted text, encoder caches must stay in sync with the decoder */
+	test_ClearFillText(data, width, height, 4);
+
+	if (!test_ClearRoundTripImage(encoder, decoder, data, width, height, 4 * width, TRUE, &second))
+		goto fail;
+
+	/* Small bitmaps are glyphs, the second time only the glyph index is sent */
+	if (!test_ClearRoundTripImage(encoder, decoder, data, 8, 16, 4 * width, TRUE, &glyph1))
+		goto fail;
+
+	if (!test_ClearRoundTripImage(encoder, decoder, data, 8, 16, 4 * width, TRUE, &glyph2))
+		goto fail;
+
+	(void)printf("clear round trip: %" PRIuz " / %" PRIuz " bytes, glyph %" PRIuz " / %" PRIuz
+	             " bytes\n",
+	             first, second, glyph1, glyph2);
+
+	if ((glyph2 != 4) || (first >= 4ull * width * height / 8) ||
+	    (second >= 4ull * width * height / 8))
+		goto fail;
+
+	/* Without the geometry the legacy API can not encode, it must fail visibly */
+	BYTE* pDstData = data;
+	UINT32 DstSize = 1;
+	if ((clear_compress(encoder, data, 4 * width * height, &pDstData, &DstSize) >= 0) ||
+	    pDstData || (DstSize != 0))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	clear_context_free(encoder);
+	clear_context_free(decoder);
+	free(data);
+	return rc;
+}
+
+static BOOL test_ClearBenchmark(const char* path, const char* file)
+{
+	BOOL rc = FALSE;
+	size_t clearSize = 0;
+	UINT32 planarSize = 0;
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, file);
+	CLEAR_CONTEXT* encoder = clear_context_new(TRUE);
+	CLEAR_CONTEXT* decoder = clear_context_new(FALSE);
+	BITMAP_PLANAR_CONTEXT* planar = NULL;
+	BYTE* planarData = NULL;
+
+	if (!image || !name || !encoder || !decoder)
+		goto fail;
+
+	if (winpr_image_read(image, name) <= 0)
+		goto fail;
+
+	planar = freerdp_bitmap_planar_context_new(PLANAR_FORMAT_HEADER_NA | PLANAR_FORMAT_HEADER_RLE,
+	                                           image->width, image->height);
+
+	if (!planar)
+		goto fail;
+
+	const UINT64 start = winpr_GetTickCount64NS();
+
+	if (!test_ClearRoundTripImage(encoder, decoder, image->data, image->width, image->height,
+	                              image->scanline, FALSE, &clearSize))
+		goto fail;
+
+	const UINT64 mid = winpr_GetTickCount64NS();
+	planarData = freerdp_bitmap_compress_planar(planar, image->data, PIXEL_FORMAT_BGRX32,
+	                                            image->width, image->height, image->scanline, NULL,
+	                                            &planarSize);
+	const UINT64 end = winpr_GetTickCount64NS();
+
+	if (!planarData)
+		goto fail;
+
+	(void)printf("%s [%" PRIu32 "x%" PRIu32 "]: clear %" PRIuz " bytes (%" PRIu64
+	             " us incl. decode), planar %" PRIu32 " bytes (%" PRIu64 " us)\n",
+	             file, image->width, image->height, clearSize, (mid - start) / 1000, planarSize,
+	             (end - mid) / 1000);
+	rc = TRUE;
+fail:
+	free(planarData);
+	freerdp_bitmap_planar_context_free(planar);
+	clear_context_free(encoder);
+	clear_context_free(decoder);
+	winpr_image_free(image, TRUE);
+	free(name);
+	return rc;
+}
+
 int TestFreeRDPCodecClear(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -87,5 +280,16 @@ int TestFreeRDPCodecClear(int argc, char* argv[])
 	if (!test_ClearDecompressExample(4, 7, 15, TEST_CLEAR_EXAMPLE_4, sizeof(TEST_CLEAR_EXAMPLE_4)))
 		return -1;
 
+	if (!test_ClearRoundTrip())
+		return -1;
+
+	const char* files[] = { "test01.bmp", "rfx.bmp", "progressive.bmp" };
+
+	for (size_t x = 0; x < ARRAYSIZE(files); x++)
+	{
+		if (!test_ClearBenchmark(CMAKE_CURRENT_SOURCE_DIR, files[x]))
+			return -1;
+	}
+
 	return 0;
 }
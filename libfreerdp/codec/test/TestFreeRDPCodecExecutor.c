@@ -0,0 +1,154 @@
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/stream.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/codec/rfx.h>
+#include <freerdp/codec/executor.h>
+
+#define IMG_WIDTH 320
+#define IMG_HEIGHT 192
+#define IMG_FORMAT PIXEL_FORMAT_BGRX32
+#define IMG_STRIDE (IMG_WIDTH * 4)
+
+static void fill_image(BYTE* data)
+{
+	BYTE noise[IMG_WIDTH] = { 0 };
+
+	for (size_t y = 0; y < IMG_HEIGHT; y++)
+	{
+		winpr_RAND(noise, sizeof(noise));
+		for (size_t x = 0; x < IMG_WIDTH; x++)
+		{
+			BYTE* pixel = &data[y * IMG_STRIDE + x * 4];
+			pixel[0] = (BYTE)(x + (noise[x] & 0x0F));
+			pixel[1] = (BYTE)(y * 2);
+			pixel[2] = (BYTE)((x + y) / 2);
+			pixel[3] = 0xFF;
+		}
+	}
+}
+
+static BOOL encode(RFX_CONTEXT* context, const BYTE* image, wStream* s)
+{
+	const RFX_RECT rect = { 0, 0, IMG_WIDTH, IMG_HEIGHT };
+
+	if (!rfx_context_reset(context, IMG_WIDTH, IMG_HEIGHT))
+		return FALSE;
+	rfx_context_set_pixel_format(context, IMG_FORMAT);
+	return rfx_compose_message(context, s, &rect, 1, image, IMG_WIDTH, IMG_HEIGHT, IMG_STRIDE);
+}
+
+static BOOL decode(RFX_CONTEXT* context, wStream* s, BYTE* dst)
+{
+	REGION16 region = { 0 };
+
+	region16_init(&region);
+	const BOOL rc =
+	    rfx_process_message(context, Stream_Buffer(s), (UINT32)Stream_GetPosition(s), 0, 0, dst,
+	                        IMG_FORMAT, IMG_STRIDE, IMG_HEIGHT, &region);
+	region16_uninit(&region);
+	return rc;
+}
+
+/* The threaded codecs must produce the same output as the single threaded ones */
+static BOOL test_executor_rfx(void)
+{
+	BOOL rc = FALSE;
+	FREERDP_CODEC_EXECUTOR_STATS before = { 0 };
+	FREERDP_CODEC_EXECUTOR_STATS during = { 0 };
+	FREERDP_CODEC_EXECUTOR_STATS after = { 0 };
+	BYTE* image = calloc(IMG_HEIGHT, IMG_STRIDE);
+	BYTE* dst1 = calloc(IMG_HEIGHT, IMG_STRIDE);
+	BYTE* dst2 = calloc(IMG_HEIGHT, IMG_STRIDE);
+	wStream* s1 = Stream_New(NULL, 1024);
+	wStream* s2 = Stream_New(NULL, 1024);
+	RFX_CONTEXT* encoder1 = rfx_context_new_ex(TRUE, THREADING_FLAGS_DISABLE_THREADS);
+	RFX_CONTEXT* decoder1 = rfx_context_new_ex(FALSE, THREADING_FLAGS_DISABLE_THREADS);
+	RFX_CONTEXT* encoder2 = NULL;
+	RFX_CONTEXT* decoder2 = NULL;
+
+	if (!freerdp_codec_executor_get_stats(&before))
+		goto fail;
+
+	encoder2 = rfx_context_new_ex(TRUE, 0);
+	decoder2 = rfx_context_new_ex(FALSE, 0);
+	if (!image || !dst1 || !dst2 || !s1 || !s2 || !encoder1 || !decoder1 || !encoder2 ||
+	    !decoder2)
+		goto fail;
+
+	fill_image(image);
+	if (!encode(encoder1, image, s1) || !encode(encoder2, image, s2))
+		goto fail;
+	if ((Stream_GetPosition(s1) != Stream_GetPosition(s2)) ||
+	    (memcmp(Stream_Buffer(s1), Stream_Buffer(s2), Stream_GetPosition(s1)) != 0))
+	{
+		(void)fprintf(stderr, "threaded encoder output differs\n");
+		goto fail;
+	}
+
+	if (!decode(decoder1, s1, dst1) || !decode(decoder2, s2, dst2))
+		goto fail;
+	if (memcmp(dst1, dst2, 1ull * IMG_HEIGHT * IMG_STRIDE) != 0)
+	{
+		(void)fprintf(stderr, "threaded decoder output differs\n");
+		goto fail;
+	}
+
+	if (!freerdp_codec_executor_get_stats(&during))
+		goto fail;
+
+	/* 15 tiles encoded and decoded */
+	if ((during.Queues < before.Queues + 2) || (during.PendingItems != 0) ||
+	    (during.SubmittedItems < before.SubmittedItems + 30) ||
+	    (during.CompletedItems != during.SubmittedItems) || (during.Threads > during.MaxThreads))
+	{
+		(void)fprintf(stderr, "unexpected executor statistics\n");
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
+	rfx_context_free(encoder1);
+	rfx_context_free(decoder1);
+	rfx_context_free(encoder2);
+	rfx_context_free(decoder2);
+
+	if (rc)
+	{
+		/* the worker threads are stopped with the last queue */
+		if (!freerdp_codec_executor_get_stats(&after) || (after.Queues != before.Queues) ||
+		    ((after.Queues == 0) && (after.Threads != 0)))
+			rc = FALSE;
+	}
+
+	Stream_Free(s1, TRUE);
+	Stream_Free(s2, TRUE);
+	free(image);
+	free(dst1);
+	free(dst2);
+	return rc;
+}
+
+int TestFreeRDPCodecExecutor(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!freerdp_codec_executor_set_max_threads(2) ||
+	    (freerdp_codec_executor_get_max_threads() != 2))
+		return -1;
+
+	if (!test_executor_rfx())
+		return -1;
+
+	/* a limit of one worker serialises the work of all contexts */
+	if (!freerdp_codec_executor_set_max_threads(1) || !test_executor_rfx())
+		return -1;
+
+	if (!freerdp_codec_executor_set_max_threads(0) ||
+	    (freerdp_codec_executor_get_max_threads() == 0))
+		return -1;
+
+	return 0;
+}
@@ -5,6 +5,9 @@
 
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/path.h>
+#include <winpr/image.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/codec/color.h>
@@ -156,6 +159,245 @@ fail:
 	return rc;
 }
 
+static BOOL compare_image(const BYTE* src, const BYTE* dst, UINT32 format, UINT32 step, UINT32 w,
+                          UINT32 h, UINT16 bpp)
+{
+	const UINT32 bstep = FreeRDPGetBytesPerPixel(format);
+	const int maxDiff = 4 * ((bpp < 24) ? 2 : 1);
+
+	for (UINT32 y = 0; y < h; y++)
+	{
+		for (UINT32 x = 0; x < w; x++)
+		{
+			BYTE r = 0;
+			BYTE g = 0;
+			BYTE b = 0;
+			BYTE dr = 0;
+			BYTE dg = 0;
+			BYTE db = 0;
+			const size_t offset = 1ULL * y * step + 1ULL * x * bstep;
+			const UINT32 srcColor = FreeRDPReadColor(&src[offset], format);
+			const UINT32 dstColor = FreeRDPReadColor(&dst[offset], format);
+			FreeRDPSplitColor(srcColor, format, &r, &g, &b, NULL, NULL);
+			FreeRDPSplitColor(dstColor, format, &dr, &dg, &db, NULL, NULL);
+
+			if ((abs(r - dr) > maxDiff) || (abs(g - dg) > maxDiff) || (abs(b - db) > maxDiff))
+			{
+				(void)fprintf(stderr,
+				              "[%s] %" PRIu16 "bpp %" PRIu32 "x%" PRIu32 " mismatch at %" PRIu32
+				              "x%" PRIu32 "\n",
+				              __func__, bpp, w, h, x, y);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* Patterns typical for desktop content, each one favouring a different order type */
+static UINT32 pattern_color(size_t pattern, UINT32 x, UINT32 y, UINT32 seed)
+{
+	const UINT32 format = PIXEL_FORMAT_RGBX32;
+
+	switch (pattern)
+	{
+		case 0: /* solid */
+			return FreeRDPGetColor(format, 0x20, 0x40, 0x80, 0xFF);
+
+		case 1: /* text, dark glyph strokes on a light background */
+			if (((y % 12) < 9) && ((((x * 7) ^ (y * 13) ^ seed) % 5) == 0))
+				return FreeRDPGetColor(format, 0x10, 0x10, 0x10, 0xFF);
+			return FreeRDPGetColor(format, 0xF0, 0xF0, 0xF0, 0xFF);
+
+		case 2: /* dithered */
+			if ((x + y) & 1)
+				return FreeRDPGetColor(format, 0xC0, 0xC0, 0xC0, 0xFF);
+			return FreeRDPGetColor(format, 0x80, 0x80, 0x80, 0xFF);
+
+		case 3: /* horizontal gradient */
+			return FreeRDPGetColor(format, (BYTE)(x * 4), (BYTE)(x * 2), 0x40, 0xFF);
+
+		case 4: /* black and white */
+			if (((x / 3) + (y / 5) + seed) % 3 == 0)
+				return FreeRDPGetColor(format, 0xFF, 0xFF, 0xFF, 0xFF);
+			return FreeRDPGetColor(format, 0x00, 0x00, 0x00, 0xFF);
+
+		default: /* window, title bar, border and noisy content */
+			if (y < 8)
+				return FreeRDPGetColor(format, 0x00, 0x50, 0xA0, 0xFF);
+			if ((x == 0) || (x == 63) || (y == 63))
+				return FreeRDPGetColor(format, 0x30, 0x30, 0x30, 0xFF);
+			if ((x > 16) && (x < 40) && (y > 20) && (y < 40))
+				return FreeRDPGetColor(format, (BYTE)(seed + x * y), (BYTE)(x ^ y), (BYTE)seed,
+				                       0xFF);
+			return FreeRDPGetColor(format, 0xFF, 0xFF, 0xFF, 0xFF);
+	}
+}
+
+static BOOL run_encode_decode_pattern(UINT16 bpp, BITMAP_INTERLEAVED_CONTEXT* encoder,
+                                      BITMAP_INTERLEAVED_CONTEXT* decoder)
+{
+	BOOL rc = FALSE;
+	const UINT32 sizes[][2] = { { 64, 64 }, { 4, 1 }, { 8, 3 }, { 60, 17 }, { 32, 64 } };
+	const UINT32 format = PIXEL_FORMAT_RGBX32;
+	const size_t step = 64ULL * 4ULL;
+	const size_t SrcSize = step * 64;
+	BYTE* pSrcData = calloc(1, SrcSize);
+	BYTE* pDstData = calloc(1, SrcSize);
+	BYTE* tmp = calloc(1, SrcSize);
+
+	if (!pSrcData || !pDstData || !tmp)
+		goto fail;
+
+	for (size_t pattern = 0; pattern < 6; pattern++)
+	{
+		for (size_t i = 0; i < ARRAYSIZE(sizes); i++)
+		{
+			const UINT32 w = sizes[i][0];
+			const UINT32 h = sizes[i][1];
+			UINT32 seed = 0;
+			UINT32 DstSize = (UINT32)SrcSize;
+
+			winpr_RAND(&seed, sizeof(seed));
+
+			for (UINT32 y = 0; y < h; y++)
+			{
+				for (UINT32 x = 0; x < w; x++)
+					FreeRDPWriteColor(&pSrcData[y * step + x * 4ULL], format,
+					                  pattern_color(pattern, x, y, seed % 7));
+			}
+
+			if (!interleaved_compress(encoder, tmp, &DstSize, w, h, pSrcData, format,
+			                          (UINT32)step, 0, 0, NULL, bpp))
+				goto fail;
+
+			if (!interleaved_decompress(decoder, tmp, DstSize, w, h, bpp, pDstData, format,
+			                            (UINT32)step, 0, 0, w, h, NULL))
+				goto fail;
+
+			if (!compare_image(pSrcData, pDstData, format, (UINT32)step, w, h, bpp))
+			{
+				(void)fprintf(stderr, "[%s] pattern %" PRIuz " failed\n", __func__, pattern);
+				goto fail;
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(pSrcData);
+	free(pDstData);
+	free(tmp);
+	return rc;
+}
+
+/* Compress an image in 64x64 tiles, comparing against the legacy freerdp_bitmap_compress */
+static BOOL run_benchmark(const char* path, const char* file, UINT16 bpp,
+                          BITMAP_INTERLEAVED_CONTEXT* encoder, BITMAP_INTERLEAVED_CONTEXT* decoder)
+{
+	BOOL rc = FALSE;
+	const UINT32 format = PIXEL_FORMAT_BGRX32;
+	const UINT32 legacyFormat = (bpp == 24)   ? PIXEL_FORMAT_BGRX32
+	                            : (bpp == 16) ? PIXEL_FORMAT_RGB16
+	                                          : PIXEL_FORMAT_RGB15;
+	const size_t tileStep = 64ULL * 4ULL;
+	const size_t tileSize = tileStep * 64ULL;
+	size_t rawSize = 0;
+	size_t size = 0;
+	size_t legacySize = 0;
+	UINT64 duration = 0;
+	UINT64 legacyDuration = 0;
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, file);
+	BYTE* tile = calloc(1, tileSize);
+	BYTE* legacyTile = calloc(1, tileSize);
+	BYTE* dst = calloc(1, tileSize);
+	BYTE* tmp = calloc(1, tileSize);
+	wStream* s = Stream_New(NULL, tileSize);
+	wStream* ts = Stream_New(NULL, tileSize);
+
+	if (!image || !name || !tile || !legacyTile || !dst || !tmp || !s || !ts)
+		goto fail;
+
+	if (winpr_image_read(image, name) <= 0)
+		goto fail;
+
+	for (UINT32 y = 0; y < image->height; y += 64)
+	{
+		for (UINT32 x = 0; x < image->width; x += 64)
+		{
+			/* interleaved bitmaps must be a multiple of 4 pixels wide */
+			const UINT32 w = MIN(64, image->width - x) & ~3u;
+			const UINT32 h = MIN(64, image->height - y);
+			UINT32 DstSize = (UINT32)tileSize;
+
+			if (w == 0)
+				continue;
+
+			if (!freerdp_image_copy_no_overlap(tile, format, (UINT32)tileStep, 0, 0, w, h,
+			                                   image->data, format, image->scanline, x, y, NULL,
+			                                   FREERDP_FLIP_NONE))
+				goto fail;
+
+			const UINT64 start = winpr_GetTickCount64NS();
+			if (!interleaved_compress(encoder, tmp, &DstSize, w, h, tile, format, (UINT32)tileStep,
+			                          0, 0, NULL, bpp))
+				goto fail;
+			const UINT64 end = winpr_GetTickCount64NS();
+
+			if (!interleaved_decompress(decoder, tmp, DstSize, w, h, bpp, dst, format,
+			                            (UINT32)tileStep, 0, 0, w, h, NULL))
+				goto fail;
+
+			if (!compare_image(tile, dst, format, (UINT32)tileStep, w, h, bpp))
+				goto fail;
+
+			/* the legacy encoder expects the converted image and emits it bottom up */
+			const UINT32 legacyStep = w * FreeRDPGetBytesPerPixel(legacyFormat);
+			if (!freerdp_image_copy_no_overlap(legacyTile, legacyFormat, legacyStep, 0, 0, w, h,
+			                                   tile, format, (UINT32)tileStep, 0, 0, NULL,
+			                                   FREERDP_FLIP_NONE))
+				goto fail;
+
+			Stream_SetPosition(s, 0);
+			Stream_SetPosition(ts, 0);
+			const UINT64 legacyStart = winpr_GetTickCount64NS();
+			if (freerdp_bitmap_compress(legacyTile, w, h, s, bpp, (UINT32)tileSize, h - 1, ts, 0) <
+			    0)
+				goto fail;
+			const UINT64 legacyEnd = winpr_GetTickCount64NS();
+
+			rawSize += 1ULL * w * h * ((bpp + 7) / 8);
+			size += DstSize;
+			legacySize += Stream_GetPosition(s);
+			duration += end - start;
+			legacyDuration += legacyEnd - legacyStart;
+		}
+	}
+
+	(void)printf("%s %" PRIu16 "bpp: raw %" PRIuz " bytes, interleaved_compress %" PRIuz
+	             " bytes (%" PRIu64 " us), freerdp_bitmap_compress %" PRIuz " bytes (%" PRIu64
+	             " us)\n",
+	             file, bpp, rawSize, size, duration / 1000, legacySize, legacyDuration / 1000);
+
+	/* the run search must never do worse than the greedy legacy encoder */
+	if (size > legacySize)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	Stream_Free(ts, TRUE);
+	free(tile);
+	free(legacyTile);
+	free(dst);
+	free(tmp);
+	winpr_image_free(image, TRUE);
+	free(name);
+	return rc;
+}
+
 static BOOL TestColorConversion(void)
 {
 	const UINT32 formats[] = { PIXEL_FORMAT_RGB15,  PIXEL_FORMAT_BGR15, PIXEL_FORMAT_ABGR15,
@@ -211,6 +453,20 @@ int TestFreeRDPCodecInterleaved(int argc, char* argv[])
 	if (!TestColorConversion())
 		goto fail;
 
+	for (UINT16 bpp = 15; bpp <= 24; bpp += (bpp == 16) ? 8 : 1)
+	{
+		const char* files[] = { "test01.bmp", "rfx.bmp", "progressive.bmp" };
+
+		if (!run_encode_decode_pattern(bpp, encoder, decoder))
+			goto fail;
+
+		for (size_t x = 0; x < ARRAYSIZE(files); x++)
+		{
+			if (!run_benchmark(CMAKE_CURRENT_SOURCE_DIR, files[x], bpp, encoder, decoder))
+				goto fail;
+		}
+	}
+
 	rc = 0;
 fail:
 	bitmap_interleaved_context_free(encoder);
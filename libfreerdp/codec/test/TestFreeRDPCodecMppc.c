@@ -735,22 +735,26 @@ static const BYTE TEST_ISLAND_DATA_RDP5[] =
     "\x43\x7b\x6f\xa8\xe5\x8b\xd0\xf0\xe8\xde\xd8\xd8\xe7\xec\xf3\xa7"
     "\xe4\x7c\xa7\xe2\x9f\x01\x99\x4b\x80";
 
-static int test_MppcCompressBellsRdp5(void)
+/**
+ * The compressor is free to pick other matches than the fixtures, so the output is checked by
+ * decompressing it again. The fixtures still bound the compressed size.
+ */
+static int test_MppcCompressRoundtrip(const char* name, UINT32 level, const BYTE* pSrcData,
+                                      UINT32 SrcSize, UINT32 expectedSize)
 {
 	int rc = -1;
 	int status = 0;
 	UINT32 Flags = 0;
 	BYTE OutputBuffer[65536] = { 0 };
-	const UINT32 SrcSize = sizeof(TEST_MPPC_BELLS) - 1;
-	const BYTE* pSrcData = (const BYTE*)TEST_MPPC_BELLS;
 	UINT32 DstSize = sizeof(OutputBuffer);
 	const BYTE* pDstData = NULL;
-	const UINT32 expectedSize = sizeof(TEST_MPPC_BELLS_RDP5) - 1;
-
-	MPPC_CONTEXT* mppc = mppc_context_new(1, TRUE);
+	UINT32 OutSize = 0;
+	const BYTE* pOutData = NULL;
+	MPPC_CONTEXT* mppc = mppc_context_new(level, TRUE);
+	MPPC_CONTEXT* mppcRecv = mppc_context_new(level, FALSE);
 
-	if (!mppc)
-		return -1;
+	if (!mppc || !mppcRecv)
+		goto fail;
 
 	status = mppc_compress(mppc, pSrcData, SrcSize, OutputBuffer, &pDstData, &DstSize, &Flags);
 
@@ -759,75 +763,45 @@ static int test_MppcCompressBellsRdp5(void)
 
 	printf("Flags: 0x%08" PRIX32 " DstSize: %" PRIu32 "\n", Flags, DstSize);
 
-	if (DstSize != expectedSize)
+	if (!(Flags & PACKET_COMPRESSED) || (DstSize > expectedSize))
 	{
-		printf("MppcCompressBellsRdp5: output size mismatch: Actual: %" PRIu32
-		       ", Expected: %" PRIu32 "\n",
+		printf("%s: output size mismatch: Actual: %" PRIu32 ", Expected: <= %" PRIu32 "\n", name,
 		       DstSize, expectedSize);
 		goto fail;
 	}
 
-	if (memcmp(pDstData, TEST_MPPC_BELLS_RDP5, DstSize) != 0)
+	status = mppc_decompress(mppcRecv, pDstData, DstSize, &pOutData, &OutSize, Flags);
+
+	if (status < 0)
+		goto fail;
+
+	if ((OutSize != SrcSize) || (memcmp(pOutData, pSrcData, SrcSize) != 0))
 	{
-		printf("MppcCompressBellsRdp5: output mismatch\n");
+		printf("%s: roundtrip mismatch\n", name);
 		printf("Actual\n");
-		BitDump(__func__, WLOG_INFO, pDstData, DstSize * 8, 0);
-		printf("Expected\n");
-		BitDump(__func__, WLOG_INFO, TEST_MPPC_BELLS_RDP5, DstSize * 8, 0);
+		BitDump(name, WLOG_INFO, pDstData, DstSize * 8, 0);
 		goto fail;
 	}
 
 	rc = 0;
 fail:
 	mppc_context_free(mppc);
+	mppc_context_free(mppcRecv);
 	return rc;
 }
 
-static int test_MppcCompressBellsRdp4(void)
+static int test_MppcCompressBellsRdp5(void)
 {
-	int rc = -1;
-	int status = 0;
-	UINT32 Flags = 0;
-	BYTE OutputBuffer[65536] = { 0 };
-	const BYTE* pSrcData = (const BYTE*)TEST_MPPC_BELLS;
+	const UINT32 expectedSize = sizeof(TEST_MPPC_BELLS_RDP5) - 1;
 	const UINT32 SrcSize = sizeof(TEST_MPPC_BELLS) - 1;
-	UINT32 DstSize = sizeof(OutputBuffer);
-	const BYTE* pDstData = NULL;
-	const UINT32 expectedSize = sizeof(TEST_MPPC_BELLS_RDP4) - 1;
-	MPPC_CONTEXT* mppc = mppc_context_new(0, TRUE);
-
-	if (!mppc)
-		return -1;
-
-	status = mppc_compress(mppc, pSrcData, SrcSize, OutputBuffer, &pDstData, &DstSize, &Flags);
-
-	if (status < 0)
-		goto fail;
-
-	printf("flags: 0x%08" PRIX32 " size: %" PRIu32 "\n", Flags, DstSize);
-
-	if (DstSize != expectedSize)
-	{
-		printf("MppcCompressBellsRdp4: output size mismatch: Actual: %" PRIu32
-		       ", Expected: %" PRIu32 "\n",
-		       DstSize, expectedSize);
-		goto fail;
-	}
-
-	if (memcmp(pDstData, TEST_MPPC_BELLS_RDP4, DstSize) != 0)
-	{
-		printf("MppcCompressBellsRdp4: output mismatch\n");
-		printf("Actual\n");
-		BitDump(__func__, WLOG_INFO, pDstData, DstSize * 8, 0);
-		printf("Expected\n");
-		BitDump(__func__, WLOG_INFO, TEST_MPPC_BELLS_RDP4, DstSize * 8, 0);
-		goto fail;
-	}
+	return test_MppcCompressRoundtrip(__func__, 1, TEST_MPPC_BELLS, SrcSize, expectedSize);
+}
 
-	rc = 0;
-fail:
-	mppc_context_free(mppc);
-	return rc;
+static int test_MppcCompressBellsRdp4(void)
+{
+	const UINT32 expectedSize = sizeof(TEST_MPPC_BELLS_RDP4) - 1;
+	const UINT32 SrcSize = sizeof(TEST_MPPC_BELLS) - 1;
+	return test_MppcCompressRoundtrip(__func__, 0, TEST_MPPC_BELLS, SrcSize, expectedSize);
 }
 
 static int test_MppcDecompressBellsRdp5(void)
@@ -926,94 +900,17 @@ fail:
 
 static int test_MppcCompressIslandRdp5(void)
 {
-	int rc = -1;
-	int status = 0;
-	UINT32 Flags = 0;
-	BYTE OutputBuffer[65536] = { 0 };
-	const UINT32 SrcSize = sizeof(TEST_ISLAND_DATA) - 1;
-	const BYTE* pSrcData = (const BYTE*)TEST_ISLAND_DATA;
 	const UINT32 expectedSize = sizeof(TEST_ISLAND_DATA_RDP5) - 1;
-	UINT32 DstSize = sizeof(OutputBuffer);
-	const BYTE* pDstData = NULL;
-	MPPC_CONTEXT* mppc = mppc_context_new(1, TRUE);
-
-	if (!mppc)
-		return -1;
-
-	status = mppc_compress(mppc, pSrcData, SrcSize, OutputBuffer, &pDstData, &DstSize, &Flags);
-
-	if (status < 0)
-		goto fail;
-
-	printf("Flags: 0x%08" PRIX32 " DstSize: %" PRIu32 "\n", Flags, DstSize);
-
-	if (DstSize != expectedSize)
-	{
-		printf("MppcCompressIslandRdp5: output size mismatch: Actual: %" PRIu32
-		       ", Expected: %" PRIu32 "\n",
-		       DstSize, expectedSize);
-		goto fail;
-	}
-
-	if (memcmp(pDstData, TEST_ISLAND_DATA_RDP5, DstSize) != 0)
-	{
-		printf("MppcCompressIslandRdp5: output mismatch\n");
-		printf("Actual\n");
-		BitDump(__func__, WLOG_INFO, pDstData, DstSize * 8, 0);
-		printf("Expected\n");
-		BitDump(__func__, WLOG_INFO, TEST_ISLAND_DATA_RDP5, DstSize * 8, 0);
-		goto fail;
-	}
-
-	rc = 0;
-fail:
-	mppc_context_free(mppc);
-	return rc;
+	const UINT32 SrcSize = sizeof(TEST_ISLAND_DATA) - 1;
+	return test_MppcCompressRoundtrip(__func__, 1, TEST_ISLAND_DATA, SrcSize, expectedSize);
 }
 
 static int test_MppcCompressBufferRdp5(void)
 {
-	int rc = -1;
-	int status = 0;
-	UINT32 Flags = 0;
-	BYTE OutputBuffer[65536] = { 0 };
-	const UINT32 SrcSize = sizeof(TEST_RDP5_UNCOMPRESSED_DATA);
-	const BYTE* pSrcData = (const BYTE*)TEST_RDP5_UNCOMPRESSED_DATA;
 	const UINT32 expectedSize = sizeof(TEST_RDP5_COMPRESSED_DATA);
-	UINT32 DstSize = sizeof(OutputBuffer);
-
-	const BYTE* pDstData = NULL;
-	MPPC_CONTEXT* mppc = mppc_context_new(1, TRUE);
-
-	if (!mppc)
-		return -1;
-
-	status = mppc_compress(mppc, pSrcData, SrcSize, OutputBuffer, &pDstData, &DstSize, &Flags);
-
-	if (status < 0)
-		goto fail;
-
-	printf("flags: 0x%08" PRIX32 " size: %" PRIu32 "\n", Flags, DstSize);
-
-	if (DstSize != expectedSize)
-	{
-		printf("MppcCompressBufferRdp5: output size mismatch: Actual: %" PRIu32
-		       ", Expected: %" PRIu32 "\n",
-		       DstSize, expectedSize);
-		goto fail;
-	}
-
-	if (memcmp(pDstData, TEST_RDP5_COMPRESSED_DATA, DstSize) != 0)
-	{
-		printf("MppcCompressBufferRdp5: output mismatch: compressed output does not match "
-		       "Microsoft implementation\n");
-		goto fail;
-	}
-
-	rc = 0;
-fail:
-	mppc_context_free(mppc);
-	return rc;
+	const UINT32 SrcSize = sizeof(TEST_RDP5_UNCOMPRESSED_DATA);
+	return test_MppcCompressRoundtrip(__func__, 1, TEST_RDP5_UNCOMPRESSED_DATA, SrcSize,
+	                                  expectedSize);
 }
 
 static int test_MppcDecompressBufferRdp5(void)
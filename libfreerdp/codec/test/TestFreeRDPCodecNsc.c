@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <winpr/crt.h>
+#include <winpr/stream.h>
+#include <winpr/crypto.h>
+
+#include <freerdp/codec/nsc.h>
+#include <freerdp/codec/color.h>
+
+/* ColorLossLevel 1 drops one bit of chroma, 16 bpp green additionally lacks the low bits */
+#define NSC_TEST_TOLERANCE 6
+#define NSC_TEST_TOLERANCE_16BPP 10
+
+static BYTE* test_nsc_create_image(UINT32 format, UINT32 width, UINT32 height, UINT32 stride,
+                                   BOOL solid)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	BYTE* image = calloc(height, stride);
+	UINT32 color = 0;
+
+	if (!image)
+		return NULL;
+
+	winpr_RAND(&color, sizeof(color));
+
+	/* 2x2 blocks of the same color survive chroma subsampling, the encoder starts at the bottom */
+	for (UINT32 y = 0; y < height; y += 2)
+	{
+		for (UINT32 x = 0; x < width; x += 2)
+		{
+			if (!solid)
+				winpr_RAND(&color, sizeof(color));
+
+			for (UINT32 dy = y; dy < MIN(y + 2, height); dy++)
+			{
+				BYTE* line = &image[1ULL * (height - 1 - dy) * stride];
+
+				for (UINT32 dx = x; dx < MIN(x + 2, width); dx++)
+					FreeRDPWriteColor(&line[dx * bpp], format, color);
+			}
+		}
+	}
+
+	return image;
+}
+
+static BOOL test_nsc_compare(const BYTE* src, UINT32 srcFormat, UINT32 srcStride, const BYTE* dst,
+                             UINT32 dstStride, UINT32 width, UINT32 height)
+{
+	const size_t sbpp = FreeRDPGetBytesPerPixel(srcFormat);
+	const BOOL alpha = FreeRDPColorHasAlpha(srcFormat);
+	const int tolerance = (sbpp == 2) ? NSC_TEST_TOLERANCE_16BPP : NSC_TEST_TOLERANCE;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			BYTE sr = 0;
+			BYTE sg = 0;
+			BYTE sb = 0;
+			BYTE sa = 0;
+			BYTE dr = 0;
+			BYTE dg = 0;
+			BYTE db = 0;
+			BYTE da = 0;
+			const UINT32 scolor =
+			    FreeRDPReadColor(&src[1ULL * y * srcStride + x * sbpp], srcFormat);
+			const UINT32 dcolor =
+			    FreeRDPReadColor(&dst[1ULL * y * dstStride + x * 4ULL], PIXEL_FORMAT_BGRA32);
+			FreeRDPSplitColor(scolor, srcFormat, &sr, &sg, &sb, &sa, NULL);
+			FreeRDPSplitColor(dcolor, PIXEL_FORMAT_BGRA32, &dr, &dg, &db, &da, NULL);
+
+			if ((abs(sr - dr) > tolerance) || (abs(sg - dg) > tolerance) ||
+			    (abs(sb - db) > tolerance) || (alpha && (sa != da)))
+			{
+				(void)fprintf(stderr,
+				              "[%s] %s %" PRIu32 "x%" PRIu32 " mismatch at %" PRIu32 "x%" PRIu32
+				              ": %02" PRIx8 "%02" PRIx8 "%02" PRIx8 "%02" PRIx8
+				              " != %02" PRIx8 "%02" PRIx8 "%02" PRIx8 "%02" PRIx8 "\n",
+				              __func__, FreeRDPGetColorFormatName(srcFormat), width, height, x, y,
+				              sr, sg, sb, sa, dr, dg, db, da);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_nsc_round_trip(UINT32 format, UINT32 width, UINT32 height, BOOL subsampling,
+                                BOOL solid)
+{
+	BOOL rc = FALSE;
+	const UINT32 srcStride = width * FreeRDPGetBytesPerPixel(format) + 8;
+	const UINT32 dstStride = width * 4;
+	BYTE* src = test_nsc_create_image(format, width, height, srcStride, solid);
+	BYTE* dst = calloc(height, dstStride);
+	NSC_CONTEXT* encoder = nsc_context_new();
+	NSC_CONTEXT* decoder = nsc_context_new();
+	wStream* s = Stream_New(NULL, 1024);
+
+	if (!src || !dst || !encoder || !decoder || !s)
+		goto fail;
+
+	if (!nsc_context_set_parameters(encoder, NSC_COLOR_FORMAT, format) ||
+	    !nsc_context_set_parameters(encoder, NSC_COLOR_LOSS_LEVEL, 1) ||
+	    !nsc_context_set_parameters(encoder, NSC_ALLOW_SUBSAMPLING, subsampling ? 1 : 0))
+		goto fail;
+
+	/* encode twice to check the context is reusable */
+	for (size_t i = 0; i < 2; i++)
+	{
+		Stream_SetPosition(s, 0);
+
+		if (!nsc_compose_message(encoder, s, src, width, height, srcStride))
+			goto fail;
+	}
+
+	/* the encoder stores the image bottom up */
+	if (!nsc_process_message(decoder, 32, width, height, Stream_Buffer(s),
+	                         (UINT32)Stream_GetPosition(s), dst, PIXEL_FORMAT_BGRA32, dstStride, 0,
+	                         0, width, height, FREERDP_FLIP_VERTICAL))
+		goto fail;
+
+	rc = test_nsc_compare(src, format, srcStride, dst, dstStride, width, height);
+
+fail:
+	if (!rc)
+		(void)fprintf(stderr, "[%s] %s %" PRIu32 "x%" PRIu32 " subsampling=%d failed\n", __func__,
+		              FreeRDPGetColorFormatName(format), width, height, subsampling);
+	Stream_Free(s, TRUE);
+	nsc_context_free(encoder);
+	nsc_context_free(decoder);
+	free(src);
+	free(dst);
+	return rc;
+}
+
+int TestFreeRDPCodecNsc(int argc, char* argv[])
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_BGR24,  PIXEL_FORMAT_RGB24,
+		                       PIXEL_FORMAT_BGR16,  PIXEL_FORMAT_RGB16 };
+	const UINT32 sizes[][2] = { { 1, 1 }, { 7, 3 }, { 16, 16 }, { 67, 131 }, { 301, 259 } };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	for (size_t f = 0; f < ARRAYSIZE(formats); f++)
+	{
+		for (size_t i = 0; i < ARRAYSIZE(sizes); i++)
+		{
+			for (int subsampling = 0; subsampling < 2; subsampling++)
+			{
+				if (!test_nsc_round_trip(formats[f], sizes[i][0], sizes[i][1], subsampling, FALSE))
+					return -1;
+
+				if (!test_nsc_round_trip(formats[f], sizes[i][0], sizes[i][1], subsampling, TRUE))
+					return -1;
+			}
+		}
+	}
+
+	return 0;
+}
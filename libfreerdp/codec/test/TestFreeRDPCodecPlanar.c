@@ -5461,6 +5461,10 @@ static BOOL CompareBitmap(const BYTE* srcA, UINT32 srcAFormat, const BYTE* srcB,
 			maxDiff = 0.0;
 	}
 
+	/* 15/16 bpp channels are expanded to 8 bit planes and reduced again, +/- 1bit */
+	if ((srcABits <= 16) && (srcBBits <= 16))
+		maxDiff = MAX(maxDiff, 2 * 2.0);
+
 	for (size_t y = 0; y < height; y++)
 	{
 		const BYTE* lineA = &srcA[y * width * FreeRDPGetBytesPerPixel(srcAFormat)];
@@ -5513,10 +5517,6 @@ static BOOL RunTestPlanar(BITMAP_PLANAR_CONTEXT* planar, const BYTE* srcBitmap,
 	(void)printf("%s [%s] --> [%s]: ", __func__, FreeRDPGetColorFormatName(srcFormat),
 	             FreeRDPGetColorFormatName(dstFormat));
 	(void)fflush(stdout);
-	printf("TODO: Skipping unfinished test!");
-	rc = TRUE;
-	goto fail;
-
 	if (!compressedBitmap || !decompressedBitmap)
 		goto fail;
 
@@ -5628,6 +5628,9 @@ static BOOL TestPlanar(const UINT32 format)
 	if (!planar)
 		goto fail;
 
+	/* The test bitmaps are top down, decompress below does not flip them */
+	freerdp_planar_topdown_image(planar, TRUE);
+
 	if (!RunTestPlanar(planar, TEST_RLE_BITMAP_EXPERIMENTAL_01, PIXEL_FORMAT_RGBX32, format, 64,
 	                   64))
 		goto fail;
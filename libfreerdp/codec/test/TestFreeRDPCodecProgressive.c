@@ -1038,6 +1038,30 @@ static BOOL colordiff(UINT32 format, UINT32 a, UINT32 b)
 	return TRUE;
 }
 
+static BOOL compare_image(const wImage* image, const BYTE* resultData, UINT32 ColorFormat)
+{
+	for (size_t y = 0; y < image->height; y++)
+	{
+		const BYTE* orig = &image->data[y * image->scanline];
+		const BYTE* dec = &resultData[y * image->scanline];
+		for (size_t x = 0; x < image->width; x++)
+		{
+			const BYTE* po = &orig[x * 4];
+			const BYTE* pd = &dec[x * 4];
+
+			const DWORD a = FreeRDPReadColor(po, ColorFormat);
+			const DWORD b = FreeRDPReadColor(pd, ColorFormat);
+			if (!colordiff(ColorFormat, a, b))
+			{
+				printf("xxxxxxx [%" PRIuz ":%" PRIuz "] [%s] %08X != %08X\n", x, y,
+				       FreeRDPGetColorFormatName(ColorFormat), a, b);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
 static BOOL test_encode_decode(const char* path)
 {
 	BOOL res = FALSE;
@@ -1089,32 +1113,114 @@ static BOOL test_encode_decode(const char* path)
 		dstImage->data = resultData;
 		winpr_image_write(dstImage, "/tmp/test.bmp");
 	}
-	for (size_t y = 0; y < image->height; y++)
+	if (!compare_image(image, resultData, ColorFormat))
+		goto fail;
+	res = TRUE;
+fail:
+	region16_uninit(&invalidRegion);
+	progressive_context_free(progressiveEnc);
+	progressive_context_free(progressiveDec);
+	winpr_image_free(image, TRUE);
+	winpr_image_free(dstImage, FALSE);
+	free(resultData);
+	free(name);
+	return res;
+}
+
+static BOOL test_encode_decode_multipass(const char* path)
+{
+	BOOL res = FALSE;
+	int rc = 0;
+	BYTE* resultData = NULL;
+	BYTE* dstData = NULL;
+	UINT32 dstSize = 0;
+	UINT32 simpleSize = 0;
+	UINT32 frameId = 0;
+	const UINT32 ColorFormat = PIXEL_FORMAT_BGRX32;
+	const BYTE schedule[] = { 4, 2, 0 };
+	REGION16 invalidRegion = { 0 };
+	REGION16 emptyRegion = { 0 };
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, "progressive.bmp");
+	PROGRESSIVE_CONTEXT* progressiveSimple = progressive_context_new(TRUE);
+	PROGRESSIVE_CONTEXT* progressiveEnc = progressive_context_new(TRUE);
+	PROGRESSIVE_CONTEXT* progressiveDec = progressive_context_new(FALSE);
+
+	region16_init(&invalidRegion);
+	region16_init(&emptyRegion);
+	if (!image || !name || !progressiveSimple || !progressiveEnc || !progressiveDec)
+		goto fail;
+
+	rc = winpr_image_read(image, name);
+	if (rc <= 0)
+		goto fail;
+
+	resultData = calloc(image->scanline, image->height);
+	if (!resultData)
+		goto fail;
+
+	rc = progressive_compress(progressiveSimple, image->data, image->scanline * image->height,
+	                          ColorFormat, image->width, image->height, image->scanline, NULL,
+	                          &dstData, &simpleSize);
+	if (rc <= 0)
+		goto fail;
+
+	if (!progressive_context_set_quant_schedule(progressiveEnc, schedule, ARRAYSIZE(schedule)))
+		goto fail;
+	if (!progressive_context_set_upgrade_budget(progressiveEnc, 16 * 1024))
+		goto fail;
+
+	rc = progressive_create_surface_context(progressiveDec, 0, image->width, image->height);
+	if (rc <= 0)
+		goto fail;
+
+	// The coarse first pass must be cheaper than the full quality message
+	rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+	                          ColorFormat, image->width, image->height, image->scanline, NULL,
+	                          &dstData, &dstSize);
+	if ((rc <= 0) || (dstSize >= simpleSize))
+		goto fail;
+
+	rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+	                            image->scanline, 0, 0, &invalidRegion, 0, frameId++);
+	if (rc < 0)
+		goto fail;
+
+	// Refine the unchanged image until all tiles reached the last pass
+	while (progressive_compress_has_pending_upgrades(progressiveEnc))
 	{
-		const BYTE* orig = &image->data[y * image->scanline];
-		const BYTE* dec = &resultData[y * image->scanline];
-		for (size_t x = 0; x < image->width; x++)
-		{
-			const BYTE* po = &orig[x * 4];
-			const BYTE* pd = &dec[x * 4];
+		if (frameId > 64)
+			goto fail;
 
-			const DWORD a = FreeRDPReadColor(po, ColorFormat);
-			const DWORD b = FreeRDPReadColor(pd, ColorFormat);
-			if (!colordiff(ColorFormat, a, b))
-			{
-				printf("xxxxxxx [%" PRIuz ":%" PRIuz "] [%s] %08X != %08X\n", x, y,
-				       FreeRDPGetColorFormatName(ColorFormat), a, b);
-				goto fail;
-			}
-		}
+		rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+		                          ColorFormat, image->width, image->height, image->scanline,
+		                          &emptyRegion, &dstData, &dstSize);
+		if (rc <= 0)
+			goto fail;
+
+		rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+		                            image->scanline, 0, 0, &invalidRegion, 0, frameId++);
+		if (rc < 0)
+			goto fail;
 	}
+
+	// Nothing left to send
+	rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+	                          ColorFormat, image->width, image->height, image->scanline,
+	                          &emptyRegion, &dstData, &dstSize);
+	if (rc != 0)
+		goto fail;
+
+	if (!compare_image(image, resultData, ColorFormat))
+		goto fail;
 	res = TRUE;
 fail:
 	region16_uninit(&invalidRegion);
+	region16_uninit(&emptyRegion);
+	progressive_context_free(progressiveSimple);
 	progressive_context_free(progressiveEnc);
 	progressive_context_free(progressiveDec);
 	winpr_image_free(image, TRUE);
-	winpr_image_free(dstImage, FALSE);
 	free(resultData);
 	free(name);
 	return res;
@@ -1463,6 +1569,8 @@ int TestFreeRDPCodecProgressive(int argc, char* argv[])
 		    */
 		if (!test_encode_decode(ms_sample_path))
 			goto fail;
+		if (!test_encode_decode_multipass(ms_sample_path))
+			goto fail;
 		rc = 0;
 	}
 
@@ -1,5 +1,6 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/codec/rfx.h>
@@ -842,6 +843,101 @@ static BOOL fuzzyCompareImage(const UINT32* crefImage, const BYTE* img, size_t n
 	return TRUE;
 }
 
+static BOOL test_rfx_decode_sample(RFX_CONTEXT* context, BYTE* dest, REGION16* region)
+{
+	const size_t stride = FORMAT_SIZE * IMG_WIDTH;
+
+	region16_clear(region);
+	return rfx_process_message(context, encodeDataSample, sizeof(encodeDataSample), 0, 0, dest,
+	                           FORMAT, stride, IMG_HEIGHT, region);
+}
+
+/* Encode the reference image with RLGR1 or RLGR3 and decode it again, then time the RLGR bound
+ * parts of the codec on the test vectors. */
+static BOOL test_rfx_round_trip(RLGR_MODE mode, UINT32 iterations)
+{
+	BOOL rc = FALSE;
+	REGION16 region = { 0 };
+	const size_t stride = FORMAT_SIZE * IMG_WIDTH;
+	const RFX_RECT rect = { 0, 0, IMG_WIDTH, IMG_HEIGHT };
+	RFX_CONTEXT* encoder = rfx_context_new(TRUE);
+	RFX_CONTEXT* decoder = rfx_context_new(FALSE);
+	BYTE* dest = calloc(IMG_WIDTH * IMG_HEIGHT, FORMAT_SIZE);
+	wStream* s = Stream_New(NULL, 4096);
+
+	region16_init(&region);
+
+	if (!encoder || !decoder || !dest || !s)
+		goto fail;
+
+	/* srefImage holds 0x00RRGGBB values, in memory that is BGRX */
+	rfx_context_set_pixel_format(encoder, PIXEL_FORMAT_BGRX32);
+
+	if (!rfx_context_reset(encoder, IMG_WIDTH, IMG_HEIGHT) || !rfx_context_set_mode(encoder, mode))
+		goto fail;
+
+	if (!rfx_compose_message(encoder, s, &rect, 1, (const BYTE*)srefImage, IMG_WIDTH, IMG_HEIGHT,
+	                         stride))
+		goto fail;
+
+	Stream_SealLength(s);
+
+	if (!rfx_process_message(decoder, Stream_Buffer(s), Stream_Length(s), 0, 0, dest,
+	                         PIXEL_FORMAT_BGRX32, stride, IMG_HEIGHT, &region))
+		goto fail;
+
+	/* RemoteFX is lossy, with the default quantization values the error is small */
+	for (size_t i = 0; i < IMG_WIDTH * IMG_HEIGHT * FORMAT_SIZE; i++)
+	{
+		const BYTE* ref = (const BYTE*)srefImage;
+
+		if ((i % FORMAT_SIZE) == 3)
+			continue;
+
+		if (fuzzyCompare(dest[i], ref[i]) > 16)
+		{
+			(void)fprintf(stderr, "RLGR%d round trip mismatch at byte %" PRIuz "\n",
+			              (mode == RLGR1) ? 1 : 3, i);
+			goto fail;
+		}
+	}
+
+	const UINT64 start = winpr_GetTickCount64NS();
+
+	for (UINT32 x = 0; x < iterations; x++)
+	{
+		Stream_SetPosition(s, 0);
+
+		if (!rfx_compose_message(encoder, s, &rect, 1, (const BYTE*)srefImage, IMG_WIDTH,
+		                         IMG_HEIGHT, stride))
+			goto fail;
+	}
+
+	const UINT64 mid = winpr_GetTickCount64NS();
+
+	/* the test vector is RLGR1 coded */
+	for (UINT32 x = 0; x < iterations; x++)
+	{
+		if (!test_rfx_decode_sample(decoder, dest, &region))
+			goto fail;
+	}
+
+	const UINT64 end = winpr_GetTickCount64NS();
+
+	(void)printf("RLGR%d: %" PRIuz " bytes, %" PRIu32 " x encode %" PRIu64
+	             " us, %" PRIu32 " x decode sample %" PRIu64 " us\n",
+	             (mode == RLGR1) ? 1 : 3, Stream_Length(s), iterations, (mid - start) / 1000,
+	             iterations, (end - mid) / 1000);
+	rc = TRUE;
+fail:
+	region16_uninit(&region);
+	Stream_Free(s, TRUE);
+	rfx_context_free(encoder);
+	rfx_context_free(decoder);
+	free(dest);
+	return rc;
+}
+
 int TestFreeRDPCodecRemoteFX(int argc, char* argv[])
 {
 	int rc = -1;
@@ -877,6 +973,9 @@ int TestFreeRDPCodecRemoteFX(int argc, char* argv[])
 	if (!fuzzyCompareImage(srefImage, dest, IMG_WIDTH * IMG_HEIGHT))
 		goto fail;
 
+	if (!test_rfx_round_trip(RLGR1, 100) || !test_rfx_round_trip(RLGR3, 100))
+		goto fail;
+
 	rc = 0;
 fail:
 	region16_uninit(&region);
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+
+#include <freerdp/types.h>
+#include <freerdp/codec/color.h>
+
+/* Both passes round to 8 bit */
+#define SCALE_TEST_TOLERANCE 2
+
+static BYTE* test_scale_create_image(UINT32 format, UINT32 width, UINT32 height, UINT32 stride,
+                                     BOOL flat, UINT32* pColor)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	BYTE* image = calloc(height, stride);
+	UINT32 color = 0;
+
+	if (!image)
+		return NULL;
+
+	winpr_RAND(&color, sizeof(color));
+	color = FreeRDPReadColor((const BYTE*)&color, format);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			if (!flat)
+				winpr_RAND(&color, sizeof(color));
+			FreeRDPWriteColor(&image[1ULL * y * stride + x * bpp], format, color);
+		}
+	}
+
+	if (pColor)
+		*pColor = FreeRDPReadColor(image, format);
+	return image;
+}
+
+/* Source coordinate weights of a destination pixel, see freerdp_image_scaler_scale */
+static size_t test_scale_weights(UINT32 src, UINT32 dst, UINT32 x, UINT32* first, double* w)
+{
+	if (src == dst)
+	{
+		*first = x;
+		w[0] = 1.0;
+		return 1;
+	}
+
+	if (dst > src)
+	{
+		double pos = ((x + 0.5) * src) / dst - 0.5;
+		pos = MAX(pos, 0.0);
+		const UINT32 idx = MIN((UINT32)pos, src - 1);
+		const double frac = (idx == src - 1) ? 0.0 : pos - idx;
+
+		*first = idx;
+		w[0] = 1.0 - frac;
+		w[1] = frac;
+		return (idx == src - 1) ? 1 : 2;
+	}
+
+	const double begin = 1.0 * x * src / dst;
+	const double end = 1.0 * (x + 1) * src / dst;
+	size_t count = 0;
+
+	*first = (UINT32)begin;
+	for (UINT32 j = *first; (j < src) && (j < end); j++)
+		w[count++] = (MIN(end, j + 1.0) - MAX(begin, 1.0 * j)) * dst / src;
+	return count;
+}
+
+/* Straightforward floating point implementation of the expected result */
+static BOOL test_scale_compare(const BYTE* src, UINT32 srcFormat, UINT32 srcStride,
+                               UINT32 srcWidth, UINT32 srcHeight, const BYTE* dst,
+                               UINT32 dstFormat, UINT32 dstStride, UINT32 dstWidth,
+                               UINT32 dstHeight)
+{
+	const size_t sbpp = FreeRDPGetBytesPerPixel(srcFormat);
+	const size_t dbpp = FreeRDPGetBytesPerPixel(dstFormat);
+	const BOOL alpha = FreeRDPColorHasAlpha(srcFormat) && FreeRDPColorHasAlpha(dstFormat);
+	double* wx = calloc(srcWidth + 2, sizeof(double));
+	double* wy = calloc(srcHeight + 2, sizeof(double));
+	BOOL rc = FALSE;
+
+	if (!wx || !wy)
+		goto fail;
+
+	for (UINT32 y = 0; y < dstHeight; y++)
+	{
+		UINT32 fy = 0;
+		const size_t ny = test_scale_weights(srcHeight, dstHeight, y, &fy, wy);
+
+		for (UINT32 x = 0; x < dstWidth; x++)
+		{
+			UINT32 fx = 0;
+			const size_t nx = test_scale_weights(srcWidth, dstWidth, x, &fx, wx);
+			double expected[4] = { 0 };
+			BYTE actual[4] = { 0 };
+
+			for (size_t j = 0; j < ny; j++)
+			{
+				for (size_t i = 0; i < nx; i++)
+				{
+					const BYTE* pixel = &src[(fy + j) * srcStride + (fx + i) * sbpp];
+					const UINT32 color = FreeRDPReadColor(pixel, srcFormat);
+					BYTE c[4] = { 0 };
+
+					FreeRDPSplitColor(color, srcFormat, &c[0], &c[1], &c[2], &c[3], NULL);
+					for (size_t k = 0; k < 4; k++)
+						expected[k] += c[k] * wx[i] * wy[j];
+				}
+			}
+
+			const UINT32 color = FreeRDPReadColor(&dst[1ULL * y * dstStride + x * dbpp], dstFormat);
+			FreeRDPSplitColor(color, dstFormat, &actual[0], &actual[1], &actual[2], &actual[3],
+			                  NULL);
+
+			for (size_t k = 0; k < (alpha ? 4 : 3); k++)
+			{
+				if (fabs(expected[k] - actual[k]) > SCALE_TEST_TOLERANCE)
+				{
+					(void)fprintf(stderr,
+					              "[%s] %" PRIu32 "x%" PRIu32 " -> %" PRIu32 "x%" PRIu32
+					              " mismatch at %" PRIu32 "x%" PRIu32 " channel %" PRIuz
+					              ": %f != %" PRIu8 "\n",
+					              __func__, srcWidth, srcHeight, dstWidth, dstHeight, x, y, k,
+					              expected[k], actual[k]);
+					goto fail;
+				}
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(wx);
+	free(wy);
+	return rc;
+}
+
+static BOOL test_scale_flat(const BYTE* dst, UINT32 dstFormat, UINT32 dstStride, UINT32 width,
+                            UINT32 height, UINT32 color, UINT32 srcFormat)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(dstFormat);
+	const BOOL alpha = FreeRDPColorHasAlpha(srcFormat) && FreeRDPColorHasAlpha(dstFormat);
+	BYTE expected[4] = { 0 };
+
+	FreeRDPSplitColor(color, srcFormat, &expected[0], &expected[1], &expected[2], &expected[3],
+	                  NULL);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			BYTE actual[4] = { 0 };
+			const UINT32 val = FreeRDPReadColor(&dst[1ULL * y * dstStride + x * bpp], dstFormat);
+
+			FreeRDPSplitColor(val, dstFormat, &actual[0], &actual[1], &actual[2], &actual[3], NULL);
+
+			if (memcmp(expected, actual, alpha ? 4 : 3) != 0)
+			{
+				(void)fprintf(stderr,
+				              "[%s] %s %" PRIu32 "x%" PRIu32 " mismatch at %" PRIu32 "x%" PRIu32
+				              ": %08" PRIx32 " != %08" PRIx32 "\n",
+				              __func__, FreeRDPGetColorFormatName(dstFormat), width, height, x, y,
+				              color, val);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_scale_run(FREERDP_IMAGE_SCALER* scaler, UINT32 srcFormat, UINT32 dstFormat,
+                           UINT32 srcWidth, UINT32 srcHeight, UINT32 dstWidth, UINT32 dstHeight,
+                           BOOL flat)
+{
+	BOOL rc = FALSE;
+	UINT32 color = 0;
+	/* an offset into a larger image to check the coordinates are honored */
+	const UINT32 off = 3;
+	const UINT32 sbpp = FreeRDPGetBytesPerPixel(srcFormat);
+	const UINT32 dbpp = FreeRDPGetBytesPerPixel(dstFormat);
+	const UINT32 srcStride = (srcWidth + off) * sbpp + 8;
+	const UINT32 dstStride = (dstWidth + off) * dbpp + 4;
+	BYTE* src = test_scale_create_image(srcFormat, srcWidth + off, srcHeight + off, srcStride,
+	                                    flat, &color);
+	BYTE* dst = calloc(dstHeight + off, dstStride);
+	BYTE* ref = calloc(dstHeight + off, dstStride);
+
+	if (!src || !dst || !ref)
+		goto fail;
+
+	if (!freerdp_image_scaler_scale(scaler, dst, dstFormat, dstStride, off, off, dstWidth,
+	                                dstHeight, src, srcFormat, srcStride, off, off, srcWidth,
+	                                srcHeight))
+		goto fail;
+
+	/* the one shot API must produce the same result */
+	if (!freerdp_image_scale(ref, dstFormat, dstStride, off, off, dstWidth, dstHeight, src,
+	                         srcFormat, srcStride, off, off, srcWidth, srcHeight))
+		goto fail;
+
+	if (memcmp(dst, ref, 1ULL * (dstHeight + off) * dstStride) != 0)
+	{
+		(void)fprintf(stderr, "[%s] freerdp_image_scale differs\n", __func__);
+		goto fail;
+	}
+
+	const BYTE* pdst = &dst[1ULL * off * dstStride + off * dbpp];
+	if (flat)
+		rc = test_scale_flat(pdst, dstFormat, dstStride, dstWidth, dstHeight, color, srcFormat);
+	else
+		rc = test_scale_compare(&src[1ULL * off * srcStride + off * sbpp], srcFormat, srcStride,
+		                        srcWidth, srcHeight, pdst, dstFormat, dstStride, dstWidth,
+		                        dstHeight);
+
+fail:
+	if (!rc)
+		(void)fprintf(stderr,
+		              "[%s] %s -> %s %" PRIu32 "x%" PRIu32 " -> %" PRIu32 "x%" PRIu32
+		              " flat=%d failed\n",
+		              __func__, FreeRDPGetColorFormatName(srcFormat),
+		              FreeRDPGetColorFormatName(dstFormat), srcWidth, srcHeight, dstWidth,
+		              dstHeight, flat);
+	free(src);
+	free(dst);
+	free(ref);
+	return rc;
+}
+
+int TestFreeRDPCodecScale(int argc, char* argv[])
+{
+	int rc = -1;
+	const UINT32 formats[][2] = { { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRA32 },
+		                          { PIXEL_FORMAT_RGBX32, PIXEL_FORMAT_RGBX32 },
+		                          { PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGBA32 },
+		                          { PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_RGB24 },
+		                          { PIXEL_FORMAT_RGB24, PIXEL_FORMAT_BGRX32 },
+		                          { PIXEL_FORMAT_RGB16, PIXEL_FORMAT_ARGB32 } };
+	/* enlarge, shrink, mixed, 1 pixel sources and non integer ratios */
+	const UINT32 sizes[][4] = { { 1, 1, 5, 3 },     { 7, 5, 16, 11 },   { 16, 16, 8, 8 },
+		                        { 64, 48, 21, 17 }, { 33, 65, 67, 31 }, { 17, 1, 3, 9 },
+		                        { 100, 7, 100, 3 }, { 5, 100, 9, 100 }, { 301, 259, 640, 480 } };
+	FREERDP_IMAGE_SCALER* scaler = freerdp_image_scaler_new();
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!scaler)
+		goto fail;
+
+	/* the scaler is reused, so the cached tables must follow every size change */
+	for (size_t f = 0; f < ARRAYSIZE(formats); f++)
+	{
+		for (size_t i = 0; i < ARRAYSIZE(sizes); i++)
+		{
+			for (int flat = 0; flat < 2; flat++)
+			{
+				if (!test_scale_run(scaler, formats[f][0], formats[f][1], sizes[i][0], sizes[i][1],
+				                    sizes[i][2], sizes[i][3], flat))
+					goto fail;
+			}
+		}
+	}
+
+	rc = 0;
+fail:
+	freerdp_image_scaler_free(scaler);
+	return rc;
+}
@@ -71,6 +71,7 @@ static BOOL test_compare(const char* fkt, const void* generated, size_t generate
 	return TRUE;
 }
 
+/* The fixtures bound the compressed size, the output itself is checked by decompressing it */
 static BOOL test_run(const char* fkt, const void* src, UINT32 src_size, const void* expected,
                      size_t expected_size)
 {
@@ -80,16 +81,40 @@ static BOOL test_run(const char* fkt, const void* src, UINT32 src_size, const vo
 	const BYTE* pDstData = NULL;
 	BYTE OutputBuffer[65536] = { 0 };
 	UINT32 DstSize = sizeof(OutputBuffer);
+	const BYTE* pOutData = NULL;
+	UINT32 OutSize = 0;
 	XCRUSH_CONTEXT* xcrush = xcrush_context_new(TRUE);
-	if (!xcrush)
-		return -1;
+	XCRUSH_CONTEXT* xcrushRecv = xcrush_context_new(FALSE);
+	if (!xcrush || !xcrushRecv)
+		goto fail;
 	status = xcrush_compress(xcrush, src, src_size, OutputBuffer, &pDstData, &DstSize, &Flags);
 	printf("[%s] status: %d Flags: 0x%08" PRIX32 " DstSize: %" PRIu32 "\n", fkt, status, Flags,
 	       DstSize);
+	if (status < 0)
+		goto fail;
 
-	rc = test_compare(fkt, pDstData, DstSize, expected, expected_size);
+	if (DstSize > expected_size)
+	{
+		test_dump(fkt, pDstData, DstSize, expected, expected_size);
+		goto fail;
+	}
+
+	/* packets that do not shrink are sent as they are */
+	if (!(Flags & PACKET_COMPRESSED))
+	{
+		rc = test_compare(fkt, pDstData, DstSize, src, src_size);
+		goto fail;
+	}
+
+	status = xcrush_decompress(xcrushRecv, pDstData, DstSize, &pOutData, &OutSize, Flags);
+	if (status < 0)
+		goto fail;
+
+	rc = test_compare(fkt, pOutData, OutSize, src, src_size);
 
+fail:
 	xcrush_context_free(xcrush);
+	xcrush_context_free(xcrushRecv);
 	return rc;
 }
 
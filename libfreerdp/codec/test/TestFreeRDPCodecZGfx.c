@@ -4,6 +4,8 @@
 
 #include <freerdp/freerdp.h>
 #include <freerdp/codec/zgfx.h>
+#include <freerdp/channels/drdynvc.h>
+#include <freerdp/utils/drdynvc.h>
 #include <freerdp/log.h>
 
 /* Sample from [MS-RDPEGFX] */
@@ -253,6 +255,191 @@ fail:
 	return rc;
 }
 
+static BYTE* test_ZGfxCreateScreenData(size_t size)
+{
+	BYTE* data = malloc(size);
+
+	if (!data)
+		return NULL;
+
+	/* Mimic RDPGFX payloads: repeated scanlines, some glyph like patterns and noise */
+	for (size_t x = 0; x < size; x++)
+	{
+		const size_t line = x / 256;
+
+		if ((line % 7) == 3)
+			data[x] = (BYTE)(x * 13 + line);
+		else if ((line % 5) == 1)
+			data[x] = TEST_FOX_DATA[x % (sizeof(TEST_FOX_DATA) - 1)];
+		else
+			data[x] = (BYTE)((x % 4) == 3 ? 0xFF : 0x20 + (x / 1024) % 4);
+	}
+
+	winpr_RAND(&data[size / 2], MIN(size / 16, 4096));
+	return data;
+}
+
+static int test_ZGfxCompressRoundTrip(ZGFX_COMPRESSION_LEVEL level, BOOL verbose)
+{
+	int rc = -1;
+	const size_t sizes[] = { 1, 3, 16, 1024, 65535, 65536, 200000, 77, 65535 * 3 + 17 };
+	const size_t maxSize = 65535 * 3 + 17;
+	UINT64 compressed = 0;
+	UINT64 uncompressed = 0;
+	UINT64 duration = 0;
+	ZGFX_CONTEXT* compressor = zgfx_context_new(TRUE);
+	ZGFX_CONTEXT* decompressor = zgfx_context_new(FALSE);
+	BYTE* data = test_ZGfxCreateScreenData(maxSize);
+
+	if (!compressor || !decompressor || !data)
+		goto fail;
+
+	if (!zgfx_context_set_compression_level(compressor, level))
+		goto fail;
+
+	/* The history is shared across PDUs, so every call depends on the previous ones */
+	for (size_t x = 0; x < ARRAYSIZE(sizes); x++)
+	{
+		UINT32 Flags = 0;
+		BYTE* pCompressed = NULL;
+		UINT32 CompressedSize = 0;
+		BYTE* pDecompressed = NULL;
+		UINT32 DecompressedSize = 0;
+		const BYTE* pSrcData = &data[(x * 4099) % (maxSize - sizes[x] + 1)];
+		const UINT64 start = winpr_GetTickCount64NS();
+		const int status = zgfx_compress(compressor, pSrcData, (UINT32)sizes[x], &pCompressed,
+		                                 &CompressedSize, &Flags);
+		duration += winpr_GetTickCount64NS() - start;
+
+		if (status < 0)
+		{
+			free(pCompressed);
+			goto fail;
+		}
+
+		const int dstatus = zgfx_decompress(decompressor, pCompressed, CompressedSize,
+		                                    &pDecompressed, &DecompressedSize, 0);
+		free(pCompressed);
+
+		if ((dstatus < 0) || (DecompressedSize != sizes[x]) ||
+		    (memcmp(pDecompressed, pSrcData, DecompressedSize) != 0))
+		{
+			printf("%s: level %d, round trip of %" PRIuz " bytes failed\n", __func__, level,
+			       sizes[x]);
+			free(pDecompressed);
+			goto fail;
+		}
+
+		free(pDecompressed);
+		compressed += CompressedSize;
+		uncompressed += sizes[x];
+	}
+
+	if ((level != ZGFX_COMPRESSION_LEVEL_NONE) && (compressed >= uncompressed))
+	{
+		printf("%s: level %d did not compress: %" PRIu64 " >= %" PRIu64 "\n", __func__, level,
+		       compressed, uncompressed);
+		goto fail;
+	}
+
+	if (verbose)
+		printf("%s: level %d ratio %.2f%% (%" PRIu64 " -> %" PRIu64 " bytes), %.2f MB/s\n",
+		       __func__, level, 100.0 * (double)compressed / (double)uncompressed, uncompressed,
+		       compressed,
+		       duration > 0 ? (double)uncompressed * 1000.0 / (double)duration : 0.0);
+
+	rc = 0;
+fail:
+	free(data);
+	zgfx_context_free(compressor);
+	zgfx_context_free(decompressor);
+	return rc;
+}
+
+/* Compress as dynamic channel data and return the total compressed size, 0 on failure.
+ * Both sides use a history of historySize bytes, the RDP 8.0 default if 0 */
+static size_t test_ZGfxDynvcTransfer(const BYTE* data, size_t size, UINT32 historySize)
+{
+	size_t total = 0;
+	wStream* s = Stream_New(NULL, 2 * DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE);
+	ZGFX_CONTEXT* compressor =
+	    (historySize > 0) ? zgfx_context_new_ex(TRUE, historySize) : zgfx_context_new(TRUE);
+	ZGFX_CONTEXT* decompressor =
+	    (historySize > 0) ? zgfx_context_new_ex(FALSE, historySize) : zgfx_context_new(FALSE);
+
+	if (!s || !compressor || !decompressor)
+		goto fail;
+
+	for (size_t offset = 0; offset < size; offset += DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE)
+	{
+		BYTE* pDstData = NULL;
+		UINT32 DstSize = 0;
+		const size_t length = MIN(size - offset, DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE);
+
+		Stream_SetPosition(s, 0);
+		if (!drdynvc_compress_data(compressor, s, &data[offset], length))
+			goto fail;
+
+		if (!drdynvc_decompress_data(decompressor, Stream_Buffer(s), Stream_GetPosition(s),
+		                             &pDstData, &DstSize))
+			goto fail;
+
+		const BOOL match = (DstSize == length) && (memcmp(pDstData, &data[offset], length) == 0);
+		free(pDstData);
+		if (!match)
+		{
+			printf("%s: chunk at %" PRIuz " does not match\n", __func__, offset);
+			goto fail;
+		}
+
+		total += Stream_GetPosition(s);
+	}
+
+	Stream_Free(s, TRUE);
+	zgfx_context_free(compressor);
+	zgfx_context_free(decompressor);
+	return total;
+
+fail:
+	Stream_Free(s, TRUE);
+	zgfx_context_free(compressor);
+	zgfx_context_free(decompressor);
+	return 0;
+}
+
+static int test_ZGfxDynvcHistoryLimit(void)
+{
+	int rc = -1;
+	const size_t blockSize = 4096;
+	const size_t size = 4 * blockSize + DRDYNVC_RDP8_LITE_HISTORY_SIZE;
+	BYTE* data = malloc(size);
+
+	if (!data)
+		return -1;
+
+	/* A random block repeated beyond the RDP 8.0 Lite history */
+	winpr_RAND(data, size - blockSize);
+	memcpy(&data[size - blockSize], data, blockSize);
+
+	const size_t limited = test_ZGfxDynvcTransfer(data, size, DRDYNVC_RDP8_LITE_HISTORY_SIZE);
+	const size_t unlimited = test_ZGfxDynvcTransfer(data, size, 0);
+
+	if ((limited == 0) || (unlimited == 0))
+		goto fail;
+
+	if (limited < unlimited + blockSize / 2)
+	{
+		printf("%s: history limit ignored, %" PRIuz " vs %" PRIuz " bytes\n", __func__, limited,
+		       unlimited);
+		goto fail;
+	}
+
+	rc = 0;
+fail:
+	free(data);
+	return rc;
+}
+
 int TestFreeRDPCodecZGfx(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -270,5 +457,14 @@ int TestFreeRDPCodecZGfx(int argc, char* argv[])
 	if (test_ZGfxCompressConsistent() < 0)
 		return -1;
 
+	for (int level = ZGFX_COMPRESSION_LEVEL_NONE; level <= ZGFX_COMPRESSION_LEVEL_MAX; level++)
+	{
+		if (test_ZGfxCompressRoundTrip((ZGFX_COMPRESSION_LEVEL)level, TRUE) < 0)
+			return -1;
+	}
+
+	if (test_ZGfxDynvcHistoryLimit() < 0)
+		return -1;
+
 	return 0;
 }
@@ -30,6 +30,13 @@
 
 #include <freerdp/log.h>
 #include "xcrush.h"
+#include "bulk_match.h"
+
+#define TAG FREERDP_TAG("codec.xcrush")
+
+/* The largest packet is 16384 bytes and a chunk is at least 15 bytes long */
+#define XCRUSH_MAX_PACKET_SIZE 16384
+#define XCRUSH_MAX_SIGNATURES ((XCRUSH_MAX_PACKET_SIZE / 15) + 1)
 
 #pragma pack(push, 1)
 
@@ -78,19 +85,25 @@ struct s_XCRUSH_CONTEXT
 	ALIGN64 UINT32 HistoryOffset;
 	ALIGN64 UINT32 HistoryBufferSize;
 	ALIGN64 BYTE HistoryBuffer[2000000];
-	ALIGN64 BYTE BlockBuffer[16384];
+	ALIGN64 BYTE BlockBuffer[XCRUSH_MAX_PACKET_SIZE];
+	ALIGN64 BYTE UndoBuffer[XCRUSH_MAX_PACKET_SIZE]; /* history replaced by the last packet */
+	ALIGN64 UINT32 UndoHistoryOffset;
 	ALIGN64 UINT32 CompressionFlags;
 	ALIGN64 UINT32 SignatureIndex;
 	ALIGN64 UINT32 SignatureCount;
-	ALIGN64 XCRUSH_SIGNATURE Signatures[1000];
+	ALIGN64 XCRUSH_SIGNATURE Signatures[XCRUSH_MAX_SIGNATURES];
 	ALIGN64 UINT32 ChunkHead;
 	ALIGN64 UINT32 ChunkTail;
 	ALIGN64 XCRUSH_CHUNK Chunks[65534];
 	ALIGN64 UINT16 NextChunks[65536];
 	ALIGN64 UINT32 OriginalMatchCount;
 	ALIGN64 UINT32 OptimizedMatchCount;
-	ALIGN64 XCRUSH_MATCH_INFO OriginalMatches[1000];
-	ALIGN64 XCRUSH_MATCH_INFO OptimizedMatches[1000];
+	ALIGN64 XCRUSH_MATCH_INFO OriginalMatches[XCRUSH_MAX_SIGNATURES];
+	ALIGN64 XCRUSH_MATCH_INFO OptimizedMatches[XCRUSH_MAX_SIGNATURES];
+	ALIGN64 UINT32 ChunkBoundaryMask;
+	ALIGN64 UINT32 MaxChunkCount;
+	ALIGN64 UINT32 NiceMatchLength;
+	bulk_match_length_fn_t MatchLength;
 };
 
 //#define DEBUG_XCRUSH 1
@@ -245,7 +258,7 @@ static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 		rotation = _rotl(accumulator, 1);
 		accumulator = data[i + 32] ^ data[i] ^ rotation;
 
-		if (!(accumulator & 0x7F))
+		if (!(accumulator & xcrush->ChunkBoundaryMask))
 		{
 			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
 				return 0;
@@ -255,7 +268,7 @@ static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 		rotation = _rotl(accumulator, 1);
 		accumulator = data[i + 32] ^ data[i] ^ rotation;
 
-		if (!(accumulator & 0x7F))
+		if (!(accumulator & xcrush->ChunkBoundaryMask))
 		{
 			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
 				return 0;
@@ -265,7 +278,7 @@ static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 		rotation = _rotl(accumulator, 1);
 		accumulator = data[i + 32] ^ data[i] ^ rotation;
 
-		if (!(accumulator & 0x7F))
+		if (!(accumulator & xcrush->ChunkBoundaryMask))
 		{
 			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
 				return 0;
@@ -275,7 +288,7 @@ static int xcrush_compute_chunks(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 		rotation = _rotl(accumulator, 1);
 		accumulator = data[i + 32] ^ data[i] ^ rotation;
 
-		if (!(accumulator & 0x7F))
+		if (!(accumulator & xcrush->ChunkBoundaryMask))
 		{
 			if (!xcrush_append_chunk(xcrush, data, &offset, i + 32))
 				return 0;
@@ -411,14 +424,10 @@ static int xcrush_find_match_length(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT3
                                     UINT32 MaxMatchLength,
                                     XCRUSH_MATCH_INFO* WINPR_RESTRICT MatchInfo)
 {
-	UINT32 MatchSymbol = 0;
-	UINT32 ChunkSymbol = 0;
 	BYTE* ChunkBuffer = NULL;
 	BYTE* MatchBuffer = NULL;
 	BYTE* MatchStartPtr = NULL;
-	BYTE* ForwardChunkPtr = NULL;
 	BYTE* ReverseChunkPtr = NULL;
-	BYTE* ForwardMatchPtr = NULL;
 	BYTE* ReverseMatchPtr = NULL;
 	BYTE* HistoryBufferEnd = NULL;
 	UINT32 ReverseMatchLength = 0;
@@ -453,28 +462,14 @@ static int xcrush_find_match_length(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT3
 	if (ChunkBuffer < HistoryBuffer)
 		return -2005; /* error */
 
-	ForwardMatchPtr = &HistoryBuffer[MatchOffset];
-	ForwardChunkPtr = &HistoryBuffer[ChunkOffset];
-
 	if ((&MatchBuffer[MaxMatchLength + 1] < HistoryBufferEnd) &&
 	    (MatchBuffer[MaxMatchLength + 1] != ChunkBuffer[MaxMatchLength + 1]))
 	{
 		return 0;
 	}
 
-	while (1)
-	{
-		MatchSymbol = *ForwardMatchPtr++;
-		ChunkSymbol = *ForwardChunkPtr++;
-
-		if (MatchSymbol != ChunkSymbol)
-			break;
-
-		if (ForwardMatchPtr > HistoryBufferEnd)
-			break;
-
-		ForwardMatchLength++;
-	}
+	ForwardMatchLength = xcrush->MatchLength(ChunkBuffer, MatchBuffer,
+	                                         (UINT32)(HistoryBufferEnd - MatchBuffer));
 
 	ReverseMatchPtr = MatchBuffer - 1;
 	ReverseChunkPtr = ChunkBuffer - 1;
@@ -511,7 +506,6 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 {
 	UINT32 j = 0;
 	int status = 0;
-	UINT32 ChunkIndex = 0;
 	UINT32 ChunkCount = 0;
 	XCRUSH_CHUNK* chunk = NULL;
 	UINT32 MatchLength = 0;
@@ -562,14 +556,12 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 						MaxMatchInfo.ChunkOffset = MatchInfo.ChunkOffset;
 						MaxMatchInfo.MatchLength = MatchInfo.MatchLength;
 
-						if (MatchLength > 256)
+						if (MatchLength > xcrush->NiceMatchLength)
 							break;
 					}
 				}
 
-				ChunkIndex = ChunkCount++;
-
-				if (ChunkIndex > 4)
+				if (++ChunkCount >= xcrush->MaxChunkCount)
 					break;
 
 				status = xcrush_find_next_matching_chunk(xcrush, chunk, &chunk);
@@ -591,7 +583,7 @@ static int xcrush_find_all_matches(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32
 				    xcrush->OriginalMatches[j].MatchLength + xcrush->OriginalMatches[j].MatchOffset;
 				j++;
 
-				if (j >= 1000)
+				if (j >= ARRAYSIZE(xcrush->OriginalMatches))
 					return -1003; /* error */
 			}
 		}
@@ -994,6 +986,11 @@ static int xcrush_compress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 	WINPR_ASSERT(pDstSize);
 	WINPR_ASSERT(pFlags);
 
+	if (SrcSize > sizeof(xcrush->UndoBuffer))
+		return -1001;
+
+	xcrush->UndoHistoryOffset = xcrush->HistoryOffset;
+
 	if (xcrush->HistoryOffset + SrcSize + 8 > xcrush->HistoryBufferSize)
 	{
 		xcrush->HistoryOffset = 0;
@@ -1003,6 +1000,7 @@ static int xcrush_compress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 	HistoryOffset = xcrush->HistoryOffset;
 	HistoryBuffer = xcrush->HistoryBuffer;
 	HistoryPtr = &HistoryBuffer[HistoryOffset];
+	CopyMemory(xcrush->UndoBuffer, HistoryPtr, SrcSize);
 	MoveMemory(HistoryPtr, pSrcData, SrcSize);
 	xcrush->HistoryOffset += SrcSize;
 
@@ -1050,6 +1048,21 @@ static int xcrush_compress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 	return 1;
 }
 
+/**
+ * Put back the history replaced by the last packet, so it matches the one of the decompressor
+ * again. Chunks inserted for the packet stay, matches are verified against the history bytes.
+ */
+static void xcrush_discard_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32 SrcSize)
+{
+	WINPR_ASSERT(xcrush);
+	WINPR_ASSERT(SrcSize <= sizeof(xcrush->UndoBuffer));
+	WINPR_ASSERT(xcrush->HistoryOffset >= SrcSize);
+
+	CopyMemory(&xcrush->HistoryBuffer[xcrush->HistoryOffset - SrcSize], xcrush->UndoBuffer,
+	           SrcSize);
+	xcrush->HistoryOffset = xcrush->UndoHistoryOffset;
+}
+
 int xcrush_compress(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, const BYTE* WINPR_RESTRICT pSrcData,
                     UINT32 SrcSize, BYTE* WINPR_RESTRICT pDstBuffer,
                     const BYTE** WINPR_RESTRICT ppDstData, UINT32* WINPR_RESTRICT pDstSize,
@@ -1119,11 +1132,12 @@ int xcrush_compress(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, const BYTE* WINPR_RES
 	if (status < 0)
 		return status;
 
-	if (!status || (Level2ComprFlags & PACKET_FLUSHED))
+	if (!status || !(Level2ComprFlags & PACKET_COMPRESSED))
 	{
-		if (CompressedDataSize > DstSize)
+		/* both levels together would not save anything, send the packet uncompressed */
+		if (CompressedDataSize > (OriginalDataSize - 2))
 		{
-			xcrush_context_reset(xcrush, TRUE);
+			xcrush_discard_l1(xcrush, SrcSize);
 			*ppDstData = pSrcData;
 			*pDstSize = SrcSize;
 			*pFlags = 0;
@@ -1161,12 +1175,43 @@ int xcrush_compress(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, const BYTE* WINPR_RES
 	return 1;
 }
 
+BOOL xcrush_set_compression_effort(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
+                                   BULK_COMPRESSION_EFFORT effort)
+{
+	WINPR_ASSERT(xcrush);
+
+	/* smaller chunks give more match candidates at the cost of more signatures to look up */
+	switch (effort)
+	{
+		case BULK_COMPRESSION_EFFORT_FAST:
+			xcrush->ChunkBoundaryMask = 0xFF;
+			xcrush->MaxChunkCount = 2;
+			xcrush->NiceMatchLength = 64;
+			break;
+		case BULK_COMPRESSION_EFFORT_DEFAULT:
+			xcrush->ChunkBoundaryMask = 0x7F;
+			xcrush->MaxChunkCount = 6;
+			xcrush->NiceMatchLength = 256;
+			break;
+		case BULK_COMPRESSION_EFFORT_MAX:
+			xcrush->ChunkBoundaryMask = 0x3F;
+			xcrush->MaxChunkCount = 64;
+			xcrush->NiceMatchLength = XCRUSH_MAX_PACKET_SIZE;
+			break;
+		default:
+			WLog_ERR(TAG, "invalid compression effort %d", effort);
+			return FALSE;
+	}
+
+	return mppc_set_compression_effort(xcrush->mppc, effort);
+}
+
 void xcrush_context_reset(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, BOOL flush)
 {
 	WINPR_ASSERT(xcrush);
 
 	xcrush->SignatureIndex = 0;
-	xcrush->SignatureCount = 1000;
+	xcrush->SignatureCount = ARRAYSIZE(xcrush->Signatures);
 	ZeroMemory(&(xcrush->Signatures), sizeof(XCRUSH_SIGNATURE) * xcrush->SignatureCount);
 	xcrush->CompressionFlags = 0;
 	xcrush->ChunkHead = xcrush->ChunkTail = 1;
@@ -1175,6 +1220,11 @@ void xcrush_context_reset(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, BOOL flush)
 	ZeroMemory(&(xcrush->OriginalMatches), sizeof(xcrush->OriginalMatches));
 	ZeroMemory(&(xcrush->OptimizedMatches), sizeof(xcrush->OptimizedMatches));
 
+	/* A full reset must not leave data of a previous user in the history, a fresh context
+	 * is still all zero and the 2 MB buffer remains untouched */
+	if (!flush && (xcrush->HistoryOffset != 0))
+		ZeroMemory(&(xcrush->HistoryBuffer), sizeof(xcrush->HistoryBuffer));
+
 	if (flush)
 		xcrush->HistoryOffset = xcrush->HistoryBufferSize + 1;
 	else
@@ -1195,6 +1245,8 @@ XCRUSH_CONTEXT* xcrush_context_new(BOOL Compressor)
 	if (!xcrush->mppc)
 		goto fail;
 	xcrush->HistoryBufferSize = 2000000;
+	xcrush->MatchLength = bulk_match_length_get();
+	(void)xcrush_set_compression_effort(xcrush, BULK_COMPRESSION_EFFORT_DEFAULT);
 	xcrush_context_reset(xcrush, FALSE);
 
 	return xcrush;
@@ -1204,6 +1256,11 @@ fail:
 	return NULL;
 }
 
+size_t xcrush_context_memory_size(BOOL Compressor)
+{
+	return sizeof(XCRUSH_CONTEXT) + mppc_context_memory_size(Compressor);
+}
+
 void xcrush_context_free(XCRUSH_CONTEXT* xcrush)
 {
 	if (xcrush)
@@ -43,11 +43,19 @@ extern "C"
 	                                    const BYTE** WINPR_RESTRICT ppDstData,
 	                                    UINT32* WINPR_RESTRICT pDstSize, UINT32 flags);
 
+	/* Only affects the compressor, the output is understood by every decompressor */
+	FREERDP_LOCAL BOOL xcrush_set_compression_effort(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
+	                                                 BULK_COMPRESSION_EFFORT effort);
+
 	FREERDP_LOCAL void xcrush_context_reset(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, BOOL flush);
 
-	FREERDP_LOCAL XCRUSH_CONTEXT* xcrush_context_new(BOOL Compressor);
+	FREERDP_LOCAL size_t xcrush_context_memory_size(BOOL Compressor);
+
 	FREERDP_LOCAL void xcrush_context_free(XCRUSH_CONTEXT* xcrush);
 
+	WINPR_ATTR_MALLOC(xcrush_context_free, 1)
+	FREERDP_LOCAL XCRUSH_CONTEXT* xcrush_context_new(BOOL Compressor);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,8 @@
 #include <freerdp/log.h>
 #include <freerdp/codec/yuv.h>
 
+#include "executor.h"
+
 #define TAG FREERDP_TAG("codec")
 
 #define TILE_SIZE 64
@@ -58,11 +60,9 @@ struct S_YUV_CONTEXT
 	UINT32 nthreads;
 	UINT32 heightStep;
 
-	PTP_POOL threadPool;
-	TP_CALLBACK_ENVIRON ThreadPoolEnv;
+	CODEC_QUEUE* queue;
 
-	UINT32 work_object_count;
-	PTP_WORK* work_objects;
+	UINT32 work_param_count;
 	YUV_ENCODE_WORK_PARAM* work_enc_params;
 	YUV_PROCESS_WORK_PARAM* work_dec_params;
 	YUV_COMBINE_WORK_PARAM* work_combined_params;
@@ -181,7 +181,7 @@ BOOL yuv_context_reset(YUV_CONTEXT* WINPR_RESTRICT context, UINT32 width, UINT32
 
 		const size_t count = pw * ph;
 
-		context->work_object_count = 0;
+		context->work_param_count = 0;
 		if (context->encoder)
 		{
 			void* tmp = winpr_aligned_recalloc(context->work_enc_params, count,
@@ -211,14 +211,7 @@ BOOL yuv_context_reset(YUV_CONTEXT* WINPR_RESTRICT context, UINT32 width, UINT32
 			context->work_combined_params = ctmp;
 		}
 
-		void* wtmp =
-		    winpr_aligned_recalloc((void*)context->work_objects, count, sizeof(PTP_WORK), 32);
-		if (!wtmp)
-			goto fail;
-		memset(wtmp, 0, count * sizeof(PTP_WORK));
-
-		context->work_objects = (PTP_WORK*)wtmp;
-		context->work_object_count = WINPR_ASSERTING_INT_CAST(uint32_t, count);
+		context->work_param_count = WINPR_ASSERTING_INT_CAST(uint32_t, count);
 	}
 	rc = TRUE;
 fail:
@@ -244,14 +237,11 @@ YUV_CONTEXT* yuv_context_new(BOOL encoder, UINT32 ThreadingFlags)
 		if (ret->useThreads)
 		{
 			ret->nthreads = sysInfos.dwNumberOfProcessors;
-			ret->threadPool = CreateThreadpool(NULL);
-			if (!ret->threadPool)
+			ret->queue = codec_queue_new();
+			if (!ret->queue)
 			{
 				goto error_threadpool;
 			}
-
-			InitializeThreadpoolEnvironment(&ret->ThreadPoolEnv);
-			SetThreadpoolCallbackPool(&ret->ThreadPoolEnv, ret->threadPool);
 		}
 	}
 
@@ -271,10 +261,7 @@ void yuv_context_free(YUV_CONTEXT* context)
 		return;
 	if (context->useThreads)
 	{
-		if (context->threadPool)
-			CloseThreadpool(context->threadPool);
-		DestroyThreadpoolEnvironment(&context->ThreadPoolEnv);
-		winpr_aligned_free((void*)context->work_objects);
+		codec_queue_free(context->queue);
 		winpr_aligned_free(context->work_combined_params);
 		winpr_aligned_free(context->work_enc_params);
 		winpr_aligned_free(context->work_dec_params);
@@ -310,8 +297,8 @@ static INLINE YUV_PROCESS_WORK_PARAM pool_decode_param(const RECTANGLE_16* WINPR
 	return current;
 }
 
-static BOOL submit_object(PTP_WORK* WINPR_RESTRICT work_object, PTP_WORK_CALLBACK cb,
-                          const void* WINPR_RESTRICT param, YUV_CONTEXT* WINPR_RESTRICT context)
+static BOOL submit_object(PTP_WORK_CALLBACK cb, const void* WINPR_RESTRICT param,
+                          YUV_CONTEXT* WINPR_RESTRICT context)
 {
 	union
 	{
@@ -321,37 +308,10 @@ static BOOL submit_object(PTP_WORK* WINPR_RESTRICT work_object, PTP_WORK_CALLBAC
 
 	cnv.cpv = param;
 
-	if (!work_object)
-		return FALSE;
-
-	*work_object = NULL;
-
 	if (!param || !context)
 		return FALSE;
 
-	*work_object = CreateThreadpoolWork(cb, cnv.pv, &context->ThreadPoolEnv);
-	if (!*work_object)
-		return FALSE;
-
-	SubmitThreadpoolWork(*work_object);
-	return TRUE;
-}
-
-static void free_objects(PTP_WORK* work_objects, UINT32 waitCount)
-{
-	WINPR_ASSERT(work_objects || (waitCount == 0));
-
-	for (UINT32 i = 0; i < waitCount; i++)
-	{
-		PTP_WORK cur = work_objects[i];
-		work_objects[i] = NULL;
-
-		if (!cur)
-			continue;
-
-		WaitForThreadpoolWorkCallbacks(cur, FALSE);
-		CloseThreadpoolWork(cur);
-	}
+	return codec_queue_submit(context->queue, cb, cnv.pv);
 }
 
 static BOOL intersects(UINT32 pos, const RECTANGLE_16* WINPR_RESTRICT regionRects,
@@ -441,9 +401,9 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 			{
 				RECTANGLE_16 z = y;
 
-				if (context->work_object_count <= waitCount)
+				if (context->work_param_count <= waitCount)
 				{
-					free_objects(context->work_objects, context->work_object_count);
+					codec_queue_wait(context->queue);
 					waitCount = 0;
 				}
 
@@ -452,7 +412,7 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 				if (rectangle_is_empty(&z))
 					continue;
 				*cur = pool_decode_param(&z, context, pYUVData, iStride, DstFormat, dest, nDstStep);
-				if (!submit_object(&context->work_objects[waitCount], cb, cur, context))
+				if (!submit_object(cb, cur, context))
 					goto fail;
 				waitCount++;
 				y.top += TILE_SIZE;
@@ -463,7 +423,7 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 	}
 	rc = TRUE;
 fail:
-	free_objects(context->work_objects, context->work_object_count);
+	codec_queue_wait(context->queue);
 	return rc;
 }
 
@@ -585,22 +545,22 @@ static BOOL pool_decode_rect(YUV_CONTEXT* WINPR_RESTRICT context, BYTE type,
 	{
 		YUV_COMBINE_WORK_PARAM* current = NULL;
 
-		if (context->work_object_count <= waitCount)
+		if (context->work_param_count <= waitCount)
 		{
-			free_objects(context->work_objects, context->work_object_count);
+			codec_queue_wait(context->queue);
 			waitCount = 0;
 		}
 		current = &context->work_combined_params[waitCount];
 		*current = pool_decode_rect_param(&regionRects[waitCount], context, type, pYUVData, iStride,
 		                                  pYUVDstData, iDstStride);
 
-		if (!submit_object(&context->work_objects[waitCount], cb, current, context))
+		if (!submit_object(cb, current, context))
 			goto fail;
 	}
 
 	rc = TRUE;
 fail:
-	free_objects(context->work_objects, context->work_object_count);
+	codec_queue_wait(context->queue);
 	return rc;
 }
 
@@ -844,9 +804,9 @@ static BOOL pool_encode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 			RECTANGLE_16 r = *rect;
 			YUV_ENCODE_WORK_PARAM* current = NULL;
 
-			if (context->work_object_count <= waitCount)
+			if (context->work_param_count <= waitCount)
 			{
-				free_objects(context->work_objects, context->work_object_count);
+				codec_queue_wait(context->queue);
 				waitCount = 0;
 			}
 
@@ -854,7 +814,7 @@ static BOOL pool_encode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 			r.top += y * context->heightStep;
 			*current = pool_encode_fill(&r, context, pSrcData, nSrcStep, SrcFormat, iStride,
 			                            pYUVLumaData, pYUVChromaData);
-			if (!submit_object(&context->work_objects[waitCount], cb, current, context))
+			if (!submit_object(cb, current, context))
 				goto fail;
 			waitCount++;
 		}
@@ -862,7 +822,7 @@ static BOOL pool_encode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 
 	rc = TRUE;
 fail:
-	free_objects(context->work_objects, context->work_object_count);
+	codec_queue_wait(context->queue);
 	return rc;
 }
 
@@ -30,8 +30,18 @@
 #include <freerdp/log.h>
 #include <freerdp/codec/zgfx.h>
 
+#include "zgfx.h"
+
 #define TAG FREERDP_TAG("codec")
 
+/* Largest hash and chain tables, used with the full RDP 8.0 history. Smaller histories get
+ * tables just large enough to reach back over the whole history. */
+#define ZGFX_HASH_BITS 16
+#define ZGFX_CHAIN_BITS 18
+#define ZGFX_MIN_MATCH 3
+#define ZGFX_HISTORY_SIZE 2500000
+#define ZGFX_OUTPUT_SIZE 65536
+
 /**
  * RDP8 Compressor Limits:
  *
@@ -63,14 +73,36 @@ struct S_ZGFX_CONTEXT
 	UINT32 BitsCurrent;
 	UINT32 cBitsCurrent;
 
-	BYTE OutputBuffer[65536];
+	BYTE* OutputBuffer; /* one decompressed segment, allocated on first use */
 	UINT32 OutputCount;
 
-	BYTE HistoryBuffer[2500000];
+	BYTE* HistoryBuffer;
 	UINT32 HistoryIndex;
 	UINT32 HistoryBufferSize;
+
+	/* Compressor state, only allocated if Compressor is TRUE */
+	ZGFX_COMPRESSION_LEVEL CompressionLevel;
+	UINT32 MaxChainLength;
+	BOOL LazyMatching;
+	UINT32 HistoryLimit; /* largest match distance the peer can resolve */
+	UINT32 Position; /* absolute stream position of HistoryIndex, 0 is reserved */
+	UINT32 HashBits;
+	UINT32 ChainMask;
+	UINT32* HashTable;
+	UINT32* ChainTable;
+	UINT32 LiteralCodes[256];
+	BYTE LiteralBits[256];
 };
 
+typedef struct
+{
+	BYTE* pbOutputCurrent;
+	BYTE* pbOutputEnd;
+	UINT64 BitsCurrent;
+	UINT32 cBitsCurrent;
+	BOOL overflow;
+} ZGFX_BIT_WRITER;
+
 static const ZGFX_TOKEN ZGFX_TOKEN_TABLE[] = {
 	// len code vbits type  vbase
 	{ 1, 0, 8, 0, 0 },           // 0
@@ -254,7 +286,7 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 	{
 		zgfx_history_buffer_ring_write(zgfx, pbSegment, cbSegment);
 
-		if (cbSegment > sizeof(zgfx->OutputBuffer))
+		if (cbSegment > ZGFX_OUTPUT_SIZE)
 			return FALSE;
 
 		CopyMemory(zgfx->OutputBuffer, pbSegment, cbSegment);
@@ -301,7 +333,7 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 					if (++zgfx->HistoryIndex == zgfx->HistoryBufferSize)
 						zgfx->HistoryIndex = 0;
 
-					if (zgfx->OutputCount >= sizeof(zgfx->OutputBuffer))
+					if (zgfx->OutputCount >= ZGFX_OUTPUT_SIZE)
 						return FALSE;
 
 					zgfx->OutputBuffer[zgfx->OutputCount++] = c;
@@ -311,6 +343,9 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 					zgfx_GetBits(zgfx, ZGFX_TOKEN_TABLE[opIndex].valueBits);
 					distance = ZGFX_TOKEN_TABLE[opIndex].valueBase + zgfx->bits;
 
+					if (distance > zgfx->HistoryBufferSize)
+						return FALSE;
+
 					if (distance != 0)
 					{
 						/* Match */
@@ -337,7 +372,7 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 							count += zgfx->bits;
 						}
 
-						if (count > sizeof(zgfx->OutputBuffer) - zgfx->OutputCount)
+						if (count > ZGFX_OUTPUT_SIZE - zgfx->OutputCount)
 							return FALSE;
 
 						zgfx_history_buffer_ring_read(zgfx, WINPR_ASSERTING_INT_CAST(int, distance),
@@ -356,7 +391,7 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 						zgfx->cBitsCurrent = 0;
 						zgfx->BitsCurrent = 0;
 
-						if (count > sizeof(zgfx->OutputBuffer) - zgfx->OutputCount)
+						if (count > ZGFX_OUTPUT_SIZE - zgfx->OutputCount)
 							return FALSE;
 						else if (count > zgfx->cBitsRemaining / 8)
 							return FALSE;
@@ -423,6 +458,13 @@ int zgfx_decompress(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, const BYTE* WINPR_RESTRIC
 	*ppDstData = NULL;
 	*pDstSize = 0;
 
+	if (!zgfx->OutputBuffer)
+	{
+		zgfx->OutputBuffer = (BYTE*)calloc(ZGFX_OUTPUT_SIZE, sizeof(BYTE));
+		if (!zgfx->OutputBuffer)
+			goto fail;
+	}
+
 	if (!Stream_CheckAndLogRequiredLength(TAG, stream, 1))
 		goto fail;
 
@@ -488,11 +530,322 @@ fail:
 	return status;
 }
 
-static BOOL zgfx_compress_segment(WINPR_ATTR_UNUSED ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
-                                  wStream* WINPR_RESTRICT s, const BYTE* WINPR_RESTRICT pSrcData,
-                                  UINT32 SrcSize, UINT32* WINPR_RESTRICT pFlags)
+static void zgfx_compressor_reset(ZGFX_CONTEXT* WINPR_RESTRICT zgfx)
+{
+	/* Forget all match candidates, the history ring itself stays in sync with the peer */
+	zgfx->Position = 1;
+
+	if (zgfx->HashTable)
+		ZeroMemory(zgfx->HashTable, (1ull << zgfx->HashBits) * sizeof(UINT32));
+
+	if (zgfx->ChainTable)
+		ZeroMemory(zgfx->ChainTable, (zgfx->ChainMask + 1ull) * sizeof(UINT32));
+}
+
+static INLINE void zgfx_PutBits(ZGFX_BIT_WRITER* WINPR_RESTRICT writer, UINT32 value,
+                                UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= 32);
+
+	writer->BitsCurrent = (writer->BitsCurrent << nbits) | value;
+	writer->cBitsCurrent += nbits;
+
+	while (writer->cBitsCurrent >= 8)
+	{
+		writer->cBitsCurrent -= 8;
+
+		if (writer->pbOutputCurrent >= writer->pbOutputEnd)
+		{
+			writer->overflow = TRUE;
+			return;
+		}
+
+		*writer->pbOutputCurrent++ = (BYTE)(writer->BitsCurrent >> writer->cBitsCurrent);
+	}
+}
+
+static INLINE BOOL zgfx_FlushBits(ZGFX_BIT_WRITER* WINPR_RESTRICT writer)
 {
-	/* FIXME: Currently compression not implemented. Just copy the raw source */
+	BYTE unused = 0;
+
+	if (writer->cBitsCurrent > 0)
+	{
+		unused = (BYTE)(8 - writer->cBitsCurrent);
+		zgfx_PutBits(writer, 0, unused);
+	}
+
+	/* The last byte of a compressed segment holds the number of unused bits */
+	if (writer->overflow || (writer->pbOutputCurrent >= writer->pbOutputEnd))
+		return FALSE;
+
+	*writer->pbOutputCurrent++ = unused;
+	return TRUE;
+}
+
+static INLINE UINT32 zgfx_hash(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                               const BYTE* WINPR_RESTRICT data)
+{
+	const UINT32 value = ((UINT32)data[0] << 16) | ((UINT32)data[1] << 8) | data[2];
+	return (value * 2654435761u) >> (32 - zgfx->HashBits);
+}
+
+static INLINE void zgfx_hash_insert(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, UINT32 position,
+                                    const BYTE* WINPR_RESTRICT data)
+{
+	const UINT32 hash = zgfx_hash(zgfx, data);
+	zgfx->ChainTable[position & zgfx->ChainMask] = zgfx->HashTable[hash];
+	zgfx->HashTable[hash] = position;
+}
+
+static INLINE UINT32 zgfx_match_length(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx, UINT32 candidate,
+                                       UINT32 segmentStart, const BYTE* WINPR_RESTRICT pSrcData,
+                                       UINT32 offset, UINT32 maxLength)
+{
+	UINT32 length = 0;
+	const BYTE* cur = &pSrcData[offset];
+
+	if (candidate >= segmentStart)
+	{
+		const BYTE* ref = &pSrcData[candidate - segmentStart];
+
+		while (length + 8 <= maxLength)
+		{
+			UINT64 a = 0;
+			UINT64 b = 0;
+			memcpy(&a, &ref[length], sizeof(a));
+			memcpy(&b, &cur[length], sizeof(b));
+
+			if (a != b)
+				break;
+
+			length += 8;
+		}
+
+		while ((length < maxLength) && (ref[length] == cur[length]))
+			length++;
+
+		return length;
+	}
+
+	/* The segment has already been appended to the history, walk the ring */
+	const UINT32 distance = zgfx->Position - candidate;
+	UINT32 index = (zgfx->HistoryIndex + zgfx->HistoryBufferSize -
+	                distance % zgfx->HistoryBufferSize) %
+	               zgfx->HistoryBufferSize;
+
+	while ((length < maxLength) && (zgfx->HistoryBuffer[index] == cur[length]))
+	{
+		length++;
+
+		if (++index == zgfx->HistoryBufferSize)
+			index = 0;
+	}
+
+	return length;
+}
+
+static INLINE const ZGFX_TOKEN* zgfx_match_token(UINT32 distance)
+{
+	const ZGFX_TOKEN* match = NULL;
+
+	for (size_t x = 0; ZGFX_TOKEN_TABLE[x].prefixLength != 0; x++)
+	{
+		const ZGFX_TOKEN* token = &ZGFX_TOKEN_TABLE[x];
+
+		if ((token->tokenType == 1) && (token->valueBase <= distance))
+		{
+			if (!match || (token->valueBase > match->valueBase))
+				match = token;
+		}
+	}
+
+	return match;
+}
+
+static INLINE UINT32 zgfx_length_bits(UINT32 count)
+{
+	UINT32 k = 2;
+
+	if (count == 3)
+		return 1;
+
+	while ((count >> (k + 1)) != 0)
+		k++;
+
+	return 2 * k;
+}
+
+static INLINE UINT32 zgfx_match_cost(UINT32 distance, UINT32 count)
+{
+	const ZGFX_TOKEN* token = zgfx_match_token(distance);
+	WINPR_ASSERT(token);
+	return token->prefixLength + token->valueBits + zgfx_length_bits(count);
+}
+
+static INLINE UINT32 zgfx_literal_cost(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                       const BYTE* WINPR_RESTRICT data, UINT32 count)
+{
+	UINT32 cost = 0;
+
+	for (UINT32 x = 0; x < count; x++)
+		cost += zgfx->LiteralBits[data[x]];
+
+	return cost;
+}
+
+static INLINE void zgfx_write_literal(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                      ZGFX_BIT_WRITER* WINPR_RESTRICT writer, BYTE c)
+{
+	zgfx_PutBits(writer, zgfx->LiteralCodes[c], zgfx->LiteralBits[c]);
+}
+
+static INLINE void zgfx_write_match(ZGFX_BIT_WRITER* WINPR_RESTRICT writer, UINT32 distance,
+                                    UINT32 count)
+{
+	const ZGFX_TOKEN* token = zgfx_match_token(distance);
+	WINPR_ASSERT(token);
+	WINPR_ASSERT(count >= ZGFX_MIN_MATCH);
+
+	zgfx_PutBits(writer, token->prefixCode, token->prefixLength);
+	zgfx_PutBits(writer, distance - token->valueBase, token->valueBits);
+
+	if (count == 3)
+	{
+		zgfx_PutBits(writer, 0, 1);
+		return;
+	}
+
+	/* count in [2^k, 2^(k+1)) is encoded as k-1 one bits, a zero bit and k value bits */
+	UINT32 k = 2;
+	while ((count >> (k + 1)) != 0)
+		k++;
+
+	zgfx_PutBits(writer, ((1u << (k - 1)) - 1u) << 1, k);
+	zgfx_PutBits(writer, count - (1u << k), k);
+}
+
+static UINT32 zgfx_find_match(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx, UINT32 segmentStart,
+                              const BYTE* WINPR_RESTRICT pSrcData, UINT32 offset, UINT32 SrcSize,
+                              UINT32* WINPR_RESTRICT pDistance)
+{
+	UINT32 bestLength = 0;
+	const UINT32 position = segmentStart + offset;
+	const UINT32 maxLength = SrcSize - offset;
+	const UINT32 maxDistance = MIN(zgfx->ChainMask, zgfx->HistoryLimit);
+	/* The ring already holds the whole segment, older data is only there as far back as the
+	 * rest of the segment left room for */
+	const UINT32 maxRingDistance =
+	    (zgfx->HistoryBufferSize > maxLength) ? zgfx->HistoryBufferSize - maxLength : 0;
+	UINT32 candidate = zgfx->HashTable[zgfx_hash(zgfx, &pSrcData[offset])];
+
+	for (UINT32 chain = 0; (chain < zgfx->MaxChainLength) && (candidate != 0); chain++)
+	{
+		if (candidate >= position)
+			break;
+
+		const UINT32 distance = position - candidate;
+
+		if (distance > maxDistance)
+			break;
+
+		if ((candidate < segmentStart) && (distance > maxRingDistance))
+			break;
+
+		const UINT32 length =
+		    zgfx_match_length(zgfx, candidate, segmentStart, pSrcData, offset, maxLength);
+
+		if (length > bestLength)
+		{
+			bestLength = length;
+			*pDistance = distance;
+
+			if (length == maxLength)
+				break;
+		}
+
+		candidate = zgfx->ChainTable[candidate & zgfx->ChainMask];
+	}
+
+	if (bestLength < ZGFX_MIN_MATCH)
+		return 0;
+
+	return bestLength;
+}
+
+static BOOL zgfx_compress_lz77(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                               const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                               BYTE* WINPR_RESTRICT pDstData, size_t DstSize,
+                               size_t* WINPR_RESTRICT pUsed)
+{
+	UINT32 offset = 0;
+	ZGFX_BIT_WRITER writer = { 0 };
+	const UINT32 segmentStart = zgfx->Position - SrcSize;
+
+	writer.pbOutputCurrent = pDstData;
+	writer.pbOutputEnd = &pDstData[DstSize];
+
+	while (offset < SrcSize)
+	{
+		UINT32 distance = 0;
+		UINT32 length = 0;
+
+		if (offset + ZGFX_MIN_MATCH <= SrcSize)
+		{
+			length = zgfx_find_match(zgfx, segmentStart, pSrcData, offset, SrcSize, &distance);
+			zgfx_hash_insert(zgfx, segmentStart + offset, &pSrcData[offset]);
+
+			if ((length > 0) && (zgfx_match_cost(distance, length) >=
+			                     zgfx_literal_cost(zgfx, &pSrcData[offset], length)))
+				length = 0;
+
+			if ((length > 0) && zgfx->LazyMatching && (offset + 1 + ZGFX_MIN_MATCH <= SrcSize))
+			{
+				UINT32 nextDistance = 0;
+				const UINT32 nextLength = zgfx_find_match(zgfx, segmentStart, pSrcData, offset + 1,
+				                                          SrcSize, &nextDistance);
+
+				if (nextLength > length + 1)
+					length = 0;
+			}
+		}
+
+		if (length == 0)
+		{
+			zgfx_write_literal(zgfx, &writer, pSrcData[offset++]);
+		}
+		else
+		{
+			zgfx_write_match(&writer, distance, length);
+
+			for (UINT32 x = 1; x < length; x++)
+			{
+				if (offset + x + ZGFX_MIN_MATCH > SrcSize)
+					break;
+
+				zgfx_hash_insert(zgfx, segmentStart + offset + x, &pSrcData[offset + x]);
+			}
+
+			offset += length;
+		}
+
+		if (writer.overflow)
+			return FALSE;
+	}
+
+	if (!zgfx_FlushBits(&writer))
+		return FALSE;
+
+	*pUsed = WINPR_ASSERTING_INT_CAST(size_t, writer.pbOutputCurrent - pDstData);
+	return TRUE;
+}
+
+static BOOL zgfx_compress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, wStream* WINPR_RESTRICT s,
+                                  const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                                  UINT32* WINPR_RESTRICT pFlags)
+{
+	size_t used = 0;
+	BOOL compressed = FALSE;
+
 	if (!Stream_EnsureRemainingCapacity(s, SrcSize + 1))
 	{
 		WLog_ERR(TAG, "Stream_EnsureRemainingCapacity failed!");
@@ -500,8 +853,32 @@ static BOOL zgfx_compress_segment(WINPR_ATTR_UNUSED ZGFX_CONTEXT* WINPR_RESTRICT
 	}
 
 	(*pFlags) |= ZGFX_PACKET_COMPR_TYPE_RDP8; /* RDP 8.0 compression format */
-	Stream_Write_UINT8(s, WINPR_ASSERTING_INT_CAST(uint8_t, *pFlags)); /* header (1 byte) */
-	Stream_Write(s, pSrcData, SrcSize);
+
+	/* The decompressor appends every segment to its history, compressed or not */
+	if (zgfx->Position > UINT32_MAX - 2 * ZGFX_SEGMENTED_MAXSIZE)
+		zgfx_compressor_reset(zgfx);
+
+	zgfx_history_buffer_ring_write(zgfx, pSrcData, SrcSize);
+	zgfx->Position += SrcSize;
+
+	if (zgfx->HashTable && (zgfx->CompressionLevel != ZGFX_COMPRESSION_LEVEL_NONE))
+	{
+		/* Only keep the compressed data if it is smaller than the raw segment */
+		BYTE* pDstData = Stream_Pointer(s) + 1;
+		compressed = zgfx_compress_lz77(zgfx, pSrcData, SrcSize, pDstData, SrcSize, &used);
+	}
+
+	if (compressed)
+	{
+		Stream_Write_UINT8(s, WINPR_ASSERTING_INT_CAST(uint8_t, *pFlags | PACKET_COMPRESSED));
+		Stream_Seek(s, used);
+	}
+	else
+	{
+		Stream_Write_UINT8(s, WINPR_ASSERTING_INT_CAST(uint8_t, *pFlags)); /* header (1 byte) */
+		Stream_Write(s, pSrcData, SrcSize);
+	}
+
 	return TRUE;
 }
 
@@ -611,24 +988,159 @@ int zgfx_compress(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, const BYTE* WINPR_RESTRICT
 void zgfx_context_reset(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, WINPR_ATTR_UNUSED BOOL flush)
 {
 	zgfx->HistoryIndex = 0;
+	zgfx_compressor_reset(zgfx);
 }
 
-ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
+BOOL zgfx_context_set_compression_level(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                        ZGFX_COMPRESSION_LEVEL level)
+{
+	WINPR_ASSERT(zgfx);
+
+	switch (level)
+	{
+		case ZGFX_COMPRESSION_LEVEL_NONE:
+			zgfx->MaxChainLength = 0;
+			zgfx->LazyMatching = FALSE;
+			break;
+		case ZGFX_COMPRESSION_LEVEL_FAST:
+			zgfx->MaxChainLength = 4;
+			zgfx->LazyMatching = FALSE;
+			break;
+		case ZGFX_COMPRESSION_LEVEL_DEFAULT:
+			zgfx->MaxChainLength = 16;
+			zgfx->LazyMatching = TRUE;
+			break;
+		case ZGFX_COMPRESSION_LEVEL_MAX:
+			zgfx->MaxChainLength = 256;
+			zgfx->LazyMatching = TRUE;
+			break;
+		default:
+			WLog_ERR(TAG, "invalid compression level %d", level);
+			return FALSE;
+	}
+
+	zgfx->CompressionLevel = level;
+	return TRUE;
+}
+
+BOOL zgfx_context_set_history_limit(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, UINT32 limit)
+{
+	WINPR_ASSERT(zgfx);
+
+	if ((limit == 0) || (limit > zgfx->HistoryBufferSize))
+	{
+		WLog_ERR(TAG, "invalid history limit %" PRIu32, limit);
+		return FALSE;
+	}
+
+	zgfx->HistoryLimit = limit;
+	return TRUE;
+}
+
+static void zgfx_init_literal_codes(ZGFX_CONTEXT* WINPR_RESTRICT zgfx)
+{
+	const ZGFX_TOKEN* def = &ZGFX_TOKEN_TABLE[0];
+
+	for (size_t c = 0; c < ARRAYSIZE(zgfx->LiteralCodes); c++)
+	{
+		zgfx->LiteralCodes[c] = (def->prefixCode << def->valueBits) | (UINT32)c;
+		zgfx->LiteralBits[c] = (BYTE)(def->prefixLength + def->valueBits);
+	}
+
+	/* Frequent literals have dedicated shorter prefix codes */
+	for (size_t x = 1; ZGFX_TOKEN_TABLE[x].prefixLength != 0; x++)
+	{
+		const ZGFX_TOKEN* token = &ZGFX_TOKEN_TABLE[x];
+
+		if ((token->tokenType != 0) || (token->valueBits != 0))
+			continue;
+
+		zgfx->LiteralCodes[token->valueBase] = token->prefixCode;
+		zgfx->LiteralBits[token->valueBase] = (BYTE)token->prefixLength;
+	}
+}
+
+static UINT32 zgfx_chain_bits(UINT32 HistorySize)
+{
+	UINT32 bits = ZGFX_MIN_MATCH;
+
+	while ((bits < ZGFX_CHAIN_BITS) && ((1u << bits) <= HistorySize))
+		bits++;
+	return bits;
+}
+
+ZGFX_CONTEXT* zgfx_context_new_ex(BOOL Compressor, UINT32 HistorySize)
 {
 	ZGFX_CONTEXT* zgfx = NULL;
+
+	if ((HistorySize < ZGFX_MIN_MATCH) || (HistorySize > ZGFX_HISTORY_SIZE))
+	{
+		WLog_ERR(TAG, "invalid history size %" PRIu32, HistorySize);
+		return NULL;
+	}
+
 	zgfx = (ZGFX_CONTEXT*)calloc(1, sizeof(ZGFX_CONTEXT));
 
 	if (zgfx)
 	{
 		zgfx->Compressor = Compressor;
-		zgfx->HistoryBufferSize = sizeof(zgfx->HistoryBuffer);
+		zgfx->HistoryBufferSize = HistorySize;
+		zgfx->HistoryLimit = zgfx->HistoryBufferSize;
+		zgfx->HistoryBuffer = (BYTE*)calloc(HistorySize, sizeof(BYTE));
+
+		if (!zgfx->HistoryBuffer)
+			goto fail;
+
+		if (Compressor)
+		{
+			const UINT32 chainBits = zgfx_chain_bits(HistorySize);
+
+			zgfx->HashBits = MIN(ZGFX_HASH_BITS, chainBits - 1);
+			zgfx->ChainMask = (1u << chainBits) - 1u;
+			zgfx->HashTable = (UINT32*)calloc(1ull << zgfx->HashBits, sizeof(UINT32));
+			zgfx->ChainTable = (UINT32*)calloc(zgfx->ChainMask + 1ull, sizeof(UINT32));
+
+			if (!zgfx->HashTable || !zgfx->ChainTable)
+				goto fail;
+
+			zgfx_init_literal_codes(zgfx);
+			zgfx_context_set_compression_level(zgfx, ZGFX_COMPRESSION_LEVEL_DEFAULT);
+		}
+
 		zgfx_context_reset(zgfx, FALSE);
 	}
 
 	return zgfx;
+
+fail:
+	zgfx_context_free(zgfx);
+	return NULL;
+}
+
+ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
+{
+	return zgfx_context_new_ex(Compressor, ZGFX_HISTORY_SIZE);
+}
+
+size_t zgfx_context_memory_size(BOOL Compressor)
+{
+	size_t size = sizeof(ZGFX_CONTEXT) + ZGFX_HISTORY_SIZE;
+
+	if (Compressor)
+		size += ((1ull << ZGFX_HASH_BITS) + (1ull << ZGFX_CHAIN_BITS)) * sizeof(UINT32);
+	else
+		size += ZGFX_OUTPUT_SIZE;
+	return size;
 }
 
 void zgfx_context_free(ZGFX_CONTEXT* zgfx)
 {
+	if (!zgfx)
+		return;
+
+	free(zgfx->HashTable);
+	free(zgfx->ChainTable);
+	free(zgfx->OutputBuffer);
+	free(zgfx->HistoryBuffer);
 	free(zgfx);
 }
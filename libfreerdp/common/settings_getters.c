@@ -196,6 +196,9 @@ BOOL freerdp_settings_get_bool(WINPR_ATTR_UNUSED const rdpSettings* settings,
 		case FreeRDP_DumpRemoteFx:
 			return settings->DumpRemoteFx;
 
+		case FreeRDP_DynamicChannelCompression:
+			return settings->DynamicChannelCompression;
+
 		case FreeRDP_DynamicDaylightTimeDisabled:
 			return settings->DynamicDaylightTimeDisabled;
 
@@ -852,6 +855,10 @@ BOOL freerdp_settings_set_bool(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->DumpRemoteFx = cnv.c;
 			break;
 
+		case FreeRDP_DynamicChannelCompression:
+			settings->DynamicChannelCompression = cnv.c;
+			break;
+
 		case FreeRDP_DynamicDaylightTimeDisabled:
 			settings->DynamicDaylightTimeDisabled = cnv.c;
 			break;
@@ -1688,6 +1695,9 @@ UINT32 freerdp_settings_get_uint32(WINPR_ATTR_UNUSED const rdpSettings* settings
 		case FreeRDP_CompDeskSupportLevel:
 			return settings->CompDeskSupportLevel;
 
+		case FreeRDP_CompressionEffort:
+			return settings->CompressionEffort;
+
 		case FreeRDP_CompressionLevel:
 			return settings->CompressionLevel;
 
@@ -2112,6 +2122,10 @@ BOOL freerdp_settings_set_uint32(WINPR_ATTR_UNUSED rdpSettings* settings,
 			settings->CompDeskSupportLevel = cnv.c;
 			break;
 
+		case FreeRDP_CompressionEffort:
+			settings->CompressionEffort = cnv.c;
+			break;
+
 		case FreeRDP_CompressionLevel:
 			settings->CompressionLevel = cnv.c;
 			break;
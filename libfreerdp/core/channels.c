@@ -50,7 +50,43 @@
 
 #define TAG FREERDP_TAG("core.channels")
 
+static BOOL freerdp_channel_send_segments(rdpRdp* rdp, UINT16 channelId, size_t totalSize,
+                                          UINT32 flags, const BYTE* header, size_t headerLength,
+                                          const BYTE* data, size_t chunkSize)
+{
+	if (totalSize > UINT32_MAX)
+		return FALSE;
+
+	UINT16 sec_flags = 0;
+	wStream* s = rdp_send_stream_init(rdp, &sec_flags);
+
+	if (!s)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, headerLength + chunkSize + 8))
+	{
+		Stream_Release(s);
+		return FALSE;
+	}
+
+	Stream_Write_UINT32(s, (UINT32)totalSize);
+	Stream_Write_UINT32(s, flags);
+
+	if (headerLength > 0)
+		Stream_Write(s, header, headerLength);
+	Stream_Write(s, data, chunkSize);
+
+	/* WLog_DBG(TAG, "sending data (flags=0x%x size=%d)",  flags, size); */
+	return rdp_send(rdp, s, channelId, sec_flags);
+}
+
 BOOL freerdp_channel_send(rdpRdp* rdp, UINT16 channelId, const BYTE* data, size_t size)
+{
+	return freerdp_channel_send_with_header(rdp, channelId, NULL, 0, data, size);
+}
+
+BOOL freerdp_channel_send_with_header(rdpRdp* rdp, UINT16 channelId, const BYTE* header,
+                                      size_t headerLength, const BYTE* data, size_t size)
 {
 	size_t left = 0;
 	UINT32 flags = 0;
@@ -59,8 +95,12 @@ BOOL freerdp_channel_send(rdpRdp* rdp, UINT16 channelId, const BYTE* data, size_
 	const rdpMcsChannel* channel = NULL;
 
 	WINPR_ASSERT(rdp);
+	WINPR_ASSERT(header || (headerLength == 0));
 	WINPR_ASSERT(data || (size == 0));
 
+	if (headerLength > SIZE_MAX - size)
+		return FALSE;
+
 	mcs = rdp->mcs;
 	WINPR_ASSERT(mcs);
 	for (UINT32 i = 0; i < mcs->channelCount; i++)
@@ -80,8 +120,9 @@ BOOL freerdp_channel_send(rdpRdp* rdp, UINT16 channelId, const BYTE* data, size_
 	}
 
 	flags = CHANNEL_FLAG_FIRST;
-	left = size;
+	left = headerLength + size;
 
+	const size_t totalSize = left;
 	while (left > 0)
 	{
 		if (left > rdp->settings->VCChunkSize)
@@ -99,10 +140,15 @@ BOOL freerdp_channel_send(rdpRdp* rdp, UINT16 channelId, const BYTE* data, size_
 			flags |= CHANNEL_FLAG_SHOW_PROTOCOL;
 		}
 
-		if (!freerdp_channel_send_packet(rdp, channelId, size, flags, data, chunkSize))
+		/* the header goes into the first chunk(s), the data follows without an extra copy */
+		const size_t hchunk = MIN(headerLength, chunkSize);
+		if (!freerdp_channel_send_segments(rdp, channelId, totalSize, flags, header, hchunk, data,
+		                                   chunkSize - hchunk))
 			return FALSE;
 
-		data += chunkSize;
+		header += hchunk;
+		headerLength -= hchunk;
+		data += chunkSize - hchunk;
 		left -= chunkSize;
 		flags = 0;
 	}
@@ -296,26 +342,6 @@ const WtsApiFunctionTable* FreeRDP_InitWtsApi(void)
 BOOL freerdp_channel_send_packet(rdpRdp* rdp, UINT16 channelId, size_t totalSize, UINT32 flags,
                                  const BYTE* data, size_t chunkSize)
 {
-	if (totalSize > UINT32_MAX)
-		return FALSE;
-
-	UINT16 sec_flags = 0;
-	wStream* s = rdp_send_stream_init(rdp, &sec_flags);
-
-	if (!s)
-		return FALSE;
-
-	if (!Stream_EnsureRemainingCapacity(s, chunkSize + 8))
-	{
-		Stream_Release(s);
-		return FALSE;
-	}
-
-	Stream_Write_UINT32(s, (UINT32)totalSize);
-	Stream_Write_UINT32(s, flags);
-
-	Stream_Write(s, data, chunkSize);
-
-	/* WLog_DBG(TAG, "sending data (flags=0x%x size=%d)",  flags, size); */
-	return rdp_send(rdp, s, channelId, sec_flags);
+	return freerdp_channel_send_segments(rdp, channelId, totalSize, flags, NULL, 0, data,
+	                                     chunkSize);
 }
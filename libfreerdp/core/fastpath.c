@@ -372,6 +372,13 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 	          fastpath_update_to_string(updateCode), updateCode, Stream_GetRemainingLength(s));
 #endif
 
+	/* relayed as is, nothing to decode */
+	if (update->RawUpdate)
+	{
+		rc = update->RawUpdate(context, updateCode, s);
+		goto out;
+	}
+
 	const BOOL defaultReturn =
 	    freerdp_settings_get_bool(context->settings, FreeRDP_DeactivateClientDecoding);
 	switch (updateCode)
@@ -478,6 +485,7 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 			break;
 	}
 
+out:
 	Stream_SetPosition(s, 0);
 	if (!rc)
 	{
@@ -688,8 +688,10 @@ static BOOL rdp_read_info_packet(rdpRdp* rdp, wStream* s, UINT16 tpktlength)
 
 	if (flags & INFO_COMPRESSION)
 	{
+		/* The client supports every type up to the one it announces, the server settings
+		 * hold the highest type the server is willing to use */
 		CompressionLevel = ((flags & 0x00001E00) >> 9);
-		settings->CompressionLevel = CompressionLevel;
+		settings->CompressionLevel = MIN(CompressionLevel, settings->CompressionLevel);
 	}
 	else
 	{
@@ -187,6 +187,7 @@ state_run_t multitransport_recv_response(rdpMultitransport* multi, wStream* s)
 	return IFCALLRESULT(STATE_RUN_SUCCESS, multi->MtResponse, multi, requestId, hr);
 }
 
+/* The RDP-UDP engine (rdpudp.c) is not wired up yet, see rdpudp.h for what is missing */
 static state_run_t multitransport_no_udp(rdpMultitransport* multi, UINT32 reqId,
                                          WINPR_ATTR_UNUSED UINT16 reqProto,
                                          WINPR_ATTR_UNUSED const BYTE* cookie)
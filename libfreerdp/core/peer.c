@@ -1441,6 +1441,26 @@ const char* freerdp_peer_os_minor_type_string(freerdp_peer* client)
 	return os_minor_type_to_string((UINT16)osMinorType);
 }
 
+size_t freerdp_peer_get_output_queue_depth(freerdp_peer* client)
+{
+	WINPR_ASSERT(client);
+
+	rdpContext* context = client->context;
+	if (!context || !context->rdp || !context->rdp->transport)
+		return 0;
+	return transport_get_output_queue_depth(context->rdp->transport);
+}
+
+BOOL freerdp_peer_is_output_congested(freerdp_peer* client)
+{
+	WINPR_ASSERT(client);
+
+	rdpContext* context = client->context;
+	if (!context || !context->rdp || !context->rdp->transport)
+		return FALSE;
+	return transport_is_output_congested(context->rdp->transport);
+}
+
 freerdp_peer* freerdp_peer_new(int sockfd)
 {
 	UINT32 option_value = 0;
@@ -1181,7 +1181,7 @@ state_run_t rdp_recv_data_pdu(rdpRdp* rdp, wStream* s)
 		}
 
 		if (bulk_decompress(rdp->bulk, Stream_ConstPointer(s), SrcSize, &pDstData, &DstSize,
-		                    compressedType))
+		                    compressedType) >= 0)
 		{
 			cs = transport_take_from_pool(rdp->transport, DstSize);
 			if (!cs)
@@ -0,0 +1,1404 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * UDP Transport Extension [MS-RDPEUDP]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crypto.h>
+#include <winpr/stream.h>
+#include <winpr/synch.h>
+#include <winpr/collections.h>
+
+#include <freerdp/log.h>
+#include <freerdp/types.h>
+
+#include "rdpudp.h"
+
+#define TAG FREERDP_TAG("core.rdpudp")
+
+/* [MS-RDPEUDP] 2.2.2.1 RDPUDP_FEC_HEADER uFlags */
+#define RDPUDP_FLAG_SYN 0x0001
+#define RDPUDP_FLAG_FIN 0x0002
+#define RDPUDP_FLAG_ACK 0x0004
+#define RDPUDP_FLAG_DATA 0x0008
+#define RDPUDP_FLAG_FEC 0x0010
+#define RDPUDP_FLAG_CN 0x0020
+#define RDPUDP_FLAG_CWR 0x0040
+#define RDPUDP_FLAG_AOA 0x0100
+#define RDPUDP_FLAG_SYNLOSSY 0x0200
+#define RDPUDP_FLAG_ACKDELAYED 0x0400
+#define RDPUDP_FLAG_CORRELATION_ID 0x0800
+#define RDPUDP_FLAG_SYNEX 0x1000
+
+/* [MS-RDPEUDP] 2.2.2.9 RDPUDP_SYNDATAEX_PAYLOAD */
+#define RDPUDP_VERSION_INFO_VALID 0x0001
+#define RDPUDP_PROTOCOL_VERSION_1 0x0001
+#define RDPUDP_PROTOCOL_VERSION_2 0x0002
+
+/* [MS-RDPEUDP] 2.2.1.1 ACK vector element states */
+#define DATAGRAM_RECEIVED 0
+#define DATAGRAM_PENDING 3
+
+#define RDPUDP_FEC_HEADER_LENGTH 8
+#define RDPUDP_SYNDATA_LENGTH 8
+#define RDPUDP_CORRELATION_ID_LENGTH 32
+#define RDPUDP_ACK_OF_ACKS_LENGTH 4
+#define RDPUDP_SOURCE_HEADER_LENGTH 8
+#define RDPUDP_FEC_PAYLOAD_HEADER_LENGTH 12
+
+/* Maximum number of ACK vector elements sent, older runs are left out */
+#define RDPUDP_ACK_VECTOR_MAX 64
+#define RDPUDP_ACK_VECTOR_HEADER_MAX (2 + RDPUDP_ACK_VECTOR_MAX + 2)
+
+/* Headers of the largest datagram, a FEC datagram also carries the xor of the lengths */
+#define RDPUDP_DATAGRAM_OVERHEAD                                                           \
+	(RDPUDP_FEC_HEADER_LENGTH + RDPUDP_ACK_VECTOR_HEADER_MAX + RDPUDP_ACK_OF_ACKS_LENGTH + \
+	 RDPUDP_FEC_PAYLOAD_HEADER_LENGTH + 2)
+
+/* Receive window advertised to the peer, in datagrams */
+#define RDPUDP_RECEIVE_WINDOW 64
+/* Sequence number range tracked in both directions, must be a power of 2 */
+#define RDPUDP_RING_SIZE 256
+#define RDPUDP_RING_MASK (RDPUDP_RING_SIZE - 1)
+#define RDPUDP_MAX_CWND (RDPUDP_RING_SIZE / 2)
+#define RDPUDP_INITIAL_CWND 4
+
+/* Source datagrams covered by one FEC datagram in lossy mode */
+#define RDPUDP_FEC_GROUP 4
+#define RDPUDP_FEC_PENDING 16
+
+/* A datagram is lost when this many later datagrams were received */
+#define RDPUDP_DUP_THRESHOLD 3
+
+/* Timers in milliseconds */
+#define RDPUDP_INITIAL_RTO 500
+#define RDPUDP_MIN_RTO 100
+#define RDPUDP_MAX_RTO 8000
+#define RDPUDP_ACK_DELAY 50
+#define RDPUDP_SYN_RETRIES 5
+#define RDPUDP_MAX_RETRANSMITS 8
+
+typedef struct
+{
+	BOOL inUse;
+	BOOL fec;
+	UINT32 snSource;
+	UINT64 sentAt;
+} RDPUDP_CHANNEL_ENTRY;
+
+typedef struct
+{
+	BOOL inUse;
+	BOOL done; /* acknowledged (reliable) or resolved (lossy) */
+	UINT32 snCoded;
+	UINT32 retransmits;
+	size_t length;
+	BYTE* data;
+} RDPUDP_SOURCE_ENTRY;
+
+typedef struct
+{
+	BOOL present;
+	UINT32 snSource;
+	size_t length;
+	BYTE* data;
+} RDPUDP_RECEIVE_ENTRY;
+
+typedef struct
+{
+	BOOL inUse;
+	UINT32 snSourceStart;
+	BYTE range;
+	size_t length;
+	BYTE* data;
+} RDPUDP_FEC_ENTRY;
+
+struct rdp_udp
+{
+	BOOL server;
+	BOOL lossy;
+	RDPUDP_STATE state;
+
+	RdpUdpSendCb Send;
+	RdpUdpReceiveCb Receive;
+	void* context;
+
+	UINT16 mtu;
+	UINT16 version;
+	BOOL synEx;
+
+	/* handshake */
+	UINT32 snLocalInitial;
+	UINT32 snPeerInitial;
+	UINT64 synSentAt;
+	UINT32 synRetries;
+
+	/* sender, snCoded numbers every DATA and FEC datagram, snSource every payload */
+	UINT32 snCodedNext;
+	UINT32 snCodedUna;
+	UINT32 snSourceNext;
+	UINT32 snSourceUna;
+	UINT32 snFecNext;
+	UINT32 peerWindow;
+	RDPUDP_CHANNEL_ENTRY channel[RDPUDP_RING_SIZE];
+	RDPUDP_SOURCE_ENTRY source[RDPUDP_RING_SIZE];
+	wQueue* pending;
+
+	/* congestion control */
+	UINT32 cwnd;
+	UINT32 cwndCount;
+	UINT32 ssthresh;
+	UINT32 snRecover;
+	BOOL sendCwr;
+	UINT64 srtt;
+	UINT64 rttvar;
+	UINT64 rto;
+	BOOL hasRtt;
+
+	/* receiver */
+	UINT32 snAckBase;
+	UINT32 snHighest;
+	BYTE received[RDPUDP_RING_SIZE];
+	BOOL ackPending;
+	BOOL ackDelayed;
+	UINT32 unacked;
+	UINT64 ackDeadline;
+	BOOL sendCn;
+	UINT32 snDeliverNext;
+	UINT32 snSourceHighest;
+	RDPUDP_RECEIVE_ENTRY receive[RDPUDP_RING_SIZE];
+	RDPUDP_FEC_ENTRY fec[RDPUDP_FEC_PENDING];
+	size_t fecIndex;
+
+	wStream* buffer;
+};
+
+static INT32 rdpudp_seq_diff(UINT32 a, UINT32 b)
+{
+	return (INT32)(a - b);
+}
+
+static size_t rdpudp_max_payload(UINT16 mtu)
+{
+	return mtu - RDPUDP_DATAGRAM_OVERHEAD;
+}
+
+static void rdpudp_fail(rdpUdp* udp, const char* reason)
+{
+	WINPR_ASSERT(udp);
+
+	WLog_ERR(TAG, "connection failed: %s", reason);
+	udp->state = RDPUDP_STATE_FAILED;
+}
+
+static BOOL rdpudp_copy_payload(BYTE** pdata, size_t* plength, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(pdata);
+	WINPR_ASSERT(plength);
+
+	if (!*pdata)
+	{
+		*pdata = malloc(RDPUDP_MTU_SIZE);
+		if (!*pdata)
+			return FALSE;
+	}
+
+	if (length > RDPUDP_MTU_SIZE)
+		return FALSE;
+
+	memcpy(*pdata, data, length);
+	*plength = length;
+	return TRUE;
+}
+
+static BOOL rdpudp_send_datagram(rdpUdp* udp, wStream* s)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(udp->Send);
+
+	Stream_SealLength(s);
+	if (!udp->Send(udp->context, Stream_Buffer(s), Stream_Length(s)))
+	{
+		rdpudp_fail(udp, "failed to send datagram");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static wStream* rdpudp_write_header(rdpUdp* udp, UINT32 snSourceAck, UINT16 flags)
+{
+	WINPR_ASSERT(udp);
+
+	wStream* s = udp->buffer;
+	Stream_SetPosition(s, 0);
+
+	if (udp->sendCn && (flags & RDPUDP_FLAG_ACK))
+		flags |= RDPUDP_FLAG_CN;
+
+	/* RDPUDP_FEC_HEADER */
+	Stream_Write_UINT32_BE(s, snSourceAck);
+	Stream_Write_UINT16_BE(s, RDPUDP_RECEIVE_WINDOW);
+	Stream_Write_UINT16_BE(s, flags);
+	return s;
+}
+
+/* The ACK vector runs from the oldest tracked datagram to snSourceAck so the peer derives the
+ * start from the total run length. Run lengths are encoded minus one. */
+static void rdpudp_write_ack_vector(rdpUdp* udp, wStream* s)
+{
+	BYTE elements[RDPUDP_ACK_VECTOR_MAX] = { 0 };
+	size_t count = 0;
+
+	WINPR_ASSERT(udp);
+
+	UINT32 seq = udp->snHighest;
+	INT32 remaining = rdpudp_seq_diff(udp->snHighest, udp->snAckBase) + 1;
+
+	while ((remaining > 0) && (count < ARRAYSIZE(elements)))
+	{
+		const BYTE state =
+		    udp->received[seq & RDPUDP_RING_MASK] ? DATAGRAM_RECEIVED : DATAGRAM_PENDING;
+		BYTE run = 0;
+
+		while ((remaining > 0) && (run < 64))
+		{
+			const BYTE cur =
+			    udp->received[seq & RDPUDP_RING_MASK] ? DATAGRAM_RECEIVED : DATAGRAM_PENDING;
+			if (cur != state)
+				break;
+			run++;
+			remaining--;
+			seq--;
+		}
+
+		elements[count++] = (BYTE)((state << 6) | (run - 1));
+	}
+
+	/* RDPUDP_ACK_VECTOR_HEADER */
+	Stream_Write_UINT16_BE(s, (UINT16)count);
+	for (size_t x = 0; x < count; x++)
+		Stream_Write_UINT8(s, elements[count - x - 1]);
+	Stream_Zero(s, (4 - ((2 + count) % 4)) % 4);
+}
+
+static wStream* rdpudp_write_ack_header(rdpUdp* udp, UINT16 flags)
+{
+	WINPR_ASSERT(udp);
+
+	wStream* s =
+	    rdpudp_write_header(udp, udp->snHighest, flags | RDPUDP_FLAG_ACK | RDPUDP_FLAG_AOA);
+	rdpudp_write_ack_vector(udp, s);
+
+	/* RDPUDP_ACK_OF_ACKVECTOR_HEADER */
+	Stream_Write_UINT32_BE(s, udp->snCodedUna);
+
+	udp->ackPending = FALSE;
+	udp->ackDelayed = FALSE;
+	udp->unacked = 0;
+	return s;
+}
+
+static BOOL rdpudp_send_ack(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	const UINT16 flags = udp->ackDelayed ? RDPUDP_FLAG_ACKDELAYED : 0;
+	wStream* s = rdpudp_write_ack_header(udp, flags);
+	return rdpudp_send_datagram(udp, s);
+}
+
+static BOOL rdpudp_send_syn(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	UINT16 flags = RDPUDP_FLAG_SYN | RDPUDP_FLAG_SYNEX;
+	if (udp->lossy)
+		flags |= RDPUDP_FLAG_SYNLOSSY;
+
+	wStream* s = rdpudp_write_header(udp, UINT32_MAX, flags);
+
+	/* RDPUDP_SYNDATA_PAYLOAD */
+	Stream_Write_UINT32_BE(s, udp->snLocalInitial);
+	Stream_Write_UINT16_BE(s, RDPUDP_MTU_SIZE); /* uUpStreamMtu */
+	Stream_Write_UINT16_BE(s, RDPUDP_MTU_SIZE); /* uDownStreamMtu */
+
+	/* RDPUDP_SYNDATAEX_PAYLOAD */
+	Stream_Write_UINT16_BE(s, RDPUDP_VERSION_INFO_VALID);
+	Stream_Write_UINT16_BE(s, RDPUDP_PROTOCOL_VERSION_2);
+
+	/* SYN datagrams are padded to the MTU to probe the path */
+	Stream_Zero(s, RDPUDP_MTU_SIZE - Stream_GetPosition(s));
+	return rdpudp_send_datagram(udp, s);
+}
+
+static BOOL rdpudp_send_synack(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	UINT16 flags = RDPUDP_FLAG_SYN | RDPUDP_FLAG_ACK;
+	if (udp->synEx)
+		flags |= RDPUDP_FLAG_SYNEX;
+
+	wStream* s = rdpudp_write_header(udp, udp->snPeerInitial, flags);
+
+	/* RDPUDP_SYNDATA_PAYLOAD */
+	Stream_Write_UINT32_BE(s, udp->snLocalInitial);
+	Stream_Write_UINT16_BE(s, udp->mtu);
+	Stream_Write_UINT16_BE(s, udp->mtu);
+
+	if (udp->synEx)
+	{
+		/* RDPUDP_SYNDATAEX_PAYLOAD */
+		Stream_Write_UINT16_BE(s, RDPUDP_VERSION_INFO_VALID);
+		Stream_Write_UINT16_BE(s, udp->version);
+	}
+
+	Stream_Zero(s, RDPUDP_MTU_SIZE - Stream_GetPosition(s));
+	return rdpudp_send_datagram(udp, s);
+}
+
+static void rdpudp_init_sequences(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	/* The first datagram after the handshake uses the initial sequence number + 1 */
+	udp->snCodedNext = udp->snLocalInitial + 1;
+	udp->snCodedUna = udp->snCodedNext;
+	udp->snSourceNext = udp->snCodedNext;
+	udp->snSourceUna = udp->snCodedNext;
+	udp->snFecNext = udp->snCodedNext;
+	udp->snRecover = udp->snCodedNext;
+
+	udp->snHighest = udp->snPeerInitial;
+	udp->snAckBase = udp->snPeerInitial + 1;
+	udp->snDeliverNext = udp->snPeerInitial + 1;
+	udp->snSourceHighest = udp->snPeerInitial;
+}
+
+static void rdpudp_congestion_event(rdpUdp* udp, UINT32 snCoded, BOOL timeout)
+{
+	WINPR_ASSERT(udp);
+
+	/* Reduce once per window of datagrams sent before the previous reduction */
+	if (rdpudp_seq_diff(snCoded, udp->snRecover) < 0)
+		return;
+
+	udp->ssthresh = MAX(udp->cwnd / 2, 2);
+	udp->cwnd = timeout ? 1 : udp->ssthresh;
+	udp->cwndCount = 0;
+	udp->snRecover = udp->snCodedNext;
+	udp->sendCwr = TRUE;
+}
+
+static void rdpudp_update_rtt(rdpUdp* udp, UINT64 sample)
+{
+	WINPR_ASSERT(udp);
+
+	/* RFC 6298 */
+	if (!udp->hasRtt)
+	{
+		udp->srtt = sample;
+		udp->rttvar = sample / 2;
+		udp->hasRtt = TRUE;
+	}
+	else
+	{
+		const UINT64 delta = (udp->srtt > sample) ? udp->srtt - sample : sample - udp->srtt;
+		udp->rttvar = (3 * udp->rttvar + delta) / 4;
+		udp->srtt = (7 * udp->srtt + sample) / 8;
+	}
+
+	udp->rto = MIN(MAX(udp->srtt + 4 * udp->rttvar, RDPUDP_MIN_RTO), RDPUDP_MAX_RTO);
+}
+
+static BOOL rdpudp_send_source(rdpUdp* udp, UINT32 snSource, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	/* Retransmissions while the oldest datagram is still unresolved */
+	if (udp->snCodedNext - udp->snCodedUna >= RDPUDP_RING_SIZE)
+	{
+		rdpudp_fail(udp, "send window overflow");
+		return FALSE;
+	}
+
+	RDPUDP_SOURCE_ENTRY* src = &udp->source[snSource & RDPUDP_RING_MASK];
+	const UINT32 snCoded = udp->snCodedNext++;
+	RDPUDP_CHANNEL_ENTRY* entry = &udp->channel[snCoded & RDPUDP_RING_MASK];
+
+	WINPR_ASSERT(src->inUse);
+	WINPR_ASSERT(!entry->inUse);
+
+	entry->inUse = TRUE;
+	entry->fec = FALSE;
+	entry->snSource = snSource;
+	entry->sentAt = now;
+	src->snCoded = snCoded;
+
+	UINT16 flags = RDPUDP_FLAG_DATA;
+	if (udp->sendCwr)
+		flags |= RDPUDP_FLAG_CWR;
+	udp->sendCwr = FALSE;
+
+	wStream* s = rdpudp_write_ack_header(udp, flags);
+
+	/* RDPUDP_SOURCE_PAYLOAD_HEADER */
+	Stream_Write_UINT32_BE(s, snCoded);
+	Stream_Write_UINT32_BE(s, snSource);
+	Stream_Write(s, src->data, src->length);
+	return rdpudp_send_datagram(udp, s);
+}
+
+/* The FEC payload is the xor of the lengths followed by the xor of the zero padded payloads */
+static BOOL rdpudp_send_fec(rdpUdp* udp, UINT32 snSourceStart, BYTE range, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(range > 0);
+
+	const UINT32 snCoded = udp->snCodedNext++;
+	RDPUDP_CHANNEL_ENTRY* entry = &udp->channel[snCoded & RDPUDP_RING_MASK];
+
+	WINPR_ASSERT(!entry->inUse);
+	entry->inUse = TRUE;
+	entry->fec = TRUE;
+	entry->sentAt = now;
+
+	wStream* s = rdpudp_write_ack_header(udp, RDPUDP_FLAG_FEC);
+
+	/* RDPUDP_FEC_PAYLOAD_HEADER */
+	Stream_Write_UINT32_BE(s, snCoded);
+	Stream_Write_UINT32_BE(s, snSourceStart);
+	Stream_Write_UINT8(s, range);
+	Stream_Write_UINT8(s, 0); /* uFecIndex */
+	Stream_Zero(s, 2);        /* padding */
+
+	UINT16 lengthXor = 0;
+	size_t length = 0;
+	for (BYTE x = 0; x < range; x++)
+	{
+		const RDPUDP_SOURCE_ENTRY* src = &udp->source[(snSourceStart + x) & RDPUDP_RING_MASK];
+		lengthXor ^= (UINT16)src->length;
+		length = MAX(length, src->length);
+	}
+
+	Stream_Write_UINT16_BE(s, lengthXor);
+	BYTE* data = Stream_Pointer(s);
+	memset(data, 0, length);
+	for (BYTE x = 0; x < range; x++)
+	{
+		const RDPUDP_SOURCE_ENTRY* src = &udp->source[(snSourceStart + x) & RDPUDP_RING_MASK];
+		for (size_t y = 0; y < src->length; y++)
+			data[y] ^= src->data[y];
+	}
+	Stream_Seek(s, length);
+
+	return rdpudp_send_datagram(udp, s);
+}
+
+static void rdpudp_retire_sources(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	while (udp->snSourceUna != udp->snSourceNext)
+	{
+		RDPUDP_SOURCE_ENTRY* src = &udp->source[udp->snSourceUna & RDPUDP_RING_MASK];
+		if (!src->done)
+			break;
+
+		/* Payloads are needed for FEC datagrams not yet sent */
+		if (udp->lossy && (rdpudp_seq_diff(udp->snSourceUna, udp->snFecNext) >= 0))
+			break;
+
+		src->inUse = FALSE;
+		udp->snSourceUna++;
+	}
+
+	while (udp->snCodedUna != udp->snCodedNext)
+	{
+		if (udp->channel[udp->snCodedUna & RDPUDP_RING_MASK].inUse)
+			break;
+		udp->snCodedUna++;
+	}
+}
+
+static BOOL rdpudp_flush(rdpUdp* udp, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->state != RDPUDP_STATE_ESTABLISHED)
+		return TRUE;
+
+	while (Queue_Count(udp->pending) > 0)
+	{
+		const UINT32 inflight = udp->snCodedNext - udp->snCodedUna;
+		const UINT32 window = MIN(udp->cwnd, udp->peerWindow);
+
+		if ((inflight >= window) || (inflight >= RDPUDP_RING_SIZE - 2) ||
+		    (udp->snSourceNext - udp->snSourceUna >= RDPUDP_RING_SIZE - 1))
+			break;
+
+		wStream* s = Queue_Dequeue(udp->pending);
+		const UINT32 snSource = udp->snSourceNext;
+		RDPUDP_SOURCE_ENTRY* src = &udp->source[snSource & RDPUDP_RING_MASK];
+
+		WINPR_ASSERT(!src->inUse);
+		const BOOL rc =
+		    rdpudp_copy_payload(&src->data, &src->length, Stream_Buffer(s), Stream_Length(s));
+		Stream_Free(s, TRUE);
+		if (!rc)
+			return FALSE;
+
+		src->inUse = TRUE;
+		src->done = FALSE;
+		src->retransmits = 0;
+		udp->snSourceNext++;
+
+		if (!rdpudp_send_source(udp, snSource, now))
+			return FALSE;
+
+		if (udp->lossy && (udp->snSourceNext - udp->snFecNext >= RDPUDP_FEC_GROUP))
+		{
+			if (!rdpudp_send_fec(udp, udp->snFecNext, RDPUDP_FEC_GROUP, now))
+				return FALSE;
+			udp->snFecNext = udp->snSourceNext;
+		}
+	}
+
+	/* Do not hold back protection of a partial group when there is nothing more to send */
+	if (udp->lossy && (Queue_Count(udp->pending) == 0) && (udp->snFecNext != udp->snSourceNext))
+	{
+		const BYTE range = (BYTE)(udp->snSourceNext - udp->snFecNext);
+		if (!rdpudp_send_fec(udp, udp->snFecNext, range, now))
+			return FALSE;
+		udp->snFecNext = udp->snSourceNext;
+	}
+
+	rdpudp_retire_sources(udp);
+
+	if (udp->ackPending && (udp->unacked >= 2))
+		return rdpudp_send_ack(udp);
+	return TRUE;
+}
+
+static BOOL rdpudp_channel_outstanding(const rdpUdp* udp, UINT32 snCoded)
+{
+	WINPR_ASSERT(udp);
+
+	return (rdpudp_seq_diff(snCoded, udp->snCodedUna) >= 0) &&
+	       (rdpudp_seq_diff(snCoded, udp->snCodedNext) < 0);
+}
+
+static void rdpudp_channel_acked(rdpUdp* udp, UINT32 snCoded)
+{
+	WINPR_ASSERT(udp);
+
+	if (!rdpudp_channel_outstanding(udp, snCoded))
+		return;
+
+	RDPUDP_CHANNEL_ENTRY* entry = &udp->channel[snCoded & RDPUDP_RING_MASK];
+	if (!entry->inUse)
+		return;
+
+	entry->inUse = FALSE;
+	if (!entry->fec)
+	{
+		/* Any copy of a retransmitted payload acknowledges it */
+		RDPUDP_SOURCE_ENTRY* src = &udp->source[entry->snSource & RDPUDP_RING_MASK];
+		if (src->inUse)
+			src->done = TRUE;
+	}
+
+	if (udp->cwnd < udp->ssthresh)
+		udp->cwnd++;
+	else if (++udp->cwndCount >= udp->cwnd)
+	{
+		udp->cwnd++;
+		udp->cwndCount = 0;
+	}
+	udp->cwnd = MIN(udp->cwnd, RDPUDP_MAX_CWND);
+}
+
+static BOOL rdpudp_channel_lost(rdpUdp* udp, UINT32 snCoded, BOOL timeout, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	if (!rdpudp_channel_outstanding(udp, snCoded))
+		return TRUE;
+
+	RDPUDP_CHANNEL_ENTRY* entry = &udp->channel[snCoded & RDPUDP_RING_MASK];
+	if (!entry->inUse)
+		return TRUE;
+
+	entry->inUse = FALSE;
+	rdpudp_congestion_event(udp, snCoded, timeout);
+
+	if (entry->fec)
+		return TRUE;
+
+	RDPUDP_SOURCE_ENTRY* src = &udp->source[entry->snSource & RDPUDP_RING_MASK];
+	if (!src->inUse || src->done || (src->snCoded != snCoded))
+		return TRUE;
+
+	if (udp->lossy)
+	{
+		src->done = TRUE;
+		return TRUE;
+	}
+
+	if (++src->retransmits > RDPUDP_MAX_RETRANSMITS)
+	{
+		rdpudp_fail(udp, "too many retransmissions");
+		return FALSE;
+	}
+
+	return rdpudp_send_source(udp, entry->snSource, now);
+}
+
+static BOOL rdpudp_process_ack(rdpUdp* udp, UINT32 snSourceAck, UINT16 flags,
+                               const BYTE* elements, size_t count, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	/* Acknowledges the SYN or nothing sent yet */
+	if (rdpudp_seq_diff(snSourceAck, udp->snCodedNext) >= 0)
+	{
+		WLog_WARN(TAG, "ignoring acknowledgement of unsent datagram %" PRIu32, snSourceAck);
+		return TRUE;
+	}
+
+	size_t total = 0;
+	for (size_t x = 0; x < count; x++)
+		total += (elements[x] & 0x3F) + 1;
+
+	const RDPUDP_CHANNEL_ENTRY* last = &udp->channel[snSourceAck & RDPUDP_RING_MASK];
+	if ((total > 0) && rdpudp_channel_outstanding(udp, snSourceAck) && last->inUse &&
+	    !(flags & RDPUDP_FLAG_ACKDELAYED))
+		rdpudp_update_rtt(udp, now - last->sentAt);
+
+	UINT32 seq = snSourceAck + 1 - (UINT32)total;
+	const UINT32 start = seq;
+	for (size_t x = 0; x < count; x++)
+	{
+		const BYTE state = elements[x] >> 6;
+		const size_t run = (elements[x] & 0x3F) + 1;
+
+		for (size_t y = 0; y < run; y++, seq++)
+		{
+			if (state == DATAGRAM_RECEIVED)
+				rdpudp_channel_acked(udp, seq);
+		}
+	}
+
+	if (flags & RDPUDP_FLAG_CN)
+		rdpudp_congestion_event(udp, snSourceAck, FALSE);
+
+	/* Datagrams reported missing while later ones arrived are lost */
+	for (UINT32 sn = udp->snCodedUna; rdpudp_seq_diff(snSourceAck, sn) >= RDPUDP_DUP_THRESHOLD;
+	     sn++)
+	{
+		if (rdpudp_seq_diff(sn, start) < 0)
+			continue;
+		if (!rdpudp_channel_lost(udp, sn, FALSE, now))
+			return FALSE;
+	}
+
+	rdpudp_retire_sources(udp);
+	return TRUE;
+}
+
+static BOOL rdpudp_deliver(rdpUdp* udp, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(udp->Receive);
+
+	if (!udp->Receive(udp->context, data, length))
+	{
+		rdpudp_fail(udp, "receive callback failed");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL rdpudp_receive_entry_valid(const rdpUdp* udp, UINT32 snSource)
+{
+	WINPR_ASSERT(udp);
+
+	const RDPUDP_RECEIVE_ENTRY* entry = &udp->receive[snSource & RDPUDP_RING_MASK];
+	return entry->present && (entry->snSource == snSource);
+}
+
+static BOOL rdpudp_store_source(rdpUdp* udp, UINT32 snSource, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(udp);
+
+	RDPUDP_RECEIVE_ENTRY* entry = &udp->receive[snSource & RDPUDP_RING_MASK];
+	if (!rdpudp_copy_payload(&entry->data, &entry->length, data, length))
+		return FALSE;
+
+	entry->present = TRUE;
+	entry->snSource = snSource;
+	if (rdpudp_seq_diff(snSource, udp->snSourceHighest) > 0)
+		udp->snSourceHighest = snSource;
+	return TRUE;
+}
+
+/* Returns FALSE if the payload was not accepted and must not be acknowledged */
+static BOOL rdpudp_receive_source(rdpUdp* udp, UINT32 snSource, const BYTE* data, size_t length,
+                                  BOOL* accepted)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(accepted);
+
+	*accepted = FALSE;
+
+	if (udp->lossy)
+	{
+		if (rdpudp_seq_diff(snSource, udp->snSourceHighest) <= -RDPUDP_RING_SIZE)
+			return TRUE;
+
+		*accepted = TRUE;
+		if (rdpudp_receive_entry_valid(udp, snSource))
+			return TRUE;
+
+		if (!rdpudp_store_source(udp, snSource, data, length))
+			return FALSE;
+		return rdpudp_deliver(udp, data, length);
+	}
+
+	const INT32 offset = rdpudp_seq_diff(snSource, udp->snDeliverNext);
+	if (offset >= RDPUDP_RING_SIZE)
+		return TRUE;
+
+	*accepted = TRUE;
+	if ((offset < 0) || rdpudp_receive_entry_valid(udp, snSource))
+		return TRUE;
+
+	if (!rdpudp_store_source(udp, snSource, data, length))
+		return FALSE;
+
+	while (rdpudp_receive_entry_valid(udp, udp->snDeliverNext))
+	{
+		RDPUDP_RECEIVE_ENTRY* entry = &udp->receive[udp->snDeliverNext & RDPUDP_RING_MASK];
+		entry->present = FALSE;
+		udp->snDeliverNext++;
+
+		if (!rdpudp_deliver(udp, entry->data, entry->length))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL rdpudp_fec_recover(rdpUdp* udp, RDPUDP_FEC_ENTRY* fec)
+{
+	BYTE data[RDPUDP_MTU_SIZE] = { 0 };
+
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(fec);
+	WINPR_ASSERT(fec->length >= 2);
+
+	UINT32 missing = 0;
+	size_t count = 0;
+
+	for (BYTE x = 0; x < fec->range; x++)
+	{
+		const UINT32 sn = fec->snSourceStart + x;
+		if (!rdpudp_receive_entry_valid(udp, sn))
+		{
+			missing = sn;
+			count++;
+		}
+	}
+
+	if (count != 1)
+	{
+		if (count == 0)
+			fec->inUse = FALSE;
+		return TRUE;
+	}
+
+	fec->inUse = FALSE;
+
+	UINT16 length = (UINT16)((fec->data[0] << 8) | fec->data[1]);
+	const size_t available = fec->length - 2;
+	memcpy(data, &fec->data[2], available);
+
+	for (BYTE x = 0; x < fec->range; x++)
+	{
+		const UINT32 sn = fec->snSourceStart + x;
+		if (sn == missing)
+			continue;
+
+		const RDPUDP_RECEIVE_ENTRY* entry = &udp->receive[sn & RDPUDP_RING_MASK];
+		if (entry->length > available)
+			return TRUE;
+
+		length ^= (UINT16)entry->length;
+		for (size_t y = 0; y < entry->length; y++)
+			data[y] ^= entry->data[y];
+	}
+
+	if (length > available)
+	{
+		WLog_WARN(TAG, "invalid FEC datagram for %" PRIu32, fec->snSourceStart);
+		return TRUE;
+	}
+
+	if (!rdpudp_store_source(udp, missing, data, length))
+		return FALSE;
+	return rdpudp_deliver(udp, data, length);
+}
+
+static BOOL rdpudp_receive_fec(rdpUdp* udp, UINT32 snSourceStart, BYTE range, const BYTE* data,
+                               size_t length)
+{
+	WINPR_ASSERT(udp);
+
+	if ((range == 0) || (range > RDPUDP_FEC_GROUP) || (length < 2))
+		return TRUE;
+
+	RDPUDP_FEC_ENTRY* fec = &udp->fec[udp->fecIndex++ % ARRAYSIZE(udp->fec)];
+	if (!rdpudp_copy_payload(&fec->data, &fec->length, data, length))
+		return FALSE;
+	fec->inUse = TRUE;
+	fec->snSourceStart = snSourceStart;
+	fec->range = range;
+
+	/* A recovered payload might complete another group */
+	BOOL progress = TRUE;
+	while (progress)
+	{
+		progress = FALSE;
+		for (size_t x = 0; x < ARRAYSIZE(udp->fec); x++)
+		{
+			RDPUDP_FEC_ENTRY* cur = &udp->fec[x];
+			if (!cur->inUse)
+				continue;
+
+			if (rdpudp_seq_diff(cur->snSourceStart, udp->snSourceHighest) <=
+			    -(RDPUDP_RING_SIZE - RDPUDP_FEC_GROUP))
+			{
+				cur->inUse = FALSE;
+				continue;
+			}
+
+			if (!rdpudp_fec_recover(udp, cur))
+				return FALSE;
+			if (!cur->inUse)
+				progress = TRUE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void rdpudp_channel_received(rdpUdp* udp, UINT32 snCoded, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	BOOL immediate = FALSE;
+
+	if (rdpudp_seq_diff(snCoded, udp->snHighest) > 0)
+	{
+		/* Gap, report it right away */
+		if (snCoded != udp->snHighest + 1)
+			immediate = TRUE;
+
+		for (UINT32 sn = udp->snHighest + 1, x = 0; (sn != snCoded) && (x < RDPUDP_RING_SIZE);
+		     sn++, x++)
+			udp->received[sn & RDPUDP_RING_MASK] = 0;
+
+		udp->snHighest = snCoded;
+		if (rdpudp_seq_diff(udp->snHighest, udp->snAckBase) >= RDPUDP_RING_SIZE)
+			udp->snAckBase = udp->snHighest - RDPUDP_RING_SIZE + 1;
+	}
+	else
+		immediate = TRUE;
+
+	if (rdpudp_seq_diff(snCoded, udp->snAckBase) >= 0)
+		udp->received[snCoded & RDPUDP_RING_MASK] = 1;
+
+	/* Reordering is tolerated like on the sender side, a datagram still missing after
+	 * RDPUDP_DUP_THRESHOLD later ones is lost */
+	const UINT32 snCheck = udp->snHighest - RDPUDP_DUP_THRESHOLD;
+	if ((rdpudp_seq_diff(snCheck, udp->snAckBase) >= 0) &&
+	    !udp->received[snCheck & RDPUDP_RING_MASK])
+		udp->sendCn = TRUE;
+
+	udp->unacked++;
+	if (immediate)
+		udp->unacked = MAX(udp->unacked, 2);
+
+	if (!udp->ackPending)
+	{
+		udp->ackPending = TRUE;
+		udp->ackDeadline = now + RDPUDP_ACK_DELAY;
+	}
+}
+
+static BOOL rdpudp_parse_syn(rdpUdp* udp, wStream* s, UINT16 flags, UINT32* snInitial)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(snInitial);
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_SYNDATA_LENGTH))
+		return FALSE;
+
+	UINT16 upMtu = 0;
+	UINT16 downMtu = 0;
+	Stream_Read_UINT32_BE(s, *snInitial);
+	Stream_Read_UINT16_BE(s, upMtu);
+	Stream_Read_UINT16_BE(s, downMtu);
+
+	const UINT16 mtu = MIN(MIN(upMtu, downMtu), RDPUDP_MTU_SIZE);
+	if (mtu < RDPUDP_MIN_MTU_SIZE)
+	{
+		WLog_ERR(TAG, "MTU %" PRIu16 " too small", mtu);
+		return FALSE;
+	}
+	udp->mtu = mtu;
+
+	if (flags & RDPUDP_FLAG_CORRELATION_ID)
+	{
+		/* RDPUDP_CORRELATION_ID_PAYLOAD, only used for diagnostics */
+		if (!Stream_SafeSeek(s, RDPUDP_CORRELATION_ID_LENGTH))
+			return FALSE;
+	}
+
+	udp->version = RDPUDP_PROTOCOL_VERSION_1;
+	udp->synEx = (flags & RDPUDP_FLAG_SYNEX) != 0;
+	if (udp->synEx)
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 4))
+			return FALSE;
+
+		UINT16 synExFlags = 0;
+		UINT16 version = 0;
+		Stream_Read_UINT16_BE(s, synExFlags);
+		Stream_Read_UINT16_BE(s, version);
+
+		if (synExFlags & RDPUDP_VERSION_INFO_VALID)
+			udp->version = version;
+	}
+
+	/* RDPUDP2 (version 3) is not implemented, stay with the version 1 datagram format */
+	udp->version = MIN(udp->version, RDPUDP_PROTOCOL_VERSION_2);
+	return TRUE;
+}
+
+static BOOL rdpudp_handle_syn(rdpUdp* udp, wStream* s, UINT32 snSourceAck, UINT16 flags,
+                              UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	UINT32 snInitial = 0;
+
+	if (udp->server)
+	{
+		if (flags & RDPUDP_FLAG_ACK)
+			return TRUE;
+
+		/* Our SYN+ACK was lost */
+		if (udp->state == RDPUDP_STATE_SYN_RECEIVED)
+			return rdpudp_send_synack(udp);
+
+		if (udp->state != RDPUDP_STATE_LISTEN)
+			return TRUE;
+
+		if (!rdpudp_parse_syn(udp, s, flags, &snInitial))
+			return TRUE;
+
+		udp->lossy = (flags & RDPUDP_FLAG_SYNLOSSY) != 0;
+		udp->snPeerInitial = snInitial;
+		rdpudp_init_sequences(udp);
+		udp->state = RDPUDP_STATE_SYN_RECEIVED;
+		udp->synSentAt = now;
+		udp->synRetries = 0;
+		return rdpudp_send_synack(udp);
+	}
+
+	if (!(flags & RDPUDP_FLAG_ACK))
+		return TRUE;
+
+	/* Our ACK of the SYN+ACK was lost */
+	if (udp->state == RDPUDP_STATE_ESTABLISHED)
+		return rdpudp_send_ack(udp);
+
+	if ((udp->state != RDPUDP_STATE_SYN_SENT) || (snSourceAck != udp->snLocalInitial))
+		return TRUE;
+
+	if (!rdpudp_parse_syn(udp, s, flags, &snInitial))
+	{
+		rdpudp_fail(udp, "invalid SYN+ACK");
+		return FALSE;
+	}
+
+	udp->snPeerInitial = snInitial;
+	rdpudp_init_sequences(udp);
+	udp->state = RDPUDP_STATE_ESTABLISHED;
+	udp->rto = RDPUDP_INITIAL_RTO;
+	return rdpudp_send_ack(udp);
+}
+
+BOOL rdpudp_input(rdpUdp* udp, const BYTE* data, size_t length, UINT64 now)
+{
+	wStream sbuffer = { 0 };
+
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(data || (length == 0));
+
+	if ((udp->state == RDPUDP_STATE_CLOSED) || (udp->state == RDPUDP_STATE_FAILED))
+		return FALSE;
+
+	wStream* s = Stream_StaticConstInit(&sbuffer, data, length);
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_FEC_HEADER_LENGTH))
+		return TRUE;
+
+	UINT32 snSourceAck = 0;
+	UINT16 receiveWindow = 0;
+	UINT16 flags = 0;
+	Stream_Read_UINT32_BE(s, snSourceAck);
+	Stream_Read_UINT16_BE(s, receiveWindow);
+	Stream_Read_UINT16_BE(s, flags);
+
+	if (flags & RDPUDP_FLAG_SYN)
+		return rdpudp_handle_syn(udp, s, snSourceAck, flags, now);
+
+	if (udp->state == RDPUDP_STATE_SYN_RECEIVED)
+	{
+		if (!(flags & RDPUDP_FLAG_ACK))
+			return TRUE;
+		udp->state = RDPUDP_STATE_ESTABLISHED;
+		udp->rto = RDPUDP_INITIAL_RTO;
+	}
+
+	if (udp->state != RDPUDP_STATE_ESTABLISHED)
+		return TRUE;
+
+	if (flags & RDPUDP_FLAG_FIN)
+	{
+		udp->state = RDPUDP_STATE_CLOSED;
+		return TRUE;
+	}
+
+	udp->peerWindow = MAX(receiveWindow, 1);
+
+	if (flags & RDPUDP_FLAG_CWR)
+		udp->sendCn = FALSE;
+
+	if (flags & RDPUDP_FLAG_ACK)
+	{
+		UINT16 count = 0;
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
+			return TRUE;
+		Stream_Read_UINT16_BE(s, count);
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, count + ((4 - ((2 + count) % 4)) % 4)))
+			return TRUE;
+		const BYTE* vector = Stream_ConstPointer(s);
+		Stream_Seek(s, count + ((4 - ((2 + count) % 4)) % 4));
+
+		if (flags & RDPUDP_FLAG_AOA)
+		{
+			UINT32 snAckOfAcks = 0;
+			if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_ACK_OF_ACKS_LENGTH))
+				return TRUE;
+			Stream_Read_UINT32_BE(s, snAckOfAcks);
+
+			/* The peer knows the state of everything before, stop reporting it */
+			if ((rdpudp_seq_diff(snAckOfAcks, udp->snAckBase) > 0) &&
+			    (rdpudp_seq_diff(snAckOfAcks, udp->snHighest) <= 1))
+				udp->snAckBase = snAckOfAcks;
+		}
+
+		if (!rdpudp_process_ack(udp, snSourceAck, flags, vector, count, now))
+			return FALSE;
+	}
+
+	if (flags & (RDPUDP_FLAG_DATA | RDPUDP_FLAG_FEC))
+	{
+		const size_t hdrlen = (flags & RDPUDP_FLAG_FEC) ? RDPUDP_FEC_PAYLOAD_HEADER_LENGTH
+		                                                : RDPUDP_SOURCE_HEADER_LENGTH;
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, hdrlen))
+			return TRUE;
+
+		UINT32 snCoded = 0;
+		UINT32 snSourceStart = 0;
+		BOOL accepted = TRUE;
+		Stream_Read_UINT32_BE(s, snCoded);
+		Stream_Read_UINT32_BE(s, snSourceStart);
+
+		if (flags & RDPUDP_FLAG_FEC)
+		{
+			BYTE range = 0;
+			Stream_Read_UINT8(s, range);
+			Stream_Seek(s, 3); /* uFecIndex, padding */
+
+			if (udp->lossy && !rdpudp_receive_fec(udp, snSourceStart, range,
+			                                      Stream_ConstPointer(s),
+			                                      Stream_GetRemainingLength(s)))
+				return FALSE;
+		}
+		else if (!rdpudp_receive_source(udp, snSourceStart, Stream_ConstPointer(s),
+		                                 Stream_GetRemainingLength(s), &accepted))
+			return FALSE;
+
+		if (accepted)
+			rdpudp_channel_received(udp, snCoded, now);
+	}
+
+	return rdpudp_flush(udp, now);
+}
+
+BOOL rdpudp_write(rdpUdp* udp, const BYTE* data, size_t length, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->state != RDPUDP_STATE_ESTABLISHED)
+		return FALSE;
+
+	if ((length == 0) || (length > rdpudp_max_payload(udp->mtu)))
+	{
+		WLog_ERR(TAG, "invalid payload length %" PRIuz, length);
+		return FALSE;
+	}
+
+	wStream* s = Stream_New(NULL, length);
+	if (!s)
+		return FALSE;
+
+	Stream_Write(s, data, length);
+	Stream_SealLength(s);
+	if (!Queue_Enqueue(udp->pending, s))
+	{
+		Stream_Free(s, TRUE);
+		return FALSE;
+	}
+
+	return rdpudp_flush(udp, now);
+}
+
+BOOL rdpudp_check_timeout(rdpUdp* udp, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	switch (udp->state)
+	{
+		case RDPUDP_STATE_SYN_SENT:
+		case RDPUDP_STATE_SYN_RECEIVED:
+			if (now - udp->synSentAt < udp->rto)
+				return TRUE;
+
+			if (++udp->synRetries > RDPUDP_SYN_RETRIES)
+			{
+				rdpudp_fail(udp, "handshake timed out");
+				return FALSE;
+			}
+
+			udp->synSentAt = now;
+			udp->rto = MIN(udp->rto * 2, RDPUDP_MAX_RTO);
+			if (udp->state == RDPUDP_STATE_SYN_SENT)
+				return rdpudp_send_syn(udp);
+			return rdpudp_send_synack(udp);
+
+		case RDPUDP_STATE_ESTABLISHED:
+			break;
+
+		default:
+			return udp->state != RDPUDP_STATE_FAILED;
+	}
+
+	BOOL expired = FALSE;
+	for (UINT32 sn = udp->snCodedUna; sn != udp->snCodedNext; sn++)
+	{
+		const RDPUDP_CHANNEL_ENTRY* entry = &udp->channel[sn & RDPUDP_RING_MASK];
+		if (!entry->inUse || (now - entry->sentAt < udp->rto))
+			continue;
+
+		expired = TRUE;
+		if (!rdpudp_channel_lost(udp, sn, TRUE, now))
+			return FALSE;
+	}
+
+	if (expired)
+		udp->rto = MIN(udp->rto * 2, RDPUDP_MAX_RTO);
+
+	if (udp->ackPending && (now >= udp->ackDeadline))
+	{
+		udp->ackDelayed = TRUE;
+		if (!rdpudp_send_ack(udp))
+			return FALSE;
+	}
+
+	rdpudp_retire_sources(udp);
+	return rdpudp_flush(udp, now);
+}
+
+UINT32 rdpudp_get_timeout(const rdpUdp* udp, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	UINT64 deadline = UINT64_MAX;
+
+	switch (udp->state)
+	{
+		case RDPUDP_STATE_SYN_SENT:
+		case RDPUDP_STATE_SYN_RECEIVED:
+			deadline = udp->synSentAt + udp->rto;
+			break;
+
+		case RDPUDP_STATE_ESTABLISHED:
+			if (udp->ackPending)
+				deadline = udp->ackDeadline;
+
+			for (UINT32 sn = udp->snCodedUna; sn != udp->snCodedNext; sn++)
+			{
+				const RDPUDP_CHANNEL_ENTRY* entry = &udp->channel[sn & RDPUDP_RING_MASK];
+				if (entry->inUse)
+					deadline = MIN(deadline, entry->sentAt + udp->rto);
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	if (deadline == UINT64_MAX)
+		return INFINITE;
+	if (deadline <= now)
+		return 0;
+	return (UINT32)MIN(deadline - now, INFINITE - 1);
+}
+
+BOOL rdpudp_connect(rdpUdp* udp, BOOL lossy, UINT64 now)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->server || (udp->state != RDPUDP_STATE_CLOSED))
+		return FALSE;
+
+	winpr_RAND(&udp->snLocalInitial, sizeof(udp->snLocalInitial));
+	udp->lossy = lossy;
+	udp->state = RDPUDP_STATE_SYN_SENT;
+	udp->synSentAt = now;
+	udp->synRetries = 0;
+	return rdpudp_send_syn(udp);
+}
+
+BOOL rdpudp_close(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->state != RDPUDP_STATE_ESTABLISHED)
+	{
+		udp->state = RDPUDP_STATE_CLOSED;
+		return TRUE;
+	}
+
+	udp->state = RDPUDP_STATE_CLOSED;
+	wStream* s = rdpudp_write_header(udp, udp->snHighest, RDPUDP_FLAG_FIN | RDPUDP_FLAG_ACK);
+	rdpudp_write_ack_vector(udp, s);
+	return rdpudp_send_datagram(udp, s);
+}
+
+RDPUDP_STATE rdpudp_get_state(const rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return udp->state;
+}
+
+BOOL rdpudp_is_lossy(const rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return udp->lossy;
+}
+
+size_t rdpudp_get_max_payload(const rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return rdpudp_max_payload(udp->mtu);
+}
+
+size_t rdpudp_get_pending(const rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return Queue_Count(udp->pending) + (udp->snSourceNext - udp->snSourceUna);
+}
+
+static void rdpudp_stream_free(void* obj)
+{
+	Stream_Free(obj, TRUE);
+}
+
+rdpUdp* rdpudp_new(BOOL server, RdpUdpSendCb send, RdpUdpReceiveCb receive, void* context)
+{
+	WINPR_ASSERT(send);
+	WINPR_ASSERT(receive);
+
+	rdpUdp* udp = calloc(1, sizeof(rdpUdp));
+	if (!udp)
+		return NULL;
+
+	udp->server = server;
+	udp->state = server ? RDPUDP_STATE_LISTEN : RDPUDP_STATE_CLOSED;
+	udp->Send = send;
+	udp->Receive = receive;
+	udp->context = context;
+	udp->mtu = RDPUDP_MTU_SIZE;
+	udp->peerWindow = RDPUDP_RECEIVE_WINDOW;
+	udp->cwnd = RDPUDP_INITIAL_CWND;
+	udp->ssthresh = RDPUDP_MAX_CWND;
+	udp->rto = RDPUDP_INITIAL_RTO;
+
+	if (server)
+		winpr_RAND(&udp->snLocalInitial, sizeof(udp->snLocalInitial));
+
+	udp->buffer = Stream_New(NULL, RDPUDP_MTU_SIZE);
+	udp->pending = Queue_New(FALSE, -1, -1);
+	if (!udp->buffer || !udp->pending)
+		goto fail;
+
+	wObject* obj = Queue_Object(udp->pending);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = rdpudp_stream_free;
+	return udp;
+
+fail:
+	WINPR_PRAGMA_DIAG_PUSH
+	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
+	rdpudp_free(udp);
+	WINPR_PRAGMA_DIAG_POP
+	return NULL;
+}
+
+void rdpudp_free(rdpUdp* udp)
+{
+	if (!udp)
+		return;
+
+	for (size_t x = 0; x < RDPUDP_RING_SIZE; x++)
+	{
+		free(udp->source[x].data);
+		free(udp->receive[x].data);
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(udp->fec); x++)
+		free(udp->fec[x].data);
+
+	Queue_Free(udp->pending);
+	Stream_Free(udp->buffer, TRUE);
+	free(udp);
+}
@@ -0,0 +1,85 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * UDP Transport Extension [MS-RDPEUDP]
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_RDPUDP_H
+#define FREERDP_LIB_CORE_RDPUDP_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+/*
+ * RDP-UDP protocol engine.
+ *
+ * The engine does no I/O on its own: datagrams received from the socket are passed to
+ * rdpudp_input, datagrams to send are handed to the send callback and payloads are delivered
+ * through the receive callback. All functions take the current time in milliseconds so the
+ * caller drives the retransmission and delayed acknowledgement timers via rdpudp_check_timeout.
+ *
+ * In reliable mode payloads are delivered exactly once and in order. In lossy mode lost
+ * datagrams are not retransmitted, payloads are delivered when they arrive and single losses
+ * within a group of datagrams are recovered from FEC datagrams.
+ *
+ * This is the protocol engine only, nothing in the connection sequence uses it yet. Missing
+ * before multitransport can be offered:
+ * - a UDP socket owner calling the engine from the client and server transports,
+ * - the TLS (reliable) and DTLS (lossy) security layer on top of the engine,
+ * - the RDPEMT tunnel PDUs and moving dynamic channels onto the tunnel,
+ * - RDPEUDP2 (SYNEX version 3) and with it the security cookie hash in the SYN datagram,
+ *   the engine announces version 2 and keeps the RDPEUDP datagram format.
+ * Until then the client declines the Initiate Multitransport Request (multitransport.c).
+ */
+
+typedef struct rdp_udp rdpUdp;
+
+#define RDPUDP_MTU_SIZE 1232
+#define RDPUDP_MIN_MTU_SIZE 1132
+
+typedef enum
+{
+	RDPUDP_STATE_CLOSED,
+	RDPUDP_STATE_LISTEN,
+	RDPUDP_STATE_SYN_SENT,
+	RDPUDP_STATE_SYN_RECEIVED,
+	RDPUDP_STATE_ESTABLISHED,
+	RDPUDP_STATE_FAILED
+} RDPUDP_STATE;
+
+typedef BOOL (*RdpUdpSendCb)(void* context, const BYTE* data, size_t length);
+typedef BOOL (*RdpUdpReceiveCb)(void* context, const BYTE* data, size_t length);
+
+FREERDP_LOCAL void rdpudp_free(rdpUdp* udp);
+
+WINPR_ATTR_MALLOC(rdpudp_free, 1)
+FREERDP_LOCAL rdpUdp* rdpudp_new(BOOL server, RdpUdpSendCb send, RdpUdpReceiveCb receive,
+                                 void* context);
+
+FREERDP_LOCAL BOOL rdpudp_connect(rdpUdp* udp, BOOL lossy, UINT64 now);
+FREERDP_LOCAL BOOL rdpudp_close(rdpUdp* udp);
+
+FREERDP_LOCAL BOOL rdpudp_input(rdpUdp* udp, const BYTE* data, size_t length, UINT64 now);
+FREERDP_LOCAL BOOL rdpudp_write(rdpUdp* udp, const BYTE* data, size_t length, UINT64 now);
+
+FREERDP_LOCAL BOOL rdpudp_check_timeout(rdpUdp* udp, UINT64 now);
+FREERDP_LOCAL UINT32 rdpudp_get_timeout(const rdpUdp* udp, UINT64 now);
+
+FREERDP_LOCAL RDPUDP_STATE rdpudp_get_state(const rdpUdp* udp);
+FREERDP_LOCAL BOOL rdpudp_is_lossy(const rdpUdp* udp);
+FREERDP_LOCAL size_t rdpudp_get_max_payload(const rdpUdp* udp);
+FREERDP_LOCAL size_t rdpudp_get_pending(const rdpUdp* udp);
+
+#endif /* FREERDP_LIB_CORE_RDPUDP_H */
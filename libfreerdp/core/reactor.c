@@ -0,0 +1,579 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RDP Server Peer Reactor
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/handle.h>
+
+#include <freerdp/log.h>
+#include <freerdp/listener.h>
+#include <freerdp/channels/wtsvc.h>
+
+#define TAG FREERDP_TAG("core.reactor")
+
+/* handles of a single peer: transport, virtual channel manager and timer */
+#define REACTOR_MAX_HANDLES 32
+#define REACTOR_MAX_EVENTS 256
+
+#if defined(_WIN32)
+/* Wait sets are limited to MAXIMUM_WAIT_OBJECTS handles, which limits the number of peers a
+ * worker can serve. */
+#define REACTOR_GENERIC_HANDLES 8
+#define REACTOR_GENERIC_ENTRIES ((MAXIMUM_WAIT_OBJECTS - 1) / REACTOR_GENERIC_HANDLES)
+#endif
+
+typedef struct s_reactor_worker reactor_worker;
+
+typedef struct
+{
+	reactor_worker* worker;
+	size_t index;
+	freerdp_listener* listener;
+	freerdp_peer* peer;
+	HANDLE vcm;
+	HANDLE timer;
+	psReactorPeerEvent callback;
+	void* arg;
+	BOOL ready;
+	HANDLE handles[REACTOR_MAX_HANDLES];
+	DWORD nhandles;
+} reactor_entry;
+
+struct s_reactor_worker
+{
+	freerdp_reactor* reactor;
+	HANDLE thread;
+	HANDLE event;
+
+	/* protected by the reactor lock */
+	wArrayList* pending;
+	size_t load;
+	BOOL failed;
+
+	/* only accessed by the worker thread */
+	reactor_entry** entries;
+	size_t count;
+	size_t capacity;
+	WINPR_WAIT_SET* set;
+};
+
+struct rdp_freerdp_reactor
+{
+	CRITICAL_SECTION lock;
+	BOOL stopping;
+	size_t peers;
+	size_t count;
+	reactor_worker* workers;
+};
+
+static void reactor_entry_free(reactor_entry* entry)
+{
+	if (!entry)
+		return;
+
+	if (entry->timer)
+		(void)CloseHandle(entry->timer);
+	free(entry);
+}
+
+static DWORD reactor_entry_get_handles(reactor_entry* entry, HANDLE* handles, DWORD count)
+{
+	DWORD nCount = 0;
+
+	WINPR_ASSERT(entry);
+
+	if (entry->listener)
+		return entry->listener->GetEventHandles(entry->listener, handles, count);
+
+	WINPR_ASSERT(entry->peer);
+	nCount = entry->peer->GetEventHandles(entry->peer, handles, count);
+	if (nCount == 0)
+		return 0;
+
+	if (entry->vcm)
+	{
+		if (nCount >= count)
+			return 0;
+		handles[nCount++] = WTSVirtualChannelManagerGetEventHandle(entry->vcm);
+	}
+
+	if (entry->timer)
+	{
+		if (nCount >= count)
+			return 0;
+		handles[nCount++] = entry->timer;
+	}
+
+	return nCount;
+}
+
+static BOOL reactor_entry_check(reactor_entry* entry)
+{
+	WINPR_ASSERT(entry);
+
+	if (entry->listener)
+		return entry->listener->CheckFileDescriptor(entry->listener);
+
+	if (entry->timer && (WaitForSingleObject(entry->timer, 0) == WAIT_OBJECT_0))
+	{
+		if (!entry->callback(entry->peer, FREERDP_REACTOR_PEER_TIMER, entry->arg))
+			return FALSE;
+	}
+
+	if (!entry->peer->CheckFileDescriptor(entry->peer))
+		return FALSE;
+
+	if (entry->vcm && !WTSVirtualChannelManagerCheckFileDescriptor(entry->vcm))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* The handles of a peer change during the connection sequence, so they are compared after
+ * every dispatch. Descriptor and mode changes of the handles are left to the wait set. */
+static BOOL reactor_entry_update(reactor_entry* entry)
+{
+	HANDLE handles[REACTOR_MAX_HANDLES] = { 0 };
+
+	WINPR_ASSERT(entry);
+	WINPR_ASSERT(entry->worker);
+
+	const DWORD nCount = reactor_entry_get_handles(entry, handles, ARRAYSIZE(handles));
+	if (nCount == 0)
+	{
+		WLog_ERR(TAG, "Failed to get event handles");
+		return FALSE;
+	}
+
+	if ((nCount == entry->nhandles) &&
+	    (memcmp(handles, entry->handles, sizeof(HANDLE) * nCount) == 0))
+		return TRUE;
+
+	if (!WaitSet_SetHandles(entry->worker->set, handles, nCount, entry))
+	{
+		WLog_ERR(TAG, "Failed to update the wait set");
+		return FALSE;
+	}
+
+	memcpy(entry->handles, handles, sizeof(HANDLE) * nCount);
+	entry->nhandles = nCount;
+	return TRUE;
+}
+
+static void reactor_entry_unregister(reactor_entry* entry)
+{
+	WINPR_ASSERT(entry);
+	WINPR_ASSERT(entry->worker);
+
+	(void)WaitSet_SetHandles(entry->worker->set, NULL, 0, entry);
+	entry->nhandles = 0;
+}
+
+static BOOL reactor_worker_append(reactor_worker* worker, reactor_entry* entry)
+{
+	WINPR_ASSERT(worker);
+	WINPR_ASSERT(entry);
+
+	if (worker->count == worker->capacity)
+	{
+		const size_t capacity = MAX(32, worker->capacity * 2);
+		reactor_entry** entries = realloc(worker->entries, sizeof(reactor_entry*) * capacity);
+		if (!entries)
+			return FALSE;
+		worker->entries = entries;
+		worker->capacity = capacity;
+	}
+
+	entry->index = worker->count;
+	worker->entries[worker->count++] = entry;
+	return TRUE;
+}
+
+/* Removes the entry from the worker, a peer is handed back to the application */
+static void reactor_worker_close(reactor_worker* worker, reactor_entry* entry)
+{
+	WINPR_ASSERT(worker);
+	WINPR_ASSERT(entry);
+
+	reactor_entry_unregister(entry);
+
+	if ((entry->index < worker->count) && (worker->entries[entry->index] == entry))
+	{
+		reactor_entry* last = worker->entries[--worker->count];
+		worker->entries[entry->index] = last;
+		last->index = entry->index;
+	}
+
+	EnterCriticalSection(&worker->reactor->lock);
+	worker->load--;
+	if (entry->peer)
+		worker->reactor->peers--;
+	LeaveCriticalSection(&worker->reactor->lock);
+
+	if (entry->peer)
+		(void)entry->callback(entry->peer, FREERDP_REACTOR_PEER_CLOSED, entry->arg);
+	else
+		WLog_INFO(TAG, "Listener removed from reactor");
+	reactor_entry_free(entry);
+}
+
+static void reactor_worker_dispatch(reactor_worker* worker, reactor_entry* entry)
+{
+	WINPR_ASSERT(worker);
+	WINPR_ASSERT(entry);
+
+	if (!reactor_entry_check(entry) || !reactor_entry_update(entry))
+		reactor_worker_close(worker, entry);
+}
+
+/* Takes over the entries added from other threads, returns FALSE if the reactor stops */
+static BOOL reactor_worker_take_pending(reactor_worker* worker)
+{
+	BOOL stopping = FALSE;
+
+	(void)ResetEvent(worker->event);
+
+	while (TRUE)
+	{
+		reactor_entry* entry = NULL;
+
+		EnterCriticalSection(&worker->reactor->lock);
+		stopping = worker->reactor->stopping;
+		if (ArrayList_Count(worker->pending) > 0)
+		{
+			entry = ArrayList_GetItem(worker->pending, 0);
+			ArrayList_RemoveAt(worker->pending, 0);
+		}
+		LeaveCriticalSection(&worker->reactor->lock);
+
+		if (!entry)
+			break;
+
+		if (!reactor_worker_append(worker, entry))
+		{
+			entry->index = SIZE_MAX;
+			reactor_worker_close(worker, entry);
+		}
+		else if (!reactor_entry_update(entry))
+			reactor_worker_close(worker, entry);
+	}
+
+	return !stopping;
+}
+
+static BOOL reactor_worker_wait(reactor_worker* worker)
+{
+	void* events[REACTOR_MAX_EVENTS] = { 0 };
+	reactor_entry* ready[REACTOR_MAX_EVENTS] = { 0 };
+	size_t count = ARRAYSIZE(events);
+	size_t nready = 0;
+	BOOL wakeup = FALSE;
+
+	const DWORD status = WaitSet_WaitEx(worker->set, INFINITE, events, &count);
+	if (status != WAIT_OBJECT_0)
+	{
+		WLog_ERR(TAG, "WaitSet_WaitEx failed with 0x%08" PRIx32, GetLastError());
+		return FALSE;
+	}
+
+	/* a peer might be reported once per handle, it is checked once */
+	for (size_t x = 0; x < count; x++)
+	{
+		reactor_entry* entry = events[x];
+
+		if (!entry)
+			wakeup = TRUE;
+		else if (!entry->ready)
+		{
+			entry->ready = TRUE;
+			ready[nready++] = entry;
+		}
+	}
+
+	for (size_t x = 0; x < nready; x++)
+	{
+		ready[x]->ready = FALSE;
+		reactor_worker_dispatch(worker, ready[x]);
+	}
+
+	if (wakeup)
+		return reactor_worker_take_pending(worker);
+	return TRUE;
+}
+
+static DWORD WINAPI reactor_worker_thread(LPVOID arg)
+{
+	reactor_worker* worker = arg;
+	WINPR_ASSERT(worker);
+
+	while (reactor_worker_wait(worker))
+		;
+
+	/* the reactor stops or this worker failed, either way it hands back all peers it still
+	 * serves. A failed worker takes no new entries, the other workers continue. */
+	EnterCriticalSection(&worker->reactor->lock);
+	worker->failed = TRUE;
+	if (!worker->reactor->stopping)
+		WLog_ERR(TAG, "Reactor worker failed, closing its %" PRIuz " entries", worker->load);
+	LeaveCriticalSection(&worker->reactor->lock);
+	(void)reactor_worker_take_pending(worker);
+
+	while (worker->count > 0)
+		reactor_worker_close(worker, worker->entries[worker->count - 1]);
+
+	ExitThread(0);
+	return 0;
+}
+
+static BOOL reactor_add(freerdp_reactor* reactor, reactor_entry* entry)
+{
+	BOOL rc = FALSE;
+	reactor_worker* worker = NULL;
+
+	WINPR_ASSERT(reactor);
+	WINPR_ASSERT(entry);
+
+	EnterCriticalSection(&reactor->lock);
+	if (reactor->stopping)
+		goto fail;
+
+	/* listeners stay on the first worker, peers go to the least busy one */
+	for (size_t x = 0; x < reactor->count; x++)
+	{
+		reactor_worker* cur = &reactor->workers[x];
+
+		if (cur->failed)
+			continue;
+		if (!worker || (entry->peer && (cur->load < worker->load)))
+			worker = cur;
+	}
+
+	if (!worker)
+	{
+		WLog_ERR(TAG, "No reactor worker left");
+		goto fail;
+	}
+
+#if defined(_WIN32)
+	if (worker->load >= REACTOR_GENERIC_ENTRIES)
+	{
+		WLog_ERR(TAG, "All reactor workers are busy");
+		goto fail;
+	}
+#endif
+
+	entry->worker = worker;
+	if (!ArrayList_Append(worker->pending, entry))
+		goto fail;
+
+	worker->load++;
+	if (entry->peer)
+		reactor->peers++;
+	rc = SetEvent(worker->event);
+
+fail:
+	LeaveCriticalSection(&reactor->lock);
+	return rc;
+}
+
+BOOL freerdp_reactor_add_listener(freerdp_reactor* reactor, freerdp_listener* listener)
+{
+	if (!reactor || !listener)
+		return FALSE;
+
+	reactor_entry* entry = calloc(1, sizeof(reactor_entry));
+	if (!entry)
+		return FALSE;
+
+	entry->listener = listener;
+	if (!reactor_add(reactor, entry))
+	{
+		reactor_entry_free(entry);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL freerdp_reactor_add_peer(freerdp_reactor* reactor, freerdp_peer* peer, HANDLE vcm,
+                              UINT32 timerInterval, psReactorPeerEvent callback, void* arg)
+{
+	if (!reactor || !peer || !callback)
+		return FALSE;
+
+	reactor_entry* entry = calloc(1, sizeof(reactor_entry));
+	if (!entry)
+		return FALSE;
+
+	entry->peer = peer;
+	entry->vcm = vcm;
+	entry->callback = callback;
+	entry->arg = arg;
+
+	if (timerInterval > 0)
+	{
+		LARGE_INTEGER due = { 0 };
+		due.QuadPart = -10000LL * timerInterval;
+
+		entry->timer = CreateWaitableTimerA(NULL, FALSE, NULL);
+		if (!entry->timer ||
+		    !SetWaitableTimer(entry->timer, &due, (LONG)MIN(timerInterval, INT32_MAX), NULL,
+		                      NULL, FALSE))
+			goto fail;
+	}
+
+	if (!reactor_add(reactor, entry))
+		goto fail;
+
+	return TRUE;
+
+fail:
+	reactor_entry_free(entry);
+	return FALSE;
+}
+
+size_t freerdp_reactor_get_peer_count(freerdp_reactor* reactor)
+{
+	size_t count = 0;
+
+	if (!reactor)
+		return 0;
+
+	EnterCriticalSection(&reactor->lock);
+	count = reactor->peers;
+	LeaveCriticalSection(&reactor->lock);
+	return count;
+}
+
+static BOOL reactor_worker_init(freerdp_reactor* reactor, reactor_worker* worker)
+{
+	WINPR_ASSERT(reactor);
+	WINPR_ASSERT(worker);
+
+	worker->reactor = reactor;
+	worker->set = WaitSet_New();
+	if (!worker->set)
+		return FALSE;
+
+	worker->pending = ArrayList_New(FALSE);
+	if (!worker->pending)
+		return FALSE;
+
+	worker->event = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!worker->event)
+		return FALSE;
+
+	if (!WaitSet_AddEx(worker->set, worker->event, NULL))
+		return FALSE;
+
+	worker->thread = CreateThread(NULL, 0, reactor_worker_thread, worker, 0, NULL);
+	return worker->thread != NULL;
+}
+
+static void reactor_worker_uninit(reactor_worker* worker)
+{
+	WINPR_ASSERT(worker);
+
+	if (worker->thread)
+	{
+		(void)WaitForSingleObject(worker->thread, INFINITE);
+		(void)CloseHandle(worker->thread);
+	}
+
+	if (worker->event)
+		(void)CloseHandle(worker->event);
+
+	if (worker->pending)
+	{
+		/* entries that never reached a worker thread */
+		for (size_t x = 0; x < ArrayList_Count(worker->pending); x++)
+		{
+			reactor_entry* entry = ArrayList_GetItem(worker->pending, x);
+			if (entry->peer)
+				(void)entry->callback(entry->peer, FREERDP_REACTOR_PEER_CLOSED, entry->arg);
+			reactor_entry_free(entry);
+		}
+		ArrayList_Free(worker->pending);
+	}
+
+	free(worker->entries);
+	WaitSet_Free(worker->set);
+}
+
+void freerdp_reactor_free(freerdp_reactor* reactor)
+{
+	if (!reactor)
+		return;
+
+	EnterCriticalSection(&reactor->lock);
+	reactor->stopping = TRUE;
+	for (size_t x = 0; x < reactor->count; x++)
+	{
+		if (reactor->workers[x].event)
+			(void)SetEvent(reactor->workers[x].event);
+	}
+	LeaveCriticalSection(&reactor->lock);
+
+	for (size_t x = 0; x < reactor->count; x++)
+		reactor_worker_uninit(&reactor->workers[x]);
+
+	free(reactor->workers);
+	DeleteCriticalSection(&reactor->lock);
+	free(reactor);
+}
+
+freerdp_reactor* freerdp_reactor_new(size_t workers)
+{
+	freerdp_reactor* reactor = calloc(1, sizeof(freerdp_reactor));
+	if (!reactor)
+		return NULL;
+
+	if (!InitializeCriticalSectionAndSpinCount(&reactor->lock, 4000))
+	{
+		free(reactor);
+		return NULL;
+	}
+
+	if (workers == 0)
+	{
+		SYSTEM_INFO sysInfos = { 0 };
+		GetNativeSystemInfo(&sysInfos);
+		workers = MAX(1, sysInfos.dwNumberOfProcessors);
+	}
+
+	reactor->workers = calloc(workers, sizeof(reactor_worker));
+	if (!reactor->workers)
+		goto fail;
+
+	for (size_t x = 0; x < workers; x++)
+	{
+		reactor->count++;
+		if (!reactor_worker_init(reactor, &reactor->workers[x]))
+			goto fail;
+	}
+
+	return reactor;
+
+fail:
+	WLog_ERR(TAG, "Failed to create reactor with %" PRIuz " workers", workers);
+	freerdp_reactor_free(reactor);
+	return NULL;
+}
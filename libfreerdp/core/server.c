@@ -54,6 +54,10 @@
 #endif
 
 #define DVC_MAX_DATA_PDU_SIZE 1600
+/* room for the largest DVC PDU header, 1 byte header + 4 byte channel id + 4 byte length */
+#define WTS_CHANNEL_STREAM_HEADROOM 16
+/* larger streams are allocated on demand and freed on release instead of being pooled */
+#define WTS_CHANNEL_POOL_MAX_STREAM_SIZE (64ull * 1024ull)
 
 typedef struct
 {
@@ -94,20 +98,24 @@ static BOOL wts_queue_receive_data(rdpPeerChannel* channel, const BYTE* Buffer,
 	return MessageQueue_Post(channel->queue, messageCtx, 0, NULL, NULL);
 }
 
-static BOOL wts_queue_send_item(rdpPeerChannel* channel, BYTE* Buffer, UINT32 Length)
+/* Queues the data between offset and the current position, the queue owns the stream */
+static BOOL wts_queue_send_item(rdpPeerChannel* channel, wStream* s, size_t offset)
 {
-	BYTE* buffer = NULL;
-	UINT32 length = 0;
-
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(channel->vcm);
-	buffer = Buffer;
-	length = Length;
+	WINPR_ASSERT(s);
+
+	Stream_SealLength(s);
+	Stream_SetPosition(s, offset);
 
 	WINPR_ASSERT(channel->channelId <= UINT16_MAX);
 	const UINT16 channelId = (UINT16)channel->channelId;
-	return MessageQueue_Post(channel->vcm->queue, (void*)(UINT_PTR)channelId, 0, (void*)buffer,
-	                         (void*)(UINT_PTR)length);
+	if (!MessageQueue_Post(channel->vcm->queue, (void*)(UINT_PTR)channelId, 0, s, NULL))
+	{
+		Stream_Release(s);
+		return FALSE;
+	}
+	return TRUE;
 }
 
 static unsigned wts_read_variable_uint(wStream* s, int cbLen, UINT32* val)
@@ -143,6 +151,14 @@ static unsigned wts_read_variable_uint(wStream* s, int cbLen, UINT32* val)
 	}
 }
 
+static wStream* wts_stream_take(WTSVirtualChannelManager* vcm, size_t size)
+{
+	WINPR_ASSERT(vcm);
+	if (size > WTS_CHANNEL_POOL_MAX_STREAM_SIZE)
+		return Stream_New(NULL, size);
+	return StreamPool_Take(vcm->streamPool, size);
+}
+
 static BOOL wts_read_drdynvc_capabilities_response(rdpPeerChannel* channel, UINT32 length)
 {
 	UINT16 Version = 0;
@@ -165,8 +181,8 @@ static BOOL wts_read_drdynvc_capabilities_response(rdpPeerChannel* channel, UINT
 	WTSVirtualChannelManager* vcm = channel->vcm;
 	vcm->drdynvc_state = DRDYNVC_STATE_READY;
 
-	/* we only support version 1 for now (no compression yet) */
-	vcm->dvc_spoken_version = MAX(Version, 1);
+	/* version 3 adds compressed data PDUs, we do not offer anything newer */
+	vcm->dvc_spoken_version = MIN(Version, 3);
 
 	return SetEvent(MessageQueue_Event(vcm->queue));
 }
@@ -204,9 +220,34 @@ static BOOL wts_read_drdynvc_create_response(rdpPeerChannel* channel, wStream* s
 	return status;
 }
 
+static BOOL wts_decompress_drdynvc_data(rdpPeerChannel* channel, wStream* s, UINT32 length,
+                                        BYTE** ppData, UINT32* pLength)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(s);
+
+	if (!channel->dvc_decompressor)
+	{
+		channel->dvc_decompressor = zgfx_context_new_ex(FALSE, DRDYNVC_RDP8_LITE_HISTORY_SIZE);
+		if (!channel->dvc_decompressor)
+			return FALSE;
+	}
+
+	if (!drdynvc_decompress_data(channel->dvc_decompressor, Stream_ConstPointer(s), length, ppData,
+	                             pLength))
+	{
+		WLog_ERR(TAG, "ChannelId %" PRIu32 " failed to decompress data", channel->channelId);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static BOOL wts_read_drdynvc_data_first(rdpPeerChannel* channel, wStream* s, int cbLen,
-                                        UINT32 length)
+                                        UINT32 length, BOOL compressed)
 {
+	BYTE* decompressed = NULL;
+
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(s);
 	const UINT32 value = wts_read_variable_uint(s, cbLen, &channel->dvc_total_length);
@@ -218,34 +259,57 @@ static BOOL wts_read_drdynvc_data_first(rdpPeerChannel* channel, wStream* s, int
 	else
 		length -= value;
 
+	const BYTE* data = Stream_ConstPointer(s);
+	if (compressed)
+	{
+		if (!wts_decompress_drdynvc_data(channel, s, length, &decompressed, &length))
+			return FALSE;
+		data = decompressed;
+	}
+
+	BOOL ret = FALSE;
 	if (length > channel->dvc_total_length)
-		return FALSE;
+		goto fail;
 
 	Stream_SetPosition(channel->receiveData, 0);
 
 	if (!Stream_EnsureRemainingCapacity(channel->receiveData, channel->dvc_total_length))
-		return FALSE;
+		goto fail;
 
-	Stream_Write(channel->receiveData, Stream_ConstPointer(s), length);
-	return TRUE;
+	Stream_Write(channel->receiveData, data, length);
+	ret = TRUE;
+fail:
+	free(decompressed);
+	return ret;
 }
 
-static BOOL wts_read_drdynvc_data(rdpPeerChannel* channel, wStream* s, UINT32 length)
+static BOOL wts_read_drdynvc_data(rdpPeerChannel* channel, wStream* s, UINT32 length,
+                                  BOOL compressed)
 {
 	BOOL ret = FALSE;
+	BYTE* decompressed = NULL;
 
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(s);
+
+	const BYTE* data = Stream_ConstPointer(s);
+	if (compressed)
+	{
+		if (!wts_decompress_drdynvc_data(channel, s, length, &decompressed, &length))
+			return FALSE;
+		data = decompressed;
+	}
+
 	if (channel->dvc_total_length > 0)
 	{
 		if (Stream_GetPosition(channel->receiveData) + length > channel->dvc_total_length)
 		{
 			channel->dvc_total_length = 0;
 			WLog_ERR(TAG, "incorrect fragment data, discarded.");
-			return FALSE;
+			goto fail;
 		}
 
-		Stream_Write(channel->receiveData, Stream_ConstPointer(s), length);
+		Stream_Write(channel->receiveData, data, length);
 
 		if (Stream_GetPosition(channel->receiveData) >= channel->dvc_total_length)
 		{
@@ -258,9 +322,11 @@ static BOOL wts_read_drdynvc_data(rdpPeerChannel* channel, wStream* s, UINT32 le
 	}
 	else
 	{
-		ret = wts_queue_receive_data(channel, Stream_ConstPointer(s), length);
+		ret = wts_queue_receive_data(channel, data, length);
 	}
 
+fail:
+	free(decompressed);
 	return ret;
 }
 
@@ -345,7 +411,8 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 					return TRUE;
 				}
 
-				return wts_read_drdynvc_data_first(dvc, channel->receiveData, Sp, (UINT32)length);
+				return wts_read_drdynvc_data_first(dvc, channel->receiveData, Sp, (UINT32)length,
+				                                   FALSE);
 
 			case DATA_PDU:
 				if (dvc->dvc_open_state != DVC_OPEN_STATE_SUCCEEDED)
@@ -357,16 +424,36 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 					return TRUE;
 				}
 
-				return wts_read_drdynvc_data(dvc, channel->receiveData, (UINT32)length);
+				return wts_read_drdynvc_data(dvc, channel->receiveData, (UINT32)length, FALSE);
 
 			case CLOSE_REQUEST_PDU:
 				wts_read_drdynvc_close_response(dvc);
 				break;
 
 			case DATA_FIRST_COMPRESSED_PDU:
+				if (dvc->dvc_open_state != DVC_OPEN_STATE_SUCCEEDED)
+				{
+					WLog_ERR(TAG,
+					         "ChannelId %" PRIu32 " did not open successfully. "
+					         "Ignoring DYNVC_DATA_FIRST_COMPRESSED PDU",
+					         ChannelId);
+					return TRUE;
+				}
+
+				return wts_read_drdynvc_data_first(dvc, channel->receiveData, Sp, (UINT32)length,
+				                                   TRUE);
+
 			case DATA_COMPRESSED_PDU:
-				WLog_ERR(TAG, "Compressed data not handled");
-				break;
+				if (dvc->dvc_open_state != DVC_OPEN_STATE_SUCCEEDED)
+				{
+					WLog_ERR(TAG,
+					         "ChannelId %" PRIu32 " did not open successfully. "
+					         "Ignoring DYNVC_DATA_COMPRESSED PDU",
+					         ChannelId);
+					return TRUE;
+				}
+
+				return wts_read_drdynvc_data(dvc, channel->receiveData, (UINT32)length, TRUE);
 
 			case SOFT_SYNC_RESPONSE_PDU:
 				WLog_ERR(TAG, "SoftSync response not handled yet(and rather strange to receive "
@@ -581,9 +668,13 @@ BOOL WTSVirtualChannelManagerOpen(HANDLE hServer)
 			vcm->dvc_spoken_version = 1;
 			Stream_Write_UINT8(s, 0x50);    /* Cmd=5 sp=0 cbId=0 */
 			Stream_Write_UINT8(s, 0x00);    /* Pad */
-			Stream_Write_UINT16(s, 0x0001); /* Version */
+			Stream_Write_UINT16(s, 0x0003); /* Version */
 
-			/* TODO: shall implement version 2 and 3 */
+			/* Priority charges as sent by Windows servers, we do not prioritize channels */
+			Stream_Write_UINT16(s, 0x03a8); /* PriorityCharge0 */
+			Stream_Write_UINT16(s, 0x0ccc); /* PriorityCharge1 */
+			Stream_Write_UINT16(s, 0x2492); /* PriorityCharge2 */
+			Stream_Write_UINT16(s, 0x4924); /* PriorityCharge3 */
 
 			const size_t pos = Stream_GetPosition(s);
 			WINPR_ASSERT(pos <= UINT32_MAX);
@@ -613,28 +704,51 @@ BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen
 			return FALSE;
 	}
 
+	/* the (mostly small) channel PDUs are sent in as few TLS records as possible */
+	WINPR_ASSERT(vcm->rdp);
+	transport_cork(vcm->rdp->transport);
+
 	while (MessageQueue_Peek(vcm->queue, &message, TRUE))
 	{
-		BYTE* buffer = NULL;
-		UINT32 length = 0;
-		UINT16 channelId = 0;
-		channelId = (UINT16)(UINT_PTR)message.context;
-		buffer = (BYTE*)message.wParam;
-		length = (UINT32)(UINT_PTR)message.lParam;
+		const UINT16 channelId = (UINT16)(UINT_PTR)message.context;
+		wStream* s = (wStream*)message.wParam;
+		wStream* hs = (wStream*)message.lParam;
 
-		WINPR_ASSERT(vcm->client);
-		WINPR_ASSERT(vcm->client->SendChannelData);
-		if (!vcm->client->SendChannelData(vcm->client, channelId, buffer, length))
+		WINPR_ASSERT(s);
+		if (hs)
 		{
-			status = FALSE;
+			/* a DVC fragment, its own header followed by the next message.id bytes of s */
+			const size_t length = message.id;
+			if (!Stream_CheckAndLogRequiredLength(TAG, s, length) ||
+			    !freerdp_channel_send_with_header(vcm->rdp, channelId, Stream_ConstBuffer(hs),
+			                                      Stream_Length(hs), Stream_ConstPointer(s),
+			                                      length))
+				status = FALSE;
+			else
+				Stream_Seek(s, length);
+
+			Stream_Release(hs);
+		}
+		else
+		{
+			WINPR_ASSERT(vcm->client);
+			WINPR_ASSERT(vcm->client->SendChannelData);
+			if (!vcm->client->SendChannelData(vcm->client, channelId, Stream_ConstPointer(s),
+			                                  Stream_GetRemainingLength(s)))
+			{
+				status = FALSE;
+			}
 		}
 
-		free(buffer);
+		Stream_Release(s);
 
 		if (!status)
 			break;
 	}
 
+	if (!transport_uncork(vcm->rdp->transport))
+		status = FALSE;
+
 	return status;
 }
 
@@ -970,13 +1084,10 @@ static void wts_virtual_channel_manager_free_message(void* obj)
 {
 	wMessage* msg = (wMessage*)obj;
 
-	if (msg)
-	{
-		BYTE* buffer = (BYTE*)msg->wParam;
-
-		if (buffer)
-			free(buffer);
-	}
+	if (msg && msg->wParam)
+		Stream_Release((wStream*)msg->wParam);
+	if (msg && msg->lParam)
+		Stream_Release((wStream*)msg->lParam);
 }
 
 static void channel_free(rdpPeerChannel* channel)
@@ -1050,6 +1161,11 @@ HANDLE WINAPI FreeRDP_WTSOpenServerA(LPSTR pServerName)
 	if (!vcm->queue)
 		goto error_queue;
 
+	vcm->streamPool = StreamPool_New(TRUE, DVC_MAX_DATA_PDU_SIZE);
+
+	if (!vcm->streamPool)
+		goto error_streamPool;
+
 	vcm->dvc_channel_id_seq = 0;
 	vcm->dynamicVirtualChannels = HashTable_New(TRUE);
 
@@ -1074,6 +1190,8 @@ HANDLE WINAPI FreeRDP_WTSOpenServerA(LPSTR pServerName)
 error_hashFunction:
 	HashTable_Free(vcm->dynamicVirtualChannels);
 error_dynamicVirtualChannels:
+	StreamPool_Free(vcm->streamPool);
+error_streamPool:
 	MessageQueue_Free(vcm->queue);
 error_queue:
 	HashTable_Remove(g_ServerHandles, (void*)(UINT_PTR)vcm->SessionId);
@@ -1113,6 +1231,7 @@ VOID WINAPI FreeRDP_WTSCloseServer(HANDLE hServer)
 		}
 
 		MessageQueue_Free(vcm->queue);
+		StreamPool_Free(vcm->streamPool);
 		free(vcm);
 	}
 }
@@ -1501,6 +1620,10 @@ HANDLE WINAPI FreeRDP_WTSVirtualChannelOpenEx(DWORD SessionId, LPSTR pVirtualNam
 		return NULL;
 	}
 
+	channel->dvc_compress =
+	    ((flags & WTS_CHANNEL_OPTION_DYNAMIC_NO_COMPRESS) == 0) &&
+	    freerdp_settings_get_bool(client->context->settings, FreeRDP_DynamicChannelCompression);
+
 	const LONG hdl = InterlockedIncrement(&vcm->dvc_channel_id_seq);
 	channel->channelId = WINPR_ASSERTING_INT_CAST(uint32_t, hdl);
 
@@ -1638,15 +1761,167 @@ BOOL WINAPI FreeRDP_WTSVirtualChannelRead(HANDLE hChannelHandle, WINPR_ATTR_UNUS
 	return TRUE;
 }
 
+/* Compressed PDUs need a client speaking version 3 */
+static BOOL wts_dvc_compress(const rdpPeerChannel* channel)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->vcm);
+	return channel->dvc_compress && (channel->vcm->dvc_spoken_version >= 3);
+}
+
+static BOOL wts_dvc_ready(const rdpPeerChannel* channel)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->vcm);
+	if (!channel->vcm->drdynvc_channel || (channel->vcm->drdynvc_state != DRDYNVC_STATE_READY))
+	{
+		DEBUG_DVC("drdynvc not ready");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Splits the data in DATA_FIRST/DATA PDUs, each fragment is a pooled stream */
+static BOOL wts_write_dvc_fragments(rdpPeerChannel* channel, const BYTE* Buffer, size_t Length)
+{
+	BOOL first = TRUE;
+	WTSVirtualChannelManager* vcm = channel->vcm;
+
+	const BOOL compress = wts_dvc_compress(channel);
+	if (compress && !channel->dvc_compressor)
+	{
+		channel->dvc_compressor = zgfx_context_new_ex(TRUE, DRDYNVC_RDP8_LITE_HISTORY_SIZE);
+		if (!channel->dvc_compressor)
+		{
+			SetLastError(g_err_oom);
+			return FALSE;
+		}
+	}
+
+	while (Length > 0)
+	{
+		int cbLen = 0;
+		wStream* s = StreamPool_Take(vcm->streamPool, DVC_MAX_DATA_PDU_SIZE);
+
+		if (!s)
+		{
+			WLog_ERR(TAG, "StreamPool_Take failed!");
+			SetLastError(g_err_oom);
+			return FALSE;
+		}
+
+		BYTE Cmd = compress ? DATA_COMPRESSED_PDU : DATA_PDU;
+		Stream_Seek_UINT8(s);
+		const int cbChId = wts_write_variable_uint(s, channel->channelId);
+
+		/* pooled streams might be larger, the PDU size is fixed */
+		size_t written = compress ? DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE
+		                          : DVC_MAX_DATA_PDU_SIZE - Stream_GetPosition(s);
+		if (first && (Length > written))
+		{
+			cbLen = wts_write_variable_uint(s, WINPR_ASSERTING_INT_CAST(uint32_t, Length));
+			Cmd = compress ? DATA_FIRST_COMPRESSED_PDU : DATA_FIRST_PDU;
+			if (!compress)
+				written = DVC_MAX_DATA_PDU_SIZE - Stream_GetPosition(s);
+		}
+
+		first = FALSE;
+
+		if (written > Length)
+			written = Length;
+
+		if (compress)
+		{
+			if (!drdynvc_compress_data(channel->dvc_compressor, s, Buffer, written))
+			{
+				Stream_Release(s);
+				return FALSE;
+			}
+		}
+		else
+			Stream_Write(s, Buffer, written);
+
+		Stream_Buffer(s)[0] = ((Cmd << 4) | (cbLen << 2) | cbChId) & 0xFF;
+		Length -= written;
+		Buffer += written;
+		if (!wts_queue_send_item(vcm->drdynvc_channel, s, 0))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Queues DATA_FIRST/DATA PDUs for the payload of s, only the fragment headers are written,
+ * every fragment references its part of s. The queue owns s. */
+static BOOL wts_queue_dvc_fragments(rdpPeerChannel* channel, wStream* s, size_t offset,
+                                    size_t length)
+{
+	WTSVirtualChannelManager* vcm = channel->vcm;
+	BYTE first[WTS_CHANNEL_STREAM_HEADROOM] = { 0 };
+	BYTE header[WTS_CHANNEL_STREAM_HEADROOM] = { 0 };
+	wStream fbuffer = { 0 };
+	wStream hbuffer = { 0 };
+	wStream* fhs = Stream_StaticInit(&fbuffer, first, sizeof(first));
+	wStream* hs = Stream_StaticInit(&hbuffer, header, sizeof(header));
+
+	WINPR_ASSERT(fhs);
+	WINPR_ASSERT(hs);
+	WINPR_ASSERT(length <= UINT32_MAX);
+	Stream_Seek_UINT8(fhs);
+	const int cbChId = wts_write_variable_uint(fhs, channel->channelId);
+	const int cbLen = wts_write_variable_uint(fhs, (UINT32)length);
+	first[0] = ((DATA_FIRST_PDU << 4) | (cbLen << 2) | cbChId) & 0xFF;
+	wts_write_drdynvc_header(hs, DATA_PDU, channel->channelId);
+
+	const size_t firstChunk = DVC_MAX_DATA_PDU_SIZE - Stream_GetPosition(fhs);
+	const size_t chunk = DVC_MAX_DATA_PDU_SIZE - Stream_GetPosition(hs);
+	WINPR_ASSERT(length > firstChunk);
+	const size_t count = 1 + (length - firstChunk + chunk - 1) / chunk;
+
+	/* the sender releases fragments concurrently, take all references up front */
+	for (size_t x = 1; x < count; x++)
+		Stream_AddRef(s);
+
+	Stream_SealLength(s);
+	Stream_SetPosition(s, offset);
+
+	WINPR_ASSERT(vcm->drdynvc_channel);
+	WINPR_ASSERT(vcm->drdynvc_channel->channelId <= UINT16_MAX);
+	const UINT16 channelId = (UINT16)vcm->drdynvc_channel->channelId;
+
+	size_t x = 0;
+	for (; x < count; x++)
+	{
+		const wStream* cur = (x == 0) ? fhs : hs;
+		const size_t written = MIN((x == 0) ? firstChunk : chunk, length);
+		wStream* fs = StreamPool_Take(vcm->streamPool, WTS_CHANNEL_STREAM_HEADROOM);
+
+		if (!fs)
+		{
+			SetLastError(g_err_oom);
+			break;
+		}
+
+		Stream_Write(fs, Stream_ConstBuffer(cur), Stream_GetPosition(cur));
+		Stream_SealLength(fs);
+
+		/* message.id carries the number of payload bytes of this fragment */
+		if (!MessageQueue_Post(vcm->queue, (void*)(UINT_PTR)channelId, (UINT32)written, s, fs))
+		{
+			Stream_Release(fs);
+			break;
+		}
+		length -= written;
+	}
+
+	for (size_t y = x; y < count; y++)
+		Stream_Release(s);
+	return x == count;
+}
+
 BOOL WINAPI FreeRDP_WTSVirtualChannelWrite(HANDLE hChannelHandle, PCHAR Buffer, ULONG uLength,
                                            PULONG pBytesWritten)
 {
-	wStream* s = NULL;
-	int cbLen = 0;
-	int cbChId = 0;
-	int first = 0;
-	BYTE* buffer = NULL;
-	size_t totalWritten = 0;
 	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
 	BOOL ret = FALSE;
 
@@ -1657,79 +1932,122 @@ BOOL WINAPI FreeRDP_WTSVirtualChannelWrite(HANDLE hChannelHandle, PCHAR Buffer,
 	WINPR_ASSERT(channel->vcm);
 	if (channel->channelType == RDP_PEER_CHANNEL_TYPE_SVC)
 	{
-		buffer = (BYTE*)malloc(uLength);
+		wStream* s = wts_stream_take(channel->vcm, uLength);
 
-		if (!buffer)
+		if (!s)
 		{
 			SetLastError(g_err_oom);
 			goto fail;
 		}
 
-		CopyMemory(buffer, Buffer, uLength);
-		totalWritten = uLength;
-		if (!wts_queue_send_item(channel, buffer, uLength))
+		Stream_Write(s, Buffer, uLength);
+		if (!wts_queue_send_item(channel, s, 0))
 			goto fail;
 	}
-	else if (!channel->vcm->drdynvc_channel || (channel->vcm->drdynvc_state != DRDYNVC_STATE_READY))
-	{
-		DEBUG_DVC("drdynvc not ready");
+	else if (!wts_dvc_ready(channel))
 		goto fail;
-	}
-	else
+	else if (!wts_write_dvc_fragments(channel, (const BYTE*)Buffer, uLength))
+		goto fail;
+
+	if (pBytesWritten)
+		*pBytesWritten = uLength;
+
+	ret = TRUE;
+fail:
+	LeaveCriticalSection(&channel->writeLock);
+	return ret;
+}
+
+wStream* WTSVirtualChannelStreamNew(HANDLE hChannelHandle, size_t size)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+
+	if (!channel || (size > SIZE_MAX - WTS_CHANNEL_STREAM_HEADROOM))
+		return NULL;
+
+	WINPR_ASSERT(channel->vcm);
+	wStream* s = wts_stream_take(channel->vcm, size + WTS_CHANNEL_STREAM_HEADROOM);
+
+	if (!s)
 	{
-		first = TRUE;
+		SetLastError(g_err_oom);
+		return NULL;
+	}
 
-		size_t Length = uLength;
-		while (Length > 0)
-		{
-			s = Stream_New(NULL, DVC_MAX_DATA_PDU_SIZE);
+	Stream_Seek(s, WTS_CHANNEL_STREAM_HEADROOM);
+	return s;
+}
 
-			if (!s)
-			{
-				WLog_ERR(TAG, "Stream_New failed!");
-				SetLastError(g_err_oom);
-				goto fail;
-			}
+BOOL WTSVirtualChannelWriteStream(HANDLE hChannelHandle, wStream* s, PULONG pBytesWritten)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+	BOOL ret = FALSE;
 
-			buffer = Stream_Buffer(s);
-			Stream_Seek_UINT8(s);
-			cbChId = wts_write_variable_uint(s, channel->channelId);
+	if (!s)
+		return FALSE;
 
-			if (first && (Length > Stream_GetRemainingLength(s)))
-			{
-				cbLen = wts_write_variable_uint(s, WINPR_ASSERTING_INT_CAST(uint32_t, Length));
-				buffer[0] = ((DATA_FIRST_PDU << 4) | (cbLen << 2) | cbChId) & 0xFF;
-			}
-			else
-			{
-				buffer[0] = ((DATA_PDU << 4) | cbChId) & 0xFF;
-			}
+	const size_t end = Stream_GetPosition(s);
+	if (!channel || (end < WTS_CHANNEL_STREAM_HEADROOM) ||
+	    (end - WTS_CHANNEL_STREAM_HEADROOM > UINT32_MAX))
+	{
+		Stream_Release(s);
+		return FALSE;
+	}
+
+	const size_t length = end - WTS_CHANNEL_STREAM_HEADROOM;
 
-			first = FALSE;
-			size_t written = Stream_GetRemainingLength(s);
+	EnterCriticalSection(&channel->writeLock);
+	WINPR_ASSERT(channel->vcm);
+	if (channel->channelType == RDP_PEER_CHANNEL_TYPE_SVC)
+	{
+		/* static channels are fragmented by the MCS layer, the stream is queued as it is */
+		ret = wts_queue_send_item(channel, s, WTS_CHANNEL_STREAM_HEADROOM);
+		s = NULL;
+		if (!ret)
+			goto fail;
+	}
+	else if (!wts_dvc_ready(channel))
+		goto fail;
+	else if (length > 0)
+	{
+		BYTE header[WTS_CHANNEL_STREAM_HEADROOM] = { 0 };
+		wStream sbuffer = { 0 };
+		wStream* hs = Stream_StaticInit(&sbuffer, header, sizeof(header));
 
-			if (written > Length)
-				written = Length;
+		WINPR_ASSERT(hs);
+		wts_write_drdynvc_header(hs, DATA_PDU, channel->channelId);
+		const size_t hlen = Stream_GetPosition(hs);
 
-			Stream_Write(s, Buffer, written);
-			const size_t length = Stream_GetPosition(s);
-			Stream_Free(s, FALSE);
-			if (length > UINT32_MAX)
+		/* a single uncompressed PDU gets its header in front of the payload */
+		if (!wts_dvc_compress(channel) && (hlen + length <= DVC_MAX_DATA_PDU_SIZE))
+		{
+			const size_t offset = WTS_CHANNEL_STREAM_HEADROOM - hlen;
+			memcpy(Stream_Buffer(s) + offset, header, hlen);
+			ret = wts_queue_send_item(channel->vcm->drdynvc_channel, s, offset);
+			s = NULL;
+			if (!ret)
 				goto fail;
-			Length -= written;
-			Buffer += written;
-			totalWritten += written;
-			if (!wts_queue_send_item(channel->vcm->drdynvc_channel, buffer, (UINT32)length))
+		}
+		else if (!wts_dvc_compress(channel))
+		{
+			ret = wts_queue_dvc_fragments(channel, s, WTS_CHANNEL_STREAM_HEADROOM, length);
+			s = NULL;
+			if (!ret)
 				goto fail;
 		}
+		else if (!wts_write_dvc_fragments(channel,
+		                                   Stream_Buffer(s) + WTS_CHANNEL_STREAM_HEADROOM, length))
+			goto fail;
 	}
 
 	if (pBytesWritten)
-		*pBytesWritten = WINPR_ASSERTING_INT_CAST(uint32_t, totalWritten);
+		*pBytesWritten = (ULONG)length;
 
 	ret = TRUE;
 fail:
 	LeaveCriticalSection(&channel->writeLock);
+	if (s)
+		Stream_Release(s);
 	return ret;
 }
 
@@ -2092,6 +2410,8 @@ void server_channel_common_free(rdpPeerChannel* channel)
 		return;
 	MessageQueue_Free(channel->queue);
 	Stream_Free(channel->receiveData, TRUE);
+	zgfx_context_free(channel->dvc_compressor);
+	zgfx_context_free(channel->dvc_decompressor);
 	DeleteCriticalSection(&channel->writeLock);
 	free(channel);
 }
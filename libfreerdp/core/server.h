@@ -24,6 +24,7 @@
 #include <freerdp/freerdp.h>
 #include <freerdp/api.h>
 #include <freerdp/channels/wtsvc.h>
+#include <freerdp/codec/zgfx.h>
 
 #include <winpr/synch.h>
 #include <winpr/stream.h>
@@ -66,6 +67,9 @@ struct rdp_peer_channel
 	BYTE dvc_open_state;
 	INT32 creationStatus;
 	UINT32 dvc_total_length;
+	BOOL dvc_compress;
+	ZGFX_CONTEXT* dvc_compressor;
+	ZGFX_CONTEXT* dvc_decompressor;
 	rdpMcsChannel* mcsChannel;
 
 	char channelName[128];
@@ -79,6 +83,7 @@ struct WTSVirtualChannelManager
 
 	DWORD SessionId;
 	wMessageQueue* queue;
+	wStreamPool* streamPool;
 
 	rdpPeerChannel* drdynvc_channel;
 	BYTE drdynvc_state;
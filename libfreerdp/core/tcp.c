@@ -303,6 +303,16 @@ static long transport_bio_simple_ctrl(BIO* bio, int cmd, long arg1, void* arg2)
 		}
 		break;
 
+		case BIO_C_SET_WRITE_EVENT:
+		{
+			/* writability is only of interest while output is pending */
+			const LONG events = FD_READ | FD_ACCEPT | FD_CLOSE | (arg1 ? FD_WRITE : 0);
+
+			if (!BIO_get_init(bio) || WSAEventSelect(ptr->socket, ptr->hEvent, events))
+				return 0;
+			return 1;
+		}
+
 		case BIO_C_SET_FD:
 			if (arg2)
 			{
@@ -453,6 +463,7 @@ typedef struct
 	BIO* bufferedBio;
 	BOOL readBlocked;
 	BOOL writeBlocked;
+	BOOL writeEvent;
 	RingBuffer xmitBuffer;
 } WINPR_BIO_BUFFERED_SOCKET;
 
@@ -521,6 +532,13 @@ static int transport_bio_buffered_write(BIO* bio, const char* buf, int num)
 
 out:
 	ringbuffer_commit_read_bytes(&ptr->xmitBuffer, committedBytes);
+
+	/* let the event loop know when the rest can be sent instead of waiting for the next write */
+	if (ptr->writeBlocked != ptr->writeEvent)
+	{
+		if (BIO_set_write_event(next_bio, ptr->writeBlocked) > 0)
+			ptr->writeEvent = ptr->writeBlocked;
+	}
 	return ret;
 }
 
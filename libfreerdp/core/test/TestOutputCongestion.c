@@ -0,0 +1,226 @@
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
+#include <winpr/sysinfo.h>
+
+#include "test_loopback.h"
+
+/* A client that stops reading makes the output of its peer pile up. The peer has to report the
+ * backlog and the congestion, recover once the client reads again and drop the client if it
+ * does not drain the backlog in time instead of blocking the writer forever. */
+
+#define TEST_ACK_TIMEOUT 500
+#define TEST_BITMAP_SIZE 64
+#define TEST_MAX_UPDATES 100000
+
+typedef struct
+{
+	rdpContext context;
+	HANDLE stop;
+	LONG connected;
+	LONG reading;
+} test_client_context;
+
+/* accepts the client and runs its peer until activation, the test drives it afterwards */
+static DWORD WINAPI test_server_thread(LPVOID arg)
+{
+	test_loopback_server* server = arg;
+
+	if (!test_loopback_server_accept(server))
+		return 1;
+
+	freerdp_peer* peer = server->peer;
+	rdpSettings* settings = peer->context->settings;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_WaitForOutputBufferFlush, FALSE) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpAckTimeout, TEST_ACK_TIMEOUT) ||
+	    !peer->Initialize(peer))
+		return 1;
+
+	while (!InterlockedCompareExchange(&server->activated, 0, 0))
+	{
+		if (WaitForSingleObject(server->stop, 0) == WAIT_OBJECT_0)
+			return 1;
+		if (!test_loopback_peer_check(peer, NULL, 100))
+			return 1;
+	}
+	return 0;
+}
+
+static BOOL test_client_bitmap(rdpContext* context, const BITMAP_UPDATE* bitmap)
+{
+	WINPR_UNUSED(context);
+	WINPR_UNUSED(bitmap);
+	return TRUE;
+}
+
+static BOOL test_client_post_connect(freerdp* instance)
+{
+	instance->context->update->BitmapUpdate = test_client_bitmap;
+	return TRUE;
+}
+
+static DWORD WINAPI test_client_thread(LPVOID arg)
+{
+	freerdp* instance = arg;
+	test_client_context* tc = (test_client_context*)instance->context;
+
+	if (!freerdp_connect(instance))
+		return 1;
+
+	(void)InterlockedExchange(&tc->reading, 1);
+	(void)InterlockedIncrement(&tc->connected);
+	while (WaitForSingleObject(tc->stop, 0) != WAIT_OBJECT_0)
+	{
+		/* a client that stopped reading leaves everything in the socket */
+		if (!InterlockedCompareExchange(&tc->reading, 0, 0))
+		{
+			Sleep(10);
+			continue;
+		}
+
+		if (!test_loopback_client_check(instance, tc->stop, 100))
+			break;
+	}
+
+	(void)freerdp_disconnect(instance);
+	return 0;
+}
+
+static BOOL test_send(freerdp_peer* peer, BYTE* data)
+{
+	BITMAP_DATA rect = { .destRight = TEST_BITMAP_SIZE - 1,
+		                 .destBottom = TEST_BITMAP_SIZE - 1,
+		                 .width = TEST_BITMAP_SIZE,
+		                 .height = TEST_BITMAP_SIZE,
+		                 .bitsPerPixel = 32,
+		                 .bitmapLength = TEST_BITMAP_SIZE * TEST_BITMAP_SIZE * 4,
+		                 .bitmapDataStream = data };
+	const BITMAP_UPDATE bitmap = { .number = 1, .rectangles = &rect, .skipCompression = TRUE };
+	rdpUpdate* update = peer->context->update;
+
+	return update->BitmapUpdate(peer->context, &bitmap);
+}
+
+/* a client that does not read makes the output queue up until the peer reports congestion */
+static BOOL test_congestion(freerdp_peer* peer, BYTE* data)
+{
+	for (size_t x = 0; x < TEST_MAX_UPDATES; x++)
+	{
+		if (freerdp_peer_is_output_congested(peer))
+			return freerdp_peer_get_output_queue_depth(peer) > 0;
+		if (!test_send(peer, data))
+			return FALSE;
+	}
+
+	printf("%s: no congestion, depth %" PRIuz "\n", __func__,
+	       freerdp_peer_get_output_queue_depth(peer));
+	return FALSE;
+}
+
+/* once the client reads again the queue drains while the peer is checked */
+static BOOL test_drain(freerdp_peer* peer)
+{
+	const UINT64 end = GetTickCount64() + TEST_LOOPBACK_TIMEOUT;
+
+	while (freerdp_peer_is_output_congested(peer) ||
+	       (freerdp_peer_get_output_queue_depth(peer) > 0))
+	{
+		if (GetTickCount64() > end)
+		{
+			printf("%s: still queued %" PRIuz "\n", __func__,
+			       freerdp_peer_get_output_queue_depth(peer));
+			return FALSE;
+		}
+		if (!test_loopback_peer_check(peer, NULL, 100))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the writer gives up on a client that does not drain the queue, it does not hang */
+static BOOL test_drop(freerdp_peer* peer, BYTE* data)
+{
+	const UINT64 start = GetTickCount64();
+
+	for (size_t x = 0; x < TEST_MAX_UPDATES; x++)
+	{
+		if (!test_send(peer, data))
+		{
+			const UINT64 diff = GetTickCount64() - start;
+			if (diff > TEST_LOOPBACK_TIMEOUT)
+			{
+				printf("%s: dropping took %" PRIu64 " ms\n", __func__, diff);
+				return FALSE;
+			}
+			return TRUE;
+		}
+	}
+
+	printf("%s: client never dropped\n", __func__);
+	return FALSE;
+}
+
+int TestOutputCongestion(int argc, char* argv[])
+{
+	int rc = -1;
+	test_loopback_server server = { 0 };
+	freerdp* instance = NULL;
+	HANDLE stop = NULL;
+	HANDLE thread = NULL;
+	BYTE* data = NULL;
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	data = calloc(TEST_BITMAP_SIZE * TEST_BITMAP_SIZE, 4);
+	stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!data || !stop || !test_loopback_server_open(&server, stop))
+		goto fail;
+
+	server.thread = CreateThread(NULL, 0, test_server_thread, &server, 0, NULL);
+	instance = test_loopback_client_new(sizeof(test_client_context), test_client_post_connect,
+	                                    server.port);
+	if (!server.thread || !instance)
+		goto fail;
+
+	test_client_context* tc = (test_client_context*)instance->context;
+	tc->stop = stop;
+	thread = CreateThread(NULL, 0, test_client_thread, instance, 0, NULL);
+	if (!thread)
+		goto fail;
+
+	DWORD status = 1;
+	if (!test_loopback_wait(&tc->connected, 1) ||
+	    (WaitForSingleObject(server.thread, TEST_LOOPBACK_TIMEOUT) != WAIT_OBJECT_0) ||
+	    !GetExitCodeThread(server.thread, &status) || (status != 0))
+		goto fail;
+
+	(void)InterlockedExchange(&tc->reading, 0);
+	if (!test_congestion(server.peer, data))
+		goto fail;
+
+	(void)InterlockedExchange(&tc->reading, 1);
+	if (!test_drain(server.peer))
+		goto fail;
+
+	(void)InterlockedExchange(&tc->reading, 0);
+	if (!test_drop(server.peer, data))
+		goto fail;
+
+	rc = 0;
+fail:
+	if (stop)
+		(void)SetEvent(stop);
+	if (thread)
+	{
+		(void)WaitForSingleObject(thread, INFINITE);
+		(void)CloseHandle(thread);
+	}
+	test_loopback_client_free(instance);
+	test_loopback_server_free(&server);
+	if (stop)
+		(void)CloseHandle(stop);
+	free(data);
+	return rc;
+}
@@ -0,0 +1,317 @@
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
+#include <winpr/sysinfo.h>
+
+#include "test_loopback.h"
+
+/* Relays graphics updates undecoded through two connection legs, the way freerdp-proxy does:
+ *
+ *   server A -> client B (RawUpdate) -> server C -> client D
+ *
+ * B must never decode an update, D must get what A sent. */
+
+#define TEST_BITMAP_SIZE 4
+#define TEST_POINTER_X 123
+#define TEST_POINTER_Y 45
+#define TEST_POINTER_INDEX 3
+#define TEST_RECT_COLOR 0x123456
+
+typedef struct
+{
+	test_loopback_server base;
+	BOOL send;
+	LONG sent;
+} test_server;
+
+typedef struct
+{
+	rdpContext context;
+	struct test_chain* chain;
+	BOOL relay;
+} test_client_context;
+
+typedef struct
+{
+	freerdp* instance;
+	HANDLE thread;
+	LONG connected;
+} test_client;
+
+typedef struct test_chain
+{
+	HANDLE stop;
+	test_server a;
+	test_client b;
+	test_server c;
+	test_client d;
+	LONG relayed;
+	LONG decoded;
+	LONG position;
+	LONG system;
+	LONG cached;
+	LONG bitmap;
+	LONG rect;
+	BYTE data[TEST_BITMAP_SIZE * TEST_BITMAP_SIZE * 4];
+} test_chain;
+
+static BOOL test_server_send(rdpContext* context, const BYTE* data)
+{
+	const POINTER_POSITION_UPDATE position = { .xPos = TEST_POINTER_X, .yPos = TEST_POINTER_Y };
+	const POINTER_SYSTEM_UPDATE system = { .type = SYSPTR_NULL };
+	const POINTER_CACHED_UPDATE cached = { .cacheIndex = TEST_POINTER_INDEX };
+	BITMAP_DATA rect = { .destRight = TEST_BITMAP_SIZE - 1,
+		                 .destBottom = TEST_BITMAP_SIZE - 1,
+		                 .width = TEST_BITMAP_SIZE,
+		                 .height = TEST_BITMAP_SIZE,
+		                 .bitsPerPixel = 32,
+		                 .bitmapLength = TEST_BITMAP_SIZE * TEST_BITMAP_SIZE * 4,
+		                 .bitmapDataStream = WINPR_CAST_CONST_PTR_AWAY(data, BYTE*) };
+	const BITMAP_UPDATE bitmap = { .number = 1, .rectangles = &rect, .skipCompression = TRUE };
+	/* the second order only differs in the color, the receiver needs the state of the first */
+	const OPAQUE_RECT_ORDER first = {
+		.nLeftRect = 1, .nTopRect = 2, .nWidth = 3, .nHeight = 4, .color = 0
+	};
+	OPAQUE_RECT_ORDER second = first;
+	second.color = TEST_RECT_COLOR;
+	rdpUpdate* update = context->update;
+
+	return update->pointer->PointerPosition(context, &position) &&
+	       update->pointer->PointerSystem(context, &system) &&
+	       update->pointer->PointerCached(context, &cached) &&
+	       update->BitmapUpdate(context, &bitmap) && update->BeginPaint(context) &&
+	       update->primary->OpaqueRect(context, &first) &&
+	       update->primary->OpaqueRect(context, &second) && update->EndPaint(context);
+}
+
+static DWORD WINAPI test_server_thread(LPVOID arg)
+{
+	test_server* server = arg;
+	BYTE data[TEST_BITMAP_SIZE * TEST_BITMAP_SIZE * 4] = { 0 };
+
+	for (size_t x = 0; x < sizeof(data); x++)
+		data[x] = (BYTE)x;
+
+	if (!test_loopback_server_accept(&server->base))
+		return 1;
+
+	freerdp_peer* peer = server->base.peer;
+	if (!peer->Initialize(peer))
+		return 1;
+
+	while (WaitForSingleObject(server->base.stop, 0) != WAIT_OBJECT_0)
+	{
+		if (!test_loopback_peer_check(peer, server->base.stop, 100))
+			break;
+
+		if (server->send && InterlockedCompareExchange(&server->base.activated, 0, 0) &&
+		    !InterlockedCompareExchange(&server->sent, 1, 0))
+		{
+			if (!test_server_send(peer->context, data))
+				break;
+		}
+	}
+	return 0;
+}
+
+static BOOL test_relay_update(rdpContext* context, BYTE updateCode, wStream* s)
+{
+	test_client_context* tc = (test_client_context*)context;
+	freerdp_peer* peer = tc->chain->c.base.peer;
+
+	(void)InterlockedIncrement(&tc->chain->relayed);
+	return peer->context->update->RawUpdate(peer->context, updateCode, s);
+}
+
+static BOOL test_decoded_position(rdpContext* context, const POINTER_POSITION_UPDATE* pointer)
+{
+	test_client_context* tc = (test_client_context*)context;
+
+	if (tc->relay)
+		(void)InterlockedIncrement(&tc->chain->decoded);
+	else if (pointer->xPos == TEST_POINTER_X && pointer->yPos == TEST_POINTER_Y)
+		(void)InterlockedIncrement(&tc->chain->position);
+	return TRUE;
+}
+
+static BOOL test_decoded_system(rdpContext* context, const POINTER_SYSTEM_UPDATE* pointer)
+{
+	test_client_context* tc = (test_client_context*)context;
+
+	if (tc->relay)
+		(void)InterlockedIncrement(&tc->chain->decoded);
+	else if (pointer->type == SYSPTR_NULL)
+		(void)InterlockedIncrement(&tc->chain->system);
+	return TRUE;
+}
+
+static BOOL test_decoded_cached(rdpContext* context, const POINTER_CACHED_UPDATE* pointer)
+{
+	test_client_context* tc = (test_client_context*)context;
+
+	if (tc->relay)
+		(void)InterlockedIncrement(&tc->chain->decoded);
+	else if (pointer->cacheIndex == TEST_POINTER_INDEX)
+		(void)InterlockedIncrement(&tc->chain->cached);
+	return TRUE;
+}
+
+static BOOL test_decoded_bitmap(rdpContext* context, const BITMAP_UPDATE* bitmap)
+{
+	test_client_context* tc = (test_client_context*)context;
+
+	if (tc->relay)
+	{
+		(void)InterlockedIncrement(&tc->chain->decoded);
+		return TRUE;
+	}
+
+	if (bitmap->number != 1)
+		return TRUE;
+
+	const BITMAP_DATA* rect = &bitmap->rectangles[0];
+	if ((rect->width == TEST_BITMAP_SIZE) && (rect->height == TEST_BITMAP_SIZE) &&
+	    (rect->bitsPerPixel == 32) && (rect->bitmapLength == sizeof(tc->chain->data)))
+	{
+		memcpy(tc->chain->data, rect->bitmapDataStream, sizeof(tc->chain->data));
+		(void)InterlockedIncrement(&tc->chain->bitmap);
+	}
+	return TRUE;
+}
+
+static BOOL test_decoded_opaque_rect(rdpContext* context, const OPAQUE_RECT_ORDER* rect)
+{
+	test_client_context* tc = (test_client_context*)context;
+
+	if (tc->relay)
+		(void)InterlockedIncrement(&tc->chain->decoded);
+	else if ((rect->nLeftRect == 1) && (rect->nTopRect == 2) && (rect->nWidth == 3) &&
+	         (rect->nHeight == 4) && (rect->color == TEST_RECT_COLOR))
+		(void)InterlockedIncrement(&tc->chain->rect);
+	return TRUE;
+}
+
+static BOOL test_client_post_connect(freerdp* instance)
+{
+	test_client_context* tc = (test_client_context*)instance->context;
+	rdpUpdate* update = instance->context->update;
+
+	update->pointer->PointerPosition = test_decoded_position;
+	update->pointer->PointerSystem = test_decoded_system;
+	update->pointer->PointerCached = test_decoded_cached;
+	update->BitmapUpdate = test_decoded_bitmap;
+	update->primary->OpaqueRect = test_decoded_opaque_rect;
+	if (tc->relay)
+		update->RawUpdate = test_relay_update;
+	return TRUE;
+}
+
+static DWORD WINAPI test_client_thread(LPVOID arg)
+{
+	freerdp* instance = arg;
+	test_client_context* tc = (test_client_context*)instance->context;
+	test_client* client = tc->relay ? &tc->chain->b : &tc->chain->d;
+
+	if (!freerdp_connect(instance))
+		return 1;
+
+	(void)InterlockedIncrement(&client->connected);
+	while (WaitForSingleObject(tc->chain->stop, 0) != WAIT_OBJECT_0)
+	{
+		if (!test_loopback_client_check(instance, tc->chain->stop, 100))
+			break;
+	}
+
+	(void)freerdp_disconnect(instance);
+	return 0;
+}
+
+static BOOL test_client_start(test_chain* chain, test_client* client, UINT16 port, BOOL relay)
+{
+	client->instance =
+	    test_loopback_client_new(sizeof(test_client_context), test_client_post_connect, port);
+	if (!client->instance)
+		return FALSE;
+
+	test_client_context* tc = (test_client_context*)client->instance->context;
+	tc->chain = chain;
+	tc->relay = relay;
+
+	client->thread = CreateThread(NULL, 0, test_client_thread, client->instance, 0, NULL);
+	return client->thread != NULL;
+}
+
+static BOOL test_server_start(test_chain* chain, test_server* server)
+{
+	if (!test_loopback_server_open(&server->base, chain->stop))
+		return FALSE;
+	server->base.thread = CreateThread(NULL, 0, test_server_thread, server, 0, NULL);
+	return server->base.thread != NULL;
+}
+
+static void test_client_free(test_client* client)
+{
+	if (client->thread)
+	{
+		(void)WaitForSingleObject(client->thread, INFINITE);
+		(void)CloseHandle(client->thread);
+	}
+	test_loopback_client_free(client->instance);
+}
+
+int TestRawUpdate(int argc, char* argv[])
+{
+	int rc = -1;
+	test_chain chain = { 0 };
+	BYTE expected[sizeof(chain.data)] = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	for (size_t x = 0; x < sizeof(expected); x++)
+		expected[x] = (BYTE)x;
+
+	chain.stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!chain.stop)
+		goto fail;
+
+	/* the relaying leg B -> C needs C up before B receives anything */
+	if (!test_server_start(&chain, &chain.c) ||
+	    !test_client_start(&chain, &chain.d, chain.c.base.port, FALSE) ||
+	    !test_loopback_wait(&chain.d.connected, 1) ||
+	    !test_loopback_wait(&chain.c.base.activated, 1))
+		goto fail;
+
+	if (!test_server_start(&chain, &chain.a) ||
+	    !test_client_start(&chain, &chain.b, chain.a.base.port, TRUE) ||
+	    !test_loopback_wait(&chain.b.connected, 1))
+		goto fail;
+
+	chain.a.send = TRUE;
+	if (!test_loopback_wait(&chain.position, 1) || !test_loopback_wait(&chain.system, 1) ||
+	    !test_loopback_wait(&chain.cached, 1) || !test_loopback_wait(&chain.bitmap, 1) ||
+	    !test_loopback_wait(&chain.rect, 1))
+		goto fail;
+
+	if ((chain.decoded != 0) || (chain.relayed < 5) ||
+	    (memcmp(chain.data, expected, sizeof(expected)) != 0))
+		goto fail;
+
+	rc = 0;
+fail:
+	if (rc != 0)
+		printf("relayed %" PRId32 ", decoded %" PRId32 ", position %" PRId32 ", system %" PRId32
+		       ", cached %" PRId32 ", bitmap %" PRId32 ", rect %" PRId32 "\n",
+		       chain.relayed, chain.decoded, chain.position, chain.system, chain.cached,
+		       chain.bitmap, chain.rect);
+	if (chain.stop)
+		(void)SetEvent(chain.stop);
+	test_client_free(&chain.b);
+	test_client_free(&chain.d);
+	test_loopback_server_free(&chain.a.base);
+	test_loopback_server_free(&chain.c.base);
+	if (chain.stop)
+		(void)CloseHandle(chain.stop);
+	return rc;
+}
@@ -0,0 +1,266 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+
+#include "../rdpudp.h"
+
+#define TEST_MAX_DATAGRAMS 4096
+#define TEST_MAX_TIME (10 * 60 * 1000)
+
+typedef struct
+{
+	UINT64 deliverAt;
+	size_t length;
+	BYTE data[RDPUDP_MTU_SIZE];
+} test_datagram;
+
+/* One direction of the simulated link */
+typedef struct
+{
+	test_datagram* datagrams;
+	size_t count;
+	UINT32 lossPercent;
+	UINT32 latency;
+	UINT32 jitter;
+	UINT64 sent;
+	UINT64 dropped;
+} test_link;
+
+typedef struct test_peer_s test_peer;
+struct test_peer_s
+{
+	const char* name;
+	rdpUdp* udp;
+	test_link* out;
+	UINT64 now;
+	UINT32 seed;
+
+	UINT32 received;
+	UINT32 expected;
+	BOOL ordered;
+	BOOL corrupt;
+	BYTE* seen;
+	size_t seenCount;
+};
+
+static UINT32 test_random(UINT32* seed)
+{
+	*seed = *seed * 1103515245u + 12345u;
+	return (*seed >> 16) & 0x7FFF;
+}
+
+/* Message content is derived from its index so the receiver can verify it */
+static size_t test_message(UINT32 index, BYTE* data, size_t maxLength)
+{
+	UINT32 seed = index;
+	const size_t length = 4 + (test_random(&seed) % (maxLength - 4));
+
+	data[0] = (BYTE)(index >> 24);
+	data[1] = (BYTE)(index >> 16);
+	data[2] = (BYTE)(index >> 8);
+	data[3] = (BYTE)index;
+	for (size_t x = 4; x < length; x++)
+		data[x] = (BYTE)test_random(&seed);
+	return length;
+}
+
+static BOOL test_send(void* context, const BYTE* data, size_t length)
+{
+	test_peer* peer = context;
+	test_link* link = peer->out;
+
+	if ((length > RDPUDP_MTU_SIZE) || (link->count >= TEST_MAX_DATAGRAMS))
+		return FALSE;
+
+	link->sent++;
+	if (test_random(&peer->seed) % 100 < link->lossPercent)
+	{
+		link->dropped++;
+		return TRUE;
+	}
+
+	test_datagram* d = &link->datagrams[link->count++];
+	d->deliverAt = peer->now + link->latency;
+	if (link->jitter > 0)
+		d->deliverAt += test_random(&peer->seed) % link->jitter;
+	d->length = length;
+	memcpy(d->data, data, length);
+	return TRUE;
+}
+
+static BOOL test_receive(void* context, const BYTE* data, size_t length)
+{
+	BYTE expected[RDPUDP_MTU_SIZE] = { 0 };
+	test_peer* peer = context;
+
+	if (length < 4)
+		return FALSE;
+
+	const UINT32 index = ((UINT32)data[0] << 24) | ((UINT32)data[1] << 16) |
+	                     ((UINT32)data[2] << 8) | data[3];
+	const size_t len = test_message(index, expected, rdpudp_get_max_payload(peer->udp));
+
+	if ((index >= peer->seenCount) || peer->seen[index] || (len != length) ||
+	    (memcmp(expected, data, length) != 0))
+	{
+		(void)fprintf(stderr, "[%s] corrupt or duplicate message %" PRIu32 "\n", peer->name,
+		              index);
+		peer->corrupt = TRUE;
+		return FALSE;
+	}
+
+	if (peer->ordered && (index != peer->expected))
+	{
+		(void)fprintf(stderr, "[%s] message %" PRIu32 " out of order, expected %" PRIu32 "\n",
+		              peer->name, index, peer->expected);
+		peer->corrupt = TRUE;
+		return FALSE;
+	}
+
+	peer->seen[index] = 1;
+	peer->expected = index + 1;
+	peer->received++;
+	return TRUE;
+}
+
+/* Deliver every datagram due at the current time */
+static BOOL test_deliver(test_link* link, test_peer* to)
+{
+	size_t x = 0;
+
+	while (x < link->count)
+	{
+		test_datagram* d = &link->datagrams[x];
+		if (d->deliverAt > to->now)
+		{
+			x++;
+			continue;
+		}
+
+		test_datagram cur = *d;
+		link->count--;
+		memmove(d, d + 1, (link->count - x) * sizeof(test_datagram));
+
+		if (!rdpudp_input(to->udp, cur.data, cur.length, to->now))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_step(test_peer* client, test_peer* server, test_link* c2s, test_link* s2c,
+                      UINT64 now)
+{
+	client->now = now;
+	server->now = now;
+
+	if (!test_deliver(c2s, server) || !test_deliver(s2c, client))
+		return FALSE;
+	if (!rdpudp_check_timeout(client->udp, now) || !rdpudp_check_timeout(server->udp, now))
+		return FALSE;
+	return TRUE;
+}
+
+static BOOL test_transfer(const char* name, BOOL lossy, UINT32 lossPercent, UINT32 latency,
+                          UINT32 jitter, UINT32 messages, UINT32 minDeliveredPercent)
+{
+	BOOL rc = FALSE;
+	BYTE data[RDPUDP_MTU_SIZE] = { 0 };
+	test_link c2s = { 0 };
+	test_link s2c = { 0 };
+	test_peer client = { 0 };
+	test_peer server = { 0 };
+	UINT64 now = 0;
+	UINT32 sent = 0;
+
+	c2s.datagrams = calloc(TEST_MAX_DATAGRAMS, sizeof(test_datagram));
+	s2c.datagrams = calloc(TEST_MAX_DATAGRAMS, sizeof(test_datagram));
+	server.seen = calloc(messages, 1);
+	if (!c2s.datagrams || !s2c.datagrams || !server.seen)
+		goto fail;
+
+	c2s.lossPercent = s2c.lossPercent = lossPercent;
+	c2s.latency = s2c.latency = latency;
+	c2s.jitter = s2c.jitter = jitter;
+
+	client.name = "client";
+	client.out = &c2s;
+	client.seed = 1;
+	server.name = "server";
+	server.out = &s2c;
+	server.seed = 2;
+	server.ordered = !lossy;
+	server.seenCount = messages;
+
+	client.udp = rdpudp_new(FALSE, test_send, test_receive, &client);
+	server.udp = rdpudp_new(TRUE, test_send, test_receive, &server);
+	if (!client.udp || !server.udp)
+		goto fail;
+
+	if (!rdpudp_connect(client.udp, lossy, now))
+		goto fail;
+
+	for (; now < TEST_MAX_TIME; now++)
+	{
+		if (!test_step(&client, &server, &c2s, &s2c, now))
+			goto fail;
+
+		if (rdpudp_get_state(client.udp) != RDPUDP_STATE_ESTABLISHED)
+			continue;
+
+		/* Keep a bounded amount of data queued like a real producer */
+		while ((sent < messages) && (rdpudp_get_pending(client.udp) < 128))
+		{
+			const size_t length = test_message(sent, data, rdpudp_get_max_payload(client.udp));
+			if (!rdpudp_write(client.udp, data, length, now))
+				goto fail;
+			sent++;
+		}
+
+		if ((sent == messages) && (rdpudp_get_pending(client.udp) == 0) && (c2s.count == 0) &&
+		    (s2c.count == 0))
+			break;
+	}
+
+	if (rdpudp_is_lossy(server.udp) != lossy)
+		goto fail;
+
+	if (server.corrupt || (sent != messages) ||
+	    (server.received * 100ull < 1ull * messages * minDeliveredPercent))
+		goto fail;
+
+	printf("%s: %" PRIu32 "/%" PRIu32 " messages in %" PRIu64 "ms, %" PRIu64 "/%" PRIu64
+	       " datagrams dropped\n",
+	       name, server.received, messages, now, c2s.dropped + s2c.dropped,
+	       c2s.sent + s2c.sent);
+	rc = TRUE;
+
+fail:
+	if (!rc)
+		(void)fprintf(stderr, "%s failed after %" PRIu64 "ms, %" PRIu32 "/%" PRIu32 " received\n",
+		              name, now, server.received, messages);
+	rdpudp_free(client.udp);
+	rdpudp_free(server.udp);
+	free(c2s.datagrams);
+	free(s2c.datagrams);
+	free(server.seen);
+	return rc;
+}
+
+int TestRdpUdp(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_transfer("reliable", FALSE, 0, 5, 0, 2000, 100))
+		return -1;
+	if (!test_transfer("reliable lossy link", FALSE, 10, 20, 10, 2000, 100))
+		return -1;
+	if (!test_transfer("lossy", TRUE, 0, 5, 0, 2000, 100))
+		return -1;
+	if (!test_transfer("lossy with FEC", TRUE, 5, 20, 10, 2000, 97))
+		return -1;
+
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/interlocked.h>
+#include <winpr/sysinfo.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/peer.h>
+#include <freerdp/listener.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define TEST_PEERS 32
+#define TEST_TIMEOUT 10000
+
+typedef struct
+{
+	freerdp_reactor* reactor;
+	HANDLE done;
+	LONG accepted;
+	LONG closed;
+	LONG ticks;
+	LONG expected;
+} test_reactor;
+
+static BOOL test_peer_event(freerdp_peer* peer, FREERDP_REACTOR_PEER_EVENT event, void* arg)
+{
+	test_reactor* test = arg;
+
+	switch (event)
+	{
+		case FREERDP_REACTOR_PEER_TIMER:
+			(void)InterlockedIncrement(&test->ticks);
+			return TRUE;
+
+		case FREERDP_REACTOR_PEER_CLOSED:
+			freerdp_peer_context_free(peer);
+			freerdp_peer_free(peer);
+			if (InterlockedIncrement(&test->closed) == test->expected)
+				(void)SetEvent(test->done);
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL test_peer_accepted(freerdp_listener* instance, freerdp_peer* client)
+{
+	test_reactor* test = instance->info;
+
+	if (!freerdp_peer_context_new(client))
+		return FALSE;
+
+	if (!freerdp_reactor_add_peer(test->reactor, client, NULL, 5, test_peer_event, test))
+	{
+		freerdp_peer_context_free(client);
+		return FALSE;
+	}
+
+	(void)InterlockedIncrement(&test->accepted);
+	return TRUE;
+}
+
+static BOOL test_open(freerdp_listener* listener, UINT16* pport)
+{
+	for (UINT16 port = 33890; port < 34000; port++)
+	{
+		if (listener->Open(listener, "127.0.0.1", port))
+		{
+			*pport = port;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static BOOL test_connect(int* sockets, size_t count, UINT16 port)
+{
+	struct sockaddr_in addr = { 0 };
+
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for (size_t x = 0; x < count; x++)
+	{
+		sockets[x] = socket(AF_INET, SOCK_STREAM, 0);
+		if (sockets[x] < 0)
+			return FALSE;
+		if (connect(sockets[x], (struct sockaddr*)&addr, sizeof(addr)) != 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void test_close(int* sockets, size_t count)
+{
+	for (size_t x = 0; x < count; x++)
+	{
+		if (sockets[x] >= 0)
+			close(sockets[x]);
+		sockets[x] = -1;
+	}
+}
+
+static BOOL test_wait(const LONG* value, LONG expected)
+{
+	const UINT64 end = GetTickCount64() + TEST_TIMEOUT;
+
+	while (InterlockedCompareExchange((LONG*)value, 0, 0) < expected)
+	{
+		if (GetTickCount64() > end)
+		{
+			printf("timeout waiting for %" PRId32 " (%" PRId32 ")\n", expected, *value);
+			return FALSE;
+		}
+		Sleep(5);
+	}
+	return TRUE;
+}
+
+int TestReactor(int argc, char* argv[])
+{
+	int rc = -1;
+	UINT16 port = 0;
+	int sockets[TEST_PEERS] = { 0 };
+	test_reactor test = { 0 };
+	freerdp_listener* listener = freerdp_listener_new();
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	for (size_t x = 0; x < ARRAYSIZE(sockets); x++)
+		sockets[x] = -1;
+
+	test.reactor = freerdp_reactor_new(3);
+	test.done = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!listener || !test.reactor || !test.done)
+		goto fail;
+
+	listener->info = &test;
+	listener->PeerAccepted = test_peer_accepted;
+	if (!test_open(listener, &port) || !freerdp_reactor_add_listener(test.reactor, listener))
+		goto fail;
+
+	/* idle peers only wake up for their timers */
+	test.expected = TEST_PEERS / 2;
+	if (!test_connect(sockets, TEST_PEERS, port) || !test_wait(&test.accepted, TEST_PEERS) ||
+	    !test_wait(&test.ticks, 4 * TEST_PEERS))
+		goto fail;
+
+	if (freerdp_reactor_get_peer_count(test.reactor) != TEST_PEERS)
+		goto fail;
+
+	/* a disconnected peer fails its check and is handed back */
+	test_close(sockets, TEST_PEERS / 2);
+	if (WaitForSingleObject(test.done, TEST_TIMEOUT) != WAIT_OBJECT_0)
+		goto fail;
+
+	if (freerdp_reactor_get_peer_count(test.reactor) != TEST_PEERS / 2)
+		goto fail;
+
+	/* peers still connected are handed back when the reactor stops */
+	freerdp_reactor_free(test.reactor);
+	test.reactor = NULL;
+	if (test.closed != TEST_PEERS)
+		goto fail;
+
+	rc = 0;
+fail:
+	if (rc != 0)
+		printf("accepted %" PRId32 ", closed %" PRId32 ", ticks %" PRId32 "\n", test.accepted,
+		       test.closed, test.ticks);
+	freerdp_reactor_free(test.reactor);
+	test_close(sockets, ARRAYSIZE(sockets));
+	if (listener)
+		listener->Close(listener);
+	freerdp_listener_free(listener);
+	if (test.done)
+		(void)CloseHandle(test.done);
+	return rc;
+}
@@ -49,6 +49,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_DrawGdiPlusEnabled,
 	FreeRDP_DrawNineGridEnabled,
 	FreeRDP_DumpRemoteFx,
+	FreeRDP_DynamicChannelCompression,
 	FreeRDP_DynamicDaylightTimeDisabled,
 	FreeRDP_DynamicResolutionUpdate,
 	FreeRDP_EmbeddedWindow,
@@ -236,6 +237,7 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_ColorDepth,
 	FreeRDP_ColorPointerCacheSize,
 	FreeRDP_CompDeskSupportLevel,
+	FreeRDP_CompressionEffort,
 	FreeRDP_CompressionLevel,
 	FreeRDP_ConnectionType,
 	FreeRDP_CookieMaxLength,
@@ -0,0 +1,214 @@
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/crypto/certificate.h>
+#include <freerdp/crypto/privatekey.h>
+
+#include "test_loopback.h"
+
+static BOOL test_loopback_peer_accepted(freerdp_listener* instance, freerdp_peer* client)
+{
+	test_loopback_server* server = instance->info;
+
+	if (server->peer)
+		return FALSE;
+	server->peer = client;
+	return TRUE;
+}
+
+static BOOL test_loopback_peer_post_connect(freerdp_peer* client)
+{
+	WINPR_UNUSED(client);
+	return TRUE;
+}
+
+static BOOL test_loopback_peer_activate(freerdp_peer* client)
+{
+	test_loopback_server* server = client->ContextExtra;
+
+	(void)InterlockedIncrement(&server->activated);
+	return TRUE;
+}
+
+BOOL test_loopback_server_open(test_loopback_server* server, HANDLE stop)
+{
+	WINPR_ASSERT(server);
+
+	server->stop = stop;
+	server->listener = freerdp_listener_new();
+	if (!server->listener)
+		return FALSE;
+
+	server->listener->info = server;
+	server->listener->PeerAccepted = test_loopback_peer_accepted;
+	for (UINT16 port = 34100; port < 34300; port++)
+	{
+		if (server->listener->Open(server->listener, "127.0.0.1", port))
+		{
+			server->port = port;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+BOOL test_loopback_server_accept(test_loopback_server* server)
+{
+	WINPR_ASSERT(server);
+
+	freerdp_listener* listener = server->listener;
+
+	while (!server->peer)
+	{
+		HANDLE handles[32] = { 0 };
+		DWORD count = listener->GetEventHandles(listener, handles, ARRAYSIZE(handles) - 1);
+
+		if (count == 0)
+			return FALSE;
+		handles[count++] = server->stop;
+		if (WaitForMultipleObjects(count, handles, FALSE, INFINITE) == WAIT_FAILED)
+			return FALSE;
+		if (WaitForSingleObject(server->stop, 0) == WAIT_OBJECT_0)
+			return FALSE;
+		if (!listener->CheckFileDescriptor(listener))
+			return FALSE;
+	}
+
+	freerdp_peer* peer = server->peer;
+	peer->ContextExtra = server;
+	if (!freerdp_peer_context_new(peer))
+		return FALSE;
+
+	rdpSettings* settings = peer->context->settings;
+	rdpPrivateKey* key = freerdp_key_new_from_file_enc(
+	    TESTING_SRC_DIRECTORY "/libfreerdp/core/test/test_server.key", NULL);
+	if (!freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerRsaKey, key, 1))
+		return FALSE;
+	rdpCertificate* cert = freerdp_certificate_new_from_file(
+	    TESTING_SRC_DIRECTORY "/libfreerdp/core/test/test_server.crt");
+	if (!freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerCertificate, cert, 1))
+		return FALSE;
+
+	if (!freerdp_settings_set_bool(settings, FreeRDP_RdpSecurity, FALSE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_TlsSecurity, TRUE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_NlaSecurity, FALSE) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_ColorDepth, 32))
+		return FALSE;
+
+	peer->PostConnect = test_loopback_peer_post_connect;
+	peer->Activate = test_loopback_peer_activate;
+	return TRUE;
+}
+
+BOOL test_loopback_peer_check(freerdp_peer* peer, HANDLE stop, DWORD timeout)
+{
+	HANDLE handles[32] = { 0 };
+
+	WINPR_ASSERT(peer);
+
+	DWORD count = peer->GetEventHandles(peer, handles, ARRAYSIZE(handles) - 1);
+
+	if (count == 0)
+		return FALSE;
+	if (stop)
+		handles[count++] = stop;
+	if (WaitForMultipleObjects(count, handles, FALSE, timeout) == WAIT_FAILED)
+		return FALSE;
+	return peer->CheckFileDescriptor(peer);
+}
+
+void test_loopback_server_free(test_loopback_server* server)
+{
+	if (!server)
+		return;
+
+	if (server->thread)
+	{
+		(void)WaitForSingleObject(server->thread, INFINITE);
+		(void)CloseHandle(server->thread);
+	}
+	if (server->peer)
+	{
+		server->peer->Disconnect(server->peer);
+		freerdp_peer_context_free(server->peer);
+		freerdp_peer_free(server->peer);
+	}
+	if (server->listener)
+	{
+		server->listener->Close(server->listener);
+		freerdp_listener_free(server->listener);
+	}
+}
+
+freerdp* test_loopback_client_new(size_t contextSize, pConnectCallback PostConnect, UINT16 port)
+{
+	freerdp* instance = freerdp_new();
+	if (!instance)
+		return NULL;
+
+	WINPR_ASSERT(contextSize >= sizeof(rdpContext));
+	instance->ContextSize = contextSize;
+	instance->PostConnect = PostConnect;
+	if (!freerdp_context_new(instance))
+	{
+		freerdp_free(instance);
+		return NULL;
+	}
+
+	rdpSettings* settings = instance->context->settings;
+
+	if (!freerdp_settings_set_string(settings, FreeRDP_ServerHostname, "127.0.0.1") ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_ServerPort, port) ||
+	    !freerdp_settings_set_string(settings, FreeRDP_Username, "test") ||
+	    !freerdp_settings_set_string(settings, FreeRDP_Password, "test") ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_IgnoreCertificate, TRUE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_RdpSecurity, FALSE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_TlsSecurity, TRUE) ||
+	    !freerdp_settings_set_bool(settings, FreeRDP_NlaSecurity, FALSE))
+	{
+		test_loopback_client_free(instance);
+		return NULL;
+	}
+	return instance;
+}
+
+BOOL test_loopback_client_check(freerdp* instance, HANDLE stop, DWORD timeout)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+
+	WINPR_ASSERT(instance);
+
+	DWORD count = freerdp_get_event_handles(instance->context, handles, ARRAYSIZE(handles) - 1);
+
+	if (count == 0)
+		return FALSE;
+	handles[count++] = stop;
+	if (WaitForMultipleObjects(count, handles, FALSE, timeout) == WAIT_FAILED)
+		return FALSE;
+	return freerdp_check_event_handles(instance->context);
+}
+
+void test_loopback_client_free(freerdp* instance)
+{
+	if (!instance)
+		return;
+
+	freerdp_context_free(instance);
+	freerdp_free(instance);
+}
+
+BOOL test_loopback_wait(const LONG* value, LONG expected)
+{
+	const UINT64 end = GetTickCount64() + TEST_LOOPBACK_TIMEOUT;
+
+	while (InterlockedCompareExchange((LONG*)value, 0, 0) < expected)
+	{
+		if (GetTickCount64() > end)
+			return FALSE;
+		Sleep(5);
+	}
+	return TRUE;
+}
@@ -0,0 +1,49 @@
+#ifndef FREERDP_LIB_CORE_TEST_LOOPBACK_H
+#define FREERDP_LIB_CORE_TEST_LOOPBACK_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/peer.h>
+#include <freerdp/listener.h>
+
+/* A server with a single peer and clients connected to it over TLS on 127.0.0.1, shared by the
+ * tests that need a complete connection. */
+
+#define TEST_LOOPBACK_TIMEOUT 10000
+
+typedef struct
+{
+	HANDLE stop;
+	freerdp_listener* listener;
+	freerdp_peer* peer;
+	HANDLE thread;
+	UINT16 port;
+	LONG activated;
+} test_loopback_server;
+
+/* opens the listener on a free port, stop aborts the wait for the client */
+BOOL test_loopback_server_open(test_loopback_server* server, HANDLE stop);
+
+/* waits for the client and creates the peer context with the test certificate and TLS security,
+ * the caller adjusts the settings and calls peer->Initialize */
+BOOL test_loopback_server_accept(test_loopback_server* server);
+
+/* waits up to timeout for events of the peer or stop (may be NULL) and handles them */
+BOOL test_loopback_peer_check(freerdp_peer* peer, HANDLE stop, DWORD timeout);
+
+/* joins the server thread, disconnects the peer and frees everything */
+void test_loopback_server_free(test_loopback_server* server);
+
+/* a client of port with a context of contextSize bytes, starting with rdpContext */
+freerdp* test_loopback_client_new(size_t contextSize, pConnectCallback PostConnect, UINT16 port);
+
+/* waits up to timeout for events of the client or stop and handles them */
+BOOL test_loopback_client_check(freerdp* instance, HANDLE stop, DWORD timeout);
+
+void test_loopback_client_free(freerdp* instance);
+
+/* waits until value reaches expected, FALSE after TEST_LOOPBACK_TIMEOUT */
+BOOL test_loopback_wait(const LONG* value, LONG expected);
+
+#endif /* FREERDP_LIB_CORE_TEST_LOOPBACK_H */
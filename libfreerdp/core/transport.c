@@ -25,6 +25,7 @@
 
 #include <winpr/crt.h>
 #include <winpr/synch.h>
+#include <winpr/sysinfo.h>
 #include <winpr/print.h>
 #include <winpr/stream.h>
 #include <winpr/winsock.h>
@@ -65,6 +66,16 @@
 
 #define BUFFER_SIZE 16384
 
+/* Small PDUs written while the transport is corked are collected up to the size of a single
+ * TLS record. This is done here and not with TCP_CORK: the records are already built when the
+ * data reaches the socket, so only coalescing before the TLS layer saves the per record
+ * overhead. TCP_NODELAY stays enabled, a flush always hits the network immediately. */
+#define TRANSPORT_COALESCE_SIZE 16384
+/* Output queued above this is reported as congestion */
+#define TRANSPORT_OUTPUT_CONGESTED (256 * 1024)
+/* Writes on a non blocking transport wait once this much output is queued */
+#define TRANSPORT_OUTPUT_LIMIT (4 * 1024 * 1024)
+
 struct rdp_transport
 {
 	TRANSPORT_LAYER layer;
@@ -88,6 +99,8 @@ struct rdp_transport
 	CRITICAL_SECTION ReadLock;
 	CRITICAL_SECTION WriteLock;
 	UINT64 written;
+	wStream* OutputBuffer;
+	size_t OutputCork;
 	HANDLE rereadEvent;
 	BOOL haveMoreBytesToRead;
 	wLog* log;
@@ -1144,42 +1157,61 @@ int transport_write(rdpTransport* transport, wStream* s)
 	return IFCALLRESULT(-1, transport->io.WritePdu, transport, s);
 }
 
-static int transport_default_write(rdpTransport* transport, wStream* s)
+/* WriteLock must be held.
+ * Waits until the socket BIO holds no more than limit bytes the peer did not accept yet. A peer
+ * that does not drain it within FreeRDP_TcpAckTimeout is dropped, as the kernel would do with
+ * unacknowledged data, the writer must not be stuck on it forever. Like TCP_USER_TIMEOUT a
+ * timeout of 0 waits without limit. */
+static int transport_wait_output(rdpTransport* transport, long limit)
 {
-	int status = -1;
 	rdpContext* context = transport_get_context(transport);
 
-	WINPR_ASSERT(transport);
 	WINPR_ASSERT(context);
 
-	if (!s)
-		return -1;
-
-	Stream_AddRef(s);
+	const UINT32 timeout = freerdp_settings_get_uint32(context->settings, FreeRDP_TcpAckTimeout);
+	const UINT64 end = GetTickCount64() + timeout;
 
-	rdpRdp* rdp = context->rdp;
-	if (!rdp)
-		goto fail;
+	while (BIO_write_blocked(transport->frontBio) && (BIO_wpending(transport->frontBio) > limit))
+	{
+		const UINT64 now = GetTickCount64();
 
-	EnterCriticalSection(&(transport->WriteLock));
-	if (!transport->frontBio)
-		goto out_cleanup;
+		if ((timeout > 0) && (now >= end))
+		{
+			WLog_Print(transport->log, WLOG_ERROR,
+			           "peer did not drain its output within %" PRIu32 " ms, dropping it", timeout);
+			return -1;
+		}
 
-	size_t length = Stream_GetPosition(s);
-	size_t writtenlength = length;
-	Stream_SetPosition(s, 0);
+		const UINT64 wait = (timeout > 0) ? MIN(100, end - now) : 100;
+		if (BIO_wait_write(transport->frontBio, (int)wait) < 0)
+		{
+			WLog_Print(transport->log, WLOG_ERROR, "error when selecting for write");
+			return -1;
+		}
 
-	if (length > 0)
-	{
-		rdp->outBytes += length;
-		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
+		if (BIO_flush(transport->frontBio) < 1)
+		{
+			WLog_Print(transport->log, WLOG_ERROR, "error when flushing outputBuffer");
+			return -1;
+		}
 	}
 
+	return 1;
+}
+
+/* WriteLock must be held */
+static int transport_write_bio(rdpTransport* transport, const BYTE* data, size_t length)
+{
+	int status = -1;
+	rdpContext* context = transport_get_context(transport);
+
+	WINPR_ASSERT(context);
+
 	while (length > 0)
 	{
 		ERR_clear_error();
 		const int towrite = (length > INT32_MAX) ? INT32_MAX : (int)length;
-		status = BIO_write(transport->frontBio, Stream_ConstPointer(s), towrite);
+		status = BIO_write(transport->frontBio, data, towrite);
 
 		if (status <= 0)
 		{
@@ -1190,21 +1222,20 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 			if (!BIO_should_retry(transport->frontBio))
 			{
 				WLog_ERR_BIO(transport, "BIO_should_retry", transport->frontBio);
-				goto out_cleanup;
+				return -1;
 			}
 
 			/* non-blocking can live with blocked IOs */
 			if (!transport->blocking)
 			{
 				WLog_ERR_BIO(transport, "BIO_write", transport->frontBio);
-				goto out_cleanup;
+				return -1;
 			}
 
 			if (BIO_wait_write(transport->frontBio, 100) < 0)
 			{
 				WLog_ERR_BIO(transport, "BIO_wait_write", transport->frontBio);
-				status = -1;
-				goto out_cleanup;
+				return -1;
 			}
 
 			continue;
@@ -1213,51 +1244,163 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 		WINPR_ASSERT(context->settings);
 		if (transport->blocking || context->settings->WaitForOutputBufferFlush)
 		{
-			while (BIO_write_blocked(transport->frontBio))
-			{
-				if (BIO_wait_write(transport->frontBio, 100) < 0)
-				{
-					WLog_Print(transport->log, WLOG_ERROR, "error when selecting for write");
-					status = -1;
-					goto out_cleanup;
-				}
-
-				if (BIO_flush(transport->frontBio) < 1)
-				{
-					WLog_Print(transport->log, WLOG_ERROR, "error when flushing outputBuffer");
-					status = -1;
-					goto out_cleanup;
-				}
-			}
+			if (transport_wait_output(transport, 0) < 0)
+				return -1;
 		}
 
 		const size_t ustatus = (size_t)status;
 		if (ustatus > length)
-		{
-			status = -1;
-			goto out_cleanup;
-		}
+			return -1;
 
 		length -= ustatus;
-		Stream_Seek(s, ustatus);
+		data += ustatus;
 	}
 
-	transport->written += writtenlength;
-out_cleanup:
+	return status;
+}
 
-	if (status < 0)
+/* WriteLock must be held */
+static int transport_flush_coalesced(rdpTransport* transport)
+{
+	const size_t length = Stream_GetPosition(transport->OutputBuffer);
+
+	if (length == 0)
+		return 1;
+
+	Stream_SetPosition(transport->OutputBuffer, 0);
+	return transport_write_bio(transport, Stream_Buffer(transport->OutputBuffer), length);
+}
+
+static void transport_write_failed(rdpTransport* transport)
+{
+	rdpContext* context = transport_get_context(transport);
+
+	WINPR_ASSERT(context);
+
+	/* A write error indicates that the peer has dropped the connection */
+	transport->layer = TRANSPORT_LAYER_CLOSED;
+	freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_TRANSPORT_FAILED);
+}
+
+static int transport_default_write(rdpTransport* transport, wStream* s)
+{
+	int status = -1;
+	rdpContext* context = transport_get_context(transport);
+
+	WINPR_ASSERT(transport);
+	WINPR_ASSERT(context);
+
+	if (!s)
+		return -1;
+
+	Stream_AddRef(s);
+
+	rdpRdp* rdp = context->rdp;
+	if (!rdp)
+		goto fail;
+
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->frontBio)
+		goto out_cleanup;
+
+	const size_t length = Stream_GetPosition(s);
+	Stream_SetPosition(s, 0);
+
+	if (length > 0)
 	{
-		/* A write error indicates that the peer has dropped the connection */
-		transport->layer = TRANSPORT_LAYER_CLOSED;
-		freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_TRANSPORT_FAILED);
+		rdp->outBytes += length;
+		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
+	}
+
+	if ((transport->OutputCork > 0) && (length > 0) && (length < TRANSPORT_COALESCE_SIZE))
+	{
+		status = 1;
+		if (Stream_GetRemainingCapacity(transport->OutputBuffer) < length)
+			status = transport_flush_coalesced(transport);
+
+		if (status > 0)
+			Stream_Write(transport->OutputBuffer, Stream_Buffer(s), length);
+	}
+	else
+	{
+		/* keep the order, the collected PDUs go first */
+		status = transport_flush_coalesced(transport);
+		if (status > 0)
+			status = transport_write_bio(transport, Stream_Buffer(s), length);
 	}
 
+	/* The socket BIO keeps everything the peer does not accept yet, a slow peer must not let
+	 * that grow without bounds. Callers are supposed to check for congestion well before. */
+	if ((status > 0) && !transport->blocking)
+		status = transport_wait_output(transport, TRANSPORT_OUTPUT_LIMIT);
+
+	if (status > 0)
+		transport->written += length;
+out_cleanup:
+
+	if (status < 0)
+		transport_write_failed(transport);
+
 	LeaveCriticalSection(&(transport->WriteLock));
 fail:
 	Stream_Release(s);
 	return status;
 }
 
+BOOL transport_cork(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	transport->OutputCork++;
+	LeaveCriticalSection(&(transport->WriteLock));
+	return TRUE;
+}
+
+BOOL transport_uncork(rdpTransport* transport)
+{
+	BOOL rc = TRUE;
+
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	WINPR_ASSERT(transport->OutputCork > 0);
+	if (transport->OutputCork > 0)
+		transport->OutputCork--;
+
+	if ((transport->OutputCork == 0) && transport->frontBio)
+	{
+		if (transport_flush_coalesced(transport) < 0)
+		{
+			transport_write_failed(transport);
+			rc = FALSE;
+		}
+	}
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+size_t transport_get_output_queue_depth(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	size_t depth = Stream_GetPosition(transport->OutputBuffer);
+	if (transport->frontBio)
+	{
+		const long pending = BIO_wpending(transport->frontBio);
+		if (pending > 0)
+			depth += (size_t)pending;
+	}
+	LeaveCriticalSection(&(transport->WriteLock));
+	return depth;
+}
+
+BOOL transport_is_output_congested(rdpTransport* transport)
+{
+	return transport_get_output_queue_depth(transport) > TRANSPORT_OUTPUT_CONGESTED;
+}
+
 BOOL transport_get_public_key(rdpTransport* transport, const BYTE** data, DWORD* length)
 {
 	return IFCALLRESULT(FALSE, transport->io.GetPublicKey, transport, data, length);
@@ -1394,18 +1537,20 @@ BOOL transport_is_write_blocked(rdpTransport* transport)
 
 int transport_drain_output_buffer(rdpTransport* transport)
 {
-	BOOL status = FALSE;
+	int status = FALSE;
 
 	WINPR_ASSERT(transport);
 	WINPR_ASSERT(transport->frontBio);
+
+	EnterCriticalSection(&(transport->WriteLock));
 	if (BIO_write_blocked(transport->frontBio))
 	{
 		if (BIO_flush(transport->frontBio) < 1)
-			return -1;
-
-		const long rc = BIO_write_blocked(transport->frontBio);
-		status = (rc != 0);
+			status = -1;
+		else
+			status = (BIO_write_blocked(transport->frontBio) != 0);
 	}
+	LeaveCriticalSection(&(transport->WriteLock));
 
 	return status;
 }
@@ -1426,6 +1571,15 @@ int transport_check_fds(rdpTransport* transport)
 		return -1;
 	}
 
+	/* The event also signals writability while output is pending, see the buffered BIO */
+	if (transport->frontBio && (transport_drain_output_buffer(transport) < 0))
+	{
+		EnterCriticalSection(&(transport->WriteLock));
+		transport_write_failed(transport);
+		LeaveCriticalSection(&(transport->WriteLock));
+		return -1;
+	}
+
 	/**
 	 * Note: transport_read_pdu tries to read one PDU from
 	 * the transport layer.
@@ -1690,6 +1844,11 @@ rdpTransport* transport_new(rdpContext* context)
 	if (!InitializeCriticalSectionAndSpinCount(&(transport->WriteLock), 4000))
 		goto fail;
 
+	transport->OutputBuffer = Stream_New(NULL, TRANSPORT_COALESCE_SIZE);
+
+	if (!transport->OutputBuffer)
+		goto fail;
+
 	// transport->io.DataHandler = transport_data_handler;
 	transport->io.TCPConnect = freerdp_tcp_default_connect;
 	transport->io.TLSConnect = transport_default_connect_tls;
@@ -1732,6 +1891,7 @@ void transport_free(rdpTransport* transport)
 
 	nla_free(transport->nla);
 	StreamPool_Free(transport->ReceivePool);
+	Stream_Free(transport->OutputBuffer, TRUE);
 	(void)CloseHandle(transport->connectedEvent);
 	(void)CloseHandle(transport->rereadEvent);
 	(void)CloseHandle(transport->ioEvent);
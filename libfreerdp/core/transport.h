@@ -125,6 +125,11 @@ FREERDP_LOCAL void transport_set_aad_mode(rdpTransport* transport, BOOL AadMode)
 FREERDP_LOCAL BOOL transport_is_write_blocked(rdpTransport* transport);
 FREERDP_LOCAL int transport_drain_output_buffer(rdpTransport* transport);
 
+FREERDP_LOCAL BOOL transport_cork(rdpTransport* transport);
+FREERDP_LOCAL BOOL transport_uncork(rdpTransport* transport);
+FREERDP_LOCAL size_t transport_get_output_queue_depth(rdpTransport* transport);
+FREERDP_LOCAL BOOL transport_is_output_congested(rdpTransport* transport);
+
 FREERDP_LOCAL BOOL transport_io_callback_set_event(rdpTransport* transport, BOOL set);
 
 FREERDP_LOCAL const rdpTransportIo* transport_get_io_callbacks(rdpTransport* transport);
@@ -739,6 +739,88 @@ fail:
 	return NULL;
 }
 
+/* Slow-path bitmap, palette and pointer updates carry the same data as the fast-path ones */
+static BOOL update_type_to_fastpath(UINT16 updateType, BYTE* updateCode)
+{
+	WINPR_ASSERT(updateCode);
+
+	switch (updateType)
+	{
+		case UPDATE_TYPE_BITMAP:
+			*updateCode = FASTPATH_UPDATETYPE_BITMAP;
+			return TRUE;
+		case UPDATE_TYPE_PALETTE:
+			*updateCode = FASTPATH_UPDATETYPE_PALETTE;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL update_pointer_type_to_fastpath(UINT16 messageType, BYTE* updateCode)
+{
+	WINPR_ASSERT(updateCode);
+
+	switch (messageType)
+	{
+		case PTR_MSG_TYPE_POSITION:
+			*updateCode = FASTPATH_UPDATETYPE_PTR_POSITION;
+			return TRUE;
+		case PTR_MSG_TYPE_COLOR:
+			*updateCode = FASTPATH_UPDATETYPE_COLOR;
+			return TRUE;
+		case PTR_MSG_TYPE_CACHED:
+			*updateCode = FASTPATH_UPDATETYPE_CACHED;
+			return TRUE;
+		case PTR_MSG_TYPE_POINTER:
+			*updateCode = FASTPATH_UPDATETYPE_POINTER;
+			return TRUE;
+		case PTR_MSG_TYPE_POINTER_LARGE:
+			*updateCode = FASTPATH_UPDATETYPE_LARGE_POINTER;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL update_recv_raw(rdpUpdate* update, BYTE updateCode, wStream* s, size_t offset)
+{
+	wStream sbuffer = { 0 };
+
+	WINPR_ASSERT(update);
+	WINPR_ASSERT(update->RawUpdate);
+
+	const size_t end = Stream_GetPosition(s) + Stream_GetRemainingLength(s);
+	if (offset > end)
+		return FALSE;
+
+	wStream* raw = Stream_StaticInit(&sbuffer, Stream_Buffer(s) + offset, end - offset);
+	if (!raw)
+		return FALSE;
+
+	if (!update->RawUpdate(update->context, updateCode, raw))
+		return FALSE;
+	return Stream_SetPosition(s, end);
+}
+
+/* slow-path orders are relayed in the fast-path form as well, so all orders share one order
+ * state on the receiving side */
+static BOOL update_recv_orders_raw(rdpUpdate* update, wStream* s)
+{
+	UINT16 numberOrders = 0;
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 6))
+		return FALSE;
+
+	Stream_Seek_UINT16(s);               /* pad2OctetsA (2 bytes) */
+	Stream_Read_UINT16(s, numberOrders); /* numberOrders (2 bytes) */
+
+	/* TS_FP_UPDATE_ORDERS is numberOrders followed by the orders, reuse pad2OctetsB for it */
+	const size_t offset = Stream_GetPosition(s);
+	Stream_Write_UINT16(s, numberOrders);
+	return update_recv_raw(update, FASTPATH_UPDATETYPE_ORDERS, s, offset);
+}
+
 BOOL update_recv_pointer(rdpUpdate* update, wStream* s)
 {
 	BOOL rc = FALSE;
@@ -755,6 +837,10 @@ BOOL update_recv_pointer(rdpUpdate* update, wStream* s)
 	Stream_Read_UINT16(s, messageType); /* messageType (2 bytes) */
 	Stream_Seek_UINT16(s);              /* pad2Octets (2 bytes) */
 
+	BYTE updateCode = 0;
+	if (update->RawUpdate && update_pointer_type_to_fastpath(messageType, &updateCode))
+		return update_recv_raw(update, updateCode, s, Stream_GetPosition(s));
+
 	switch (messageType)
 	{
 		case PTR_MSG_TYPE_POSITION:
@@ -854,6 +940,20 @@ BOOL update_recv(rdpUpdate* update, wStream* s)
 	if (!update_begin_paint(update))
 		goto fail;
 
+	BYTE updateCode = 0;
+	if (update->RawUpdate && update_type_to_fastpath(updateType, &updateCode))
+	{
+		/* the updateType is part of the fast-path bitmap and palette data */
+		rc = update_recv_raw(update, updateCode, s, Stream_GetPosition(s) - 2);
+		goto fail;
+	}
+
+	if (update->RawUpdate && (updateType == UPDATE_TYPE_ORDERS))
+	{
+		rc = update_recv_orders_raw(update, s);
+		goto fail;
+	}
+
 	switch (updateType)
 	{
 		case UPDATE_TYPE_ORDERS:
@@ -1036,7 +1136,9 @@ static BOOL s_update_begin_paint(rdpContext* context)
 	update->combineUpdates = TRUE;
 	update->numberOrders = 0;
 	update->us = s;
-	return TRUE;
+
+	/* everything sent until the end of the paint shares TLS records */
+	return transport_cork(context->rdp->transport);
 }
 
 static BOOL s_update_end_paint(rdpContext* context)
@@ -1065,7 +1167,7 @@ static BOOL s_update_end_paint(rdpContext* context)
 	update->offsetOrders = 0;
 	update->us = NULL;
 	Stream_Free(s, TRUE);
-	return TRUE;
+	return transport_uncork(context->rdp->transport);
 }
 
 static BOOL update_flush(rdpContext* context)
@@ -1361,6 +1463,35 @@ out:
 	return ret;
 }
 
+static BOOL update_send_raw(rdpContext* context, BYTE updateCode, wStream* s)
+{
+	wStream* update = NULL;
+	WINPR_ASSERT(context);
+	rdpRdp* rdp = context->rdp;
+	BOOL ret = FALSE;
+
+	WINPR_ASSERT(rdp);
+	WINPR_ASSERT(s);
+
+	/* orders still batched must go out before the relayed update */
+	if (!update_force_flush(context))
+		return FALSE;
+	update = fastpath_update_pdu_init(rdp->fastpath);
+
+	if (!update)
+		return FALSE;
+
+	const size_t length = Stream_GetRemainingLength(s);
+	if (!Stream_EnsureRemainingCapacity(update, length))
+		goto out;
+
+	Stream_Write(update, Stream_ConstPointer(s), length);
+	ret = fastpath_send_update_pdu(rdp->fastpath, updateCode, update, FALSE);
+out:
+	Stream_Release(update);
+	return ret;
+}
+
 static BOOL update_send_surface_bits(rdpContext* context,
                                      const SURFACE_BITS_COMMAND* surfaceBitsCommand)
 {
@@ -3239,6 +3370,7 @@ void update_register_server_callbacks(rdpUpdate* update)
 	update->SetKeyboardImeStatus = update_send_set_keyboard_ime_status;
 	update->SaveSessionInfo = rdp_send_save_session_info;
 	update->ServerStatusInfo = rdp_send_server_status_info;
+	update->RawUpdate = update_send_raw;
 	update->primary->DstBlt = update_send_dstblt;
 	update->primary->PatBlt = update_send_patblt;
 	update->primary->ScrBlt = update_send_scrblt;
@@ -29,6 +29,7 @@
 #include <freerdp/freerdp.h>
 #include <freerdp/gdi/gdi.h>
 #include <freerdp/codec/color.h>
+#include <freerdp/primitives.h>
 
 #include <freerdp/gdi/region.h>
 #include <freerdp/gdi/bitmap.h>
@@ -177,179 +178,82 @@ HGDI_BITMAP gdi_CreateCompatibleBitmap(HGDI_DC hdc, UINT32 nWidth, UINT32 nHeigh
 	return hBitmap;
 }
 
-static BOOL op_not(UINT32* stack, const UINT32* stackp)
+/* The ROP3 index is the truth table of the operation, bit (P << 2) | (S << 1) | D */
+static BOOL rop3_uses_src(BYTE rop3)
 {
-	if (!stack || !stackp)
-		return FALSE;
-
-	if (*stackp < 1)
-		return FALSE;
-
-	stack[(*stackp) - 1] = ~stack[(*stackp) - 1];
-	return TRUE;
-}
-
-static BOOL op_and(UINT32* stack, UINT32* stackp)
-{
-	if (!stack || !stackp)
-		return FALSE;
-
-	if (*stackp < 2)
-		return FALSE;
-
-	(*stackp)--;
-	stack[(*stackp) - 1] &= stack[(*stackp)];
-	return TRUE;
+	return (((rop3 >> 2) ^ rop3) & 0x33) != 0;
 }
 
-static BOOL op_or(UINT32* stack, UINT32* stackp)
+static BOOL rop3_uses_pat(BYTE rop3)
 {
-	if (!stack || !stackp)
-		return FALSE;
-
-	if (*stackp < 2)
-		return FALSE;
-
-	(*stackp)--;
-	stack[(*stackp) - 1] |= stack[(*stackp)];
-	return TRUE;
+	return (((rop3 >> 4) ^ rop3) & 0x0F) != 0;
 }
 
-static BOOL op_xor(UINT32* stack, UINT32* stackp)
+static void BitBlt_fill_color_row(BYTE* WINPR_RESTRICT row, UINT32 format, UINT32 color,
+                                  size_t count)
 {
-	if (!stack || !stackp)
-		return FALSE;
-
-	if (*stackp < 2)
-		return FALSE;
-
-	(*stackp)--;
-	stack[(*stackp) - 1] ^= stack[(*stackp)];
-	return TRUE;
-}
+	const size_t bpp = FreeRDPGetBytesPerPixel(format);
+	size_t filled = 1;
 
-static UINT32 process_rop(UINT32 src, UINT32 dst, UINT32 pat, const char* rop, UINT32 format)
-{
-	UINT32 stack[10] = { 0 };
-	UINT32 stackp = 0;
+	FreeRDPWriteColor(row, format, color);
 
-	while (*rop != '\0')
+	/* Replicate the pixel, doubling the copied range each time */
+	while (filled < count)
 	{
-		char op = *rop++;
-
-		switch (op)
-		{
-			case '0':
-				stack[stackp++] = FreeRDPGetColor(format, 0, 0, 0, 0xFF);
-				break;
-
-			case '1':
-				stack[stackp++] = FreeRDPGetColor(format, 0xFF, 0xFF, 0xFF, 0xFF);
-				break;
-
-			case 'D':
-				stack[stackp++] = dst;
-				break;
-
-			case 'S':
-				stack[stackp++] = src;
-				break;
-
-			case 'P':
-				stack[stackp++] = pat;
-				break;
-
-			case 'x':
-				op_xor(stack, &stackp);
-				break;
-
-			case 'a':
-				op_and(stack, &stackp);
-				break;
-
-			case 'o':
-				op_or(stack, &stackp);
-				break;
-
-			case 'n':
-				op_not(stack, &stackp);
-				break;
-
-			default:
-				break;
-		}
+		const size_t chunk = MIN(filled, count - filled);
+		memcpy(&row[filled * bpp], row, chunk * bpp);
+		filled += chunk;
 	}
-
-	return stack[0];
 }
 
-static INLINE BOOL BitBlt_write(HGDI_DC hdcDest, HGDI_DC hdcSrc, INT32 nXDest, INT32 nYDest,
-                                INT32 nXSrc, INT32 nYSrc, INT32 x, INT32 y, BOOL useSrc,
-                                BOOL usePat, UINT32 style, const char* rop,
-                                const gdiPalette* palette)
+static BOOL BitBlt_fill_pattern_row(HGDI_DC hdcDest, BYTE* WINPR_RESTRICT row, UINT32 nXDest,
+                                    UINT32 nYDest, size_t count)
 {
-	UINT32 dstColor = 0;
-	UINT32 colorA = 0;
-	UINT32 colorB = 0;
-	UINT32 colorC = 0;
-	const INT32 dstX = nXDest + x;
-	const INT32 dstY = nYDest + y;
-	BYTE* dstp = gdi_get_bitmap_pointer(hdcDest, dstX, dstY);
-
-	if (!dstp)
-	{
-		WLog_ERR(TAG, "dstp=%p", (const void*)dstp);
-		return FALSE;
-	}
+	const size_t bpp = FreeRDPGetBytesPerPixel(hdcDest->format);
+	const HGDI_BITMAP hBmpBrush = hdcDest->brush->pattern;
 
-	colorA = FreeRDPReadColor(dstp, hdcDest->format);
+	WINPR_ASSERT(hBmpBrush);
+	const size_t period = MIN(WINPR_ASSERTING_INT_CAST(size_t, hBmpBrush->width), count);
+	size_t filled = period;
 
-	if (useSrc)
+	for (size_t x = 0; x < period; x++)
 	{
-		const BYTE* srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc + x, nYSrc + y);
+		const BYTE* patp =
+		    gdi_get_brush_pointer(hdcDest, nXDest + WINPR_ASSERTING_INT_CAST(UINT32, x), nYDest);
 
-		if (!srcp)
+		if (!patp)
 		{
-			WLog_ERR(TAG, "srcp=%p", (const void*)srcp);
+			WLog_ERR(TAG, "patp=%p", (const void*)patp);
 			return FALSE;
 		}
 
-		colorC = FreeRDPReadColor(srcp, hdcSrc->format);
-		colorC = FreeRDPConvertColor(colorC, hdcSrc->format, hdcDest->format, palette);
+		memcpy(&row[x * bpp], patp, bpp);
 	}
 
-	if (usePat)
+	/* The brush repeats every brush width pixels */
+	while (filled < count)
 	{
-		switch (style)
-		{
-			case GDI_BS_SOLID:
-				colorB = hdcDest->brush->color;
-				break;
-
-			case GDI_BS_HATCHED:
-			case GDI_BS_PATTERN:
-			{
-				const BYTE* patp =
-				    gdi_get_brush_pointer(hdcDest, WINPR_ASSERTING_INT_CAST(uint32_t, nXDest + x),
-				                          WINPR_ASSERTING_INT_CAST(uint32_t, nYDest + y));
+		const size_t chunk = MIN(filled, count - filled);
+		memcpy(&row[filled * bpp], row, chunk * bpp);
+		filled += chunk;
+	}
 
-				if (!patp)
-				{
-					WLog_ERR(TAG, "patp=%p", (const void*)patp);
-					return FALSE;
-				}
+	return TRUE;
+}
 
-				colorB = FreeRDPReadColor(patp, hdcDest->format);
-			}
-			break;
+static void BitBlt_convert_src_row(BYTE* WINPR_RESTRICT row, UINT32 dstFormat,
+                                   const BYTE* WINPR_RESTRICT srcp, UINT32 srcFormat,
+                                   size_t count, const gdiPalette* palette)
+{
+	const size_t dstBpp = FreeRDPGetBytesPerPixel(dstFormat);
+	const size_t srcBpp = FreeRDPGetBytesPerPixel(srcFormat);
 
-			default:
-				break;
-		}
+	for (size_t x = 0; x < count; x++)
+	{
+		UINT32 color = FreeRDPReadColor(&srcp[x * srcBpp], srcFormat);
+		color = FreeRDPConvertColor(color, srcFormat, dstFormat, palette);
+		FreeRDPWriteColor(&row[x * dstBpp], dstFormat, color);
 	}
-
-	dstColor = process_rop(colorC, colorA, colorB, rop, hdcDest->format);
-	return FreeRDPWriteColor(dstp, hdcDest->format, dstColor);
 }
 
 static BOOL adjust_src_coordinates(HGDI_DC hdcSrc, INT32 nWidth, INT32 nHeight, INT32* px,
@@ -464,30 +368,19 @@ static BOOL adjust_src_dst_coordinates(HGDI_DC hdcDest, INT32* pnXSrc, INT32* pn
 }
 
 static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32 nHeight,
-                           HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, const char* rop,
+                           HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, DWORD rop,
                            const gdiPalette* palette)
 {
+	BOOL rc = FALSE;
 	UINT32 style = 0;
-	BOOL useSrc = FALSE;
-	BOOL usePat = FALSE;
-	const char* iter = rop;
-
-	while (*iter != '\0')
-	{
-		switch (*iter++)
-		{
-			case 'P':
-				usePat = TRUE;
-				break;
-
-			case 'S':
-				useSrc = TRUE;
-				break;
-
-			default:
-				break;
-		}
-	}
+	UINT32 color = 0;
+	BYTE* srcRow = NULL;
+	BYTE* patRow = NULL;
+	BYTE rop3 = (rop >> 16) & 0xFF;
+	const BOOL useSrc = rop3_uses_src(rop3);
+	BOOL usePat = rop3_uses_pat(rop3);
+	BOOL overlap = FALSE;
+	const primitives_t* prims = primitives_get();
 
 	if (!hdcDest)
 		return FALSE;
@@ -511,6 +404,9 @@ static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nW
 		switch (style)
 		{
 			case GDI_BS_SOLID:
+				color = hdcDest->brush->color;
+				break;
+
 			case GDI_BS_HATCHED:
 			case GDI_BS_PATTERN:
 				break;
@@ -520,57 +416,107 @@ static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nW
 				return FALSE;
 		}
 	}
+	else if ((rop3 == 0x00) || (rop3 == 0xFF))
+	{
+		/* BLACKNESS and WHITENESS keep an opaque alpha channel, fill with a solid color */
+		const BYTE val = (rop3 == 0x00) ? 0x00 : 0xFF;
+		usePat = TRUE;
+		style = GDI_BS_SOLID;
+		color = FreeRDPGetColor(hdcDest->format, val, val, val, 0xFF);
+		rop3 = 0xF0; /* PATCOPY */
+	}
+
+	const HGDI_BITMAP hDstBmp = (HGDI_BITMAP)hdcDest->selectedObject;
+	const size_t bpp = FreeRDPGetBytesPerPixel(hdcDest->format);
+
+	if (!hDstBmp || (bpp == 0))
+		return FALSE;
 
-	if ((nXDest > nXSrc) && (nYDest > nYSrc))
+	if ((nWidth <= 0) || (nHeight <= 0))
+		return TRUE;
+
+	const size_t count = WINPR_ASSERTING_INT_CAST(size_t, nWidth);
+	const size_t rowSize = count * bpp;
+
+	if (rowSize > UINT32_MAX)
+		return FALSE;
+
+	if (useSrc)
 	{
-		for (INT32 y = nHeight - 1; y >= 0; y--)
+		const HGDI_BITMAP hSrcBmp = (HGDI_BITMAP)hdcSrc->selectedObject;
+
+		/* The source row is used in place unless it needs a conversion or may overlap the
+		 * destination */
+		overlap = (hSrcBmp->data == hDstBmp->data);
+
+		if (overlap || (hdcSrc->format != hdcDest->format))
 		{
-			for (INT32 x = nWidth - 1; x >= 0; x--)
-			{
-				if (!BitBlt_write(hdcDest, hdcSrc, nXDest, nYDest, nXSrc, nYSrc, x, y, useSrc,
-				                  usePat, style, rop, palette))
-					return FALSE;
-			}
+			srcRow = malloc(rowSize);
+
+			if (!srcRow)
+				goto fail;
 		}
 	}
-	else if (nXDest > nXSrc)
+
+	if (usePat)
 	{
-		for (INT32 y = 0; y < nHeight; y++)
-		{
-			for (INT32 x = nWidth - 1; x >= 0; x--)
-			{
-				if (!BitBlt_write(hdcDest, hdcSrc, nXDest, nYDest, nXSrc, nYSrc, x, y, useSrc,
-				                  usePat, style, rop, palette))
-					return FALSE;
-			}
-		}
+		patRow = malloc(rowSize);
+
+		if (!patRow)
+			goto fail;
+
+		if (style == GDI_BS_SOLID)
+			BitBlt_fill_color_row(patRow, hdcDest->format, color, count);
 	}
-	else if (nYDest > nYSrc)
+
+	for (INT32 i = 0; i < nHeight; i++)
 	{
-		for (INT32 y = nHeight - 1; y >= 0; y--)
+		/* Process bottom up when moving down within the same bitmap */
+		const INT32 y = (overlap && (nYDest > nYSrc)) ? (nHeight - 1 - i) : i;
+		const BYTE* src = NULL;
+		BYTE* dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
+
+		if (!dstp)
 		{
-			for (INT32 x = 0; x < nWidth; x++)
-			{
-				if (!BitBlt_write(hdcDest, hdcSrc, nXDest, nYDest, nXSrc, nYSrc, x, y, useSrc,
-				                  usePat, style, rop, palette))
-					return FALSE;
-			}
+			WLog_ERR(TAG, "dstp=%p", (const void*)dstp);
+			goto fail;
 		}
-	}
-	else
-	{
-		for (INT32 y = 0; y < nHeight; y++)
+
+		if (useSrc)
 		{
-			for (INT32 x = 0; x < nWidth; x++)
+			const BYTE* srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
+
+			if (!srcp)
 			{
-				if (!BitBlt_write(hdcDest, hdcSrc, nXDest, nYDest, nXSrc, nYSrc, x, y, useSrc,
-				                  usePat, style, rop, palette))
-					return FALSE;
+				WLog_ERR(TAG, "srcp=%p", (const void*)srcp);
+				goto fail;
 			}
+
+			if (hdcSrc->format != hdcDest->format)
+				BitBlt_convert_src_row(srcRow, hdcDest->format, srcp, hdcSrc->format, count,
+				                       palette);
+			else if (overlap)
+				memcpy(srcRow, srcp, rowSize);
+
+			src = srcRow ? srcRow : srcp;
 		}
+
+		if (usePat && (style != GDI_BS_SOLID))
+		{
+			if (!BitBlt_fill_pattern_row(hdcDest, patRow, WINPR_ASSERTING_INT_CAST(UINT32, nXDest),
+			                             WINPR_ASSERTING_INT_CAST(UINT32, nYDest + y), count))
+				goto fail;
+		}
+
+		if (prims->rop3_8u(src, patRow, dstp, (UINT32)rowSize, rop3) != PRIMITIVES_SUCCESS)
+			goto fail;
 	}
 
-	return TRUE;
+	rc = TRUE;
+fail:
+	free(srcRow);
+	free(patRow);
+	return rc;
 }
 
 /**
@@ -664,8 +610,8 @@ BOOL gdi_BitBlt(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32
 			break;
 
 		default:
-			if (!BitBlt_process(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc,
-			                    gdi_rop_to_string(rop), palette))
+			if (!BitBlt_process(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, rop,
+			                    palette))
 				return FALSE;
 
 			break;
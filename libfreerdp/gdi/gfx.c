@@ -196,6 +196,12 @@ static UINT gdi_OutputUpdate(rdpGdi* gdi, gdiGfxSurface* surface)
 	if (!(rects = region16_rects(&surface->invalidRegion, &nbRects)) || !nbRects)
 		return CHANNEL_RC_OK;
 
+	if (!surface->scaler)
+		surface->scaler = freerdp_image_scaler_new();
+
+	if (!surface->scaler)
+		return CHANNEL_RC_NO_MEMORY;
+
 	if (!update_begin_paint(update))
 		goto fail;
 
@@ -210,9 +216,10 @@ static UINT gdi_OutputUpdate(rdpGdi* gdi, gdiGfxSurface* surface)
 		const UINT32 dwidth = MIN((UINT32)(swidth * sx), (UINT32)gdi->width - nXDst);
 		const UINT32 dheight = MIN((UINT32)(sheight * sy), (UINT32)gdi->height - nYDst);
 
-		if (!freerdp_image_scale(gdi->primary_buffer, gdi->dstFormat, gdi->stride, nXDst, nYDst,
-		                         dwidth, dheight, surface->data, surface->format, surface->scanline,
-		                         nXSrc, nYSrc, swidth, sheight))
+		if (!freerdp_image_scaler_scale(surface->scaler, gdi->primary_buffer, gdi->dstFormat,
+		                                gdi->stride, nXDst, nYDst, dwidth, dheight, surface->data,
+		                                surface->format, surface->scanline, nXSrc, nYSrc, swidth,
+		                                sheight))
 		{
 			rc = CHANNEL_RC_NULL_DATA;
 			goto fail;
@@ -1221,6 +1228,7 @@ static UINT gdi_DeleteSurface(RdpgfxClientContext* context,
 		h264_context_free(surface->h264);
 #endif
 		region16_uninit(&surface->invalidRegion);
+		freerdp_image_scaler_free(surface->scaler);
 		codecs = surface->codecs;
 		winpr_aligned_free(surface->data);
 		free(surface);
@@ -0,0 +1,291 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Planar codec plane operations, NEON optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_planar.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* Narrows a byte compare result to 4 bits per byte */
+static inline UINT64 neon_compare_mask(uint8x16_t cmp)
+{
+	const uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+	return vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+}
+
+/* Index of the first byte set in a non zero neon_compare_mask() result */
+static inline UINT32 neon_first_set(UINT64 mask)
+{
+	const UINT32 lo = (UINT32)mask;
+
+	if (lo)
+		return planar_ctz32(lo) / 4;
+
+	return 8 + planar_ctz32((UINT32)(mask >> 32)) / 4;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_planarSplit_8u_AC4P4(const BYTE* WINPR_RESTRICT pSrc, INT32 srcStep,
+                                           UINT32 srcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                           UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pDst || !planar_pixel_offsets(srcFormat, offsets, &hasAlpha))
+		return generic->planarSplit_8u_AC4P4(pSrc, srcStep, srcFormat, pDst, width, height);
+
+	const uint8x16_t opaque = vdupq_n_u8(0xFF);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* pLine = &pSrc[1LL * y * srcStep];
+		const size_t off = 1ULL * y * width;
+		BYTE* pR = &pDst[0][off];
+		BYTE* pG = &pDst[1][off];
+		BYTE* pB = &pDst[2][off];
+		BYTE* pA = &pDst[3][off];
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			const uint8x16x4_t pixels = vld4q_u8(&pLine[4ULL * x]);
+			vst1q_u8(&pR[x], pixels.val[offsets[0]]);
+			vst1q_u8(&pG[x], pixels.val[offsets[1]]);
+			vst1q_u8(&pB[x], pixels.val[offsets[2]]);
+			vst1q_u8(&pA[x], hasAlpha ? pixels.val[offsets[3]] : opaque);
+		}
+
+		planar_split_row_32(&pLine[4ULL * x], offsets, hasAlpha, &pR[x], &pG[x], &pB[x], &pA[x],
+		                    width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_planarMerge_8u_P4AC4(const BYTE* WINPR_RESTRICT pSrc[4],
+                                           BYTE* WINPR_RESTRICT pDst, INT32 dstStep,
+                                           UINT32 dstFormat, UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pSrc[0] || !pSrc[1] || !pSrc[2] || !pDst ||
+	    !planar_pixel_offsets(dstFormat, offsets, &hasAlpha))
+		return generic->planarMerge_8u_P4AC4(pSrc, pDst, dstStep, dstFormat, width, height);
+
+	const uint8x16_t opaque = vdupq_n_u8(0xFF);
+	const BOOL useAlpha = hasAlpha && pSrc[3];
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		BYTE* pLine = &pDst[1LL * y * dstStep];
+		const size_t off = 1ULL * y * width;
+		const BYTE* pR = &pSrc[0][off];
+		const BYTE* pG = &pSrc[1][off];
+		const BYTE* pB = &pSrc[2][off];
+		const BYTE* pA = useAlpha ? &pSrc[3][off] : NULL;
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			uint8x16x4_t pixels;
+			pixels.val[offsets[0]] = vld1q_u8(&pR[x]);
+			pixels.val[offsets[1]] = vld1q_u8(&pG[x]);
+			pixels.val[offsets[2]] = vld1q_u8(&pB[x]);
+			pixels.val[offsets[3]] = pA ? vld1q_u8(&pA[x]) : opaque;
+			vst4q_u8(&pLine[4ULL * x], pixels);
+		}
+
+		planar_merge_row_32(&pR[x], &pG[x], &pB[x], pA ? &pA[x] : NULL, offsets, hasAlpha,
+		                    &pLine[4ULL * x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_planarDeltaEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 width, UINT32 height)
+{
+	if (!pSrc || !pDst)
+		return -1;
+
+	if (height == 0)
+		return PRIMITIVES_SUCCESS;
+
+	memcpy(pDst, pSrc, width);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		const BYTE* pCur = &pSrc[off];
+		const BYTE* pPrev = &pSrc[off - width];
+		BYTE* pOut = &pDst[off];
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			/* (d << 1) ^ (d >> 7) maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ... */
+			const uint8x16_t delta = vsubq_u8(vld1q_u8(&pCur[x]), vld1q_u8(&pPrev[x]));
+			const uint8x16_t sign =
+			    vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(delta), 7));
+			vst1q_u8(&pOut[x], veorq_u8(vshlq_n_u8(delta, 1), sign));
+		}
+
+		planar_delta_encode_row(&pCur[x], &pPrev[x], &pOut[x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_planarDeltaDecode_8u(BYTE* WINPR_RESTRICT pSrcDst, UINT32 width,
+                                           UINT32 height)
+{
+	if (!pSrcDst)
+		return -1;
+
+	const uint8x16_t one = vdupq_n_u8(1);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		BYTE* pCur = &pSrcDst[off];
+		const BYTE* pPrev = &pSrcDst[off - width];
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			const uint8x16_t val = vld1q_u8(&pCur[x]);
+			const uint8x16_t sign =
+			    vreinterpretq_u8_s8(vnegq_s8(vreinterpretq_s8_u8(vandq_u8(val, one))));
+			const uint8x16_t delta = veorq_u8(vshrq_n_u8(val, 1), sign);
+			vst1q_u8(&pCur[x], vaddq_u8(vld1q_u8(&pPrev[x]), delta));
+		}
+
+		planar_delta_decode_row(&pCur[x], &pPrev[x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Offset of the first byte from x on that equals its predecessor, len if there is none */
+static UINT32 neon_next_repeat(const BYTE* WINPR_RESTRICT pSrc, UINT32 x, UINT32 len, BYTE prev)
+{
+	if (x == 0)
+	{
+		if ((len == 0) || (pSrc[0] == prev))
+			return 0;
+		x = 1;
+	}
+
+	for (; x + 16 <= len; x += 16)
+	{
+		const UINT64 eq = neon_compare_mask(vceqq_u8(vld1q_u8(&pSrc[x]), vld1q_u8(&pSrc[x - 1])));
+
+		if (eq)
+			return x + neon_first_set(eq);
+	}
+
+	for (; x < len; x++)
+	{
+		if (pSrc[x] == pSrc[x - 1])
+			return x;
+	}
+
+	return len;
+}
+
+static UINT32 neon_run_length(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE val)
+{
+	const uint8x16_t cmp = vdupq_n_u8(val);
+	UINT32 x = 0;
+
+	for (; x + 16 <= len; x += 16)
+	{
+		const UINT64 ne = neon_compare_mask(vmvnq_u8(vceqq_u8(vld1q_u8(&pSrc[x]), cmp)));
+
+		if (ne)
+			return x + neon_first_set(ne);
+	}
+
+	return x + planar_run_length(&pSrc[x], len - x, val);
+}
+
+static pstatus_t neon_planarFindRun_8u(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE prev,
+                                       UINT32 minRun, UINT32* WINPR_RESTRICT pStart,
+                                       UINT32* WINPR_RESTRICT pLength)
+{
+	if ((!pSrc && (len > 0)) || !pStart || !pLength || (minRun == 0))
+		return -1;
+
+	UINT32 x = 0;
+
+	while ((x = neon_next_repeat(pSrc, x, len, prev)) < len)
+	{
+		const BYTE val = (x > 0) ? pSrc[x - 1] : prev;
+		const UINT32 run = neon_run_length(&pSrc[x], len - x, val);
+
+		if (run >= minRun)
+		{
+			*pStart = x;
+			*pLength = run;
+			return PRIMITIVES_SUCCESS;
+		}
+
+		x += run;
+	}
+
+	*pStart = len;
+	*pLength = 0;
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar_neon_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	prims->planarSplit_8u_AC4P4 = neon_planarSplit_8u_AC4P4;
+	prims->planarMerge_8u_P4AC4 = neon_planarMerge_8u_P4AC4;
+	prims->planarDeltaEncode_8u = neon_planarDeltaEncode_8u;
+	prims->planarDeltaDecode_8u = neon_planarDeltaDecode_8u;
+	prims->planarFindRun_8u = neon_planarFindRun_8u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,109 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Ternary raster operations, NEON optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_rop.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* Operands of the current 16 byte block, only the ones used by an operation are loaded */
+#define ROP_D vld1q_u8(&pDst[x])
+#define ROP_S vld1q_u8(&pSrc[x])
+#define ROP_P vld1q_u8(&pPat[x])
+#define ROP_NOT(a) vmvnq_u8(a)
+
+#define NEON_ROP3_ROUTINE(_name_, _op_)                                                  \
+	static void _name_(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat, \
+	                   BYTE* WINPR_RESTRICT pDst, UINT32 len)                            \
+	{                                                                                    \
+		WINPR_UNUSED(pSrc);                                                              \
+		WINPR_UNUSED(pPat);                                                              \
+		for (UINT32 x = 0; x < len; x += sizeof(uint8x16_t))                             \
+			vst1q_u8(&pDst[x], _op_);                                                    \
+	}
+
+NEON_ROP3_ROUTINE(neon_rop3_NOTSRCCOPY, ROP_NOT(ROP_S))
+NEON_ROP3_ROUTINE(neon_rop3_SRCERASE, vbicq_u8(ROP_S, ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_DSTINVERT, ROP_NOT(ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_PATINVERT, veorq_u8(ROP_P, ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_SRCINVERT, veorq_u8(ROP_S, ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_SRCAND, vandq_u8(ROP_S, ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_PSDPxax, veorq_u8(ROP_P, vandq_u8(ROP_S, veorq_u8(ROP_D, ROP_P))))
+NEON_ROP3_ROUTINE(neon_rop3_MERGEPAINT, vorrq_u8(ROP_NOT(ROP_S), ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_MERGECOPY, vandq_u8(ROP_S, ROP_P))
+NEON_ROP3_ROUTINE(neon_rop3_SRCCOPY, ROP_S)
+NEON_ROP3_ROUTINE(neon_rop3_DSPDxax, veorq_u8(ROP_D, vandq_u8(ROP_S, veorq_u8(ROP_P, ROP_D))))
+NEON_ROP3_ROUTINE(neon_rop3_SRCPAINT, vorrq_u8(ROP_S, ROP_D))
+NEON_ROP3_ROUTINE(neon_rop3_PATCOPY, ROP_P)
+
+static const prim_rop3_kernel_fn neon_kernels[256] = {
+	[PRIM_ROP3_NOTSRCCOPY] = neon_rop3_NOTSRCCOPY, [PRIM_ROP3_SRCERASE] = neon_rop3_SRCERASE,
+	[PRIM_ROP3_DSTINVERT] = neon_rop3_DSTINVERT,   [PRIM_ROP3_PATINVERT] = neon_rop3_PATINVERT,
+	[PRIM_ROP3_SRCINVERT] = neon_rop3_SRCINVERT,   [PRIM_ROP3_SRCAND] = neon_rop3_SRCAND,
+	[PRIM_ROP3_PSDPxax] = neon_rop3_PSDPxax,       [PRIM_ROP3_MERGEPAINT] = neon_rop3_MERGEPAINT,
+	[PRIM_ROP3_MERGECOPY] = neon_rop3_MERGECOPY,   [PRIM_ROP3_SRCCOPY] = neon_rop3_SRCCOPY,
+	[PRIM_ROP3_DSPDxax] = neon_rop3_DSPDxax,       [PRIM_ROP3_SRCPAINT] = neon_rop3_SRCPAINT,
+	[PRIM_ROP3_PATCOPY] = neon_rop3_PATCOPY
+};
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_rop3_8u(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat,
+                              BYTE* WINPR_RESTRICT pDst, UINT32 len, BYTE rop3)
+{
+	const prim_rop3_kernel_fn fkt = neon_kernels[rop3];
+	const UINT32 blocks = len & ~(UINT32)(sizeof(uint8x16_t) - 1);
+
+	if (!fkt || (blocks == 0))
+		return generic->rop3_8u(pSrc, pPat, pDst, len, rop3);
+
+	if (!prim_rop3_check(pSrc, pPat, pDst, rop3))
+		return -1;
+
+	fkt(pSrc, pPat, pDst, blocks);
+
+	if (blocks == len)
+		return PRIMITIVES_SUCCESS;
+
+	return generic->rop3_8u(pSrc ? &pSrc[blocks] : NULL, pPat ? &pPat[blocks] : NULL,
+	                        &pDst[blocks], len - blocks, rop3);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_rop_neon_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	prims->rop3_8u = neon_rop3_8u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
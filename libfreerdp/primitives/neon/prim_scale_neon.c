@@ -0,0 +1,149 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Separable image scaling, NEON optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+#if defined(NEON_INTRINSICS_ENABLED)
+#include <arm_neon.h>
+
+static inline int16x8_t neon_widen(uint8x8_t val)
+{
+	return vreinterpretq_s16_u16(vmovl_u8(val));
+}
+
+/* Weighted sum of the taps of one destination pixel, 32 bit per channel */
+static inline int32x4_t neon_horizontal_pixel(const BYTE* WINPR_RESTRICT src,
+                                              const INT16* WINPR_RESTRICT w, UINT32 taps)
+{
+	int32x4_t acc = vdupq_n_s32(0);
+	UINT32 k = 0;
+
+	for (; k + 1 < taps; k += 2)
+	{
+		const int16x8_t px = neon_widen(vld1_u8(&src[4ULL * k]));
+		acc = vmlal_n_s16(acc, vget_low_s16(px), w[k]);
+		acc = vmlal_n_s16(acc, vget_high_s16(px), w[k + 1]);
+	}
+
+	if (k < taps)
+	{
+		UINT32 val = 0;
+		memcpy(&val, &src[4ULL * k], sizeof(val));
+		const int16x8_t px = neon_widen(vreinterpret_u8_u32(vdup_n_u32(val)));
+		acc = vmlal_n_s16(acc, vget_low_s16(px), w[k]);
+	}
+
+	return acc;
+}
+
+static inline uint8x8_t neon_narrow(int32x4_t a, int32x4_t b)
+{
+	const uint16x8_t val =
+	    vcombine_u16(vqrshrun_n_s32(a, SCALE_WEIGHT_SHIFT), vqrshrun_n_s32(b, SCALE_WEIGHT_SHIFT));
+	return vqmovn_u16(val);
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_scaleHorizontal_8u_C4(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                            UINT32 dstWidth, UINT32 height,
+                                            const UINT32* WINPR_RESTRICT offsets,
+                                            const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const UINT32 width2 = dstWidth & ~1u;
+
+	if (!pSrc || !pDst || !offsets || !weights || (taps == 0))
+		return -1;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* src = &pSrc[1ULL * y * srcStep];
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		for (UINT32 x = 0; x < width2; x += 2)
+		{
+			const int32x4_t a = neon_horizontal_pixel(&src[4ULL * offsets[x]],
+			                                          &weights[1ULL * x * taps], taps);
+			const int32x4_t b = neon_horizontal_pixel(&src[4ULL * offsets[x + 1]],
+			                                          &weights[1ULL * (x + 1) * taps], taps);
+			vst1_u8(&dst[4ULL * x], neon_narrow(a, b));
+		}
+
+		scale_horizontal_pixels(src, dst, width2, dstWidth, offsets, weights, taps);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_scaleVertical_8u_C4(const BYTE* const* WINPR_RESTRICT pSrc,
+                                          const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                          BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	const size_t len = 4ULL * width;
+	const size_t len16 = len & ~(size_t)15;
+
+	if (!pSrc || !weights || !pDst || (taps == 0))
+		return -1;
+
+	for (size_t x = 0; x < len16; x += 16)
+	{
+		int32x4_t acc[4] = { vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0), vdupq_n_s32(0) };
+
+		for (UINT32 k = 0; k < taps; k++)
+		{
+			const uint8x16_t row = vld1q_u8(&pSrc[k][x]);
+			const int16x8_t lo = neon_widen(vget_low_u8(row));
+			const int16x8_t hi = neon_widen(vget_high_u8(row));
+
+			acc[0] = vmlal_n_s16(acc[0], vget_low_s16(lo), weights[k]);
+			acc[1] = vmlal_n_s16(acc[1], vget_high_s16(lo), weights[k]);
+			acc[2] = vmlal_n_s16(acc[2], vget_low_s16(hi), weights[k]);
+			acc[3] = vmlal_n_s16(acc[3], vget_high_s16(hi), weights[k]);
+		}
+
+		vst1q_u8(&pDst[x], vcombine_u8(neon_narrow(acc[0], acc[1]), neon_narrow(acc[2], acc[3])));
+	}
+
+	scale_vertical_bytes(pSrc, weights, taps, pDst, len16, len);
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_neon_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "NEON optimizations");
+	prims->scaleHorizontal_8u_C4 = neon_scaleHorizontal_8u_C4;
+	prims->scaleVertical_8u_C4 = neon_scaleVertical_8u_C4;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or neon intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
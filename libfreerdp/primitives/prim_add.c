@@ -80,4 +80,7 @@ void primitives_init_add_opt(primitives_t* WINPR_RESTRICT prims)
 {
 	primitives_init_add(prims);
 	primitives_init_add_sse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_add_avx2(prims);
+#endif
 }
@@ -95,4 +95,7 @@ void primitives_init_alphaComp_opt(primitives_t* WINPR_RESTRICT prims)
 {
 	primitives_init_alphaComp(prims);
 	primitives_init_alphaComp_sse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_alphaComp_avx2(prims);
+#endif
 }
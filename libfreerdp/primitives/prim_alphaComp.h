@@ -39,4 +39,15 @@ static inline void primitives_init_alphaComp_sse3(primitives_t* WINPR_RESTRICT p
 	primitives_init_alphaComp_sse3_int(prims);
 }
 
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_alphaComp_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_alphaComp_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_alphaComp_avx2_int(prims);
+}
+#endif
+
 #endif
@@ -39,6 +39,17 @@ static inline void primitives_init_colors_sse2(primitives_t* WINPR_RESTRICT prim
 	primitives_init_colors_sse2_int(prims);
 }
 
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_colors_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_colors_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_colors_avx2_int(prims);
+}
+#endif
+
 FREERDP_LOCAL void primitives_init_colors_neon_int(primitives_t* WINPR_RESTRICT prims);
 static inline void primitives_init_colors_neon(primitives_t* WINPR_RESTRICT prims)
 {
@@ -0,0 +1,90 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Tile based image comparison
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_compare.h"
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_compare_tiles_32u(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+                                           const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+                                           UINT32 width, UINT32 height, UINT32 mask,
+                                           BYTE* WINPR_RESTRICT pDirty, UINT32 dirtyStep)
+{
+	const UINT32 ncol = (width + PRIM_COMPARE_TILE_SIZE - 1) / PRIM_COMPARE_TILE_SIZE;
+
+	WINPR_ASSERT(pSrc1);
+	WINPR_ASSERT(pSrc2);
+	WINPR_ASSERT(pDirty);
+	WINPR_ASSERT(dirtyStep >= ncol);
+
+	for (UINT32 ty = 0; ty * PRIM_COMPARE_TILE_SIZE < height; ty++)
+	{
+		const UINT32 y0 = ty * PRIM_COMPARE_TILE_SIZE;
+		const UINT32 th = MIN(PRIM_COMPARE_TILE_SIZE, height - y0);
+		BYTE* dirty = &pDirty[1ull * ty * dirtyStep];
+		UINT32 clean = ncol;
+
+		memset(dirty, 0, ncol);
+
+		/* Walk the band line by line, tiles already found dirty are skipped */
+		for (UINT32 y = 0; (y < th) && (clean > 0); y++)
+		{
+			const BYTE* line1 = &pSrc1[1ull * (y0 + y) * src1Step];
+			const BYTE* line2 = &pSrc2[1ull * (y0 + y) * src2Step];
+
+			for (UINT32 tx = 0; tx < ncol; tx++)
+			{
+				const UINT32 x0 = tx * PRIM_COMPARE_TILE_SIZE;
+				const UINT32 tw = MIN(PRIM_COMPARE_TILE_SIZE, width - x0);
+
+				if (dirty[tx])
+					continue;
+
+				if (!prim_compare_line_32u(&line1[4ull * x0], &line2[4ull * x0], tw, mask))
+				{
+					dirty[tx] = 1;
+					clean--;
+				}
+			}
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_compare(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->compare_tiles_32u = general_compare_tiles_32u;
+}
+
+void primitives_init_compare_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_compare(prims);
+	primitives_init_compare_sse41(prims);
+#if defined(WITH_AVX2)
+	primitives_init_compare_avx2(prims);
+#endif
+	primitives_init_compare_neon(prims);
+}
@@ -0,0 +1,83 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Tile based image comparison
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_COMPARE_H
+#define FREERDP_LIB_PRIM_COMPARE_H
+
+#include <string.h>
+
+#include <winpr/wtypes.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+#define PRIM_COMPARE_TILE_SIZE 16
+
+/* Compare count pixels of a tile line, used for the partial tiles at the right border */
+static inline BOOL prim_compare_line_32u(const BYTE* WINPR_RESTRICT a,
+                                         const BYTE* WINPR_RESTRICT b, UINT32 count, UINT32 mask)
+{
+	if (mask == UINT32_MAX)
+		return memcmp(a, b, 4ull * count) == 0;
+
+	for (UINT32 x = 0; x < count; x++)
+	{
+		UINT32 va = 0;
+		UINT32 vb = 0;
+		memcpy(&va, &a[4ull * x], sizeof(va));
+		memcpy(&vb, &b[4ull * x], sizeof(vb));
+
+		if ((va ^ vb) & mask)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+FREERDP_LOCAL void primitives_init_compare_sse41_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_compare_sse41(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_SSE4_1_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_compare_sse41_int(prims);
+}
+
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_compare_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_compare_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_compare_avx2_int(prims);
+}
+#endif
+
+FREERDP_LOCAL void primitives_init_compare_neon_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_compare_neon(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_compare_neon_int(prims);
+}
+
+#endif
@@ -319,6 +319,10 @@ FREERDP_LOCAL void primitives_init_alphaComp(primitives_t* WINPR_RESTRICT prims)
 FREERDP_LOCAL void primitives_init_colors(primitives_t* WINPR_RESTRICT prims);
 FREERDP_LOCAL void primitives_init_YCoCg(primitives_t* WINPR_RESTRICT prims);
 FREERDP_LOCAL void primitives_init_YUV(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_compare(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_rop(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_planar(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_scale(primitives_t* WINPR_RESTRICT prims);
 
 FREERDP_LOCAL void primitives_init_copy_opt(primitives_t* WINPR_RESTRICT prims);
 FREERDP_LOCAL void primitives_init_set_opt(primitives_t* WINPR_RESTRICT prims);
@@ -330,6 +334,10 @@ FREERDP_LOCAL void primitives_init_alphaComp_opt(primitives_t* WINPR_RESTRICT pr
 FREERDP_LOCAL void primitives_init_colors_opt(primitives_t* WINPR_RESTRICT prims);
 FREERDP_LOCAL void primitives_init_YCoCg_opt(primitives_t* WINPR_RESTRICT prims);
 FREERDP_LOCAL void primitives_init_YUV_opt(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_compare_opt(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_rop_opt(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_planar_opt(primitives_t* WINPR_RESTRICT prims);
+FREERDP_LOCAL void primitives_init_scale_opt(primitives_t* WINPR_RESTRICT prims);
 
 #if defined(WITH_OPENCL)
 FREERDP_LOCAL BOOL primitives_init_opencl(primitives_t* WINPR_RESTRICT prims);
@@ -0,0 +1,176 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Planar codec plane operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+
+#include "prim_internal.h"
+#include "prim_planar.h"
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_planarSplit_8u_AC4P4(const BYTE* WINPR_RESTRICT pSrc, INT32 srcStep,
+                                              UINT32 srcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                              UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pDst)
+		return -1;
+
+	const BOOL is32bpp = planar_pixel_offsets(srcFormat, offsets, &hasAlpha);
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(srcFormat);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* pLine = &pSrc[1LL * y * srcStep];
+		const size_t off = 1ULL * y * width;
+		BYTE* pR = &pDst[0][off];
+		BYTE* pG = &pDst[1][off];
+		BYTE* pB = &pDst[2][off];
+		BYTE* pA = &pDst[3][off];
+
+		if (is32bpp)
+		{
+			planar_split_row_32(pLine, offsets, hasAlpha, pR, pG, pB, pA, width);
+			continue;
+		}
+
+		for (UINT32 x = 0; x < width; x++)
+		{
+			const UINT32 color = FreeRDPReadColor(&pLine[1ULL * x * bpp], srcFormat);
+			FreeRDPSplitColor(color, srcFormat, &pR[x], &pG[x], &pB[x], &pA[x], NULL);
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_planarMerge_8u_P4AC4(const BYTE* WINPR_RESTRICT pSrc[4],
+                                              BYTE* WINPR_RESTRICT pDst, INT32 dstStep,
+                                              UINT32 dstFormat, UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pSrc[0] || !pSrc[1] || !pSrc[2] || !pDst)
+		return -1;
+
+	const BOOL is32bpp = planar_pixel_offsets(dstFormat, offsets, &hasAlpha);
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(dstFormat);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		BYTE* pLine = &pDst[1LL * y * dstStep];
+		const size_t off = 1ULL * y * width;
+		const BYTE* pR = &pSrc[0][off];
+		const BYTE* pG = &pSrc[1][off];
+		const BYTE* pB = &pSrc[2][off];
+		const BYTE* pA = pSrc[3] ? &pSrc[3][off] : NULL;
+
+		if (is32bpp)
+		{
+			planar_merge_row_32(pR, pG, pB, pA, offsets, hasAlpha, pLine, width);
+			continue;
+		}
+
+		for (UINT32 x = 0; x < width; x++)
+		{
+			const UINT32 color =
+			    FreeRDPGetColor(dstFormat, pR[x], pG[x], pB[x], pA ? pA[x] : 0xFF);
+			FreeRDPWriteColor(&pLine[1ULL * x * bpp], dstFormat, color);
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_planarDeltaEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                              BYTE* WINPR_RESTRICT pDst, UINT32 width,
+                                              UINT32 height)
+{
+	if (!pSrc || !pDst)
+		return -1;
+
+	if (height == 0)
+		return PRIMITIVES_SUCCESS;
+
+	memcpy(pDst, pSrc, width);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		planar_delta_encode_row(&pSrc[off], &pSrc[off - width], &pDst[off], width);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_planarDeltaDecode_8u(BYTE* WINPR_RESTRICT pSrcDst, UINT32 width,
+                                              UINT32 height)
+{
+	if (!pSrcDst)
+		return -1;
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		planar_delta_decode_row(&pSrcDst[off], &pSrcDst[off - width], width);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_planarFindRun_8u(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE prev,
+                                          UINT32 minRun, UINT32* WINPR_RESTRICT pStart,
+                                          UINT32* WINPR_RESTRICT pLength)
+{
+	if ((!pSrc && (len > 0)) || !pStart || !pLength || (minRun == 0))
+		return -1;
+
+	planar_find_run(pSrc, 0, len, prev, minRun, pStart, pLength);
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->planarSplit_8u_AC4P4 = general_planarSplit_8u_AC4P4;
+	prims->planarMerge_8u_P4AC4 = general_planarMerge_8u_P4AC4;
+	prims->planarDeltaEncode_8u = general_planarDeltaEncode_8u;
+	prims->planarDeltaDecode_8u = general_planarDeltaDecode_8u;
+	prims->planarFindRun_8u = general_planarFindRun_8u;
+}
+
+void primitives_init_planar_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_planar(prims);
+	primitives_init_planar_ssse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_planar_avx2(prims);
+#endif
+	primitives_init_planar_neon(prims);
+}
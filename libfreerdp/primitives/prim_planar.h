@@ -0,0 +1,209 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Planar codec plane operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_PLANAR_H
+#define FREERDP_LIB_PRIM_PLANAR_H
+
+#include <winpr/wtypes.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+
+#include "prim_internal.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Byte offsets of red, green, blue and alpha within a 32bpp pixel. Returns FALSE for all other
+ * formats. */
+static inline BOOL planar_pixel_offsets(UINT32 format, BYTE offsets[4], BOOL* hasAlpha)
+{
+	static const BYTE argb[4] = { 1, 2, 3, 0 };
+	static const BYTE abgr[4] = { 3, 2, 1, 0 };
+	static const BYTE rgba[4] = { 0, 1, 2, 3 };
+	static const BYTE bgra[4] = { 2, 1, 0, 3 };
+	const BYTE* src = NULL;
+
+	switch (format)
+	{
+		case PIXEL_FORMAT_ARGB32:
+		case PIXEL_FORMAT_XRGB32:
+			src = argb;
+			break;
+		case PIXEL_FORMAT_ABGR32:
+		case PIXEL_FORMAT_XBGR32:
+			src = abgr;
+			break;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			src = rgba;
+			break;
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			src = bgra;
+			break;
+		default:
+			return FALSE;
+	}
+
+	for (size_t x = 0; x < 4; x++)
+		offsets[x] = src[x];
+	*hasAlpha = FreeRDPColorHasAlpha(format);
+	return TRUE;
+}
+
+static inline UINT32 planar_ctz32(UINT32 val)
+{
+#if defined(_MSC_VER)
+	unsigned long idx = 0;
+	_BitScanForward(&idx, val);
+	return (UINT32)idx;
+#else
+	return (UINT32)__builtin_ctz(val);
+#endif
+}
+
+/* Scalar row kernels, shared by the generic implementation and the tails of the SIMD ones */
+static inline void planar_split_row_32(const BYTE* WINPR_RESTRICT pSrc, const BYTE offsets[4],
+                                       BOOL hasAlpha, BYTE* WINPR_RESTRICT pR,
+                                       BYTE* WINPR_RESTRICT pG, BYTE* WINPR_RESTRICT pB,
+                                       BYTE* WINPR_RESTRICT pA, UINT32 width)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		const BYTE* pixel = &pSrc[4ULL * x];
+		pR[x] = pixel[offsets[0]];
+		pG[x] = pixel[offsets[1]];
+		pB[x] = pixel[offsets[2]];
+		pA[x] = hasAlpha ? pixel[offsets[3]] : 0xFF;
+	}
+}
+
+static inline void planar_merge_row_32(const BYTE* WINPR_RESTRICT pR,
+                                       const BYTE* WINPR_RESTRICT pG,
+                                       const BYTE* WINPR_RESTRICT pB,
+                                       const BYTE* WINPR_RESTRICT pA, const BYTE offsets[4],
+                                       BOOL hasAlpha, BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		BYTE* pixel = &pDst[4ULL * x];
+		pixel[offsets[0]] = pR[x];
+		pixel[offsets[1]] = pG[x];
+		pixel[offsets[2]] = pB[x];
+		pixel[offsets[3]] = (hasAlpha && pA) ? pA[x] : 0xFF;
+	}
+}
+
+static inline void planar_delta_encode_row(const BYTE* WINPR_RESTRICT pCur,
+                                           const BYTE* WINPR_RESTRICT pPrev,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		const BYTE delta = (BYTE)(pCur[x] - pPrev[x]);
+		pDst[x] = (BYTE)((delta << 1) ^ ((delta & 0x80) ? 0xFF : 0x00));
+	}
+}
+
+static inline void planar_delta_decode_row(BYTE* WINPR_RESTRICT pCur,
+                                           const BYTE* WINPR_RESTRICT pPrev, UINT32 width)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		const BYTE val = pCur[x];
+		const BYTE delta = (BYTE)((val >> 1) ^ ((val & 1) ? 0xFF : 0x00));
+		pCur[x] = (BYTE)(pPrev[x] + delta);
+	}
+}
+
+/* Number of bytes at the start of pSrc equal to val */
+static inline UINT32 planar_run_length(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE val)
+{
+	UINT32 x = 0;
+
+	while ((x < len) && (pSrc[x] == val))
+		x++;
+
+	return x;
+}
+
+/* Scalar run search from offset x on, see fn_planarFindRun_8u_t */
+static inline void planar_find_run(const BYTE* WINPR_RESTRICT pSrc, UINT32 x, UINT32 len,
+                                   BYTE prev, UINT32 minRun, UINT32* WINPR_RESTRICT pStart,
+                                   UINT32* WINPR_RESTRICT pLength)
+{
+	while (x < len)
+	{
+		const BYTE val = (x > 0) ? pSrc[x - 1] : prev;
+
+		if (pSrc[x] != val)
+		{
+			x++;
+			continue;
+		}
+
+		const UINT32 run = planar_run_length(&pSrc[x], len - x, val);
+		if (run >= minRun)
+		{
+			*pStart = x;
+			*pLength = run;
+			return;
+		}
+
+		x += run;
+	}
+
+	*pStart = len;
+	*pLength = 0;
+}
+
+FREERDP_LOCAL void primitives_init_planar_ssse3_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_planar_ssse3(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresentEx(PF_EX_SSSE3) ||
+	    !IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE) ||
+	    !IsProcessorFeaturePresent(PF_SSE3_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_planar_ssse3_int(prims);
+}
+
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_planar_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_planar_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_planar_avx2_int(prims);
+}
+#endif
+
+FREERDP_LOCAL void primitives_init_planar_neon_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_planar_neon(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_planar_neon_int(prims);
+}
+
+#endif
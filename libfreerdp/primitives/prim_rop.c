@@ -0,0 +1,171 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Ternary raster operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_rop.h"
+
+/* Sum of the minterms of the truth table. Called with a constant rop3 the compiler folds this
+ * into the few logical operations the raster operation actually needs. */
+static INLINE UINT64 rop3_eval(BYTE rop3, UINT64 D, UINT64 S, UINT64 P)
+{
+	UINT64 r = 0;
+
+	if (rop3 & 0x01)
+		r |= ~P & ~S & ~D;
+	if (rop3 & 0x02)
+		r |= ~P & ~S & D;
+	if (rop3 & 0x04)
+		r |= ~P & S & ~D;
+	if (rop3 & 0x08)
+		r |= ~P & S & D;
+	if (rop3 & 0x10)
+		r |= P & ~S & ~D;
+	if (rop3 & 0x20)
+		r |= P & ~S & D;
+	if (rop3 & 0x40)
+		r |= P & S & ~D;
+	if (rop3 & 0x80)
+		r |= P & S & D;
+
+	return r;
+}
+
+static INLINE UINT64 rop3_load(const BYTE* WINPR_RESTRICT ptr, BOOL used)
+{
+	UINT64 val = 0;
+
+	if (used)
+		memcpy(&val, ptr, sizeof(val));
+
+	return val;
+}
+
+static INLINE BYTE rop3_load_byte(const BYTE* WINPR_RESTRICT ptr, BOOL used)
+{
+	return used ? *ptr : 0;
+}
+
+/* Instantiate a row kernel for every ROP3 index, processing 64 bit words */
+#define ROP3_KERNEL(code)                                                                      \
+	static void rop3_kernel_##code(const BYTE* WINPR_RESTRICT pSrc,                            \
+	                               const BYTE* WINPR_RESTRICT pPat, BYTE* WINPR_RESTRICT pDst, \
+	                               UINT32 len)                                                 \
+	{                                                                                          \
+		const BOOL useD = PRIM_ROP3_USES_DST(code);                                            \
+		const BOOL useS = PRIM_ROP3_USES_SRC(code);                                            \
+		const BOOL useP = PRIM_ROP3_USES_PAT(code);                                            \
+		UINT32 x = 0;                                                                          \
+                                                                                               \
+		for (; x + sizeof(UINT64) <= len; x += sizeof(UINT64))                                 \
+		{                                                                                      \
+			const UINT64 D = rop3_load(&pDst[x], useD);                                        \
+			const UINT64 S = rop3_load(useS ? &pSrc[x] : NULL, useS);                          \
+			const UINT64 P = rop3_load(useP ? &pPat[x] : NULL, useP);                          \
+			const UINT64 R = rop3_eval(code, D, S, P);                                         \
+			memcpy(&pDst[x], &R, sizeof(R));                                                   \
+		}                                                                                      \
+                                                                                               \
+		for (; x < len; x++)                                                                   \
+		{                                                                                      \
+			const BYTE D = rop3_load_byte(&pDst[x], useD);                                     \
+			const BYTE S = rop3_load_byte(useS ? &pSrc[x] : NULL, useS);                       \
+			const BYTE P = rop3_load_byte(useP ? &pPat[x] : NULL, useP);                       \
+			pDst[x] = (BYTE)rop3_eval(code, D, S, P);                                          \
+		}                                                                                      \
+	}
+
+#define ROP3_KERNELS_16(h) \
+	ROP3_KERNEL(h##0)      \
+	ROP3_KERNEL(h##1)      \
+	ROP3_KERNEL(h##2)      \
+	ROP3_KERNEL(h##3)      \
+	ROP3_KERNEL(h##4)      \
+	ROP3_KERNEL(h##5)      \
+	ROP3_KERNEL(h##6)      \
+	ROP3_KERNEL(h##7)      \
+	ROP3_KERNEL(h##8)      \
+	ROP3_KERNEL(h##9)      \
+	ROP3_KERNEL(h##A)      \
+	ROP3_KERNEL(h##B)      \
+	ROP3_KERNEL(h##C)      \
+	ROP3_KERNEL(h##D)      \
+	ROP3_KERNEL(h##E)      \
+	ROP3_KERNEL(h##F)
+
+#define ROP3_TABLE_16(h)                                                                \
+	rop3_kernel_##h##0, rop3_kernel_##h##1, rop3_kernel_##h##2, rop3_kernel_##h##3,     \
+	    rop3_kernel_##h##4, rop3_kernel_##h##5, rop3_kernel_##h##6, rop3_kernel_##h##7, \
+	    rop3_kernel_##h##8, rop3_kernel_##h##9, rop3_kernel_##h##A, rop3_kernel_##h##B, \
+	    rop3_kernel_##h##C, rop3_kernel_##h##D, rop3_kernel_##h##E, rop3_kernel_##h##F
+
+ROP3_KERNELS_16(0x0)
+ROP3_KERNELS_16(0x1)
+ROP3_KERNELS_16(0x2)
+ROP3_KERNELS_16(0x3)
+ROP3_KERNELS_16(0x4)
+ROP3_KERNELS_16(0x5)
+ROP3_KERNELS_16(0x6)
+ROP3_KERNELS_16(0x7)
+ROP3_KERNELS_16(0x8)
+ROP3_KERNELS_16(0x9)
+ROP3_KERNELS_16(0xA)
+ROP3_KERNELS_16(0xB)
+ROP3_KERNELS_16(0xC)
+ROP3_KERNELS_16(0xD)
+ROP3_KERNELS_16(0xE)
+ROP3_KERNELS_16(0xF)
+
+static const prim_rop3_kernel_fn rop3_kernels[256] = {
+	ROP3_TABLE_16(0x0), ROP3_TABLE_16(0x1), ROP3_TABLE_16(0x2), ROP3_TABLE_16(0x3),
+	ROP3_TABLE_16(0x4), ROP3_TABLE_16(0x5), ROP3_TABLE_16(0x6), ROP3_TABLE_16(0x7),
+	ROP3_TABLE_16(0x8), ROP3_TABLE_16(0x9), ROP3_TABLE_16(0xA), ROP3_TABLE_16(0xB),
+	ROP3_TABLE_16(0xC), ROP3_TABLE_16(0xD), ROP3_TABLE_16(0xE), ROP3_TABLE_16(0xF)
+};
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_rop3_8u(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat,
+                                 BYTE* WINPR_RESTRICT pDst, UINT32 len, BYTE rop3)
+{
+	if (!prim_rop3_check(pSrc, pPat, pDst, rop3))
+		return -1;
+
+	rop3_kernels[rop3](pSrc, pPat, pDst, len);
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_rop(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->rop3_8u = general_rop3_8u;
+}
+
+void primitives_init_rop_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_rop(prims);
+	primitives_init_rop_sse2(prims);
+#if defined(WITH_AVX2)
+	primitives_init_rop_avx2(prims);
+#endif
+	primitives_init_rop_neon(prims);
+}
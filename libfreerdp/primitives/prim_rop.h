@@ -0,0 +1,95 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Ternary raster operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_ROP_H
+#define FREERDP_LIB_PRIM_ROP_H
+
+#include <winpr/wtypes.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+/* The ROP3 index is the truth table of the operation, bit (P << 2) | (S << 1) | D */
+#define PRIM_ROP3_USES_DST(rop3) (((((rop3) >> 1) ^ (rop3)) & 0x55) != 0)
+#define PRIM_ROP3_USES_SRC(rop3) (((((rop3) >> 2) ^ (rop3)) & 0x33) != 0)
+#define PRIM_ROP3_USES_PAT(rop3) (((((rop3) >> 4) ^ (rop3)) & 0x0F) != 0)
+
+typedef void (*prim_rop3_kernel_fn)(const BYTE* WINPR_RESTRICT pSrc,
+                                    const BYTE* WINPR_RESTRICT pPat, BYTE* WINPR_RESTRICT pDst,
+                                    UINT32 len);
+
+static inline BOOL prim_rop3_check(const BYTE* WINPR_RESTRICT pSrc,
+                                   const BYTE* WINPR_RESTRICT pPat, const BYTE* WINPR_RESTRICT pDst,
+                                   BYTE rop3)
+{
+	if (!pDst)
+		return FALSE;
+	if (PRIM_ROP3_USES_SRC(rop3) && !pSrc)
+		return FALSE;
+	if (PRIM_ROP3_USES_PAT(rop3) && !pPat)
+		return FALSE;
+	return TRUE;
+}
+
+/* ROP3 indices with dedicated SIMD kernels */
+#define PRIM_ROP3_NOTSRCCOPY 0x33 /* ~S */
+#define PRIM_ROP3_SRCERASE 0x44   /* S & ~D */
+#define PRIM_ROP3_DSTINVERT 0x55  /* ~D */
+#define PRIM_ROP3_PATINVERT 0x5A  /* P ^ D */
+#define PRIM_ROP3_SRCINVERT 0x66  /* S ^ D */
+#define PRIM_ROP3_SRCAND 0x88     /* S & D */
+#define PRIM_ROP3_PSDPxax 0xB8    /* (S & D) | (~S & P) */
+#define PRIM_ROP3_MERGEPAINT 0xBB /* ~S | D */
+#define PRIM_ROP3_MERGECOPY 0xC0  /* S & P */
+#define PRIM_ROP3_SRCCOPY 0xCC    /* S */
+#define PRIM_ROP3_DSPDxax 0xE2    /* (S & P) | (~S & D) */
+#define PRIM_ROP3_SRCPAINT 0xEE   /* S | D */
+#define PRIM_ROP3_PATCOPY 0xF0    /* P */
+
+FREERDP_LOCAL void primitives_init_rop_sse2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_rop_sse2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_rop_sse2_int(prims);
+}
+
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_rop_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_rop_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_rop_avx2_int(prims);
+}
+#endif
+
+FREERDP_LOCAL void primitives_init_rop_neon_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_rop_neon(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_rop_neon_int(prims);
+}
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Separable image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_scaleHorizontal_8u_C4(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                               BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                               UINT32 dstWidth, UINT32 height,
+                                               const UINT32* WINPR_RESTRICT offsets,
+                                               const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	if (!pSrc || !pDst || !offsets || !weights || (taps == 0))
+		return -1;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		scale_horizontal_pixels(&pSrc[1ULL * y * srcStep], &pDst[1ULL * y * dstStep], 0, dstWidth,
+		                        offsets, weights, taps);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_scaleVertical_8u_C4(const BYTE* const* WINPR_RESTRICT pSrc,
+                                             const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                             BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	if (!pSrc || !weights || !pDst || (taps == 0))
+		return -1;
+
+	scale_vertical_bytes(pSrc, weights, taps, pDst, 0, 4ULL * width);
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->scaleHorizontal_8u_C4 = general_scaleHorizontal_8u_C4;
+	prims->scaleVertical_8u_C4 = general_scaleVertical_8u_C4;
+}
+
+void primitives_init_scale_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_scale(prims);
+	primitives_init_scale_sse41(prims);
+#if defined(WITH_AVX2)
+	primitives_init_scale_avx2(prims);
+#endif
+	primitives_init_scale_neon(prims);
+}
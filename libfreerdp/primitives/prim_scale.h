@@ -0,0 +1,117 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Separable image scaling
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_SCALE_H
+#define FREERDP_LIB_PRIM_SCALE_H
+
+#include <winpr/wtypes.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+
+/* Weights are 14 bit fixed point */
+#define SCALE_WEIGHT_SHIFT 14
+#define SCALE_WEIGHT_ROUND (1 << (SCALE_WEIGHT_SHIFT - 1))
+
+static inline BYTE scale_clamp(INT32 sum)
+{
+	const INT32 val = (sum + SCALE_WEIGHT_ROUND) >> SCALE_WEIGHT_SHIFT;
+
+	if (val < 0)
+		return 0;
+	if (val > 0xFF)
+		return 0xFF;
+	return (BYTE)val;
+}
+
+/* Two weights packed for a 16 bit multiply-add of interleaved samples */
+static inline UINT32 scale_weight_pair(INT16 w0, INT16 w1)
+{
+	return (UINT32)(UINT16)w0 | ((UINT32)(UINT16)w1 << 16);
+}
+
+/* Scalar row kernels, shared by the generic implementation and the tails of the SIMD ones */
+static inline void scale_horizontal_pixels(const BYTE* WINPR_RESTRICT pSrc,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 start, UINT32 end,
+                                           const UINT32* WINPR_RESTRICT offsets,
+                                           const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	for (UINT32 x = start; x < end; x++)
+	{
+		const BYTE* src = &pSrc[4ULL * offsets[x]];
+		const INT16* w = &weights[1ULL * x * taps];
+		INT32 sum[4] = { 0 };
+
+		for (UINT32 k = 0; k < taps; k++)
+		{
+			for (size_t c = 0; c < 4; c++)
+				sum[c] += src[4ULL * k + c] * w[k];
+		}
+
+		for (size_t c = 0; c < 4; c++)
+			pDst[4ULL * x + c] = scale_clamp(sum[c]);
+	}
+}
+
+static inline void scale_vertical_bytes(const BYTE* const* WINPR_RESTRICT pSrc,
+                                        const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                        BYTE* WINPR_RESTRICT pDst, size_t start, size_t end)
+{
+	for (size_t x = start; x < end; x++)
+	{
+		INT32 sum = 0;
+
+		for (UINT32 k = 0; k < taps; k++)
+			sum += pSrc[k][x] * weights[k];
+
+		pDst[x] = scale_clamp(sum);
+	}
+}
+
+FREERDP_LOCAL void primitives_init_scale_sse41_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_scale_sse41(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_SSE4_1_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_scale_sse41_int(prims);
+}
+
+#if defined(WITH_AVX2)
+FREERDP_LOCAL void primitives_init_scale_avx2_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_scale_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_scale_avx2_int(prims);
+}
+#endif
+
+FREERDP_LOCAL void primitives_init_scale_neon_int(primitives_t* WINPR_RESTRICT prims);
+static inline void primitives_init_scale_neon(primitives_t* WINPR_RESTRICT prims)
+{
+	if (!IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	primitives_init_scale_neon_int(prims);
+}
+
+#endif
@@ -147,4 +147,7 @@ void primitives_init_shift_opt(primitives_t* WINPR_RESTRICT prims)
 {
 	primitives_init_shift(prims);
 	primitives_init_shift_sse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_shift_avx2(prims);
+#endif
 }
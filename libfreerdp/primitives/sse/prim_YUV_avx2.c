@@ -0,0 +1,868 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized YUV/RGB conversion operations using AVX2
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/wtypes.h>
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+#include <winpr/crt.h>
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_avxsse.h"
+#include "prim_YUV.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/*
+ * The kernels below are the SSE4.1 ones widened to 256 bit. Most AVX2 integer instructions
+ * operate on the two 128 bit lanes independently, so wherever a result spans lanes it is put
+ * back into pixel order with a cross lane permutation.
+ */
+
+/* dword order of a packus/packs of two hadd results of four 8 pixel loads */
+#define AVX2_PACK_ORDER _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)
+
+static inline __m256i avx2_pack_order(__m256i val)
+{
+	return _mm256_permutevar8x32_epi32(val, AVX2_PACK_ORDER);
+}
+
+/* The lower 64 bit of both lanes */
+static inline __m128i avx2_low_qwords(__m256i val)
+{
+	return _mm256_castsi256_si128(_mm256_permute4x64_epi64(val, 0x08));
+}
+
+static inline __m256i mm256_broadcast_epu8(__m128i val)
+{
+	return _mm256_broadcastsi128_si256(val);
+}
+
+/****************************************************************************/
+/* AVX2 YUV -> RGB conversion                                               */
+/****************************************************************************/
+
+/* input are uint16_t vectors */
+static inline __m256i avx2_yuv2x_single(const __m256i Y, __m256i U, __m256i V, const short iMulU,
+                                        const short iMulV)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	__m256i Ylo = _mm256_unpacklo_epi16(Y, zero);
+	__m256i Yhi = _mm256_unpackhi_epi16(Y, zero);
+	if (iMulU != 0)
+	{
+		const __m256i addX = _mm256_set1_epi16(128);
+		const __m256i D = _mm256_sub_epi16(U, addX);
+		const __m256i mulU = _mm256_set1_epi16(iMulU);
+		const __m256i mulDlo = _mm256_mullo_epi16(D, mulU);
+		const __m256i mulDhi = _mm256_mulhi_epi16(D, mulU);
+		Ylo = _mm256_add_epi32(Ylo, _mm256_unpacklo_epi16(mulDlo, mulDhi));
+		Yhi = _mm256_add_epi32(Yhi, _mm256_unpackhi_epi16(mulDlo, mulDhi));
+	}
+	if (iMulV != 0)
+	{
+		const __m256i addX = _mm256_set1_epi16(128);
+		const __m256i E = _mm256_sub_epi16(V, addX);
+		const __m256i mulV = _mm256_set1_epi16(iMulV);
+		const __m256i mulElo = _mm256_mullo_epi16(E, mulV);
+		const __m256i mulEhi = _mm256_mulhi_epi16(E, mulV);
+		Ylo = _mm256_add_epi32(Ylo, _mm256_unpacklo_epi16(mulElo, mulEhi));
+		Yhi = _mm256_add_epi32(Yhi, _mm256_unpackhi_epi16(mulElo, mulEhi));
+	}
+
+	const __m256i rYlo = _mm256_srai_epi32(Ylo, 8);
+	const __m256i rYhi = _mm256_srai_epi32(Yhi, 8);
+	return _mm256_packs_epi32(rYlo, rYhi);
+}
+
+/* Input are uint8_t vectors, the unpack and pack steps are symmetric so the result is in pixel
+ * order */
+static inline __m256i avx2_yuv2x(const __m256i Y, __m256i U, __m256i V, const short iMulU,
+                                 const short iMulV)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	/* Ylo = Y * 256
+	 * Ulo = uint8_t -> uint16_t
+	 * Vlo = uint8_t -> uint16_t
+	 */
+	const __m256i Ylo = _mm256_unpacklo_epi8(zero, Y);
+	const __m256i Ulo = _mm256_unpacklo_epi8(U, zero);
+	const __m256i Vlo = _mm256_unpacklo_epi8(V, zero);
+	const __m256i preslo = avx2_yuv2x_single(Ylo, Ulo, Vlo, iMulU, iMulV);
+
+	const __m256i Yhi = _mm256_unpackhi_epi8(zero, Y);
+	const __m256i Uhi = _mm256_unpackhi_epi8(U, zero);
+	const __m256i Vhi = _mm256_unpackhi_epi8(V, zero);
+	const __m256i preshi = avx2_yuv2x_single(Yhi, Uhi, Vhi, iMulU, iMulV);
+
+	return _mm256_packus_epi16(preslo, preshi);
+}
+
+/* const INT32 r = ((256L * C(Y) + 0L * D(U) + 403L * E(V))) >> 8; */
+static inline __m256i avx2_yuv2r(const __m256i Y, __m256i U, __m256i V)
+{
+	return avx2_yuv2x(Y, U, V, 0, 403);
+}
+
+/*  const INT32 g = ((256L * C(Y) - 48L * D(U) - 120L * E(V))) >> 8; */
+static inline __m256i avx2_yuv2g(const __m256i Y, __m256i U, __m256i V)
+{
+	return avx2_yuv2x(Y, U, V, -48, -120);
+}
+
+/* const INT32 b = ((256L * C(Y) + 475L * D(U) + 0L * E(V))) >> 8; */
+static inline __m256i avx2_yuv2b(const __m256i Y, __m256i U, __m256i V)
+{
+	return avx2_yuv2x(Y, U, V, 475, 0);
+}
+
+/* Convert 32 pixels, the alpha channel of the destination is not touched */
+static inline void avx2_BGRX_fillRGB_pixel(BYTE* WINPR_RESTRICT pRGB, __m256i Y, __m256i U,
+                                           __m256i V)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i amask = _mm256_set1_epi32((int32_t)0xFF000000);
+	const __m256i r = avx2_yuv2r(Y, U, V);
+	const __m256i g = avx2_yuv2g(Y, U, V);
+	const __m256i b = avx2_yuv2b(Y, U, V);
+
+	const __m256i bglo = _mm256_unpacklo_epi8(b, g);
+	const __m256i bghi = _mm256_unpackhi_epi8(b, g);
+	const __m256i rxlo = _mm256_unpacklo_epi8(r, zero);
+	const __m256i rxhi = _mm256_unpackhi_epi8(r, zero);
+
+	/* pixels 0-3|16-19, 4-7|20-23, 8-11|24-27 and 12-15|28-31 */
+	const __m256i bgrx0 = _mm256_unpacklo_epi16(bglo, rxlo);
+	const __m256i bgrx1 = _mm256_unpackhi_epi16(bglo, rxlo);
+	const __m256i bgrx2 = _mm256_unpacklo_epi16(bghi, rxhi);
+	const __m256i bgrx3 = _mm256_unpackhi_epi16(bghi, rxhi);
+	const __m256i bgrx[] = { _mm256_permute2x128_si256(bgrx0, bgrx1, 0x20),
+		                     _mm256_permute2x128_si256(bgrx2, bgrx3, 0x20),
+		                     _mm256_permute2x128_si256(bgrx0, bgrx1, 0x31),
+		                     _mm256_permute2x128_si256(bgrx2, bgrx3, 0x31) };
+
+	__m256i* rgb = (__m256i*)pRGB;
+	for (size_t i = 0; i < ARRAYSIZE(bgrx); i++)
+	{
+		const __m256i alpha = _mm256_and_si256(_mm256_loadu_si256(&rgb[i]), amask);
+		_mm256_storeu_si256(&rgb[i], _mm256_or_si256(bgrx[i], alpha));
+	}
+}
+
+/* 16 chroma samples to 32 by duplicating each one */
+static inline __m256i avx2_duplicate(const BYTE* WINPR_RESTRICT data)
+{
+	const __m256i val = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)data));
+	return _mm256_or_si256(val, _mm256_slli_epi16(val, 8));
+}
+
+static inline pstatus_t avx2_YUV420ToRGB_BGRX(const BYTE* WINPR_RESTRICT pSrc[],
+                                              const UINT32* WINPR_RESTRICT srcStep,
+                                              BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                              UINT32 DstFormat,
+                                              const prim_size_t* WINPR_RESTRICT roi)
+{
+	const UINT32 nWidth = roi->width - roi->width % 32;
+
+	for (size_t y = 0; y < roi->height; y++)
+	{
+		BYTE* dst = pDst + dstStep * y;
+		const BYTE* YData = pSrc[0] + y * srcStep[0];
+		const BYTE* UData = pSrc[1] + (y / 2) * srcStep[1];
+		const BYTE* VData = pSrc[2] + (y / 2) * srcStep[2];
+
+		for (size_t x = 0; x < nWidth; x += 32)
+		{
+			const __m256i Y = _mm256_loadu_si256((const __m256i*)&YData[x]);
+			const __m256i U = avx2_duplicate(&UData[x / 2]);
+			const __m256i V = avx2_duplicate(&VData[x / 2]);
+			avx2_BGRX_fillRGB_pixel(&dst[4 * x], Y, U, V);
+		}
+	}
+
+	if (nWidth == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	const BYTE* pTail[] = { pSrc[0] + nWidth, pSrc[1] + nWidth / 2, pSrc[2] + nWidth / 2 };
+	const prim_size_t tail = { roi->width - nWidth, roi->height };
+	return generic->YUV420ToRGB_8u_P3AC4R(pTail, srcStep, pDst + 4ULL * nWidth, dstStep, DstFormat,
+	                                      &tail);
+}
+
+static pstatus_t avx2_YUV420ToRGB(const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
+                                  BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+                                  const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_YUV420ToRGB_BGRX(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+
+		default:
+			return generic->YUV420ToRGB_8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+	}
+}
+
+static inline __m256i odd1sum(__m256i u1)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i u1hi = _mm256_unpackhi_epi8(u1, zero);
+	const __m256i u1lo = _mm256_unpacklo_epi8(u1, zero);
+	return _mm256_hadds_epi16(u1lo, u1hi);
+}
+
+static inline __m256i odd0sum(__m256i u0, __m256i u1sum)
+{
+	/* Mask out even bytes, extend uint8_t to uint16_t by filling in zero bytes,
+	 * horizontally add the values */
+	const __m256i mask =
+	    mm256_broadcast_epu8(mm_set_epu8(0x80, 0x0F, 0x80, 0x0D, 0x80, 0x0B, 0x80, 0x09, 0x80, 0x07,
+	                                     0x80, 0x05, 0x80, 0x03, 0x80, 0x01));
+	const __m256i u0odd = _mm256_shuffle_epi8(u0, mask);
+	return _mm256_adds_epi16(u1sum, u0odd);
+}
+
+static inline __m256i calcavg(__m256i u0even, __m256i sum)
+{
+	const __m256i u4zero = _mm256_slli_epi16(u0even, 2);
+	const __m256i uavg = _mm256_sub_epi16(u4zero, sum);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i savg = _mm256_packus_epi16(uavg, zero);
+	const __m256i smask =
+	    mm256_broadcast_epu8(mm_set_epu8(0x80, 0x07, 0x80, 0x06, 0x80, 0x05, 0x80, 0x04, 0x80, 0x03,
+	                                     0x80, 0x02, 0x80, 0x01, 0x80, 0x00));
+	return _mm256_shuffle_epi8(savg, smask);
+}
+
+static inline __m256i diffmask(__m256i avg, __m256i u0even)
+{
+	/* Check for values >= 30 to apply the avg value to
+	 * use int16 for calculations to avoid issues with signed 8bit integers
+	 */
+	const __m256i diff = _mm256_subs_epi16(u0even, avg);
+	const __m256i absdiff = _mm256_abs_epi16(diff);
+	const __m256i val30 = _mm256_set1_epi16(30);
+	return _mm256_cmpgt_epi16(val30, absdiff);
+}
+
+static inline void avx2_filter(__m256i pU[2])
+{
+	const __m256i u1sum = odd1sum(pU[1]);
+	const __m256i sum = odd0sum(pU[0], u1sum);
+
+	/* Mask out the odd bytes. We don´t need to do anything to make the uint8_t to uint16_t */
+	const __m256i emask = _mm256_set1_epi16(0x00ff);
+	const __m256i u0even = _mm256_and_si256(pU[0], emask);
+	const __m256i avg = calcavg(u0even, sum);
+	const __m256i umask = diffmask(avg, u0even);
+
+	const __m256i u0orig = _mm256_and_si256(u0even, umask);
+	const __m256i u0avg = _mm256_andnot_si256(umask, avg);
+	const __m256i evenresult = _mm256_or_si256(u0orig, u0avg);
+	const __m256i omask = _mm256_set1_epi16((int16_t)0xff00);
+	const __m256i u0odd = _mm256_and_si256(pU[0], omask);
+	pU[0] = _mm256_or_si256(evenresult, u0odd);
+}
+
+static inline void avx2_YUV444ToRGB_8u_P3AC4R_BGRX_DOUBLE_ROW(BYTE* WINPR_RESTRICT pDst[2],
+                                                              const BYTE* WINPR_RESTRICT YData[2],
+                                                              const BYTE* WINPR_RESTRICT UData[2],
+                                                              const BYTE* WINPR_RESTRICT VData[2],
+                                                              UINT32 nWidth)
+{
+	for (size_t x = 0; x < nWidth; x += 32)
+	{
+		const __m256i Y[] = { _mm256_loadu_si256((const __m256i*)&YData[0][x]),
+			                  _mm256_loadu_si256((const __m256i*)&YData[1][x]) };
+		__m256i U[] = { _mm256_loadu_si256((const __m256i*)&UData[0][x]),
+			            _mm256_loadu_si256((const __m256i*)&UData[1][x]) };
+		__m256i V[] = { _mm256_loadu_si256((const __m256i*)&VData[0][x]),
+			            _mm256_loadu_si256((const __m256i*)&VData[1][x]) };
+
+		avx2_filter(U);
+		avx2_filter(V);
+
+		for (size_t i = 0; i < 2; i++)
+			avx2_BGRX_fillRGB_pixel(&pDst[i][x * 4], Y[i], U[i], V[i]);
+	}
+}
+
+static inline pstatus_t avx2_YUV444ToRGB_8u_P3AC4R_BGRX(const BYTE* WINPR_RESTRICT pSrc[],
+                                                        const UINT32 srcStep[],
+                                                        BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                                        UINT32 DstFormat,
+                                                        const prim_size_t* WINPR_RESTRICT roi)
+{
+	const UINT32 nWidth = roi->width - roi->width % 32;
+	const UINT32 nHeight = roi->height - roi->height % 2;
+
+	for (size_t y = 0; y < nHeight; y += 2)
+	{
+		BYTE* dst[] = { (pDst + dstStep * y), (pDst + dstStep * (y + 1)) };
+		const BYTE* YData[] = { pSrc[0] + y * srcStep[0], pSrc[0] + (y + 1) * srcStep[0] };
+		const BYTE* UData[] = { pSrc[1] + y * srcStep[1], pSrc[1] + (y + 1) * srcStep[1] };
+		const BYTE* VData[] = { pSrc[2] + y * srcStep[2], pSrc[2] + (y + 1) * srcStep[2] };
+
+		avx2_YUV444ToRGB_8u_P3AC4R_BGRX_DOUBLE_ROW(dst, YData, UData, VData, nWidth);
+	}
+
+	/* The columns right of the vectorized block and an odd last line */
+	if (nWidth < roi->width)
+	{
+		const BYTE* pTail[] = { pSrc[0] + nWidth, pSrc[1] + nWidth, pSrc[2] + nWidth };
+		const prim_size_t tail = { roi->width - nWidth, nHeight };
+		const pstatus_t rc = generic->YUV444ToRGB_8u_P3AC4R(pTail, srcStep, pDst + 4ULL * nWidth,
+		                                                    dstStep, DstFormat, &tail);
+		if (rc != PRIMITIVES_SUCCESS)
+			return rc;
+	}
+
+	if (nHeight < roi->height)
+	{
+		const BYTE* pLast[] = { pSrc[0] + 1ULL * nHeight * srcStep[0],
+			                    pSrc[1] + 1ULL * nHeight * srcStep[1],
+			                    pSrc[2] + 1ULL * nHeight * srcStep[2] };
+		const prim_size_t last = { roi->width, 1 };
+		return generic->YUV444ToRGB_8u_P3AC4R(pLast, srcStep, pDst + 1ULL * nHeight * dstStep,
+		                                      dstStep, DstFormat, &last);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_YUV444ToRGB_8u_P3AC4R(const BYTE* WINPR_RESTRICT pSrc[],
+                                            const UINT32 srcStep[], BYTE* WINPR_RESTRICT pDst,
+                                            UINT32 dstStep, UINT32 DstFormat,
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_YUV444ToRGB_8u_P3AC4R_BGRX(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+
+		default:
+			return generic->YUV444ToRGB_8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+	}
+}
+
+/****************************************************************************/
+/* AVX2 RGB -> YUV420 conversion                                            */
+/****************************************************************************/
+
+/* The factors of the SSE4.1 implementation, see the notes there */
+#define BGRX_Y_FACTORS _mm256_set1_epi32(0x001B5C09) /*   0,   27,  92,   9 */
+#define BGRX_U_FACTORS _mm256_set1_epi32(0x00E39D7F) /*   0,  -29, -99, 127 */
+#define BGRX_V_FACTORS _mm256_set1_epi32(0x007F8CF4) /*   0,  127, -116, -12 */
+#define CONST128_FACTORS _mm256_set1_epi8(-128)
+
+#define Y_SHIFT 7
+#define U_SHIFT 8
+#define V_SHIFT 8
+
+/* Luma of 32 BGRX pixels */
+static inline __m256i avx2_BGRX_Y(const __m256i argb[4])
+{
+	const __m256i y_factors = BGRX_Y_FACTORS;
+	const __m256i y1 =
+	    _mm256_srli_epi16(_mm256_hadd_epi16(_mm256_maddubs_epi16(argb[0], y_factors),
+	                                        _mm256_maddubs_epi16(argb[1], y_factors)),
+	                      Y_SHIFT);
+	const __m256i y2 =
+	    _mm256_srli_epi16(_mm256_hadd_epi16(_mm256_maddubs_epi16(argb[2], y_factors),
+	                                        _mm256_maddubs_epi16(argb[3], y_factors)),
+	                      Y_SHIFT);
+	return avx2_pack_order(_mm256_packus_epi16(y1, y2));
+}
+
+/* Chroma of 32 BGRX pixels as signed bytes, 128 has not yet been added */
+static inline __m256i avx2_BGRX_UV(const __m256i argb[4], const __m256i factors)
+{
+	const __m256i c1 = _mm256_srai_epi16(_mm256_hadd_epi16(_mm256_maddubs_epi16(argb[0], factors),
+	                                                       _mm256_maddubs_epi16(argb[1], factors)),
+	                                     U_SHIFT);
+	const __m256i c2 = _mm256_srai_epi16(_mm256_hadd_epi16(_mm256_maddubs_epi16(argb[2], factors),
+	                                                       _mm256_maddubs_epi16(argb[3], factors)),
+	                                     U_SHIFT);
+	return avx2_pack_order(_mm256_packs_epi16(c1, c2));
+}
+
+static inline void avx2_load_BGRX(const BYTE* WINPR_RESTRICT src, __m256i argb[4])
+{
+	const __m256i* ptr = (const __m256i*)src;
+	for (size_t i = 0; i < 4; i++)
+		argb[i] = _mm256_loadu_si256(&ptr[i]);
+}
+
+/* average 2x2 blocks of 16x2 pixels into 8x1 pixels */
+static inline __m256i avx2_subsample(__m256i x0, __m256i x1)
+{
+	/**
+	 * shuffle controls
+	 * c = a[0],a[2],b[0],b[2] == 10 00 10 00 = 0x88
+	 * c = a[1],a[3],b[1],b[3] == 11 01 11 01 = 0xdd
+	 */
+	const __m256 a = _mm256_castsi256_ps(x0);
+	const __m256 b = _mm256_castsi256_ps(x1);
+	const __m256i even = _mm256_castps_si256(_mm256_shuffle_ps(a, b, 0x88));
+	const __m256i odd = _mm256_castps_si256(_mm256_shuffle_ps(a, b, 0xdd));
+	return _mm256_permute4x64_epi64(_mm256_avg_epu8(even, odd), 0xD8);
+}
+
+static inline void avx2_RGBToYUV420_BGRX_DOUBLE_ROW(const BYTE* WINPR_RESTRICT src1,
+                                                    const BYTE* WINPR_RESTRICT src2,
+                                                    BYTE* WINPR_RESTRICT ydst1,
+                                                    BYTE* WINPR_RESTRICT ydst2,
+                                                    BYTE* WINPR_RESTRICT udst,
+                                                    BYTE* WINPR_RESTRICT vdst, UINT32 width)
+{
+	const __m256i u_factors = BGRX_U_FACTORS;
+	const __m256i v_factors = BGRX_V_FACTORS;
+	const __m256i vector128 = CONST128_FACTORS;
+
+	for (size_t x = 0; x < width; x += 32)
+	{
+		__m256i xe[4];
+		__m256i xo[4];
+		avx2_load_BGRX(&src1[4ULL * x], xe);
+		avx2_load_BGRX(&src2[4ULL * x], xo);
+
+		_mm256_storeu_si256((__m256i*)&ydst1[x], avx2_BGRX_Y(xe));
+		_mm256_storeu_si256((__m256i*)&ydst2[x], avx2_BGRX_Y(xo));
+
+		/* subsample 32x2 pixels into 16x1 pixels */
+		const __m256i x0 = avx2_subsample(_mm256_avg_epu8(xe[0], xo[0]),
+		                                  _mm256_avg_epu8(xe[1], xo[1]));
+		const __m256i x1 = avx2_subsample(_mm256_avg_epu8(xe[2], xo[2]),
+		                                  _mm256_avg_epu8(xe[3], xo[3]));
+		const __m256i u = _mm256_srai_epi16(_mm256_hadd_epi16(_mm256_maddubs_epi16(x0, u_factors),
+		                                                      _mm256_maddubs_epi16(x1, u_factors)),
+		                                    U_SHIFT);
+		const __m256i v = _mm256_srai_epi16(_mm256_hadd_epi16(_mm256_maddubs_epi16(x0, v_factors),
+		                                                      _mm256_maddubs_epi16(x1, v_factors)),
+		                                    V_SHIFT);
+		/* U to the lower, V to the upper lane and add 128 */
+		const __m256i uv = _mm256_sub_epi8(avx2_pack_order(_mm256_packs_epi16(u, v)), vector128);
+		_mm_storeu_si128((__m128i*)&udst[x / 2], _mm256_castsi256_si128(uv));
+		_mm_storeu_si128((__m128i*)&vdst[x / 2], _mm256_extracti128_si256(uv, 1));
+	}
+}
+
+static pstatus_t avx2_RGBToYUV420_BGRX(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                       UINT32 srcStep, BYTE* WINPR_RESTRICT pDst[],
+                                       const UINT32 dstStep[],
+                                       const prim_size_t* WINPR_RESTRICT roi)
+{
+	if (roi->height < 1 || roi->width < 1)
+		return !PRIMITIVES_SUCCESS;
+
+	const UINT32 nWidth = roi->width - roi->width % 32;
+	const UINT32 nHeight = roi->height - roi->height % 2;
+
+	for (size_t y = 0; y < nHeight; y += 2)
+	{
+		const BYTE* line1 = &pSrc[y * srcStep];
+		const BYTE* line2 = &pSrc[(1ULL + y) * srcStep];
+		BYTE* ydst1 = &pDst[0][y * dstStep[0]];
+		BYTE* ydst2 = &pDst[0][(1ULL + y) * dstStep[0]];
+		BYTE* udst = &pDst[1][y / 2 * dstStep[1]];
+		BYTE* vdst = &pDst[2][y / 2 * dstStep[2]];
+
+		avx2_RGBToYUV420_BGRX_DOUBLE_ROW(line1, line2, ydst1, ydst2, udst, vdst, nWidth);
+	}
+
+	/* The columns right of the vectorized block and an odd last line */
+	if ((nWidth < roi->width) && (nHeight > 0))
+	{
+		BYTE* pTail[] = { pDst[0] + nWidth, pDst[1] + nWidth / 2, pDst[2] + nWidth / 2 };
+		const prim_size_t tail = { roi->width - nWidth, nHeight };
+		const pstatus_t rc = generic->RGBToYUV420_8u_P3AC4R(pSrc + 4ULL * nWidth, srcFormat,
+		                                                    srcStep, pTail, dstStep, &tail);
+		if (rc != PRIMITIVES_SUCCESS)
+			return rc;
+	}
+
+	if (nHeight < roi->height)
+	{
+		BYTE* pLast[] = { pDst[0] + 1ULL * nHeight * dstStep[0],
+			              pDst[1] + 1ULL * (nHeight / 2) * dstStep[1],
+			              pDst[2] + 1ULL * (nHeight / 2) * dstStep[2] };
+		const prim_size_t last = { roi->width, 1 };
+		return generic->RGBToYUV420_8u_P3AC4R(pSrc + 1ULL * nHeight * srcStep, srcFormat, srcStep,
+		                                      pLast, dstStep, &last);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_RGBToYUV420(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                  UINT32 srcStep, BYTE* WINPR_RESTRICT pDst[],
+                                  const UINT32 dstStep[], const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_RGBToYUV420_BGRX(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+
+		default:
+			return generic->RGBToYUV420_8u_P3AC4R(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+	}
+}
+
+/****************************************************************************/
+/* AVX2 RGB -> AVC444-YUV conversion                                        */
+/****************************************************************************/
+
+/* The even bytes of 32 values */
+static inline __m128i avx2_even_bytes(__m256i val)
+{
+	const __m256i mask =
+	    mm256_broadcast_epu8(mm_set_epu8(0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 14, 12, 10,
+	                                     8, 6, 4, 2, 0));
+	return avx2_low_qwords(_mm256_shuffle_epi8(val, mask));
+}
+
+/* The odd bytes of 32 values */
+static inline __m128i avx2_odd_bytes(__m256i val)
+{
+	const __m256i mask =
+	    mm256_broadcast_epu8(mm_set_epu8(0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 15, 13, 11,
+	                                     9, 7, 5, 3, 1));
+	return avx2_low_qwords(_mm256_shuffle_epi8(val, mask));
+}
+
+/* The average of 2x2 blocks of unsigned values */
+static inline __m128i avx2_avg_2x2(__m256i even, __m256i odd)
+{
+	const __m256i ones = _mm256_set1_epi8(1);
+	const __m256i sum =
+	    _mm256_add_epi16(_mm256_maddubs_epi16(even, ones), _mm256_maddubs_epi16(odd, ones));
+	const __m256i avg = _mm256_srli_epi16(sum, 2);
+	return avx2_low_qwords(_mm256_packus_epi16(avg, avg));
+}
+
+/* The average of 2x2 blocks of signed values */
+static inline __m128i avx2_avg_2x2_signed(__m256i even, __m256i odd)
+{
+	const __m256i ones = _mm256_set1_epi8(1);
+	const __m256i sum =
+	    _mm256_add_epi16(_mm256_maddubs_epi16(ones, even), _mm256_maddubs_epi16(ones, odd));
+	const __m256i avg = _mm256_srai_epi16(sum, 2);
+	return avx2_low_qwords(_mm256_packs_epi16(avg, avg));
+}
+
+static inline void avx2_RGBToAVC444YUV_BGRX_DOUBLE_ROW(
+    const BYTE* WINPR_RESTRICT srcEven, const BYTE* WINPR_RESTRICT srcOdd,
+    BYTE* WINPR_RESTRICT b1Even, BYTE* WINPR_RESTRICT b1Odd, BYTE* WINPR_RESTRICT b2,
+    BYTE* WINPR_RESTRICT b3, BYTE* WINPR_RESTRICT b4, BYTE* WINPR_RESTRICT b5,
+    BYTE* WINPR_RESTRICT b6, BYTE* WINPR_RESTRICT b7, UINT32 width)
+{
+	const __m256i u_factors = BGRX_U_FACTORS;
+	const __m256i v_factors = BGRX_V_FACTORS;
+	const __m256i vector128 = CONST128_FACTORS;
+
+	UINT32 x = 0;
+	for (; x < width - width % 32; x += 32)
+	{
+		__m256i xe[4];
+		__m256i xo[4];
+		avx2_load_BGRX(&srcEven[4ULL * x], xe);
+		avx2_load_BGRX(&srcOdd[4ULL * x], xo);
+
+		/* store y [b1] */
+		_mm256_storeu_si256((__m256i*)b1Even, avx2_BGRX_Y(xe));
+		b1Even += 32;
+		_mm256_storeu_si256((__m256i*)b1Odd, avx2_BGRX_Y(xo));
+		b1Odd += 32;
+
+		/* We need to split these according to
+		 * 3.3.8.3.2 YUV420p Stream Combination for YUV444 mode
+		 *
+		 * 2x   2y    -> b2 / b3
+		 * x    2y+1  -> b4 / b5
+		 * 2x+1 2y    -> b6 / b7 */
+		{
+			const __m256i ue = _mm256_sub_epi8(avx2_BGRX_UV(xe, u_factors), vector128);
+			const __m256i uo = _mm256_sub_epi8(avx2_BGRX_UV(xo, u_factors), vector128);
+			_mm_storeu_si128((__m128i*)b2, avx2_avg_2x2(ue, uo));
+			b2 += 16;
+			_mm256_storeu_si256((__m256i*)b4, uo);
+			b4 += 32;
+			_mm_storeu_si128((__m128i*)b6, avx2_odd_bytes(ue));
+			b6 += 16;
+		}
+		{
+			const __m256i ve = _mm256_sub_epi8(avx2_BGRX_UV(xe, v_factors), vector128);
+			const __m256i vo = _mm256_sub_epi8(avx2_BGRX_UV(xo, v_factors), vector128);
+			_mm_storeu_si128((__m128i*)b3, avx2_avg_2x2(ve, vo));
+			b3 += 16;
+			_mm256_storeu_si256((__m256i*)b5, vo);
+			b5 += 32;
+			_mm_storeu_si128((__m128i*)b7, avx2_odd_bytes(ve));
+			b7 += 16;
+		}
+	}
+
+	general_RGBToAVC444YUV_BGRX_DOUBLE_ROW(x, srcEven, srcOdd, b1Even, b1Odd, b2, b3, b4, b5, b6,
+	                                       b7, width);
+}
+
+static pstatus_t avx2_RGBToAVC444YUV_BGRX(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                          BYTE* WINPR_RESTRICT pDst1[], const UINT32 dst1Step[],
+                                          BYTE* WINPR_RESTRICT pDst2[], const UINT32 dst2Step[],
+                                          const prim_size_t* WINPR_RESTRICT roi)
+{
+	if (roi->height < 1 || roi->width < 1)
+		return !PRIMITIVES_SUCCESS;
+
+	size_t y = 0;
+	for (; y < roi->height - roi->height % 2; y += 2)
+	{
+		const BYTE* srcEven = pSrc + y * srcStep;
+		const BYTE* srcOdd = pSrc + (y + 1) * srcStep;
+		const size_t i = y >> 1;
+		const size_t n = (i & (size_t)~7) + i;
+		BYTE* b1Even = pDst1[0] + y * dst1Step[0];
+		BYTE* b1Odd = (b1Even + dst1Step[0]);
+		BYTE* b2 = pDst1[1] + (y / 2) * dst1Step[1];
+		BYTE* b3 = pDst1[2] + (y / 2) * dst1Step[2];
+		BYTE* b4 = pDst2[0] + 1ULL * dst2Step[0] * n;
+		BYTE* b5 = b4 + 8ULL * dst2Step[0];
+		BYTE* b6 = pDst2[1] + (y / 2) * dst2Step[1];
+		BYTE* b7 = pDst2[2] + (y / 2) * dst2Step[2];
+		avx2_RGBToAVC444YUV_BGRX_DOUBLE_ROW(srcEven, srcOdd, b1Even, b1Odd, b2, b3, b4, b5, b6, b7,
+		                                    roi->width);
+	}
+
+	for (; y < roi->height; y++)
+	{
+		const BYTE* srcEven = pSrc + y * srcStep;
+		BYTE* b1Even = pDst1[0] + y * dst1Step[0];
+		BYTE* b2 = pDst1[1] + (y / 2) * dst1Step[1];
+		BYTE* b3 = pDst1[2] + (y / 2) * dst1Step[2];
+		BYTE* b6 = pDst2[1] + (y / 2) * dst2Step[1];
+		BYTE* b7 = pDst2[2] + (y / 2) * dst2Step[2];
+		general_RGBToAVC444YUV_BGRX_DOUBLE_ROW(0, srcEven, NULL, b1Even, NULL, b2, b3, NULL, NULL,
+		                                       b6, b7, roi->width);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_RGBToAVC444YUV(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                     UINT32 srcStep, BYTE* WINPR_RESTRICT pDst1[],
+                                     const UINT32 dst1Step[], BYTE* WINPR_RESTRICT pDst2[],
+                                     const UINT32 dst2Step[],
+                                     const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_RGBToAVC444YUV_BGRX(pSrc, srcStep, pDst1, dst1Step, pDst2, dst2Step, roi);
+
+		default:
+			return generic->RGBToAVC444YUV(pSrc, srcFormat, srcStep, pDst1, dst1Step, pDst2,
+			                               dst2Step, roi);
+	}
+}
+
+/* Split the bytes 4x and 4x+2 of 32 values, the first go to the lower, the others to the upper
+ * 64 bit */
+static inline void avx2_store_4x(__m256i val, BYTE* WINPR_RESTRICT dst1,
+                                 BYTE* WINPR_RESTRICT dst2)
+{
+	const __m256i mask =
+	    mm256_broadcast_epu8(mm_set_epu8(0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 14, 10, 6,
+	                                     2, 12, 8, 4, 0));
+	const __m128i split =
+	    _mm256_castsi256_si128(avx2_pack_order(_mm256_shuffle_epi8(val, mask)));
+	_mm_storel_epi64((__m128i*)dst1, split);
+	_mm_storel_epi64((__m128i*)dst2, _mm_srli_si128(split, 8));
+}
+
+static inline void avx2_RGBToAVC444YUVv2_BGRX_DOUBLE_ROW(
+    const BYTE* WINPR_RESTRICT srcEven, const BYTE* WINPR_RESTRICT srcOdd,
+    BYTE* WINPR_RESTRICT yLumaDstEven, BYTE* WINPR_RESTRICT yLumaDstOdd,
+    BYTE* WINPR_RESTRICT uLumaDst, BYTE* WINPR_RESTRICT vLumaDst,
+    BYTE* WINPR_RESTRICT yEvenChromaDst1, BYTE* WINPR_RESTRICT yEvenChromaDst2,
+    BYTE* WINPR_RESTRICT yOddChromaDst1, BYTE* WINPR_RESTRICT yOddChromaDst2,
+    BYTE* WINPR_RESTRICT uChromaDst1, BYTE* WINPR_RESTRICT uChromaDst2,
+    BYTE* WINPR_RESTRICT vChromaDst1, BYTE* WINPR_RESTRICT vChromaDst2, UINT32 width)
+{
+	const __m256i u_factors = BGRX_U_FACTORS;
+	const __m256i v_factors = BGRX_V_FACTORS;
+	const __m256i vector128 = CONST128_FACTORS;
+	const __m128i vector128s = _mm_set1_epi8(-128);
+
+	UINT32 x = 0;
+	for (; x < width - width % 32; x += 32)
+	{
+		__m256i xe[4];
+		__m256i xo[4];
+		avx2_load_BGRX(&srcEven[4ULL * x], xe);
+		avx2_load_BGRX(&srcOdd[4ULL * x], xo);
+
+		_mm256_storeu_si256((__m256i*)yLumaDstEven, avx2_BGRX_Y(xe));
+		yLumaDstEven += 32;
+		_mm256_storeu_si256((__m256i*)yLumaDstOdd, avx2_BGRX_Y(xo));
+		yLumaDstOdd += 32;
+
+		/* We need to split these according to
+		 * 3.3.8.3.3 YUV420p Stream Combination for YUV444v2 mode
+		 *
+		 * 2x   2y    -> uLumaDst / vLumaDst
+		 * 2x+1  y    -> yChromaDst1 / yChromaDst2
+		 * 4x   2y+1  -> uChromaDst1 / uChromaDst2
+		 * 4x+2 2y+1  -> vChromaDst1 / vChromaDst2 */
+		{
+			const __m256i ues = avx2_BGRX_UV(xe, u_factors);
+			const __m256i uos = avx2_BGRX_UV(xo, u_factors);
+			const __m256i ue = _mm256_sub_epi8(ues, vector128);
+			const __m256i uo = _mm256_sub_epi8(uos, vector128);
+			_mm_storeu_si128((__m128i*)yEvenChromaDst1, avx2_odd_bytes(ue));
+			yEvenChromaDst1 += 16;
+			_mm_storeu_si128((__m128i*)yOddChromaDst1, avx2_odd_bytes(uo));
+			yOddChromaDst1 += 16;
+			avx2_store_4x(uo, uChromaDst1, vChromaDst1);
+			uChromaDst1 += 8;
+			vChromaDst1 += 8;
+			_mm_storeu_si128((__m128i*)uLumaDst,
+			                 _mm_sub_epi8(avx2_avg_2x2_signed(ues, uos), vector128s));
+			uLumaDst += 16;
+		}
+		{
+			const __m256i ves = avx2_BGRX_UV(xe, v_factors);
+			const __m256i vos = avx2_BGRX_UV(xo, v_factors);
+			const __m256i ve = _mm256_sub_epi8(ves, vector128);
+			const __m256i vo = _mm256_sub_epi8(vos, vector128);
+			_mm_storeu_si128((__m128i*)yEvenChromaDst2, avx2_odd_bytes(ve));
+			yEvenChromaDst2 += 16;
+			_mm_storeu_si128((__m128i*)yOddChromaDst2, avx2_odd_bytes(vo));
+			yOddChromaDst2 += 16;
+			avx2_store_4x(vo, uChromaDst2, vChromaDst2);
+			uChromaDst2 += 8;
+			vChromaDst2 += 8;
+			_mm_storeu_si128((__m128i*)vLumaDst,
+			                 _mm_sub_epi8(avx2_avg_2x2_signed(ves, vos), vector128s));
+			vLumaDst += 16;
+		}
+	}
+
+	general_RGBToAVC444YUVv2_BGRX_DOUBLE_ROW(x, srcEven, srcOdd, yLumaDstEven, yLumaDstOdd,
+	                                         uLumaDst, vLumaDst, yEvenChromaDst1, yEvenChromaDst2,
+	                                         yOddChromaDst1, yOddChromaDst2, uChromaDst1,
+	                                         uChromaDst2, vChromaDst1, vChromaDst2, width);
+}
+
+static pstatus_t avx2_RGBToAVC444YUVv2_BGRX(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                            BYTE* WINPR_RESTRICT pDst1[], const UINT32 dst1Step[],
+                                            BYTE* WINPR_RESTRICT pDst2[], const UINT32 dst2Step[],
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	if (roi->height < 1 || roi->width < 1)
+		return !PRIMITIVES_SUCCESS;
+
+	size_t y = 0;
+	for (; y < roi->height - roi->height % 2; y += 2)
+	{
+		const BYTE* srcEven = (pSrc + y * srcStep);
+		const BYTE* srcOdd = (srcEven + srcStep);
+		BYTE* dstLumaYEven = (pDst1[0] + y * dst1Step[0]);
+		BYTE* dstLumaYOdd = (dstLumaYEven + dst1Step[0]);
+		BYTE* dstLumaU = (pDst1[1] + (y / 2) * dst1Step[1]);
+		BYTE* dstLumaV = (pDst1[2] + (y / 2) * dst1Step[2]);
+		BYTE* dstEvenChromaY1 = (pDst2[0] + y * dst2Step[0]);
+		BYTE* dstEvenChromaY2 = dstEvenChromaY1 + roi->width / 2;
+		BYTE* dstOddChromaY1 = dstEvenChromaY1 + dst2Step[0];
+		BYTE* dstOddChromaY2 = dstEvenChromaY2 + dst2Step[0];
+		BYTE* dstChromaU1 = (pDst2[1] + (y / 2) * dst2Step[1]);
+		BYTE* dstChromaV1 = (pDst2[2] + (y / 2) * dst2Step[2]);
+		BYTE* dstChromaU2 = dstChromaU1 + roi->width / 4;
+		BYTE* dstChromaV2 = dstChromaV1 + roi->width / 4;
+		avx2_RGBToAVC444YUVv2_BGRX_DOUBLE_ROW(srcEven, srcOdd, dstLumaYEven, dstLumaYOdd, dstLumaU,
+		                                      dstLumaV, dstEvenChromaY1, dstEvenChromaY2,
+		                                      dstOddChromaY1, dstOddChromaY2, dstChromaU1,
+		                                      dstChromaU2, dstChromaV1, dstChromaV2, roi->width);
+	}
+
+	for (; y < roi->height; y++)
+	{
+		const BYTE* srcEven = (pSrc + y * srcStep);
+		BYTE* dstLumaYEven = (pDst1[0] + y * dst1Step[0]);
+		BYTE* dstLumaU = (pDst1[1] + (y / 2) * dst1Step[1]);
+		BYTE* dstLumaV = (pDst1[2] + (y / 2) * dst1Step[2]);
+		BYTE* dstEvenChromaY1 = (pDst2[0] + y * dst2Step[0]);
+		BYTE* dstEvenChromaY2 = dstEvenChromaY1 + roi->width / 2;
+		BYTE* dstChromaU1 = (pDst2[1] + (y / 2) * dst2Step[1]);
+		BYTE* dstChromaV1 = (pDst2[2] + (y / 2) * dst2Step[2]);
+		BYTE* dstChromaU2 = dstChromaU1 + roi->width / 4;
+		BYTE* dstChromaV2 = dstChromaV1 + roi->width / 4;
+		general_RGBToAVC444YUVv2_BGRX_DOUBLE_ROW(0, srcEven, NULL, dstLumaYEven, NULL, dstLumaU,
+		                                         dstLumaV, dstEvenChromaY1, dstEvenChromaY2, NULL,
+		                                         NULL, dstChromaU1, dstChromaU2, dstChromaV1,
+		                                         dstChromaV2, roi->width);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_RGBToAVC444YUVv2(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                       UINT32 srcStep, BYTE* WINPR_RESTRICT pDst1[],
+                                       const UINT32 dst1Step[], BYTE* WINPR_RESTRICT pDst2[],
+                                       const UINT32 dst2Step[],
+                                       const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_RGBToAVC444YUVv2_BGRX(pSrc, srcStep, pDst1, dst1Step, pDst2, dst2Step,
+			                                  roi);
+
+		default:
+			return generic->RGBToAVC444YUVv2(pSrc, srcFormat, srcStep, pDst1, dst1Step, pDst2,
+			                                 dst2Step, roi);
+	}
+}
+#endif
+
+void primitives_init_YUV_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->YUV420ToRGB_8u_P3AC4R = avx2_YUV420ToRGB;
+	prims->YUV444ToRGB_8u_P3AC4R = avx2_YUV444ToRGB_8u_P3AC4R;
+	prims->RGBToYUV420_8u_P3AC4R = avx2_RGBToYUV420;
+	prims->RGBToAVC444YUV = avx2_RGBToAVC444YUV;
+	prims->RGBToAVC444YUVv2 = avx2_RGBToAVC444YUVv2;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
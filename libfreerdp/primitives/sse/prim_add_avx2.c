@@ -0,0 +1,101 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Add operations, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_add.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* INT16 values per AVX2 register */
+#define AVX2_INT16_COUNT (sizeof(__m256i) / sizeof(INT16))
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_add_16s(const INT16* WINPR_RESTRICT pSrc1, const INT16* WINPR_RESTRICT pSrc2,
+                              INT16* WINPR_RESTRICT pDst, UINT32 len)
+{
+	UINT32 x = 0;
+
+	for (; x + 2 * AVX2_INT16_COUNT <= len; x += 2 * AVX2_INT16_COUNT)
+	{
+		const __m256i a0 = _mm256_loadu_si256((const __m256i*)&pSrc1[x]);
+		const __m256i a1 = _mm256_loadu_si256((const __m256i*)&pSrc1[x + AVX2_INT16_COUNT]);
+		const __m256i b0 = _mm256_loadu_si256((const __m256i*)&pSrc2[x]);
+		const __m256i b1 = _mm256_loadu_si256((const __m256i*)&pSrc2[x + AVX2_INT16_COUNT]);
+		_mm256_storeu_si256((__m256i*)&pDst[x], _mm256_adds_epi16(a0, b0));
+		_mm256_storeu_si256((__m256i*)&pDst[x + AVX2_INT16_COUNT], _mm256_adds_epi16(a1, b1));
+	}
+
+	for (; x + AVX2_INT16_COUNT <= len; x += AVX2_INT16_COUNT)
+	{
+		const __m256i a = _mm256_loadu_si256((const __m256i*)&pSrc1[x]);
+		const __m256i b = _mm256_loadu_si256((const __m256i*)&pSrc2[x]);
+		_mm256_storeu_si256((__m256i*)&pDst[x], _mm256_adds_epi16(a, b));
+	}
+
+	/* Finish off the remainder. */
+	if (x < len)
+		return generic->add_16s(&pSrc1[x], &pSrc2[x], &pDst[x], len - x);
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_add_16s_inplace(INT16* WINPR_RESTRICT pSrcDst1,
+                                      INT16* WINPR_RESTRICT pSrcDst2, UINT32 len)
+{
+	UINT32 x = 0;
+
+	for (; x + AVX2_INT16_COUNT <= len; x += AVX2_INT16_COUNT)
+	{
+		const __m256i a = _mm256_loadu_si256((const __m256i*)&pSrcDst1[x]);
+		const __m256i b = _mm256_loadu_si256((const __m256i*)&pSrcDst2[x]);
+		const __m256i sum = _mm256_adds_epi16(a, b);
+		_mm256_storeu_si256((__m256i*)&pSrcDst1[x], sum);
+		_mm256_storeu_si256((__m256i*)&pSrcDst2[x], sum);
+	}
+
+	/* Finish off the remainder. */
+	if (x < len)
+		return generic->add_16s_inplace(&pSrcDst1[x], &pSrcDst2[x], len - x);
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_add_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->add_16s = avx2_add_16s;
+	prims->add_16s_inplace = avx2_add_16s_inplace;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
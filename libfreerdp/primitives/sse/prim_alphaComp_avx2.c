@@ -0,0 +1,115 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Alpha blending operations, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Note: like the SSE version this code assumes the second operand is fully opaque.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_alphaComp.h"
+
+#include "prim_internal.h"
+
+/* ------------------------------------------------------------------------- */
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Blend 4 pixels, unpacked to 16 bit per channel */
+static inline __m256i avx2_blend(__m256i src1, __m256i src2)
+{
+	const __m256i one = _mm256_set1_epi16(1);
+	/* subtract */
+	const __m256i diff = _mm256_subs_epi16(src1, src2);
+	/* 00Ab00Ab00Ab00Ab00Aa00Aa00Aa00Aa */
+	__m256i alpha = _mm256_shufflelo_epi16(src1, 0xff);
+	alpha = _mm256_shufflehi_epi16(alpha, 0xff);
+	/* Add one to alphas */
+	alpha = _mm256_adds_epi16(alpha, one);
+	/* Multiply and take low word, shift 8 right, add src2 */
+	const __m256i blend = _mm256_srai_epi16(_mm256_mullo_epi16(alpha, diff), 8);
+	/* Must mask off remainders or pack gets confused */
+	return _mm256_and_si256(_mm256_adds_epi16(blend, src2), _mm256_set1_epi16(0x00ff));
+}
+
+static pstatus_t avx2_alphaComp_argb(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+                                     const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+                                     BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 width,
+                                     UINT32 height)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const UINT32 count = width - width % 8;
+
+	if ((width <= 0) || (height <= 0))
+		return PRIMITIVES_SUCCESS;
+
+	if (count == 0) /* pointless if too small */
+	{
+		return generic->alphaComp_argb(pSrc1, src1Step, pSrc2, src2Step, pDst, dstStep, width,
+		                               height);
+	}
+
+	for (size_t y = 0; y < height; ++y)
+	{
+		const BYTE* sptr1 = &pSrc1[y * src1Step];
+		const BYTE* sptr2 = &pSrc2[y * src2Step];
+		BYTE* dptr = &pDst[y * dstStep];
+
+		/* 8 pixels at a time. */
+		for (size_t x = 0; x < 4ULL * count; x += sizeof(__m256i))
+		{
+			const __m256i src1 = _mm256_loadu_si256((const __m256i*)&sptr1[x]);
+			const __m256i src2 = _mm256_loadu_si256((const __m256i*)&sptr2[x]);
+			const __m256i lo =
+			    avx2_blend(_mm256_unpacklo_epi8(src1, zero), _mm256_unpacklo_epi8(src2, zero));
+			const __m256i hi =
+			    avx2_blend(_mm256_unpackhi_epi8(src1, zero), _mm256_unpackhi_epi8(src2, zero));
+			_mm256_storeu_si256((__m256i*)&dptr[x], _mm256_packus_epi16(lo, hi));
+		}
+
+		/* Finish off the remainder. */
+		if (count < width)
+		{
+			const pstatus_t status =
+			    generic->alphaComp_argb(&sptr1[4ULL * count], src1Step, &sptr2[4ULL * count],
+			                            src2Step, &dptr[4ULL * count], dstStep, width - count, 1);
+			if (status != PRIMITIVES_SUCCESS)
+				return status;
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_alphaComp_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->alphaComp_argb = avx2_alphaComp_argb;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
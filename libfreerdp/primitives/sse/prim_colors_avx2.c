@@ -0,0 +1,229 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Color conversion operations, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_colors.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+static inline __m256i mm256_between_epi16(__m256i val, __m256i min, __m256i max)
+{
+	return _mm256_min_epi16(max, _mm256_max_epi16(val, min));
+}
+
+/*---------------------------------------------------------------------------*/
+/* Convert 16 pixels of a line. The fixed point arithmetic is the one of the SSE2 version, see
+ * the comments there.
+ */
+static inline void avx2_yCbCrToRGB_16s8u_16(const INT16* WINPR_RESTRICT y_buf,
+                                            const INT16* WINPR_RESTRICT cb_buf,
+                                            const INT16* WINPR_RESTRICT cr_buf,
+                                            BYTE* WINPR_RESTRICT d_buf, BOOL rgbx)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi16(255);
+	const __m256i r_cr = _mm256_set1_epi16(22987);  /*  1.403 << 14 */
+	const __m256i g_cb = _mm256_set1_epi16(-5636);  /* -0.344 << 14 */
+	const __m256i g_cr = _mm256_set1_epi16(-11698); /* -0.714 << 14 */
+	const __m256i b_cb = _mm256_set1_epi16(29000);  /*  1.770 << 14 */
+	const __m256i c4096 = _mm256_set1_epi16(4096);
+
+	/* y = (y_r_buf[i] + 4096) >> 2 */
+	__m256i y = _mm256_loadu_si256((const __m256i*)y_buf);
+	y = _mm256_srai_epi16(_mm256_add_epi16(y, c4096), 2);
+	const __m256i cb = _mm256_loadu_si256((const __m256i*)cb_buf);
+	const __m256i cr = _mm256_loadu_si256((const __m256i*)cr_buf);
+	/* (y + HIWORD(cr*22986)) >> 3 */
+	__m256i r = _mm256_add_epi16(y, _mm256_mulhi_epi16(cr, r_cr));
+	r = mm256_between_epi16(_mm256_srai_epi16(r, 3), zero, max);
+	/* (y + HIWORD(cb*-5636) + HIWORD(cr*-11698)) >> 3 */
+	__m256i g = _mm256_add_epi16(y, _mm256_mulhi_epi16(cb, g_cb));
+	g = _mm256_add_epi16(g, _mm256_mulhi_epi16(cr, g_cr));
+	g = mm256_between_epi16(_mm256_srai_epi16(g, 3), zero, max);
+	/* (y + HIWORD(cb*28999)) >> 3 */
+	__m256i b = _mm256_add_epi16(y, _mm256_mulhi_epi16(cb, b_cb));
+	b = mm256_between_epi16(_mm256_srai_epi16(b, 3), zero, max);
+
+	/* The lanes hold pixels 0-7 and 8-15 */
+	const __m256i first = rgbx ? r : b;
+	const __m256i third = rgbx ? b : r;
+	const __m256i ft = _mm256_packus_epi16(first, third); /* F0..F7 T0..T7 | F8..F15 T8..T15 */
+	const __m256i gx = _mm256_packus_epi16(g, max);       /* G0..G7 FF..FF | G8..G15 FF..FF */
+	const __m256i fg = _mm256_unpacklo_epi8(ft, gx);      /* F0G0..F7G7 | F8G8..F15G15 */
+	const __m256i tx = _mm256_unpackhi_epi8(ft, gx);      /* T0FF..T7FF | T8FF..T15FF */
+	const __m256i p0 = _mm256_unpacklo_epi16(fg, tx);     /* pixels 0-3 | 8-11 */
+	const __m256i p1 = _mm256_unpackhi_epi16(fg, tx);     /* pixels 4-7 | 12-15 */
+	_mm256_storeu_si256((__m256i*)d_buf, _mm256_permute2x128_si256(p0, p1, 0x20));
+	_mm256_storeu_si256((__m256i*)&d_buf[sizeof(__m256i)], _mm256_permute2x128_si256(p0, p1, 0x31));
+}
+
+static pstatus_t avx2_yCbCrToRGB_16s8u_P3AC4R_X(const INT16* WINPR_RESTRICT pSrc[3],
+                                                UINT32 srcStep, BYTE* WINPR_RESTRICT pDst,
+                                                UINT32 dstStep, UINT32 DstFormat,
+                                                const prim_size_t* WINPR_RESTRICT roi, BOOL rgbx)
+{
+	const UINT32 nWidth = roi->width - roi->width % 16;
+
+	for (size_t yp = 0; yp < roi->height; ++yp)
+	{
+		const INT16* y_buf = (const INT16*)((const BYTE*)pSrc[0] + yp * srcStep);
+		const INT16* cb_buf = (const INT16*)((const BYTE*)pSrc[1] + yp * srcStep);
+		const INT16* cr_buf = (const INT16*)((const BYTE*)pSrc[2] + yp * srcStep);
+		BYTE* d_buf = &pDst[yp * dstStep];
+
+		for (size_t x = 0; x < nWidth; x += 16)
+			avx2_yCbCrToRGB_16s8u_16(&y_buf[x], &cb_buf[x], &cr_buf[x], &d_buf[4 * x], rgbx);
+	}
+
+	if (nWidth == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	const INT16* pTail[] = { pSrc[0] + nWidth, pSrc[1] + nWidth, pSrc[2] + nWidth };
+	const prim_size_t tail = { roi->width - nWidth, roi->height };
+	return generic->yCbCrToRGB_16s8u_P3AC4R(pTail, srcStep, pDst + 4ULL * nWidth, dstStep,
+	                                        DstFormat, &tail);
+}
+
+static pstatus_t
+avx2_yCbCrToRGB_16s8u_P3AC4R(const INT16* WINPR_RESTRICT pSrc[3], UINT32 srcStep,
+                             BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+                             const prim_size_t* WINPR_RESTRICT roi) /* region of interest */
+{
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			return avx2_yCbCrToRGB_16s8u_P3AC4R_X(pSrc, srcStep, pDst, dstStep, DstFormat, roi,
+			                                      FALSE);
+
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			return avx2_yCbCrToRGB_16s8u_P3AC4R_X(pSrc, srcStep, pDst, dstStep, DstFormat, roi,
+			                                      TRUE);
+
+		default:
+			return generic->yCbCrToRGB_16s8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+	}
+}
+
+/* The encoded YCbCr coefficients are represented as 11.5 fixed-point
+ * numbers. See the general code.
+ */
+static inline void avx2_RGBToYCbCr_16s16s_16(const INT16* WINPR_RESTRICT r_buf,
+                                             const INT16* WINPR_RESTRICT g_buf,
+                                             const INT16* WINPR_RESTRICT b_buf,
+                                             INT16* WINPR_RESTRICT y_buf,
+                                             INT16* WINPR_RESTRICT cb_buf,
+                                             INT16* WINPR_RESTRICT cr_buf)
+{
+	const __m256i min = _mm256_set1_epi16(-128 * 32);
+	const __m256i max = _mm256_set1_epi16(127 * 32);
+	const __m256i y_r = _mm256_set1_epi16(9798);    /*  0.299000 << 15 */
+	const __m256i y_g = _mm256_set1_epi16(19235);   /*  0.587000 << 15 */
+	const __m256i y_b = _mm256_set1_epi16(3735);    /*  0.114000 << 15 */
+	const __m256i cb_r = _mm256_set1_epi16(-5535);  /* -0.168935 << 15 */
+	const __m256i cb_g = _mm256_set1_epi16(-10868); /* -0.331665 << 15 */
+	const __m256i cb_b = _mm256_set1_epi16(16403);  /*  0.500590 << 15 */
+	const __m256i cr_r = _mm256_set1_epi16(16377);  /*  0.499813 << 15 */
+	const __m256i cr_g = _mm256_set1_epi16(-13714); /* -0.418531 << 15 */
+	const __m256i cr_b = _mm256_set1_epi16(-2663);  /* -0.081282 << 15 */
+
+	/* r<<6; g<<6; b<<6 */
+	const __m256i r = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)r_buf), 6);
+	const __m256i g = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)g_buf), 6);
+	const __m256i b = _mm256_slli_epi16(_mm256_loadu_si256((const __m256i*)b_buf), 6);
+
+	/* y = HIWORD(r*y_r) + HIWORD(g*y_g) + HIWORD(b*y_b) + min */
+	__m256i y = _mm256_mulhi_epi16(r, y_r);
+	y = _mm256_add_epi16(y, _mm256_mulhi_epi16(g, y_g));
+	y = _mm256_add_epi16(y, _mm256_mulhi_epi16(b, y_b));
+	y = _mm256_add_epi16(y, min);
+	/* y_r_buf[i] = MINMAX(y, 0, (255 << 5)) - (128 << 5); */
+	_mm256_storeu_si256((__m256i*)y_buf, mm256_between_epi16(y, min, max));
+
+	/* cb = HIWORD(r*cb_r) + HIWORD(g*cb_g) + HIWORD(b*cb_b) */
+	__m256i cb = _mm256_mulhi_epi16(r, cb_r);
+	cb = _mm256_add_epi16(cb, _mm256_mulhi_epi16(g, cb_g));
+	cb = _mm256_add_epi16(cb, _mm256_mulhi_epi16(b, cb_b));
+	/* cb_g_buf[i] = MINMAX(cb, (-128 << 5), (127 << 5)); */
+	_mm256_storeu_si256((__m256i*)cb_buf, mm256_between_epi16(cb, min, max));
+
+	/* cr = HIWORD(r*cr_r) + HIWORD(g*cr_g) + HIWORD(b*cr_b) */
+	__m256i cr = _mm256_mulhi_epi16(r, cr_r);
+	cr = _mm256_add_epi16(cr, _mm256_mulhi_epi16(g, cr_g));
+	cr = _mm256_add_epi16(cr, _mm256_mulhi_epi16(b, cr_b));
+	/* cr_b_buf[i] = MINMAX(cr, (-128 << 5), (127 << 5)); */
+	_mm256_storeu_si256((__m256i*)cr_buf, mm256_between_epi16(cr, min, max));
+}
+
+static pstatus_t
+avx2_RGBToYCbCr_16s16s_P3P3(const INT16* WINPR_RESTRICT pSrc[3], int srcStep,
+                            INT16* WINPR_RESTRICT pDst[3], int dstStep,
+                            const prim_size_t* WINPR_RESTRICT roi) /* region of interest */
+{
+	const UINT32 nWidth = roi->width - roi->width % 16;
+	const size_t srcStride = WINPR_ASSERTING_INT_CAST(size_t, srcStep);
+	const size_t dstStride = WINPR_ASSERTING_INT_CAST(size_t, dstStep);
+
+	for (size_t yp = 0; yp < roi->height; ++yp)
+	{
+		const INT16* r_buf = (const INT16*)((const BYTE*)pSrc[0] + yp * srcStride);
+		const INT16* g_buf = (const INT16*)((const BYTE*)pSrc[1] + yp * srcStride);
+		const INT16* b_buf = (const INT16*)((const BYTE*)pSrc[2] + yp * srcStride);
+		INT16* y_buf = (INT16*)((BYTE*)pDst[0] + yp * dstStride);
+		INT16* cb_buf = (INT16*)((BYTE*)pDst[1] + yp * dstStride);
+		INT16* cr_buf = (INT16*)((BYTE*)pDst[2] + yp * dstStride);
+
+		for (size_t x = 0; x < nWidth; x += 16)
+			avx2_RGBToYCbCr_16s16s_16(&r_buf[x], &g_buf[x], &b_buf[x], &y_buf[x], &cb_buf[x],
+			                          &cr_buf[x]);
+	}
+
+	if (nWidth == roi->width)
+		return PRIMITIVES_SUCCESS;
+
+	const INT16* pTailSrc[] = { pSrc[0] + nWidth, pSrc[1] + nWidth, pSrc[2] + nWidth };
+	INT16* pTailDst[] = { pDst[0] + nWidth, pDst[1] + nWidth, pDst[2] + nWidth };
+	const prim_size_t tail = { roi->width - nWidth, roi->height };
+	return generic->RGBToYCbCr_16s16s_P3P3(pTailSrc, srcStep, pTailDst, dstStep, &tail);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_colors_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->yCbCrToRGB_16s8u_P3AC4R = avx2_yCbCrToRGB_16s8u_P3AC4R;
+	prims->RGBToYCbCr_16s16s_P3P3 = avx2_RGBToYCbCr_16s16s_P3P3;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,114 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Tile based image comparison, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/cast.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_compare.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+/* Compare one line of a 16 pixel wide tile (64 bytes) */
+static inline BOOL avx2_line_equal(const BYTE* WINPR_RESTRICT a, const BYTE* WINPR_RESTRICT b,
+                                   __m256i mask)
+{
+	const __m256i* pa = (const __m256i*)a;
+	const __m256i* pb = (const __m256i*)b;
+	const __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256(&pa[0]), _mm256_loadu_si256(&pb[0]));
+	const __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256(&pa[1]), _mm256_loadu_si256(&pb[1]));
+	return _mm256_testz_si256(_mm256_or_si256(x0, x1), mask) != 0;
+}
+
+static pstatus_t avx2_compare_tiles_32u(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+                                        const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+                                        UINT32 width, UINT32 height, UINT32 mask,
+                                        BYTE* WINPR_RESTRICT pDirty, UINT32 dirtyStep)
+{
+	const UINT32 ncol = (width + PRIM_COMPARE_TILE_SIZE - 1) / PRIM_COMPARE_TILE_SIZE;
+	const UINT32 nfull = width / PRIM_COMPARE_TILE_SIZE;
+	const __m256i vmask = _mm256_set1_epi32(WINPR_CXX_COMPAT_CAST(int32_t, mask));
+
+	WINPR_ASSERT(pSrc1);
+	WINPR_ASSERT(pSrc2);
+	WINPR_ASSERT(pDirty);
+	WINPR_ASSERT(dirtyStep >= ncol);
+
+	for (UINT32 ty = 0; ty * PRIM_COMPARE_TILE_SIZE < height; ty++)
+	{
+		const UINT32 y0 = ty * PRIM_COMPARE_TILE_SIZE;
+		const UINT32 th = MIN(PRIM_COMPARE_TILE_SIZE, height - y0);
+		BYTE* dirty = &pDirty[1ull * ty * dirtyStep];
+		UINT32 clean = ncol;
+
+		memset(dirty, 0, ncol);
+
+		for (UINT32 y = 0; (y < th) && (clean > 0); y++)
+		{
+			const BYTE* line1 = &pSrc1[1ull * (y0 + y) * src1Step];
+			const BYTE* line2 = &pSrc2[1ull * (y0 + y) * src2Step];
+
+			for (UINT32 tx = 0; tx < nfull; tx++)
+			{
+				const size_t offset = 4ull * PRIM_COMPARE_TILE_SIZE * tx;
+
+				if (dirty[tx])
+					continue;
+
+				if (!avx2_line_equal(&line1[offset], &line2[offset], vmask))
+				{
+					dirty[tx] = 1;
+					clean--;
+				}
+			}
+
+			if ((nfull < ncol) && !dirty[nfull])
+			{
+				const size_t offset = 4ull * PRIM_COMPARE_TILE_SIZE * nfull;
+
+				if (!prim_compare_line_32u(&line1[offset], &line2[offset],
+				                           width % PRIM_COMPARE_TILE_SIZE, mask))
+				{
+					dirty[nfull] = 1;
+					clean--;
+				}
+			}
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_compare_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->compare_tiles_32u = avx2_compare_tiles_32u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
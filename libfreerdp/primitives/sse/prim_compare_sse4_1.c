@@ -0,0 +1,116 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Tile based image comparison, SSE4.1 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_avxsse.h"
+#include "prim_compare.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#include <smmintrin.h>
+
+/* Compare one line of a 16 pixel wide tile (64 bytes) */
+static inline BOOL sse41_line_equal(const BYTE* WINPR_RESTRICT a, const BYTE* WINPR_RESTRICT b,
+                                    __m128i mask)
+{
+	const __m128i x0 = _mm_xor_si128(LOAD_SI128(&a[0]), LOAD_SI128(&b[0]));
+	const __m128i x1 = _mm_xor_si128(LOAD_SI128(&a[16]), LOAD_SI128(&b[16]));
+	const __m128i x2 = _mm_xor_si128(LOAD_SI128(&a[32]), LOAD_SI128(&b[32]));
+	const __m128i x3 = _mm_xor_si128(LOAD_SI128(&a[48]), LOAD_SI128(&b[48]));
+	const __m128i x = _mm_or_si128(_mm_or_si128(x0, x1), _mm_or_si128(x2, x3));
+	return _mm_testz_si128(x, mask) != 0;
+}
+
+static pstatus_t sse41_compare_tiles_32u(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+                                         const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+                                         UINT32 width, UINT32 height, UINT32 mask,
+                                         BYTE* WINPR_RESTRICT pDirty, UINT32 dirtyStep)
+{
+	const UINT32 ncol = (width + PRIM_COMPARE_TILE_SIZE - 1) / PRIM_COMPARE_TILE_SIZE;
+	const UINT32 nfull = width / PRIM_COMPARE_TILE_SIZE;
+	const __m128i vmask = mm_set1_epu32(mask);
+
+	WINPR_ASSERT(pSrc1);
+	WINPR_ASSERT(pSrc2);
+	WINPR_ASSERT(pDirty);
+	WINPR_ASSERT(dirtyStep >= ncol);
+
+	for (UINT32 ty = 0; ty * PRIM_COMPARE_TILE_SIZE < height; ty++)
+	{
+		const UINT32 y0 = ty * PRIM_COMPARE_TILE_SIZE;
+		const UINT32 th = MIN(PRIM_COMPARE_TILE_SIZE, height - y0);
+		BYTE* dirty = &pDirty[1ull * ty * dirtyStep];
+		UINT32 clean = ncol;
+
+		memset(dirty, 0, ncol);
+
+		for (UINT32 y = 0; (y < th) && (clean > 0); y++)
+		{
+			const BYTE* line1 = &pSrc1[1ull * (y0 + y) * src1Step];
+			const BYTE* line2 = &pSrc2[1ull * (y0 + y) * src2Step];
+
+			for (UINT32 tx = 0; tx < nfull; tx++)
+			{
+				const size_t offset = 4ull * PRIM_COMPARE_TILE_SIZE * tx;
+
+				if (dirty[tx])
+					continue;
+
+				if (!sse41_line_equal(&line1[offset], &line2[offset], vmask))
+				{
+					dirty[tx] = 1;
+					clean--;
+				}
+			}
+
+			if ((nfull < ncol) && !dirty[nfull])
+			{
+				const size_t offset = 4ull * PRIM_COMPARE_TILE_SIZE * nfull;
+
+				if (!prim_compare_line_32u(&line1[offset], &line2[offset],
+				                           width % PRIM_COMPARE_TILE_SIZE, mask))
+				{
+					dirty[nfull] = 1;
+					clean--;
+				}
+			}
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_compare_sse41_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "SSE4.1 optimizations");
+	prims->compare_tiles_32u = sse41_compare_tiles_32u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE4.1 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
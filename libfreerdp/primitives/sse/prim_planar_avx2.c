@@ -0,0 +1,351 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Planar codec plane operations, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_planar.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Gathers the channels of 4 pixels per lane, result is [R0..R3 G0..G3 B0..B3 A0..A3] */
+static __m256i avx2_split_mask(const BYTE offsets[4])
+{
+	BYTE mask[16] = { 0 };
+
+	for (size_t c = 0; c < 4; c++)
+	{
+		for (size_t p = 0; p < 4; p++)
+			mask[c * 4 + p] = (BYTE)(p * 4 + offsets[c]);
+	}
+
+	return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mask));
+}
+
+/* Moves the [R G B A] bytes of 4 pixels per lane to their position in the pixel format */
+static __m256i avx2_merge_mask(const BYTE offsets[4])
+{
+	BYTE mask[16] = { 0 };
+
+	for (size_t p = 0; p < 4; p++)
+	{
+		for (size_t c = 0; c < 4; c++)
+			mask[p * 4 + offsets[c]] = (BYTE)(p * 4 + c);
+	}
+
+	return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)mask));
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_planarSplit_8u_AC4P4(const BYTE* WINPR_RESTRICT pSrc, INT32 srcStep,
+                                           UINT32 srcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                           UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pDst || !planar_pixel_offsets(srcFormat, offsets, &hasAlpha))
+		return generic->planarSplit_8u_AC4P4(pSrc, srcStep, srcFormat, pDst, width, height);
+
+	const __m256i mask = avx2_split_mask(offsets);
+	/* The in lane transpose leaves the 4 pixel groups in the order 0 2 4 6 1 3 5 7 */
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const __m256i opaque = _mm256_set1_epi8((char)0xFF);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* pLine = &pSrc[1LL * y * srcStep];
+		const size_t off = 1ULL * y * width;
+		BYTE* pR = &pDst[0][off];
+		BYTE* pG = &pDst[1][off];
+		BYTE* pB = &pDst[2][off];
+		BYTE* pA = &pDst[3][off];
+		UINT32 x = 0;
+
+		for (; x + 32 <= width; x += 32)
+		{
+			const __m256i* src = (const __m256i*)&pLine[4ULL * x];
+			const __m256i p0 = _mm256_shuffle_epi8(_mm256_loadu_si256(&src[0]), mask);
+			const __m256i p1 = _mm256_shuffle_epi8(_mm256_loadu_si256(&src[1]), mask);
+			const __m256i p2 = _mm256_shuffle_epi8(_mm256_loadu_si256(&src[2]), mask);
+			const __m256i p3 = _mm256_shuffle_epi8(_mm256_loadu_si256(&src[3]), mask);
+			const __m256i rg01 = _mm256_unpacklo_epi32(p0, p1);
+			const __m256i ba01 = _mm256_unpackhi_epi32(p0, p1);
+			const __m256i rg23 = _mm256_unpacklo_epi32(p2, p3);
+			const __m256i ba23 = _mm256_unpackhi_epi32(p2, p3);
+			const __m256i r = _mm256_unpacklo_epi64(rg01, rg23);
+			const __m256i g = _mm256_unpackhi_epi64(rg01, rg23);
+			const __m256i b = _mm256_unpacklo_epi64(ba01, ba23);
+
+			_mm256_storeu_si256((__m256i*)&pR[x], _mm256_permutevar8x32_epi32(r, order));
+			_mm256_storeu_si256((__m256i*)&pG[x], _mm256_permutevar8x32_epi32(g, order));
+			_mm256_storeu_si256((__m256i*)&pB[x], _mm256_permutevar8x32_epi32(b, order));
+
+			if (hasAlpha)
+			{
+				const __m256i a = _mm256_unpackhi_epi64(ba01, ba23);
+				_mm256_storeu_si256((__m256i*)&pA[x], _mm256_permutevar8x32_epi32(a, order));
+			}
+			else
+				_mm256_storeu_si256((__m256i*)&pA[x], opaque);
+		}
+
+		planar_split_row_32(&pLine[4ULL * x], offsets, hasAlpha, &pR[x], &pG[x], &pB[x], &pA[x],
+		                    width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_planarMerge_8u_P4AC4(const BYTE* WINPR_RESTRICT pSrc[4],
+                                           BYTE* WINPR_RESTRICT pDst, INT32 dstStep,
+                                           UINT32 dstFormat, UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pSrc[0] || !pSrc[1] || !pSrc[2] || !pDst ||
+	    !planar_pixel_offsets(dstFormat, offsets, &hasAlpha))
+		return generic->planarMerge_8u_P4AC4(pSrc, pDst, dstStep, dstFormat, width, height);
+
+	const __m256i mask = avx2_merge_mask(offsets);
+	const __m256i opaque = _mm256_set1_epi8((char)0xFF);
+	const BOOL useAlpha = hasAlpha && pSrc[3];
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		BYTE* pLine = &pDst[1LL * y * dstStep];
+		const size_t off = 1ULL * y * width;
+		const BYTE* pR = &pSrc[0][off];
+		const BYTE* pG = &pSrc[1][off];
+		const BYTE* pB = &pSrc[2][off];
+		const BYTE* pA = useAlpha ? &pSrc[3][off] : NULL;
+		UINT32 x = 0;
+
+		for (; x + 32 <= width; x += 32)
+		{
+			__m256i* dst = (__m256i*)&pLine[4ULL * x];
+			/* Swap the middle quadwords so the in lane unpacks produce consecutive pixels */
+			const __m256i r = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)&pR[x]),
+			                                           0xD8);
+			const __m256i g = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)&pG[x]),
+			                                           0xD8);
+			const __m256i b = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)&pB[x]),
+			                                           0xD8);
+			const __m256i a =
+			    pA ? _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)&pA[x]), 0xD8)
+			       : opaque;
+			const __m256i rgLo = _mm256_unpacklo_epi8(r, g);
+			const __m256i rgHi = _mm256_unpackhi_epi8(r, g);
+			const __m256i baLo = _mm256_unpacklo_epi8(b, a);
+			const __m256i baHi = _mm256_unpackhi_epi8(b, a);
+			const __m256i q0 = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rgLo, baLo), mask);
+			const __m256i q1 = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rgLo, baLo), mask);
+			const __m256i q2 = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rgHi, baHi), mask);
+			const __m256i q3 = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rgHi, baHi), mask);
+
+			_mm256_storeu_si256(&dst[0], _mm256_permute2x128_si256(q0, q1, 0x20));
+			_mm256_storeu_si256(&dst[1], _mm256_permute2x128_si256(q0, q1, 0x31));
+			_mm256_storeu_si256(&dst[2], _mm256_permute2x128_si256(q2, q3, 0x20));
+			_mm256_storeu_si256(&dst[3], _mm256_permute2x128_si256(q2, q3, 0x31));
+		}
+
+		planar_merge_row_32(&pR[x], &pG[x], &pB[x], pA ? &pA[x] : NULL, offsets, hasAlpha,
+		                    &pLine[4ULL * x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_planarDeltaEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 width, UINT32 height)
+{
+	if (!pSrc || !pDst)
+		return -1;
+
+	if (height == 0)
+		return PRIMITIVES_SUCCESS;
+
+	const __m256i zero = _mm256_setzero_si256();
+	memcpy(pDst, pSrc, width);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		const BYTE* pCur = &pSrc[off];
+		const BYTE* pPrev = &pSrc[off - width];
+		BYTE* pOut = &pDst[off];
+		UINT32 x = 0;
+
+		for (; x + 32 <= width; x += 32)
+		{
+			/* (d << 1) ^ (d >> 7) maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ... */
+			const __m256i delta = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i*)&pCur[x]),
+			                                      _mm256_loadu_si256((const __m256i*)&pPrev[x]));
+			const __m256i sign = _mm256_cmpgt_epi8(zero, delta);
+			_mm256_storeu_si256((__m256i*)&pOut[x],
+			                    _mm256_xor_si256(_mm256_add_epi8(delta, delta), sign));
+		}
+
+		planar_delta_encode_row(&pCur[x], &pPrev[x], &pOut[x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_planarDeltaDecode_8u(BYTE* WINPR_RESTRICT pSrcDst, UINT32 width,
+                                           UINT32 height)
+{
+	if (!pSrcDst)
+		return -1;
+
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i low7 = _mm256_set1_epi8(0x7F);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		BYTE* pCur = &pSrcDst[off];
+		const BYTE* pPrev = &pSrcDst[off - width];
+		UINT32 x = 0;
+
+		for (; x + 32 <= width; x += 32)
+		{
+			const __m256i val = _mm256_loadu_si256((const __m256i*)&pCur[x]);
+			const __m256i half = _mm256_and_si256(_mm256_srli_epi16(val, 1), low7);
+			const __m256i sign = _mm256_sub_epi8(zero, _mm256_and_si256(val, one));
+			const __m256i delta = _mm256_xor_si256(half, sign);
+			_mm256_storeu_si256(
+			    (__m256i*)&pCur[x],
+			    _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)&pPrev[x]), delta));
+		}
+
+		planar_delta_decode_row(&pCur[x], &pPrev[x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Offset of the first byte from x on that equals its predecessor, len if there is none */
+static UINT32 avx2_next_repeat(const BYTE* WINPR_RESTRICT pSrc, UINT32 x, UINT32 len, BYTE prev)
+{
+	if (x == 0)
+	{
+		if ((len == 0) || (pSrc[0] == prev))
+			return 0;
+		x = 1;
+	}
+
+	for (; x + 32 <= len; x += 32)
+	{
+		const __m256i cur = _mm256_loadu_si256((const __m256i*)&pSrc[x]);
+		const __m256i before = _mm256_loadu_si256((const __m256i*)&pSrc[x - 1]);
+		const UINT32 eq = (UINT32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, before));
+
+		if (eq)
+			return x + planar_ctz32(eq);
+	}
+
+	for (; x < len; x++)
+	{
+		if (pSrc[x] == pSrc[x - 1])
+			return x;
+	}
+
+	return len;
+}
+
+static UINT32 avx2_run_length(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE val)
+{
+	const __m256i cmp = _mm256_set1_epi8((char)val);
+	UINT32 x = 0;
+
+	for (; x + 32 <= len; x += 32)
+	{
+		const __m256i cur = _mm256_loadu_si256((const __m256i*)&pSrc[x]);
+		const UINT32 eq = (UINT32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cur, cmp));
+
+		if (eq != UINT32_MAX)
+			return x + planar_ctz32(~eq);
+	}
+
+	return x + planar_run_length(&pSrc[x], len - x, val);
+}
+
+static pstatus_t avx2_planarFindRun_8u(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE prev,
+                                       UINT32 minRun, UINT32* WINPR_RESTRICT pStart,
+                                       UINT32* WINPR_RESTRICT pLength)
+{
+	if ((!pSrc && (len > 0)) || !pStart || !pLength || (minRun == 0))
+		return -1;
+
+	UINT32 x = 0;
+
+	while ((x = avx2_next_repeat(pSrc, x, len, prev)) < len)
+	{
+		const BYTE val = (x > 0) ? pSrc[x - 1] : prev;
+		const UINT32 run = avx2_run_length(&pSrc[x], len - x, val);
+
+		if (run >= minRun)
+		{
+			*pStart = x;
+			*pLength = run;
+			return PRIMITIVES_SUCCESS;
+		}
+
+		x += run;
+	}
+
+	*pStart = len;
+	*pLength = 0;
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->planarSplit_8u_AC4P4 = avx2_planarSplit_8u_AC4P4;
+	prims->planarMerge_8u_P4AC4 = avx2_planarMerge_8u_P4AC4;
+	prims->planarDeltaEncode_8u = avx2_planarDeltaEncode_8u;
+	prims->planarDeltaDecode_8u = avx2_planarDeltaDecode_8u;
+	prims->planarFindRun_8u = avx2_planarFindRun_8u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
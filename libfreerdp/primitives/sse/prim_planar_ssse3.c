@@ -0,0 +1,327 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Planar codec plane operations, SSSE3 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_avxsse.h"
+#include "prim_planar.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Gathers the channels of 4 pixels, result is [R0..R3 G0..G3 B0..B3 A0..A3] */
+static __m128i ssse3_split_mask(const BYTE offsets[4])
+{
+	BYTE mask[16] = { 0 };
+
+	for (size_t c = 0; c < 4; c++)
+	{
+		for (size_t p = 0; p < 4; p++)
+			mask[c * 4 + p] = (BYTE)(p * 4 + offsets[c]);
+	}
+
+	return LOAD_SI128(mask);
+}
+
+/* Moves the [R G B A] bytes of 4 pixels to their position in the pixel format */
+static __m128i ssse3_merge_mask(const BYTE offsets[4])
+{
+	BYTE mask[16] = { 0 };
+
+	for (size_t p = 0; p < 4; p++)
+	{
+		for (size_t c = 0; c < 4; c++)
+			mask[p * 4 + offsets[c]] = (BYTE)(p * 4 + c);
+	}
+
+	return LOAD_SI128(mask);
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t ssse3_planarSplit_8u_AC4P4(const BYTE* WINPR_RESTRICT pSrc, INT32 srcStep,
+                                            UINT32 srcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                            UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pDst || !planar_pixel_offsets(srcFormat, offsets, &hasAlpha))
+		return generic->planarSplit_8u_AC4P4(pSrc, srcStep, srcFormat, pDst, width, height);
+
+	const __m128i mask = ssse3_split_mask(offsets);
+	const __m128i opaque = mm_set1_epu8(0xFF);
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* pLine = &pSrc[1LL * y * srcStep];
+		const size_t off = 1ULL * y * width;
+		BYTE* pR = &pDst[0][off];
+		BYTE* pG = &pDst[1][off];
+		BYTE* pB = &pDst[2][off];
+		BYTE* pA = &pDst[3][off];
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			const BYTE* src = &pLine[4ULL * x];
+			const __m128i p0 = _mm_shuffle_epi8(LOAD_SI128(&src[0]), mask);
+			const __m128i p1 = _mm_shuffle_epi8(LOAD_SI128(&src[16]), mask);
+			const __m128i p2 = _mm_shuffle_epi8(LOAD_SI128(&src[32]), mask);
+			const __m128i p3 = _mm_shuffle_epi8(LOAD_SI128(&src[48]), mask);
+			const __m128i rg01 = _mm_unpacklo_epi32(p0, p1);
+			const __m128i ba01 = _mm_unpackhi_epi32(p0, p1);
+			const __m128i rg23 = _mm_unpacklo_epi32(p2, p3);
+			const __m128i ba23 = _mm_unpackhi_epi32(p2, p3);
+
+			STORE_SI128(&pR[x], _mm_unpacklo_epi64(rg01, rg23));
+			STORE_SI128(&pG[x], _mm_unpackhi_epi64(rg01, rg23));
+			STORE_SI128(&pB[x], _mm_unpacklo_epi64(ba01, ba23));
+			STORE_SI128(&pA[x], hasAlpha ? _mm_unpackhi_epi64(ba01, ba23) : opaque);
+		}
+
+		planar_split_row_32(&pLine[4ULL * x], offsets, hasAlpha, &pR[x], &pG[x], &pB[x], &pA[x],
+		                    width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t ssse3_planarMerge_8u_P4AC4(const BYTE* WINPR_RESTRICT pSrc[4],
+                                            BYTE* WINPR_RESTRICT pDst, INT32 dstStep,
+                                            UINT32 dstFormat, UINT32 width, UINT32 height)
+{
+	BYTE offsets[4] = { 0 };
+	BOOL hasAlpha = FALSE;
+
+	if (!pSrc || !pSrc[0] || !pSrc[1] || !pSrc[2] || !pDst ||
+	    !planar_pixel_offsets(dstFormat, offsets, &hasAlpha))
+		return generic->planarMerge_8u_P4AC4(pSrc, pDst, dstStep, dstFormat, width, height);
+
+	const __m128i mask = ssse3_merge_mask(offsets);
+	const __m128i opaque = mm_set1_epu8(0xFF);
+	const BOOL useAlpha = hasAlpha && pSrc[3];
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		BYTE* pLine = &pDst[1LL * y * dstStep];
+		const size_t off = 1ULL * y * width;
+		const BYTE* pR = &pSrc[0][off];
+		const BYTE* pG = &pSrc[1][off];
+		const BYTE* pB = &pSrc[2][off];
+		const BYTE* pA = useAlpha ? &pSrc[3][off] : NULL;
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			BYTE* dst = &pLine[4ULL * x];
+			const __m128i r = LOAD_SI128(&pR[x]);
+			const __m128i g = LOAD_SI128(&pG[x]);
+			const __m128i b = LOAD_SI128(&pB[x]);
+			const __m128i a = pA ? LOAD_SI128(&pA[x]) : opaque;
+			const __m128i rgLo = _mm_unpacklo_epi8(r, g);
+			const __m128i rgHi = _mm_unpackhi_epi8(r, g);
+			const __m128i baLo = _mm_unpacklo_epi8(b, a);
+			const __m128i baHi = _mm_unpackhi_epi8(b, a);
+
+			STORE_SI128(&dst[0], _mm_shuffle_epi8(_mm_unpacklo_epi16(rgLo, baLo), mask));
+			STORE_SI128(&dst[16], _mm_shuffle_epi8(_mm_unpackhi_epi16(rgLo, baLo), mask));
+			STORE_SI128(&dst[32], _mm_shuffle_epi8(_mm_unpacklo_epi16(rgHi, baHi), mask));
+			STORE_SI128(&dst[48], _mm_shuffle_epi8(_mm_unpackhi_epi16(rgHi, baHi), mask));
+		}
+
+		planar_merge_row_32(&pR[x], &pG[x], &pB[x], pA ? &pA[x] : NULL, offsets, hasAlpha,
+		                    &pLine[4ULL * x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t ssse3_planarDeltaEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 width,
+                                            UINT32 height)
+{
+	if (!pSrc || !pDst)
+		return -1;
+
+	if (height == 0)
+		return PRIMITIVES_SUCCESS;
+
+	const __m128i zero = _mm_setzero_si128();
+	memcpy(pDst, pSrc, width);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		const BYTE* pCur = &pSrc[off];
+		const BYTE* pPrev = &pSrc[off - width];
+		BYTE* pOut = &pDst[off];
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			/* (d << 1) ^ (d >> 7) maps 0, -1, 1, -2, ... to 0, 1, 2, 3, ... */
+			const __m128i delta = _mm_sub_epi8(LOAD_SI128(&pCur[x]), LOAD_SI128(&pPrev[x]));
+			const __m128i sign = _mm_cmpgt_epi8(zero, delta);
+			STORE_SI128(&pOut[x], _mm_xor_si128(_mm_add_epi8(delta, delta), sign));
+		}
+
+		planar_delta_encode_row(&pCur[x], &pPrev[x], &pOut[x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t ssse3_planarDeltaDecode_8u(BYTE* WINPR_RESTRICT pSrcDst, UINT32 width,
+                                            UINT32 height)
+{
+	if (!pSrcDst)
+		return -1;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = mm_set1_epu8(1);
+	const __m128i low7 = mm_set1_epu8(0x7F);
+
+	for (UINT32 y = 1; y < height; y++)
+	{
+		const size_t off = 1ULL * y * width;
+		BYTE* pCur = &pSrcDst[off];
+		const BYTE* pPrev = &pSrcDst[off - width];
+		UINT32 x = 0;
+
+		for (; x + 16 <= width; x += 16)
+		{
+			const __m128i val = LOAD_SI128(&pCur[x]);
+			const __m128i half = _mm_and_si128(_mm_srli_epi16(val, 1), low7);
+			const __m128i sign = _mm_sub_epi8(zero, _mm_and_si128(val, one));
+			const __m128i delta = _mm_xor_si128(half, sign);
+			STORE_SI128(&pCur[x], _mm_add_epi8(LOAD_SI128(&pPrev[x]), delta));
+		}
+
+		planar_delta_decode_row(&pCur[x], &pPrev[x], width - x);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Offset of the first byte from x on that equals its predecessor, len if there is none */
+static UINT32 ssse3_next_repeat(const BYTE* WINPR_RESTRICT pSrc, UINT32 x, UINT32 len, BYTE prev)
+{
+	if (x == 0)
+	{
+		if ((len == 0) || (pSrc[0] == prev))
+			return 0;
+		x = 1;
+	}
+
+	for (; x + 16 <= len; x += 16)
+	{
+		const __m128i cur = LOAD_SI128(&pSrc[x]);
+		const __m128i before = LOAD_SI128(&pSrc[x - 1]);
+		const UINT32 eq = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(cur, before));
+
+		if (eq)
+			return x + planar_ctz32(eq);
+	}
+
+	for (; x < len; x++)
+	{
+		if (pSrc[x] == pSrc[x - 1])
+			return x;
+	}
+
+	return len;
+}
+
+static UINT32 ssse3_run_length(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE val)
+{
+	const __m128i cmp = mm_set1_epu8(val);
+	UINT32 x = 0;
+
+	for (; x + 16 <= len; x += 16)
+	{
+		const UINT32 eq = (UINT32)_mm_movemask_epi8(_mm_cmpeq_epi8(LOAD_SI128(&pSrc[x]), cmp));
+
+		if (eq != 0xFFFF)
+			return x + planar_ctz32(~eq);
+	}
+
+	return x + planar_run_length(&pSrc[x], len - x, val);
+}
+
+static pstatus_t ssse3_planarFindRun_8u(const BYTE* WINPR_RESTRICT pSrc, UINT32 len, BYTE prev,
+                                        UINT32 minRun, UINT32* WINPR_RESTRICT pStart,
+                                        UINT32* WINPR_RESTRICT pLength)
+{
+	if ((!pSrc && (len > 0)) || !pStart || !pLength || (minRun == 0))
+		return -1;
+
+	UINT32 x = 0;
+
+	while ((x = ssse3_next_repeat(pSrc, x, len, prev)) < len)
+	{
+		const BYTE val = (x > 0) ? pSrc[x - 1] : prev;
+		const UINT32 run = ssse3_run_length(&pSrc[x], len - x, val);
+
+		if (run >= minRun)
+		{
+			*pStart = x;
+			*pLength = run;
+			return PRIMITIVES_SUCCESS;
+		}
+
+		x += run;
+	}
+
+	*pStart = len;
+	*pLength = 0;
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar_ssse3_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "SSE3/SSSE3 optimizations");
+	prims->planarSplit_8u_AC4P4 = ssse3_planarSplit_8u_AC4P4;
+	prims->planarMerge_8u_P4AC4 = ssse3_planarMerge_8u_P4AC4;
+	prims->planarDeltaEncode_8u = ssse3_planarDeltaEncode_8u;
+	prims->planarDeltaDecode_8u = ssse3_planarDeltaDecode_8u;
+	prims->planarFindRun_8u = ssse3_planarFindRun_8u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSSE3 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,111 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Ternary raster operations, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_rop.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Operands of the current 32 byte block, only the ones used by an operation are loaded */
+#define ROP_D _mm256_loadu_si256((const __m256i*)&pDst[x])
+#define ROP_S _mm256_loadu_si256((const __m256i*)&pSrc[x])
+#define ROP_P _mm256_loadu_si256((const __m256i*)&pPat[x])
+#define ROP_NOT(a) _mm256_xor_si256((a), _mm256_set1_epi32(-1))
+
+#define AVX2_ROP3_ROUTINE(_name_, _op_)                                                  \
+	static void _name_(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat, \
+	                   BYTE* WINPR_RESTRICT pDst, UINT32 len)                            \
+	{                                                                                    \
+		WINPR_UNUSED(pSrc);                                                              \
+		WINPR_UNUSED(pPat);                                                              \
+		for (UINT32 x = 0; x < len; x += sizeof(__m256i))                                \
+			_mm256_storeu_si256((__m256i*)&pDst[x], _op_);                               \
+	}
+
+AVX2_ROP3_ROUTINE(avx2_rop3_NOTSRCCOPY, ROP_NOT(ROP_S))
+AVX2_ROP3_ROUTINE(avx2_rop3_SRCERASE, _mm256_andnot_si256(ROP_D, ROP_S))
+AVX2_ROP3_ROUTINE(avx2_rop3_DSTINVERT, ROP_NOT(ROP_D))
+AVX2_ROP3_ROUTINE(avx2_rop3_PATINVERT, _mm256_xor_si256(ROP_P, ROP_D))
+AVX2_ROP3_ROUTINE(avx2_rop3_SRCINVERT, _mm256_xor_si256(ROP_S, ROP_D))
+AVX2_ROP3_ROUTINE(avx2_rop3_SRCAND, _mm256_and_si256(ROP_S, ROP_D))
+AVX2_ROP3_ROUTINE(avx2_rop3_PSDPxax,
+                  _mm256_xor_si256(ROP_P, _mm256_and_si256(ROP_S, _mm256_xor_si256(ROP_D, ROP_P))))
+AVX2_ROP3_ROUTINE(avx2_rop3_MERGEPAINT, _mm256_or_si256(ROP_NOT(ROP_S), ROP_D))
+AVX2_ROP3_ROUTINE(avx2_rop3_MERGECOPY, _mm256_and_si256(ROP_S, ROP_P))
+AVX2_ROP3_ROUTINE(avx2_rop3_SRCCOPY, ROP_S)
+AVX2_ROP3_ROUTINE(avx2_rop3_DSPDxax,
+                  _mm256_xor_si256(ROP_D, _mm256_and_si256(ROP_S, _mm256_xor_si256(ROP_P, ROP_D))))
+AVX2_ROP3_ROUTINE(avx2_rop3_SRCPAINT, _mm256_or_si256(ROP_S, ROP_D))
+AVX2_ROP3_ROUTINE(avx2_rop3_PATCOPY, ROP_P)
+
+static const prim_rop3_kernel_fn avx2_kernels[256] = {
+	[PRIM_ROP3_NOTSRCCOPY] = avx2_rop3_NOTSRCCOPY, [PRIM_ROP3_SRCERASE] = avx2_rop3_SRCERASE,
+	[PRIM_ROP3_DSTINVERT] = avx2_rop3_DSTINVERT,   [PRIM_ROP3_PATINVERT] = avx2_rop3_PATINVERT,
+	[PRIM_ROP3_SRCINVERT] = avx2_rop3_SRCINVERT,   [PRIM_ROP3_SRCAND] = avx2_rop3_SRCAND,
+	[PRIM_ROP3_PSDPxax] = avx2_rop3_PSDPxax,       [PRIM_ROP3_MERGEPAINT] = avx2_rop3_MERGEPAINT,
+	[PRIM_ROP3_MERGECOPY] = avx2_rop3_MERGECOPY,   [PRIM_ROP3_SRCCOPY] = avx2_rop3_SRCCOPY,
+	[PRIM_ROP3_DSPDxax] = avx2_rop3_DSPDxax,       [PRIM_ROP3_SRCPAINT] = avx2_rop3_SRCPAINT,
+	[PRIM_ROP3_PATCOPY] = avx2_rop3_PATCOPY
+};
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_rop3_8u(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat,
+                              BYTE* WINPR_RESTRICT pDst, UINT32 len, BYTE rop3)
+{
+	const prim_rop3_kernel_fn fkt = avx2_kernels[rop3];
+	const UINT32 blocks = len & ~(UINT32)(sizeof(__m256i) - 1);
+
+	if (!fkt || (blocks == 0))
+		return generic->rop3_8u(pSrc, pPat, pDst, len, rop3);
+
+	if (!prim_rop3_check(pSrc, pPat, pDst, rop3))
+		return -1;
+
+	fkt(pSrc, pPat, pDst, blocks);
+
+	if (blocks == len)
+		return PRIMITIVES_SUCCESS;
+
+	return generic->rop3_8u(pSrc ? &pSrc[blocks] : NULL, pPat ? &pPat[blocks] : NULL,
+	                        &pDst[blocks], len - blocks, rop3);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_rop_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->rop3_8u = avx2_rop3_8u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,111 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Ternary raster operations, SSE2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_rop.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Operands of the current 16 byte block, only the ones used by an operation are loaded */
+#define ROP_D _mm_loadu_si128((const __m128i*)&pDst[x])
+#define ROP_S _mm_loadu_si128((const __m128i*)&pSrc[x])
+#define ROP_P _mm_loadu_si128((const __m128i*)&pPat[x])
+#define ROP_NOT(a) _mm_xor_si128((a), _mm_set1_epi32(-1))
+
+#define SSE2_ROP3_ROUTINE(_name_, _op_)                                                  \
+	static void _name_(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat, \
+	                   BYTE* WINPR_RESTRICT pDst, UINT32 len)                            \
+	{                                                                                    \
+		WINPR_UNUSED(pSrc);                                                              \
+		WINPR_UNUSED(pPat);                                                              \
+		for (UINT32 x = 0; x < len; x += sizeof(__m128i))                                \
+			_mm_storeu_si128((__m128i*)&pDst[x], _op_);                                  \
+	}
+
+SSE2_ROP3_ROUTINE(sse2_rop3_NOTSRCCOPY, ROP_NOT(ROP_S))
+SSE2_ROP3_ROUTINE(sse2_rop3_SRCERASE, _mm_andnot_si128(ROP_D, ROP_S))
+SSE2_ROP3_ROUTINE(sse2_rop3_DSTINVERT, ROP_NOT(ROP_D))
+SSE2_ROP3_ROUTINE(sse2_rop3_PATINVERT, _mm_xor_si128(ROP_P, ROP_D))
+SSE2_ROP3_ROUTINE(sse2_rop3_SRCINVERT, _mm_xor_si128(ROP_S, ROP_D))
+SSE2_ROP3_ROUTINE(sse2_rop3_SRCAND, _mm_and_si128(ROP_S, ROP_D))
+SSE2_ROP3_ROUTINE(sse2_rop3_PSDPxax,
+                  _mm_xor_si128(ROP_P, _mm_and_si128(ROP_S, _mm_xor_si128(ROP_D, ROP_P))))
+SSE2_ROP3_ROUTINE(sse2_rop3_MERGEPAINT, _mm_or_si128(ROP_NOT(ROP_S), ROP_D))
+SSE2_ROP3_ROUTINE(sse2_rop3_MERGECOPY, _mm_and_si128(ROP_S, ROP_P))
+SSE2_ROP3_ROUTINE(sse2_rop3_SRCCOPY, ROP_S)
+SSE2_ROP3_ROUTINE(sse2_rop3_DSPDxax,
+                  _mm_xor_si128(ROP_D, _mm_and_si128(ROP_S, _mm_xor_si128(ROP_P, ROP_D))))
+SSE2_ROP3_ROUTINE(sse2_rop3_SRCPAINT, _mm_or_si128(ROP_S, ROP_D))
+SSE2_ROP3_ROUTINE(sse2_rop3_PATCOPY, ROP_P)
+
+static const prim_rop3_kernel_fn sse2_kernels[256] = {
+	[PRIM_ROP3_NOTSRCCOPY] = sse2_rop3_NOTSRCCOPY, [PRIM_ROP3_SRCERASE] = sse2_rop3_SRCERASE,
+	[PRIM_ROP3_DSTINVERT] = sse2_rop3_DSTINVERT,   [PRIM_ROP3_PATINVERT] = sse2_rop3_PATINVERT,
+	[PRIM_ROP3_SRCINVERT] = sse2_rop3_SRCINVERT,   [PRIM_ROP3_SRCAND] = sse2_rop3_SRCAND,
+	[PRIM_ROP3_PSDPxax] = sse2_rop3_PSDPxax,       [PRIM_ROP3_MERGEPAINT] = sse2_rop3_MERGEPAINT,
+	[PRIM_ROP3_MERGECOPY] = sse2_rop3_MERGECOPY,   [PRIM_ROP3_SRCCOPY] = sse2_rop3_SRCCOPY,
+	[PRIM_ROP3_DSPDxax] = sse2_rop3_DSPDxax,       [PRIM_ROP3_SRCPAINT] = sse2_rop3_SRCPAINT,
+	[PRIM_ROP3_PATCOPY] = sse2_rop3_PATCOPY
+};
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse2_rop3_8u(const BYTE* WINPR_RESTRICT pSrc, const BYTE* WINPR_RESTRICT pPat,
+                              BYTE* WINPR_RESTRICT pDst, UINT32 len, BYTE rop3)
+{
+	const prim_rop3_kernel_fn fkt = sse2_kernels[rop3];
+	const UINT32 blocks = len & ~(UINT32)(sizeof(__m128i) - 1);
+
+	if (!fkt || (blocks == 0))
+		return generic->rop3_8u(pSrc, pPat, pDst, len, rop3);
+
+	if (!prim_rop3_check(pSrc, pPat, pDst, rop3))
+		return -1;
+
+	fkt(pSrc, pPat, pDst, blocks);
+
+	if (blocks == len)
+		return PRIMITIVES_SUCCESS;
+
+	return generic->rop3_8u(pSrc ? &pSrc[blocks] : NULL, pPat ? &pPat[blocks] : NULL,
+	                        &pDst[blocks], len - blocks, rop3);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_rop_sse2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "SSE2 optimizations");
+	prims->rop3_8u = sse2_rop3_8u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
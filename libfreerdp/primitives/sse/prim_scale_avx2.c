@@ -0,0 +1,201 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Separable image scaling, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+/* Loads the taps k and k + 1 of two destination pixels, one per lane */
+static inline __m256i avx2_load_pair(const BYTE* WINPR_RESTRICT a, const BYTE* WINPR_RESTRICT b)
+{
+	const __m128i lo = _mm_loadl_epi64((const __m128i*)a);
+	const __m128i hi = _mm_loadl_epi64((const __m128i*)b);
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+static inline __m256i avx2_load_single(const BYTE* WINPR_RESTRICT a, const BYTE* WINPR_RESTRICT b)
+{
+	INT32 va = 0;
+	INT32 vb = 0;
+	memcpy(&va, a, sizeof(va));
+	memcpy(&vb, b, sizeof(vb));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_cvtsi32_si128(va)),
+	                               _mm_cvtsi32_si128(vb), 1);
+}
+
+static inline __m256i avx2_weight_pair(UINT32 wa, UINT32 wb)
+{
+	const int a = WINPR_CXX_COMPAT_CAST(int, wa);
+	const int b = WINPR_CXX_COMPAT_CAST(int, wb);
+	return _mm256_set_epi32(b, b, b, b, a, a, a, a);
+}
+
+static inline __m256i avx2_madd_add(__m256i acc, __m256i val, __m256i wv)
+{
+	return _mm256_add_epi32(acc, _mm256_madd_epi16(val, wv));
+}
+
+/* Weighted sum of the taps of two destination pixels, 32 bit per channel */
+static inline __m256i avx2_horizontal_pixels(const BYTE* WINPR_RESTRICT srcA,
+                                             const INT16* WINPR_RESTRICT wA,
+                                             const BYTE* WINPR_RESTRICT srcB,
+                                             const INT16* WINPR_RESTRICT wB, UINT32 taps,
+                                             __m256i mask)
+{
+	__m256i acc = _mm256_setzero_si256();
+	UINT32 k = 0;
+
+	for (; k + 1 < taps; k += 2)
+	{
+		const __m256i px =
+		    _mm256_shuffle_epi8(avx2_load_pair(&srcA[4ULL * k], &srcB[4ULL * k]), mask);
+		const __m256i wv = avx2_weight_pair(scale_weight_pair(wA[k], wA[k + 1]),
+		                                    scale_weight_pair(wB[k], wB[k + 1]));
+		acc = avx2_madd_add(acc, px, wv);
+	}
+
+	if (k < taps)
+	{
+		const __m256i px =
+		    _mm256_shuffle_epi8(avx2_load_single(&srcA[4ULL * k], &srcB[4ULL * k]), mask);
+		const __m256i wv =
+		    avx2_weight_pair(scale_weight_pair(wA[k], 0), scale_weight_pair(wB[k], 0));
+		acc = avx2_madd_add(acc, px, wv);
+	}
+
+	return acc;
+}
+
+static inline __m256i avx2_round(__m256i acc)
+{
+	const __m256i round = _mm256_set1_epi32(SCALE_WEIGHT_ROUND);
+	return _mm256_srai_epi32(_mm256_add_epi32(acc, round), SCALE_WEIGHT_SHIFT);
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_scaleHorizontal_8u_C4(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                            UINT32 dstWidth, UINT32 height,
+                                            const UINT32* WINPR_RESTRICT offsets,
+                                            const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const __m256i mask = _mm256_broadcastsi128_si256(
+	    _mm_set_epi8(-128, 7, -128, 3, -128, 6, -128, 2, -128, 5, -128, 1, -128, 4, -128, 0));
+	/* packs/packus work per lane, this restores the pixel order */
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const UINT32 width8 = dstWidth & ~7u;
+
+	if (!pSrc || !pDst || !offsets || !weights || (taps == 0))
+		return -1;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* src = &pSrc[1ULL * y * srcStep];
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		for (UINT32 x = 0; x < width8; x += 8)
+		{
+			__m256i px[4];
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				const UINT32 a = x + 2 * (UINT32)i;
+				const UINT32 b = a + 1;
+				px[i] = avx2_round(avx2_horizontal_pixels(
+				    &src[4ULL * offsets[a]], &weights[1ULL * a * taps], &src[4ULL * offsets[b]],
+				    &weights[1ULL * b * taps], taps, mask));
+			}
+
+			const __m256i lo = _mm256_packs_epi32(px[0], px[1]);
+			const __m256i hi = _mm256_packs_epi32(px[2], px[3]);
+			const __m256i val = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+			_mm256_storeu_si256((__m256i*)&dst[4ULL * x], val);
+		}
+
+		scale_horizontal_pixels(src, dst, width8, dstWidth, offsets, weights, taps);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_scaleVertical_8u_C4(const BYTE* const* WINPR_RESTRICT pSrc,
+                                          const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                          BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const size_t len = 4ULL * width;
+	const size_t len32 = len & ~(size_t)31;
+
+	if (!pSrc || !weights || !pDst || (taps == 0))
+		return -1;
+
+	for (size_t x = 0; x < len32; x += 32)
+	{
+		__m256i acc[4] = { zero, zero, zero, zero };
+
+		for (UINT32 k = 0; k < taps; k += 2)
+		{
+			const BOOL pair = (k + 1 < taps);
+			const __m256i r0 = _mm256_loadu_si256((const __m256i*)&pSrc[k][x]);
+			const __m256i r1 = pair ? _mm256_loadu_si256((const __m256i*)&pSrc[k + 1][x]) : zero;
+			const UINT32 w = scale_weight_pair(weights[k], pair ? weights[k + 1] : 0);
+			const __m256i wv = _mm256_set1_epi32(WINPR_CXX_COMPAT_CAST(int, w));
+			const __m256i lo = _mm256_unpacklo_epi8(r0, r1);
+			const __m256i hi = _mm256_unpackhi_epi8(r0, r1);
+
+			acc[0] = avx2_madd_add(acc[0], _mm256_unpacklo_epi8(lo, zero), wv);
+			acc[1] = avx2_madd_add(acc[1], _mm256_unpackhi_epi8(lo, zero), wv);
+			acc[2] = avx2_madd_add(acc[2], _mm256_unpacklo_epi8(hi, zero), wv);
+			acc[3] = avx2_madd_add(acc[3], _mm256_unpackhi_epi8(hi, zero), wv);
+		}
+
+		/* all operations above work per lane, so the byte order is already correct */
+		const __m256i a = _mm256_packs_epi32(avx2_round(acc[0]), avx2_round(acc[1]));
+		const __m256i b = _mm256_packs_epi32(avx2_round(acc[2]), avx2_round(acc[3]));
+		_mm256_storeu_si256((__m256i*)&pDst[x], _mm256_packus_epi16(a, b));
+	}
+
+	scale_vertical_bytes(pSrc, weights, taps, pDst, len32, len);
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->scaleHorizontal_8u_C4 = avx2_scaleHorizontal_8u_C4;
+	prims->scaleVertical_8u_C4 = avx2_scaleVertical_8u_C4;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,178 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Separable image scaling, SSE4.1 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/sysinfo.h>
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/log.h>
+
+#include "prim_internal.h"
+#include "prim_avxsse.h"
+#include "prim_scale.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+
+/* Interleaves the channels of two adjacent pixels as 16 bit [c0 c0' c1 c1' c2 c2' c3 c3'] */
+static inline __m128i sse41_pixel_pair(const BYTE* WINPR_RESTRICT src, __m128i mask)
+{
+	return _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i*)src), mask);
+}
+
+static inline __m128i sse41_pixel_single(const BYTE* WINPR_RESTRICT src, __m128i mask)
+{
+	INT32 val = 0;
+	memcpy(&val, src, sizeof(val));
+	return _mm_shuffle_epi8(_mm_cvtsi32_si128(val), mask);
+}
+
+static inline __m128i sse41_madd_add(__m128i acc, __m128i val, __m128i wv)
+{
+	return _mm_add_epi32(acc, _mm_madd_epi16(val, wv));
+}
+
+/* Weighted sum of the taps of one destination pixel, 32 bit per channel */
+static inline __m128i sse41_horizontal_pixel(const BYTE* WINPR_RESTRICT src,
+                                             const INT16* WINPR_RESTRICT w, UINT32 taps,
+                                             __m128i mask)
+{
+	__m128i acc = _mm_setzero_si128();
+	UINT32 k = 0;
+
+	for (; k + 1 < taps; k += 2)
+	{
+		const __m128i wv = mm_set1_epu32(scale_weight_pair(w[k], w[k + 1]));
+		acc = sse41_madd_add(acc, sse41_pixel_pair(&src[4ULL * k], mask), wv);
+	}
+
+	if (k < taps)
+	{
+		const __m128i wv = mm_set1_epu32(scale_weight_pair(w[k], 0));
+		acc = sse41_madd_add(acc, sse41_pixel_single(&src[4ULL * k], mask), wv);
+	}
+
+	return acc;
+}
+
+static inline __m128i sse41_round(__m128i acc)
+{
+	const __m128i round = _mm_set1_epi32(SCALE_WEIGHT_ROUND);
+	return _mm_srai_epi32(_mm_add_epi32(acc, round), SCALE_WEIGHT_SHIFT);
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse41_scaleHorizontal_8u_C4(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                             BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                             UINT32 dstWidth, UINT32 height,
+                                             const UINT32* WINPR_RESTRICT offsets,
+                                             const INT16* WINPR_RESTRICT weights, UINT32 taps)
+{
+	const __m128i mask =
+	    _mm_set_epi8(-128, 7, -128, 3, -128, 6, -128, 2, -128, 5, -128, 1, -128, 4, -128, 0);
+	const UINT32 width4 = dstWidth & ~3u;
+
+	if (!pSrc || !pDst || !offsets || !weights || (taps == 0))
+		return -1;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* src = &pSrc[1ULL * y * srcStep];
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		for (UINT32 x = 0; x < width4; x += 4)
+		{
+			__m128i px[4];
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				const BYTE* s = &src[4ULL * offsets[x + i]];
+				const INT16* w = &weights[1ULL * (x + i) * taps];
+				px[i] = sse41_round(sse41_horizontal_pixel(s, w, taps, mask));
+			}
+
+			const __m128i lo = _mm_packs_epi32(px[0], px[1]);
+			const __m128i hi = _mm_packs_epi32(px[2], px[3]);
+			STORE_SI128(&dst[4ULL * x], _mm_packus_epi16(lo, hi));
+		}
+
+		scale_horizontal_pixels(src, dst, width4, dstWidth, offsets, weights, taps);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse41_scaleVertical_8u_C4(const BYTE* const* WINPR_RESTRICT pSrc,
+                                           const INT16* WINPR_RESTRICT weights, UINT32 taps,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const size_t len = 4ULL * width;
+	const size_t len16 = len & ~(size_t)15;
+
+	if (!pSrc || !weights || !pDst || (taps == 0))
+		return -1;
+
+	for (size_t x = 0; x < len16; x += 16)
+	{
+		__m128i acc[4] = { zero, zero, zero, zero };
+
+		for (UINT32 k = 0; k < taps; k += 2)
+		{
+			const BOOL pair = (k + 1 < taps);
+			const __m128i r0 = LOAD_SI128(&pSrc[k][x]);
+			const __m128i r1 = pair ? LOAD_SI128(&pSrc[k + 1][x]) : zero;
+			const UINT32 w = scale_weight_pair(weights[k], pair ? weights[k + 1] : 0);
+			const __m128i wv = mm_set1_epu32(w);
+			const __m128i lo = _mm_unpacklo_epi8(r0, r1);
+			const __m128i hi = _mm_unpackhi_epi8(r0, r1);
+
+			acc[0] = sse41_madd_add(acc[0], _mm_unpacklo_epi8(lo, zero), wv);
+			acc[1] = sse41_madd_add(acc[1], _mm_unpackhi_epi8(lo, zero), wv);
+			acc[2] = sse41_madd_add(acc[2], _mm_unpacklo_epi8(hi, zero), wv);
+			acc[3] = sse41_madd_add(acc[3], _mm_unpackhi_epi8(hi, zero), wv);
+		}
+
+		const __m128i a = _mm_packs_epi32(sse41_round(acc[0]), sse41_round(acc[1]));
+		const __m128i b = _mm_packs_epi32(sse41_round(acc[2]), sse41_round(acc[3]));
+		STORE_SI128(&pDst[x], _mm_packus_epi16(a, b));
+	}
+
+	scale_vertical_bytes(pSrc, weights, taps, pDst, len16, len);
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_sse41_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	WLog_VRB(PRIM_TAG, "SSE4.1 optimizations");
+	prims->scaleHorizontal_8u_C4 = sse41_scaleHorizontal_8u_C4;
+	prims->scaleVertical_8u_C4 = sse41_scaleVertical_8u_C4;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or SSE4.1 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,112 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Shift operations, AVX2 optimized
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_shift.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* 16 bit values per AVX2 register */
+#define AVX2_16_COUNT (sizeof(__m256i) / sizeof(UINT16))
+
+/* SCD = Source, Constant, Destination */
+#define AVX2_SCD_ROUTINE(_name_, _type_, _fallback_, _op_)                                   \
+	static pstatus_t _name_(const _type_* WINPR_RESTRICT pSrc, UINT32 val,                   \
+	                        _type_* WINPR_RESTRICT pDst, UINT32 len)                         \
+	{                                                                                        \
+		UINT32 x = 0;                                                                        \
+		if (val == 0)                                                                        \
+			return PRIMITIVES_SUCCESS;                                                       \
+		if (val >= 16)                                                                       \
+			return -1;                                                                       \
+		for (; x + 2 * AVX2_16_COUNT <= len; x += 2 * AVX2_16_COUNT)                         \
+		{                                                                                    \
+			const __m256i a0 = _mm256_loadu_si256((const __m256i*)&pSrc[x]);                 \
+			const __m256i a1 = _mm256_loadu_si256((const __m256i*)&pSrc[x + AVX2_16_COUNT]); \
+			_mm256_storeu_si256((__m256i*)&pDst[x], _op_(a0, (int)val));                     \
+			_mm256_storeu_si256((__m256i*)&pDst[x + AVX2_16_COUNT], _op_(a1, (int)val));     \
+		}                                                                                    \
+		for (; x + AVX2_16_COUNT <= len; x += AVX2_16_COUNT)                                 \
+		{                                                                                    \
+			const __m256i a = _mm256_loadu_si256((const __m256i*)&pSrc[x]);                  \
+			_mm256_storeu_si256((__m256i*)&pDst[x], _op_(a, (int)val));                      \
+		}                                                                                    \
+		/* Finish off the remainder. */                                                      \
+		if (x < len)                                                                         \
+			return _fallback_(&pSrc[x], val, &pDst[x], len - x);                             \
+		return PRIMITIVES_SUCCESS;                                                           \
+	}
+
+/* ------------------------------------------------------------------------- */
+AVX2_SCD_ROUTINE(avx2_lShiftC_16s, INT16, generic->lShiftC_16s, _mm256_slli_epi16)
+/* ------------------------------------------------------------------------- */
+AVX2_SCD_ROUTINE(avx2_rShiftC_16s, INT16, generic->rShiftC_16s, _mm256_srai_epi16)
+/* ------------------------------------------------------------------------- */
+AVX2_SCD_ROUTINE(avx2_lShiftC_16u, UINT16, generic->lShiftC_16u, _mm256_slli_epi16)
+/* ------------------------------------------------------------------------- */
+AVX2_SCD_ROUTINE(avx2_rShiftC_16u, UINT16, generic->rShiftC_16u, _mm256_srli_epi16)
+
+static pstatus_t avx2_lShiftC_16s_inplace(INT16* WINPR_RESTRICT pSrcDst, UINT32 val, UINT32 len)
+{
+	UINT32 x = 0;
+
+	if (val == 0)
+		return PRIMITIVES_SUCCESS;
+	if (val >= 16)
+		return -1;
+
+	for (; x + AVX2_16_COUNT <= len; x += AVX2_16_COUNT)
+	{
+		const __m256i a = _mm256_loadu_si256((const __m256i*)&pSrcDst[x]);
+		_mm256_storeu_si256((__m256i*)&pSrcDst[x], _mm256_slli_epi16(a, (int)val));
+	}
+
+	/* Finish off the remainder. */
+	if (x < len)
+		return generic->lShiftC_16s_inplace(&pSrcDst[x], val, len - x);
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_shift_avx2_int(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE_AVX_INTRINSICS_ENABLED)
+	generic = primitives_get_generic();
+
+	WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+	prims->lShiftC_16s_inplace = avx2_lShiftC_16s_inplace;
+	prims->lShiftC_16s = avx2_lShiftC_16s;
+	prims->rShiftC_16s = avx2_rShiftC_16s;
+	prims->lShiftC_16u = avx2_lShiftC_16u;
+	prims->rShiftC_16u = avx2_rShiftC_16u;
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SIMD or WITH_AVX2 or AVX2 intrinsics not available");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,185 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+
+#include "prim_test.h"
+
+#define TEST_WIDTH 203
+#define TEST_HEIGHT 77
+#define TEST_STEP (TEST_WIDTH * 4 + 12)
+#define TILES_X ((TEST_WIDTH + 15) / 16)
+#define TILES_Y ((TEST_HEIGHT + 15) / 16)
+
+/* ========================================================================= */
+static BOOL check_tiles(const char* name, fn_compare_tiles_32u_t fkt, const BYTE* src1,
+                        const BYTE* src2, UINT32 width, UINT32 height, UINT32 mask,
+                        const BYTE* expected)
+{
+	BYTE dirty[TILES_Y * TILES_X] = { 0 };
+
+	/* Stale content must be overwritten */
+	memset(dirty, 0xAA, sizeof(dirty));
+
+	const pstatus_t status =
+	    fkt(src1, TEST_STEP, src2, TEST_STEP, width, height, mask, dirty, TILES_X);
+	if (status != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	for (UINT32 ty = 0; ty < (height + 15) / 16; ty++)
+	{
+		for (UINT32 tx = 0; tx < (width + 15) / 16; tx++)
+		{
+			const BYTE got = dirty[ty * TILES_X + tx];
+			const BYTE exp = expected[ty * TILES_X + tx];
+
+			if (got != exp)
+			{
+				printf("compare_tiles_32u %s FAIL [%" PRIu32 "x%" PRIu32 "] tile %" PRIu32
+				       ",%" PRIu32 " mask 0x%08" PRIx32 ": expected %" PRIu8 ", got %" PRIu8 "\n",
+				       name, width, height, tx, ty, mask, exp, got);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static void set_pixel(BYTE* data, UINT32 x, UINT32 y, UINT32 xorValue, BYTE* expected,
+                      UINT32 mask)
+{
+	UINT32 val = 0;
+	BYTE* pixel = &data[y * TEST_STEP + x * 4];
+
+	memcpy(&val, pixel, sizeof(val));
+	val ^= xorValue;
+	memcpy(pixel, &val, sizeof(val));
+
+	if (xorValue & mask)
+		expected[(y / 16) * TILES_X + (x / 16)] = 1;
+}
+
+static BOOL test_compare_tiles_32u_func(UINT32 mask, UINT32 xorValue)
+{
+	BOOL rc = FALSE;
+	BYTE expected[TILES_Y * TILES_X] = { 0 };
+	BYTE* src1 = calloc(TEST_HEIGHT, TEST_STEP);
+	BYTE* src2 = calloc(TEST_HEIGHT, TEST_STEP);
+
+	if (!src1 || !src2)
+		goto fail;
+
+	winpr_RAND(src1, 1ull * TEST_HEIGHT * TEST_STEP);
+	memcpy(src2, src1, 1ull * TEST_HEIGHT * TEST_STEP);
+
+	/* Padding beyond the width must not be compared */
+	for (UINT32 y = 0; y < TEST_HEIGHT; y++)
+		src2[y * TEST_STEP + TEST_WIDTH * 4] ^= 0xFF;
+
+	if (!check_tiles("generic equal", generic->compare_tiles_32u, src1, src2, TEST_WIDTH,
+	                 TEST_HEIGHT, mask, expected))
+		goto fail;
+	if (!check_tiles("optimized equal", optimized->compare_tiles_32u, src1, src2, TEST_WIDTH,
+	                 TEST_HEIGHT, mask, expected))
+		goto fail;
+
+	/* First and last pixel of a tile, partial tiles at the right and bottom border */
+	set_pixel(src2, 16, 0, xorValue, expected, mask);
+	set_pixel(src2, 63, 15, xorValue, expected, mask);
+	set_pixel(src2, 100, 40, xorValue, expected, mask);
+	set_pixel(src2, TEST_WIDTH - 1, 20, xorValue, expected, mask);
+	set_pixel(src2, 5, TEST_HEIGHT - 1, xorValue, expected, mask);
+	set_pixel(src2, TEST_WIDTH - 1, TEST_HEIGHT - 1, xorValue, expected, mask);
+
+	if (!check_tiles("generic", generic->compare_tiles_32u, src1, src2, TEST_WIDTH, TEST_HEIGHT,
+	                 mask, expected))
+		goto fail;
+	if (!check_tiles("optimized", optimized->compare_tiles_32u, src1, src2, TEST_WIDTH,
+	                 TEST_HEIGHT, mask, expected))
+		goto fail;
+
+	/* A width that is a multiple of the tile size only uses full tiles */
+	if (!check_tiles("optimized full tiles", optimized->compare_tiles_32u, src1, src2, 192, 64,
+	                 mask, expected))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src1);
+	free(src2);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_compare_tiles_32u_speed(void)
+{
+	BOOL rc = FALSE;
+	const UINT32 width = 1920;
+	const UINT32 height = 1080;
+	const UINT32 step = width * 4;
+	const UINT32 tilesX = (width + 15) / 16;
+	BYTE* src1 = calloc(height, step);
+	BYTE* src2 = calloc(height, step);
+	BYTE* dirty = calloc((height + 15) / 16, tilesX);
+
+	if (!src1 || !src2 || !dirty)
+		goto fail;
+
+	winpr_RAND(src1, 1ull * height * step);
+	memcpy(src2, src1, 1ull * height * step);
+
+	if (!speed_test("compare_tiles_32u", "equal", g_Iterations,
+	                (speed_test_fkt)generic->compare_tiles_32u,
+	                (speed_test_fkt)optimized->compare_tiles_32u, src1, step, src2, step, width,
+	                height, UINT32_MAX, dirty, tilesX))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src1);
+	free(src2);
+	free(dirty);
+	return rc;
+}
+
+int TestPrimitivesCompare(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_compare_tiles_32u_func(UINT32_MAX, 0x00010000))
+		return -1;
+
+	/* Differences in masked bits are ignored */
+	if (!test_compare_tiles_32u_func(0x00FFFFFF, 0xFF000000))
+		return -1;
+
+	if (!test_compare_tiles_32u_func(0x00FFFFFF, 0x80000001))
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_compare_tiles_32u_speed())
+			return -1;
+	}
+
+	return 0;
+}
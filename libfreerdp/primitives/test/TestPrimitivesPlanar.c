@@ -0,0 +1,392 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+#include <freerdp/codec/color.h>
+
+#include "prim_test.h"
+
+#define TEST_HEIGHT 5
+#define TEST_MAX_WIDTH 131
+#define FUNC_TEST_SIZE_RUN 1027
+
+/* Not multiples of any vector width to cover the tail handling */
+static const UINT32 test_widths[] = { 1, 15, 16, 17, 31, 32, 33, 64, 67, TEST_MAX_WIDTH };
+
+static const UINT32 test_formats[] = { PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32,
+	                                   PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_XBGR32,
+	                                   PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
+	                                   PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32,
+	                                   PIXEL_FORMAT_RGB24,  PIXEL_FORMAT_RGB16 };
+
+/* ========================================================================= */
+static BOOL test_split_impl(const char* name, fn_planarSplit_8u_AC4P4_t fkt, const BYTE* image,
+                            UINT32 stride, UINT32 format, UINT32 width, BOOL bottomUp)
+{
+	BYTE planes[4][TEST_MAX_WIDTH * TEST_HEIGHT] = { 0 };
+	BYTE* dst[4] = { planes[0], planes[1], planes[2], planes[3] };
+	const BYTE* src = bottomUp ? &image[1ULL * (TEST_HEIGHT - 1) * stride] : image;
+	const INT32 step = bottomUp ? -(INT32)stride : (INT32)stride;
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(format);
+
+	if (fkt(src, step, format, dst, width, TEST_HEIGHT) != PRIMITIVES_SUCCESS)
+	{
+		printf("%s failed for %s\n", name, FreeRDPGetColorFormatName(format));
+		return FALSE;
+	}
+
+	for (UINT32 y = 0; y < TEST_HEIGHT; y++)
+	{
+		const UINT32 line = bottomUp ? TEST_HEIGHT - 1 - y : y;
+
+		for (UINT32 x = 0; x < width; x++)
+		{
+			BYTE expected[4] = { 0 };
+			const size_t off = 1ULL * y * width + x;
+			const BYTE* pixel = &image[1ULL * line * stride + 1ULL * x * bpp];
+			const UINT32 color = FreeRDPReadColor(pixel, format);
+			FreeRDPSplitColor(color, format, &expected[0], &expected[1], &expected[2], &expected[3],
+			                  NULL);
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				if (planes[c][off] != expected[c])
+				{
+					printf("%s %s width %" PRIu32 " [%" PRIu32 "x%" PRIu32 "] plane %" PRIuz
+					       " expected 0x%02" PRIx8 ", got 0x%02" PRIx8 "\n",
+					       name, FreeRDPGetColorFormatName(format), width, x, y, c, expected[c],
+					       planes[c][off]);
+					return FALSE;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_split_func(void)
+{
+	BYTE ALIGN(image[(TEST_MAX_WIDTH * 4 + 5) * TEST_HEIGHT]) = { 0 };
+
+	winpr_RAND(image, sizeof(image));
+
+	for (size_t f = 0; f < ARRAYSIZE(test_formats); f++)
+	{
+		const UINT32 format = test_formats[f];
+
+		for (size_t w = 0; w < ARRAYSIZE(test_widths); w++)
+		{
+			const UINT32 width = test_widths[w];
+			const UINT32 stride = width * FreeRDPGetBytesPerPixel(format) + 5;
+
+			for (size_t b = 0; b < 2; b++)
+			{
+				if (!test_split_impl("generic->planarSplit_8u_AC4P4",
+				                     generic->planarSplit_8u_AC4P4, image, stride, format, width,
+				                     b != 0))
+					return FALSE;
+				if (!test_split_impl("optimized->planarSplit_8u_AC4P4",
+				                     optimized->planarSplit_8u_AC4P4, image, stride, format, width,
+				                     b != 0))
+					return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_merge_func(void)
+{
+	BYTE ALIGN(planes[4][TEST_MAX_WIDTH * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(image1[(TEST_MAX_WIDTH * 4 + 5) * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(image2[(TEST_MAX_WIDTH * 4 + 5) * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(split[4][TEST_MAX_WIDTH * TEST_HEIGHT]) = { 0 };
+
+	winpr_RAND(planes, sizeof(planes));
+
+	for (size_t f = 0; f < ARRAYSIZE(test_formats); f++)
+	{
+		const UINT32 format = test_formats[f];
+
+		for (size_t w = 0; w < ARRAYSIZE(test_widths); w++)
+		{
+			const UINT32 width = test_widths[w];
+			const UINT32 stride = width * FreeRDPGetBytesPerPixel(format) + 5;
+
+			for (size_t v = 0; v < 4; v++)
+			{
+				const BOOL bottomUp = (v & 1) != 0;
+				const BOOL withAlpha = (v & 2) != 0;
+				const BYTE* src[4] = { planes[0], planes[1], planes[2],
+					                   withAlpha ? planes[3] : NULL };
+				const size_t last = 1ULL * (TEST_HEIGHT - 1) * stride;
+				const INT32 step = bottomUp ? -(INT32)stride : (INT32)stride;
+
+				memset(image1, 0xA5, sizeof(image1));
+				memset(image2, 0xA5, sizeof(image2));
+
+				if (generic->planarMerge_8u_P4AC4(src, bottomUp ? &image1[last] : image1, step,
+				                                  format, width,
+				                                  TEST_HEIGHT) != PRIMITIVES_SUCCESS)
+					return FALSE;
+				if (optimized->planarMerge_8u_P4AC4(src, bottomUp ? &image2[last] : image2, step,
+				                                    format, width,
+				                                    TEST_HEIGHT) != PRIMITIVES_SUCCESS)
+					return FALSE;
+
+				if (memcmp(image1, image2, sizeof(image1)) != 0)
+				{
+					printf("planarMerge_8u_P4AC4 %s width %" PRIu32 " variant %" PRIuz
+					       " generic and optimized differ\n",
+					       FreeRDPGetColorFormatName(format), width, v);
+					return FALSE;
+				}
+
+				/* Splitting the merged image must give the planes back */
+				BYTE* dst[4] = { split[0], split[1], split[2], split[3] };
+				if (optimized->planarSplit_8u_AC4P4(bottomUp ? &image1[last] : image1, step,
+				                                    format, dst, width,
+				                                    TEST_HEIGHT) != PRIMITIVES_SUCCESS)
+					return FALSE;
+
+				if ((FreeRDPGetBytesPerPixel(format) == 4) &&
+				    ((memcmp(split[0], planes[0], 1ULL * width * TEST_HEIGHT) != 0) ||
+				     (memcmp(split[1], planes[1], 1ULL * width * TEST_HEIGHT) != 0) ||
+				     (memcmp(split[2], planes[2], 1ULL * width * TEST_HEIGHT) != 0)))
+				{
+					printf("planarMerge_8u_P4AC4 %s width %" PRIu32 " variant %" PRIuz
+					       " round trip failed\n",
+					       FreeRDPGetColorFormatName(format), width, v);
+					return FALSE;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_delta_func(void)
+{
+	BYTE ALIGN(plane[TEST_MAX_WIDTH * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(delta1[TEST_MAX_WIDTH * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(delta2[TEST_MAX_WIDTH * TEST_HEIGHT]) = { 0 };
+	const struct
+	{
+		BYTE prev;
+		BYTE cur;
+		BYTE encoded;
+	} mapping[] = { { 10, 10, 0 },  { 10, 9, 1 },    { 10, 11, 2 },  { 10, 8, 3 },
+		            { 0, 127, 254 }, { 128, 0, 255 }, { 255, 0, 2 } };
+
+	/* Spot check the mapping of [MS-RDPEGDI] 3.1.9.2.3 */
+	for (size_t x = 0; x < ARRAYSIZE(mapping); x++)
+	{
+		const BYTE src[2] = { mapping[x].prev, mapping[x].cur };
+		BYTE dst[2] = { 0 };
+
+		if (optimized->planarDeltaEncode_8u(src, dst, 1, 2) != PRIMITIVES_SUCCESS)
+			return FALSE;
+
+		if ((dst[0] != mapping[x].prev) || (dst[1] != mapping[x].encoded))
+		{
+			printf("planarDeltaEncode_8u %" PRIu8 " -> %" PRIu8 " expected %" PRIu8
+			       ", got %" PRIu8 "\n",
+			       mapping[x].prev, mapping[x].cur, mapping[x].encoded, dst[1]);
+			return FALSE;
+		}
+	}
+
+	winpr_RAND(plane, sizeof(plane));
+
+	for (size_t w = 0; w < ARRAYSIZE(test_widths); w++)
+	{
+		const UINT32 width = test_widths[w];
+		const size_t size = 1ULL * width * TEST_HEIGHT;
+
+		if (generic->planarDeltaEncode_8u(plane, delta1, width, TEST_HEIGHT) !=
+		    PRIMITIVES_SUCCESS)
+			return FALSE;
+		if (optimized->planarDeltaEncode_8u(plane, delta2, width, TEST_HEIGHT) !=
+		    PRIMITIVES_SUCCESS)
+			return FALSE;
+
+		if (memcmp(delta1, delta2, size) != 0)
+		{
+			printf("planarDeltaEncode_8u width %" PRIu32 " generic and optimized differ\n",
+			       width);
+			return FALSE;
+		}
+
+		if (generic->planarDeltaDecode_8u(delta1, width, TEST_HEIGHT) != PRIMITIVES_SUCCESS)
+			return FALSE;
+		if (optimized->planarDeltaDecode_8u(delta2, width, TEST_HEIGHT) != PRIMITIVES_SUCCESS)
+			return FALSE;
+
+		if ((memcmp(delta1, plane, size) != 0) || (memcmp(delta2, plane, size) != 0))
+		{
+			printf("planarDeltaDecode_8u width %" PRIu32 " round trip failed\n", width);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_find_run_impl(const char* name, fn_planarFindRun_8u_t fkt, const BYTE* src,
+                               UINT32 len, BYTE prev, UINT32 minRun)
+{
+	UINT32 expStart = len;
+	UINT32 expLength = 0;
+	UINT32 start = 0;
+	UINT32 length = 0;
+
+	for (UINT32 x = 0; x < len; x++)
+	{
+		const BYTE val = (x > 0) ? src[x - 1] : prev;
+		UINT32 run = 0;
+
+		while ((x + run < len) && (src[x + run] == val))
+			run++;
+
+		if (run >= minRun)
+		{
+			expStart = x;
+			expLength = run;
+			break;
+		}
+	}
+
+	if (fkt(src, len, prev, minRun, &start, &length) != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	if ((start != expStart) || (length != expLength))
+	{
+		printf("%s len %" PRIu32 " minRun %" PRIu32 " expected %" PRIu32 "/%" PRIu32
+		       ", got %" PRIu32 "/%" PRIu32 "\n",
+		       name, len, minRun, expStart, expLength, start, length);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_find_run_func(void)
+{
+	BYTE ALIGN(src[FUNC_TEST_SIZE_RUN]) = { 0 };
+
+	for (size_t i = 0; i < 64; i++)
+	{
+		UINT32 rnd[4] = { 0 };
+
+		/* Few distinct values, so that short and long runs both show up */
+		winpr_RAND(src, sizeof(src));
+		for (size_t x = 0; x < sizeof(src); x++)
+			src[x] &= (i & 1) ? 0x01 : 0x0F;
+
+		winpr_RAND(rnd, sizeof(rnd));
+		const UINT32 pos = rnd[0] % sizeof(src);
+		const UINT32 len = MIN(rnd[1] % 80, sizeof(src) - pos);
+		memset(&src[pos], (BYTE)rnd[2], len);
+
+		for (UINT32 minRun = 1; minRun < 6; minRun++)
+		{
+			const UINT32 slen = (UINT32)(sizeof(src) - (i % 7));
+			const BYTE prev = (BYTE)(rnd[3] & 0x01);
+
+			if (!test_find_run_impl("generic->planarFindRun_8u", generic->planarFindRun_8u, src,
+			                        slen, prev, minRun))
+				return FALSE;
+			if (!test_find_run_impl("optimized->planarFindRun_8u", optimized->planarFindRun_8u,
+			                        src, slen, prev, minRun))
+				return FALSE;
+			if (!test_find_run_impl("optimized->planarFindRun_8u", optimized->planarFindRun_8u,
+			                        &src[pos], slen - pos, prev, 40))
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_planar_speed(void)
+{
+	BYTE ALIGN(image[MAX_TEST_SIZE * 4]) = { 0 };
+	BYTE ALIGN(planes[4][MAX_TEST_SIZE]) = { 0 };
+	BYTE ALIGN(delta[MAX_TEST_SIZE]) = { 0 };
+	BYTE* dst[4] = { planes[0], planes[1], planes[2], planes[3] };
+	const BYTE* src[4] = { planes[0], planes[1], planes[2], planes[3] };
+	const UINT32 width = 64;
+	const UINT32 height = MAX_TEST_SIZE / 64;
+
+	winpr_RAND(image, sizeof(image));
+
+	if (!speed_test("planarSplit_8u_AC4P4", "BGRX32", g_Iterations,
+	                (speed_test_fkt)generic->planarSplit_8u_AC4P4,
+	                (speed_test_fkt)optimized->planarSplit_8u_AC4P4, image, width * 4,
+	                PIXEL_FORMAT_BGRX32, dst, width, height))
+		return FALSE;
+
+	if (!speed_test("planarMerge_8u_P4AC4", "BGRA32", g_Iterations,
+	                (speed_test_fkt)generic->planarMerge_8u_P4AC4,
+	                (speed_test_fkt)optimized->planarMerge_8u_P4AC4, src, image, width * 4,
+	                PIXEL_FORMAT_BGRA32, width, height))
+		return FALSE;
+
+	if (!speed_test("planarDeltaEncode_8u", "plane", g_Iterations,
+	                (speed_test_fkt)generic->planarDeltaEncode_8u,
+	                (speed_test_fkt)optimized->planarDeltaEncode_8u, planes[0], delta, width,
+	                height))
+		return FALSE;
+
+	return TRUE;
+}
+
+int TestPrimitivesPlanar(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_split_func())
+		return -1;
+
+	if (!test_merge_func())
+		return -1;
+
+	if (!test_delta_func())
+		return -1;
+
+	if (!test_find_run_func())
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_planar_speed())
+			return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+
+#include "prim_test.h"
+
+/* Not a multiple of any vector width to cover the tail handling */
+#define FUNC_TEST_SIZE 4099
+
+/* Evaluate the truth table bit by bit */
+static BYTE rop3_reference(BYTE rop3, BYTE s, BYTE p, BYTE d)
+{
+	BYTE r = 0;
+
+	for (size_t bit = 0; bit < 8; bit++)
+	{
+		const unsigned sb = (s >> bit) & 1;
+		const unsigned pb = (p >> bit) & 1;
+		const unsigned db = (d >> bit) & 1;
+		const unsigned idx = (pb << 2) | (sb << 1) | db;
+
+		if ((rop3 >> idx) & 1)
+			r |= (BYTE)(1u << bit);
+	}
+
+	return r;
+}
+
+/* ========================================================================= */
+static BOOL test_rop3_impl(const char* name, fn_rop3_8u_t fkt, const BYTE* src, const BYTE* pat,
+                           const BYTE* dstOrig, BYTE* dst, UINT32 len)
+{
+	for (size_t rop3 = 0; rop3 < 256; rop3++)
+	{
+		memcpy(dst, dstOrig, len + 1);
+
+		const pstatus_t status = fkt(src, pat, dst, len, (BYTE)rop3);
+		if (status != PRIMITIVES_SUCCESS)
+		{
+			printf("ROP3 %s [0x%02" PRIx32 "] failed with %" PRId32 "\n", name, (UINT32)rop3,
+			       status);
+			return FALSE;
+		}
+
+		for (size_t x = 0; x < len; x++)
+		{
+			const BYTE expected = rop3_reference((BYTE)rop3, src[x], pat[x], dstOrig[x]);
+			if (dst[x] != expected)
+			{
+				printf("ROP3 %s [0x%02" PRIx32 "] FAIL[%" PRIuz "] S=0x%02" PRIx8
+				       " P=0x%02" PRIx8 " D=0x%02" PRIx8 " expected 0x%02" PRIx8
+				       ", got 0x%02" PRIx8 "\n",
+				       name, (UINT32)rop3, x, src[x], pat[x], dstOrig[x], expected, dst[x]);
+				return FALSE;
+			}
+		}
+
+		if (dst[len] != dstOrig[len])
+		{
+			printf("ROP3 %s [0x%02" PRIx32 "] wrote past the end\n", name, (UINT32)rop3);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_rop3_func(void)
+{
+	BYTE ALIGN(src[FUNC_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(pat[FUNC_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(dstOrig[FUNC_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(dst[FUNC_TEST_SIZE + 3]) = { 0 };
+	const UINT32 lengths[] = { 1, 7, 15, 31, 33, 65, FUNC_TEST_SIZE };
+
+	winpr_RAND(src, sizeof(src));
+	winpr_RAND(pat, sizeof(pat));
+	winpr_RAND(dstOrig, sizeof(dstOrig));
+
+	for (size_t x = 0; x < ARRAYSIZE(lengths); x++)
+	{
+		const UINT32 len = lengths[x];
+
+		if (!test_rop3_impl("generic->rop3_8u aligned", generic->rop3_8u, src, pat, dstOrig, dst,
+		                    len))
+			return FALSE;
+		if (!test_rop3_impl("generic->rop3_8u unaligned", generic->rop3_8u, src + 1, pat + 2,
+		                    dstOrig + 1, dst + 1, len))
+			return FALSE;
+		if (!test_rop3_impl("optimized->rop3_8u aligned", optimized->rop3_8u, src, pat, dstOrig,
+		                    dst, len))
+			return FALSE;
+		if (!test_rop3_impl("optimized->rop3_8u unaligned", optimized->rop3_8u, src + 1, pat + 2,
+		                    dstOrig + 1, dst + 1, len))
+			return FALSE;
+	}
+
+	/* Operands not part of the operation may be NULL */
+	if (optimized->rop3_8u(NULL, NULL, dst, FUNC_TEST_SIZE, 0x55) != PRIMITIVES_SUCCESS)
+		return FALSE;
+	if (optimized->rop3_8u(src, NULL, dst, FUNC_TEST_SIZE, 0xCC) != PRIMITIVES_SUCCESS)
+		return FALSE;
+	if (optimized->rop3_8u(NULL, pat, dst, FUNC_TEST_SIZE, 0xF0) != PRIMITIVES_SUCCESS)
+		return FALSE;
+	if (optimized->rop3_8u(NULL, pat, dst, FUNC_TEST_SIZE, 0xCC) == PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_rop3_speed(void)
+{
+	/* One representative per class: D only, S/D, P/D, P/S/D and a code without SIMD kernel */
+	const struct
+	{
+		const char* name;
+		BYTE rop3;
+	} rops[] = { { "DSTINVERT", 0x55 }, { "SRCCOPY", 0xCC },  { "SRCAND", 0x88 },
+		         { "SRCINVERT", 0x66 }, { "PATINVERT", 0x5A }, { "PSDPxax", 0xB8 },
+		         { "DPSDonox", 0xAD } };
+	BYTE ALIGN(src[MAX_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(pat[MAX_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(dst[MAX_TEST_SIZE + 3]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+	winpr_RAND(pat, sizeof(pat));
+	winpr_RAND(dst, sizeof(dst));
+
+	for (size_t x = 0; x < ARRAYSIZE(rops); x++)
+	{
+		if (!speed_test("rop3_8u", rops[x].name, g_Iterations, (speed_test_fkt)generic->rop3_8u,
+		                (speed_test_fkt)optimized->rop3_8u, src + 1, pat + 1, dst + 1,
+		                MAX_TEST_SIZE, rops[x].rop3))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+int TestPrimitivesRop(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_rop3_func())
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_rop3_speed())
+			return -1;
+	}
+
+	return 0;
+}
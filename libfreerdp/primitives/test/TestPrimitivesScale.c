@@ -0,0 +1,227 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+
+#include "prim_test.h"
+
+#define TEST_HEIGHT 3
+#define TEST_MAX_TAPS 7
+#define TEST_MAX_WIDTH 131
+#define TEST_SRC_WIDTH (TEST_MAX_WIDTH + TEST_MAX_TAPS)
+
+/* Not multiples of any vector width to cover the tail handling */
+static const UINT32 test_widths[] = { 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 64, 67, TEST_MAX_WIDTH };
+
+/* Random tables with weights adding up to 1 << 14, the last tap takes the remainder */
+static void test_fill_tables(UINT32* offsets, INT16* weights, UINT32 width, UINT32 taps)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		INT16* w = &weights[1ULL * x * taps];
+		INT32 sum = 0;
+		UINT32 rnd = 0;
+
+		winpr_RAND(&rnd, sizeof(rnd));
+		offsets[x] = rnd % (TEST_SRC_WIDTH - taps + 1);
+
+		for (UINT32 k = 0; k + 1 < taps; k++)
+		{
+			winpr_RAND(&rnd, sizeof(rnd));
+			w[k] = (INT16)(rnd % ((1 << 14) - sum + 1));
+			sum += w[k];
+		}
+
+		w[taps - 1] = (INT16)((1 << 14) - sum);
+	}
+}
+
+/* ========================================================================= */
+static BOOL test_horizontal_func(void)
+{
+	BYTE ALIGN(src[TEST_SRC_WIDTH * 4 * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(dst1[TEST_MAX_WIDTH * 4 * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(dst2[TEST_MAX_WIDTH * 4 * TEST_HEIGHT]) = { 0 };
+	UINT32 offsets[TEST_MAX_WIDTH] = { 0 };
+	INT16 weights[TEST_MAX_WIDTH * TEST_MAX_TAPS] = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	for (UINT32 taps = 1; taps <= TEST_MAX_TAPS; taps++)
+	{
+		for (size_t i = 0; i < ARRAYSIZE(test_widths); i++)
+		{
+			const UINT32 width = test_widths[i];
+			test_fill_tables(offsets, weights, width, taps);
+
+			if (generic->scaleHorizontal_8u_C4(src, TEST_SRC_WIDTH * 4, dst1, width * 4, width,
+			                                   TEST_HEIGHT, offsets, weights,
+			                                   taps) != PRIMITIVES_SUCCESS)
+				return FALSE;
+
+			if (optimized->scaleHorizontal_8u_C4(src, TEST_SRC_WIDTH * 4, dst2, width * 4, width,
+			                                     TEST_HEIGHT, offsets, weights,
+			                                     taps) != PRIMITIVES_SUCCESS)
+				return FALSE;
+
+			/* spot check the generic implementation */
+			for (size_t c = 0; c < 4; c++)
+			{
+				const UINT32 x = width - 1;
+				const BYTE* s = &src[4ULL * (TEST_SRC_WIDTH * (TEST_HEIGHT - 1) + offsets[x]) + c];
+				INT32 sum = 0;
+
+				for (UINT32 k = 0; k < taps; k++)
+					sum += s[4ULL * k] * weights[1ULL * x * taps + k];
+
+				if (dst1[4ULL * (width * (TEST_HEIGHT - 1) + x) + c] != (sum + 8192) >> 14)
+				{
+					printf("scaleHorizontal_8u_C4 width %" PRIu32 " taps %" PRIu32
+					       " wrong result\n",
+					       width, taps);
+					return FALSE;
+				}
+			}
+
+			if (memcmp(dst1, dst2, 4ULL * width * TEST_HEIGHT) != 0)
+			{
+				printf("scaleHorizontal_8u_C4 width %" PRIu32 " taps %" PRIu32
+				       " generic and optimized differ\n",
+				       width, taps);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* ========================================================================= */
+static BOOL test_vertical_func(void)
+{
+	BYTE ALIGN(src[TEST_MAX_TAPS][TEST_MAX_WIDTH * 4]) = { 0 };
+	BYTE ALIGN(dst1[TEST_MAX_WIDTH * 4]) = { 0 };
+	BYTE ALIGN(dst2[TEST_MAX_WIDTH * 4]) = { 0 };
+	const BYTE* rows[TEST_MAX_TAPS] = { 0 };
+	UINT32 offset = 0;
+	INT16 weights[TEST_MAX_TAPS] = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	for (UINT32 taps = 1; taps <= TEST_MAX_TAPS; taps++)
+	{
+		/* rows in reverse order, the implementation must not assume adjacent lines */
+		for (UINT32 k = 0; k < taps; k++)
+			rows[k] = src[TEST_MAX_TAPS - 1 - k];
+
+		for (size_t i = 0; i < ARRAYSIZE(test_widths); i++)
+		{
+			const UINT32 width = test_widths[i];
+			test_fill_tables(&offset, weights, 1, taps);
+
+			if (generic->scaleVertical_8u_C4(rows, weights, taps, dst1, width) !=
+			    PRIMITIVES_SUCCESS)
+				return FALSE;
+
+			if (optimized->scaleVertical_8u_C4(rows, weights, taps, dst2, width) !=
+			    PRIMITIVES_SUCCESS)
+				return FALSE;
+
+			if (memcmp(dst1, dst2, 4ULL * width) != 0)
+			{
+				printf("scaleVertical_8u_C4 width %" PRIu32 " taps %" PRIu32
+				       " generic and optimized differ\n",
+				       width, taps);
+				return FALSE;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_scale_speed(void)
+{
+	const UINT32 width = 1920;
+	const UINT32 height = 64;
+	BOOL rc = FALSE;
+	BYTE* src = calloc(2ULL * width * 4, height);
+	BYTE* dst = calloc(1ULL * width * 4, height);
+	UINT32* offsets = calloc(width, sizeof(UINT32));
+	INT16* weights = calloc(2ULL * width, sizeof(INT16));
+	const BYTE* rows[2] = { 0 };
+
+	if (!src || !dst || !offsets || !weights)
+		goto fail;
+
+	winpr_RAND(src, 2ULL * width * 4 * height);
+
+	/* 2:1 box filter */
+	for (UINT32 x = 0; x < width; x++)
+	{
+		offsets[x] = 2 * x;
+		weights[2ULL * x] = 1 << 13;
+		weights[2ULL * x + 1] = 1 << 13;
+	}
+
+	rows[0] = src;
+	rows[1] = &src[2ULL * width * 4];
+
+	if (!speed_test("scaleHorizontal_8u_C4", "2 taps", g_Iterations,
+	                (speed_test_fkt)generic->scaleHorizontal_8u_C4,
+	                (speed_test_fkt)optimized->scaleHorizontal_8u_C4, src, 2 * width * 4, dst,
+	                width * 4, width, height, offsets, weights, 2))
+		goto fail;
+
+	if (!speed_test("scaleVertical_8u_C4", "2 taps", g_Iterations,
+	                (speed_test_fkt)generic->scaleVertical_8u_C4,
+	                (speed_test_fkt)optimized->scaleVertical_8u_C4, rows, weights, 2, dst,
+	                2 * width))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	free(offsets);
+	free(weights);
+	return rc;
+}
+
+int TestPrimitivesScale(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_horizontal_func())
+		return -1;
+
+	if (!test_vertical_func())
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_scale_speed())
+			return -1;
+	}
+
+	return 0;
+}
@@ -19,9 +19,15 @@
  * limitations under the License.
  */
 
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+
+#include <freerdp/log.h>
 #include <freerdp/utils/drdynvc.h>
 #include <freerdp/channels/drdynvc.h>
 
+#define TAG FREERDP_TAG("utils.drdynvc")
+
 const char* drdynvc_get_packet_type(BYTE cmd)
 {
 	switch (cmd)
@@ -48,3 +54,75 @@ const char* drdynvc_get_packet_type(BYTE cmd)
 			return "UNKNOWN";
 	}
 }
+
+BOOL drdynvc_compress_data(ZGFX_CONTEXT* zgfx, wStream* s, const BYTE* data, size_t length)
+{
+	UINT32 flags = 0;
+
+	WINPR_ASSERT(zgfx);
+	WINPR_ASSERT(s);
+	WINPR_ASSERT(data || (length == 0));
+
+	if (length > DRDYNVC_MAX_UNCOMPRESSED_CHUNK_SIZE)
+	{
+		WLog_ERR(TAG, "chunk of %" PRIuz " bytes exceeds the compressed PDU limit", length);
+		return FALSE;
+	}
+
+	const size_t pos = Stream_GetPosition(s);
+	if (zgfx_compress_to_stream(zgfx, s, data, (UINT32)length, &flags) < 0)
+		return FALSE;
+
+	/* A chunk always fits a single segment, the PDU carries it without the descriptor */
+	const size_t end = Stream_GetPosition(s);
+	BYTE* segment = Stream_BufferAs(s, BYTE) + pos;
+	if ((end <= pos + 1) || (segment[0] != ZGFX_SEGMENTED_SINGLE))
+		return FALSE;
+
+	MoveMemory(segment, segment + 1, end - pos - 1);
+	Stream_SetPosition(s, end - 1);
+	Stream_SealLength(s);
+	return TRUE;
+}
+
+BOOL drdynvc_decompress_data(ZGFX_CONTEXT* zgfx, const BYTE* data, size_t length,
+                             BYTE** ppDstData, UINT32* pDstSize)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(zgfx);
+	WINPR_ASSERT(ppDstData);
+	WINPR_ASSERT(pDstSize);
+
+	*ppDstData = NULL;
+	*pDstSize = 0;
+
+	if ((length < 1) || (length >= UINT32_MAX))
+		return FALSE;
+
+	BYTE* segment = malloc(length + 1);
+	if (!segment)
+		return FALSE;
+
+	segment[0] = ZGFX_SEGMENTED_SINGLE;
+	CopyMemory(&segment[1], data, length);
+
+	if (zgfx_decompress(zgfx, segment, (UINT32)(length + 1), ppDstData, pDstSize, 0) < 0)
+		goto fail;
+
+	/* Empty chunks are never sent */
+	if (*pDstSize == 0)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	if (!rc)
+	{
+		free(*ppDstData);
+		*ppDstData = NULL;
+		*pDstSize = 0;
+		WLog_ERR(TAG, "invalid compressed dynamic channel data");
+	}
+	free(segment);
+	return rc;
+}
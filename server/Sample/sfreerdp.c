@@ -1087,6 +1087,7 @@ static DWORD WINAPI test_peer_mainloop(LPVOID arg)
 	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
 	DWORD count = 0;
 	DWORD status = 0;
+	WINPR_WAIT_SET* events = NULL;
 	testPeerContext* context = NULL;
 	rdpSettings* settings = NULL;
 	rdpInput* input = NULL;
@@ -1196,6 +1197,10 @@ static DWORD WINAPI test_peer_mainloop(LPVOID arg)
 
 	WLog_INFO(TAG, "We've got a client %s", client->local ? "(local)" : client->hostname);
 
+	events = WaitSet_New();
+	if (!events)
+		goto fail;
+
 	while (error == CHANNEL_RC_OK)
 	{
 		count = 0;
@@ -1214,11 +1219,19 @@ static DWORD WINAPI test_peer_mainloop(LPVOID arg)
 
 		HANDLE channelHandle = WTSVirtualChannelManagerGetEventHandle(context->vcm);
 		handles[count++] = channelHandle;
-		status = WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+
+		/* the transport handles change during the connection sequence only */
+		if (!WaitSet_SetHandles(events, handles, count, NULL))
+		{
+			WLog_ERR(TAG, "Failed to update the wait set");
+			break;
+		}
+
+		status = WaitSet_Wait(events, INFINITE);
 
 		if (status == WAIT_FAILED)
 		{
-			WLog_ERR(TAG, "WaitForMultipleObjects failed (errno: %d)", errno);
+			WLog_ERR(TAG, "WaitSet_Wait failed (errno: %d)", errno);
 			break;
 		}
 
@@ -1275,6 +1288,7 @@ static DWORD WINAPI test_peer_mainloop(LPVOID arg)
 	WINPR_ASSERT(client->Disconnect);
 	client->Disconnect(client);
 fail:
+	WaitSet_Free(events);
 	freerdp_peer_context_free(client);
 	freerdp_peer_free(client);
 	return error;
@@ -1304,9 +1318,13 @@ static void test_server_mainloop(freerdp_listener* instance)
 	HANDLE handles[32] = { 0 };
 	DWORD count = 0;
 	DWORD status = 0;
+	WINPR_WAIT_SET* events = WaitSet_New();
 
 	WINPR_ASSERT(instance);
-	while (1)
+	if (!events)
+		WLog_ERR(TAG, "Failed to create a wait set");
+
+	while (events)
 	{
 		WINPR_ASSERT(instance->GetEventHandles);
 		count = instance->GetEventHandles(instance, handles, 32);
@@ -1317,7 +1335,13 @@ static void test_server_mainloop(freerdp_listener* instance)
 			break;
 		}
 
-		status = WaitForMultipleObjects(count, handles, FALSE, INFINITE);
+		if (!WaitSet_SetHandles(events, handles, count, NULL))
+		{
+			WLog_ERR(TAG, "Failed to update the wait set");
+			break;
+		}
+
+		status = WaitSet_Wait(events, INFINITE);
 
 		if (WAIT_FAILED == status)
 		{
@@ -1333,6 +1357,7 @@ static void test_server_mainloop(freerdp_listener* instance)
 		}
 	}
 
+	WaitSet_Free(events);
 	WINPR_ASSERT(instance->Close);
 	instance->Close(instance);
 }
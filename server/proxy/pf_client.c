@@ -554,6 +554,15 @@ static BOOL pf_client_post_connect(freerdp* instance)
 
 	pf_client_register_update_callbacks(update);
 
+	/* without a module hooking the graphics updates are relayed undecoded, as long as the
+	 * client accepts everything the target may send */
+	if (!pf_modules_has_graphics_hook(pc->pdata->module) &&
+	    pf_client_raw_updates_compatible(context->settings, ps->settings))
+	{
+		PROXY_LOG_INFO(TAG, pc, "relaying graphics updates undecoded");
+		pf_client_register_raw_update_callbacks(update);
+	}
+
 	/* virtual channels receive data hook */
 	pc->client_receive_channel_data_original = instance->ReceiveChannelData;
 	instance->ReceiveChannelData = pf_client_receive_channel_data_hook;
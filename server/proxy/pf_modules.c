@@ -231,6 +231,26 @@ BOOL pf_modules_run_hook(proxyModule* module, PF_HOOK_TYPE type, proxyData* pdat
 	                         custom);
 }
 
+static BOOL pf_modules_graphics_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
+{
+	const proxyPlugin* plugin = (const proxyPlugin*)data;
+
+	WINPR_UNUSED(index);
+	WINPR_UNUSED(ap);
+
+	return (plugin->ClientEndPaint == NULL);
+}
+
+/*
+ * checks if any plugin hooks the painting of the target's graphics updates.
+ */
+BOOL pf_modules_has_graphics_hook(proxyModule* module)
+{
+	WINPR_ASSERT(module);
+	WINPR_ASSERT(module->plugins);
+	return !ArrayList_ForEach(module->plugins, pf_modules_graphics_ArrayList_ForEachFkt);
+}
+
 static BOOL pf_modules_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
 {
 	proxyPlugin* plugin = (proxyPlugin*)data;
@@ -61,6 +61,19 @@ static BOOL pf_server_suppress_output(rdpContext* context, BYTE allow, const REC
 	return pc->update->SuppressOutput(pc, allow, area);
 }
 
+static BOOL pf_server_frame_acknowledge(rdpContext* context, UINT32 frameId)
+{
+	pServerContext* ps = (pServerContext*)context;
+	rdpContext* pc = NULL;
+	WINPR_ASSERT(ps);
+	WINPR_ASSERT(ps->pdata);
+	pc = (rdpContext*)ps->pdata->pc;
+	WINPR_ASSERT(pc);
+	WINPR_ASSERT(pc->update);
+	WINPR_ASSERT(pc->update->SurfaceFrameAcknowledge);
+	return pc->update->SurfaceFrameAcknowledge(pc, frameId);
+}
+
 /* Proxy from PC to PS */
 
 /**
@@ -129,6 +142,26 @@ static BOOL pf_client_bitmap_update(rdpContext* context, const BITMAP_UPDATE* bi
 	return ps->update->BitmapUpdate(ps, bitmap);
 }
 
+/**
+ * Relays a graphics update as received from the target, nothing is decoded
+ * or encoded again. Only used if no module hooks the graphics.
+ */
+static BOOL pf_client_raw_update(rdpContext* context, BYTE updateCode, wStream* s)
+{
+	pClientContext* pc = (pClientContext*)context;
+	proxyData* pdata = NULL;
+	rdpContext* ps = NULL;
+	WINPR_ASSERT(pc);
+	pdata = pc->pdata;
+	WINPR_ASSERT(pdata);
+	ps = (rdpContext*)pdata->ps;
+	WINPR_ASSERT(ps);
+	WINPR_ASSERT(ps->update);
+	WINPR_ASSERT(ps->update->RawUpdate);
+	WLog_DBG(TAG, "called");
+	return ps->update->RawUpdate(ps, updateCode, s);
+}
+
 static BOOL pf_client_desktop_resize(rdpContext* context)
 {
 	pClientContext* pc = (pClientContext*)context;
@@ -592,6 +625,7 @@ void pf_server_register_update_callbacks(rdpUpdate* update)
 	WINPR_ASSERT(update);
 	update->RefreshRect = pf_server_refresh_rect;
 	update->SuppressOutput = pf_server_suppress_output;
+	update->SurfaceFrameAcknowledge = pf_server_frame_acknowledge;
 }
 
 void pf_client_register_update_callbacks(rdpUpdate* update)
@@ -627,3 +661,69 @@ void pf_client_register_update_callbacks(rdpUpdate* update)
 	update->pointer->PointerNew = pf_client_send_pointer_new;
 	update->pointer->PointerCached = pf_client_send_pointer_cached;
 }
+
+static BOOL pf_client_raw_check_uint32(const rdpSettings* target, const rdpSettings* client,
+                                       FreeRDP_Settings_Keys_UInt32 id)
+{
+	const UINT32 tval = freerdp_settings_get_uint32(target, id);
+	const UINT32 cval = freerdp_settings_get_uint32(client, id);
+	if (tval <= cval)
+		return TRUE;
+
+	WLog_INFO(TAG, "%s: target %" PRIu32 " exceeds client %" PRIu32,
+	          freerdp_settings_get_name_for_key(id), tval, cval);
+	return FALSE;
+}
+
+static BOOL pf_client_raw_check_flags(const rdpSettings* target, const rdpSettings* client,
+                                      FreeRDP_Settings_Keys_UInt32 id)
+{
+	const UINT32 tval = freerdp_settings_get_uint32(target, id);
+	const UINT32 cval = freerdp_settings_get_uint32(client, id);
+	if ((tval & ~cval) == 0)
+		return TRUE;
+
+	WLog_INFO(TAG, "%s: target 0x%08" PRIx32 " not supported by client 0x%08" PRIx32,
+	          freerdp_settings_get_name_for_key(id), tval, cval);
+	return FALSE;
+}
+
+static BOOL pf_client_raw_check_bool(const rdpSettings* target, const rdpSettings* client,
+                                     FreeRDP_Settings_Keys_Bool id)
+{
+	if (!freerdp_settings_get_bool(target, id) || freerdp_settings_get_bool(client, id))
+		return TRUE;
+
+	WLog_INFO(TAG, "%s: enabled for the target but not the client",
+	          freerdp_settings_get_name_for_key(id));
+	return FALSE;
+}
+
+BOOL pf_client_raw_updates_compatible(const rdpSettings* target, const rdpSettings* client)
+{
+	WINPR_ASSERT(target);
+	WINPR_ASSERT(client);
+
+	/* undecoded updates are sent to the client as the target sent them, so the client must
+	 * accept everything the target negotiated with the proxy. */
+	if (!freerdp_settings_get_bool(client, FreeRDP_FastPathOutput))
+	{
+		WLog_INFO(TAG, "client does not support fast-path output");
+		return FALSE;
+	}
+
+	return pf_client_raw_check_uint32(target, client, FreeRDP_MultifragMaxRequestSize) &&
+	       pf_client_raw_check_uint32(target, client, FreeRDP_PointerCacheSize) &&
+	       pf_client_raw_check_uint32(target, client, FreeRDP_ColorPointerCacheSize) &&
+	       pf_client_raw_check_uint32(target, client, FreeRDP_FrameAcknowledge) &&
+	       pf_client_raw_check_flags(target, client, FreeRDP_LargePointerFlag) &&
+	       pf_client_raw_check_flags(target, client, FreeRDP_SurfaceCommandsSupported) &&
+	       pf_client_raw_check_bool(target, client, FreeRDP_SurfaceCommandsEnabled) &&
+	       pf_client_raw_check_bool(target, client, FreeRDP_SurfaceFrameMarkerEnabled);
+}
+
+void pf_client_register_raw_update_callbacks(rdpUpdate* update)
+{
+	WINPR_ASSERT(update);
+	update->RawUpdate = pf_client_raw_update;
+}
@@ -30,5 +30,7 @@
 
 void pf_server_register_update_callbacks(rdpUpdate* update);
 void pf_client_register_update_callbacks(rdpUpdate* update);
+void pf_client_register_raw_update_callbacks(rdpUpdate* update);
+BOOL pf_client_raw_updates_compatible(const rdpSettings* target, const rdpSettings* client);
 
 #endif /* FREERDP_SERVER_PROXY_PFUPDATE_H */
@@ -90,6 +90,7 @@ extern "C"
 	                           void* param);
 	BOOL pf_modules_run_hook(proxyModule* module, PF_HOOK_TYPE type, proxyData* pdata,
 	                         void* custom);
+	BOOL pf_modules_has_graphics_hook(proxyModule* module);
 
 	void pf_modules_free(proxyModule* module);
 
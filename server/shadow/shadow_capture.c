@@ -22,6 +22,7 @@
 #include <winpr/print.h>
 
 #include <freerdp/log.h>
+#include <freerdp/primitives.h>
 
 #include "shadow_surface.h"
 
@@ -86,47 +87,6 @@ int shadow_capture_compare(const BYTE* WINPR_RESTRICT pData1, UINT32 nStep1, UIN
 }
 #endif
 
-static BOOL color_equal(UINT32 colorA, UINT32 formatA, UINT32 colorB, UINT32 formatB)
-{
-	BYTE ar = 0;
-	BYTE ag = 0;
-	BYTE ab = 0;
-	BYTE aa = 0;
-	BYTE br = 0;
-	BYTE bg = 0;
-	BYTE bb = 0;
-	BYTE ba = 0;
-	FreeRDPSplitColor(colorA, formatA, &ar, &ag, &ab, &aa, NULL);
-	FreeRDPSplitColor(colorB, formatB, &br, &bg, &bb, &ba, NULL);
-
-	if (ar != br)
-		return FALSE;
-	if (ag != bg)
-		return FALSE;
-	if (ab != bb)
-		return FALSE;
-	if (aa != ba)
-		return FALSE;
-	return TRUE;
-}
-
-static BOOL pixel_equal(const BYTE* WINPR_RESTRICT a, UINT32 formatA, const BYTE* WINPR_RESTRICT b,
-                        UINT32 formatB, size_t count)
-{
-	const size_t bppA = FreeRDPGetBytesPerPixel(formatA);
-	const size_t bppB = FreeRDPGetBytesPerPixel(formatB);
-
-	for (size_t x = 0; x < count; x++)
-	{
-		const UINT32 colorA = FreeRDPReadColor(&a[bppA * x], formatA);
-		const UINT32 colorB = FreeRDPReadColor(&b[bppB * x], formatB);
-		if (!color_equal(colorA, formatA, colorB, formatB))
-			return FALSE;
-	}
-
-	return TRUE;
-}
-
 static BOOL color_equal_no_alpha(UINT32 colorA, UINT32 formatA, UINT32 colorB, UINT32 formatB)
 {
 	BYTE ar = 0;
@@ -178,64 +138,67 @@ typedef BOOL (*pixel_equal_fn_t)(const BYTE* WINPR_RESTRICT a, UINT32 formatA,
 
 static pixel_equal_fn_t get_comparison_fn(DWORD format1, DWORD format2)
 {
-
 	if (format1 == format2)
 		return pixel_equal_same_format;
 
-	const UINT32 bpp1 = FreeRDPGetBitsPerPixel(format1);
+	return pixel_equal_no_alpha;
+}
+
+/* Check if the images can be compared with the compare_tiles_32u primitive and get the
+ * pixel mask to use */
+static BOOL get_comparison_mask(DWORD format1, DWORD format2, UINT32* pMask)
+{
+	BYTE mask[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+	WINPR_ASSERT(pMask);
 
-	if (!FreeRDPColorHasAlpha(format1) || !FreeRDPColorHasAlpha(format2))
+	if ((FreeRDPGetBitsPerPixel(format1) != 32) || (FreeRDPGetBitsPerPixel(format2) != 32))
+		return FALSE;
+
+	if (format1 != format2)
 	{
-		/* In case we have RGBA32 and RGBX32 or similar assume the alpha data is equal.
-		 * This allows us to use the fast memcmp comparison. */
-		if ((bpp1 == 32) && FreeRDPAreColorFormatsEqualNoAlpha(format1, format2))
+		/* In case we have RGBA32 and RGBX32 or similar ignore the alpha byte */
+		if (FreeRDPColorHasAlpha(format1) && FreeRDPColorHasAlpha(format2))
+			return FALSE;
+
+		if (!FreeRDPAreColorFormatsEqualNoAlpha(format1, format2))
+			return FALSE;
+
+		switch (format1)
 		{
-			switch (format1)
-			{
-				case PIXEL_FORMAT_ARGB32:
-				case PIXEL_FORMAT_XRGB32:
-				case PIXEL_FORMAT_ABGR32:
-				case PIXEL_FORMAT_XBGR32:
-					return pixel_equal;
-				case PIXEL_FORMAT_RGBA32:
-				case PIXEL_FORMAT_RGBX32:
-				case PIXEL_FORMAT_BGRA32:
-				case PIXEL_FORMAT_BGRX32:
-					return pixel_equal;
-				default:
-					break;
-			}
+			case PIXEL_FORMAT_ARGB32:
+			case PIXEL_FORMAT_XRGB32:
+			case PIXEL_FORMAT_ABGR32:
+			case PIXEL_FORMAT_XBGR32:
+				mask[0] = 0;
+				break;
+			case PIXEL_FORMAT_RGBA32:
+			case PIXEL_FORMAT_RGBX32:
+			case PIXEL_FORMAT_BGRA32:
+			case PIXEL_FORMAT_BGRX32:
+				mask[3] = 0;
+				break;
+			default:
+				return FALSE;
 		}
-		return pixel_equal_no_alpha;
 	}
-	else
-		return pixel_equal_no_alpha;
+
+	memcpy(pMask, mask, sizeof(mask));
+	return TRUE;
 }
 
-int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32 format1,
-                                       UINT32 nStep1, UINT32 nWidth, UINT32 nHeight,
-                                       const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
-                                       UINT32 nStep2, RECTANGLE_16* WINPR_RESTRICT rect)
+static void compare_tiles_generic(const BYTE* WINPR_RESTRICT pData1, UINT32 format1,
+                                  UINT32 nStep1, UINT32 nWidth, UINT32 nHeight,
+                                  const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
+                                  UINT32 nStep2, BYTE* WINPR_RESTRICT dirty, UINT32 ncol)
 {
 	pixel_equal_fn_t pixel_equal_fn = get_comparison_fn(format1, format2);
-	BOOL allEqual = TRUE;
-	UINT32 tw = 0;
 	const UINT32 nrow = (nHeight + 15) / 16;
-	const UINT32 ncol = (nWidth + 15) / 16;
-	UINT32 l = ncol + 1;
-	UINT32 t = nrow + 1;
-	UINT32 r = 0;
-	UINT32 b = 0;
 	const size_t bppA = FreeRDPGetBytesPerPixel(format1);
 	const size_t bppB = FreeRDPGetBytesPerPixel(format2);
-	const RECTANGLE_16 empty = { 0 };
-	WINPR_ASSERT(rect);
-
-	*rect = empty;
 
 	for (size_t ty = 0; ty < nrow; ty++)
 	{
-		BOOL rowEqual = TRUE;
 		size_t th = ((ty + 1) == nrow) ? (nHeight % 16) : 16;
 
 		if (!th)
@@ -244,7 +207,7 @@ int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32
 		for (size_t tx = 0; tx < ncol; tx++)
 		{
 			BOOL equal = TRUE;
-			tw = ((tx + 1) == ncol) ? (nWidth % 16) : 16;
+			size_t tw = ((tx + 1) == ncol) ? (nWidth % 16) : 16;
 
 			if (!tw)
 				tw = 16;
@@ -264,50 +227,120 @@ int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32
 				p2 += nStep2;
 			}
 
-			if (!equal)
-			{
-				rowEqual = FALSE;
-				if (l > tx)
-					l = (UINT32)tx;
-
-				if (r < tx)
-					r = (UINT32)tx;
-			}
+			dirty[ty * ncol + tx] = equal ? 0 : 1;
 		}
+	}
+}
 
-		if (!rowEqual)
-		{
-			allEqual = FALSE;
+static BOOL region_add_tiles(REGION16* WINPR_RESTRICT region, UINT32 top, UINT32 bottom,
+                             const BYTE* WINPR_RESTRICT dirty, UINT32 ncol, UINT32 nWidth)
+{
+	for (UINT32 tx = 0; tx < ncol; tx++)
+	{
+		if (!dirty[tx])
+			continue;
 
-			if (t > ty)
-				t = (UINT32)ty;
+		const UINT32 left = tx;
 
-			if (b < ty)
-				b = (UINT32)ty;
-		}
+		while ((tx < ncol) && dirty[tx])
+			tx++;
+
+		const RECTANGLE_16 rect = { WINPR_ASSERTING_INT_CAST(UINT16, left * 16),
+			                        WINPR_ASSERTING_INT_CAST(UINT16, top),
+			                        WINPR_ASSERTING_INT_CAST(UINT16, MIN(tx * 16, nWidth)),
+			                        WINPR_ASSERTING_INT_CAST(UINT16, bottom) };
+
+		if (!region16_union_rect(region, region, &rect))
+			return FALSE;
 	}
 
-	if (allEqual)
+	return TRUE;
+}
+
+int shadow_capture_compare_region(const BYTE* WINPR_RESTRICT pData1, UINT32 format1,
+                                  UINT32 nStep1, UINT32 nWidth, UINT32 nHeight,
+                                  const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
+                                  UINT32 nStep2, REGION16* WINPR_RESTRICT region)
+{
+	int rc = -1;
+	UINT32 mask = 0;
+	const UINT32 nrow = (nHeight + 15) / 16;
+	const UINT32 ncol = (nWidth + 15) / 16;
+
+	WINPR_ASSERT(pData1);
+	WINPR_ASSERT(pData2);
+	WINPR_ASSERT(region);
+
+	region16_clear(region);
+
+	if ((nWidth > UINT16_MAX) || (nHeight > UINT16_MAX))
+		return -1;
+
+	if ((nWidth == 0) || (nHeight == 0))
 		return 0;
 
-	WINPR_ASSERT(l * 16 <= UINT16_MAX);
-	WINPR_ASSERT(t * 16 <= UINT16_MAX);
-	WINPR_ASSERT((r + 1) * 16 <= UINT16_MAX);
-	WINPR_ASSERT((b + 1) * 16 <= UINT16_MAX);
-	rect->left = (UINT16)l * 16;
-	rect->top = (UINT16)t * 16;
-	rect->right = (UINT16)(r + 1) * 16;
-	rect->bottom = (UINT16)(b + 1) * 16;
+	BYTE* dirty = calloc(nrow, ncol);
+
+	if (!dirty)
+		return -1;
 
-	WINPR_ASSERT(nWidth <= UINT16_MAX);
-	if (rect->right > nWidth)
-		rect->right = (UINT16)nWidth;
+	if (get_comparison_mask(format1, format2, &mask))
+	{
+		const primitives_t* prims = primitives_get();
 
-	WINPR_ASSERT(nHeight <= UINT16_MAX);
-	if (rect->bottom > nHeight)
-		rect->bottom = (UINT16)nHeight;
+		if (prims->compare_tiles_32u(pData1, nStep1, pData2, nStep2, nWidth, nHeight, mask, dirty,
+		                             ncol) != PRIMITIVES_SUCCESS)
+			goto fail;
+	}
+	else
+		compare_tiles_generic(pData1, format1, nStep1, nWidth, nHeight, pData2, format2, nStep2,
+		                      dirty, ncol);
 
-	return 1;
+	/* Tile rows with the same dirty tiles are added as a single band */
+	for (UINT32 ty = 0; ty < nrow;)
+	{
+		const BYTE* line = &dirty[1ull * ty * ncol];
+		UINT32 next = ty + 1;
+
+		while ((next < nrow) && (memcmp(line, &dirty[1ull * next * ncol], ncol) == 0))
+			next++;
+
+		if (!region_add_tiles(region, ty * 16, MIN(next * 16, nHeight), line, ncol, nWidth))
+			goto fail;
+
+		ty = next;
+	}
+
+	rc = region16_is_empty(region) ? 0 : 1;
+fail:
+	free(dirty);
+	return rc;
+}
+
+int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32 format1,
+                                       UINT32 nStep1, UINT32 nWidth, UINT32 nHeight,
+                                       const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
+                                       UINT32 nStep2, RECTANGLE_16* WINPR_RESTRICT rect)
+{
+	REGION16 region = { 0 };
+	const RECTANGLE_16 empty = { 0 };
+
+	WINPR_ASSERT(rect);
+
+	*rect = empty;
+	region16_init(&region);
+
+	const int rc = shadow_capture_compare_region(pData1, format1, nStep1, nWidth, nHeight, pData2,
+	                                             format2, nStep2, &region);
+
+	if (rc > 0)
+	{
+		const RECTANGLE_16* extents = region16_extents(&region);
+		*rect = *extents;
+	}
+
+	region16_uninit(&region);
+	return rc;
 }
 
 rdpShadowCapture* shadow_capture_new(rdpShadowServer* server)
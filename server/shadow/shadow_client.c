@@ -37,6 +37,12 @@
 
 #define TAG CLIENT_TAG("shadow")
 
+/* Damaged area in percent of the surface from which H264 full frames are sent */
+#define SHADOW_GFX_H264_MIN_AREA 25
+
+/* More rectangles are merged to their bounding box for codecs without region support */
+#define SHADOW_GFX_MAX_RECTS 32
+
 typedef struct
 {
 	BOOL gfxOpened;
@@ -306,6 +312,9 @@ static BOOL shadow_client_context_new(freerdp_peer* peer, rdpContext* context)
 		return FALSE;
 	if (!freerdp_settings_set_uint32(settings, FreeRDP_CompressionLevel, PACKET_COMPR_TYPE_RDP8))
 		return FALSE;
+	/* let output queue up so a slow client shows as congested instead of stalling the encoder */
+	if (!freerdp_settings_set_bool(settings, FreeRDP_WaitForOutputBufferFlush, FALSE))
+		return FALSE;
 
 	if (server->ipcSocket && (strncmp(bind_address, server->ipcSocket,
 	                                  strnlen(bind_address, sizeof(bind_address))) != 0))
@@ -1140,16 +1149,80 @@ static INLINE UINT32 rdpgfx_estimate_h264_avc420(RDPGFX_AVC420_BITMAP_STREAM* ha
 	       havc420->length;
 }
 
+static UINT64 shadow_client_region_area(const REGION16* region)
+{
+	UINT64 area = 0;
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(region, &numRects);
+
+	for (UINT32 x = 0; x < numRects; x++)
+	{
+		const RECTANGLE_16* rect = &rects[x];
+		area += 1ull * (rect->right - rect->left) * (rect->bottom - rect->top);
+	}
+
+	return area;
+}
+
+/**
+ * Rectangles to encode with codecs that do not support a region.
+ * Heavily fragmented regions are sent as a single bounding rectangle.
+ */
+static const RECTANGLE_16* shadow_client_gfx_rects(const REGION16* region, UINT32* numRects)
+{
+	const RECTANGLE_16* rects = region16_rects(region, numRects);
+
+	if (*numRects > SHADOW_GFX_MAX_RECTS)
+	{
+		*numRects = 1;
+		return region16_extents(region);
+	}
+
+	return rects;
+}
+
+static void shadow_client_gfx_set_rect(RDPGFX_SURFACE_COMMAND* cmd, const RECTANGLE_16* rect)
+{
+	cmd->left = rect->left;
+	cmd->top = rect->top;
+	cmd->right = rect->right;
+	cmd->bottom = rect->bottom;
+	cmd->width = cmd->right - cmd->left;
+	cmd->height = cmd->bottom - cmd->top;
+}
+
+/**
+ * Encoded data is shared between clients through the surface frame cache.
+ * With a single client this would only add a copy of every update.
+ */
+static rdpShadowFrameCacheEntry*
+shadow_client_frame_cache_acquire(rdpShadowClient* client, const SHADOW_FRAME_CACHE_KEY* key)
+{
+	WINPR_ASSERT(client);
+
+	rdpShadowServer* server = client->server;
+	WINPR_ASSERT(server);
+
+	const rdpShadowSurface* surface = client->inLobby ? server->lobby : server->surface;
+	if (!surface || (ArrayList_Count(server->clients) < 2))
+		return NULL;
+
+	return shadow_frame_cache_acquire(surface->cache, key);
+}
+
 /**
  * Function description
+ * Only the invalid region is encoded. H264 always encodes the full surface, so it is used only if
+ * a large part of the surface changed. Smaller updates use the other codecs of the client.
  *
  * @return TRUE on success
  */
 static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE* pSrcData,
-                                           UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nXSrc,
-                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight)
+                                           UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nWidth,
+                                           UINT16 nHeight, const REGION16* invalidRegion)
 {
 	UINT32 id = 0;
+	UINT32 numRects = 0;
 	UINT error = CHANNEL_RC_OK;
 	const rdpContext* context = (const rdpContext*)client;
 	const rdpSettings* settings = NULL;
@@ -1159,7 +1232,7 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	RDPGFX_END_FRAME_PDU cmdend = { 0 };
 	SYSTEMTIME sTime = { 0 };
 
-	if (!context || !pSrcData)
+	if (!context || !pSrcData || !invalidRegion)
 		return FALSE;
 
 	settings = context->settings;
@@ -1181,19 +1254,23 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	cmdend.frameId = cmdstart.frameId;
 	cmd.surfaceId = client->surfaceId;
 	cmd.format = PIXEL_FORMAT_BGRX32;
-	cmd.left = nXSrc;
-	cmd.top = nYSrc;
-	cmd.right = cmd.left + nWidth;
-	cmd.bottom = cmd.top + nHeight;
+	cmd.left = 0;
+	cmd.top = 0;
+	cmd.right = nWidth;
+	cmd.bottom = nHeight;
 	cmd.width = nWidth;
 	cmd.height = nHeight;
 
+	const RECTANGLE_16* rects = shadow_client_gfx_rects(invalidRegion, &numRects);
+
 	id = freerdp_settings_get_uint32(settings, FreeRDP_RemoteFxCodecId);
 #ifdef WITH_GFX_H264
 	const BOOL GfxH264 = freerdp_settings_get_bool(settings, FreeRDP_GfxH264);
 	const BOOL GfxAVC444 = freerdp_settings_get_bool(settings, FreeRDP_GfxAVC444);
 	const BOOL GfxAVC444v2 = freerdp_settings_get_bool(settings, FreeRDP_GfxAVC444v2);
-	if (GfxAVC444 || GfxAVC444v2)
+	const BOOL fullFrame = shadow_client_region_area(invalidRegion) * 100ull >=
+	                       1ull * nWidth * nHeight * SHADOW_GFX_H264_MIN_AREA;
+	if (fullFrame && (GfxAVC444 || GfxAVC444v2))
 	{
 		INT32 rc = 0;
 		RDPGFX_AVC444_BITMAP_STREAM avc444 = { 0 };
@@ -1243,7 +1320,7 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 	}
-	else if (GfxH264)
+	else if (fullFrame && GfxH264)
 	{
 		INT32 rc = 0;
 		RDPGFX_AVC420_BITMAP_STREAM avc420 = { 0 };
@@ -1294,7 +1371,7 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	{
 		BOOL rc = 0;
 		wStream* s = NULL;
-		RFX_RECT rect;
+		RFX_RECT* rfxRects = NULL;
 
 		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_REMOTEFX) < 0)
 		{
@@ -1302,19 +1379,27 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 
+		rfxRects = calloc(numRects, sizeof(RFX_RECT));
+		if (!rfxRects)
+			return FALSE;
+
+		for (UINT32 x = 0; x < numRects; x++)
+		{
+			const RECTANGLE_16* rect = &rects[x];
+			RFX_RECT* rfxRect = &rfxRects[x];
+
+			rfxRect->x = rect->left;
+			rfxRect->y = rect->top;
+			rfxRect->width = rect->right - rect->left;
+			rfxRect->height = rect->bottom - rect->top;
+		}
+
 		s = Stream_New(NULL, 1024);
 		WINPR_ASSERT(s);
 
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		rect.x = (UINT16)cmd.left;
-		rect.y = (UINT16)cmd.top;
-		rect.width = WINPR_ASSERTING_INT_CAST(UINT16, cmd.right - cmd.left);
-		rect.height = WINPR_ASSERTING_INT_CAST(UINT16, cmd.bottom - cmd.top);
-
-		rc = rfx_compose_message(encoder->rfx, s, &rect, 1, pSrcData, nWidth, nHeight, nSrcStep);
+		rc = rfx_compose_message(encoder->rfx, s, rfxRects, numRects, pSrcData, nWidth, nHeight,
+		                         nSrcStep);
+		free(rfxRects);
 
 		if (!rc)
 		{
@@ -1346,33 +1431,34 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	}
 	else if (freerdp_settings_get_bool(settings, FreeRDP_GfxProgressive))
 	{
-		INT32 rc = 0;
-		REGION16 region;
-		RECTANGLE_16 regionRect;
+		INT32 rc = 1;
+		SHADOW_FRAME_CACHE_KEY key = { RDPGFX_CODECID_CAPROGRESSIVE, 0, cmd.format, nWidth,
+			                           nHeight, NULL, 0 };
 
-		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PROGRESSIVE) < 0)
-		{
-			WLog_ERR(TAG, "Failed to prepare encoder FREERDP_CODEC_PROGRESSIVE");
-			return FALSE;
-		}
+		key.rects = region16_rects(invalidRegion, &key.numRects);
+		rdpShadowFrameCacheEntry* entry = shadow_client_frame_cache_acquire(client, &key);
 
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		regionRect.left = (UINT16)cmd.left;
-		regionRect.top = (UINT16)cmd.top;
-		regionRect.right = (UINT16)cmd.right;
-		regionRect.bottom = (UINT16)cmd.bottom;
-		region16_init(&region);
-		region16_union_rect(&region, &region, &regionRect);
-		rc = progressive_compress(encoder->progressive, pSrcData, nSrcStep * nHeight, cmd.format,
-		                          nWidth, nHeight, nSrcStep, &region, &cmd.data, &cmd.length);
-		region16_uninit(&region);
-		if (rc < 0)
+		if (!shadow_frame_cache_entry_get(entry, &cmd.data, &cmd.length))
 		{
-			WLog_ERR(TAG, "progressive_compress failed");
-			return FALSE;
+			if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PROGRESSIVE) < 0)
+			{
+				WLog_ERR(TAG, "Failed to prepare encoder FREERDP_CODEC_PROGRESSIVE");
+				shadow_frame_cache_release(entry);
+				return FALSE;
+			}
+
+			rc = progressive_compress(encoder->progressive, pSrcData, nSrcStep * nHeight,
+			                          cmd.format, nWidth, nHeight, nSrcStep, invalidRegion,
+			                          &cmd.data, &cmd.length);
+			if (rc < 0)
+			{
+				WLog_ERR(TAG, "progressive_compress failed");
+				shadow_frame_cache_release(entry);
+				return FALSE;
+			}
+
+			if (rc > 0)
+				shadow_frame_cache_entry_set(entry, cmd.data, cmd.length);
 		}
 
 		/* rc > 0 means new data */
@@ -1384,74 +1470,143 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			          &cmdend);
 		}
 
+		shadow_frame_cache_release(entry);
+
 		if (error)
 		{
 			WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
 			return FALSE;
 		}
 	}
-	else if (freerdp_settings_get_bool(settings, FreeRDP_GfxPlanar))
+	else if (client->server->GfxClearCodec)
 	{
-		const UINT32 w = cmd.right - cmd.left;
-		const UINT32 h = cmd.bottom - cmd.top;
-		const BYTE* src =
-		    &pSrcData[cmd.top * nSrcStep + cmd.left * FreeRDPGetBytesPerPixel(SrcFormat)];
-		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PLANAR) < 0)
+		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_CLEARCODEC) < 0)
 		{
-			WLog_ERR(TAG, "Failed to prepare encoder FREERDP_CODEC_PLANAR");
+			WLog_ERR(TAG, "Failed to prepare encoder FREERDP_CODEC_CLEARCODEC");
 			return FALSE;
 		}
 
-		const BOOL rc = freerdp_bitmap_planar_context_reset(encoder->planar, w, h);
-		if (!rc)
-			return FALSE;
+		for (UINT32 x = 0; x < numRects; x++)
+		{
+			shadow_client_gfx_set_rect(&cmd, &rects[x]);
 
-		freerdp_planar_topdown_image(encoder->planar, TRUE);
+			const BYTE* src =
+			    &pSrcData[cmd.top * nSrcStep + cmd.left * FreeRDPGetBytesPerPixel(SrcFormat)];
 
-		cmd.data = freerdp_bitmap_compress_planar(encoder->planar, src, SrcFormat, w, h, nSrcStep,
-		                                          NULL, &cmd.length);
-		WINPR_ASSERT(cmd.data || (cmd.length == 0));
+			Stream_SetPosition(encoder->bs, 0);
 
-		cmd.codecId = RDPGFX_CODECID_PLANAR;
+			if (!clear_compress_to_stream(encoder->clear, encoder->bs, src, SrcFormat, nSrcStep,
+			                              cmd.width, cmd.height))
+			{
+				WLog_ERR(TAG, "clear_compress_to_stream failed");
+				return FALSE;
+			}
 
-		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-		          &cmdend);
-		free(cmd.data);
-		if (error)
-		{
-			WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
-			return FALSE;
+			cmd.codecId = RDPGFX_CODECID_CLEARCODEC;
+			cmd.data = Stream_Buffer(encoder->bs);
+			cmd.length = WINPR_ASSERTING_INT_CAST(UINT32, Stream_GetPosition(encoder->bs));
+
+			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd,
+			          (x == 0) ? &cmdstart : NULL, (x + 1 == numRects) ? &cmdend : NULL);
+			if (error)
+			{
+				WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
+				return FALSE;
+			}
 		}
 	}
-	else
+	else if (freerdp_settings_get_bool(settings, FreeRDP_GfxPlanar))
 	{
-		const UINT32 w = cmd.right - cmd.left;
-		const UINT32 h = cmd.bottom - cmd.top;
-		const UINT32 length = w * 4 * h;
+		const UINT32 planarFlags = freerdp_settings_get_bool(settings, FreeRDP_DrawAllowSkipAlpha)
+		                               ? PLANAR_FORMAT_HEADER_NA
+		                               : 0;
 
-		BYTE* data = malloc(length);
-		if (!data)
+		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PLANAR) < 0)
+		{
+			WLog_ERR(TAG, "Failed to prepare encoder FREERDP_CODEC_PLANAR");
 			return FALSE;
+		}
 
-		BOOL rc = freerdp_image_copy_no_overlap(data, PIXEL_FORMAT_BGRA32, 0, 0, 0, w, h, pSrcData,
-		                                        SrcFormat, nSrcStep, cmd.left, cmd.top, NULL, 0);
-		if (!rc)
+		for (UINT32 x = 0; x < numRects; x++)
 		{
+			BYTE* data = NULL;
+			const SHADOW_FRAME_CACHE_KEY key = {
+				RDPGFX_CODECID_PLANAR, planarFlags, SrcFormat, nWidth, nHeight, &rects[x], 1
+			};
+
+			shadow_client_gfx_set_rect(&cmd, &rects[x]);
+
+			rdpShadowFrameCacheEntry* entry = shadow_client_frame_cache_acquire(client, &key);
+
+			if (!shadow_frame_cache_entry_get(entry, &cmd.data, &cmd.length))
+			{
+				const BYTE* src =
+				    &pSrcData[cmd.top * nSrcStep + cmd.left * FreeRDPGetBytesPerPixel(SrcFormat)];
+
+				const BOOL rc =
+				    freerdp_bitmap_planar_context_reset(encoder->planar, cmd.width, cmd.height);
+				if (!rc)
+				{
+					shadow_frame_cache_release(entry);
+					return FALSE;
+				}
+
+				freerdp_planar_topdown_image(encoder->planar, TRUE);
+
+				data = freerdp_bitmap_compress_planar(encoder->planar, src, SrcFormat, cmd.width,
+				                                      cmd.height, nSrcStep, NULL, &cmd.length);
+				WINPR_ASSERT(data || (cmd.length == 0));
+
+				cmd.data = data;
+				shadow_frame_cache_entry_set(entry, data, cmd.length);
+			}
+
+			cmd.codecId = RDPGFX_CODECID_PLANAR;
+
+			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd,
+			          (x == 0) ? &cmdstart : NULL, (x + 1 == numRects) ? &cmdend : NULL);
+			shadow_frame_cache_release(entry);
 			free(data);
-			return FALSE;
+			if (error)
+			{
+				WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
+				return FALSE;
+			}
 		}
+	}
+	else
+	{
+		for (UINT32 x = 0; x < numRects; x++)
+		{
+			shadow_client_gfx_set_rect(&cmd, &rects[x]);
 
-		cmd.data = data;
-		cmd.length = length;
-		cmd.codecId = RDPGFX_CODECID_UNCOMPRESSED;
+			const UINT32 length = cmd.width * 4 * cmd.height;
 
-		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-		          &cmdend);
-		free(data);
-		if (error)
-		{
-			WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
-			return FALSE;
+			BYTE* data = malloc(length);
+			if (!data)
+				return FALSE;
+
+			BOOL rc = freerdp_image_copy_no_overlap(data, PIXEL_FORMAT_BGRA32, 0, 0, 0, cmd.width,
+			                                        cmd.height, pSrcData, SrcFormat, nSrcStep,
+			                                        cmd.left, cmd.top, NULL, 0);
+			if (!rc)
+			{
+				free(data);
+				return FALSE;
+			}
+
+			cmd.data = data;
+			cmd.length = length;
+			cmd.codecId = RDPGFX_CODECID_UNCOMPRESSED;
+
+			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd,
+			          (x == 0) ? &cmdstart : NULL, (x + 1 == numRects) ? &cmdend : NULL);
+			free(data);
+			if (error)
+			{
+				WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
+				return FALSE;
+			}
 		}
 	}
 	return TRUE;
@@ -1859,6 +2014,41 @@ out:
 	return ret;
 }
 
+/**
+ * Convert the invalid region to GFX surface coordinates.
+ *
+ * @return TRUE on success
+ */
+static BOOL shadow_client_gfx_region(const rdpShadowServer* server, const REGION16* invalidRegion,
+                                     UINT16 nWidth, UINT16 nHeight, REGION16* gfxRegion)
+{
+	UINT16 subX = 0;
+	UINT16 subY = 0;
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(invalidRegion, &numRects);
+	const RECTANGLE_16 surfaceRect = { 0, 0, nWidth, nHeight };
+
+	if (server->shareSubRect)
+	{
+		subX = server->subRect.left;
+		subY = server->subRect.top;
+	}
+
+	for (UINT32 index = 0; index < numRects; index++)
+	{
+		const RECTANGLE_16* r = &rects[index];
+		WINPR_ASSERT(r->left >= subX);
+		WINPR_ASSERT(r->top >= subY);
+		const RECTANGLE_16 rect = { (UINT16)(r->left - subX), (UINT16)(r->top - subY),
+			                        (UINT16)(r->right - subX), (UINT16)(r->bottom - subY) };
+
+		if (!region16_union_rect(gfxRegion, gfxRegion, &rect))
+			return FALSE;
+	}
+
+	return region16_intersect_rect(gfxRegion, gfxRegion, &surfaceRect);
+}
+
 /**
  * Function description
  *
@@ -1962,7 +2152,9 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	{
 		if (pStatus->gfxOpened && client->areGfxCapsReady)
 		{
-			/* GFX/h264 always full screen encoded */
+			REGION16 gfxRegion = { 0 };
+
+			/* The GFX surface covers the whole (shared part of the) desktop */
 			nWidth = freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth);
 			nHeight = freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight);
 
@@ -1983,8 +2175,13 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 			WINPR_ASSERT(nWidth <= UINT16_MAX);
 			WINPR_ASSERT(nHeight >= 0);
 			WINPR_ASSERT(nHeight <= UINT16_MAX);
-			ret = shadow_client_send_surface_gfx(client, pSrcData, nSrcStep, SrcFormat, 0, 0,
-			                                     (UINT16)nWidth, (UINT16)nHeight);
+			region16_init(&gfxRegion);
+			ret = shadow_client_gfx_region(server, &invalidRegion, (UINT16)nWidth, (UINT16)nHeight,
+			                               &gfxRegion);
+			if (ret)
+				ret = shadow_client_send_surface_gfx(client, pSrcData, nSrcStep, SrcFormat,
+				                                     (UINT16)nWidth, (UINT16)nHeight, &gfxRegion);
+			region16_uninit(&gfxRegion);
 		}
 		else
 		{
@@ -2245,6 +2442,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	HANDLE ChannelEvent = 0;
 	void* UpdateSubscriber = NULL;
 	HANDLE UpdateEvent = 0;
+	WINPR_WAIT_SET* WaitEvents = NULL;
 	freerdp_peer* peer = NULL;
 	rdpContext* context = NULL;
 	rdpSettings* settings = NULL;
@@ -2310,6 +2508,12 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	WINPR_ASSERT(rc);
 	rc = freerdp_settings_set_bool(settings, FreeRDP_SupportMonitorLayoutPdu, TRUE);
 	WINPR_ASSERT(rc);
+
+	/* most handles stay the same for the whole session, keep them registered */
+	WaitEvents = WaitSet_New();
+	if (!WaitEvents)
+		goto fail;
+
 	while (1)
 	{
 		HANDLE events[MAXIMUM_WAIT_OBJECTS] = { 0 };
@@ -2336,7 +2540,10 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 			events[nCount++] = gfxevent;
 #endif
 
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+		if (!WaitSet_SetHandles(WaitEvents, events, nCount, NULL))
+			goto fail;
+
+		status = WaitSet_Wait(WaitEvents, INFINITE);
 
 		if (status == WAIT_FAILED)
 			goto fail;
@@ -2364,6 +2571,15 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 						break;
 					}
 				}
+				else if (freerdp_peer_is_output_congested(peer))
+				{
+					/* The client does not keep up, merge this frame into the next one */
+					if (!shadow_client_no_surface_update(client, &gfxstatus))
+					{
+						WLog_ERR(TAG, "Failed to handle surface update");
+						break;
+					}
+				}
 				else
 				{
 					/* Send frame */
@@ -2547,6 +2763,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	}
 
 fail:
+	WaitSet_Free(WaitEvents);
 
 	/* Free channels early because we establish channels in post connect */
 #if defined(CHANNEL_AUDIN_SERVER)
@@ -216,6 +216,25 @@ fail:
 	return -1;
 }
 
+static int shadow_encoder_init_clear(rdpShadowEncoder* encoder)
+{
+	if (!encoder->clear)
+		encoder->clear = clear_context_new(TRUE);
+
+	if (!encoder->clear)
+		goto fail;
+
+	if (!clear_context_reset(encoder->clear))
+		goto fail;
+
+	encoder->codecs |= FREERDP_CODEC_CLEARCODEC;
+	return 1;
+fail:
+	clear_context_free(encoder->clear);
+	encoder->clear = NULL;
+	return -1;
+}
+
 static int shadow_encoder_init_interleaved(rdpShadowEncoder* encoder)
 {
 	if (!encoder->interleaved)
@@ -336,6 +355,18 @@ static int shadow_encoder_uninit_planar(rdpShadowEncoder* encoder)
 	return 1;
 }
 
+static int shadow_encoder_uninit_clear(rdpShadowEncoder* encoder)
+{
+	if (encoder->clear)
+	{
+		clear_context_free(encoder->clear);
+		encoder->clear = NULL;
+	}
+
+	encoder->codecs &= (UINT32)~FREERDP_CODEC_CLEARCODEC;
+	return 1;
+}
+
 static int shadow_encoder_uninit_interleaved(rdpShadowEncoder* encoder)
 {
 	if (encoder->interleaved)
@@ -389,6 +420,8 @@ static int shadow_encoder_uninit(rdpShadowEncoder* encoder)
 
 	shadow_encoder_uninit_planar(encoder);
 
+	shadow_encoder_uninit_clear(encoder);
+
 	shadow_encoder_uninit_interleaved(encoder);
 	shadow_encoder_uninit_h264(encoder);
 
@@ -457,6 +490,15 @@ int shadow_encoder_prepare(rdpShadowEncoder* encoder, UINT32 codecs)
 			return -1;
 	}
 
+	if ((codecs & FREERDP_CODEC_CLEARCODEC) && !(encoder->codecs & FREERDP_CODEC_CLEARCODEC))
+	{
+		WLog_DBG(TAG, "initializing ClearCodec encoder");
+		status = shadow_encoder_init_clear(encoder);
+
+		if (status < 0)
+			return -1;
+	}
+
 	if ((codecs & FREERDP_CODEC_INTERLEAVED) && !(encoder->codecs & FREERDP_CODEC_INTERLEAVED))
 	{
 		WLog_DBG(TAG, "initializing interleaved bitmap encoder");
@@ -48,6 +48,7 @@ struct rdp_shadow_encoder
 	RFX_CONTEXT* rfx;
 	NSC_CONTEXT* nsc;
 	BITMAP_PLANAR_CONTEXT* planar;
+	CLEAR_CONTEXT* clear;
 	BITMAP_INTERLEAVED_CONTEXT* interleaved;
 	H264_CONTEXT* h264;
 	PROGRESSIVE_CONTEXT* progressive;
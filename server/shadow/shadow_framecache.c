@@ -0,0 +1,238 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/interlocked.h>
+
+#include "shadow.h"
+
+/* Distinct codec configurations and regions kept per surface update */
+#define SHADOW_FRAME_CACHE_MAX_ENTRIES 64
+
+struct rdp_shadow_frame_cache_entry
+{
+	SHADOW_FRAME_CACHE_KEY key;
+	RECTANGLE_16* rects;
+	CRITICAL_SECTION lock;
+	LONG refCount;
+	BYTE* data;
+	UINT32 length;
+};
+
+struct rdp_shadow_frame_cache
+{
+	CRITICAL_SECTION lock;
+	rdpShadowFrameCacheEntry* entries[SHADOW_FRAME_CACHE_MAX_ENTRIES];
+	size_t count;
+};
+
+static void shadow_frame_cache_entry_unref(rdpShadowFrameCacheEntry* entry)
+{
+	if (!entry)
+		return;
+
+	if (InterlockedDecrement(&entry->refCount) > 0)
+		return;
+
+	DeleteCriticalSection(&entry->lock);
+	free(entry->rects);
+	free(entry->data);
+	free(entry);
+}
+
+static rdpShadowFrameCacheEntry* shadow_frame_cache_entry_new(const SHADOW_FRAME_CACHE_KEY* key)
+{
+	rdpShadowFrameCacheEntry* entry = calloc(1, sizeof(rdpShadowFrameCacheEntry));
+
+	if (!entry)
+		return NULL;
+
+	if (!InitializeCriticalSectionAndSpinCount(&entry->lock, 4000))
+	{
+		free(entry);
+		return NULL;
+	}
+
+	entry->refCount = 1;
+	entry->key = *key;
+	entry->rects = calloc(key->numRects, sizeof(RECTANGLE_16));
+
+	if (!entry->rects)
+	{
+		shadow_frame_cache_entry_unref(entry);
+		return NULL;
+	}
+
+	memcpy(entry->rects, key->rects, sizeof(RECTANGLE_16) * key->numRects);
+	entry->key.rects = entry->rects;
+	return entry;
+}
+
+static BOOL shadow_frame_cache_key_equal(const SHADOW_FRAME_CACHE_KEY* a,
+                                         const SHADOW_FRAME_CACHE_KEY* b)
+{
+	if ((a->codecId != b->codecId) || (a->flags != b->flags) || (a->format != b->format) ||
+	    (a->width != b->width) || (a->height != b->height) || (a->numRects != b->numRects))
+		return FALSE;
+
+	return memcmp(a->rects, b->rects, sizeof(RECTANGLE_16) * a->numRects) == 0;
+}
+
+rdpShadowFrameCache* shadow_frame_cache_new(void)
+{
+	rdpShadowFrameCache* cache = (rdpShadowFrameCache*)calloc(1, sizeof(rdpShadowFrameCache));
+
+	if (!cache)
+		return NULL;
+
+	if (!InitializeCriticalSectionAndSpinCount(&cache->lock, 4000))
+	{
+		free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void shadow_frame_cache_free(rdpShadowFrameCache* cache)
+{
+	if (!cache)
+		return;
+
+	shadow_frame_cache_invalidate(cache);
+	DeleteCriticalSection(&cache->lock);
+	free(cache);
+}
+
+void shadow_frame_cache_invalidate(rdpShadowFrameCache* cache)
+{
+	if (!cache)
+		return;
+
+	EnterCriticalSection(&cache->lock);
+
+	/* Entries still used by a client are freed on release */
+	for (size_t x = 0; x < cache->count; x++)
+	{
+		shadow_frame_cache_entry_unref(cache->entries[x]);
+		cache->entries[x] = NULL;
+	}
+
+	cache->count = 0;
+	LeaveCriticalSection(&cache->lock);
+}
+
+rdpShadowFrameCacheEntry* shadow_frame_cache_acquire(rdpShadowFrameCache* cache,
+                                                     const SHADOW_FRAME_CACHE_KEY* key)
+{
+	rdpShadowFrameCacheEntry* entry = NULL;
+
+	if (!cache || !key || !key->rects || (key->numRects == 0))
+		return NULL;
+
+	EnterCriticalSection(&cache->lock);
+
+	for (size_t x = 0; x < cache->count; x++)
+	{
+		if (shadow_frame_cache_key_equal(&cache->entries[x]->key, key))
+		{
+			entry = cache->entries[x];
+			InterlockedIncrement(&entry->refCount);
+			break;
+		}
+	}
+
+	if (!entry)
+	{
+		if (cache->count >= ARRAYSIZE(cache->entries))
+		{
+			LeaveCriticalSection(&cache->lock);
+			return NULL;
+		}
+
+		entry = shadow_frame_cache_entry_new(key);
+
+		if (!entry)
+		{
+			LeaveCriticalSection(&cache->lock);
+			return NULL;
+		}
+
+		/* The creator encodes, lock before others can see the entry */
+		EnterCriticalSection(&entry->lock);
+		InterlockedIncrement(&entry->refCount);
+		cache->entries[cache->count++] = entry;
+		LeaveCriticalSection(&cache->lock);
+		return entry;
+	}
+
+	LeaveCriticalSection(&cache->lock);
+
+	/* Wait for the client encoding this entry */
+	EnterCriticalSection(&entry->lock);
+
+	if (entry->data)
+		LeaveCriticalSection(&entry->lock);
+
+	/* Otherwise the encoding client failed, the caller encodes with the lock held */
+	return entry;
+}
+
+void shadow_frame_cache_release(rdpShadowFrameCacheEntry* entry)
+{
+	if (!entry)
+		return;
+
+	/* The lock is only held by a caller that did not store any data */
+	if (!entry->data)
+		LeaveCriticalSection(&entry->lock);
+
+	shadow_frame_cache_entry_unref(entry);
+}
+
+BOOL shadow_frame_cache_entry_get(const rdpShadowFrameCacheEntry* entry, BYTE** ppData,
+                                  UINT32* pLength)
+{
+	WINPR_ASSERT(ppData);
+	WINPR_ASSERT(pLength);
+
+	if (!entry || !entry->data)
+		return FALSE;
+
+	*ppData = entry->data;
+	*pLength = entry->length;
+	return TRUE;
+}
+
+BOOL shadow_frame_cache_entry_set(rdpShadowFrameCacheEntry* entry, const BYTE* data,
+                                  UINT32 length)
+{
+	if (!entry || entry->data || !data || (length == 0))
+		return FALSE;
+
+	BYTE* copy = malloc(length);
+
+	if (!copy)
+		return FALSE;
+
+	memcpy(copy, data, length);
+	entry->length = length;
+	entry->data = copy;
+	LeaveCriticalSection(&entry->lock);
+	return TRUE;
+}
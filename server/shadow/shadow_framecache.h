@@ -0,0 +1,75 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_FRAMECACHE_H
+#define FREERDP_SERVER_SHADOW_FRAMECACHE_H
+
+#include <freerdp/server/shadow.h>
+#include <freerdp/codec/region.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+
+/*
+ * Encoded frame cache shared by all clients of a surface.
+ *
+ * Clients using the same codec configuration for the same region of the same surface
+ * update produce identical data, so the first client encodes and stores the result while the
+ * others reuse it. Entries are dropped whenever the surface content changes.
+ *
+ * A client that is not the first one waits in shadow_frame_cache_acquire until the
+ * encoding client stored (or gave up on) the entry.
+ */
+
+typedef struct rdp_shadow_frame_cache_entry rdpShadowFrameCacheEntry;
+
+typedef struct
+{
+	UINT32 codecId;
+	UINT32 flags; /* codec specific options that change the encoded data */
+	UINT32 format;
+	UINT32 width;
+	UINT32 height;
+	const RECTANGLE_16* rects;
+	UINT32 numRects;
+} SHADOW_FRAME_CACHE_KEY;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	void shadow_frame_cache_free(rdpShadowFrameCache* cache);
+
+	WINPR_ATTR_MALLOC(shadow_frame_cache_free, 1)
+	rdpShadowFrameCache* shadow_frame_cache_new(void);
+
+	void shadow_frame_cache_invalidate(rdpShadowFrameCache* cache);
+
+	rdpShadowFrameCacheEntry* shadow_frame_cache_acquire(rdpShadowFrameCache* cache,
+	                                                     const SHADOW_FRAME_CACHE_KEY* key);
+	void shadow_frame_cache_release(rdpShadowFrameCacheEntry* entry);
+
+	BOOL shadow_frame_cache_entry_get(const rdpShadowFrameCacheEntry* entry, BYTE** ppData,
+	                                  UINT32* pLength);
+	BOOL shadow_frame_cache_entry_set(rdpShadowFrameCacheEntry* entry, const BYTE* data,
+	                                  UINT32 length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_SERVER_SHADOW_FRAMECACHE_H */
@@ -79,6 +79,7 @@ BOOL shadow_client_init_lobby(rdpShadowServer* server)
 	rdtk_surface_free(surface);
 
 	region16_union_rect(&(lobby->invalidRegion), &(lobby->invalidRegion), &invalidRect);
+	shadow_frame_cache_invalidate(lobby->cache);
 
 	rc = TRUE;
 fail:
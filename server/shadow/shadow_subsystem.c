@@ -290,5 +290,12 @@ int shadow_subsystem_pointer_convert_alpha_pointer_data_to_format(
 
 void shadow_subsystem_frame_update(rdpShadowSubsystem* subsystem)
 {
+	WINPR_ASSERT(subsystem);
+	WINPR_ASSERT(subsystem->server);
+
+	/* Encoded data of the previous update must not be reused */
+	if (subsystem->server->surface)
+		shadow_frame_cache_invalidate(subsystem->server->surface->cache);
+
 	shadow_multiclient_publish_and_wait(subsystem->updateEvent);
 }
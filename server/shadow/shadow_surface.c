@@ -55,6 +55,16 @@ rdpShadowSurface* shadow_surface_new(rdpShadowServer* server, UINT16 x, UINT16 y
 		return NULL;
 	}
 
+	surface->cache = shadow_frame_cache_new();
+
+	if (!surface->cache)
+	{
+		DeleteCriticalSection(&(surface->lock));
+		free(surface->data);
+		free(surface);
+		return NULL;
+	}
+
 	region16_init(&(surface->invalidRegion));
 	return surface;
 }
@@ -65,6 +75,7 @@ void shadow_surface_free(rdpShadowSurface* surface)
 		return;
 
 	free(surface->data);
+	shadow_frame_cache_free(surface->cache);
 	DeleteCriticalSection(&(surface->lock));
 	region16_uninit(&(surface->invalidRegion));
 	free(surface);
@@ -79,6 +90,8 @@ BOOL shadow_surface_resize(rdpShadowSurface* surface, UINT16 x, UINT16 y, UINT32
 	if (!surface)
 		return FALSE;
 
+	shadow_frame_cache_invalidate(surface->cache);
+
 	if ((width == surface->width) && (height == surface->height))
 	{
 		/* We don't need to reset frame buffer, just update left top */
@@ -455,6 +455,124 @@ extern "C"
 
 	WINPR_API void* GetEventWaitObject(HANDLE hEvent);
 
+	/** @brief A set of handles that is waited for many times
+	 *
+	 *  Unlike \b WaitForMultipleObjects the handles are registered once (with epoll where
+	 *  available), so a wait does not need to hand all descriptors to the kernel again. A handle
+	 *  must be removed from all sets before it is closed.
+	 *
+	 *  @since version 3.17.0
+	 */
+	typedef struct winpr_wait_set WINPR_WAIT_SET;
+
+	/** @brief Free a wait set, the handles in it are not closed
+	 *
+	 *  @param set The set to free, may be \b NULL
+	 *  @since version 3.17.0
+	 */
+	WINPR_API void WaitSet_Free(WINPR_WAIT_SET* set);
+
+	/** @brief Create an empty wait set
+	 *
+	 *  @return A new wait set or \b NULL on failure
+	 *  @since version 3.17.0
+	 */
+	WINPR_ATTR_MALLOC(WaitSet_Free, 1)
+	WINPR_API WINPR_WAIT_SET* WaitSet_New(void);
+
+	/** @brief Add a handle to a wait set
+	 *
+	 *  The index of a handle is its position among the handles added. On Windows a set holds up
+	 *  to \b MAXIMUM_WAIT_OBJECTS handles, elsewhere it grows as required.
+	 *
+	 *  @param set The set to modify
+	 *  @param handle The handle to add
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	WINPR_API BOOL WaitSet_Add(WINPR_WAIT_SET* set, HANDLE handle);
+
+	/** @brief Add a handle with a context to a wait set
+	 *
+	 *  Same as \b WaitSet_Add, the context is reported by \b WaitSet_WaitEx when the handle is
+	 *  signaled.
+	 *
+	 *  @param set The set to modify
+	 *  @param handle The handle to add
+	 *  @param context An opaque pointer identifying the owner of the handle, may be \b NULL
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	WINPR_API BOOL WaitSet_AddEx(WINPR_WAIT_SET* set, HANDLE handle, void* context);
+
+	/** @brief Remove a handle from a wait set, the indices of the handles after it move down
+	 *
+	 *  @param set The set to modify
+	 *  @param handle The handle to remove
+	 *
+	 *  @return \b TRUE for success, \b FALSE if the handle is not in the set
+	 *  @since version 3.17.0
+	 */
+	WINPR_API BOOL WaitSet_Remove(WINPR_WAIT_SET* set, HANDLE handle);
+
+	/** @brief Replace the handles of a context in a wait set
+	 *
+	 *  Handles of the context that are not in \b handles are removed, the missing ones are
+	 *  added. Handles that stay keep their registration, so a loop whose handles change now
+	 *  and then can call this before every wait.
+	 *
+	 *  @param set The set to modify
+	 *  @param handles The handles the context waits for
+	 *  @param count The number of handles, \b 0 removes all handles of the context
+	 *  @param context The context the handles were added with
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.17.0
+	 */
+	WINPR_API BOOL WaitSet_SetHandles(WINPR_WAIT_SET* set, const HANDLE* handles, size_t count,
+	                                  void* context);
+
+	/** @brief Get the number of handles in a wait set
+	 *
+	 *  @param set The set to query
+	 *
+	 *  @return The number of handles
+	 *  @since version 3.17.0
+	 */
+	WINPR_API size_t WaitSet_Count(const WINPR_WAIT_SET* set);
+
+	/** @brief Wait until one of the handles in the set is signaled
+	 *
+	 *  @param set The set to wait for
+	 *  @param dwMilliseconds The timeout in milliseconds or \b INFINITE
+	 *
+	 *  @return \b WAIT_OBJECT_0 plus the lowest index of the signaled handles, \b WAIT_TIMEOUT
+	 *  or \b WAIT_FAILED, same as \b WaitForMultipleObjects without \b bWaitAll
+	 *  @since version 3.17.0
+	 */
+	WINPR_API DWORD WaitSet_Wait(WINPR_WAIT_SET* set, DWORD dwMilliseconds);
+
+	/** @brief Wait until one or more handles in the set are signaled
+	 *
+	 *  Reports the contexts of all signaled handles, once per handle. Unlike \b WaitSet_Wait the
+	 *  handles are not reset, auto reset objects like timers must be waited for by the caller.
+	 *  Handles that do not fit in \b contexts stay signaled for the next wait. On Windows a
+	 *  single context is reported per wait.
+	 *
+	 *  @param set The set to wait for
+	 *  @param dwMilliseconds The timeout in milliseconds or \b INFINITE
+	 *  @param contexts An array receiving the contexts of the signaled handles
+	 *  @param count The size of \b contexts, receives the number of contexts stored
+	 *
+	 *  @return \b WAIT_OBJECT_0 if at least one handle is signaled, \b WAIT_TIMEOUT or
+	 *  \b WAIT_FAILED
+	 *  @since version 3.17.0
+	 */
+	WINPR_API DWORD WaitSet_WaitEx(WINPR_WAIT_SET* set, DWORD dwMilliseconds, void** contexts,
+	                               size_t* count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,285 @@
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/handle.h>
+#include <winpr/sysinfo.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define TEST_EVENTS 4
+
+static BOOL test_wait(WINPR_WAIT_SET* set, DWORD timeout, DWORD expected, const char* what)
+{
+	const DWORD status = WaitSet_Wait(set, timeout);
+	if (status != expected)
+	{
+		printf("%s: WaitSet_Wait returned 0x%08" PRIx32 ", expected 0x%08" PRIx32 "\n", what,
+		       status, expected);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL test_events(WINPR_WAIT_SET* set, HANDLE* events)
+{
+	if (!test_wait(set, 0, WAIT_TIMEOUT, "idle"))
+		return FALSE;
+
+	/* the lowest signaled index wins, manual reset events stay signaled */
+	if (!SetEvent(events[2]) || !test_wait(set, INFINITE, WAIT_OBJECT_0 + 2, "single") ||
+	    !test_wait(set, 0, WAIT_OBJECT_0 + 2, "manual reset"))
+		return FALSE;
+
+	if (!SetEvent(events[1]) || !test_wait(set, 0, WAIT_OBJECT_0 + 1, "lowest"))
+		return FALSE;
+
+	if (!ResetEvent(events[1]) || !ResetEvent(events[2]))
+		return FALSE;
+
+	if (!SetEvent(events[3]) || !test_wait(set, 0, WAIT_OBJECT_0 + 3, "last") ||
+	    !ResetEvent(events[3]))
+		return FALSE;
+
+	/* removing moves the following handles down */
+	if (!WaitSet_Remove(set, events[1]) || (WaitSet_Count(set) != TEST_EVENTS - 1))
+		return FALSE;
+
+	if (!SetEvent(events[2]) || !test_wait(set, 0, WAIT_OBJECT_0 + 1, "removed"))
+		return FALSE;
+
+	if (!ResetEvent(events[2]) || WaitSet_Remove(set, events[1]))
+		return FALSE;
+
+	/* a handle in the set twice, removing one keeps the other registered */
+	if (!WaitSet_Add(set, events[0]) || !WaitSet_Remove(set, events[0]))
+		return FALSE;
+
+	if (!SetEvent(events[0]) || !test_wait(set, 0, WAIT_OBJECT_0 + 2, "duplicate"))
+		return FALSE;
+
+	return ResetEvent(events[0]);
+}
+
+static BOOL test_timer(WINPR_WAIT_SET* set)
+{
+	BOOL rc = FALSE;
+	LARGE_INTEGER due = { 0 };
+	HANDLE timer = CreateWaitableTimerA(NULL, FALSE, NULL);
+
+	due.QuadPart = -200000LL; /* 20ms */
+	if (!timer || !SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+		goto fail;
+
+	if (!WaitSet_Add(set, timer))
+		goto fail;
+
+	const UINT64 start = GetTickCount64();
+	if (!test_wait(set, 5000, WAIT_OBJECT_0 + (DWORD)WaitSet_Count(set) - 1, "timer"))
+		goto fail;
+
+	if (GetTickCount64() - start < 10)
+	{
+		printf("timer signaled too early\n");
+		goto fail;
+	}
+
+	/* the expiration is consumed by the wait */
+	if (!test_wait(set, 0, WAIT_TIMEOUT, "timer consumed"))
+		goto fail;
+
+	rc = WaitSet_Remove(set, timer);
+fail:
+	if (timer)
+		(void)CloseHandle(timer);
+	return rc;
+}
+
+#ifndef _WIN32
+#define TEST_CONTEXT_EVENTS 60
+
+static BOOL test_wait_ex(WINPR_WAIT_SET* set, DWORD expected, size_t count, const void* c1,
+                         const void* c2, const char* what)
+{
+	void* contexts[4] = { 0 };
+	size_t ncontexts = ARRAYSIZE(contexts);
+
+	const DWORD status = WaitSet_WaitEx(set, 0, contexts, &ncontexts);
+	if ((status != expected) || (ncontexts != count))
+	{
+		printf("%s: WaitSet_WaitEx returned 0x%08" PRIx32 " with %" PRIuz " contexts\n", what,
+		       status, ncontexts);
+		return FALSE;
+	}
+
+	for (size_t x = 0; x < ncontexts; x++)
+	{
+		if ((contexts[x] != c1) && (contexts[x] != c2))
+		{
+			printf("%s: unexpected context %p\n", what, contexts[x]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* sets beyond MAXIMUM_WAIT_OBJECTS with handles owned by different contexts */
+static BOOL test_contexts(void)
+{
+	BOOL rc = FALSE;
+	int a = 0;
+	int b = 0;
+	HANDLE ea[TEST_CONTEXT_EVENTS] = { 0 };
+	HANDLE eb[TEST_CONTEXT_EVENTS] = { 0 };
+	WINPR_WAIT_SET* set = WaitSet_New();
+
+	if (!set)
+		return FALSE;
+
+	for (size_t x = 0; x < TEST_CONTEXT_EVENTS; x++)
+	{
+		ea[x] = CreateEventA(NULL, TRUE, FALSE, NULL);
+		eb[x] = CreateEventA(NULL, TRUE, FALSE, NULL);
+		if (!ea[x] || !eb[x])
+			goto fail;
+	}
+
+	if (!WaitSet_SetHandles(set, ea, ARRAYSIZE(ea), &a) ||
+	    !WaitSet_SetHandles(set, eb, ARRAYSIZE(eb), &b) ||
+	    !WaitSet_SetHandles(set, ea, ARRAYSIZE(ea), &a) ||
+	    (WaitSet_Count(set) != 2 * TEST_CONTEXT_EVENTS))
+		goto fail;
+
+	if (!test_wait_ex(set, WAIT_TIMEOUT, 0, NULL, NULL, "contexts idle"))
+		goto fail;
+
+	if (!SetEvent(ea[TEST_CONTEXT_EVENTS - 1]) || !SetEvent(eb[0]) ||
+	    !test_wait_ex(set, WAIT_OBJECT_0, 2, &a, &b, "both contexts"))
+		goto fail;
+
+	/* the handles removed from a context are no longer waited for */
+	if (!WaitSet_SetHandles(set, ea, TEST_CONTEXT_EVENTS / 2, &a) ||
+	    (WaitSet_Count(set) != TEST_CONTEXT_EVENTS + TEST_CONTEXT_EVENTS / 2) ||
+	    !test_wait_ex(set, WAIT_OBJECT_0, 1, &b, &b, "shrunk context"))
+		goto fail;
+
+	if (!WaitSet_SetHandles(set, NULL, 0, &b) ||
+	    (WaitSet_Count(set) != TEST_CONTEXT_EVENTS / 2) ||
+	    !test_wait_ex(set, WAIT_TIMEOUT, 0, NULL, NULL, "removed context"))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	WaitSet_Free(set);
+	for (size_t x = 0; x < TEST_CONTEXT_EVENTS; x++)
+	{
+		if (ea[x])
+			(void)CloseHandle(ea[x]);
+		if (eb[x])
+			(void)CloseHandle(eb[x]);
+	}
+	return rc;
+}
+
+/* the descriptor behind an event might change while it is in the set */
+static BOOL test_descriptor(WINPR_WAIT_SET* set)
+{
+	BOOL rc = FALSE;
+	int fds[2][2] = { { -1, -1 }, { -1, -1 } };
+	HANDLE event = NULL;
+	const char c = 0;
+
+	if ((pipe(fds[0]) != 0) || (pipe(fds[1]) != 0))
+		goto fail;
+
+	event = CreateFileDescriptorEventA(NULL, TRUE, FALSE, fds[0][0], WINPR_FD_READ);
+	if (!event || !WaitSet_Add(set, event))
+		goto fail;
+
+	const DWORD index = WAIT_OBJECT_0 + (DWORD)WaitSet_Count(set) - 1;
+	if (!test_wait(set, 0, WAIT_TIMEOUT, "pipe idle"))
+		goto fail;
+
+	if ((write(fds[0][1], &c, 1) != 1) || !test_wait(set, 1000, index, "pipe"))
+		goto fail;
+
+	if ((SetEventFileDescriptor(event, fds[1][0], WINPR_FD_READ) != 0) ||
+	    !test_wait(set, 0, WAIT_TIMEOUT, "new pipe idle"))
+		goto fail;
+
+	if ((write(fds[1][1], &c, 1) != 1) || !test_wait(set, 1000, index, "new pipe"))
+		goto fail;
+
+	rc = WaitSet_Remove(set, event);
+fail:
+	if (event)
+		(void)CloseHandle(event);
+	for (size_t x = 0; x < 2; x++)
+	{
+		for (size_t y = 0; y < 2; y++)
+		{
+			if (fds[x][y] >= 0)
+				close(fds[x][y]);
+		}
+	}
+	return rc;
+}
+#endif
+
+int TestSynchWaitSet(int argc, char* argv[])
+{
+	int rc = -1;
+	HANDLE events[TEST_EVENTS] = { 0 };
+	WINPR_WAIT_SET* set = WaitSet_New();
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!set)
+		goto fail;
+
+	if (WaitSet_Wait(set, 0) != WAIT_FAILED)
+	{
+		printf("WaitSet_Wait on an empty set unexpectedly succeeded\n");
+		goto fail;
+	}
+
+	for (size_t x = 0; x < TEST_EVENTS; x++)
+	{
+		events[x] = CreateEventA(NULL, TRUE, FALSE, NULL);
+		if (!events[x] || !WaitSet_Add(set, events[x]))
+			goto fail;
+	}
+
+	if (!test_events(set, events))
+		goto fail;
+
+	if (!test_timer(set))
+		goto fail;
+
+#ifndef _WIN32
+	if (!test_descriptor(set))
+		goto fail;
+
+	if (!test_contexts())
+		goto fail;
+#endif
+
+	/* the stateless API must agree with the set */
+	if (!SetEvent(events[3]) ||
+	    (WaitForMultipleObjects(TEST_EVENTS, events, FALSE, 0) != WAIT_OBJECT_0 + 3))
+		goto fail;
+
+	rc = 0;
+fail:
+	if (rc != 0)
+		printf("TestSynchWaitSet failed\n");
+	WaitSet_Free(set);
+	for (size_t x = 0; x < TEST_EVENTS; x++)
+	{
+		if (events[x])
+			(void)CloseHandle(events[x]);
+	}
+	return rc;
+}
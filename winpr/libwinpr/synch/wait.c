@@ -34,6 +34,7 @@
 
 #include "synch.h"
 #include "pollset.h"
+#include "waitset.h"
 #include "../thread/thread.h"
 #include <winpr/thread.h>
 #include <winpr/debug.h>
@@ -341,6 +342,28 @@ DWORD WaitForMultipleObjectsEx(DWORD nCount, const HANDLE* lpHandles, BOOL bWait
 		}
 	}
 
+	/* the common case is a wait set that lives for this call only */
+	if (!bWaitAll && !bAlertable)
+	{
+		WINPR_WAIT_SET set;
+
+		waitset_init(&set);
+		for (DWORD idx = 0; idx < nCount; idx++)
+		{
+			if (!waitset_add(&set, lpHandles[idx]))
+			{
+				WLog_ERR(TAG, "invalid handle at %" PRIu32, idx);
+				winpr_log_backtrace(TAG, WLOG_ERROR, 20);
+				waitset_uninit(&set);
+				return WAIT_FAILED;
+			}
+		}
+
+		ret = waitset_wait(&set, dwMilliseconds);
+		waitset_uninit(&set);
+		return ret;
+	}
+
 	if (!pollset_init(&pollset, nCount + extraFds))
 	{
 		WLog_ERR(TAG, "unable to initialize pollset for nCount=%" PRIu32 " extraCount=%" PRIu32 "",
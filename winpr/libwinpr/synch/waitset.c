@@ -0,0 +1,711 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * Persistent wait sets
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <errno.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include "../log.h"
+#define TAG WINPR_TAG("sync.waitset")
+
+#ifndef _WIN32
+
+#ifdef WINPR_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#endif
+
+#include "waitset.h"
+#include "pollset.h"
+#include "../handle/handle.h"
+
+/* epoll reports at most this many descriptors per wait, the others stay ready */
+#define WAITSET_MAX_EVENTS 256
+
+static BOOL waitset_get_fd(HANDLE handle, int* pfd, ULONG* pmode)
+{
+	ULONG Type = 0;
+	WINPR_HANDLE* Object = NULL;
+
+	WINPR_ASSERT(pfd);
+	WINPR_ASSERT(pmode);
+
+	if (!winpr_Handle_GetInfo(handle, &Type, &Object))
+		return FALSE;
+
+	const int fd = winpr_Handle_getFd(Object);
+	if (fd < 0)
+		return FALSE;
+
+	*pfd = fd;
+	*pmode = Object->Mode & (WINPR_FD_READ | WINPR_FD_WRITE);
+	return TRUE;
+}
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+/* Several handles might share a descriptor, epoll only accepts it once */
+static ULONG waitset_fd_mode(const WINPR_WAIT_SET* set, int fd)
+{
+	ULONG mode = 0;
+
+	for (size_t x = 0; x < set->count; x++)
+	{
+		if (set->entries[x].fd == fd)
+			mode |= set->entries[x].mode;
+	}
+	return mode;
+}
+
+static BOOL waitset_epoll_update(WINPR_WAIT_SET* set, int fd, ULONG before, ULONG after)
+{
+	struct epoll_event event = { 0 };
+	int op = EPOLL_CTL_MOD;
+
+	if (before == after)
+		return TRUE;
+
+	if (before == 0)
+		op = EPOLL_CTL_ADD;
+	else if (after == 0)
+		op = EPOLL_CTL_DEL;
+
+	if (after & WINPR_FD_READ)
+		event.events |= EPOLLIN;
+	if (after & WINPR_FD_WRITE)
+		event.events |= EPOLLOUT;
+	event.data.fd = fd;
+
+	if (epoll_ctl(set->epfd, op, fd, &event) == 0)
+		return TRUE;
+
+	/* closing a descriptor removes it from the set, the number might be in use again */
+	if ((op == EPOLL_CTL_DEL) && ((errno == EBADF) || (errno == ENOENT)))
+		return TRUE;
+	if ((op == EPOLL_CTL_MOD) && (errno == ENOENT) &&
+	    (epoll_ctl(set->epfd, EPOLL_CTL_ADD, fd, &event) == 0))
+		return TRUE;
+	if ((op == EPOLL_CTL_ADD) && (errno == EEXIST) &&
+	    (epoll_ctl(set->epfd, EPOLL_CTL_MOD, fd, &event) == 0))
+		return TRUE;
+
+	char ebuffer[256] = { 0 };
+	WLog_ERR(TAG, "epoll_ctl(%d) fd %d failure [%d] %s", op, fd, errno,
+	         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+	return FALSE;
+}
+
+typedef struct
+{
+	int fd;
+	ULONG ready;
+} WINPR_WAIT_READY;
+
+static int waitset_compare_ready(const void* pv1, const void* pv2)
+{
+	const WINPR_WAIT_READY* r1 = pv1;
+	const WINPR_WAIT_READY* r2 = pv2;
+
+	if (r1->fd < r2->fd)
+		return -1;
+	return (r1->fd > r2->fd) ? 1 : 0;
+}
+
+static int waitset_poll_epoll(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	struct epoll_event events[WAITSET_MAX_EVENTS] = { 0 };
+	WINPR_WAIT_READY ready[WAITSET_MAX_EVENTS] = { 0 };
+	int timeout = -1;
+
+	if (dwMilliseconds != INFINITE)
+		timeout = (dwMilliseconds > INT32_MAX) ? INT32_MAX : (int)dwMilliseconds;
+
+	const int status = epoll_wait(set->epfd, events, ARRAYSIZE(events), timeout);
+	if (status < 0)
+		return (errno == EINTR) ? 0 : -1;
+
+	for (int x = 0; x < status; x++)
+	{
+		ready[x].fd = events[x].data.fd;
+		if (events[x].events & EPOLLIN)
+			ready[x].ready |= WINPR_FD_READ;
+		if (events[x].events & EPOLLOUT)
+			ready[x].ready |= WINPR_FD_WRITE;
+		if (events[x].events & (EPOLLERR | EPOLLHUP))
+			ready[x].ready |= WINPR_FD_READ | WINPR_FD_WRITE;
+	}
+
+	/* large sets are matched against the few ready descriptors by a binary search */
+	qsort(ready, (size_t)status, sizeof(WINPR_WAIT_READY), waitset_compare_ready);
+	for (size_t y = 0; (status > 0) && (y < set->count); y++)
+	{
+		WINPR_WAIT_ENTRY* entry = &set->entries[y];
+		const WINPR_WAIT_READY key = { entry->fd, 0 };
+		const WINPR_WAIT_READY* cur =
+		    bsearch(&key, ready, (size_t)status, sizeof(WINPR_WAIT_READY), waitset_compare_ready);
+
+		if (cur && (entry->mode & cur->ready))
+			entry->signaled = TRUE;
+	}
+
+	return status;
+}
+#endif
+
+static int waitset_poll_all(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	WINPR_POLL_SET pollset = { 0 };
+	int status = -1;
+
+	if (!pollset_init(&pollset, set->count))
+		return -1;
+
+	for (size_t x = 0; x < set->count; x++)
+	{
+		if (!pollset_add(&pollset, set->entries[x].fd, set->entries[x].mode))
+			goto out;
+	}
+
+	status = pollset_poll(&pollset, dwMilliseconds);
+	for (size_t x = 0; (status > 0) && (x < set->count); x++)
+		set->entries[x].signaled = pollset_isSignaled(&pollset, x);
+
+out:
+	pollset_uninit(&pollset);
+	return status;
+}
+
+/* Sockets change their mode with WSAEventSelect and events might be attached to another
+ * descriptor, so the registration is checked before every wait. */
+static BOOL waitset_sync(WINPR_WAIT_SET* set)
+{
+	for (size_t x = 0; x < set->count; x++)
+	{
+		WINPR_WAIT_ENTRY* entry = &set->entries[x];
+		int fd = -1;
+		ULONG mode = 0;
+
+		if (!waitset_get_fd(entry->handle, &fd, &mode))
+		{
+			WLog_ERR(TAG, "invalid handle at %" PRIuz, x);
+			SetLastError(ERROR_INVALID_HANDLE);
+			return FALSE;
+		}
+
+		if ((entry->fd == fd) && (entry->mode == mode))
+			continue;
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+		if (set->epfd >= 0)
+		{
+			const int oldFd = entry->fd;
+			const ULONG oldBefore = waitset_fd_mode(set, oldFd);
+			const ULONG newBefore = (oldFd == fd) ? oldBefore : waitset_fd_mode(set, fd);
+
+			entry->fd = fd;
+			entry->mode = mode;
+
+			if ((oldFd != fd) &&
+			    !waitset_epoll_update(set, oldFd, oldBefore, waitset_fd_mode(set, oldFd)))
+				return FALSE;
+			if (!waitset_epoll_update(set, fd, newBefore, waitset_fd_mode(set, fd)))
+				return FALSE;
+			continue;
+		}
+#endif
+		entry->fd = fd;
+		entry->mode = mode;
+	}
+
+	return TRUE;
+}
+
+void waitset_init(WINPR_WAIT_SET* set)
+{
+	WINPR_ASSERT(set);
+
+	set->entries = set->staticEntries;
+	set->capacity = ARRAYSIZE(set->staticEntries);
+	set->count = 0;
+	set->epfd = -1;
+}
+
+void waitset_uninit(WINPR_WAIT_SET* set)
+{
+	WINPR_ASSERT(set);
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+	if (set->epfd >= 0)
+		close(set->epfd);
+#endif
+	if (set->entries != set->staticEntries)
+		free(set->entries);
+	set->entries = set->staticEntries;
+	set->capacity = ARRAYSIZE(set->staticEntries);
+	set->epfd = -1;
+	set->count = 0;
+}
+
+static BOOL waitset_ensure_capacity(WINPR_WAIT_SET* set)
+{
+	WINPR_ASSERT(set);
+
+	if (set->count < set->capacity)
+		return TRUE;
+
+	const size_t capacity = set->capacity * 2;
+	WINPR_WAIT_ENTRY* entries = NULL;
+	if (set->entries == set->staticEntries)
+	{
+		entries = calloc(capacity, sizeof(WINPR_WAIT_ENTRY));
+		if (entries)
+			memcpy(entries, set->staticEntries, sizeof(WINPR_WAIT_ENTRY) * set->count);
+	}
+	else
+		entries = realloc(set->entries, sizeof(WINPR_WAIT_ENTRY) * capacity);
+
+	if (!entries)
+	{
+		WLog_ERR(TAG, "failed to grow wait set to %" PRIuz " handles", capacity);
+		SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return FALSE;
+	}
+
+	set->entries = entries;
+	set->capacity = capacity;
+	return TRUE;
+}
+
+BOOL waitset_add(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	return waitset_add_ex(set, handle, NULL);
+}
+
+BOOL waitset_add_ex(WINPR_WAIT_SET* set, HANDLE handle, void* context)
+{
+	WINPR_ASSERT(set);
+
+	if (!waitset_ensure_capacity(set))
+		return FALSE;
+
+	WINPR_WAIT_ENTRY* entry = &set->entries[set->count];
+	if (!waitset_get_fd(handle, &entry->fd, &entry->mode))
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+
+	entry->handle = handle;
+	entry->context = context;
+	entry->signaled = FALSE;
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+	if (set->epfd >= 0)
+	{
+		const ULONG before = waitset_fd_mode(set, entry->fd);
+		if (!waitset_epoll_update(set, entry->fd, before, before | entry->mode))
+			return FALSE;
+	}
+#endif
+
+	set->count++;
+	return TRUE;
+}
+
+/* Waits until at least one handle is signaled, the signaled entries are flagged */
+static DWORD waitset_poll(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	WINPR_ASSERT(set);
+
+	if (set->count == 0)
+	{
+		WLog_ERR(TAG, "empty wait set");
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return WAIT_FAILED;
+	}
+
+	if (!waitset_sync(set))
+		return WAIT_FAILED;
+
+	UINT64 now = GetTickCount64();
+	const UINT64 dueTime = (dwMilliseconds == INFINITE) ? UINT64_MAX : now + dwMilliseconds;
+
+	do
+	{
+		const DWORD waitTime = (dwMilliseconds == INFINITE) ? INFINITE : (DWORD)(dueTime - now);
+		int status = 0;
+
+		for (size_t x = 0; x < set->count; x++)
+			set->entries[x].signaled = FALSE;
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+		if (set->epfd >= 0)
+			status = waitset_poll_epoll(set, waitTime);
+		else
+#endif
+			status = waitset_poll_all(set, waitTime);
+
+		if (status < 0)
+		{
+			char ebuffer[256] = { 0 };
+			WLog_ERR(TAG, "waiting for %" PRIuz " handles failed [%d] %s", set->count, errno,
+			         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+			SetLastError(ERROR_INTERNAL_ERROR);
+			return WAIT_FAILED;
+		}
+
+		for (size_t x = 0; (status > 0) && (x < set->count); x++)
+		{
+			if (set->entries[x].signaled)
+				return WAIT_OBJECT_0;
+		}
+
+		now = GetTickCount64();
+	} while (now < dueTime);
+
+	return WAIT_TIMEOUT;
+}
+
+DWORD waitset_wait(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	const DWORD status = waitset_poll(set, dwMilliseconds);
+	if (status != WAIT_OBJECT_0)
+		return status;
+
+	/* like WaitForMultipleObjects the lowest index wins */
+	for (size_t x = 0; x < set->count; x++)
+	{
+		if (!set->entries[x].signaled)
+			continue;
+
+		const DWORD rc = winpr_Handle_cleanup(set->entries[x].handle);
+		if (rc != WAIT_OBJECT_0)
+		{
+			WLog_ERR(TAG, "error in cleanup function for handle at index=%" PRIuz, x);
+			return rc;
+		}
+		return (DWORD)(WAIT_OBJECT_0 + x);
+	}
+
+	return WAIT_TIMEOUT;
+}
+
+WINPR_WAIT_SET* WaitSet_New(void)
+{
+	WINPR_WAIT_SET* set = calloc(1, sizeof(WINPR_WAIT_SET));
+	if (!set)
+		return NULL;
+
+	waitset_init(set);
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+	set->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (set->epfd < 0)
+	{
+		char ebuffer[256] = { 0 };
+		WLog_ERR(TAG, "epoll_create1 failure [%d] %s", errno,
+		         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+		free(set);
+		return NULL;
+	}
+#endif
+	return set;
+}
+
+void WaitSet_Free(WINPR_WAIT_SET* set)
+{
+	if (!set)
+		return;
+
+	waitset_uninit(set);
+	free(set);
+}
+
+BOOL WaitSet_Add(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	if (!set)
+		return FALSE;
+
+	return waitset_add(set, handle);
+}
+
+BOOL WaitSet_AddEx(WINPR_WAIT_SET* set, HANDLE handle, void* context)
+{
+	if (!set)
+		return FALSE;
+
+	return waitset_add_ex(set, handle, context);
+}
+
+static BOOL waitset_remove_at(WINPR_WAIT_SET* set, size_t index)
+{
+	WINPR_ASSERT(set);
+	WINPR_ASSERT(index < set->count);
+
+	WINPR_WAIT_ENTRY* entry = &set->entries[index];
+	const int fd = entry->fd;
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+	const ULONG before = waitset_fd_mode(set, fd);
+#endif
+
+	memmove(entry, &entry[1], sizeof(WINPR_WAIT_ENTRY) * (set->count - index - 1));
+	set->count--;
+
+#if defined(WINPR_HAVE_SYS_EPOLL_H)
+	if (set->epfd >= 0)
+		return waitset_epoll_update(set, fd, before, waitset_fd_mode(set, fd));
+#else
+	WINPR_UNUSED(fd);
+#endif
+	return TRUE;
+}
+
+BOOL WaitSet_Remove(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	if (!set)
+		return FALSE;
+
+	for (size_t x = 0; x < set->count; x++)
+	{
+		if (set->entries[x].handle == handle)
+			return waitset_remove_at(set, x);
+	}
+
+	SetLastError(ERROR_INVALID_HANDLE);
+	return FALSE;
+}
+
+BOOL WaitSet_SetHandles(WINPR_WAIT_SET* set, const HANDLE* handles, size_t count, void* context)
+{
+	if (!set || (!handles && (count > 0)))
+		return FALSE;
+
+	BOOL rc = TRUE;
+	for (size_t x = set->count; x > 0; x--)
+	{
+		const WINPR_WAIT_ENTRY* entry = &set->entries[x - 1];
+		size_t y = 0;
+
+		if (entry->context != context)
+			continue;
+
+		for (; y < count; y++)
+		{
+			if (handles[y] == entry->handle)
+				break;
+		}
+
+		if ((y == count) && !waitset_remove_at(set, x - 1))
+			rc = FALSE;
+	}
+
+	for (size_t y = 0; y < count; y++)
+	{
+		size_t x = 0;
+
+		for (; x < set->count; x++)
+		{
+			if ((set->entries[x].context == context) && (set->entries[x].handle == handles[y]))
+				break;
+		}
+
+		if ((x == set->count) && !waitset_add_ex(set, handles[y], context))
+			return FALSE;
+	}
+
+	return rc;
+}
+
+size_t WaitSet_Count(const WINPR_WAIT_SET* set)
+{
+	if (!set)
+		return 0;
+	return set->count;
+}
+
+DWORD WaitSet_Wait(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	if (!set)
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return WAIT_FAILED;
+	}
+
+	return waitset_wait(set, dwMilliseconds);
+}
+
+DWORD WaitSet_WaitEx(WINPR_WAIT_SET* set, DWORD dwMilliseconds, void** contexts, size_t* count)
+{
+	if (!set || !contexts || !count || (*count == 0))
+	{
+		SetLastError(ERROR_INVALID_PARAMETER);
+		return WAIT_FAILED;
+	}
+
+	const size_t max = *count;
+	*count = 0;
+
+	const DWORD status = waitset_poll(set, dwMilliseconds);
+	if (status != WAIT_OBJECT_0)
+		return status;
+
+	for (size_t x = 0; (x < set->count) && (*count < max); x++)
+	{
+		if (set->entries[x].signaled)
+			contexts[(*count)++] = set->entries[x].context;
+	}
+
+	return WAIT_OBJECT_0;
+}
+
+#else
+
+struct winpr_wait_set
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	void* contexts[MAXIMUM_WAIT_OBJECTS];
+	DWORD count;
+};
+
+WINPR_WAIT_SET* WaitSet_New(void)
+{
+	return calloc(1, sizeof(WINPR_WAIT_SET));
+}
+
+void WaitSet_Free(WINPR_WAIT_SET* set)
+{
+	free(set);
+}
+
+BOOL WaitSet_Add(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	return WaitSet_AddEx(set, handle, NULL);
+}
+
+BOOL WaitSet_AddEx(WINPR_WAIT_SET* set, HANDLE handle, void* context)
+{
+	if (!set || !handle || (set->count >= ARRAYSIZE(set->handles)))
+		return FALSE;
+
+	set->contexts[set->count] = context;
+	set->handles[set->count++] = handle;
+	return TRUE;
+}
+
+static void waitset_remove_at(WINPR_WAIT_SET* set, DWORD index)
+{
+	const DWORD move = set->count - index - 1;
+
+	memmove(&set->handles[index], &set->handles[index + 1], sizeof(HANDLE) * move);
+	memmove(&set->contexts[index], &set->contexts[index + 1], sizeof(void*) * move);
+	set->count--;
+}
+
+BOOL WaitSet_Remove(WINPR_WAIT_SET* set, HANDLE handle)
+{
+	if (!set)
+		return FALSE;
+
+	for (DWORD x = 0; x < set->count; x++)
+	{
+		if (set->handles[x] != handle)
+			continue;
+
+		waitset_remove_at(set, x);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+BOOL WaitSet_SetHandles(WINPR_WAIT_SET* set, const HANDLE* handles, size_t count, void* context)
+{
+	if (!set || (!handles && (count > 0)))
+		return FALSE;
+
+	for (DWORD x = set->count; x > 0; x--)
+	{
+		size_t y = 0;
+
+		if (set->contexts[x - 1] != context)
+			continue;
+
+		for (; y < count; y++)
+		{
+			if (handles[y] == set->handles[x - 1])
+				break;
+		}
+
+		if (y == count)
+			waitset_remove_at(set, x - 1);
+	}
+
+	for (size_t y = 0; y < count; y++)
+	{
+		DWORD x = 0;
+
+		for (; x < set->count; x++)
+		{
+			if ((set->contexts[x] == context) && (set->handles[x] == handles[y]))
+				break;
+		}
+
+		if ((x == set->count) && !WaitSet_AddEx(set, handles[y], context))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+size_t WaitSet_Count(const WINPR_WAIT_SET* set)
+{
+	if (!set)
+		return 0;
+	return set->count;
+}
+
+DWORD WaitSet_Wait(WINPR_WAIT_SET* set, DWORD dwMilliseconds)
+{
+	if (!set || (set->count == 0))
+		return WAIT_FAILED;
+
+	return WaitForMultipleObjects(set->count, set->handles, FALSE, dwMilliseconds);
+}
+
+DWORD WaitSet_WaitEx(WINPR_WAIT_SET* set, DWORD dwMilliseconds, void** contexts, size_t* count)
+{
+	if (!set || !contexts || !count || (*count == 0))
+		return WAIT_FAILED;
+
+	*count = 0;
+
+	/* WaitForMultipleObjects reports a single handle, the others are reported next time */
+	const DWORD status = WaitSet_Wait(set, dwMilliseconds);
+	if ((status < WAIT_OBJECT_0) || (status >= WAIT_OBJECT_0 + set->count))
+		return status;
+
+	contexts[(*count)++] = set->contexts[status - WAIT_OBJECT_0];
+	return WAIT_OBJECT_0;
+}
+
+#endif
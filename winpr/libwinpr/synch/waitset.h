@@ -0,0 +1,56 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * Persistent wait sets
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef WINPR_LIBWINPR_SYNCH_WAITSET_H_
+#define WINPR_LIBWINPR_SYNCH_WAITSET_H_
+
+#include <winpr/wtypes.h>
+#include <winpr/synch.h>
+
+#include <winpr/config.h>
+
+#ifndef _WIN32
+
+typedef struct
+{
+	HANDLE handle;
+	void* context;
+	int fd;
+	ULONG mode;
+	BOOL signaled;
+} WINPR_WAIT_ENTRY;
+
+struct winpr_wait_set
+{
+	WINPR_WAIT_ENTRY* entries;
+	WINPR_WAIT_ENTRY staticEntries[MAXIMUM_WAIT_OBJECTS];
+	size_t count;
+	size_t capacity;
+
+	/* -1 for sets that poll all descriptors on every wait */
+	int epfd;
+};
+
+/* A set that lives for a single wait, as used by WaitForMultipleObjects */
+void waitset_init(WINPR_WAIT_SET* set);
+void waitset_uninit(WINPR_WAIT_SET* set);
+BOOL waitset_add(WINPR_WAIT_SET* set, HANDLE handle);
+BOOL waitset_add_ex(WINPR_WAIT_SET* set, HANDLE handle, void* context);
+DWORD waitset_wait(WINPR_WAIT_SET* set, DWORD dwMilliseconds);
+
+#endif
+
+#endif /* WINPR_LIBWINPR_SYNCH_WAITSET_H_ */